@@ -0,0 +1,189 @@
+/*
+ * 比较 Zstd 压缩 table 时使用和不使用字典的压缩率和解压速度
+ *
+ *   --num=N             写入的条目数
+ *   --dict_bytes=N      字典的大小上限(zstd_max_dict_bytes)
+ *   --train_ratio=N     训练字典使用的样本量是字典大小的多少倍(zstd_max_train_bytes)
+ *   --block_size=N      数据块大小
+ *   --reads=N           每种方式完整扫描 table 的次数
+ *   --file=PATH         临时 table 文件的路径
+ *
+ * value 是 100 字节左右的 JSON 风格小记录，单个数据块内重复的内容不多，
+ * 字典可以把各个块共有的字段名和常见取值提前放进压缩窗口
+ *
+ * 每种方式依次测量:
+ *   build    写出 table，包括采样和训练字典
+ *   size     table 文件大小，以及原始 key/value 字节数与它的比值
+ *   scan     不使用 block cache，完整扫描 reads 遍，每个数据块都要重新读取和解压
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "port/port.h"
+#include "tinydb/comparator.h"
+#include "tinydb/env.h"
+#include "tinydb/iterator.h"
+#include "tinydb/options.h"
+#include "tinydb/table.h"
+#include "tinydb/table_builder.h"
+#include "util/random.h"
+
+namespace {
+
+int FLAGS_num = 200000;
+int FLAGS_dict_bytes = 16 * 1024;
+int FLAGS_train_ratio = 100;
+int FLAGS_block_size = 4 * 1024;
+int FLAGS_reads = 5;
+const char* FLAGS_file = "/tmp/tinydb_compression_dict_bench.ldb";
+
+} // namespace
+
+namespace tinydb {
+
+namespace {
+
+const char* const kTags[] = {"admin", "beta", "mobile", "desktop", "trial",
+                             "premium", "eu", "us", "apac", "internal"};
+const char* const kCities[] = {"Berlin", "London", "Paris", "Tokyo",
+                               "New York", "Shanghai", "Sydney", "Toronto"};
+
+// 第 i 条记录的 value，由 rnd 决定其中的随机部分
+std::string MakeValue(int i, Random* rnd) {
+    char buf[256];
+    std::snprintf(buf, sizeof(buf),
+                  "{\"id\":%d,\"name\":\"user%07d\",\"email\":\"user%07d@example.com\","
+                  "\"city\":\"%s\",\"active\":%s,\"score\":%u,\"tags\":[\"%s\",\"%s\"]}",
+                  i, i, i, kCities[rnd->Uniform(8)],
+                  rnd->OneIn(3) ? "false" : "true", rnd->Uniform(100000),
+                  kTags[rnd->Uniform(10)], kTags[rnd->Uniform(10)]);
+    return buf;
+}
+
+void Run(const char* name, size_t dict_bytes, size_t train_bytes) {
+    Env* env = Env::Default();
+    Options options;
+    options.compression = kZstdCompression;
+    options.block_size = FLAGS_block_size;
+    options.zstd_max_dict_bytes = dict_bytes;
+    options.zstd_max_train_bytes = train_bytes;
+
+    WritableFile* file;
+    Status s = env->NewWritableFile(FLAGS_file, &file);
+    if (!s.ok()) {
+        std::fprintf(stderr, "%s\n", s.ToString().c_str());
+        std::exit(1);
+    }
+
+    // 每种方式写入完全相同的数据
+    Random rnd(301);
+    char key[32];
+    uint64_t raw_bytes = 0;
+    uint64_t start = env->NowMicros();
+    TableBuilder* builder = new TableBuilder(options, file);
+    for (int i = 0; i < FLAGS_num; i++) {
+        std::snprintf(key, sizeof(key), "%016d", i);
+        const std::string value = MakeValue(i, &rnd);
+        builder->Add(Slice(key, 16), value);
+        raw_bytes += 16 + value.size();
+    }
+    s = builder->Finish();
+    if (s.ok()) {
+        s = file->Sync();
+    }
+    if (s.ok()) {
+        s = file->Close();
+    }
+    const uint64_t file_size = builder->FileSize();
+    delete builder;
+    delete file;
+    if (!s.ok()) {
+        std::fprintf(stderr, "%s\n", s.ToString().c_str());
+        std::exit(1);
+    }
+    const uint64_t build_micros = env->NowMicros() - start;
+
+    RandomAccessFile* rfile;
+    Table* table = nullptr;
+    s = env->NewRandomAccessFile(FLAGS_file, &rfile);
+    if (s.ok()) {
+        s = Table::Open(options, rfile, file_size, &table);
+    }
+    if (!s.ok()) {
+        std::fprintf(stderr, "%s\n", s.ToString().c_str());
+        std::exit(1);
+    }
+    ReadOptions read_options;
+    read_options.fill_cache = false;
+    start = env->NowMicros();
+    int count = 0;
+    for (int r = 0; r < FLAGS_reads; r++) {
+        Iterator* iter = table->NewIterator(read_options);
+        for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+            count++;
+        }
+        delete iter;
+    }
+    const uint64_t scan_micros = env->NowMicros() - start;
+    delete table;
+    delete rfile;
+    env->RemoveFile(FLAGS_file);
+
+    std::fprintf(stdout, "%-8s build : %10.1f ms\n", name, build_micros / 1000.0);
+    std::fprintf(stdout, "%-8s size  : %10.1f MB  ratio %6.2f\n", name,
+                 file_size / 1048576.0,
+                 static_cast<double>(raw_bytes) / static_cast<double>(file_size));
+    std::fprintf(stdout, "%-8s scan  : %10.1f MB/s %8d entries\n", name,
+                 scan_micros > 0 ? (static_cast<double>(raw_bytes) * FLAGS_reads /
+                                    1048576.0) / (scan_micros / 1e6)
+                                 : 0.0,
+                 count);
+}
+
+} // namespace
+
+} // namespace tinydb
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        int n;
+        char junk;
+        if (sscanf(argv[i], "--num=%d%c", &n, &junk) == 1) {
+            FLAGS_num = n;
+        } else if (sscanf(argv[i], "--dict_bytes=%d%c", &n, &junk) == 1) {
+            FLAGS_dict_bytes = n;
+        } else if (sscanf(argv[i], "--train_ratio=%d%c", &n, &junk) == 1) {
+            FLAGS_train_ratio = n;
+        } else if (sscanf(argv[i], "--block_size=%d%c", &n, &junk) == 1) {
+            FLAGS_block_size = n;
+        } else if (sscanf(argv[i], "--reads=%d%c", &n, &junk) == 1) {
+            FLAGS_reads = n;
+        } else if (strncmp(argv[i], "--file=", 7) == 0) {
+            FLAGS_file = argv[i] + 7;
+        } else {
+            std::fprintf(stderr, "Invalid flag '%s'\n", argv[i]);
+            std::exit(1);
+        }
+    }
+
+    std::string probe;
+    if (!tinydb::port::Zstd_Compress(1, "x", 1, &probe)) {
+        std::fprintf(stderr, "Zstd is not available in this build\n");
+        return 1;
+    }
+
+    std::fprintf(stdout, "Entries:    %d\n", FLAGS_num);
+    std::fprintf(stdout, "Block size: %d bytes\n", FLAGS_block_size);
+    std::fprintf(stdout, "Dict size:  %d bytes\n", FLAGS_dict_bytes);
+    std::fprintf(stdout, "------------------------------------------------\n");
+
+    const size_t dict_bytes = FLAGS_dict_bytes;
+    tinydb::Run("nodict", 0, 0);
+    // 不训练：直接用样本末尾的原始内容作为字典
+    tinydb::Run("rawdict", dict_bytes, 0);
+    tinydb::Run("trained", dict_bytes, dict_bytes * FLAGS_train_ratio);
+    return 0;
+}
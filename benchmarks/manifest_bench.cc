@@ -0,0 +1,179 @@
+/*
+ * 测量 manifest 的写入和恢复耗时
+ *
+ *   --files=N           存活的文件数
+ *   --batch=N           每个 VersionEdit 加入的文件数
+ *   --churn=N           之后再执行 N 次"加入一个文件再删除"，只增长历史记录
+ *   --max_manifest=N    Options::max_manifest_file_size
+ *   --reads=N           恢复的次数
+ *   --db=PATH           数据库目录，运行前后都会清空
+ *
+ * 依次测量:
+ *   apply    写入所有文件和 churn 的 LogAndApply 总耗时
+ *   size     manifest 大小，以及开头快照的大小
+ *   recover  新建 VersionSet 并 Recover()，取 reads 次的平均值
+ *
+ * 每次 LogAndApply 都要复制一遍所有文件，文件很多时 apply 很慢，
+ * 用 -DCMAKE_BUILD_TYPE=Release 编译
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "db/column_family.h"
+#include "db/version_edit.h"
+#include "db/version_set.h"
+#include "port/port.h"
+#include "tinydb/comparator.h"
+#include "tinydb/env.h"
+#include "tinydb/options.h"
+#include "util/mutexlock.h"
+
+namespace {
+
+int FLAGS_files = 100000;
+int FLAGS_batch = 1000;
+int FLAGS_churn = 500;
+int FLAGS_max_manifest = 4 * 1024 * 1024;
+int FLAGS_reads = 3;
+const char* FLAGS_db = "/tmp/tinydb_manifest_bench";
+
+} // namespace
+
+namespace tinydb {
+
+namespace {
+
+void Check(const Status& s) {
+    if (!s.ok()) {
+        std::fprintf(stderr, "%s\n", s.ToString().c_str());
+        std::exit(1);
+    }
+}
+
+void DestroyDir(Env* env, const std::string& dir) {
+    std::vector<std::string> children;
+    if (env->GetChildren(dir, &children).ok()) {
+        for (const std::string& child : children) {
+            env->RemoveFile(dir + "/" + child);
+        }
+        env->RemoveDir(dir);
+    }
+}
+
+std::string Key(int i) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "key%012d", i);
+    return buf;
+}
+
+void Run() {
+    Env* env = Env::Default();
+    const std::string dbname = FLAGS_db;
+    DestroyDir(env, dbname);
+    {
+        Options db_options;
+        db_options.create_if_missing = true;
+        ColumnFamilySet db(dbname, db_options);
+        Check(db.Open({}));
+    }
+
+    InternalKeyComparator icmp(BytewiseComparator());
+    Options options;
+    options.comparator = &icmp;
+    options.max_manifest_file_size = FLAGS_max_manifest;
+    port::Mutex mu;
+
+    // 文件按 key 顺序分布到 1~6 层，每层内互不重叠
+    VersionSet* versions = new VersionSet(dbname, &options, &icmp);
+    bool save_manifest = false;
+    Check(versions->Recover(&save_manifest));
+    uint64_t start = env->NowMicros();
+    {
+        MutexLock l(&mu);
+        for (int i = 0; i < FLAGS_files; i += FLAGS_batch) {
+            VersionEdit edit;
+            for (int j = i; j < i + FLAGS_batch && j < FLAGS_files; j++) {
+                const int level = 1 + j % (config::kNumLevels - 1);
+                edit.AddFile(level, versions->NewFileNumber(), 2 << 20,
+                             InternalKey(Key(2 * j), 1, kTypeValue),
+                             InternalKey(Key(2 * j + 1), 1, kTypeValue), 0, 0);
+            }
+            Check(versions->LogAndApply(&edit, &mu));
+        }
+        for (int i = 0; i < FLAGS_churn; i++) {
+            const uint64_t number = versions->NewFileNumber();
+            VersionEdit add;
+            add.AddFile(0, number, 2 << 20, InternalKey(Key(0), 2, kTypeValue),
+                        InternalKey(Key(2 * FLAGS_files), 2, kTypeValue), 0, 0);
+            Check(versions->LogAndApply(&add, &mu));
+            VersionEdit remove;
+            remove.RemoveFile(0, number);
+            Check(versions->LogAndApply(&remove, &mu));
+        }
+    }
+    const uint64_t apply_micros = env->NowMicros() - start;
+    const uint64_t manifest_size = versions->ManifestFileSize();
+    const uint64_t snapshot_size = versions->ManifestSnapshotSize();
+    delete versions;
+
+    uint64_t recover_micros = 0;
+    int live_files = 0;
+    for (int r = 0; r < FLAGS_reads; r++) {
+        start = env->NowMicros();
+        versions = new VersionSet(dbname, &options, &icmp);
+        Check(versions->Recover(&save_manifest));
+        recover_micros += env->NowMicros() - start;
+        live_files = 0;
+        for (int level = 0; level < config::kNumLevels; level++) {
+            live_files += versions->NumLevelFiles(level);
+        }
+        delete versions;
+    }
+    DestroyDir(env, dbname);
+
+    const int edits = (FLAGS_files + FLAGS_batch - 1) / FLAGS_batch + 2 * FLAGS_churn;
+    std::fprintf(stdout, "apply   : %10.1f ms  %8d edits\n", apply_micros / 1000.0, edits);
+    std::fprintf(stdout, "size    : %10.1f KB  snapshot %.1f KB\n",
+                 manifest_size / 1024.0, snapshot_size / 1024.0);
+    std::fprintf(stdout, "recover : %10.1f ms  %8d files\n",
+                 recover_micros / 1000.0 / FLAGS_reads, live_files);
+}
+
+} // namespace
+
+} // namespace tinydb
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        int n;
+        char junk;
+        if (sscanf(argv[i], "--files=%d%c", &n, &junk) == 1) {
+            FLAGS_files = n;
+        } else if (sscanf(argv[i], "--batch=%d%c", &n, &junk) == 1 && n > 0) {
+            FLAGS_batch = n;
+        } else if (sscanf(argv[i], "--churn=%d%c", &n, &junk) == 1) {
+            FLAGS_churn = n;
+        } else if (sscanf(argv[i], "--max_manifest=%d%c", &n, &junk) == 1) {
+            FLAGS_max_manifest = n;
+        } else if (sscanf(argv[i], "--reads=%d%c", &n, &junk) == 1 && n > 0) {
+            FLAGS_reads = n;
+        } else if (strncmp(argv[i], "--db=", 5) == 0) {
+            FLAGS_db = argv[i] + 5;
+        } else {
+            std::fprintf(stderr, "Invalid flag '%s'\n", argv[i]);
+            std::exit(1);
+        }
+    }
+
+    std::fprintf(stdout, "Files:        %d\n", FLAGS_files);
+    std::fprintf(stdout, "Files/edit:   %d\n", FLAGS_batch);
+    std::fprintf(stdout, "Churn edits:  %d\n", 2 * FLAGS_churn);
+    std::fprintf(stdout, "Max manifest: %d bytes\n", FLAGS_max_manifest);
+    std::fprintf(stdout, "------------------------------------------------\n");
+    tinydb::Run();
+    return 0;
+}
@@ -0,0 +1,146 @@
+/*
+ * 比较不同 memtable 实现在批量导入(fillrandom)时的性能
+ *
+ *   --num=N             写入的条目数
+ *   --value_size=N      value 的字节数
+ *   --sort_threads=N    vector 实现变为只读时排序使用的线程数
+ *   --reps=a,b,...      要测试的实现: skiplist, vector, hash_skiplist, hash_linklist
+ *
+ * 每个实现依次测量:
+ *   fillrandom  以随机顺序写入 num 个 key(同一个 key 可能写入多次)
+ *   readonly    MarkReadOnly()，vector 实现在这里排序
+ *   scan        从头到尾遍历一遍，相当于 flush 时的读取
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "db/dbformat.h"
+#include "db/memtable.h"
+#include "tinydb/comparator.h"
+#include "tinydb/env.h"
+#include "tinydb/memtable_rep.h"
+#include "tinydb/options.h"
+#include "util/random.h"
+
+namespace {
+
+int FLAGS_num = 1000000;
+int FLAGS_value_size = 100;
+int FLAGS_sort_threads = 4;
+const char* FLAGS_reps = "skiplist,vector";
+
+} // namespace
+
+namespace tinydb {
+
+namespace {
+
+MemTableRepFactory* NewFactory(const std::string& name) {
+    if (name == "skiplist") {
+        return NewSkipListRepFactory();
+    } else if (name == "vector") {
+        return NewVectorRepFactory(FLAGS_sort_threads);
+    } else if (name == "hash_skiplist") {
+        return NewHashSkipListRepFactory();
+    } else if (name == "hash_linklist") {
+        return NewHashLinkListRepFactory();
+    }
+    return nullptr;
+}
+
+void Report(const char* rep, const char* name, uint64_t micros, int ops) {
+    std::fprintf(stdout, "%-14s %-11s : %10.3f micros/op %10.1f ms\n", rep, name,
+                 ops > 0 ? static_cast<double>(micros) / ops : 0.0,
+                 micros / 1000.0);
+}
+
+void Run(const std::string& rep_name) {
+    MemTableRepFactory* factory = NewFactory(rep_name);
+    if (factory == nullptr) {
+        std::fprintf(stderr, "unknown memtable rep: %s\n", rep_name.c_str());
+        return;
+    }
+    Env* env = Env::Default();
+    InternalKeyComparator icmp(BytewiseComparator());
+    Options options;
+    options.memtable_factory = factory;
+    MemTable* mem = new MemTable(icmp, options);
+    mem->Ref();
+
+    // 每个实现使用相同的随机序列
+    Random rnd(301);
+    std::string value(FLAGS_value_size, 'x');
+    char key[32];
+
+    uint64_t start = env->NowMicros();
+    for (int i = 0; i < FLAGS_num; i++) {
+        const int k = rnd.Next() % FLAGS_num;
+        std::snprintf(key, sizeof(key), "%016d", k);
+        mem->Add(i + 1, kTypeValue, Slice(key, 16), value);
+    }
+    Report(rep_name.c_str(), "fillrandom", env->NowMicros() - start, FLAGS_num);
+
+    start = env->NowMicros();
+    mem->MarkReadOnly();
+    Report(rep_name.c_str(), "readonly", env->NowMicros() - start, FLAGS_num);
+
+    start = env->NowMicros();
+    Iterator* iter = mem->NewIterator();
+    int count = 0;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+        count++;
+    }
+    delete iter;
+    Report(rep_name.c_str(), "scan", env->NowMicros() - start, count);
+    std::fprintf(stdout, "%-14s memory     : %10.1f MB\n", rep_name.c_str(),
+                 mem->ApproximateMemoryUsage() / 1048576.0);
+
+    mem->Unref();
+    delete factory;
+}
+
+} // namespace
+
+} // namespace tinydb
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        int n;
+        char junk;
+        if (sscanf(argv[i], "--num=%d%c", &n, &junk) == 1) {
+            FLAGS_num = n;
+        } else if (sscanf(argv[i], "--value_size=%d%c", &n, &junk) == 1) {
+            FLAGS_value_size = n;
+        } else if (sscanf(argv[i], "--sort_threads=%d%c", &n, &junk) == 1) {
+            FLAGS_sort_threads = n;
+        } else if (strncmp(argv[i], "--reps=", 7) == 0) {
+            FLAGS_reps = argv[i] + 7;
+        } else {
+            std::fprintf(stderr, "Invalid flag '%s'\n", argv[i]);
+            std::exit(1);
+        }
+    }
+
+    std::fprintf(stdout, "Entries:    %d\n", FLAGS_num);
+    std::fprintf(stdout, "Keys:       16 bytes each\n");
+    std::fprintf(stdout, "Values:     %d bytes each\n", FLAGS_value_size);
+    std::fprintf(stdout, "------------------------------------------------\n");
+
+    std::string reps = FLAGS_reps;
+    size_t pos = 0;
+    while (pos <= reps.size()) {
+        size_t end = reps.find(',', pos);
+        if (end == std::string::npos) {
+            end = reps.size();
+        }
+        if (end > pos) {
+            tinydb::Run(reps.substr(pos, end - pos));
+        }
+        pos = end + 1;
+    }
+    return 0;
+}
@@ -0,0 +1,163 @@
+/*
+ * 测量 MergingIterator 合并多个有序子迭代器的速度
+ *
+ *   --num=N             所有子迭代器的条目总数
+ *   --children=N        子迭代器个数
+ *   --reads=N           每种布局完整扫描的次数
+ *   --seeks=N           每种布局随机 Seek 的次数
+ *
+ * 子迭代器直接遍历内存中的有序数组，测到的基本上只有合并本身的开销。
+ * 每种布局依次测量:
+ *   range        第 i 个子迭代器持有第 i 段连续的 key，大部分 Next() 的赢家不变
+ *   interleave   第 i 个 key 属于第 i % children 个子迭代器，每次 Next() 的赢家都会变
+ *
+ *   scan         SeekToFirst() 后 Next() 到结尾
+ *   reverse      SeekToLast() 后 Prev() 到开头
+ *   seek         随机 Seek() 之后 Next() 10 次
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "table/merger.h"
+#include "tinydb/comparator.h"
+#include "tinydb/env.h"
+#include "tinydb/iterator.h"
+#include "util/random.h"
+
+namespace {
+
+int FLAGS_num = 3200000;
+int FLAGS_children = 64;
+int FLAGS_reads = 3;
+int FLAGS_seeks = 100000;
+
+} // namespace
+
+namespace tinydb {
+
+namespace {
+
+// 遍历一组有序 key 的迭代器，value 为空
+class KeyArrayIterator : public Iterator {
+public:
+    explicit KeyArrayIterator(const std::vector<std::string>* keys)
+        : keys_(keys), pos_(keys->size()) {}
+
+    bool Valid() const override { return pos_ < keys_->size(); }
+    void SeekToFirst() override { pos_ = 0; }
+    void SeekToLast() override { pos_ = keys_->empty() ? 0 : keys_->size() - 1; }
+    void Seek(const Slice& target) override {
+        pos_ = 0;
+        size_t right = keys_->size();
+        while (pos_ < right) {
+            const size_t mid = pos_ + (right - pos_) / 2;
+            if (Slice((*keys_)[mid]).compare(target) < 0) {
+                pos_ = mid + 1;
+            } else {
+                right = mid;
+            }
+        }
+    }
+    void Next() override { pos_++; }
+    void Prev() override { pos_ = pos_ == 0 ? keys_->size() : pos_ - 1; }
+    Slice key() const override { return (*keys_)[pos_]; }
+    Slice value() const override { return Slice(); }
+    Status status() const override { return Status::OK(); }
+
+private:
+    const std::vector<std::string>* keys_;
+    size_t pos_;
+};
+
+std::string Key(int i) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%016d", i);
+    return buf;
+}
+
+void Report(const char* layout, const char* name, uint64_t micros, int ops) {
+    std::fprintf(stdout, "%-10s %-8s : %10.3f micros/op %10.1f ms\n", layout, name,
+                 ops > 0 ? static_cast<double>(micros) / ops : 0.0, micros / 1000.0);
+}
+
+void Run(const char* layout, bool interleave) {
+    Env* env = Env::Default();
+    std::vector<std::vector<std::string>> keys(FLAGS_children);
+    const int per_child = (FLAGS_num + FLAGS_children - 1) / FLAGS_children;
+    for (int i = 0; i < FLAGS_num; i++) {
+        const int child = interleave ? i % FLAGS_children : i / per_child;
+        keys[child].push_back(Key(i));
+    }
+
+    std::vector<Iterator*> children(FLAGS_children);
+    for (int c = 0; c < FLAGS_children; c++) {
+        children[c] = new KeyArrayIterator(&keys[c]);
+    }
+    Iterator* iter = NewMergingIterator(BytewiseComparator(), children.data(),
+                                        FLAGS_children);
+
+    uint64_t start = env->NowMicros();
+    int count = 0;
+    for (int r = 0; r < FLAGS_reads; r++) {
+        for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+            count++;
+        }
+    }
+    Report(layout, "scan", (env->NowMicros() - start) / FLAGS_reads, count / FLAGS_reads);
+
+    start = env->NowMicros();
+    count = 0;
+    for (int r = 0; r < FLAGS_reads; r++) {
+        for (iter->SeekToLast(); iter->Valid(); iter->Prev()) {
+            count++;
+        }
+    }
+    Report(layout, "reverse", (env->NowMicros() - start) / FLAGS_reads,
+           count / FLAGS_reads);
+
+    Random rnd(301);
+    start = env->NowMicros();
+    for (int i = 0; i < FLAGS_seeks; i++) {
+        iter->Seek(Key(rnd.Uniform(FLAGS_num)));
+        for (int j = 0; j < 10 && iter->Valid(); j++) {
+            iter->Next();
+        }
+    }
+    Report(layout, "seek", env->NowMicros() - start, FLAGS_seeks);
+    delete iter;
+}
+
+} // namespace
+
+} // namespace tinydb
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        int n;
+        char junk;
+        if (sscanf(argv[i], "--num=%d%c", &n, &junk) == 1) {
+            FLAGS_num = n;
+        } else if (sscanf(argv[i], "--children=%d%c", &n, &junk) == 1 && n > 0) {
+            FLAGS_children = n;
+        } else if (sscanf(argv[i], "--reads=%d%c", &n, &junk) == 1 && n > 0) {
+            FLAGS_reads = n;
+        } else if (sscanf(argv[i], "--seeks=%d%c", &n, &junk) == 1) {
+            FLAGS_seeks = n;
+        } else {
+            std::fprintf(stderr, "Invalid flag '%s'\n", argv[i]);
+            std::exit(1);
+        }
+    }
+
+    std::fprintf(stdout, "Entries:    %d\n", FLAGS_num);
+    std::fprintf(stdout, "Children:   %d\n", FLAGS_children);
+    std::fprintf(stdout, "Keys:       16 bytes each\n");
+    std::fprintf(stdout, "------------------------------------------------\n");
+    tinydb::Run("range", false);
+    tinydb::Run("interleave", true);
+    return 0;
+}
@@ -0,0 +1,454 @@
+#include "db/backup_engine.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "db/column_family.h"
+#include "db/filename.h"
+#include "tinydb/env.h"
+#include "util/crc32c.h"
+
+namespace tinydb {
+
+namespace {
+
+// 创建 base 下 relative_file 所在的各级目录
+Status CreateParentDirs(Env* env, const std::string& base,
+                        const std::string& relative_file) {
+    std::string::size_type pos = 0;
+    while ((pos = relative_file.find('/', pos)) != std::string::npos) {
+        const std::string dir = base + "/" + relative_file.substr(0, pos);
+        if (!env->FileExists(dir)) {
+            Status s = env->CreateDir(dir);
+            if (!s.ok()) {
+                return s;
+            }
+        }
+        pos++;
+    }
+    return Status::OK();
+}
+
+// 计算 fname 的大小和 crc32c
+Status ComputeChecksum(Env* env, const std::string& fname, uint64_t* size, uint32_t* crc) {
+    SequentialFile* file;
+    Status s = env->NewSequentialFile(fname, &file);
+    if (!s.ok()) {
+        return s;
+    }
+    *size = 0;
+    *crc = 0;
+    static const int kBufferSize = 64 * 1024;
+    char* space = new char[kBufferSize];
+    while (s.ok()) {
+        Slice fragment;
+        s = file->Read(kBufferSize, &fragment, space);
+        if (!s.ok() || fragment.empty()) {
+            break;
+        }
+        *size += fragment.size();
+        *crc = crc32c::Extend(*crc, fragment.data(), fragment.size());
+    }
+    delete[] space;
+    delete file;
+    return s;
+}
+
+// 共享文件在备份目录中的路径，文件名中加上内容的 crc32c 和大小，
+// 例如 "cf-000001/000012.ldb" 对应 "shared/cf-000001/000012_<crc>_<size>.ldb"
+std::string SharedFilePath(const std::string& db_name, uint32_t crc, uint64_t size) {
+    const std::string::size_type dot = db_name.rfind('.');
+    return "shared/" + db_name.substr(0, dot) + "_" + std::to_string(crc) + "_" +
+           std::to_string(size) + db_name.substr(dot);
+}
+
+// name 是 SharedFilePath() 生成的文件名时返回 true
+bool IsSharedFileName(const std::string& name) {
+    const std::string::size_type sep = name.find('_');
+    const std::string::size_type dot = name.rfind('.');
+    if (sep == std::string::npos || dot == std::string::npos || dot < sep) {
+        return false;
+    }
+    uint64_t number;
+    FileType type;
+    return ParseFileName(name.substr(0, sep) + name.substr(dot), &number, &type);
+}
+
+// 复制 src 到 target 并 Sync()，同时计算大小和 crc32c，失败时删除 target
+Status CopyWithChecksum(Env* env, const std::string& src, const std::string& target,
+                        uint64_t* size, uint32_t* crc) {
+    SequentialFile* src_file;
+    Status s = env->NewSequentialFile(src, &src_file);
+    if (!s.ok()) {
+        return s;
+    }
+    WritableFile* dest_file;
+    s = env->NewWritableFile(target, &dest_file);
+    if (!s.ok()) {
+        delete src_file;
+        return s;
+    }
+    *size = 0;
+    *crc = 0;
+    static const int kBufferSize = 64 * 1024;
+    char* space = new char[kBufferSize];
+    while (s.ok()) {
+        Slice fragment;
+        s = src_file->Read(kBufferSize, &fragment, space);
+        if (!s.ok() || fragment.empty()) {
+            break;
+        }
+        *size += fragment.size();
+        *crc = crc32c::Extend(*crc, fragment.data(), fragment.size());
+        s = dest_file->Append(fragment);
+    }
+    if (s.ok()) {
+        s = dest_file->Sync();
+    }
+    if (s.ok()) {
+        s = dest_file->Close();
+    }
+    delete[] space;
+    delete dest_file;
+    delete src_file;
+    if (!s.ok()) {
+        env->RemoveFile(target);
+    }
+    return s;
+}
+
+// 解析十进制数字组成的文件名
+bool ParseBackupId(const std::string& name, uint32_t* id) {
+    if (name.empty() || name.size() > 9) {
+        return false;
+    }
+    uint32_t v = 0;
+    for (size_t i = 0; i < name.size(); i++) {
+        if (name[i] < '0' || name[i] > '9') {
+            return false;
+        }
+        v = v * 10 + (name[i] - '0');
+    }
+    *id = v;
+    return true;
+}
+
+} // namespace
+
+BackupEngine::BackupEngine(Env* env, const std::string& backup_dir)
+    : env_(env), backup_dir_(backup_dir) {}
+
+std::string BackupEngine::MetaFileName(uint32_t backup_id) const {
+    return backup_dir_ + "/meta/" + std::to_string(backup_id);
+}
+
+std::string BackupEngine::PrivateDirName(uint32_t backup_id) const {
+    return backup_dir_ + "/private/" + std::to_string(backup_id);
+}
+
+Status BackupEngine::Open() {
+    backups_.clear();
+    shared_files_.clear();
+    const char* subdirs[] = {"", "/shared", "/private", "/meta"};
+    for (const char* subdir : subdirs) {
+        const std::string dir = backup_dir_ + subdir;
+        if (!env_->FileExists(dir)) {
+            Status s = env_->CreateDir(dir);
+            if (!s.ok()) {
+                return s;
+            }
+        }
+    }
+
+    std::vector<std::string> children;
+    Status s = env_->GetChildren(backup_dir_ + "/meta", &children);
+    for (size_t i = 0; s.ok() && i < children.size(); i++) {
+        uint32_t id;
+        if (!ParseBackupId(children[i], &id)) {
+            continue;
+        }
+        Backup backup;
+        s = ReadMetaFile(id, &backup);
+        if (s.ok()) {
+            for (const FileInfo& f : backup.files) {
+                if (f.path.compare(0, 7, "shared/") == 0) {
+                    shared_files_[f.path] = f;
+                }
+            }
+            backups_[id] = backup;
+        }
+    }
+    if (s.ok()) {
+        GarbageCollect();
+    }
+    return s;
+}
+
+Status BackupEngine::CreateNewBackup(ColumnFamilySet* db, uint32_t* backup_id) {
+    const uint32_t id = backups_.empty() ? 1 : backups_.rbegin()->first + 1;
+    const std::string private_dir = PrivateDirName(id);
+    Status s = env_->CreateDir(private_dir);
+    if (!s.ok()) {
+        return s;
+    }
+
+    Backup backup;
+    backup.timestamp = env_->NowMicros() / 1000000;
+    std::vector<std::string> new_shared_files;
+    db->DisableFileDeletions();
+    std::vector<LiveFile> files;
+    s = db->GetLiveFiles(true /*flush*/, &files);
+    for (size_t i = 0; s.ok() && i < files.size(); i++) {
+        const LiveFile& lf = files[i];
+        FileInfo info;
+        info.db_name = lf.name;
+        if (lf.type == kTableFile || lf.type == kBlobFile) {
+            // 写完之后不再修改的文件只复制一次。文件编号可能被重建的数据库重复使用，
+            // 按内容的 crc32c 和大小判断是不是同一个文件
+            const std::string src = db->dbname() + "/" + lf.name;
+            s = ComputeChecksum(env_, src, &info.size, &info.crc);
+            if (!s.ok()) {
+                break;
+            }
+            info.path = SharedFilePath(lf.name, info.crc, info.size);
+            if (shared_files_.count(info.path) == 0) {
+                uint64_t size;
+                uint32_t crc;
+                s = CreateParentDirs(env_, backup_dir_, info.path);
+                if (s.ok()) {
+                    s = CopyWithChecksum(env_, src, backup_dir_ + "/" + info.path, &size, &crc);
+                }
+                if (s.ok()) {
+                    new_shared_files.push_back(info.path);
+                    if (size != info.size || crc != info.crc) {
+                        s = Status::Corruption("file changed during backup", lf.name);
+                    }
+                }
+            }
+            backup.files.push_back(info);
+            continue;
+        }
+
+        info.path = "private/" + std::to_string(id) + "/" + lf.name;
+        info.size = lf.contents.size();
+        info.crc = crc32c::Value(lf.contents.data(), lf.contents.size());
+        s = CreateParentDirs(env_, backup_dir_, info.path);
+        if (s.ok()) {
+            s = WriteStringToFileSync(env_, lf.contents, backup_dir_ + "/" + info.path);
+        }
+        backup.files.push_back(info);
+
+        // 每个 manifest 所在的目录需要一个指向它的 CURRENT
+        if (s.ok() && lf.type == kDescriptorFile) {
+            const std::string::size_type slash = lf.name.rfind('/');
+            const std::string dir =
+                    (slash == std::string::npos) ? "" : lf.name.substr(0, slash + 1);
+            const std::string current = lf.name.substr(dir.size()) + "\n";
+            FileInfo current_info;
+            current_info.db_name = dir + "CURRENT";
+            current_info.path = "private/" + std::to_string(id) + "/" + current_info.db_name;
+            current_info.size = current.size();
+            current_info.crc = crc32c::Value(current.data(), current.size());
+            s = WriteStringToFileSync(env_, current, backup_dir_ + "/" + current_info.path);
+            backup.files.push_back(current_info);
+        }
+    }
+    db->EnableFileDeletions();
+
+    // meta 文件写完之后备份才算成功
+    if (s.ok()) {
+        s = WriteMetaFile(id, backup);
+    }
+    if (!s.ok()) {
+        RemoveDirTree(env_, private_dir);
+        for (const std::string& path : new_shared_files) {
+            env_->RemoveFile(backup_dir_ + "/" + path);
+        }
+        return s;
+    }
+
+    for (const FileInfo& f : backup.files) {
+        if (f.path.compare(0, 7, "shared/") == 0) {
+            shared_files_[f.path] = f;
+        }
+    }
+    backups_[id] = backup;
+    *backup_id = id;
+    return s;
+}
+
+void BackupEngine::GetBackupInfo(std::vector<BackupInfo>* infos) const {
+    infos->clear();
+    for (auto& entry : backups_) {
+        BackupInfo info;
+        info.backup_id = entry.first;
+        info.timestamp = entry.second.timestamp;
+        info.size = 0;
+        info.number_files = static_cast<uint32_t>(entry.second.files.size());
+        for (const FileInfo& f : entry.second.files) {
+            info.size += f.size;
+        }
+        infos->push_back(info);
+    }
+}
+
+Status BackupEngine::DeleteBackup(uint32_t backup_id) {
+    auto it = backups_.find(backup_id);
+    if (it == backups_.end()) {
+        return Status::NotFound("backup not found");
+    }
+    // 先删除 meta 文件，中途失败时剩下的文件由下一次 GarbageCollect() 删除
+    Status s = env_->RemoveFile(MetaFileName(backup_id));
+    if (!s.ok()) {
+        return s;
+    }
+    backups_.erase(it);
+
+    shared_files_.clear();
+    for (auto& entry : backups_) {
+        for (const FileInfo& f : entry.second.files) {
+            if (f.path.compare(0, 7, "shared/") == 0) {
+                shared_files_[f.path] = f;
+            }
+        }
+    }
+    GarbageCollect();
+    return s;
+}
+
+Status BackupEngine::PurgeOldBackups(uint32_t num_backups_to_keep) {
+    Status s;
+    while (s.ok() && backups_.size() > num_backups_to_keep) {
+        s = DeleteBackup(backups_.begin()->first);
+    }
+    return s;
+}
+
+Status BackupEngine::RestoreDBFromBackup(uint32_t backup_id, const std::string& db_dir) {
+    auto it = backups_.find(backup_id);
+    if (it == backups_.end()) {
+        return Status::NotFound("backup not found");
+    }
+    if (env_->FileExists(CurrentFileName(db_dir))) {
+        return Status::InvalidArgument(db_dir, "already contains a database");
+    }
+    if (!env_->FileExists(db_dir)) {
+        Status s = env_->CreateDir(db_dir);
+        if (!s.ok()) {
+            return s;
+        }
+    }
+
+    Status s;
+    for (const FileInfo& f : it->second.files) {
+        s = CreateParentDirs(env_, db_dir, f.db_name);
+        uint64_t size = 0;
+        uint32_t crc = 0;
+        if (s.ok()) {
+            s = CopyWithChecksum(env_, backup_dir_ + "/" + f.path, db_dir + "/" + f.db_name,
+                                 &size, &crc);
+        }
+        if (s.ok() && (size != f.size || crc != f.crc)) {
+            s = Status::Corruption("backup file checksum mismatch", f.path);
+        }
+        if (!s.ok()) {
+            break;
+        }
+    }
+    return s;
+}
+
+Status BackupEngine::WriteMetaFile(uint32_t backup_id, const Backup& backup) {
+    // 每行一个文件：备份目录中的路径 数据库中的路径 大小 crc32c
+    std::string contents = std::to_string(backup.timestamp) + "\n" +
+                           std::to_string(backup.files.size()) + "\n";
+    for (const FileInfo& f : backup.files) {
+        contents += f.path + " " + f.db_name + " " + std::to_string(f.size) + " " +
+                    std::to_string(f.crc) + "\n";
+    }
+    const std::string fname = MetaFileName(backup_id);
+    const std::string tmp = fname + ".tmp";
+    Status s = WriteStringToFileSync(env_, contents, tmp);
+    if (s.ok()) {
+        s = env_->RenameFile(tmp, fname);
+    }
+    if (!s.ok()) {
+        env_->RemoveFile(tmp);
+    }
+    return s;
+}
+
+Status BackupEngine::ReadMetaFile(uint32_t backup_id, Backup* backup) {
+    std::string contents;
+    Status s = ReadFileToString(env_, MetaFileName(backup_id), &contents);
+    if (!s.ok()) {
+        return s;
+    }
+    std::vector<std::string> lines;
+    std::string::size_type start = 0, end;
+    while ((end = contents.find('\n', start)) != std::string::npos) {
+        lines.push_back(contents.substr(start, end - start));
+        start = end + 1;
+    }
+    if (lines.size() < 2 || lines.size() - 2 != std::strtoull(lines[1].c_str(), nullptr, 10)) {
+        return Status::Corruption("bad backup meta file", MetaFileName(backup_id));
+    }
+    backup->timestamp = std::strtoull(lines[0].c_str(), nullptr, 10);
+    backup->files.clear();
+    for (size_t i = 2; i < lines.size(); i++) {
+        char path[256], db_name[256];
+        unsigned long long size;
+        unsigned int crc;
+        if (std::sscanf(lines[i].c_str(), "%255s %255s %llu %u", path, db_name, &size,
+                        &crc) != 4) {
+            return Status::Corruption("bad backup meta file", MetaFileName(backup_id));
+        }
+        FileInfo f;
+        f.path = path;
+        f.db_name = db_name;
+        f.size = size;
+        f.crc = crc;
+        backup->files.push_back(f);
+    }
+    return s;
+}
+
+void BackupEngine::GarbageCollect() {
+    std::vector<std::string> children;
+    env_->GetChildren(backup_dir_ + "/private", &children);
+    for (size_t i = 0; i < children.size(); i++) {
+        uint32_t id;
+        if (ParseBackupId(children[i], &id) && backups_.count(id) == 0) {
+            RemoveDirTree(env_, PrivateDirName(id));
+        }
+    }
+    env_->GetChildren(backup_dir_ + "/meta", &children);
+    for (size_t i = 0; i < children.size(); i++) {
+        uint32_t id;
+        if (children[i] != "." && children[i] != ".." &&
+            !(ParseBackupId(children[i], &id) && backups_.count(id) > 0)) {
+            env_->RemoveFile(backup_dir_ + "/meta/" + children[i]);
+        }
+    }
+
+    // shared 下是数据库目录结构的一个子集，最多两层
+    std::vector<std::string> dirs(1, "shared");
+    for (size_t d = 0; d < dirs.size(); d++) {
+        env_->GetChildren(backup_dir_ + "/" + dirs[d], &children);
+        for (size_t i = 0; i < children.size(); i++) {
+            if (children[i] == "." || children[i] == "..") {
+                continue;
+            }
+            const std::string path = dirs[d] + "/" + children[i];
+            uint64_t number;
+            FileType type;
+            if (!IsSharedFileName(children[i]) && !ParseFileName(children[i], &number, &type)) {
+                dirs.push_back(path);
+            } else if (shared_files_.count(path) == 0) {
+                env_->RemoveFile(backup_dir_ + "/" + path);
+            }
+        }
+    }
+}
+
+} // namespace tinydb
@@ -0,0 +1,93 @@
+#ifndef STORAGE_TINYDB_DB_BACKUP_ENGINE_H_
+#define STORAGE_TINYDB_DB_BACKUP_ENGINE_H_
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "tinydb/status.h"
+
+namespace tinydb {
+
+class ColumnFamilySet;
+class Env;
+
+struct BackupInfo {
+    uint32_t backup_id;
+    uint64_t timestamp;  // 生成时间，单位秒
+    uint64_t size;       // 引用的所有文件的总大小，包括与其他备份共享的文件
+    uint32_t number_files;
+};
+
+/*
+ * 增量备份：table 和 blob 文件写完之后不再修改，备份目录中已经有的文件不再复制，
+ * 每次备份只复制上次备份之后新生成的文件，以及 manifest 和很短的 WAL 尾部
+ *
+ * 备份目录的结构：
+ *   shared/<相对路径>     table 和 blob 文件，被多个备份共享。文件名中加上内容的
+ *                         crc32c 和大小，例如 "shared/cf-000001/000012_<crc>_<size>.ldb"
+ *   private/<id>/<相对路径> 每个备份自己的 manifest、CURRENT 和 WAL
+ *   meta/<id>             备份包含的文件及其大小和 crc32c，写完之后才算备份成功
+ * 相对路径与数据库目录中的相同，例如 "cf-000001/000012.ldb"
+ *
+ * 重建的数据库或者另一个数据库可以备份到同一个目录，编号相同而内容不同的文件
+ * 分别保存。不是线程安全的，外部需要同步
+ */
+class BackupEngine {
+public:
+    BackupEngine(Env* env, const std::string& backup_dir);
+
+    BackupEngine(const BackupEngine&) = delete;
+    BackupEngine& operator=(const BackupEngine&) = delete;
+
+    // 读取已有的备份，并删除失败的备份留下的文件
+    Status Open();
+
+    // 备份 db 的当前状态，成功时把编号存到 *backup_id
+    Status CreateNewBackup(ColumnFamilySet* db, uint32_t* backup_id);
+
+    // 按编号从小到大返回所有备份
+    void GetBackupInfo(std::vector<BackupInfo>* infos) const;
+
+    // 删除一个备份，以及不再被任何备份引用的共享文件
+    Status DeleteBackup(uint32_t backup_id);
+
+    // 只保留最新的 num_backups_to_keep 个备份
+    Status PurgeOldBackups(uint32_t num_backups_to_keep);
+
+    // 把备份恢复到 db_dir，每个文件都检查大小和 crc32c。db_dir 中不能已经有数据库
+    Status RestoreDBFromBackup(uint32_t backup_id, const std::string& db_dir);
+
+private:
+    struct FileInfo {
+        std::string path;     // 在备份目录中的相对路径
+        std::string db_name;  // 在数据库目录中的相对路径
+        uint64_t size;
+        uint32_t crc;
+    };
+
+    struct Backup {
+        uint64_t timestamp;
+        std::vector<FileInfo> files;
+    };
+
+    std::string MetaFileName(uint32_t backup_id) const;
+    std::string PrivateDirName(uint32_t backup_id) const;
+
+    Status WriteMetaFile(uint32_t backup_id, const Backup& backup);
+    Status ReadMetaFile(uint32_t backup_id, Backup* backup);
+
+    // 删除没有被任何备份引用的共享文件和没有 meta 文件的 private 目录
+    void GarbageCollect();
+
+    Env* const env_;
+    const std::string backup_dir_;
+    std::map<uint32_t, Backup> backups_;
+    // 所有备份引用的共享文件，key 是 FileInfo::path
+    std::map<std::string, FileInfo> shared_files_;
+};
+
+} // namespace tinydb
+
+#endif  // STORAGE_TINYDB_DB_BACKUP_ENGINE_H_
@@ -0,0 +1,247 @@
+#include "db/backup_engine.h"
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include "db/column_family.h"
+#include "db/filename.h"
+#include "db/secondary_instance.h"
+#include "gtest/gtest.h"
+#include "tinydb/env.h"
+#include "tinydb/write_batch.h"
+#include "util/testutil.h"
+
+namespace tinydb {
+
+class BackupEngineTest : public testing::Test {
+public:
+    BackupEngineTest() : db_(nullptr) {
+        root_ = test::NewTestDirectory("backup_engine_test");
+        dbname_ = root_ + "/db";
+        backup_dir_ = root_ + "/backup";
+        options_.env = &env_;
+        options_.create_if_missing = true;
+    }
+
+    ~BackupEngineTest() override { delete db_; }
+
+    Status Open() {
+        delete db_;
+        db_ = new ColumnFamilySet(dbname_, options_);
+        return db_->Open({});
+    }
+
+    // 写入 [begin,end) 的 key 后 flush
+    void PutAndFlush(int begin, int end, const std::string& value) {
+        WriteBatch batch;
+        for (int i = begin; i < end; i++) {
+            batch.Put(0, "k" + std::to_string(i), value);
+        }
+        ASSERT_TRUE(db_->Write(WriteOptions(), &batch).ok());
+        ASSERT_TRUE(db_->Flush(db_->GetColumnFamily(0u)).ok());
+    }
+
+    // 用 secondary 实例读出 dir 中的数据库，不存在时为 "NOT_FOUND"
+    std::string Get(const std::string& dir, const std::string& key) {
+        SecondaryInstance secondary(dir, options_);
+        Status s = secondary.Open({});
+        if (!s.ok()) {
+            return s.ToString();
+        }
+        std::string value;
+        s = secondary.Get(ReadOptions(), key, &value);
+        if (s.IsNotFound()) {
+            return "NOT_FOUND";
+        }
+        return s.ok() ? value : s.ToString();
+    }
+
+    // dir 中 type 类型的文件名
+    std::set<std::string> Files(const std::string& dir, FileType type) {
+        std::vector<std::string> children;
+        env_.GetChildren(dir, &children);
+        std::set<std::string> result;
+        uint64_t number;
+        FileType t;
+        for (const std::string& f : children) {
+            if (ParseFileName(f, &number, &t) && t == type) {
+                result.insert(f);
+            }
+        }
+        return result;
+    }
+
+    // 备份目录中共享的 table 文件，文件名去掉 crc32c 和大小之后就是数据库中的文件名
+    std::set<std::string> SharedTables() {
+        std::vector<std::string> children;
+        env_.GetChildren(backup_dir_ + "/shared", &children);
+        std::set<std::string> result;
+        for (const std::string& f : children) {
+            const std::string::size_type sep = f.find('_');
+            const std::string::size_type dot = f.rfind('.');
+            if (sep != std::string::npos && dot != std::string::npos &&
+                f.substr(dot) == ".ldb") {
+                result.insert(f.substr(0, sep) + f.substr(dot));
+            }
+        }
+        return result;
+    }
+
+    // 备份目录中共享的文件的完整路径
+    std::vector<std::string> SharedFilePaths() {
+        std::vector<std::string> children;
+        env_.GetChildren(backup_dir_ + "/shared", &children);
+        std::vector<std::string> result;
+        for (const std::string& f : children) {
+            if (f != "." && f != "..") {
+                result.push_back(backup_dir_ + "/shared/" + f);
+            }
+        }
+        return result;
+    }
+
+    test::ErrorEnv env_;
+    std::string root_;
+    std::string dbname_;
+    std::string backup_dir_;
+    Options options_;
+    ColumnFamilySet* db_;
+};
+
+TEST_F(BackupEngineTest, IncrementalBackupAndRestore) {
+    ASSERT_TRUE(Open().ok());
+    PutAndFlush(0, 100, "v1");
+    BackupEngine engine(&env_, backup_dir_);
+    ASSERT_TRUE(engine.Open().ok());
+    uint32_t id1, id2;
+    ASSERT_TRUE(engine.CreateNewBackup(db_, &id1).ok());
+    const std::set<std::string> tables1 = Files(dbname_, kTableFile);
+
+    // 第二个备份只复制新的 table，还在 memtable 中的数据通过 WAL 备份
+    PutAndFlush(50, 150, "v2");
+    WriteBatch batch;
+    batch.Put(0, "unflushed", "v3");
+    ASSERT_TRUE(db_->Write(WriteOptions(), &batch).ok());
+    ASSERT_TRUE(engine.CreateNewBackup(db_, &id2).ok());
+    EXPECT_EQ(1u, id1);
+    EXPECT_EQ(2u, id2);
+    const std::set<std::string> tables2 = Files(dbname_, kTableFile);
+    std::set<std::string> all = tables1;
+    all.insert(tables2.begin(), tables2.end());
+    EXPECT_EQ(all, SharedTables());
+
+    std::vector<BackupInfo> infos;
+    engine.GetBackupInfo(&infos);
+    ASSERT_EQ(2u, infos.size());
+    EXPECT_EQ(id1, infos[0].backup_id);
+    EXPECT_LT(infos[0].number_files, infos[1].number_files);
+    EXPECT_LT(infos[0].size, infos[1].size);
+
+    const std::string restore1 = root_ + "/restore1";
+    const std::string restore2 = root_ + "/restore2";
+    ASSERT_TRUE(engine.RestoreDBFromBackup(id1, restore1).ok());
+    ASSERT_TRUE(engine.RestoreDBFromBackup(id2, restore2).ok());
+    EXPECT_EQ("v1", Get(restore1, "k60"));
+    EXPECT_EQ("NOT_FOUND", Get(restore1, "k120"));
+    EXPECT_EQ("NOT_FOUND", Get(restore1, "unflushed"));
+    EXPECT_EQ("v1", Get(restore2, "k10"));
+    EXPECT_EQ("v2", Get(restore2, "k60"));
+    EXPECT_EQ("v3", Get(restore2, "unflushed"));
+
+    // 重新打开后仍然有两个备份；删除旧的备份只删除它独有的共享文件
+    BackupEngine reopened(&env_, backup_dir_);
+    ASSERT_TRUE(reopened.Open().ok());
+    reopened.GetBackupInfo(&infos);
+    ASSERT_EQ(2u, infos.size());
+    ASSERT_TRUE(reopened.DeleteBackup(id1).ok());
+    EXPECT_EQ(tables2, SharedTables());
+    EXPECT_FALSE(env_.FileExists(backup_dir_ + "/private/1"));
+    ASSERT_TRUE(reopened.PurgeOldBackups(0).ok());
+    reopened.GetBackupInfo(&infos);
+    EXPECT_TRUE(infos.empty());
+    EXPECT_TRUE(SharedTables().empty());
+}
+
+TEST_F(BackupEngineTest, RecreatedDatabase) {
+    ASSERT_TRUE(Open().ok());
+    PutAndFlush(0, 100, "v1");
+    BackupEngine engine(&env_, backup_dir_);
+    ASSERT_TRUE(engine.Open().ok());
+    uint32_t id1, id2;
+    ASSERT_TRUE(engine.CreateNewBackup(db_, &id1).ok());
+    const std::set<std::string> tables1 = Files(dbname_, kTableFile);
+
+    // 重建的数据库重复使用文件编号，大小相同、内容不同的文件不能被当作已经备份过
+    delete db_;
+    db_ = nullptr;
+    RemoveDirTree(&env_, dbname_);
+    ASSERT_TRUE(Open().ok());
+    PutAndFlush(0, 100, "v2");
+    EXPECT_EQ(tables1, Files(dbname_, kTableFile));
+    ASSERT_TRUE(engine.CreateNewBackup(db_, &id2).ok());
+    EXPECT_EQ(2u * tables1.size(), SharedFilePaths().size());
+
+    const std::string restore1 = root_ + "/restore1";
+    const std::string restore2 = root_ + "/restore2";
+    ASSERT_TRUE(engine.RestoreDBFromBackup(id1, restore1).ok());
+    ASSERT_TRUE(engine.RestoreDBFromBackup(id2, restore2).ok());
+    EXPECT_EQ("v1", Get(restore1, "k10"));
+    EXPECT_EQ("v2", Get(restore2, "k10"));
+
+    // 内容相同的文件仍然只复制一次
+    uint32_t id3;
+    ASSERT_TRUE(engine.CreateNewBackup(db_, &id3).ok());
+    EXPECT_EQ(2u * tables1.size(), SharedFilePaths().size());
+    ASSERT_TRUE(engine.DeleteBackup(id2).ok());
+    EXPECT_EQ(2u * tables1.size(), SharedFilePaths().size());
+    ASSERT_TRUE(engine.DeleteBackup(id1).ok());
+    EXPECT_EQ(tables1.size(), SharedFilePaths().size());
+    EXPECT_EQ("v2", Get(restore2, "k10"));
+}
+
+TEST_F(BackupEngineTest, Errors) {
+    ASSERT_TRUE(Open().ok());
+    PutAndFlush(0, 100, "v1");
+    BackupEngine engine(&env_, backup_dir_);
+    ASSERT_TRUE(engine.Open().ok());
+    uint32_t id;
+    ASSERT_TRUE(engine.CreateNewBackup(db_, &id).ok());
+
+    EXPECT_TRUE(engine.RestoreDBFromBackup(id + 1, root_ + "/restore").IsNotFound());
+    EXPECT_TRUE(engine.DeleteBackup(id + 1).IsNotFound());
+    // 目标目录中已经有数据库
+    EXPECT_TRUE(engine.RestoreDBFromBackup(id, dbname_).IsInvalidArgument());
+
+    // 写 manifest 失败时备份不成功，已经复制的新 table 也被删除
+    const std::set<std::string> shared = SharedTables();
+    PutAndFlush(100, 200, "v2");
+    env_.FailNewFiles(kDescriptorFile, true);
+    uint32_t failed_id;
+    Status s = engine.CreateNewBackup(db_, &failed_id);
+    env_.FailNewFiles(kDescriptorFile, false);
+    EXPECT_TRUE(s.IsIOError()) << s.ToString();
+    std::vector<BackupInfo> infos;
+    engine.GetBackupInfo(&infos);
+    EXPECT_EQ(1u, infos.size());
+    EXPECT_EQ(shared, SharedTables());
+    EXPECT_FALSE(env_.FileExists(backup_dir_ + "/private/" + std::to_string(id + 1)));
+
+    // 共享文件的内容被改动，恢复时检查出来
+    ASSERT_EQ(1u, SharedFilePaths().size());
+    const std::string victim = SharedFilePaths()[0];
+    std::string contents;
+    ASSERT_TRUE(ReadFileToString(&env_, victim, &contents).ok());
+    contents[contents.size() / 2] ^= 0x1;
+    ASSERT_TRUE(WriteStringToFile(&env_, contents, victim).ok());
+    s = engine.RestoreDBFromBackup(id, root_ + "/restore");
+    EXPECT_TRUE(s.IsCorruption()) << s.ToString();
+
+    // meta 文件损坏时打开失败
+    ASSERT_TRUE(WriteStringToFile(&env_, "1\n5\n", backup_dir_ + "/meta/" + std::to_string(id))
+                        .ok());
+    BackupEngine reopened(&env_, backup_dir_);
+    EXPECT_TRUE(reopened.Open().IsCorruption());
+}
+
+} // namespace tinydb
@@ -0,0 +1,121 @@
+#include "db/blob_file_builder.h"
+
+#include <cassert>
+
+#include "db/blob_format.h"
+#include "db/builder.h"
+#include "db/filename.h"
+#include "db/version_edit.h"
+#include "tinydb/env.h"
+#include "util/coding.h"
+
+namespace tinydb {
+
+BlobFileBuilder::BlobFileBuilder(const std::string& dbname, Env* env,
+                                 const Options& options, uint64_t file_number)
+    : dbname_(dbname),
+      env_(env),
+      options_(options),
+      file_number_(file_number),
+      file_(nullptr),
+      offset_(0),
+      blob_count_(0),
+      blob_bytes_(0),
+      closed_(false) {}
+
+BlobFileBuilder::~BlobFileBuilder() {
+    assert(closed_);
+    delete file_;
+}
+
+Status BlobFileBuilder::OpenFile() {
+    // blob 文件与 table 文件一样经过 flush/compaction 的 I/O 选项和限速器
+    Status s = NewTableWritableFile(env_, BlobFileName(dbname_, file_number_),
+                                    options_, &file_);
+    if (!s.ok()) {
+        return s;
+    }
+    char header[kBlobFileHeaderSize];
+    EncodeFixed64(header, kBlobFileMagic);
+    EncodeFixed32(header + 8, kBlobFileVersion);
+    s = file_->Append(Slice(header, sizeof(header)));
+    if (s.ok()) {
+        offset_ = sizeof(header);
+    }
+    return s;
+}
+
+Status BlobFileBuilder::Add(const Slice& key, const Slice& value,
+                            std::string* blob_index) {
+    assert(!closed_);
+    if (!status_.ok()) {
+        return status_;
+    }
+    if (file_ == nullptr) {
+        status_ = OpenFile();
+        if (!status_.ok()) {
+            return status_;
+        }
+    }
+
+    char header[kBlobRecordHeaderSize];
+    EncodeBlobRecordHeader(key, value, header);
+    status_ = file_->Append(Slice(header, sizeof(header)));
+    if (status_.ok()) {
+        status_ = file_->Append(key);
+    }
+    if (status_.ok()) {
+        status_ = file_->Append(value);
+    }
+    if (!status_.ok()) {
+        return status_;
+    }
+
+    const uint64_t value_offset = offset_ + BlobRecordPrefixSize(key.size());
+    offset_ = value_offset + value.size();
+    blob_count_++;
+    blob_bytes_ += value.size();
+
+    blob_index->clear();
+    BlobIndex(file_number_, value_offset, value.size()).EncodeTo(blob_index);
+    return Status::OK();
+}
+
+Status BlobFileBuilder::Finish() {
+    assert(!closed_);
+    closed_ = true;
+    if (file_ == nullptr || !status_.ok()) {
+        return status_;
+    }
+    char footer[kBlobFileFooterSize];
+    EncodeFixed64(footer, blob_count_);
+    EncodeFixed64(footer + 8, blob_bytes_);
+    EncodeFixed64(footer + 16, kBlobFileMagic);
+    status_ = file_->Append(Slice(footer, sizeof(footer)));
+    if (status_.ok()) {
+        offset_ += sizeof(footer);
+        status_ = file_->Sync();
+    }
+    if (status_.ok()) {
+        status_ = file_->Close();
+    }
+    return status_;
+}
+
+void BlobFileBuilder::Abandon() {
+    if (file_ != nullptr) {
+        if (!closed_) {
+            file_->Close();
+        }
+        env_->RemoveFile(BlobFileName(dbname_, file_number_));
+    }
+    closed_ = true;
+}
+
+void BlobFileBuilder::AddToEdit(VersionEdit* edit) const {
+    if (blob_count_ > 0) {
+        edit->AddBlobFile(file_number_, blob_count_, blob_bytes_);
+    }
+}
+
+} // namespace tinydb
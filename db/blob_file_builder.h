@@ -0,0 +1,71 @@
+#ifndef STORAGE_TINYDB_DB_BLOB_FILE_BUILDER_H_
+#define STORAGE_TINYDB_DB_BLOB_FILE_BUILDER_H_
+
+#include <cstdint>
+#include <string>
+
+#include "tinydb/options.h"
+#include "tinydb/slice.h"
+#include "tinydb/status.h"
+
+namespace tinydb {
+
+class Env;
+class VersionEdit;
+class WritableFile;
+
+/*
+ * flush/compaction 时把大 value 写到编号为 file_number 的 blob 文件(格式见 db/blob_format.h)
+ * 第一次 Add() 时才创建文件，没有写入任何 blob 时不产生文件
+ *
+ * 使用方法：对每个 value 调用 Add()，返回的 BlobIndex 代替 value 写入 table；
+ * table 写完之后调用 Finish() 把 blob 文件落盘，出错时调用 Abandon() 删除它
+ */
+class BlobFileBuilder {
+public:
+    BlobFileBuilder(const std::string& dbname, Env* env, const Options& options,
+                    uint64_t file_number);
+
+    BlobFileBuilder(const BlobFileBuilder&) = delete;
+    BlobFileBuilder& operator=(const BlobFileBuilder&) = delete;
+
+    // REQUIRES: Finish(), Abandon() have been called
+    ~BlobFileBuilder();
+
+    // 把 key 的 value 追加到 blob 文件，编码后的 BlobIndex 存到 *blob_index
+    Status Add(const Slice& key, const Slice& value, std::string* blob_index);
+
+    // 写 footer 并 sync，写过 blob 时才有文件
+    Status Finish();
+
+    // 放弃已经写入的内容并删除文件，Finish() 失败或 table 写失败之后都可以调用
+    void Abandon();
+
+    // 把生成的 blob 文件登记到 edit 中，没有写入 blob 时什么都不做
+    void AddToEdit(VersionEdit* edit) const;
+
+    uint64_t file_number() const { return file_number_; }
+    uint64_t blob_count() const { return blob_count_; }
+    // 所有 value 的字节数之和，与 garbage 的统计口径相同
+    uint64_t blob_bytes() const { return blob_bytes_; }
+    uint64_t file_size() const { return offset_; }
+
+private:
+    Status OpenFile();
+
+    const std::string dbname_;
+    Env* const env_;
+    const Options options_;
+    const uint64_t file_number_;
+
+    WritableFile* file_;
+    uint64_t offset_;
+    uint64_t blob_count_;
+    uint64_t blob_bytes_;
+    Status status_;
+    bool closed_;
+};
+
+} // namespace tinydb
+
+#endif  // STORAGE_TINYDB_DB_BLOB_FILE_BUILDER_H_
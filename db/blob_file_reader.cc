@@ -0,0 +1,100 @@
+#include "db/blob_file_reader.h"
+
+#include "db/blob_format.h"
+#include "db/filename.h"
+#include "tinydb/env.h"
+#include "util/coding.h"
+
+namespace tinydb {
+
+Status BlobFileReader::Open(Env* env, const std::string& dbname,
+                            uint64_t file_number, BlobFileReader** reader) {
+    *reader = nullptr;
+    const std::string fname = BlobFileName(dbname, file_number);
+    uint64_t file_size;
+    Status s = env->GetFileSize(fname, &file_size);
+    if (!s.ok()) {
+        return s;
+    }
+    if (file_size < kBlobFileHeaderSize + kBlobFileFooterSize) {
+        return Status::Corruption("blob file too short", fname);
+    }
+    RandomAccessFile* file;
+    s = env->NewRandomAccessFile(fname, &file);
+    if (!s.ok()) {
+        return s;
+    }
+    BlobFileReader* r = new BlobFileReader(file, file_number, file_size);
+    s = r->ReadHeaderAndFooter();
+    if (!s.ok()) {
+        delete r;
+        return s;
+    }
+    *reader = r;
+    return s;
+}
+
+BlobFileReader::~BlobFileReader() { delete file_; }
+
+Status BlobFileReader::ReadHeaderAndFooter() {
+    char header_space[kBlobFileHeaderSize];
+    Slice header;
+    Status s = file_->Read(0, kBlobFileHeaderSize, &header, header_space);
+    if (!s.ok()) {
+        return s;
+    }
+    if (header.size() != kBlobFileHeaderSize ||
+        DecodeFixed64(header.data()) != kBlobFileMagic) {
+        return Status::Corruption("not a blob file");
+    }
+    if (DecodeFixed32(header.data() + 8) != kBlobFileVersion) {
+        return Status::NotSupported("unknown blob file version");
+    }
+
+    char footer_space[kBlobFileFooterSize];
+    Slice footer;
+    s = file_->Read(file_size_ - kBlobFileFooterSize, kBlobFileFooterSize,
+                    &footer, footer_space);
+    if (!s.ok()) {
+        return s;
+    }
+    // 没有 footer 说明文件没有写完(写的过程中崩溃)，这样的文件不会被 manifest 引用
+    if (footer.size() != kBlobFileFooterSize ||
+        DecodeFixed64(footer.data() + 16) != kBlobFileMagic) {
+        return Status::Corruption("blob file footer missing");
+    }
+    blob_count_ = DecodeFixed64(footer.data());
+    blob_bytes_ = DecodeFixed64(footer.data() + 8);
+    return Status::OK();
+}
+
+Status BlobFileReader::GetBlob(const Slice& key, const BlobIndex& index,
+                               std::string* value) const {
+    const uint64_t prefix = BlobRecordPrefixSize(key.size());
+    if (index.file_number() != file_number_ ||
+        index.offset() < kBlobFileHeaderSize + prefix ||
+        index.offset() + index.size() > file_size_ - kBlobFileFooterSize) {
+        return Status::Corruption("blob index out of range", index.DebugString());
+    }
+
+    // 连同 record 头部和 key 一起读出来校验
+    const size_t n = static_cast<size_t>(prefix + index.size());
+    std::string buf;
+    buf.resize(n);
+    Slice record;
+    Status s = file_->Read(index.offset() - prefix, n, &record, &buf[0]);
+    if (!s.ok()) {
+        return s;
+    }
+    if (record.size() != n) {
+        return Status::Corruption("truncated blob read");
+    }
+    Slice v;
+    s = DecodeBlobRecord(record, key, &v);
+    if (s.ok()) {
+        value->assign(v.data(), v.size());
+    }
+    return s;
+}
+
+} // namespace tinydb
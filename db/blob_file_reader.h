@@ -0,0 +1,62 @@
+#ifndef STORAGE_TINYDB_DB_BLOB_FILE_READER_H_
+#define STORAGE_TINYDB_DB_BLOB_FILE_READER_H_
+
+#include <cstdint>
+#include <string>
+
+#include "tinydb/slice.h"
+#include "tinydb/status.h"
+
+namespace tinydb {
+
+class BlobIndex;
+class Env;
+class RandomAccessFile;
+
+/*
+ * 按 BlobIndex 读取 blob 文件中的 value
+ * 多个线程可以并发调用 GetBlob()，不需要外部同步
+ */
+class BlobFileReader {
+public:
+    /*
+     * 打开 dbname 下编号为 file_number 的 blob 文件，校验 header 和 footer
+     * 成功时 *reader 指向新的 reader，调用者不再使用时 delete 它
+     */
+    static Status Open(Env* env, const std::string& dbname, uint64_t file_number,
+                       BlobFileReader** reader);
+
+    BlobFileReader(const BlobFileReader&) = delete;
+    BlobFileReader& operator=(const BlobFileReader&) = delete;
+
+    ~BlobFileReader();
+
+    // 读取 user key 为 key 的 BlobIndex 指向的 value，校验 crc 和 key 后存到 *value
+    Status GetBlob(const Slice& key, const BlobIndex& index, std::string* value) const;
+
+    uint64_t file_number() const { return file_number_; }
+    // footer 中记录的 blob 个数和 value 总字节数
+    uint64_t blob_count() const { return blob_count_; }
+    uint64_t blob_bytes() const { return blob_bytes_; }
+
+private:
+    BlobFileReader(RandomAccessFile* file, uint64_t file_number,
+                   uint64_t file_size)
+        : file_(file),
+          file_number_(file_number),
+          file_size_(file_size),
+          blob_count_(0),
+          blob_bytes_(0) {}
+
+    Status ReadHeaderAndFooter();
+
+    RandomAccessFile* const file_;
+    const uint64_t file_number_;
+    const uint64_t file_size_;
+    uint64_t blob_count_;
+    uint64_t blob_bytes_;
+};
+
+} // namespace tinydb
+
+#endif  // STORAGE_TINYDB_DB_BLOB_FILE_READER_H_
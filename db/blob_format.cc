@@ -0,0 +1,65 @@
+#include "db/blob_format.h"
+
+#include "util/coding.h"
+#include "util/crc32c.h"
+
+namespace tinydb {
+
+void BlobIndex::EncodeTo(std::string* dst) const {
+    PutVarint64(dst, file_number_);
+    PutVarint64(dst, offset_);
+    PutVarint64(dst, size_);
+}
+
+Status BlobIndex::DecodeFrom(Slice input) {
+    if (GetVarint64(&input, &file_number_) && GetVarint64(&input, &offset_) &&
+        GetVarint64(&input, &size_) && input.empty() &&
+        file_number_ != kInvalidBlobFileNumber) {
+        return Status::OK();
+    }
+    return Status::Corruption("bad blob index");
+}
+
+std::string BlobIndex::DebugString() const {
+    std::string r = "[blob file ";
+    r.append(std::to_string(file_number_));
+    r.append(" offset ");
+    r.append(std::to_string(offset_));
+    r.append(" size ");
+    r.append(std::to_string(size_));
+    r.append("]");
+    return r;
+}
+
+void EncodeBlobRecordHeader(const Slice& key, const Slice& value, char* buf) {
+    EncodeFixed32(buf + 4, static_cast<uint32_t>(key.size()));
+    EncodeFixed64(buf + 8, value.size());
+    uint32_t crc = crc32c::Value(buf + 4, kBlobRecordHeaderSize - 4);
+    crc = crc32c::Extend(crc, key.data(), key.size());
+    crc = crc32c::Extend(crc, value.data(), value.size());
+    EncodeFixed32(buf, crc32c::Mask(crc));
+}
+
+Status DecodeBlobRecord(const Slice& record, const Slice& key, Slice* value) {
+    if (record.size() < kBlobRecordHeaderSize) {
+        return Status::Corruption("truncated blob record");
+    }
+    const char* p = record.data();
+    const uint32_t key_size = DecodeFixed32(p + 4);
+    const uint64_t value_size = DecodeFixed64(p + 8);
+    if (record.size() != kBlobRecordHeaderSize + key_size + value_size) {
+        return Status::Corruption("blob record size mismatch");
+    }
+    const uint32_t expected = crc32c::Unmask(DecodeFixed32(p));
+    const uint32_t actual = crc32c::Value(p + 4, record.size() - 4);
+    if (expected != actual) {
+        return Status::Corruption("blob record checksum mismatch");
+    }
+    if (Slice(p + kBlobRecordHeaderSize, key_size) != key) {
+        return Status::Corruption("blob record key mismatch");
+    }
+    *value = Slice(p + kBlobRecordHeaderSize + key_size, value_size);
+    return Status::OK();
+}
+
+} // namespace tinydb
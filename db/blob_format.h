@@ -0,0 +1,72 @@
+#ifndef STORAGE_TINYDB_DB_BLOB_FORMAT_H_
+#define STORAGE_TINYDB_DB_BLOB_FORMAT_H_
+
+/*
+ * 键值分离：大的 value 写到单独的只追加 blob 文件中，LSM 里只保存一个很小的 BlobIndex，
+ * internal key 的类型为 kTypeBlobIndex。compaction 只搬动 BlobIndex，不再反复改写大 value
+ *
+ * blob 文件格式：
+ *   header  : magic fixed64 | version fixed32
+ *   record* : masked crc32c fixed32 | key 长度 fixed32 | value 长度 fixed64 | key | value
+ *   footer  : blob 个数 fixed64 | value 总字节数 fixed64 | magic fixed64
+ * record 的 crc 覆盖两个长度字段、key 和 value
+ * BlobIndex 中的 offset 指向 value 的第一个字节，读取时向前多读出 record 头部和 key 做校验
+ */
+
+#include <cstdint>
+#include <string>
+
+#include "tinydb/slice.h"
+#include "tinydb/status.h"
+
+namespace tinydb {
+
+// blob 文件编号为 0 表示没有 blob 文件
+static const uint64_t kInvalidBlobFileNumber = 0;
+
+static const uint64_t kBlobFileMagic = 0x6c62643a626f6c62ull;
+static const uint32_t kBlobFileVersion = 1;
+
+static const size_t kBlobFileHeaderSize = 12;
+static const size_t kBlobRecordHeaderSize = 16;
+static const size_t kBlobFileFooterSize = 24;
+
+// 返回 user key 为 key_size 字节的 blob record 中 value 之前的字节数
+inline uint64_t BlobRecordPrefixSize(uint64_t key_size) {
+    return kBlobRecordHeaderSize + key_size;
+}
+
+// LSM 中代替大 value 保存的引用，指向某个 blob 文件中的一个 value
+class BlobIndex {
+public:
+    BlobIndex() : file_number_(kInvalidBlobFileNumber), offset_(0), size_(0) {}
+    BlobIndex(uint64_t file_number, uint64_t offset, uint64_t size)
+        : file_number_(file_number), offset_(offset), size_(size) {}
+
+    uint64_t file_number() const { return file_number_; }
+    uint64_t offset() const { return offset_; }
+    uint64_t size() const { return size_; }
+
+    void EncodeTo(std::string* dst) const;
+    Status DecodeFrom(Slice input);
+
+    std::string DebugString() const;
+
+private:
+    uint64_t file_number_;
+    uint64_t offset_;  // value 在 blob 文件中的偏移
+    uint64_t size_;    // value 的字节数
+};
+
+// 编码 blob record 的头部(不含 key 和 value)，crc 同时覆盖 key 和 value
+void EncodeBlobRecordHeader(const Slice& key, const Slice& value, char* buf);
+
+/*
+ * 校验 record = 头部 | key | value，成功时 *value 指向 record 中的 value
+ * key 必须与 record 中保存的 key 相同，防止 BlobIndex 指错位置时读到别的 key 的 value
+ */
+Status DecodeBlobRecord(const Slice& record, const Slice& key, Slice* value);
+
+} // namespace tinydb
+
+#endif  // STORAGE_TINYDB_DB_BLOB_FORMAT_H_
@@ -0,0 +1,114 @@
+#include "db/blob_gc.h"
+
+#include "db/blob_file_builder.h"
+#include "db/blob_file_reader.h"
+#include "db/blob_format.h"
+#include "db/dbformat.h"
+#include "db/version_edit.h"
+
+namespace tinydb {
+
+bool BlobGarbageMeter::Count(const Slice& internal_key, const Slice& value,
+                             bool input) {
+    ParsedInternalKey ikey;
+    if (!ParseInternalKey(internal_key, &ikey) || ikey.type != kTypeBlobIndex) {
+        return false;
+    }
+    BlobIndex index;
+    Status s = index.DecodeFrom(value);
+    if (!s.ok()) {
+        if (status_.ok()) {
+            status_ = s;
+        }
+        return false;
+    }
+    Flow* flow = &flows_[index.file_number()];
+    if (input) {
+        flow->in_count++;
+        flow->in_bytes += index.size();
+    } else {
+        flow->out_count++;
+        flow->out_bytes += index.size();
+    }
+    return true;
+}
+
+void BlobGarbageMeter::ProcessInput(const Slice& internal_key,
+                                    const Slice& value) {
+    Count(internal_key, value, true);
+}
+
+void BlobGarbageMeter::ProcessOutput(const Slice& internal_key,
+                                     const Slice& value) {
+    Count(internal_key, value, false);
+}
+
+void BlobGarbageMeter::AddToEdit(VersionEdit* edit) const {
+    for (std::map<uint64_t, Flow>::const_iterator it = flows_.begin();
+         it != flows_.end(); ++it) {
+        const Flow& flow = it->second;
+        // 输出中只会出现输入中已有的 blob，或者新 blob 文件中的 blob(只有输出)
+        if (flow.in_count > flow.out_count) {
+            edit->AddBlobFileGarbage(it->first, flow.in_count - flow.out_count,
+                                     flow.in_bytes - flow.out_bytes);
+        }
+    }
+}
+
+BlobRelocator::BlobRelocator(Env* env, const std::string& dbname,
+                             uint64_t cutoff_file_number,
+                             BlobFileBuilder* output)
+    : env_(env),
+      dbname_(dbname),
+      cutoff_file_number_(cutoff_file_number),
+      output_(output),
+      relocated_count_(0),
+      relocated_bytes_(0) {}
+
+BlobRelocator::~BlobRelocator() {
+    for (std::map<uint64_t, BlobFileReader*>::iterator it = readers_.begin();
+         it != readers_.end(); ++it) {
+        delete it->second;
+    }
+}
+
+Status BlobRelocator::GetReader(uint64_t file_number, BlobFileReader** reader) {
+    std::map<uint64_t, BlobFileReader*>::iterator it = readers_.find(file_number);
+    if (it != readers_.end()) {
+        *reader = it->second;
+        return Status::OK();
+    }
+    Status s = BlobFileReader::Open(env_, dbname_, file_number, reader);
+    if (s.ok()) {
+        readers_[file_number] = *reader;
+    }
+    return s;
+}
+
+Status BlobRelocator::MaybeRelocate(const Slice& key, const Slice& blob_index,
+                                    std::string* new_blob_index,
+                                    bool* relocated) {
+    *relocated = false;
+    BlobIndex index;
+    Status s = index.DecodeFrom(blob_index);
+    if (!s.ok() || index.file_number() >= cutoff_file_number_) {
+        return s;
+    }
+
+    BlobFileReader* reader;
+    s = GetReader(index.file_number(), &reader);
+    if (s.ok()) {
+        s = reader->GetBlob(key, index, &value_);
+    }
+    if (s.ok()) {
+        s = output_->Add(key, value_, new_blob_index);
+    }
+    if (s.ok()) {
+        *relocated = true;
+        relocated_count_++;
+        relocated_bytes_ += value_.size();
+    }
+    return s;
+}
+
+} // namespace tinydb
@@ -0,0 +1,108 @@
+#ifndef STORAGE_TINYDB_DB_BLOB_GC_H_
+#define STORAGE_TINYDB_DB_BLOB_GC_H_
+
+/*
+ * compaction 中处理 BlobIndex 的两个工具：
+ *   BlobGarbageMeter 统计每个 blob 文件在本次 compaction 中新增的 garbage
+ *   BlobRelocator    把最旧的 blob 文件中仍然存活的 blob 搬到新的 blob 文件
+ *
+ * 一个 blob 被覆盖或删除后，compaction 丢掉它的 BlobIndex，它就成了 garbage；
+ * 被搬走的 blob 在原文件中也是 garbage。blob 文件的 garbage 达到 total 后被删除，
+ * 旧文件的空间因此一定能被回收，不需要单独扫描 blob 文件
+ */
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include "tinydb/slice.h"
+#include "tinydb/status.h"
+
+namespace tinydb {
+
+class BlobFileBuilder;
+class BlobFileReader;
+class Env;
+class VersionEdit;
+
+class BlobGarbageMeter {
+public:
+    BlobGarbageMeter() = default;
+
+    BlobGarbageMeter(const BlobGarbageMeter&) = delete;
+    BlobGarbageMeter& operator=(const BlobGarbageMeter&) = delete;
+
+    // compaction 读到的每个输入条目都要调用
+    void ProcessInput(const Slice& internal_key, const Slice& value);
+
+    // 写到输出的每个条目都要调用，value 为最终写入的值(搬走之后是新的 BlobIndex)
+    void ProcessOutput(const Slice& internal_key, const Slice& value);
+
+    // 输入中引用了、输出中不再引用的 blob 即为新的 garbage，登记到 edit 中
+    void AddToEdit(VersionEdit* edit) const;
+
+    // 遇到无法解析的 BlobIndex 时返回非 OK
+    Status status() const { return status_; }
+
+private:
+    struct Flow {
+        Flow() : in_count(0), in_bytes(0), out_count(0), out_bytes(0) {}
+
+        uint64_t in_count;
+        uint64_t in_bytes;
+        uint64_t out_count;
+        uint64_t out_bytes;
+    };
+
+    // BlobIndex 类型的条目返回 true，并把 blob 计入 flow
+    bool Count(const Slice& internal_key, const Slice& value, bool input);
+
+    std::map<uint64_t, Flow> flows_;
+    Status status_;
+};
+
+class BlobRelocator {
+public:
+    /*
+     * 编号 < cutoff_file_number 的 blob 文件中的 blob 被搬到 output(见
+     * Version::BlobGCCutoffFileNumber())。output 由调用者创建，compaction 结束时
+     * 调用者负责 Finish() 并登记到 VersionEdit
+     */
+    BlobRelocator(Env* env, const std::string& dbname, uint64_t cutoff_file_number,
+                  BlobFileBuilder* output);
+
+    BlobRelocator(const BlobRelocator&) = delete;
+    BlobRelocator& operator=(const BlobRelocator&) = delete;
+
+    ~BlobRelocator();
+
+    /*
+     * blob_index 是 user key 为 key 的条目的 BlobIndex
+     * 它指向需要回收的 blob 文件时，读出 blob 写到 output，*new_blob_index 为新的 BlobIndex，
+     * *relocated 为 true；否则 *relocated 为 false，条目原样保留
+     */
+    Status MaybeRelocate(const Slice& key, const Slice& blob_index,
+                         std::string* new_blob_index, bool* relocated);
+
+    // 搬走的 blob 个数和字节数
+    uint64_t relocated_count() const { return relocated_count_; }
+    uint64_t relocated_bytes() const { return relocated_bytes_; }
+
+private:
+    Status GetReader(uint64_t file_number, BlobFileReader** reader);
+
+    Env* const env_;
+    const std::string dbname_;
+    const uint64_t cutoff_file_number_;
+    BlobFileBuilder* const output_;
+
+    // 打开过的旧 blob 文件，compaction 期间一直保持打开
+    std::map<uint64_t, BlobFileReader*> readers_;
+    std::string value_;
+    uint64_t relocated_count_;
+    uint64_t relocated_bytes_;
+};
+
+} // namespace tinydb
+
+#endif  // STORAGE_TINYDB_DB_BLOB_GC_H_
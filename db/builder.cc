@@ -0,0 +1,224 @@
+#include "db/builder.h"
+
+#include "db/blob_file_builder.h"
+#include "db/dbformat.h"
+#include "db/filename.h"
+#include "db/range_tombstone_fragmenter.h"
+#include "db/version_edit.h"
+#include "tinydb/env.h"
+#include "tinydb/iterator.h"
+#include "tinydb/table.h"
+#include "tinydb/table_builder.h"
+
+namespace tinydb {
+
+EnvOptions TableFileEnvOptions(const Options& options,
+                               RateLimiter::IOPriority pri) {
+    EnvOptions env_options;
+    env_options.use_direct_io = options.use_direct_io_for_flush_and_compaction;
+    env_options.bytes_per_sync = options.bytes_per_sync;
+    env_options.rate_limiter = options.rate_limiter;
+    env_options.rate_limiter_priority = pri;
+    return env_options;
+}
+
+Status NewTableWritableFile(Env* env, const std::string& fname,
+                            const Options& options, WritableFile** result,
+                            RateLimiter::IOPriority pri) {
+    EnvOptions env_options = TableFileEnvOptions(options, pri);
+    Status s = env->NewWritableFile(fname, env_options, result);
+    if (s.IsNotSupportedError() && env_options.use_direct_io) {
+        env_options.use_direct_io = false;
+        s = env->NewWritableFile(fname, env_options, result);
+    }
+    return s;
+}
+
+Status NewTableRandomAccessFile(Env* env, const std::string& fname,
+                                const Options& options,
+                                RandomAccessFile** result,
+                                RateLimiter::IOPriority pri) {
+    EnvOptions env_options = TableFileEnvOptions(options, pri);
+    Status s = env->NewRandomAccessFile(fname, env_options, result);
+    if (s.IsNotSupportedError() && env_options.use_direct_io) {
+        env_options.use_direct_io = false;
+        s = env->NewRandomAccessFile(fname, env_options, result);
+    }
+    return s;
+}
+
+static void DeleteTableAndFile(void* arg1, void* arg2) {
+    delete reinterpret_cast<Table*>(arg1);
+    delete reinterpret_cast<RandomAccessFile*>(arg2);
+}
+
+Iterator* NewTableFileIterator(const std::string& dbname, Env* env,
+                               const Options& options,
+                               const ReadOptions& read_options,
+                               uint64_t file_number, uint64_t file_size,
+                               std::vector<RangeTombstone>* range_tombstones) {
+    RandomAccessFile* file;
+    Status s = NewTableRandomAccessFile(env, TableFileName(dbname, file_number),
+                                        options, &file);
+    if (!s.ok()) {
+        return NewErrorIterator(s);
+    }
+    Table* table;
+    s = Table::Open(options, file, file_size, &table);
+    if (!s.ok()) {
+        delete file;
+        return NewErrorIterator(s);
+    }
+    if (range_tombstones != nullptr) {
+        Iterator* range_del_iter = table->NewRangeTombstoneIterator();
+        s = ReadRangeTombstones(range_del_iter, range_tombstones);
+        delete range_del_iter;
+        if (!s.ok()) {
+            delete table;
+            delete file;
+            return NewErrorIterator(s);
+        }
+    }
+    Iterator* iter = table->NewIterator(read_options);
+    iter->RegisterCleanup(&DeleteTableAndFile, table, file);
+    return iter;
+}
+
+Status BuildTable(const std::string& dbname, Env* env, const Options& options,
+                  Iterator* iter, FileMetaData* meta,
+                  BlobFileBuilder* blob_builder, Iterator* range_del_iter) {
+    Status s;
+    meta->file_size = 0;
+    meta->oldest_blob_file_number = kInvalidBlobFileNumber;
+    meta->file_creation_time = env->NowMicros() / 1000000;
+    iter->SeekToFirst();
+    bool has_range_dels = false;
+    if (range_del_iter != nullptr) {
+        range_del_iter->SeekToFirst();
+        has_range_dels = range_del_iter->Valid();
+    }
+
+    std::string fname = TableFileName(dbname, meta->number);
+    if (iter->Valid() || has_range_dels) {
+        WritableFile* file;
+        s = NewTableWritableFile(env, fname, options, &file,
+                                 RateLimiter::IO_HIGH);
+        if (!s.ok()) {
+            return s;
+        }
+
+        // flush 生成的文件放在第 0 层
+        TableBuilder* builder = new TableBuilder(options, file, 0, nullptr);
+        bool has_range = iter->Valid();
+        if (has_range) {
+            meta->smallest.DecodeFrom(iter->key());
+        }
+        Slice key;
+        std::string blob_key;
+        std::string blob_index;
+        ParsedInternalKey ikey;
+        for (; iter->Valid(); iter->Next()) {
+            key = iter->key();
+            meta->largest.DecodeFrom(key);
+            const Slice value = iter->value();
+            if (blob_builder != nullptr && value.size() >= options.min_blob_size &&
+                ParseInternalKey(key, &ikey) && ikey.type == kTypeValue) {
+                s = blob_builder->Add(ikey.user_key, value, &blob_index);
+                if (!s.ok()) {
+                    break;
+                }
+                // 同一个 user key 和序列号只有一条记录，改变类型不影响顺序
+                ikey.type = kTypeBlobIndex;
+                blob_key.clear();
+                AppendInternalKey(&blob_key, ikey);
+                builder->Add(blob_key, blob_index);
+                meta->oldest_blob_file_number = blob_builder->file_number();
+            } else {
+                builder->Add(key, value);
+            }
+        }
+
+        // range tombstone 按 internal key 有序，原样写入，读取时再切分
+        const Comparator* icmp = options.comparator;
+        for (; s.ok() && has_range_dels && range_del_iter->Valid();
+             range_del_iter->Next()) {
+            if (!ParseInternalKey(range_del_iter->key(), &ikey)) {
+                s = Status::Corruption("bad range tombstone");
+                break;
+            }
+            builder->AddRangeTombstone(range_del_iter->key(), range_del_iter->value());
+            const RangeTombstone t(ikey.user_key, range_del_iter->value(), ikey.sequence);
+            const InternalKey start = t.SerializeKey();
+            const InternalKey end = t.SerializeEndKey();
+            if (!has_range || icmp->Compare(start.Encode(), meta->smallest.Encode()) < 0) {
+                meta->smallest = start;
+            }
+            if (!has_range || icmp->Compare(end.Encode(), meta->largest.Encode()) > 0) {
+                meta->largest = end;
+            }
+            has_range = true;
+        }
+        if (s.ok() && has_range_dels) {
+            s = range_del_iter->status();
+        }
+
+        // Finish and check for builder errors
+        if (s.ok()) {
+            s = builder->Finish();
+        } else {
+            builder->Abandon();
+        }
+        if (s.ok()) {
+            meta->file_size = builder->FileSize();
+            assert(meta->file_size > 0);
+        }
+        delete builder;
+
+        // table 引用的 blob 必须先于 table 落盘
+        if (s.ok() && blob_builder != nullptr) {
+            s = blob_builder->Finish();
+        }
+
+        // Finish and check for file errors
+        if (s.ok()) {
+            s = file->Sync();
+        }
+        if (s.ok()) {
+            s = file->Close();
+        }
+        delete file;
+        file = nullptr;
+
+        if (s.ok()) {
+            // 确认生成的文件可以打开
+            RandomAccessFile* rfile;
+            s = NewTableRandomAccessFile(env, fname, options, &rfile,
+                                         RateLimiter::IO_HIGH);
+            if (s.ok()) {
+                Table* table;
+                s = Table::Open(options, rfile, meta->file_size, &table);
+                if (s.ok()) {
+                    delete table;
+                }
+                delete rfile;
+            }
+        }
+    }
+
+    // Check for input iterator errors
+    if (!iter->status().ok()) {
+        s = iter->status();
+    }
+
+    if (s.ok() && meta->file_size > 0) {
+        // Keep it
+    } else {
+        env->RemoveFile(fname);
+        if (blob_builder != nullptr) {
+            blob_builder->Abandon();
+        }
+    }
+    return s;
+}
+
+} // namespace tinydb
@@ -0,0 +1,67 @@
+#ifndef STORAGE_TINYDB_DB_BUILDER_H_
+#define STORAGE_TINYDB_DB_BUILDER_H_
+
+#include <string>
+#include <vector>
+
+#include "tinydb/env.h"
+#include "tinydb/status.h"
+
+namespace tinydb {
+
+struct FileMetaData;
+
+class BlobFileBuilder;
+class Iterator;
+struct Options;
+struct RangeTombstone;
+struct ReadOptions;
+
+// flush 和 compaction 读写 table 文件使用的 I/O 选项，pri 为向 rate_limiter 申请配额的优先级
+EnvOptions TableFileEnvOptions(
+        const Options& options,
+        RateLimiter::IOPriority pri = RateLimiter::IO_LOW);
+
+// 按 flush/compaction 的 I/O 选项创建 table 文件，直接 I/O 不被支持时退回到普通文件
+Status NewTableWritableFile(Env* env, const std::string& fname,
+                            const Options& options, WritableFile** result,
+                            RateLimiter::IOPriority pri = RateLimiter::IO_LOW);
+
+// 按 flush/compaction 的 I/O 选项打开 table 文件用于读取(例如 compaction 的输入)
+Status NewTableRandomAccessFile(Env* env, const std::string& fname,
+                                const Options& options,
+                                RandomAccessFile** result,
+                                RateLimiter::IOPriority pri = RateLimiter::IO_LOW);
+
+/*
+ * 返回遍历编号为 file_number 的 table 文件的迭代器，迭代器析构时关闭文件
+ * 用于 compaction 读取输入，打开失败时返回带错误状态的迭代器
+ * range_tombstones 非空时，把文件中的 range tombstone 追加到 *range_tombstones，
+ * 读取失败时同样返回带错误状态的迭代器
+ */
+Iterator* NewTableFileIterator(const std::string& dbname, Env* env,
+                               const Options& options,
+                               const ReadOptions& read_options,
+                               uint64_t file_number, uint64_t file_size,
+                               std::vector<RangeTombstone>* range_tombstones = nullptr);
+
+/*
+ * 把 *iter 的内容写成一个 table 文件，文件名由 meta->number 决定
+ * 成功时填写 *meta 的其余字段
+ * *iter 没有数据时不生成文件，meta->file_size 为 0
+ *
+ * blob_builder 非空时，不小于 options.min_blob_size 的 value 写到 blob 文件，table 中
+ * 保存 BlobIndex。成功时 blob 文件已经落盘，调用者随后用 blob_builder->AddToEdit()
+ * 登记它；失败时 blob 文件已被删除
+ *
+ * range_del_iter 非空时，其中的 range tombstone(见 MemTable::NewRangeTombstoneIterator)
+ * 也写入文件，文件的 key 范围包含它们覆盖的范围。只有 range tombstone 时也生成文件
+ */
+Status BuildTable(const std::string& dbname, Env* env, const Options& options,
+                  Iterator* iter, FileMetaData* meta,
+                  BlobFileBuilder* blob_builder = nullptr,
+                  Iterator* range_del_iter = nullptr);
+
+} // namespace tinydb
+
+#endif  // STORAGE_TINYDB_DB_BUILDER_H_
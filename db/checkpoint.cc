@@ -0,0 +1,71 @@
+#include "db/checkpoint.h"
+
+#include <vector>
+
+#include "db/column_family.h"
+#include "db/filename.h"
+#include "tinydb/env.h"
+
+namespace tinydb {
+
+Checkpoint::Checkpoint(ColumnFamilySet* db) : db_(db), env_(db->env()) {}
+
+Status Checkpoint::CreateCheckpoint(const std::string& checkpoint_dir) {
+    if (env_->FileExists(checkpoint_dir)) {
+        return Status::InvalidArgument(checkpoint_dir, "already exists");
+    }
+    const std::string tmp_dir = checkpoint_dir + ".tmp";
+    if (env_->FileExists(tmp_dir)) {
+        RemoveDirTree(env_, tmp_dir);  // 上一次失败留下的
+    }
+    Status s = env_->CreateDir(tmp_dir);
+    if (!s.ok()) {
+        return s;
+    }
+
+    db_->DisableFileDeletions();
+    std::vector<LiveFile> files;
+    s = db_->GetLiveFiles(true /*flush*/, &files);
+    for (size_t i = 0; s.ok() && i < files.size(); i++) {
+        const LiveFile& f = files[i];
+        const std::string::size_type slash = f.name.rfind('/');
+        if (slash != std::string::npos) {
+            const std::string subdir = tmp_dir + "/" + f.name.substr(0, slash);
+            if (!env_->FileExists(subdir)) {
+                s = env_->CreateDir(subdir);
+                if (!s.ok()) {
+                    break;
+                }
+            }
+        }
+
+        const std::string target = tmp_dir + "/" + f.name;
+        if (f.type == kTableFile || f.type == kBlobFile) {
+            const std::string src = db_->dbname() + "/" + f.name;
+            s = env_->LinkFile(src, target);
+            if (s.IsNotSupportedError()) {
+                s = CopyFile(env_, src, target);
+            }
+        } else {
+            s = WriteStringToFileSync(env_, f.contents, target);
+        }
+        // 每个 manifest 所在的目录需要一个指向它的 CURRENT
+        if (s.ok() && f.type == kDescriptorFile) {
+            const std::string dir = (slash == std::string::npos)
+                                            ? tmp_dir
+                                            : tmp_dir + "/" + f.name.substr(0, slash);
+            s = SetCurrentFile(env_, dir, f.number);
+        }
+    }
+    db_->EnableFileDeletions();
+
+    if (s.ok()) {
+        s = env_->RenameFile(tmp_dir, checkpoint_dir);
+    }
+    if (!s.ok()) {
+        RemoveDirTree(env_, tmp_dir);
+    }
+    return s;
+}
+
+} // namespace tinydb
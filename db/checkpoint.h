@@ -0,0 +1,40 @@
+#ifndef STORAGE_TINYDB_DB_CHECKPOINT_H_
+#define STORAGE_TINYDB_DB_CHECKPOINT_H_
+
+#include <string>
+
+#include "tinydb/status.h"
+
+namespace tinydb {
+
+class ColumnFamilySet;
+class Env;
+
+/*
+ * 在另一个目录中生成数据库的一个一致的快照(checkpoint)，可以用 ColumnFamilySet::Open() 直接打开
+ *
+ * 先把所有 memtable flush 到 L0，table 和 blob 文件写完之后不再修改，用硬链接与数据库共享，
+ * manifest 和剩下的很短的 WAL 尾部复制当前状态的前缀，所以耗时只与文件个数有关，与数据量无关
+ * checkpoint 目录与数据库不在同一个文件系统上时退回到复制文件
+ *
+ * 生成期间暂停删除数据库中不再需要的文件，写入可以继续
+ */
+class Checkpoint {
+public:
+    explicit Checkpoint(ColumnFamilySet* db);
+
+    Checkpoint(const Checkpoint&) = delete;
+    Checkpoint& operator=(const Checkpoint&) = delete;
+
+    // checkpoint_dir 不能已经存在。先写到一个临时目录，完成之后再重命名，
+    // 失败时不会留下不完整的 checkpoint
+    Status CreateCheckpoint(const std::string& checkpoint_dir);
+
+private:
+    ColumnFamilySet* const db_;
+    Env* const env_;
+};
+
+} // namespace tinydb
+
+#endif  // STORAGE_TINYDB_DB_CHECKPOINT_H_
@@ -0,0 +1,130 @@
+#include "db/checkpoint.h"
+
+#include <string>
+#include <vector>
+
+#include "db/column_family.h"
+#include "db/filename.h"
+#include "db/secondary_instance.h"
+#include "gtest/gtest.h"
+#include "tinydb/env.h"
+#include "tinydb/write_batch.h"
+#include "util/testutil.h"
+
+namespace tinydb {
+
+class CheckpointTest : public testing::Test {
+public:
+    CheckpointTest() : db_(nullptr) {
+        root_ = test::NewTestDirectory("checkpoint_test");
+        dbname_ = root_ + "/db";
+        options_.env = &env_;
+        options_.create_if_missing = true;
+    }
+
+    ~CheckpointTest() override { delete db_; }
+
+    Status Open(const std::vector<ColumnFamilyDescriptor>& families = {}) {
+        delete db_;
+        db_ = new ColumnFamilySet(dbname_, options_);
+        return db_->Open(families);
+    }
+
+    Status Put(uint32_t cf, const std::string& key, const std::string& value) {
+        WriteBatch batch;
+        batch.Put(cf, key, value);
+        return db_->Write(WriteOptions(), &batch);
+    }
+
+    // 用 secondary 实例读出 dir 中的数据库，不存在时为 "NOT_FOUND"
+    std::string Get(const std::string& dir, const std::string& cf, const std::string& key,
+                    const std::vector<ColumnFamilyDescriptor>& families = {}) {
+        SecondaryInstance secondary(dir, options_);
+        Status s = secondary.Open(families);
+        if (!s.ok()) {
+            return s.ToString();
+        }
+        std::string value;
+        s = secondary.Get(ReadOptions(), cf, key, &value);
+        if (s.IsNotFound()) {
+            return "NOT_FOUND";
+        }
+        return s.ok() ? value : s.ToString();
+    }
+
+    test::ErrorEnv env_;
+    std::string root_;
+    std::string dbname_;
+    Options options_;
+    ColumnFamilySet* db_;
+};
+
+TEST_F(CheckpointTest, CreateAndOpen) {
+    ASSERT_TRUE(Open().ok());
+    ColumnFamilyData* cf;
+    ASSERT_TRUE(db_->CreateColumnFamily(ColumnFamilyDescriptor("a", options_), &cf).ok());
+    const std::vector<ColumnFamilyDescriptor> families = {ColumnFamilyDescriptor("a", options_)};
+    ASSERT_TRUE(Put(0, "k1", "v1").ok());
+    ASSERT_TRUE(db_->Flush(db_->GetColumnFamily(0u)).ok());
+    // 还在 memtable 中的数据也包含在 checkpoint 中
+    ASSERT_TRUE(Put(0, "k2", "v2").ok());
+    ASSERT_TRUE(Put(cf->id(), "k3", "v3").ok());
+    const SequenceNumber last_sequence = db_->LastSequence();
+
+    const std::string checkpoint_dir = root_ + "/checkpoint";
+    Checkpoint checkpoint(db_);
+    ASSERT_TRUE(checkpoint.CreateCheckpoint(checkpoint_dir).ok());
+    ASSERT_TRUE(Put(0, "k1", "after").ok());
+    ASSERT_TRUE(Put(0, "k4", "after").ok());
+
+    EXPECT_EQ("v1", Get(checkpoint_dir, kDefaultColumnFamilyName, "k1", families));
+    EXPECT_EQ("v2", Get(checkpoint_dir, kDefaultColumnFamilyName, "k2", families));
+    EXPECT_EQ("v3", Get(checkpoint_dir, "a", "k3", families));
+    EXPECT_EQ("NOT_FOUND", Get(checkpoint_dir, kDefaultColumnFamilyName, "k4", families));
+    EXPECT_FALSE(env_.FileExists(checkpoint_dir + ".tmp"));
+
+    // checkpoint 可以作为独立的数据库打开和写入，不影响原来的数据库
+    ColumnFamilySet copy(checkpoint_dir, options_);
+    ASSERT_TRUE(copy.Open(families).ok());
+    EXPECT_EQ(last_sequence, copy.LastSequence());
+    WriteBatch batch;
+    batch.Put(0, "k5", "copy");
+    ASSERT_TRUE(copy.Write(WriteOptions(), &batch).ok());
+    ASSERT_TRUE(copy.Flush(copy.GetColumnFamily(0u)).ok());
+    EXPECT_EQ("NOT_FOUND", Get(dbname_, kDefaultColumnFamilyName, "k5", families));
+    EXPECT_EQ("after", Get(dbname_, kDefaultColumnFamilyName, "k1", families));
+}
+
+TEST_F(CheckpointTest, Errors) {
+    ASSERT_TRUE(Open().ok());
+    ASSERT_TRUE(Put(0, "k", "v").ok());
+    Checkpoint checkpoint(db_);
+
+    // 目录已经存在
+    const std::string existing = root_ + "/existing";
+    ASSERT_TRUE(env_.CreateDir(existing).ok());
+    EXPECT_TRUE(checkpoint.CreateCheckpoint(existing).IsInvalidArgument());
+
+    // 写 manifest 失败时不留下不完整的 checkpoint
+    const std::string checkpoint_dir = root_ + "/checkpoint";
+    env_.FailNewFiles(kDescriptorFile, true);
+    Status s = checkpoint.CreateCheckpoint(checkpoint_dir);
+    EXPECT_TRUE(s.IsIOError()) << s.ToString();
+    EXPECT_GT(env_.num_failures(), 0);
+    EXPECT_FALSE(env_.FileExists(checkpoint_dir));
+    EXPECT_FALSE(env_.FileExists(checkpoint_dir + ".tmp"));
+    env_.FailNewFiles(kDescriptorFile, false);
+
+    // 上一次失败留下的临时目录被清理
+    ASSERT_TRUE(env_.CreateDir(checkpoint_dir + ".tmp").ok());
+    ASSERT_TRUE(WriteStringToFile(&env_, "garbage", checkpoint_dir + ".tmp/000001.ldb").ok());
+    ASSERT_TRUE(checkpoint.CreateCheckpoint(checkpoint_dir).ok());
+    EXPECT_FALSE(env_.FileExists(checkpoint_dir + "/000001.ldb"));
+    EXPECT_EQ("v", Get(checkpoint_dir, kDefaultColumnFamilyName, "k"));
+
+    // 原来的数据库继续正常写入
+    ASSERT_TRUE(Put(0, "k", "v2").ok());
+    EXPECT_EQ("v2", Get(dbname_, kDefaultColumnFamilyName, "k"));
+}
+
+} // namespace tinydb
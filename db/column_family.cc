@@ -0,0 +1,1013 @@
+#include "db/column_family.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <set>
+
+#include "db/blob_file_builder.h"
+#include "db/builder.h"
+#include "db/compaction.h"
+#include "db/compaction_job.h"
+#include "db/filename.h"
+#include "db/log_reader.h"
+#include "db/log_writer.h"
+#include "db/memtable.h"
+#include "db/version_edit.h"
+#include "db/version_set.h"
+#include "db/write_batch_internal.h"
+#include "tinydb/env.h"
+#include "tinydb/iterator.h"
+#include "tinydb/write_batch.h"
+#include "tinydb/write_buffer_manager.h"
+#include "util/mutexlock.h"
+#include "util/statistics.h"
+
+namespace tinydb {
+
+const char kDefaultColumnFamilyName[] = "default";
+
+namespace {
+
+/*
+ * 按编号查找 column family 的 memtable
+ * log_number 不为 0 时用于恢复：日志编号大于 log_number 的 column family 已经 flush 过
+ * 这个 WAL 中的数据，跳过属于它的更新；已经删除的 column family 的更新也跳过
+ */
+class ColumnFamilyMemTablesImpl : public ColumnFamilyMemTables {
+public:
+    ColumnFamilyMemTablesImpl(const std::map<uint32_t, ColumnFamilyData*>* families,
+                              uint64_t log_number)
+        : families_(families), log_number_(log_number) {}
+
+    MemTable* GetMemTable(uint32_t column_family_id, bool* skip) override {
+        auto it = families_->find(column_family_id);
+        if (it == families_->end()) {
+            *skip = (log_number_ != 0);
+            return nullptr;
+        }
+        ColumnFamilyData* cfd = it->second;
+        if (log_number_ != 0 && log_number_ < cfd->versions()->LogNumber()) {
+            *skip = true;
+            return nullptr;
+        }
+        touched_.insert(column_family_id);
+        return cfd->mem();
+    }
+
+    // 实际写入过的 column family
+    const std::set<uint32_t>& touched() const { return touched_; }
+
+private:
+    const std::map<uint32_t, ColumnFamilyData*>* const families_;
+    const uint64_t log_number_;
+    std::set<uint32_t> touched_;
+};
+
+// 检查 batch 中的 column family 是否都存在，写 WAL 之前调用，避免只写入一部分
+class ColumnFamilyChecker : public WriteBatch::Handler {
+public:
+    explicit ColumnFamilyChecker(const std::map<uint32_t, ColumnFamilyData*>* families)
+        : families_(families) {}
+
+    Status Put(uint32_t id, const Slice&, const Slice&) override { return Check(id); }
+    Status Delete(uint32_t id, const Slice&) override { return Check(id); }
+    Status Merge(uint32_t id, const Slice&, const Slice&) override { return Check(id); }
+    Status DeleteRange(uint32_t id, const Slice&, const Slice&) override {
+        return Check(id);
+    }
+
+private:
+    Status Check(uint32_t id) const {
+        if (families_->count(id) == 0) {
+            return Status::InvalidArgument("column family not found");
+        }
+        return Status::OK();
+    }
+
+    const std::map<uint32_t, ColumnFamilyData*>* const families_;
+};
+
+// options 的 comparator 换成 icmp
+Options WithInternalComparator(const Options& options, const InternalKeyComparator* icmp) {
+    Options result = options;
+    result.comparator = icmp;
+    return result;
+}
+
+} // namespace
+
+ColumnFamilyData::ColumnFamilyData(uint32_t id, const std::string& name,
+                                   const std::string& dir, const Options& options)
+    : id_(id),
+      name_(name),
+      dir_(dir),
+      icmp_(options.comparator),
+      options_(WithInternalComparator(options, &icmp_)),
+      versions_(new VersionSet(dir, &options_, &icmp_)),
+      mem_(nullptr),
+      imm_(nullptr),
+      imm_log_number_(0),
+      compacting_(false),
+      dropped_(false),
+      refs_(1) {
+    NewMemTable();
+}
+
+ColumnFamilyData::~ColumnFamilyData() {
+    if (mem_ != nullptr) mem_->Unref();
+    if (imm_ != nullptr) imm_->Unref();
+    delete versions_;
+}
+
+void ColumnFamilyData::NewMemTable() {
+    mem_ = new MemTable(icmp_, options_);
+    mem_->Ref();
+}
+
+ColumnFamilySet::ColumnFamilySet(const std::string& dbname, const Options& db_options)
+    : env_(db_options.env),
+      dbname_(dbname),
+      db_options_(db_options),
+      last_sequence_(0),
+      logfile_number_(0),
+      logfile_(nullptr),
+      log_(nullptr),
+      file_deletions_disabled_(0) {}
+
+ColumnFamilySet::~ColumnFamilySet() {
+    MutexLock l(&mutex_);
+    delete log_;
+    delete logfile_;
+    for (auto& entry : column_families_) {
+        delete entry.second;
+    }
+    column_families_.clear();
+}
+
+Status ColumnFamilySet::NewDB(const std::string& dir, const Options& options,
+                              uint64_t log_number) {
+    VersionEdit new_db;
+    new_db.SetComparatorName(options.comparator->Name());
+    new_db.SetLogNumber(log_number);
+    new_db.SetNextFile(std::max<uint64_t>(log_number + 1, 2));
+    new_db.SetLastSequence(0);
+
+    const std::string manifest = DescriptorFileName(dir, 1);
+    WritableFile* file;
+    Status s = env_->NewWritableFile(manifest, &file);
+    if (!s.ok()) {
+        return s;
+    }
+    {
+        log::Writer log(file);
+        std::string record;
+        new_db.EncodeTo(&record);
+        s = log.AddRecord(record);
+        if (s.ok()) {
+            s = file->Sync();
+        }
+        if (s.ok()) {
+            s = file->Close();
+        }
+    }
+    delete file;
+    if (s.ok()) {
+        s = SetCurrentFile(env_, dir, 1);
+    } else {
+        env_->RemoveFile(manifest);
+    }
+    return s;
+}
+
+Status ColumnFamilySet::OpenColumnFamily(uint32_t id, const std::string& name,
+                                         const Options& options) {
+    const std::string dir = (id == 0) ? dbname_ : ColumnFamilyDirName(dbname_, id);
+    Options cf_options = options;
+    cf_options.write_buffer_manager = db_options_.write_buffer_manager;
+    cf_options.statistics = db_options_.statistics;
+    ColumnFamilyData* cfd = new ColumnFamilyData(id, name, dir, cf_options);
+    bool save_manifest = false;
+    Status s = cfd->versions_->Recover(&save_manifest);
+    if (!s.ok()) {
+        delete cfd;
+        return s;
+    }
+    column_families_[id] = cfd;
+    return s;
+}
+
+Status ColumnFamilySet::Open(const std::vector<ColumnFamilyDescriptor>& families) {
+    MutexLock ml(&manifest_mutex_);
+    MutexLock l(&mutex_);
+    if (!column_families_.empty()) {
+        return Status::InvalidArgument("column families are already open");
+    }
+
+    std::map<std::string, const ColumnFamilyDescriptor*> descs;
+    for (size_t i = 0; i < families.size(); i++) {
+        descs[families[i].name] = &families[i];
+    }
+    auto default_desc = descs.find(kDefaultColumnFamilyName);
+    const Options& default_options =
+            (default_desc != descs.end()) ? default_desc->second->options : db_options_;
+
+    env_->CreateDir(dbname_);
+    Status s;
+    if (!env_->FileExists(CurrentFileName(dbname_))) {
+        if (!db_options_.create_if_missing) {
+            return Status::InvalidArgument(dbname_, "does not exist (create_if_missing is false)");
+        }
+        s = NewDB(dbname_, default_options, 0);
+    } else if (db_options_.error_if_exists) {
+        return Status::InvalidArgument(dbname_, "exists (error_if_exists is true)");
+    }
+    if (s.ok()) {
+        s = OpenColumnFamily(0, kDefaultColumnFamilyName, default_options);
+    }
+
+    // 注册表中的每个 column family 都必须由调用者给出 Options，反之亦然
+    if (s.ok()) {
+        const std::map<uint32_t, std::string>& registered =
+                DefaultColumnFamily()->versions_->column_families();
+        size_t matched = (default_desc != descs.end()) ? 1 : 0;
+        for (auto it = registered.begin(); s.ok() && it != registered.end(); ++it) {
+            auto desc = descs.find(it->second);
+            if (desc == descs.end()) {
+                s = Status::InvalidArgument("column family not opened: ", it->second);
+                break;
+            }
+            matched++;
+            s = OpenColumnFamily(it->first, it->second, desc->second->options);
+        }
+        if (s.ok() && matched != descs.size()) {
+            s = Status::InvalidArgument("unknown column family in descriptors");
+        }
+    }
+
+    if (s.ok()) {
+        SequenceNumber max_sequence = 0;
+        for (auto& entry : column_families_) {
+            max_sequence = std::max(max_sequence, entry.second->versions_->LastSequence());
+        }
+        last_sequence_ = max_sequence;
+        s = RecoverLogFiles();
+    }
+    if (s.ok()) {
+        s = SwitchWAL();
+    }
+    // 恢复出的数据全部写入 L0，同时把每个 column family 的日志编号推进到新的 WAL
+    for (auto it = column_families_.begin(); s.ok() && it != column_families_.end(); ++it) {
+        s = WriteLevel0Table(it->second);
+    }
+    if (s.ok()) {
+        for (auto& entry : column_families_) {
+            DeleteObsoleteFiles(entry.second);
+        }
+    } else {
+        delete log_;
+        delete logfile_;
+        log_ = nullptr;
+        logfile_ = nullptr;
+        for (auto& entry : column_families_) {
+            delete entry.second;
+        }
+        column_families_.clear();
+    }
+    return s;
+}
+
+Status ColumnFamilySet::RecoverLogFiles() {
+    uint64_t min_log = DefaultColumnFamily()->versions_->LogNumber();
+    for (auto& entry : column_families_) {
+        min_log = std::min(min_log, entry.second->versions_->LogNumber());
+    }
+
+    std::vector<std::string> filenames;
+    Status s = env_->GetChildren(dbname_, &filenames);
+    if (!s.ok()) {
+        return s;
+    }
+    std::vector<uint64_t> logs;
+    uint64_t number;
+    FileType type;
+    for (size_t i = 0; i < filenames.size(); i++) {
+        if (ParseFileName(filenames[i], &number, &type) && type == kLogFile) {
+            DefaultColumnFamily()->versions_->MarkFileNumberUsed(number);
+            if (number >= min_log) {
+                logs.push_back(number);
+            }
+        }
+    }
+    std::sort(logs.begin(), logs.end());
+    for (size_t i = 0; s.ok() && i < logs.size(); i++) {
+        s = RecoverLogFile(logs[i]);
+    }
+    return s;
+}
+
+Status ColumnFamilySet::RecoverLogFile(uint64_t log_number) {
+    struct LogReporter : public log::Reader::Reporter {
+        Status* status;  // 为 nullptr 时忽略错误
+        void Corruption(size_t bytes, const Status& s) override {
+            if (this->status != nullptr && this->status->ok()) *this->status = s;
+        }
+    };
+
+    SequentialFile* file;
+    Status status = env_->NewSequentialFile(LogFileName(dbname_, log_number), &file);
+    if (!status.ok()) {
+        return status;
+    }
+
+    LogReporter reporter;
+    reporter.status = db_options_.paranoid_checks ? &status : nullptr;
+    log::Reader reader(file, &reporter, true /*checksum*/, 0 /*initial_offset*/,
+                       log_number);
+    std::string scratch;
+    Slice record;
+    WriteBatch batch;
+    ColumnFamilyMemTablesImpl memtables(&column_families_, log_number);
+    while (reader.ReadRecord(&record, &scratch) && status.ok()) {
+        if (record.size() < 12) {
+            reporter.Corruption(record.size(),
+                                Status::Corruption("log record too small"));
+            continue;
+        }
+        WriteBatchInternal::SetContents(&batch, record);
+        status = WriteBatchInternal::InsertInto(&batch, &memtables);
+        if (!status.ok()) {
+            break;
+        }
+        const SequenceNumber last_seq = WriteBatchInternal::Sequence(&batch) +
+                                        WriteBatchInternal::Count(&batch) - 1;
+        if (last_seq > last_sequence_) {
+            last_sequence_ = last_seq;
+        }
+    }
+    delete file;
+    return status;
+}
+
+Status ColumnFamilySet::SwitchWAL() {
+    VersionSet* versions = DefaultColumnFamily()->versions_;
+    const uint64_t new_log_number = versions->NewFileNumber();
+    uint64_t recycle_number = 0;
+    if (!recyclable_logs_.empty()) {
+        recycle_number = recyclable_logs_.front();
+        recyclable_logs_.erase(recyclable_logs_.begin());
+    }
+
+    EnvOptions env_options;
+    env_options.preallocation_block_size = db_options_.wal_preallocation_size;
+    WritableFile* file;
+    Status s = NewLogFile(env_, dbname_, new_log_number, recycle_number, env_options,
+                          &file);
+    if (!s.ok()) {
+        versions->ReuseFileNumber(new_log_number);
+        return s;
+    }
+
+    delete log_;
+    delete logfile_;
+    logfile_ = file;
+    logfile_number_ = new_log_number;
+    log_ = new log::Writer(file, new_log_number, db_options_.recycle_log_file_num > 0,
+                           db_options_.wal_compression,
+                           db_options_.zstd_compression_level);
+    return s;
+}
+
+Status ColumnFamilySet::WriteLevel0Table(ColumnFamilyData* cfd) {
+    // 上一次 flush 失败留下的 imm_ 先单独写出：mem_ 中的数据可能还在 imm_log_number_ 之后、
+    // 当前 WAL 之前的 WAL 中，不能把日志编号直接推进到当前 WAL
+    if (cfd->imm_ != nullptr) {
+        Status s = FlushImmutable(cfd);
+        if (!s.ok()) {
+            return s;
+        }
+    }
+    if (cfd->mem_->NumEntries() > 0) {
+        cfd->imm_ = cfd->mem_;
+        cfd->imm_log_number_ = logfile_number_;
+        cfd->NewMemTable();
+    }
+    return FlushImmutable(cfd);
+}
+
+Status ColumnFamilySet::FlushImmutable(ColumnFamilyData* cfd) {
+    VersionSet* versions = cfd->versions_;
+    VersionEdit edit;
+    Status s;
+    uint64_t log_number = logfile_number_;
+    if (cfd->imm_ != nullptr) {
+        MemTable* imm = cfd->imm_;
+        log_number = cfd->imm_log_number_;
+        FileMetaData meta;
+        meta.number = versions->NewFileNumber();
+        BlobFileBuilder* blob_builder = nullptr;
+        if (cfd->options_.enable_blob_files) {
+            blob_builder = new BlobFileBuilder(cfd->dir_, env_, cfd->options_,
+                                               versions->NewFileNumber());
+        }
+        {
+            mutex_.Unlock();
+            // imm 不再有写入，向量 memtable 在这里排序，排序期间不阻塞其他写入和 flush
+            imm->MarkReadOnly();
+            Iterator* iter = imm->NewIterator();
+            Iterator* range_del_iter = imm->NewRangeTombstoneIterator();
+            s = BuildTable(cfd->dir_, env_, cfd->options_, iter, &meta, blob_builder,
+                           range_del_iter);
+            delete iter;
+            delete range_del_iter;
+            mutex_.Lock();
+        }
+        if (s.ok()) {
+            if (meta.file_size > 0) {
+                edit.AddFile(0, meta.number, meta.file_size, meta.smallest, meta.largest,
+                             meta.oldest_blob_file_number, meta.file_creation_time);
+            }
+            uint64_t bytes_written = meta.file_size;
+            if (blob_builder != nullptr) {
+                blob_builder->AddToEdit(&edit);
+                bytes_written += blob_builder->file_size();
+            }
+            RecordTick(cfd->options_.statistics, FLUSH_WRITE_BYTES, bytes_written);
+        }
+        delete blob_builder;
+    }
+
+    if (s.ok()) {
+        versions->MarkFileNumberUsed(logfile_number_);
+        versions->SetLastSequence(std::max(versions->LastSequence(), last_sequence_));
+        edit.SetLogNumber(log_number);
+        s = versions->LogAndApply(&edit, &mutex_);
+    }
+    // 失败时保留 imm_，下一次 flush 重试
+    if (s.ok() && cfd->imm_ != nullptr) {
+        cfd->imm_->Unref();
+        cfd->imm_ = nullptr;
+    }
+    return s;
+}
+
+Status ColumnFamilySet::MaybeCompact(uint32_t id) {
+    ColumnFamilyData* cfd;
+    {
+        MutexLock l(&mutex_);
+        auto it = column_families_.find(id);
+        if (it == column_families_.end()) {
+            return Status::OK();
+        }
+        cfd = it->second;
+        cfd->refs_++;
+    }
+
+    Status s;
+    {
+        MutexLock cl(&cfd->compaction_mutex_);
+        {
+            MutexLock l(&mutex_);
+            VersionSet* versions = cfd->versions_;
+            cfd->compacting_ = true;
+            while (s.ok() && !cfd->dropped_ && versions->NeedsCompaction()) {
+                Compaction* c = versions->PickCompaction();
+                if (c == nullptr) {
+                    break;
+                }
+                CompactionJob job(cfd->dir_, cfd->options_, versions, &manifest_mutex_, &mutex_,
+                                  c, last_sequence_);
+                s = job.Run();
+            }
+        }
+        // 其他线程的 flush 在 manifest_mutex_ 下写出还不在版本中的 table，
+        // 要等它安装完成才能删除文件
+        MutexLock ml(&manifest_mutex_);
+        MutexLock l(&mutex_);
+        cfd->compacting_ = false;
+        if (!cfd->dropped_) {
+            DeleteObsoleteFiles(cfd);
+        }
+    }
+
+    MutexLock l(&mutex_);
+    UnrefColumnFamily(cfd);
+    return s;
+}
+
+void ColumnFamilySet::UnrefColumnFamily(ColumnFamilyData* cfd) {
+    assert(cfd->refs_ > 0);
+    if (--cfd->refs_ == 0) {
+        delete cfd;
+    }
+}
+
+Status ColumnFamilySet::FlushLocked(ColumnFamilyData* cfd) {
+    if (cfd->imm_ == nullptr && cfd->mem_->NumEntries() == 0) {
+        return Status::OK();
+    }
+    // 先切换 WAL，flush 之后这个 column family 不再需要旧的 WAL
+    Status s = SwitchWAL();
+    if (s.ok()) {
+        s = WriteLevel0Table(cfd);
+    }
+    if (s.ok()) {
+        DeleteObsoleteFiles(cfd);
+    }
+    return s;
+}
+
+Status ColumnFamilySet::Flush(ColumnFamilyData* cfd) {
+    const uint32_t id = cfd->id();
+    Status s;
+    {
+        MutexLock ml(&manifest_mutex_);
+        MutexLock l(&mutex_);
+        auto it = column_families_.find(id);
+        if (it == column_families_.end() || it->second != cfd) {
+            return Status::InvalidArgument("column family not found");
+        }
+        if (!bg_error_.ok()) {
+            return bg_error_;
+        }
+        s = FlushLocked(cfd);
+    }
+    if (s.ok()) {
+        s = MaybeCompact(id);
+    }
+    return s;
+}
+
+Status ColumnFamilySet::Write(const WriteOptions& options, WriteBatch* batch) {
+    WriteBufferManager* const write_buffer_manager = db_options_.write_buffer_manager;
+    Statistics* const statistics = db_options_.statistics;
+    std::vector<uint32_t> full;
+    bool over_budget = false;
+    {
+        MutexLock l(&mutex_);
+        if (log_ == nullptr) {
+            return Status::InvalidArgument("column families are not open");
+        }
+        if (!bg_error_.ok()) {
+            return bg_error_;
+        }
+        if (WriteBatchInternal::Count(batch) == 0) {
+            return Status::OK();
+        }
+        ColumnFamilyChecker checker(&column_families_);
+        Status s = batch->Iterate(&checker);
+        if (!s.ok()) {
+            return s;
+        }
+
+        WriteBatchInternal::SetSequence(batch, last_sequence_ + 1);
+        s = log_->AddRecord(WriteBatchInternal::Contents(batch));
+        if (s.ok()) {
+            RecordTick(statistics, WAL_FILE_BYTES, WriteBatchInternal::ByteSize(batch));
+        }
+        if (s.ok() && options.sync) {
+            s = logfile_->Sync();
+            RecordTick(statistics, WAL_FILE_SYNCED);
+        }
+        if (!s.ok()) {
+            bg_error_ = s;
+            return s;
+        }
+        ColumnFamilyMemTablesImpl memtables(&column_families_, 0);
+        s = WriteBatchInternal::InsertInto(batch, &memtables);
+        if (!s.ok()) {
+            // 记录已经在 WAL 中，序列号却没有推进
+            bg_error_ = s;
+            return s;
+        }
+        last_sequence_ += WriteBatchInternal::Count(batch);
+        RecordTick(statistics, NUMBER_KEYS_WRITTEN, WriteBatchInternal::Count(batch));
+        RecordTick(statistics, BYTES_WRITTEN, WriteBatchInternal::ByteSize(batch));
+
+        for (uint32_t id : memtables.touched()) {
+            ColumnFamilyData* cfd = column_families_[id];
+            if (cfd->mem_->ApproximateMemoryUsage() > cfd->options_.write_buffer_size) {
+                full.push_back(id);
+            }
+        }
+        // 与其他数据库共享的内存预算快用完了，flush 这个数据库中最大的 memtable
+        if (full.empty() && write_buffer_manager != nullptr &&
+            write_buffer_manager->ShouldFlush()) {
+            size_t max_usage = 0;
+            uint32_t largest = 0;
+            for (auto& entry : column_families_) {
+                const size_t usage = entry.second->mem_->ApproximateMemoryUsage();
+                if (entry.second->mem_->NumEntries() > 0 && usage > max_usage) {
+                    max_usage = usage;
+                    largest = entry.first;
+                }
+            }
+            if (max_usage > 0) {
+                full.push_back(largest);
+                over_budget = true;
+            }
+        }
+    }
+
+    // flush 需要先拿 manifest_mutex_，此时 column family 可能已经被删除，按编号重新查找
+    // 其他线程可能已经 flush 过，重新检查是否还需要
+    // 写入在 flush 和 compaction 完成之前不返回，这段时间记为 stall
+    Status s;
+    const uint64_t stall_start = full.empty() ? 0 : env_->NowMicros();
+    for (size_t i = 0; s.ok() && i < full.size(); i++) {
+        {
+            MutexLock ml(&manifest_mutex_);
+            MutexLock l(&mutex_);
+            auto it = column_families_.find(full[i]);
+            if (it != column_families_.end() &&
+                (it->second->mem_->ApproximateMemoryUsage() > it->second->options_.write_buffer_size ||
+                 (over_budget && write_buffer_manager->ShouldFlush()))) {
+                s = FlushLocked(it->second);
+            }
+        }
+        if (s.ok()) {
+            s = MaybeCompact(full[i]);
+        }
+    }
+    if (!full.empty()) {
+        RecordTick(statistics, STALL_MICROS, env_->NowMicros() - stall_start);
+    }
+    return s;
+}
+
+Status ColumnFamilySet::CreateColumnFamily(const ColumnFamilyDescriptor& desc,
+                                           ColumnFamilyData** result) {
+    *result = nullptr;
+    MutexLock ml(&manifest_mutex_);
+    MutexLock l(&mutex_);
+    if (column_families_.empty()) {
+        return Status::InvalidArgument("column families are not open");
+    }
+    for (auto& entry : column_families_) {
+        if (entry.second->name() == desc.name) {
+            return Status::InvalidArgument("column family already exists: ", desc.name);
+        }
+    }
+
+    ColumnFamilyData* default_cfd = DefaultColumnFamily();
+    const uint32_t id = default_cfd->versions_->MaxColumnFamily() + 1;
+    const std::string dir = ColumnFamilyDirName(dbname_, id);
+    env_->CreateDir(dir);
+    // 新的 column family 只需要重放当前 WAL 之后的数据
+    Status s = NewDB(dir, desc.options, logfile_number_);
+    if (s.ok()) {
+        VersionEdit edit;
+        edit.AddColumnFamily(id, desc.name);
+        edit.SetMaxColumnFamily(id);
+        s = default_cfd->versions_->LogAndApply(&edit, &mutex_);
+    }
+    if (s.ok()) {
+        s = OpenColumnFamily(id, desc.name, desc.options);
+        if (s.ok()) {
+            *result = column_families_[id];
+        }
+    } else {
+        RemoveDirTree(env_, dir);
+    }
+    return s;
+}
+
+Status ColumnFamilySet::DropColumnFamily(ColumnFamilyData* cfd) {
+    if (cfd->id() == 0) {
+        return Status::InvalidArgument("cannot drop the default column family");
+    }
+    {
+        MutexLock l(&mutex_);
+        auto it = column_families_.find(cfd->id());
+        if (it == column_families_.end() || it->second != cfd) {
+            return Status::InvalidArgument("column family not found");
+        }
+        cfd->refs_++;
+    }
+
+    // 等正在进行的 compaction 结束
+    Status s;
+    {
+        MutexLock cl(&cfd->compaction_mutex_);
+        MutexLock ml(&manifest_mutex_);
+        MutexLock l(&mutex_);
+        if (cfd->dropped_) {
+            s = Status::InvalidArgument("column family not found");
+        } else {
+            VersionEdit edit;
+            edit.DropColumnFamily(cfd->id());
+            s = DefaultColumnFamily()->versions_->LogAndApply(&edit, &mutex_);
+        }
+        if (s.ok()) {
+            column_families_.erase(cfd->id());
+            cfd->dropped_ = true;
+            cfd->refs_--;  // 注册表的引用
+            RemoveDirTree(env_, cfd->dir_);
+            // 它的数据不再需要保留，旧的 WAL 可能可以删除了
+            DeleteObsoleteFiles(DefaultColumnFamily());
+        }
+    }
+
+    MutexLock l(&mutex_);
+    UnrefColumnFamily(cfd);
+    return s;
+}
+
+ColumnFamilyData* ColumnFamilySet::GetColumnFamily(uint32_t id) const {
+    MutexLock l(&mutex_);
+    auto it = column_families_.find(id);
+    return (it == column_families_.end()) ? nullptr : it->second;
+}
+
+ColumnFamilyData* ColumnFamilySet::GetColumnFamily(const std::string& name) const {
+    MutexLock l(&mutex_);
+    for (auto& entry : column_families_) {
+        if (entry.second->name() == name) {
+            return entry.second;
+        }
+    }
+    return nullptr;
+}
+
+bool ColumnFamilySet::GetIntPropertyLocked(ColumnFamilyData* cfd, Slice property,
+                                           uint64_t* value) {
+    auto it = column_families_.find(cfd->id());
+    if (it == column_families_.end() || it->second != cfd) {
+        return false;
+    }
+    Slice prefix("tinydb.");
+    if (!property.starts_with(prefix)) {
+        return false;
+    }
+    property.remove_prefix(prefix.size());
+
+    VersionSet* versions = cfd->versions_;
+    if (property.starts_with("num-files-at-level")) {
+        property.remove_prefix(strlen("num-files-at-level"));
+        int level = 0;
+        for (size_t i = 0; i < property.size(); i++) {
+            if (property[i] < '0' || property[i] > '9' || level >= config::kNumLevels) {
+                return false;
+            }
+            level = level * 10 + (property[i] - '0');
+        }
+        if (property.empty() || level >= config::kNumLevels) {
+            return false;
+        }
+        *value = versions->NumLevelFiles(level);
+    } else if (property == "cur-size-active-mem-table") {
+        *value = cfd->mem_->ApproximateMemoryUsage();
+    } else if (property == "cur-size-all-mem-tables") {
+        *value = cfd->mem_->ApproximateMemoryUsage() +
+                 (cfd->imm_ != nullptr ? cfd->imm_->ApproximateMemoryUsage() : 0);
+    } else if (property == "num-entries-active-mem-table") {
+        *value = cfd->mem_->NumEntries();
+    } else if (property == "num-immutable-mem-table") {
+        *value = (cfd->imm_ != nullptr) ? 1 : 0;
+    } else if (property == "total-sst-files-size") {
+        *value = 0;
+        for (int level = 0; level < config::kNumLevels; level++) {
+            *value += versions->NumLevelBytes(level);
+        }
+    } else if (property == "estimate-pending-compaction-bytes") {
+        *value = versions->EstimatedPendingCompactionBytes();
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool ColumnFamilySet::GetIntProperty(ColumnFamilyData* cfd, const Slice& property,
+                                     uint64_t* value) {
+    MutexLock l(&mutex_);
+    return GetIntPropertyLocked(cfd, property, value);
+}
+
+bool ColumnFamilySet::GetProperty(ColumnFamilyData* cfd, const Slice& property,
+                                  std::string* value) {
+    value->clear();
+    MutexLock l(&mutex_);
+    uint64_t int_value;
+    if (GetIntPropertyLocked(cfd, property, &int_value)) {
+        *value = std::to_string(int_value);
+        return true;
+    }
+    auto it = column_families_.find(cfd->id());
+    if (it == column_families_.end() || it->second != cfd) {
+        return false;
+    }
+
+    if (property == "tinydb.levelstats") {
+        char buf[200];
+        std::snprintf(buf, sizeof(buf),
+                      "Level Files Size(MB)\n"
+                      "--------------------\n");
+        value->append(buf);
+        for (int level = 0; level < config::kNumLevels; level++) {
+            std::snprintf(buf, sizeof(buf), "%3d %8d %8.0f\n", level,
+                          cfd->versions_->NumLevelFiles(level),
+                          cfd->versions_->NumLevelBytes(level) / 1048576.0);
+            value->append(buf);
+        }
+        return true;
+    } else if (property == "tinydb.statistics") {
+        if (db_options_.statistics == nullptr) {
+            return false;
+        }
+        *value = db_options_.statistics->ToString();
+        return true;
+    }
+    return false;
+}
+
+SequenceNumber ColumnFamilySet::LastSequence() const {
+    MutexLock l(&mutex_);
+    return last_sequence_;
+}
+
+uint64_t ColumnFamilySet::LogNumber() const {
+    MutexLock l(&mutex_);
+    return logfile_number_;
+}
+
+Status ColumnFamilySet::GetLiveFiles(bool flush, std::vector<LiveFile>* files) {
+    files->clear();
+    // 持有 manifest_mutex_ 期间没有 flush、WAL 切换，compaction 也不能安装结果，
+    // manifest 和已经关闭的 WAL 都不会变化
+    MutexLock ml(&manifest_mutex_);
+    Status s;
+    uint64_t current_log = 0;
+    uint64_t current_log_size = 0;
+    {
+        MutexLock l(&mutex_);
+        if (log_ == nullptr) {
+            return Status::InvalidArgument("column families are not open");
+        }
+        // WAL 的尾部可能是不完整的记录
+        if (!bg_error_.ok()) {
+            return bg_error_;
+        }
+        if (flush) {
+            bool need_flush = false;
+            for (auto& entry : column_families_) {
+                ColumnFamilyData* cfd = entry.second;
+                if (cfd->imm_ != nullptr || cfd->mem_->NumEntries() > 0) {
+                    need_flush = true;
+                }
+            }
+            // 所有 column family 一起推进到新的 WAL，旧的 WAL 都不再需要
+            if (need_flush) {
+                s = SwitchWAL();
+                for (auto it = column_families_.begin();
+                     s.ok() && it != column_families_.end(); ++it) {
+                    s = WriteLevel0Table(it->second);
+                }
+                if (!s.ok()) {
+                    return s;
+                }
+            }
+        }
+
+        // 文件名都相对数据库目录
+        auto add_file = [&](const std::string& path, FileType type, uint64_t number) {
+            LiveFile lf;
+            lf.name = path.substr(dbname_.size() + 1);
+            lf.type = type;
+            lf.number = number;
+            files->push_back(lf);
+        };
+        uint64_t min_log = logfile_number_;
+        for (auto& entry : column_families_) {
+            ColumnFamilyData* cfd = entry.second;
+            VersionSet* versions = cfd->versions_;
+            min_log = std::min(min_log, versions->LogNumber());
+            Version* current = versions->current();
+            for (int level = 0; level < config::kNumLevels; level++) {
+                for (FileMetaData* f : current->files(level)) {
+                    add_file(TableFileName(cfd->dir_, f->number), kTableFile, f->number);
+                }
+            }
+            for (BlobFileMetaData* f : current->blob_files()) {
+                add_file(BlobFileName(cfd->dir_, f->number), kBlobFile, f->number);
+            }
+            add_file(DescriptorFileName(cfd->dir_, versions->ManifestFileNumber()),
+                     kDescriptorFile, versions->ManifestFileNumber());
+        }
+
+        // WAL 的写入可能还在用户态缓冲中
+        s = logfile_->Flush();
+        if (s.ok()) {
+            s = env_->GetFileSize(LogFileName(dbname_, logfile_number_), &current_log_size);
+        }
+        std::vector<std::string> filenames;
+        if (s.ok()) {
+            s = env_->GetChildren(dbname_, &filenames);
+        }
+        uint64_t number;
+        FileType type;
+        for (size_t i = 0; s.ok() && i < filenames.size(); i++) {
+            if (ParseFileName(filenames[i], &number, &type) && type == kLogFile &&
+                number >= min_log && number <= logfile_number_) {
+                add_file(LogFileName(dbname_, number), kLogFile, number);
+            }
+        }
+        current_log = logfile_number_;
+    }
+
+    // 读取 manifest 和 WAL 的内容时不需要 mutex_，写入可以继续追加到当前 WAL 的末尾
+    for (size_t i = 0; s.ok() && i < files->size(); i++) {
+        LiveFile& lf = (*files)[i];
+        if (lf.type != kDescriptorFile && lf.type != kLogFile) {
+            continue;
+        }
+        s = ReadFileToString(env_, dbname_ + "/" + lf.name, &lf.contents);
+        if (s.ok() && lf.type == kLogFile && lf.number == current_log &&
+            lf.contents.size() > current_log_size) {
+            lf.contents.resize(current_log_size);
+        }
+    }
+    return s;
+}
+
+void ColumnFamilySet::DisableFileDeletions() {
+    MutexLock l(&mutex_);
+    file_deletions_disabled_++;
+}
+
+void ColumnFamilySet::EnableFileDeletions() {
+    MutexLock ml(&manifest_mutex_);
+    MutexLock l(&mutex_);
+    assert(file_deletions_disabled_ > 0);
+    if (--file_deletions_disabled_ == 0) {
+        for (auto& entry : column_families_) {
+            DeleteObsoleteFiles(entry.second);
+        }
+    }
+}
+
+void ColumnFamilySet::DeleteObsoleteFiles(ColumnFamilyData* cfd) {
+    if (file_deletions_disabled_ > 0) {
+        return;
+    }
+    // 没有未 flush 数据的 column family 不再需要任何旧的 WAL
+    uint64_t min_log = logfile_number_;
+    for (auto& entry : column_families_) {
+        ColumnFamilyData* c = entry.second;
+        if (c->imm_ != nullptr || c->mem_->NumEntries() > 0) {
+            min_log = std::min(min_log, c->versions_->LogNumber());
+        }
+    }
+
+    std::set<uint64_t> live;
+    cfd->versions_->AddLiveFiles(&live);
+
+    std::vector<std::string> filenames;
+    uint64_t number;
+    FileType type;
+    env_->GetChildren(dbname_, &filenames);
+    for (size_t i = 0; i < filenames.size(); i++) {
+        if (!ParseFileName(filenames[i], &number, &type) || type != kLogFile ||
+            number >= min_log) {
+            continue;
+        }
+        if (std::find(recyclable_logs_.begin(), recyclable_logs_.end(), number) !=
+            recyclable_logs_.end()) {
+            continue;
+        }
+        if (recyclable_logs_.size() < db_options_.recycle_log_file_num) {
+            recyclable_logs_.push_back(number);
+        } else {
+            env_->RemoveFile(dbname_ + "/" + filenames[i]);
+        }
+    }
+
+    filenames.clear();
+    env_->GetChildren(cfd->dir_, &filenames);
+    for (size_t i = 0; i < filenames.size(); i++) {
+        if (!ParseFileName(filenames[i], &number, &type)) {
+            continue;
+        }
+        bool keep = true;
+        switch (type) {
+            case kTableFile:
+            case kBlobFile:
+                // compaction 正在写的文件还不在版本中
+                keep = cfd->compacting_ || (live.find(number) != live.end());
+                break;
+            case kDescriptorFile:
+                keep = (number >= cfd->versions_->ManifestFileNumber());
+                break;
+            case kTempFile:
+                keep = false;
+                break;
+            default:
+                break;
+        }
+        if (!keep) {
+            env_->RemoveFile(cfd->dir_ + "/" + filenames[i]);
+        }
+    }
+}
+
+} // namespace tinydb
@@ -0,0 +1,278 @@
+#ifndef STORAGE_TINYDB_DB_COLUMN_FAMILY_H_
+#define STORAGE_TINYDB_DB_COLUMN_FAMILY_H_
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "db/dbformat.h"
+#include "db/filename.h"
+#include "port/port.h"
+#include "port/thread_annotations.h"
+#include "tinydb/options.h"
+#include "tinydb/status.h"
+
+namespace tinydb {
+
+class MemTable;
+class VersionSet;
+class WritableFile;
+class WriteBatch;
+
+namespace log {
+class Writer;
+}
+
+// default column family 的名字，它的编号总是 0
+extern const char kDefaultColumnFamilyName[];
+
+// 打开或创建 column family 时使用的名字和 Options
+struct ColumnFamilyDescriptor {
+    ColumnFamilyDescriptor() : name(kDefaultColumnFamilyName) {}
+    ColumnFamilyDescriptor(const std::string& n, const Options& o)
+        : name(n), options(o) {}
+
+    std::string name;
+    Options options;
+};
+
+/*
+ * 一个 column family：有自己的 Options(压缩、block_size、compaction 方式等)、
+ * memtable 和 LSM 树。default 的 table 和 manifest 直接放在数据库目录下，
+ * 其他 column family 各自使用一个子目录(见 ColumnFamilyDirName())
+ *
+ * 由 ColumnFamilySet 创建和删除，mem()/imm()/versions() 不能与 ColumnFamilySet 的
+ * 写入、flush 和 compaction 并发访问
+ */
+class ColumnFamilyData {
+public:
+    ColumnFamilyData(const ColumnFamilyData&) = delete;
+    ColumnFamilyData& operator=(const ColumnFamilyData&) = delete;
+
+    uint32_t id() const { return id_; }
+    const std::string& name() const { return name_; }
+
+    // table 和 manifest 所在的目录
+    const std::string& dir() const { return dir_; }
+
+    // 创建时传入的 Options，comparator 换成了对应的 InternalKeyComparator
+    const Options& options() const { return options_; }
+
+    // 正在写入的 memtable
+    MemTable* mem() const { return mem_; }
+
+    // 正在 flush 的 memtable，没有时为 nullptr
+    MemTable* imm() const { return imm_; }
+
+    VersionSet* versions() const { return versions_; }
+
+private:
+    friend class ColumnFamilySet;
+
+    ColumnFamilyData(uint32_t id, const std::string& name, const std::string& dir,
+                     const Options& options);
+    ~ColumnFamilyData();
+
+    // 换一个新的空 memtable
+    void NewMemTable();
+
+    const uint32_t id_;
+    const std::string name_;
+    const std::string dir_;
+    const InternalKeyComparator icmp_;
+    Options options_;
+    VersionSet* const versions_;
+    MemTable* mem_;
+    MemTable* imm_;
+    // imm_ 切换出来时的 WAL 编号，imm_ 之后的写入都在这个编号及以后的 WAL 中
+    uint64_t imm_log_number_;
+
+    // 同一个 column family 同时只有一个线程做 compaction，加锁顺序：
+    // 先 compaction_mutex_，再 ColumnFamilySet 的 manifest_mutex_ 和 mutex_
+    port::Mutex compaction_mutex_;
+    // 下面的成员由 ColumnFamilySet 的 mutex_ 保护
+    // 正在做 compaction，输出文件还没有安装到版本中，不能当作不再需要的文件删除
+    bool compacting_;
+    // 已经被删除，只等最后一个引用释放
+    bool dropped_;
+    // 注册表持有一个引用，compaction 和删除期间各自再持有一个
+    int refs_;
+};
+
+// 数据库的一个存活文件，见 ColumnFamilySet::GetLiveFiles()
+struct LiveFile {
+    // 相对数据库目录的路径，例如 "000012.ldb"、"cf-000001/MANIFEST-000003"
+    std::string name;
+    FileType type;
+    uint64_t number;
+    // manifest 和 WAL 之后还会追加写，contents 是它们属于当前状态的前缀
+    // table 和 blob 文件写完之后不再修改，contents 为空，可以直接硬链接或复制
+    std::string contents;
+};
+
+/*
+ * 共用一个 WAL 的一组 column family
+ *
+ * 每个 WriteBatch 作为一条记录写入 WAL，其中的更新按 column family 编号分别写入各自的
+ * memtable，跨 column family 的更新是原子的，多个 column family 的写入也只需要一次 fsync
+ * 所有 column family 共用一个序列号空间
+ *
+ * 某个 column family 的 memtable 超过它的 write_buffer_size 时 flush：先切换到新的 WAL，
+ * 再把 memtable 写成 L0 的 table，在它自己的 manifest 中记下新 WAL 的编号(日志编号)，
+ * 之后按它的 compaction 方式做 compaction。旧 WAL 在所有还有数据没有 flush 的
+ * column family 的日志编号都超过它之后删除
+ *
+ * 恢复时每个 column family 只重放编号不小于自己日志编号的 WAL 中属于它的更新
+ * column family 的注册表保存在 default 的 manifest 中(见 VersionEdit::AddColumnFamily())
+ *
+ * 所有方法都是线程安全的
+ */
+class ColumnFamilySet {
+public:
+    // db_options 中 env、create_if_missing、error_if_exists、write_buffer_manager、statistics
+    // 和 WAL 相关的选项对整个数据库生效
+    ColumnFamilySet(const std::string& dbname, const Options& db_options);
+
+    ColumnFamilySet(const ColumnFamilySet&) = delete;
+    ColumnFamilySet& operator=(const ColumnFamilySet&) = delete;
+
+    ~ColumnFamilySet();
+
+    const std::string& dbname() const { return dbname_; }
+    Env* env() const { return env_; }
+
+    /*
+     * 打开数据库，families 必须包含所有已经存在的 column family，default 可以省略
+     * (此时使用 db_options)。恢复时重放 WAL，把恢复出的数据 flush 到 L0，再新建一个 WAL
+     */
+    Status Open(const std::vector<ColumnFamilyDescriptor>& families);
+
+    // 新建一个 column family，成功时把它存到 *result
+    Status CreateColumnFamily(const ColumnFamilyDescriptor& desc,
+                              ColumnFamilyData** result);
+
+    // 删除一个 column family 和它的所有数据，之后 cfd 不再有效。不能删除 default
+    Status DropColumnFamily(ColumnFamilyData* cfd);
+
+    // 不存在时返回 nullptr
+    ColumnFamilyData* GetColumnFamily(uint32_t id) const;
+    ColumnFamilyData* GetColumnFamily(const std::string& name) const;
+
+    // 原子地写入 batch，batch 中的 column family 必须都存在
+    // 写 WAL 失败后，之后的 Write()、Flush() 和 GetLiveFiles() 都返回同一个错误
+    Status Write(const WriteOptions& options, WriteBatch* batch);
+
+    // 把 cfd 的 memtable flush 到 L0，之后做需要的 compaction
+    Status Flush(ColumnFamilyData* cfd);
+
+    SequenceNumber LastSequence() const;
+
+    /*
+     * 返回 cfd 的一个属性，property 不存在或者 cfd 已经被删除时返回 false
+     *   "tinydb.num-files-at-level<N>"              第 N 层的文件数
+     *   "tinydb.levelstats"                         每层的文件数和总大小，多行文本
+     *   "tinydb.cur-size-active-mem-table"          正在写入的 memtable 占用的内存
+     *   "tinydb.cur-size-all-mem-tables"            所有 memtable(包括正在 flush 的)占用的内存
+     *   "tinydb.num-entries-active-mem-table"       正在写入的 memtable 中的条目数
+     *   "tinydb.num-immutable-mem-table"            正在 flush 的 memtable 的个数
+     *   "tinydb.total-sst-files-size"               当前版本所有 table 文件的总大小
+     *   "tinydb.estimate-pending-compaction-bytes"  估计还需要 compaction 读写的字节数
+     *   "tinydb.statistics"                         Options::statistics 中所有计数器的值，多行文本
+     * 除了多行文本，其他属性都可以用 GetIntProperty() 直接取得整数值
+     */
+    bool GetProperty(ColumnFamilyData* cfd, const Slice& property, std::string* value);
+    bool GetIntProperty(ColumnFamilyData* cfd, const Slice& property, uint64_t* value);
+
+    /*
+     * 返回恢复出当前状态需要的所有文件：各个 column family 当前版本的 table 和 blob 文件、
+     * manifest，以及还需要重放的 WAL。flush 为 true 时先把所有 memtable flush 到 L0，
+     * 需要的 WAL 只剩下一个很短的尾部
+     * 每个 manifest 所在的目录还需要一个指向它的 CURRENT 文件，由调用者生成
+     * 返回的 table 和 blob 文件只在 DisableFileDeletions() 期间保证存在
+     */
+    Status GetLiveFiles(bool flush, std::vector<LiveFile>* files);
+
+    // 暂停删除不再需要的文件，可以嵌套调用，每次调用都要对应一次 EnableFileDeletions()
+    void DisableFileDeletions();
+    void EnableFileDeletions();
+
+    // 当前 WAL 的编号
+    uint64_t LogNumber() const;
+
+private:
+    // 新建一个只有空的 manifest 的数据库目录，日志编号为 log_number
+    Status NewDB(const std::string& dir, const Options& options, uint64_t log_number);
+
+    // 打开一个已经注册的 column family 并恢复它的 LSM 树
+    Status OpenColumnFamily(uint32_t id, const std::string& name, const Options& options)
+            EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+    // 重放编号不小于 min_log 的所有 WAL
+    Status RecoverLogFiles() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+    Status RecoverLogFile(uint64_t log_number) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+    // 切换到一个新的 WAL
+    Status SwitchWAL() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+    // 把 cfd 的 memtable 写成 L0 的 table 并把它的日志编号推进到当前 WAL
+    // memtable 为空时只推进日志编号
+    Status WriteLevel0Table(ColumnFamilyData* cfd) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+    // 把 cfd->imm_ 写成 L0 的 table，日志编号推进到 imm_log_number_
+    // imm_ 为 nullptr 时只把日志编号推进到当前 WAL
+    Status FlushImmutable(ColumnFamilyData* cfd) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+    /*
+     * 做完编号为 id 的 column family 需要的所有 compaction，它已经被删除时什么都不做
+     * 不持有 manifest_mutex_，只在安装结果时短暂获取，其他 column family 的写入和
+     * flush 不需要等待 compaction 完成
+     */
+    Status MaybeCompact(uint32_t id) LOCKS_EXCLUDED(manifest_mutex_, mutex_);
+
+    // 切换 WAL 并 flush cfd 的 memtable，之后需要调用 MaybeCompact()
+    Status FlushLocked(ColumnFamilyData* cfd) EXCLUSIVE_LOCKS_REQUIRED(manifest_mutex_, mutex_);
+
+    // 释放 cfd 的一个引用，最后一个引用释放时删除它
+    void UnrefColumnFamily(ColumnFamilyData* cfd) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+    // cfd 已经被删除时返回 false
+    bool GetIntPropertyLocked(ColumnFamilyData* cfd, Slice property, uint64_t* value)
+            EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+    // 删除不再需要的 WAL，以及 cfd 目录中不再被引用的 table、blob 文件和旧的 manifest
+    // 持有 manifest_mutex_ 时没有正在写出、还不在版本中的 flush 结果
+    void DeleteObsoleteFiles(ColumnFamilyData* cfd)
+            EXCLUSIVE_LOCKS_REQUIRED(manifest_mutex_, mutex_);
+
+    ColumnFamilyData* DefaultColumnFamily() const { return column_families_.at(0); }
+
+    Env* const env_;
+    const std::string dbname_;
+    const Options db_options_;
+
+    // flush、compaction 和 column family 的增删会写 manifest，写 manifest 时会释放 mutex_，
+    // 这些操作之间用 manifest_mutex_ 串行化。compaction 读写数据期间不持有 manifest_mutex_，
+    // 只在安装结果时获取。加锁顺序：先 manifest_mutex_，再 mutex_
+    port::Mutex manifest_mutex_;
+    mutable port::Mutex mutex_;
+
+    std::map<uint32_t, ColumnFamilyData*> column_families_ GUARDED_BY(mutex_);
+    SequenceNumber last_sequence_ GUARDED_BY(mutex_);
+
+    // 当前 WAL，编号由 default 的 VersionSet 分配
+    uint64_t logfile_number_ GUARDED_BY(mutex_);
+    WritableFile* logfile_ GUARDED_BY(mutex_);
+    log::Writer* log_ GUARDED_BY(mutex_);
+    // 可以复用的旧 WAL(见 Options::recycle_log_file_num)
+    std::vector<uint64_t> recyclable_logs_ GUARDED_BY(mutex_);
+    // 大于 0 时不删除任何文件
+    int file_deletions_disabled_ GUARDED_BY(mutex_);
+    // 写 WAL 失败后 WAL 中可能留下不完整的记录，它的序列号也可能被下一个写入重复使用，
+    // 之后的写入和 flush 都返回这个错误，重新打开才能恢复
+    Status bg_error_ GUARDED_BY(mutex_);
+};
+
+} // namespace tinydb
+
+#endif  // STORAGE_TINYDB_DB_COLUMN_FAMILY_H_
@@ -0,0 +1,576 @@
+#include "db/column_family.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "db/filename.h"
+#include "db/secondary_instance.h"
+#include "db/write_batch_internal.h"
+#include "gtest/gtest.h"
+#include "tinydb/env.h"
+#include "tinydb/memtable_rep.h"
+#include "tinydb/statistics.h"
+#include "tinydb/write_batch.h"
+#include "util/testutil.h"
+
+namespace tinydb {
+
+class ColumnFamilyTest : public testing::Test {
+public:
+    ColumnFamilyTest() : env_(Env::Default()), db_(nullptr) {
+        dbname_ = test::NewTestDirectory("column_family_test");
+        options_.env = &env_;
+        options_.create_if_missing = true;
+    }
+
+    ~ColumnFamilyTest() override { delete db_; }
+
+    Status Open(const std::vector<ColumnFamilyDescriptor>& families = {}) {
+        delete db_;
+        db_ = new ColumnFamilySet(dbname_, options_);
+        return db_->Open(families);
+    }
+
+    // 不 flush 直接关闭，memtable 中的数据只在 WAL 中
+    void Close() {
+        delete db_;
+        db_ = nullptr;
+    }
+
+    Status Put(uint32_t cf, const std::string& key, const std::string& value) {
+        WriteBatch batch;
+        batch.Put(cf, key, value);
+        return db_->Write(WriteOptions(), &batch);
+    }
+
+    // 用 secondary 实例读出 families 中每个 column family 的 key，不存在时为 "NOT_FOUND"
+    std::string Get(const std::string& cf, const std::string& key,
+                    const std::vector<ColumnFamilyDescriptor>& families = {}) {
+        SecondaryInstance secondary(dbname_, options_);
+        Status s = secondary.Open(families);
+        if (!s.ok()) {
+            return s.ToString();
+        }
+        std::string value;
+        s = secondary.Get(ReadOptions(), cf, key, &value);
+        if (s.IsNotFound()) {
+            return "NOT_FOUND";
+        }
+        return s.ok() ? value : s.ToString();
+    }
+
+    // 数据库目录中 type 类型的文件个数
+    int CountFiles(FileType type) {
+        std::vector<std::string> filenames;
+        EXPECT_TRUE(env_.GetChildren(dbname_, &filenames).ok());
+        int count = 0;
+        uint64_t number;
+        FileType t;
+        for (const std::string& f : filenames) {
+            if (ParseFileName(f, &number, &t) && t == type) {
+                count++;
+            }
+        }
+        return count;
+    }
+
+    test::ErrorEnv env_;
+    std::string dbname_;
+    Options options_;
+    ColumnFamilySet* db_;
+};
+
+TEST_F(ColumnFamilyTest, AtomicWriteAcrossColumnFamilies) {
+    ASSERT_TRUE(Open().ok());
+    ColumnFamilyData* cf;
+    ASSERT_TRUE(db_->CreateColumnFamily(ColumnFamilyDescriptor("a", options_), &cf).ok());
+    ASSERT_EQ(db_->GetColumnFamily("a"), cf);
+
+    WriteBatch batch;
+    batch.Put(0, "k", "v0");
+    batch.Put(cf->id(), "k", "va");
+    ASSERT_TRUE(db_->Write(WriteOptions(), &batch).ok());
+    // 只写一个 WAL 记录，序列号连续
+    EXPECT_EQ(2u, db_->LastSequence());
+
+    const std::vector<ColumnFamilyDescriptor> families = {ColumnFamilyDescriptor("a", options_)};
+    Close();
+    ASSERT_TRUE(Open(families).ok());
+    EXPECT_EQ("v0", Get(kDefaultColumnFamilyName, "k", families));
+    EXPECT_EQ("va", Get("a", "k", families));
+    EXPECT_EQ(2u, db_->LastSequence());
+}
+
+TEST_F(ColumnFamilyTest, UnknownColumnFamily) {
+    ASSERT_TRUE(Open().ok());
+    ColumnFamilyData* cf;
+    ASSERT_TRUE(db_->CreateColumnFamily(ColumnFamilyDescriptor("a", options_), &cf).ok());
+    EXPECT_TRUE(db_->CreateColumnFamily(ColumnFamilyDescriptor("a", options_), &cf)
+                        .IsInvalidArgument());
+    EXPECT_EQ(nullptr, cf);
+
+    // 整个 batch 都不写入
+    WriteBatch batch;
+    batch.Put(0, "k", "v");
+    batch.Put(100, "k", "v");
+    EXPECT_TRUE(db_->Write(WriteOptions(), &batch).IsInvalidArgument());
+    EXPECT_EQ(0u, db_->LastSequence());
+
+    // 打开时必须给出所有已经存在的 column family
+    Close();
+    EXPECT_TRUE(Open().IsInvalidArgument());
+    EXPECT_TRUE(Open({ColumnFamilyDescriptor("a", options_), ColumnFamilyDescriptor("b", options_)})
+                        .IsInvalidArgument());
+    ASSERT_TRUE(Open({ColumnFamilyDescriptor("a", options_)}).ok());
+    EXPECT_EQ("NOT_FOUND", Get(kDefaultColumnFamilyName, "k"));
+}
+
+TEST_F(ColumnFamilyTest, DropColumnFamily) {
+    ASSERT_TRUE(Open().ok());
+    ColumnFamilyData* cf;
+    ASSERT_TRUE(db_->CreateColumnFamily(ColumnFamilyDescriptor("a", options_), &cf).ok());
+    const uint32_t id = cf->id();
+    const std::string dir = cf->dir();
+    ASSERT_TRUE(Put(id, "k", "v").ok());
+    ASSERT_TRUE(db_->Flush(cf).ok());
+    ASSERT_TRUE(env_.FileExists(dir));
+
+    EXPECT_TRUE(db_->DropColumnFamily(db_->GetColumnFamily(0u)).IsInvalidArgument());
+    ASSERT_TRUE(db_->DropColumnFamily(cf).ok());
+    EXPECT_EQ(nullptr, db_->GetColumnFamily("a"));
+    EXPECT_FALSE(env_.FileExists(dir));
+    EXPECT_TRUE(Put(id, "k", "v").IsInvalidArgument());
+
+    // 删除之后重新打开不再需要它，同名的新 column family 使用新的编号
+    Close();
+    ASSERT_TRUE(Open().ok());
+    ASSERT_TRUE(db_->CreateColumnFamily(ColumnFamilyDescriptor("a", options_), &cf).ok());
+    EXPECT_NE(id, cf->id());
+    Close();
+    EXPECT_EQ("NOT_FOUND", Get("a", "k", {ColumnFamilyDescriptor("a", options_)}));
+}
+
+TEST_F(ColumnFamilyTest, FailedFlushKeepsLaterWrites) {
+    ASSERT_TRUE(Open().ok());
+    ColumnFamilyData* cfd = db_->GetColumnFamily(0u);
+    ASSERT_TRUE(Put(0, "k1", "v1").ok());
+
+    env_.FailNewFiles(kTableFile, true);
+    EXPECT_TRUE(db_->Flush(cfd).IsIOError());
+    EXPECT_GT(env_.num_failures(), 0);
+    uint64_t num_imm;
+    ASSERT_TRUE(db_->GetIntProperty(cfd, "tinydb.num-immutable-mem-table", &num_imm));
+    EXPECT_EQ(1u, num_imm);
+
+    // 这条写入在失败的 flush 切换出的 WAL 中，只在新的 memtable 里
+    ASSERT_TRUE(Put(0, "k2", "v2").ok());
+    env_.FailNewFiles(kTableFile, false);
+    ASSERT_TRUE(db_->Flush(cfd).ok());
+    ASSERT_TRUE(db_->GetIntProperty(cfd, "tinydb.num-immutable-mem-table", &num_imm));
+    EXPECT_EQ(0u, num_imm);
+    ASSERT_TRUE(Put(0, "k3", "v3").ok());
+
+    Close();
+    ASSERT_TRUE(Open().ok());
+    EXPECT_EQ("v1", Get(kDefaultColumnFamilyName, "k1"));
+    EXPECT_EQ("v2", Get(kDefaultColumnFamilyName, "k2"));
+    EXPECT_EQ("v3", Get(kDefaultColumnFamilyName, "k3"));
+}
+
+TEST_F(ColumnFamilyTest, WalWriteErrorIsSticky) {
+    // 压缩的 WAL 中失败的记录已经进入了压缩流的状态，之后的记录都不能再写
+    if (test::ZstdSupported()) {
+        options_.wal_compression = kZstdCompression;
+    }
+    ASSERT_TRUE(Open().ok());
+    ColumnFamilyData* cfd = db_->GetColumnFamily(0u);
+    ASSERT_TRUE(Put(0, "k1", "v1").ok());
+
+    env_.FailWrites(kLogFile, true);
+    Status s = Put(0, "k2", "v2");
+    EXPECT_TRUE(s.IsIOError()) << s.ToString();
+    env_.FailWrites(kLogFile, false);
+    EXPECT_GT(env_.num_failures(), 0);
+
+    // 文件恢复正常之后仍然拒绝写入，直到重新打开
+    EXPECT_EQ(s.ToString(), Put(0, "k3", "v3").ToString());
+    EXPECT_EQ(s.ToString(), db_->Flush(cfd).ToString());
+    std::vector<LiveFile> files;
+    EXPECT_EQ(s.ToString(), db_->GetLiveFiles(true, &files).ToString());
+    EXPECT_EQ(1u, db_->LastSequence());
+
+    Close();
+    ASSERT_TRUE(Open().ok());
+    EXPECT_EQ(1u, db_->LastSequence());
+    ASSERT_TRUE(Put(0, "k4", "v4").ok());
+    EXPECT_EQ(2u, db_->LastSequence());
+    EXPECT_EQ("v1", Get(kDefaultColumnFamilyName, "k1"));
+    EXPECT_EQ("NOT_FOUND", Get(kDefaultColumnFamilyName, "k2"));
+    EXPECT_EQ("NOT_FOUND", Get(kDefaultColumnFamilyName, "k3"));
+    EXPECT_EQ("v4", Get(kDefaultColumnFamilyName, "k4"));
+}
+
+TEST_F(ColumnFamilyTest, ConcurrentWritesWithCompaction) {
+    options_.write_buffer_size = 64 * 1024;
+    ASSERT_TRUE(Open().ok());
+    ColumnFamilyData* cf;
+    ASSERT_TRUE(db_->CreateColumnFamily(ColumnFamilyDescriptor("a", options_), &cf).ok());
+
+    // 两个 column family 各自 flush 和 compaction，互不等待
+    const int kNum = 20000;
+    auto writer = [&](uint32_t id, Status* result) {
+        char key[32];
+        std::string value(100, static_cast<char>('a' + id));
+        for (int i = 0; i < kNum && result->ok(); i++) {
+            std::snprintf(key, sizeof(key), "%08d", i);
+            *result = Put(id, key, value);
+        }
+    };
+    Status s0, s1;
+    std::thread t0(writer, 0u, &s0);
+    std::thread t1(writer, cf->id(), &s1);
+    t0.join();
+    t1.join();
+    ASSERT_TRUE(s0.ok()) << s0.ToString();
+    ASSERT_TRUE(s1.ok()) << s1.ToString();
+    EXPECT_EQ(2u * kNum, db_->LastSequence());
+
+    uint64_t sst_size;
+    ASSERT_TRUE(db_->GetIntProperty(cf, "tinydb.total-sst-files-size", &sst_size));
+    EXPECT_GT(sst_size, 0u);
+    uint64_t l0_files;
+    ASSERT_TRUE(db_->GetIntProperty(cf, "tinydb.num-files-at-level0", &l0_files));
+    EXPECT_LT(l0_files, static_cast<uint64_t>(config::kL0_CompactionTrigger));
+
+    const char cf_value = static_cast<char>('a' + cf->id());
+    const std::vector<ColumnFamilyDescriptor> families = {ColumnFamilyDescriptor("a", options_)};
+    Close();
+    ASSERT_TRUE(Open(families).ok());
+    SecondaryInstance secondary(dbname_, options_);
+    ASSERT_TRUE(secondary.Open(families).ok());
+    char key[32];
+    std::string value;
+    for (int i = 0; i < kNum; i += 97) {
+        std::snprintf(key, sizeof(key), "%08d", i);
+        ASSERT_TRUE(secondary.Get(ReadOptions(), kDefaultColumnFamilyName, key, &value).ok());
+        EXPECT_EQ(std::string(100, 'a'), value);
+        ASSERT_TRUE(secondary.Get(ReadOptions(), "a", key, &value).ok());
+        EXPECT_EQ(std::string(100, cf_value), value);
+    }
+}
+
+TEST_F(ColumnFamilyTest, ConcurrentWritesSameColumnFamily) {
+    options_.write_buffer_size = 16 * 1024;
+    ASSERT_TRUE(Open().ok());
+
+    // 一个线程 compaction 结束时另一个线程可能正在 flush，它写出的 table 不能被删除
+    const int kNum = 10000;
+    auto writer = [&](int thread, Status* result) {
+        char key[32];
+        std::string value(100, static_cast<char>('a' + thread));
+        for (int i = 0; i < kNum && result->ok(); i++) {
+            std::snprintf(key, sizeof(key), "%d.%08d", thread, i);
+            *result = Put(0, key, value);
+        }
+    };
+    Status s0, s1;
+    std::thread t0(writer, 0, &s0);
+    std::thread t1(writer, 1, &s1);
+    t0.join();
+    t1.join();
+    ASSERT_TRUE(s0.ok()) << s0.ToString();
+    ASSERT_TRUE(s1.ok()) << s1.ToString();
+    EXPECT_EQ(2u * kNum, db_->LastSequence());
+
+    Close();
+    ASSERT_TRUE(Open().ok());
+    SecondaryInstance secondary(dbname_, options_);
+    ASSERT_TRUE(secondary.Open({}).ok());
+    char key[32];
+    std::string value;
+    for (int thread = 0; thread < 2; thread++) {
+        for (int i = 0; i < kNum; i += 37) {
+            std::snprintf(key, sizeof(key), "%d.%08d", thread, i);
+            Status s = secondary.Get(ReadOptions(), key, &value);
+            ASSERT_TRUE(s.ok()) << key << " " << s.ToString();
+            EXPECT_EQ(std::string(100, static_cast<char>('a' + thread)), value);
+        }
+    }
+}
+TEST_F(ColumnFamilyTest, RangeDeletionAcrossFlushes) {
+    ASSERT_TRUE(Open().ok());
+    ColumnFamilyData* cfd = db_->GetColumnFamily(0u);
+    char key[32];
+    for (int i = 0; i < 100; i++) {
+        std::snprintf(key, sizeof(key), "%04d", i);
+        ASSERT_TRUE(Put(0, key, "v").ok());
+    }
+    ASSERT_TRUE(db_->Flush(cfd).ok());
+
+    // tombstone 写到新的 L0 文件中，覆盖更旧的文件中的数据
+    WriteBatch batch;
+    batch.DeleteRange("0010", "0020");
+    ASSERT_TRUE(db_->Write(WriteOptions(), &batch).ok());
+    ASSERT_TRUE(Put(0, "0015", "new").ok());
+    EXPECT_EQ("NOT_FOUND", Get(kDefaultColumnFamilyName, "0012"));
+    ASSERT_TRUE(db_->Flush(cfd).ok());
+
+    Close();
+    ASSERT_TRUE(Open().ok());
+    EXPECT_EQ("v", Get(kDefaultColumnFamilyName, "0009"));
+    EXPECT_EQ("NOT_FOUND", Get(kDefaultColumnFamilyName, "0010"));
+    EXPECT_EQ("NOT_FOUND", Get(kDefaultColumnFamilyName, "0019"));
+    EXPECT_EQ("new", Get(kDefaultColumnFamilyName, "0015"));
+    EXPECT_EQ("v", Get(kDefaultColumnFamilyName, "0020"));
+}
+
+TEST_F(ColumnFamilyTest, VectorMemTableFlush) {
+    std::unique_ptr<MemTableRepFactory> factory(NewVectorRepFactory(2));
+    Options cf_options = options_;
+    cf_options.memtable_factory = factory.get();
+    ASSERT_TRUE(Open().ok());
+    ColumnFamilyData* cf;
+    ASSERT_TRUE(db_->CreateColumnFamily(ColumnFamilyDescriptor("bulk", cf_options), &cf).ok());
+
+    // 倒序写入，flush 时排序之后写成 table
+    char key[32];
+    for (int i = 999; i >= 0; i--) {
+        std::snprintf(key, sizeof(key), "%04d", i);
+        ASSERT_TRUE(Put(cf->id(), key, std::string(key) + "v").ok());
+    }
+    ASSERT_TRUE(db_->Flush(cf).ok());
+    uint64_t l0_files;
+    ASSERT_TRUE(db_->GetIntProperty(cf, "tinydb.num-files-at-level0", &l0_files));
+    EXPECT_EQ(1u, l0_files);
+
+    const std::vector<ColumnFamilyDescriptor> families = {
+            ColumnFamilyDescriptor("bulk", cf_options)};
+    EXPECT_EQ("0000v", Get("bulk", "0000", families));
+    EXPECT_EQ("0999v", Get("bulk", "0999", families));
+    EXPECT_EQ("NOT_FOUND", Get("bulk", "1000", families));
+}
+
+TEST_F(ColumnFamilyTest, RecycleWalFiles) {
+    options_.recycle_log_file_num = 1;
+    options_.wal_preallocation_size = 64 * 1024;
+    ASSERT_TRUE(Open().ok());
+    ColumnFamilyData* cfd = db_->GetColumnFamily(0u);
+    char key[32];
+    // 每轮先写很多再 flush，下一轮复用的 WAL 中留着更长的旧数据
+    for (int round = 0; round < 5; round++) {
+        for (int i = 0; i < 200; i++) {
+            std::snprintf(key, sizeof(key), "%04d", i);
+            ASSERT_TRUE(Put(0, key, std::string(1000, static_cast<char>('a' + round))).ok());
+        }
+        ASSERT_TRUE(db_->Flush(cfd).ok());
+    }
+    ASSERT_TRUE(Put(0, "0000", "last").ok());
+
+    // 当前的 WAL 加上最多一个保留复用的
+    std::vector<std::string> filenames;
+    ASSERT_TRUE(env_.GetChildren(dbname_, &filenames).ok());
+    int logs = 0;
+    uint64_t number, current_log = 0;
+    FileType type;
+    for (const std::string& f : filenames) {
+        if (ParseFileName(f, &number, &type) && type == kLogFile) {
+            logs++;
+            current_log = std::max(current_log, number);
+        }
+    }
+    EXPECT_LE(logs, 2);
+    // 当前的 WAL 是复用的，文件中还有上一次使用时写入的数据
+    uint64_t size;
+    ASSERT_TRUE(env_.GetFileSize(LogFileName(dbname_, current_log), &size).ok());
+    EXPECT_GT(size, 100u * 1000);
+
+    // 恢复时读到旧数据就停下，不报告损坏
+    Close();
+    options_.paranoid_checks = true;
+    ASSERT_TRUE(Open().ok());
+    EXPECT_EQ("last", Get(kDefaultColumnFamilyName, "0000"));
+    EXPECT_EQ(std::string(1000, 'e'), Get(kDefaultColumnFamilyName, "0001"));
+    EXPECT_EQ(1001u, db_->LastSequence());
+}
+
+TEST_F(ColumnFamilyTest, BlobGarbageCollection) {
+    options_.enable_blob_files = true;
+    options_.min_blob_size = 100;
+    char key[32];
+    // 每次 flush 覆盖上一次的一半 key，L0 的文件数达到触发值时 compaction
+    auto write_rounds = [&]() {
+        ColumnFamilyData* cfd = db_->GetColumnFamily(0u);
+        for (int round = 0; round < config::kL0_CompactionTrigger; round++) {
+            for (int i = round * 50; i < round * 50 + 100; i++) {
+                std::snprintf(key, sizeof(key), "%04d", i);
+                ASSERT_TRUE(Put(0, key, std::string(200, static_cast<char>('a' + round))).ok());
+            }
+            ASSERT_TRUE(db_->Flush(cfd).ok());
+        }
+        uint64_t l0_files;
+        ASSERT_TRUE(db_->GetIntProperty(cfd, "tinydb.num-files-at-level0", &l0_files));
+        ASSERT_EQ(0u, l0_files);
+    };
+
+    // 不开启 GC 时，旧 blob 文件中仍然存活的 blob 留在原处
+    ASSERT_TRUE(Open().ok());
+    write_rounds();
+    EXPECT_EQ(config::kL0_CompactionTrigger, CountFiles(kBlobFile));
+
+    // 所有 blob 文件都在 age cutoff 之内时，compaction 把存活的 blob 全部搬到新文件，
+    // 旧文件变成 garbage 后被删除
+    Close();
+    dbname_ = test::NewTestDirectory("column_family_test");
+    options_.enable_blob_garbage_collection = true;
+    options_.blob_garbage_collection_age_cutoff = 1.0;
+    ASSERT_TRUE(Open().ok());
+    write_rounds();
+    EXPECT_EQ(1, CountFiles(kBlobFile));
+    for (int i = 0; i < 250; i += 7) {
+        std::snprintf(key, sizeof(key), "%04d", i);
+        const int round = std::min(i / 50, config::kL0_CompactionTrigger - 1);
+        EXPECT_EQ(std::string(200, static_cast<char>('a' + round)),
+                  Get(kDefaultColumnFamilyName, key)) << i;
+    }
+    std::snprintf(key, sizeof(key), "%04d", 250);
+    EXPECT_EQ("NOT_FOUND", Get(kDefaultColumnFamilyName, key));
+}
+
+TEST_F(ColumnFamilyTest, UniversalCompaction) {
+    options_.compaction_style = kCompactionStyleUniversal;
+    ASSERT_TRUE(Open().ok());
+    ColumnFamilyData* cfd = db_->GetColumnFamily(0u);
+    char key[32];
+    // 每次 flush 覆盖一部分 key，sorted run 的个数一直保持在触发值以下
+    for (int round = 0; round < 20; round++) {
+        for (int i = round * 10; i < round * 10 + 100; i++) {
+            std::snprintf(key, sizeof(key), "%04d", i);
+            ASSERT_TRUE(Put(0, key, std::to_string(round)).ok());
+        }
+        ASSERT_TRUE(db_->Flush(cfd).ok());
+        uint64_t l0_files;
+        ASSERT_TRUE(db_->GetIntProperty(cfd, "tinydb.num-files-at-level0", &l0_files));
+        ASSERT_LT(l0_files, static_cast<uint64_t>(config::kL0_CompactionTrigger));
+        uint64_t pending;
+        ASSERT_TRUE(db_->GetIntProperty(cfd, "tinydb.estimate-pending-compaction-bytes",
+                                        &pending));
+        ASSERT_EQ(0u, pending);
+    }
+
+    Close();
+    ASSERT_TRUE(Open().ok());
+    for (int i = 0; i < 290; i += 3) {
+        std::snprintf(key, sizeof(key), "%04d", i);
+        EXPECT_EQ(std::to_string(std::min(i / 10, 19)), Get(kDefaultColumnFamilyName, key)) << i;
+    }
+    EXPECT_EQ("NOT_FOUND", Get(kDefaultColumnFamilyName, "0290"));
+}
+
+TEST_F(ColumnFamilyTest, FIFOCompaction) {
+    options_.compaction_style = kCompactionStyleFIFO;
+    options_.compaction_options_fifo.max_table_files_size = 60 * 1024;
+    ASSERT_TRUE(Open().ok());
+    ColumnFamilyData* cfd = db_->GetColumnFamily(0u);
+    char key[32];
+    // 每次 flush 写一批新的 key，文件都留在 L0，超过上限时删除最旧的文件
+    for (int round = 0; round < 10; round++) {
+        for (int i = 0; i < 20; i++) {
+            std::snprintf(key, sizeof(key), "%02d%02d", round, i);
+            ASSERT_TRUE(Put(0, key, std::string(1000, 'v')).ok());
+        }
+        ASSERT_TRUE(db_->Flush(cfd).ok());
+        uint64_t size;
+        ASSERT_TRUE(db_->GetIntProperty(cfd, "tinydb.total-sst-files-size", &size));
+        ASSERT_LE(size, options_.compaction_options_fifo.max_table_files_size);
+    }
+    uint64_t l0_files;
+    ASSERT_TRUE(db_->GetIntProperty(cfd, "tinydb.num-files-at-level0", &l0_files));
+    EXPECT_GT(l0_files, 1u);
+    EXPECT_EQ(static_cast<uint64_t>(CountFiles(kTableFile)), l0_files);
+    EXPECT_EQ("NOT_FOUND", Get(kDefaultColumnFamilyName, "0000"));
+    EXPECT_EQ(std::string(1000, 'v'), Get(kDefaultColumnFamilyName, "0919"));
+}
+
+TEST_F(ColumnFamilyTest, PropertiesAndStatistics) {
+    std::unique_ptr<Statistics> statistics(NewStatistics());
+    options_.statistics = statistics.get();
+    ASSERT_TRUE(Open().ok());
+    ColumnFamilyData* cfd = db_->GetColumnFamily(0u);
+    ColumnFamilyData* cf;
+    ASSERT_TRUE(db_->CreateColumnFamily(ColumnFamilyDescriptor("a", options_), &cf).ok());
+
+    WriteBatch batch;
+    batch.Put(0, "k1", "v1");
+    batch.Put(0, "k2", "value2");
+    const uint64_t batch_size = WriteBatchInternal::ByteSize(&batch);
+    ASSERT_TRUE(db_->Write(WriteOptions(), &batch).ok());
+    WriteOptions sync;
+    sync.sync = true;
+    WriteBatch synced;
+    synced.Put(cf->id(), "k3", "v3");
+    ASSERT_TRUE(db_->Write(sync, &synced).ok());
+    EXPECT_EQ(3u, statistics->GetTickerCount(NUMBER_KEYS_WRITTEN));
+    EXPECT_EQ(batch_size + WriteBatchInternal::ByteSize(&synced),
+              statistics->GetTickerCount(BYTES_WRITTEN));
+    EXPECT_EQ(statistics->GetTickerCount(BYTES_WRITTEN),
+              statistics->GetTickerCount(WAL_FILE_BYTES));
+    EXPECT_EQ(1u, statistics->GetTickerCount(WAL_FILE_SYNCED));
+
+    uint64_t value;
+    ASSERT_TRUE(db_->GetIntProperty(cfd, "tinydb.num-entries-active-mem-table", &value));
+    EXPECT_EQ(2u, value);
+    ASSERT_TRUE(db_->GetIntProperty(cf, "tinydb.num-entries-active-mem-table", &value));
+    EXPECT_EQ(1u, value);
+    ASSERT_TRUE(db_->GetIntProperty(cfd, "tinydb.cur-size-active-mem-table", &value));
+    EXPECT_GT(value, 0u);
+    ASSERT_TRUE(db_->GetIntProperty(cfd, "tinydb.num-immutable-mem-table", &value));
+    EXPECT_EQ(0u, value);
+    ASSERT_TRUE(db_->GetIntProperty(cfd, "tinydb.num-files-at-level0", &value));
+    EXPECT_EQ(0u, value);
+
+    // flush 之后数据在 L0
+    ASSERT_TRUE(db_->Flush(cfd).ok());
+    EXPECT_GT(statistics->GetTickerCount(FLUSH_WRITE_BYTES), 0u);
+    ASSERT_TRUE(db_->GetIntProperty(cfd, "tinydb.num-files-at-level0", &value));
+    EXPECT_EQ(1u, value);
+    ASSERT_TRUE(db_->GetIntProperty(cfd, "tinydb.num-entries-active-mem-table", &value));
+    EXPECT_EQ(0u, value);
+    ASSERT_TRUE(db_->GetIntProperty(cfd, "tinydb.total-sst-files-size", &value));
+    EXPECT_EQ(statistics->GetTickerCount(FLUSH_WRITE_BYTES), value);
+    std::string str;
+    ASSERT_TRUE(db_->GetProperty(cfd, "tinydb.num-files-at-level0", &str));
+    EXPECT_EQ("1", str);
+    ASSERT_TRUE(db_->GetProperty(cfd, "tinydb.levelstats", &str));
+    EXPECT_NE(std::string::npos, str.find("  0        1        0\n")) << str;
+
+    // secondary 的读取计入同一个 statistics
+    const std::vector<ColumnFamilyDescriptor> families = {ColumnFamilyDescriptor("a", options_)};
+    EXPECT_EQ("value2", Get(kDefaultColumnFamilyName, "k2", families));
+    EXPECT_EQ("v3", Get("a", "k3", families));
+    EXPECT_EQ("NOT_FOUND", Get("a", "missing", families));
+    EXPECT_EQ(1u, statistics->GetTickerCount(MEMTABLE_HIT));
+    EXPECT_EQ(2u, statistics->GetTickerCount(MEMTABLE_MISS));
+    EXPECT_EQ(2u, statistics->GetTickerCount(NUMBER_KEYS_READ));
+    EXPECT_EQ(8u, statistics->GetTickerCount(BYTES_READ));
+    ASSERT_TRUE(db_->GetProperty(cfd, "tinydb.statistics", &str));
+    EXPECT_NE(std::string::npos, str.find("tinydb.number.keys.read COUNT : 2\n")) << str;
+
+    // 不认识的属性
+    EXPECT_FALSE(db_->GetIntProperty(cfd, "tinydb.num-files-at-level7", &value));
+    EXPECT_FALSE(db_->GetIntProperty(cfd, "tinydb.num-files-at-level", &value));
+    EXPECT_FALSE(db_->GetIntProperty(cfd, "tinydb.num-files-at-level0x", &value));
+    EXPECT_FALSE(db_->GetIntProperty(cfd, "tinydb.levelstats", &value));
+    EXPECT_FALSE(db_->GetIntProperty(cfd, "num-files-at-level0", &value));
+    EXPECT_FALSE(db_->GetProperty(cfd, "tinydb.unknown", &str));
+    EXPECT_TRUE(str.empty());
+
+    // 没有设置 statistics
+    options_.statistics = nullptr;
+    ASSERT_TRUE(Open(families).ok());
+    EXPECT_FALSE(db_->GetProperty(db_->GetColumnFamily(0u), "tinydb.statistics", &str));
+}
+
+} // namespace tinydb
@@ -0,0 +1,156 @@
+#include "db/compaction.h"
+
+#include "db/version_set.h"
+#include "tinydb/options.h"
+
+namespace tinydb {
+
+const char* CompactionReasonName(CompactionReason reason) {
+    switch (reason) {
+        case kCompactionReasonLevelL0FilesNum:
+            return "LevelL0FilesNum";
+        case kCompactionReasonLevelMaxLevelSize:
+            return "LevelMaxLevelSize";
+        case kCompactionReasonUniversalSizeAmplification:
+            return "UniversalSizeAmplification";
+        case kCompactionReasonUniversalSizeRatio:
+            return "UniversalSizeRatio";
+        case kCompactionReasonUniversalSortedRunNum:
+            return "UniversalSortedRunNum";
+        case kCompactionReasonFIFOMaxSize:
+            return "FIFOMaxSize";
+        case kCompactionReasonFIFOTtl:
+            return "FIFOTtl";
+    }
+    return "Unknown";
+}
+
+Compaction::Compaction(const Options* options, const InternalKeyComparator* icmp,
+                       Version* input_version, int output_level,
+                       CompactionReason reason)
+    : icmp_(icmp),
+      output_level_(output_level),
+      reason_(reason),
+      max_output_file_size_(options->max_file_size),
+      // 输出文件与 grandparent 层重叠太多时，下次 compaction 这个文件的代价太大
+      max_grandparent_overlap_bytes_(10 * static_cast<int64_t>(options->max_file_size)),
+      input_version_(input_version),
+      grandparent_index_(0),
+      seen_key_(false),
+      overlapped_bytes_(0) {
+    input_version_->Ref();
+    for (int i = 0; i < config::kNumLevels; i++) {
+        level_ptrs_[i] = 0;
+    }
+}
+
+Compaction::~Compaction() {
+    if (input_version_ != nullptr) {
+        input_version_->Unref();
+    }
+}
+
+void Compaction::AddInputFiles(int level, const std::vector<FileMetaData*>& files) {
+    assert(inputs_.empty() || inputs_.back().level < level);
+    assert(level <= output_level_);
+    CompactionInputFiles input;
+    input.level = level;
+    input.files = files;
+    inputs_.push_back(input);
+}
+
+void Compaction::SetGrandparents(const std::vector<FileMetaData*>& grandparents) {
+    grandparents_ = grandparents;
+}
+
+uint64_t Compaction::TotalInputBytes() const {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < inputs_.size(); i++) {
+        sum += TotalFileSize(inputs_[i].files);
+    }
+    return sum;
+}
+
+bool Compaction::IsDeletionCompaction() const {
+    return reason_ == kCompactionReasonFIFOMaxSize ||
+           reason_ == kCompactionReasonFIFOTtl;
+}
+
+bool Compaction::IsTrivialMove() const {
+    int num_files = 0;
+    for (size_t i = 0; i < inputs_.size(); i++) {
+        num_files += num_input_files(i);
+    }
+    // 与 grandparent 重叠太多时不能直接移动，否则之后合并这个文件的代价很大
+    return num_files == 1 && inputs_[0].level != output_level_ &&
+           inputs_[0].files.size() == 1 &&
+           TotalFileSize(grandparents_) <= max_grandparent_overlap_bytes_;
+}
+
+void Compaction::AddInputDeletions(VersionEdit* edit) {
+    for (size_t which = 0; which < inputs_.size(); which++) {
+        for (size_t i = 0; i < inputs_[which].files.size(); i++) {
+            edit->RemoveFile(inputs_[which].level, inputs_[which].files[i]->number);
+        }
+    }
+}
+
+bool Compaction::IsBaseLevelForKey(const Slice& user_key) {
+    // Maybe use binary search to find right entry instead of linear search?
+    const Comparator* user_cmp = icmp_->user_comparator();
+    for (int lvl = output_level_ + 1; lvl < config::kNumLevels; lvl++) {
+        const std::vector<FileMetaData*>& files = input_version_->files(lvl);
+        while (level_ptrs_[lvl] < files.size()) {
+            FileMetaData* f = files[level_ptrs_[lvl]];
+            if (user_cmp->Compare(user_key, f->largest.user_key()) <= 0) {
+                // We've advanced far enough
+                if (user_cmp->Compare(user_key, f->smallest.user_key()) >= 0) {
+                    // Key falls in this file's range, so definitely not base level
+                    return false;
+                }
+                break;
+            }
+            level_ptrs_[lvl]++;
+        }
+    }
+    return true;
+}
+
+bool Compaction::IsBaseLevelForRange(const Slice& begin, const Slice& end) const {
+    for (int lvl = output_level_ + 1; lvl < config::kNumLevels; lvl++) {
+        if (input_version_->OverlapInLevel(lvl, &begin, &end)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Compaction::ShouldStopBefore(const Slice& internal_key) {
+    // Scan to find earliest grandparent file that contains key.
+    while (grandparent_index_ < grandparents_.size() &&
+           icmp_->Compare(internal_key,
+                          grandparents_[grandparent_index_]->largest.Encode()) > 0) {
+        if (seen_key_) {
+            overlapped_bytes_ += grandparents_[grandparent_index_]->file_size;
+        }
+        grandparent_index_++;
+    }
+    seen_key_ = true;
+
+    if (overlapped_bytes_ > max_grandparent_overlap_bytes_) {
+        // Too much overlap for current output; start new output
+        overlapped_bytes_ = 0;
+        return true;
+    } else {
+        return false;
+    }
+}
+
+void Compaction::ReleaseInputs() {
+    if (input_version_ != nullptr) {
+        input_version_->Unref();
+        input_version_ = nullptr;
+    }
+}
+
+} // namespace tinydb
@@ -0,0 +1,130 @@
+#ifndef STORAGE_TINYDB_DB_COMPACTION_H_
+#define STORAGE_TINYDB_DB_COMPACTION_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "db/dbformat.h"
+#include "db/version_edit.h"
+
+namespace tinydb {
+
+struct Options;
+class Version;
+
+// 触发 compaction 的原因
+enum CompactionReason {
+    kCompactionReasonLevelL0FilesNum,
+    kCompactionReasonLevelMaxLevelSize,
+    kCompactionReasonUniversalSizeAmplification,
+    kCompactionReasonUniversalSizeRatio,
+    kCompactionReasonUniversalSortedRunNum,
+    kCompactionReasonFIFOMaxSize,
+    kCompactionReasonFIFOTtl,
+};
+
+// 返回 reason 的名字，用于日志
+const char* CompactionReasonName(CompactionReason reason);
+
+// 一次 compaction 在某一层的输入文件
+struct CompactionInputFiles {
+    int level;
+    std::vector<FileMetaData*> files;
+};
+
+/*
+ * 描述一次 compaction：从哪些层读哪些文件，输出到哪一层
+ * 由 CompactionPicker 选出，CompactionJob 执行，与 compaction 的方式无关
+ *
+ * 输入按层从上到下(从新到旧)排列，最后一个输入层不深于 output_level
+ */
+class Compaction {
+public:
+    // 引用 input_version，直到 ReleaseInputs() 或析构
+    Compaction(const Options* options, const InternalKeyComparator* icmp,
+               Version* input_version, int output_level, CompactionReason reason);
+
+    Compaction(const Compaction&) = delete;
+    Compaction& operator=(const Compaction&) = delete;
+
+    ~Compaction();
+
+    // 追加一层输入，files 可以为空(例如 leveled 下一层没有重叠的文件)
+    void AddInputFiles(int level, const std::vector<FileMetaData*>& files);
+
+    // 与输出重叠的 output_level + 1 层文件，输出文件与它们重叠太多时提前切换文件
+    void SetGrandparents(const std::vector<FileMetaData*>& grandparents);
+
+    size_t num_input_levels() const { return inputs_.size(); }
+    int level(size_t which) const { return inputs_[which].level; }
+    const std::vector<FileMetaData*>& inputs(size_t which) const {
+        return inputs_[which].files;
+    }
+    int num_input_files(size_t which) const {
+        return static_cast<int>(inputs_[which].files.size());
+    }
+
+    // 第一个输入层
+    int start_level() const { return inputs_[0].level; }
+    int output_level() const { return output_level_; }
+    CompactionReason reason() const { return reason_; }
+
+    Version* input_version() const { return input_version_; }
+
+    // compaction 的结果写入这个 edit
+    VersionEdit* edit() { return &edit_; }
+
+    // 输出文件的大小上限
+    uint64_t MaxOutputFileSize() const { return max_output_file_size_; }
+
+    // 所有输入文件的大小之和
+    uint64_t TotalInputBytes() const;
+
+    // 只有一个输入文件，且不需要与其他文件合并，直接把它移到 output_level 即可
+    bool IsTrivialMove() const;
+
+    // 只删除输入文件，不读取也不输出任何数据(FIFO compaction)
+    bool IsDeletionCompaction() const;
+
+    // 把删除所有输入文件的操作加到 *edit
+    void AddInputDeletions(VersionEdit* edit);
+
+    // output_level 以下的层中都没有 user_key 时返回 true，此时删除标记可以直接丢掉
+    // 要求按递增的顺序调用
+    bool IsBaseLevelForKey(const Slice& user_key);
+
+    // output_level 以下的层中没有文件与 [begin, end] 重叠时返回 true，
+    // 此时对所有快照都可见的 range tombstone 已经没有要遮住的数据，可以丢掉
+    bool IsBaseLevelForRange(const Slice& begin, const Slice& end) const;
+
+    // 当前输出文件在写入 internal_key 之前应当结束时返回 true
+    bool ShouldStopBefore(const Slice& internal_key);
+
+    // 释放 input_version 的引用，compaction 结束后调用
+    void ReleaseInputs();
+
+private:
+    const InternalKeyComparator* const icmp_;
+    const int output_level_;
+    const CompactionReason reason_;
+    const uint64_t max_output_file_size_;
+    const int64_t max_grandparent_overlap_bytes_;
+    Version* input_version_;
+    VersionEdit edit_;
+
+    std::vector<CompactionInputFiles> inputs_;
+
+    // ShouldStopBefore() 的状态
+    std::vector<FileMetaData*> grandparents_;
+    size_t grandparent_index_;  // Index in grandparent_starts_
+    bool seen_key_;             // Some output key has been seen
+    int64_t overlapped_bytes_;  // Bytes of overlap between current output
+                                // and grandparent files
+
+    // IsBaseLevelForKey() 的状态：level_ptrs_[lvl] 是 lvl 层中可能包含下一个 key 的文件下标
+    size_t level_ptrs_[config::kNumLevels];
+};
+
+} // namespace tinydb
+
+#endif  // STORAGE_TINYDB_DB_COMPACTION_H_
@@ -0,0 +1,587 @@
+#include "db/compaction_job.h"
+
+#include "db/blob_file_builder.h"
+#include "db/blob_format.h"
+#include "db/blob_gc.h"
+#include "db/builder.h"
+#include "db/compaction.h"
+#include "db/filename.h"
+#include "db/merge_helper.h"
+#include "db/range_tombstone_fragmenter.h"
+#include "db/version_set.h"
+#include "table/merger.h"
+#include "tinydb/compaction_filter.h"
+#include "tinydb/env.h"
+#include "tinydb/iterator.h"
+#include "tinydb/table_builder.h"
+#include "util/mutexlock.h"
+#include "util/statistics.h"
+
+namespace tinydb {
+
+CompactionJob::CompactionJob(const std::string& dbname, const Options& options,
+                             VersionSet* versions, port::Mutex* manifest_mu,
+                             port::Mutex* mu, Compaction* c,
+                             SequenceNumber smallest_snapshot)
+    : dbname_(dbname),
+      options_(options),
+      icmp_(versions->internal_comparator()),
+      versions_(versions),
+      manifest_mu_(manifest_mu),
+      mu_(mu),
+      compact_(c),
+      smallest_snapshot_(smallest_snapshot),
+      outfile_(nullptr),
+      builder_(nullptr),
+      close_pending_(false),
+      has_output_lower_(false),
+      range_dels_(nullptr),
+      blob_builder_(nullptr),
+      blob_meter_(nullptr),
+      blob_relocator_(nullptr) {}
+
+CompactionJob::~CompactionJob() {
+    if (builder_ != nullptr) {
+        builder_->Abandon();
+        delete builder_;
+    }
+    delete outfile_;
+    delete range_dels_;
+    delete blob_relocator_;
+    delete blob_meter_;
+    delete blob_builder_;
+    delete compact_;
+}
+
+uint64_t CompactionJob::NewFileNumber() {
+    MutexLock l(mu_);
+    return versions_->NewFileNumber();
+}
+
+Status CompactionJob::Run() {
+    mu_->AssertHeld();
+    const uint64_t start_micros = options_.env->NowMicros();
+    VersionEdit* edit = compact_->edit();
+    Status s;
+
+    if (compact_->IsDeletionCompaction()) {
+        // 输入文件整个被丢掉，不需要读写数据
+        compact_->AddInputDeletions(edit);
+        s = LogAndApply(edit);
+    } else if (compact_->IsTrivialMove()) {
+        // 直接把文件移到下一层，不需要读写数据
+        FileMetaData* f = compact_->inputs(0)[0];
+        edit->RemoveFile(compact_->start_level(), f->number);
+        edit->AddFile(compact_->output_level(), f->number, f->file_size,
+                      f->smallest, f->largest, f->oldest_blob_file_number,
+                      f->file_creation_time);
+        s = LogAndApply(edit);
+    } else {
+        Version* v = compact_->input_version();
+        const std::vector<BlobFileMetaData*>& blob_files = v->blob_files();
+        uint64_t gc_cutoff = kInvalidBlobFileNumber;
+        if (!blob_files.empty()) {
+            blob_meter_ = new BlobGarbageMeter;
+            if (options_.enable_blob_garbage_collection) {
+                gc_cutoff = v->BlobGCCutoffFileNumber(
+                        options_.blob_garbage_collection_age_cutoff);
+                if (gc_cutoff <= blob_files[0]->number) {
+                    gc_cutoff = kInvalidBlobFileNumber;
+                }
+            }
+        }
+        if (options_.enable_blob_files || gc_cutoff != kInvalidBlobFileNumber) {
+            // 没有写入 blob 时不会生成文件，编号空着也没有关系
+            blob_builder_ = new BlobFileBuilder(dbname_, options_.env, options_,
+                                                versions_->NewFileNumber());
+        }
+        if (gc_cutoff != kInvalidBlobFileNumber) {
+            blob_relocator_ = new BlobRelocator(options_.env, dbname_, gc_cutoff,
+                                                blob_builder_);
+        }
+
+        mu_->Unlock();
+        s = DoCompactionWork();
+        mu_->Lock();
+
+        if (s.ok()) {
+            s = Install();
+        }
+        if (!s.ok()) {
+            RemoveOutputs();
+        }
+    }
+
+    compact_->ReleaseInputs();
+    stats_.micros = options_.env->NowMicros() - start_micros;
+    if (s.ok()) {
+        RecordTick(options_.statistics, COMPACT_READ_BYTES, stats_.bytes_read);
+        RecordTick(options_.statistics, COMPACT_WRITE_BYTES, stats_.bytes_written);
+    }
+    return s;
+}
+
+Iterator* CompactionJob::MakeInputIterator() {
+    ReadOptions read_options;
+    read_options.verify_checksums = options_.paranoid_checks;
+    read_options.fill_cache = false;
+    read_options.total_order_seek = true;
+
+    std::vector<Iterator*> list;
+    std::vector<RangeTombstone> tombstones;
+    for (size_t which = 0; which < compact_->num_input_levels(); which++) {
+        const std::vector<FileMetaData*>& files = compact_->inputs(which);
+        for (size_t i = 0; i < files.size(); i++) {
+            list.push_back(NewTableFileIterator(dbname_, options_.env, options_,
+                                                read_options, files[i]->number,
+                                                files[i]->file_size, &tombstones));
+        }
+    }
+    if (!tombstones.empty()) {
+        range_dels_ = new FragmentedRangeTombstoneList(tombstones,
+                                                       icmp_->user_comparator());
+    }
+    return NewMergingIterator(icmp_, list.data(), static_cast<int>(list.size()));
+}
+
+Status CompactionJob::DoCompactionWork() {
+    stats_.bytes_read = compact_->TotalInputBytes();
+
+    Iterator* input = MakeInputIterator();
+    input->SeekToFirst();
+    Status status;
+    ParsedInternalKey ikey;
+    std::string current_user_key;
+    bool has_current_user_key = false;
+    SequenceNumber last_sequence_for_key = kMaxSequenceNumber;
+    const Comparator* ucmp = icmp_->user_comparator();
+    const CompactionFilter* filter = options_.compaction_filter;
+    while (input->Valid()) {
+        Slice key = input->key();
+        if (compact_->ShouldStopBefore(key) && builder_ != nullptr) {
+            close_pending_ = true;
+        }
+        stats_.num_input_records++;
+        if (blob_meter_ != nullptr) {
+            blob_meter_->ProcessInput(key, input->value());
+        }
+
+        // Handle key/value, add to state, etc.
+        bool drop = false;
+        const bool parsed = ParseInternalKey(key, &ikey);
+        if (!parsed) {
+            // Do not hide error keys
+            current_user_key.clear();
+            has_current_user_key = false;
+            last_sequence_for_key = kMaxSequenceNumber;
+        } else {
+            if (!has_current_user_key ||
+                ucmp->Compare(ikey.user_key, Slice(current_user_key)) != 0) {
+                // First occurrence of this user key
+                current_user_key.assign(ikey.user_key.data(), ikey.user_key.size());
+                has_current_user_key = true;
+                last_sequence_for_key = kMaxSequenceNumber;
+            }
+
+            if (last_sequence_for_key <= smallest_snapshot_) {
+                // 被同一个 user key 的更新的版本覆盖，而且没有快照能看到它
+                drop = true;
+            } else if (ikey.type == kTypeDeletion &&
+                       ikey.sequence <= smallest_snapshot_ &&
+                       compact_->IsBaseLevelForKey(ikey.user_key)) {
+                // 更深的层中没有这个 key，本层中更旧的版本在这次 compaction 中会被
+                // 上面的规则丢掉，所以删除标记本身也不再需要
+                drop = true;
+            } else if (range_dels_ != nullptr &&
+                       range_dels_->MaxCoveringTombstoneSeqnum(
+                               ikey.user_key, smallest_snapshot_) > ikey.sequence) {
+                // 被所有快照都能看到的 range tombstone 覆盖
+                drop = true;
+            }
+            last_sequence_for_key = ikey.sequence;
+        }
+
+        Slice value = input->value();
+        if (!drop && parsed && ikey.type == kTypeValue &&
+            ikey.sequence <= smallest_snapshot_ && filter != nullptr &&
+            filter->Filter(compact_->output_level(), ikey.user_key, value)) {
+            stats_.num_filtered_records++;
+            if (compact_->IsBaseLevelForKey(ikey.user_key)) {
+                drop = true;
+            } else {
+                // 更深的层中还有这个 key 的旧版本，改写成删除标记把它们遮住
+                ikey.type = kTypeDeletion;
+                filtered_key_.clear();
+                AppendInternalKey(&filtered_key_, ikey);
+                key = filtered_key_;
+                value = Slice();
+            }
+        }
+
+        if (!drop && parsed && ikey.type == kTypeMerge &&
+            ikey.sequence <= smallest_snapshot_ && options_.merge_operator != nullptr) {
+            // 合并之后 input 已经位于下一个需要处理的条目
+            status = MergeOperands(input, ikey, &last_sequence_for_key);
+            if (!status.ok()) {
+                break;
+            }
+            continue;
+        }
+
+        if (drop) {
+            stats_.num_dropped_records++;
+        } else {
+            status = ProcessKeyValue(key, parsed ? &ikey : nullptr, value);
+            if (!status.ok()) {
+                break;
+            }
+        }
+        input->Next();
+    }
+
+    if (status.ok()) {
+        status = input->status();
+    }
+    if (status.ok() && builder_ == nullptr && outputs_.empty() &&
+        range_dels_ != nullptr) {
+        // 所有的数据都被删掉了，range tombstone 可能仍然需要保留
+        status = OpenOutputFile();
+    }
+    if (builder_ != nullptr) {
+        Status s = FinishOutputFile(status, nullptr);
+        if (status.ok()) {
+            status = s;
+        }
+    }
+    delete input;
+
+    // table 引用的 blob 必须先于新版本落盘
+    if (status.ok() && blob_builder_ != nullptr) {
+        status = blob_builder_->Finish();
+        stats_.bytes_written += blob_builder_->file_size();
+    }
+    return status;
+}
+
+Status CompactionJob::ProcessKeyValue(const Slice& key,
+                                      const ParsedInternalKey* ikey,
+                                      const Slice& value) {
+    Slice out_key = key;
+    Slice out_value = value;
+    bool is_blob_index = ikey != nullptr && ikey->type == kTypeBlobIndex;
+    if (ikey != nullptr && blob_builder_ != nullptr) {
+        if (ikey->type == kTypeValue && options_.enable_blob_files &&
+            value.size() >= options_.min_blob_size) {
+            // 较早写入的大 value(例如打开键值分离之前)在 compaction 时分离出去
+            Status s = blob_builder_->Add(ikey->user_key, value, &blob_index_);
+            if (!s.ok()) {
+                return s;
+            }
+            blob_key_.clear();
+            AppendInternalKey(&blob_key_, ParsedInternalKey(ikey->user_key,
+                                                            ikey->sequence,
+                                                            kTypeBlobIndex));
+            out_key = blob_key_;
+            out_value = blob_index_;
+            is_blob_index = true;
+        } else if (is_blob_index && blob_relocator_ != nullptr) {
+            bool relocated;
+            Status s = blob_relocator_->MaybeRelocate(ikey->user_key, value,
+                                                      &blob_index_, &relocated);
+            if (!s.ok()) {
+                return s;
+            }
+            if (relocated) {
+                out_value = blob_index_;
+            }
+        }
+    }
+
+    // 输出文件只在 user key 变化的地方切换，同一个 user key 的所有版本和覆盖它的
+    // range tombstone 都在同一个文件中
+    if (builder_ != nullptr && close_pending_ && ikey != nullptr &&
+        icmp_->user_comparator()->Compare(ikey->user_key,
+                                          outputs_.back().largest.user_key()) != 0) {
+        Status s = FinishOutputFile(Status::OK(), &ikey->user_key);
+        if (!s.ok()) {
+            return s;
+        }
+    }
+    if (builder_ == nullptr) {
+        Status s = OpenOutputFile();
+        if (!s.ok()) {
+            return s;
+        }
+    }
+    Output* out = &outputs_.back();
+    if (builder_->NumEntries() == 0) {
+        out->smallest.DecodeFrom(out_key);
+    }
+    out->largest.DecodeFrom(out_key);
+    builder_->Add(out_key, out_value);
+
+    if (is_blob_index) {
+        if (blob_meter_ != nullptr) {
+            blob_meter_->ProcessOutput(out_key, out_value);
+        }
+        BlobIndex index;
+        if (index.DecodeFrom(out_value).ok() &&
+            (out->oldest_blob_file_number == kInvalidBlobFileNumber ||
+             index.file_number() < out->oldest_blob_file_number)) {
+            out->oldest_blob_file_number = index.file_number();
+        }
+    }
+
+    // 文件足够大时，在下一个 user key 之前结束
+    if (builder_->FileSize() >= compact_->MaxOutputFileSize()) {
+        close_pending_ = true;
+    }
+    return Status::OK();
+}
+
+Status CompactionJob::MergeOperands(Iterator* input, const ParsedInternalKey& first,
+                                    SequenceNumber* last_sequence_for_key) {
+    const Comparator* ucmp = icmp_->user_comparator();
+    const std::string user_key = first.user_key.ToString();
+    const SequenceNumber sequence = first.sequence;
+    MergeContext context;
+    std::vector<std::string> keys;  // 操作数原来的 key，与 context 中的顺序相同
+    context.PushOperand(input->value());
+    keys.push_back(input->key().ToString());
+
+    // 向后收集同一个 user key 的操作数，直到遇到值或者删除记录
+    // 它们都比 first 旧，所以也都对所有快照可见
+    bool has_base = false;
+    std::string base_value;
+    Slice base;
+    const Slice* existing_value = nullptr;
+    bool blocked = false;  // 遇到了不能在这里合并的 blob 引用
+    ParsedInternalKey ikey;
+    for (input->Next(); input->Valid(); input->Next()) {
+        if (!ParseInternalKey(input->key(), &ikey) ||
+            ucmp->Compare(ikey.user_key, user_key) != 0) {
+            break;
+        }
+        if (ikey.type == kTypeBlobIndex) {
+            // 合并需要读出 blob，交给读取时处理
+            blocked = true;
+            break;
+        }
+        stats_.num_input_records++;
+        if (blob_meter_ != nullptr) {
+            blob_meter_->ProcessInput(input->key(), input->value());
+        }
+        if (range_dels_ != nullptr &&
+            range_dels_->MaxCoveringTombstoneSeqnum(user_key, smallest_snapshot_) >
+                    ikey.sequence) {
+            // 更旧的版本都被 range tombstone 删除了
+            has_base = true;
+        } else if (ikey.type == kTypeMerge) {
+            context.PushOperand(input->value());
+            keys.push_back(input->key().ToString());
+            continue;
+        } else if (ikey.type == kTypeValue) {
+            has_base = true;
+            base_value = input->value().ToString();
+            base = base_value;
+            existing_value = &base;
+        } else {
+            has_base = true;
+        }
+        // 合并的基础(值、删除记录或者被 tombstone 覆盖的条目)本身不会写出
+        stats_.num_dropped_records++;
+        input->Next();
+        break;
+    }
+    if (!input->status().ok()) {
+        return input->status();
+    }
+    if (!has_base && !blocked && compact_->IsBaseLevelForKey(user_key)) {
+        // 更深的层中也没有这个 key
+        has_base = true;
+    }
+
+    std::string merged_key;
+    std::string merged_value;
+    if (has_base) {
+        // 合并成一个普通的值，更旧的版本都不再需要
+        Status s = FullMergeOperands(options_.merge_operator, user_key, existing_value,
+                                     context.GetOperandsOldestFirst(), &merged_value);
+        if (!s.ok()) {
+            return s;
+        }
+        *last_sequence_for_key = sequence;
+        ParsedInternalKey out(user_key, sequence, kTypeValue);
+        AppendInternalKey(&merged_key, out);
+        stats_.num_dropped_records += keys.size() - 1;
+        return ProcessKeyValue(merged_key, &out, merged_value);
+    }
+
+    // 后面还有更旧的版本需要保留
+    *last_sequence_for_key = kMaxSequenceNumber;
+    const std::vector<Slice> operands = context.GetOperandsOldestFirst();
+    if (PartialMergeOperands(options_.merge_operator, user_key, operands,
+                             &merged_value)) {
+        ParsedInternalKey out(user_key, sequence, kTypeMerge);
+        AppendInternalKey(&merged_key, out);
+        stats_.num_dropped_records += keys.size() - 1;
+        return ProcessKeyValue(merged_key, &out, merged_value);
+    }
+    // 不能合并时原样写出，没有丢掉任何操作数
+    for (size_t i = 0; i < keys.size(); i++) {
+        ParsedInternalKey out;
+        ParseInternalKey(keys[i], &out);
+        Status s = ProcessKeyValue(keys[i], &out, operands[keys.size() - 1 - i]);
+        if (!s.ok()) {
+            return s;
+        }
+    }
+    return Status::OK();
+}
+
+Status CompactionJob::OpenOutputFile() {
+    assert(builder_ == nullptr);
+    Output out;
+    out.number = NewFileNumber();
+    out.file_size = 0;
+    out.oldest_blob_file_number = kInvalidBlobFileNumber;
+    outputs_.push_back(out);
+
+    Status s = NewTableWritableFile(options_.env, TableFileName(dbname_, out.number),
+                                    options_, &outfile_);
+    if (s.ok()) {
+        builder_ = new TableBuilder(options_, outfile_, compact_->output_level(),
+                                    nullptr);
+    }
+    return s;
+}
+
+void CompactionJob::AddRangeTombstones(const Slice* upper) {
+    const Slice lower(output_lower_);
+    std::vector<RangeTombstone> tombstones;
+    range_dels_->GetTombstones(smallest_snapshot_, has_output_lower_ ? &lower : nullptr,
+                               upper, &tombstones);
+    Output* out = &outputs_.back();
+    bool has_range = builder_->NumEntries() > 0;
+    for (size_t i = 0; i < tombstones.size(); i++) {
+        const RangeTombstone& t = tombstones[i];
+        if (t.seq <= smallest_snapshot_ &&
+            compact_->IsBaseLevelForRange(t.start_key, t.end_key)) {
+            // 覆盖的数据在这次 compaction 中都已经丢掉了
+            continue;
+        }
+        const InternalKey start = t.SerializeKey();
+        const InternalKey end = t.SerializeEndKey();
+        builder_->AddRangeTombstone(start.Encode(), t.end_key);
+        if (!has_range || icmp_->Compare(start, out->smallest) < 0) {
+            out->smallest = start;
+        }
+        if (!has_range || icmp_->Compare(end, out->largest) > 0) {
+            out->largest = end;
+        }
+        has_range = true;
+    }
+}
+
+Status CompactionJob::FinishOutputFile(const Status& input_status,
+                                       const Slice* next_user_key) {
+    assert(builder_ != nullptr);
+    Status s = input_status;
+    if (s.ok() && range_dels_ != nullptr) {
+        // 每个输出文件保存 range tombstone 落在 [上一个文件的终点, next_user_key) 中的部分
+        AddRangeTombstones(next_user_key);
+    }
+    if (next_user_key != nullptr) {
+        output_lower_.assign(next_user_key->data(), next_user_key->size());
+        has_output_lower_ = true;
+    }
+    close_pending_ = false;
+
+    const bool empty = builder_->NumEntries() == 0 && builder_->NumRangeDeletions() == 0;
+    if (s.ok() && !empty) {
+        s = builder_->Finish();
+    } else {
+        builder_->Abandon();
+    }
+    const uint64_t current_bytes = builder_->FileSize();
+    outputs_.back().file_size = current_bytes;
+    stats_.bytes_written += current_bytes;
+    stats_.num_output_files++;
+    delete builder_;
+    builder_ = nullptr;
+
+    // Finish and check for file errors
+    if (s.ok()) {
+        s = outfile_->Sync();
+    }
+    if (s.ok()) {
+        s = outfile_->Close();
+    }
+    delete outfile_;
+    outfile_ = nullptr;
+
+    if (s.ok() && empty) {
+        // 只有被丢掉的 range tombstone，不需要这个文件
+        options_.env->RemoveFile(TableFileName(dbname_, outputs_.back().number));
+        outputs_.pop_back();
+        stats_.num_output_files--;
+    }
+    return s;
+}
+
+Status CompactionJob::Install() {
+    mu_->AssertHeld();
+    if (blob_meter_ != nullptr && !blob_meter_->status().ok()) {
+        return blob_meter_->status();
+    }
+
+    VersionEdit* edit = compact_->edit();
+    compact_->AddInputDeletions(edit);
+    const int level = compact_->output_level();
+    // 输出中的数据来自所有输入，生成时间取输入中最早的
+    uint64_t creation_time = 0;
+    for (size_t which = 0; which < compact_->num_input_levels(); which++) {
+        const std::vector<FileMetaData*>& files = compact_->inputs(which);
+        for (size_t i = 0; i < files.size(); i++) {
+            const uint64_t t = files[i]->file_creation_time;
+            if (t != 0 && (creation_time == 0 || t < creation_time)) {
+                creation_time = t;
+            }
+        }
+    }
+    for (size_t i = 0; i < outputs_.size(); i++) {
+        const Output& out = outputs_[i];
+        edit->AddFile(level, out.number, out.file_size, out.smallest, out.largest,
+                      out.oldest_blob_file_number, creation_time);
+    }
+    if (blob_builder_ != nullptr) {
+        blob_builder_->AddToEdit(edit);
+    }
+    if (blob_meter_ != nullptr) {
+        blob_meter_->AddToEdit(edit);
+    }
+    return LogAndApply(edit);
+}
+
+Status CompactionJob::LogAndApply(VersionEdit* edit) {
+    mu_->AssertHeld();
+    // 加锁顺序是先 manifest_mu_ 再 mu_，等待期间其他线程可以继续读写和 flush
+    mu_->Unlock();
+    manifest_mu_->Lock();
+    mu_->Lock();
+    Status s = versions_->LogAndApply(edit, mu_);
+    manifest_mu_->Unlock();
+    return s;
+}
+
+void CompactionJob::RemoveOutputs() {
+    for (size_t i = 0; i < outputs_.size(); i++) {
+        options_.env->RemoveFile(TableFileName(dbname_, outputs_[i].number));
+    }
+    outputs_.clear();
+    if (blob_builder_ != nullptr) {
+        blob_builder_->Abandon();
+    }
+}
+
+} // namespace tinydb
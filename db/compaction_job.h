@@ -0,0 +1,168 @@
+#ifndef STORAGE_TINYDB_DB_COMPACTION_JOB_H_
+#define STORAGE_TINYDB_DB_COMPACTION_JOB_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "db/dbformat.h"
+#include "port/port.h"
+#include "port/thread_annotations.h"
+#include "tinydb/options.h"
+#include "tinydb/status.h"
+
+namespace tinydb {
+
+class BlobFileBuilder;
+class BlobGarbageMeter;
+class BlobRelocator;
+class Compaction;
+class FragmentedRangeTombstoneList;
+class Iterator;
+class TableBuilder;
+class VersionEdit;
+class VersionSet;
+class WritableFile;
+
+// 一次 compaction 的统计
+struct CompactionJobStats {
+    CompactionJobStats()
+        : micros(0),
+          bytes_read(0),
+          bytes_written(0),
+          num_input_records(0),
+          num_dropped_records(0),
+          num_filtered_records(0),
+          num_output_files(0) {}
+
+    uint64_t micros;
+    uint64_t bytes_read;     // 输入文件的大小之和
+    uint64_t bytes_written;  // 输出的 table 和 blob 文件的大小之和
+    uint64_t num_input_records;
+    uint64_t num_dropped_records;
+    uint64_t num_filtered_records;  // 被 Options::compaction_filter 丢掉或改写成删除标记的条目
+    int num_output_files;
+};
+
+/*
+ * 执行一次由 CompactionPicker 选出的 compaction：合并所有输入文件，丢掉被覆盖的旧版本
+ * 和不再需要的删除标记，写出 output_level 层的新文件，再用 LogAndApply 安装新版本
+ * 各种 compaction 方式共用这里读取输入和写 table 的逻辑
+ *
+ * 设置了 Options::compaction_filter 时，对所有快照都能看到的 value 调用它决定是否丢掉
+ * 对所有快照可见的 merge 操作数用 Options::merge_operator 与更旧的版本合并
+ * 被对所有快照可见的 range tombstone 覆盖的条目直接丢掉，tombstone 本身切分之后
+ * 按输出文件的范围写回，更深的层中没有它覆盖的数据时也一起丢掉
+ * FIFO compaction 只删除输入文件，不读写数据
+ *
+ * 打开了键值分离时，大 value 写到新的 blob 文件，指向需要回收的旧 blob 文件的 BlobIndex
+ * 被搬走(见 BlobRelocator)，每个 blob 文件新增的 garbage 记录到 manifest 中
+ */
+class CompactionJob {
+public:
+    /*
+     * options 与传给 VersionSet 的相同，其中 comparator 是 internal key comparator
+     * 安装结果写 manifest 之前先拿 *manifest_mu，与其他写 manifest 的操作串行化，
+     * 加锁顺序：先 *manifest_mu，再 *mu
+     * 序列号不大于 smallest_snapshot 的旧版本对所有读者都不可见，可以丢掉
+     * 接管 c 的所有权
+     */
+    CompactionJob(const std::string& dbname, const Options& options,
+                  VersionSet* versions, port::Mutex* manifest_mu, port::Mutex* mu,
+                  Compaction* c, SequenceNumber smallest_snapshot);
+
+    CompactionJob(const CompactionJob&) = delete;
+    CompactionJob& operator=(const CompactionJob&) = delete;
+
+    ~CompactionJob();
+
+    // 执行 compaction 并安装结果，读写文件和等待 *manifest_mu 期间释放 *mu
+    // 失败时已经写出的文件被删除，当前版本不变
+    Status Run() EXCLUSIVE_LOCKS_REQUIRED(mu_) LOCKS_EXCLUDED(manifest_mu_);
+
+    const CompactionJobStats& stats() const { return stats_; }
+
+private:
+    struct Output {
+        uint64_t number;
+        uint64_t file_size;
+        InternalKey smallest;
+        InternalKey largest;
+        uint64_t oldest_blob_file_number;
+    };
+
+    // 合并输入并写出新文件，不持有锁
+    Status DoCompactionWork();
+
+    // 处理一个需要保留的条目，写到当前输出文件
+    // ikey 为解析后的 key，key 无法解析时为 nullptr
+    Status ProcessKeyValue(const Slice& key, const ParsedInternalKey* ikey,
+                           const Slice& value);
+
+    /*
+     * input 位于一个对所有快照可见的 merge 操作数 first，把它和同一个 user key 的更旧的
+     * 操作数合并：遇到值或者删除记录(更深的层中也没有这个 key 时同样)时合并成一个值，
+     * 否则尽量用 PartialMerge 合并成一个操作数。写出结果，input 停在第一个没有用到的条目
+     */
+    Status MergeOperands(Iterator* input, const ParsedInternalKey& first,
+                         SequenceNumber* last_sequence_for_key);
+
+    Status OpenOutputFile();
+
+    // 结束当前输出文件，next_user_key 是下一个文件的第一个 user key，没有时为 nullptr
+    Status FinishOutputFile(const Status& input_status, const Slice* next_user_key);
+
+    // 把 [output_lower_, *upper) 范围内需要保留的 range tombstone 写到当前输出文件，
+    // 并扩展文件的 key 范围
+    void AddRangeTombstones(const Slice* upper);
+
+    // 把结果写入 edit 并安装新版本
+    Status Install() EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+    // 拿到 *manifest_mu_ 之后调用 VersionSet::LogAndApply()
+    Status LogAndApply(VersionEdit* edit) EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+    // 删除已经写出的文件
+    void RemoveOutputs();
+
+    Iterator* MakeInputIterator();
+
+    uint64_t NewFileNumber() LOCKS_EXCLUDED(mu_);
+
+    const std::string dbname_;
+    const Options options_;
+    const InternalKeyComparator* const icmp_;
+    VersionSet* const versions_;
+    port::Mutex* const manifest_mu_;
+    port::Mutex* const mu_;
+    Compaction* const compact_;
+    const SequenceNumber smallest_snapshot_;
+
+    std::vector<Output> outputs_;
+    WritableFile* outfile_;
+    TableBuilder* builder_;
+    // 当前输出文件已经足够大，在下一个 user key 之前结束
+    bool close_pending_;
+    // 当前输出文件的起点，即上一个输出文件的终点
+    std::string output_lower_;
+    bool has_output_lower_;
+
+    // 所有输入文件中的 range tombstone，没有时为 nullptr
+    FragmentedRangeTombstoneList* range_dels_;
+
+    // 键值分离/blob GC，用不到时为 nullptr
+    BlobFileBuilder* blob_builder_;
+    BlobGarbageMeter* blob_meter_;
+    BlobRelocator* blob_relocator_;
+    std::string blob_key_;
+    std::string blob_index_;
+
+    // 被 compaction_filter 改写成删除标记的 key
+    std::string filtered_key_;
+
+    CompactionJobStats stats_;
+};
+
+} // namespace tinydb
+
+#endif  // STORAGE_TINYDB_DB_COMPACTION_JOB_H_
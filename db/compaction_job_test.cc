@@ -0,0 +1,233 @@
+#include "db/compaction_job.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "db/builder.h"
+#include "db/column_family.h"
+#include "db/compaction.h"
+#include "db/memtable.h"
+#include "db/merge_helper.h"
+#include "db/table_cache.h"
+#include "db/version_edit.h"
+#include "db/version_set.h"
+#include "gtest/gtest.h"
+#include "tinydb/comparator.h"
+#include "tinydb/compaction_filter.h"
+#include "tinydb/env.h"
+#include "tinydb/merge_operator.h"
+#include "util/coding.h"
+#include "util/mutexlock.h"
+#include "util/testutil.h"
+
+namespace tinydb {
+
+namespace {
+
+struct Entry {
+    std::string key;
+    SequenceNumber seq;
+    ValueType type;
+    std::string value;
+};
+
+std::string Fixed(uint64_t v) {
+    std::string result;
+    PutFixed64(&result, v);
+    return result;
+}
+
+// 末尾带有写入时间 write_time 的 value，供 TTL compaction filter 使用
+std::string WithTimestamp(const std::string& value, uint64_t write_time) {
+    std::string result = value;
+    PutFixed32(&result, static_cast<uint32_t>(write_time));
+    return result;
+}
+
+} // namespace
+
+/*
+ * 直接在一个 VersionSet 上构造各层的文件，再对指定的输入执行 CompactionJob
+ */
+class CompactionJobTest : public testing::Test {
+public:
+    CompactionJobTest() : icmp_(BytewiseComparator()), versions_(nullptr) {
+        dbname_ = test::NewTestDirectory("compaction_job_test");
+        merge_operator_.reset(NewUInt64AddOperator());
+        {
+            // 借用 ColumnFamilySet 建一个空的数据库
+            Options db_options;
+            db_options.create_if_missing = true;
+            ColumnFamilySet db(dbname_, db_options);
+            EXPECT_TRUE(db.Open({}).ok());
+        }
+        options_.comparator = &icmp_;
+        options_.merge_operator = merge_operator_.get();
+        versions_ = new VersionSet(dbname_, &options_, &icmp_);
+        bool save_manifest;
+        EXPECT_TRUE(versions_->Recover(&save_manifest).ok());
+        table_cache_.reset(new TableCache(dbname_, options_, 100));
+    }
+
+    ~CompactionJobTest() override { delete versions_; }
+
+    // 把 entries 写成 level 层的一个文件
+    void AddFile(int level, const std::vector<Entry>& entries) {
+        MemTable* mem = new MemTable(icmp_, options_);
+        mem->Ref();
+        SequenceNumber max_seq = 0;
+        for (const Entry& e : entries) {
+            mem->Add(e.seq, e.type, e.key, e.value);
+            max_seq = std::max(max_seq, e.seq);
+        }
+        FileMetaData meta;
+        {
+            MutexLock l(&mu_);
+            meta.number = versions_->NewFileNumber();
+        }
+        Iterator* iter = mem->NewIterator();
+        ASSERT_TRUE(BuildTable(dbname_, options_.env, options_, iter, &meta).ok());
+        delete iter;
+        mem->Unref();
+
+        VersionEdit edit;
+        edit.AddFile(level, meta.number, meta.file_size, meta.smallest, meta.largest,
+                     meta.oldest_blob_file_number, meta.file_creation_time);
+        MutexLock l(&mu_);
+        versions_->SetLastSequence(std::max(versions_->LastSequence(), max_seq));
+        ASSERT_TRUE(versions_->LogAndApply(&edit, &mu_).ok());
+    }
+
+    // 把 start_level 和 output_level 的所有文件合并到 output_level
+    Status Compact(int start_level, int output_level, CompactionJobStats* stats) {
+        MutexLock l(&mu_);
+        Version* v = versions_->current();
+        Compaction* c = new Compaction(&options_, &icmp_, v, output_level,
+                                       kCompactionReasonLevelL0FilesNum);
+        c->AddInputFiles(start_level, v->files(start_level));
+        c->AddInputFiles(output_level, v->files(output_level));
+        // 没有快照，所有的条目对最新的序列号都可见
+        CompactionJob job(dbname_, options_, versions_, &manifest_mu_, &mu_, c,
+                          versions_->LastSequence());
+        Status s = job.Run();
+        *stats = job.stats();
+        return s;
+    }
+
+    std::string Get(const std::string& key) {
+        Version* v;
+        {
+            MutexLock l(&mu_);
+            v = versions_->current();
+            v->Ref();
+        }
+        LookupKey lkey(key, kMaxSequenceNumber);
+        std::string value;
+        MergeContext merge_context;
+        Status s = v->Get(ReadOptions(), lkey, &value, table_cache_.get(), &merge_context);
+        {
+            MutexLock l(&mu_);
+            v->Unref();
+        }
+        if (s.IsNotFound()) {
+            return "NOT_FOUND";
+        }
+        return s.ok() ? value : s.ToString();
+    }
+
+    int NumFiles(int level) {
+        MutexLock l(&mu_);
+        return versions_->NumLevelFiles(level);
+    }
+
+    std::string dbname_;
+    InternalKeyComparator icmp_;
+    std::unique_ptr<const MergeOperator> merge_operator_;
+    Options options_;
+    port::Mutex manifest_mu_;
+    port::Mutex mu_;
+    VersionSet* versions_;
+    std::unique_ptr<TableCache> table_cache_;
+};
+
+TEST_F(CompactionJobTest, FullMergeCountsEachDroppedRecordOnce) {
+    AddFile(0, {{"a", 1, kTypeValue, "va"}, {"k", 2, kTypeValue, Fixed(1)}});
+    AddFile(0, {{"k", 3, kTypeMerge, Fixed(2)}});
+    AddFile(0, {{"k", 4, kTypeMerge, Fixed(3)}, {"k", 5, kTypeMerge, Fixed(4)}});
+
+    CompactionJobStats stats;
+    ASSERT_TRUE(Compact(0, 1, &stats).ok());
+    EXPECT_EQ(0, NumFiles(0));
+    EXPECT_EQ(1, NumFiles(1));
+    // k 的三个操作数和一个值合并成一个值，a 原样保留
+    EXPECT_EQ(5u, stats.num_input_records);
+    EXPECT_EQ(3u, stats.num_dropped_records);
+    EXPECT_EQ(Fixed(10), Get("k"));
+    EXPECT_EQ("va", Get("a"));
+}
+
+TEST_F(CompactionJobTest, PartialMergeAndUnmergedOperands) {
+    // 更深的层中还有 j 和 k 的值，只能合并操作数
+    AddFile(2, {{"j", 1, kTypeValue, Fixed(1)}, {"k", 2, kTypeValue, Fixed(1)}});
+    AddFile(0, {{"j", 3, kTypeMerge, Fixed(2)}, {"k", 4, kTypeMerge, "bad"}});
+    AddFile(0, {{"j", 5, kTypeMerge, Fixed(3)}, {"k", 6, kTypeMerge, Fixed(3)}});
+
+    CompactionJobStats stats;
+    ASSERT_TRUE(Compact(0, 1, &stats).ok());
+    EXPECT_EQ(1, NumFiles(1));
+    EXPECT_EQ(1, NumFiles(2));
+    // j 的两个操作数合并成一个；k 的操作数有一个格式错误，PartialMerge 失败，两个都原样写出
+    EXPECT_EQ(4u, stats.num_input_records);
+    EXPECT_EQ(1u, stats.num_dropped_records);
+    EXPECT_EQ(Fixed(6), Get("j"));
+    // 格式错误的操作数不能当作 0
+    EXPECT_EQ(0u, Get("k").find("Corruption")) << Get("k");
+}
+
+TEST_F(CompactionJobTest, FullMergeFailure) {
+    AddFile(0, {{"k", 1, kTypeValue, "not a fixed64"}});
+    AddFile(0, {{"k", 2, kTypeMerge, Fixed(3)}});
+
+    CompactionJobStats stats;
+    EXPECT_TRUE(Compact(0, 1, &stats).IsCorruption());
+    // 失败时当前版本不变
+    EXPECT_EQ(2, NumFiles(0));
+    EXPECT_EQ(0, NumFiles(1));
+}
+
+TEST_F(CompactionJobTest, TTLCompactionFilter) {
+    Env* env = Env::Default();
+    std::unique_ptr<const CompactionFilter> filter(NewTTLCompactionFilter(env, 100));
+    options_.compaction_filter = filter.get();
+    const uint64_t now = env->NowMicros() / 1000000;
+
+    // 更深的层中还有 b 的旧版本
+    AddFile(2, {{"b", 1, kTypeValue, WithTimestamp("vb1", now)}});
+    AddFile(0, {{"a", 2, kTypeValue, WithTimestamp("va", now - 1000)},
+                {"b", 3, kTypeValue, WithTimestamp("vb2", now - 1000)}});
+    AddFile(0, {{"c", 4, kTypeValue, WithTimestamp("vc", now)}, {"d", 5, kTypeValue, "x"}});
+
+    CompactionJobStats stats;
+    ASSERT_TRUE(Compact(0, 1, &stats).ok());
+    // 过期的 a 直接丢掉，b 改写成删除标记遮住更深层的旧版本；太短的 value 不处理
+    EXPECT_EQ(2u, stats.num_filtered_records);
+    EXPECT_EQ(1u, stats.num_dropped_records);
+    EXPECT_EQ("NOT_FOUND", Get("a"));
+    EXPECT_EQ("NOT_FOUND", Get("b"));
+    EXPECT_EQ("x", Get("d"));
+    std::string c = Get("c");
+    Slice value(c);
+    ASSERT_TRUE(StripTTLTimestamp(&value));
+    EXPECT_EQ("vc", value.ToString());
+    Slice short_value("abc");
+    EXPECT_FALSE(StripTTLTimestamp(&short_value));
+
+    // 输出文件沿用输入中最旧的生成时间
+    Version* v = versions_->current();
+    ASSERT_EQ(1u, v->files(1).size());
+    EXPECT_GT(v->files(1)[0]->file_creation_time, 0u);
+    EXPECT_LE(v->files(1)[0]->file_creation_time, env->NowMicros() / 1000000);
+}
+
+} // namespace tinydb
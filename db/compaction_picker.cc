@@ -0,0 +1,297 @@
+#include "db/compaction_picker.h"
+
+#include "db/compaction.h"
+#include "db/version_set.h"
+#include "tinydb/options.h"
+
+namespace tinydb {
+
+void CompactionPicker::GetRange(const std::vector<FileMetaData*>& inputs,
+                                InternalKey* smallest,
+                                InternalKey* largest) const {
+    assert(!inputs.empty());
+    smallest->Clear();
+    largest->Clear();
+    for (size_t i = 0; i < inputs.size(); i++) {
+        FileMetaData* f = inputs[i];
+        if (i == 0) {
+            *smallest = f->smallest;
+            *largest = f->largest;
+        } else {
+            if (icmp_->Compare(f->smallest, *smallest) < 0) {
+                *smallest = f->smallest;
+            }
+            if (icmp_->Compare(f->largest, *largest) > 0) {
+                *largest = f->largest;
+            }
+        }
+    }
+}
+
+void CompactionPicker::GetRange2(const std::vector<FileMetaData*>& inputs1,
+                                 const std::vector<FileMetaData*>& inputs2,
+                                 InternalKey* smallest,
+                                 InternalKey* largest) const {
+    std::vector<FileMetaData*> all = inputs1;
+    all.insert(all.end(), inputs2.begin(), inputs2.end());
+    GetRange(all, smallest, largest);
+}
+
+namespace {
+
+static double MaxBytesForLevel(int level) {
+    // L0 按文件数触发 compaction，这里的结果对 L0 没有意义
+    double result = 10. * 1048576.0;
+    while (level > 1) {
+        result *= 10;
+        level--;
+    }
+    return result;
+}
+
+// 找出 files 中最大的 key，files 为空时返回 false
+bool FindLargestKey(const InternalKeyComparator& icmp,
+                    const std::vector<FileMetaData*>& files,
+                    InternalKey* largest_key) {
+    if (files.empty()) {
+        return false;
+    }
+    *largest_key = files[0]->largest;
+    for (size_t i = 1; i < files.size(); ++i) {
+        FileMetaData* f = files[i];
+        if (icmp.Compare(f->largest, *largest_key) > 0) {
+            *largest_key = f->largest;
+        }
+    }
+    return true;
+}
+
+// 在 level_files 中找 smallest 与 largest_key 的 user key 相同且 internal key 更大的文件里
+// smallest 最小的一个
+FileMetaData* FindSmallestBoundaryFile(const InternalKeyComparator& icmp,
+                                       const std::vector<FileMetaData*>& level_files,
+                                       const InternalKey& largest_key) {
+    const Comparator* user_cmp = icmp.user_comparator();
+    FileMetaData* smallest_boundary_file = nullptr;
+    for (size_t i = 0; i < level_files.size(); ++i) {
+        FileMetaData* f = level_files[i];
+        if (icmp.Compare(f->smallest, largest_key) > 0 &&
+            user_cmp->Compare(f->smallest.user_key(), largest_key.user_key()) == 0) {
+            if (smallest_boundary_file == nullptr ||
+                icmp.Compare(f->smallest, smallest_boundary_file->smallest) < 0) {
+                smallest_boundary_file = f;
+            }
+        }
+    }
+    return smallest_boundary_file;
+}
+
+/*
+ * 同一个 user key 的多个版本可能跨越同一层的两个相邻文件 b1=(l1,u1)、b2=(l2,u2)，
+ * user_key(u1) == user_key(l2)。只 compaction b1 会把 u1 移到下一层，
+ * 之后读取时在本层的 b2 中先找到更旧的 l2，得到错误的结果
+ * 所以把这样的边界文件也加入 compaction_files，直到没有为止
+ */
+void AddBoundaryInputs(const InternalKeyComparator& icmp,
+                       const std::vector<FileMetaData*>& level_files,
+                       std::vector<FileMetaData*>* compaction_files) {
+    InternalKey largest_key;
+    if (!FindLargestKey(icmp, *compaction_files, &largest_key)) {
+        return;
+    }
+    while (true) {
+        FileMetaData* smallest_boundary_file =
+                FindSmallestBoundaryFile(icmp, level_files, largest_key);
+        if (smallest_boundary_file == nullptr) {
+            break;
+        }
+        compaction_files->push_back(smallest_boundary_file);
+        largest_key = smallest_boundary_file->largest;
+    }
+}
+
+/*
+ * leveled compaction：L0 按文件数、其他层按总大小计算分数，选分数最高的层，
+ * 从该层上一次结束的位置之后选一个文件，与下一层中重叠的文件合并
+ */
+class LevelCompactionPicker : public CompactionPicker {
+public:
+    LevelCompactionPicker(const Options* options, const InternalKeyComparator* icmp)
+        : CompactionPicker(options, icmp) {}
+
+    void ComputeCompactionScore(const Version* v, int* level,
+                                double* score) const override {
+        int best_level = -1;
+        double best_score = -1;
+        for (int lvl = 0; lvl < config::kNumLevels - 1; lvl++) {
+            double s;
+            if (lvl == 0) {
+                // L0 按文件数而不是字节数计算分数：
+                // (1) write buffer 较大时不至于频繁做 L0 compaction
+                // (2) L0 的文件每次读都要合并，文件数比大小更影响读性能
+                s = v->files(lvl).size() /
+                    static_cast<double>(config::kL0_CompactionTrigger);
+            } else {
+                // Compute the ratio of current size to size limit.
+                const uint64_t level_bytes = TotalFileSize(v->files(lvl));
+                s = static_cast<double>(level_bytes) / MaxBytesForLevel(lvl);
+            }
+            if (s > best_score) {
+                best_level = lvl;
+                best_score = s;
+            }
+        }
+        *level = best_level;
+        *score = best_score;
+    }
+
+    /*
+     * 从 L0 开始逐层计算超出阈值的字节数，它们被合并到下一层，下一层也随之增大
+     * 每移动一个字节要重写下一层中按大小比例对应的数据，所以乘以 (下一层/本层 + 1)
+     */
+    uint64_t EstimatePendingCompactionBytes(const Version* v) const override {
+        uint64_t estimated = 0;
+        uint64_t bytes_compact_to_next_level = 0;
+        if (v->files(0).size() >= static_cast<size_t>(config::kL0_CompactionTrigger)) {
+            bytes_compact_to_next_level = TotalFileSize(v->files(0));
+            estimated = bytes_compact_to_next_level;
+        }
+        for (int lvl = 1; lvl < config::kNumLevels - 1; lvl++) {
+            const uint64_t level_bytes = TotalFileSize(v->files(lvl)) + bytes_compact_to_next_level;
+            const double max_bytes = MaxBytesForLevel(lvl);
+            if (level_bytes == 0 || level_bytes <= max_bytes) {
+                bytes_compact_to_next_level = 0;
+                continue;
+            }
+            const uint64_t excess = level_bytes - static_cast<uint64_t>(max_bytes);
+            const double ratio = static_cast<double>(TotalFileSize(v->files(lvl + 1))) / level_bytes;
+            estimated += static_cast<uint64_t>(excess * (ratio + 1));
+            bytes_compact_to_next_level = excess;
+        }
+        return estimated;
+    }
+
+    Compaction* PickCompaction(Version* v,
+                               const std::string* compact_pointers) override {
+        if (v->compaction_score() < 1) {
+            return nullptr;
+        }
+        const int level = v->compaction_level();
+        assert(level >= 0);
+        assert(level + 1 < config::kNumLevels);
+
+        // Pick the first file that comes after compact_pointer_[level]
+        const std::vector<FileMetaData*>& level_files = v->files(level);
+        std::vector<FileMetaData*> inputs0;
+        for (size_t i = 0; i < level_files.size(); i++) {
+            FileMetaData* f = level_files[i];
+            if (compact_pointers[level].empty() ||
+                icmp_->Compare(f->largest.Encode(), compact_pointers[level]) > 0) {
+                inputs0.push_back(f);
+                break;
+            }
+        }
+        if (inputs0.empty()) {
+            // Wrap-around to the beginning of the key space
+            inputs0.push_back(level_files[0]);
+        }
+
+        // Files in level 0 may overlap each other, so pick up all overlapping ones
+        InternalKey smallest, largest;
+        if (level == 0) {
+            GetRange(inputs0, &smallest, &largest);
+            v->GetOverlappingInputs(0, &smallest, &largest, &inputs0);
+            assert(!inputs0.empty());
+        }
+
+        Compaction* c = new Compaction(
+                options_, icmp_, v, level + 1,
+                level == 0 ? kCompactionReasonLevelL0FilesNum
+                           : kCompactionReasonLevelMaxLevelSize);
+        SetupOtherInputs(v, level, &inputs0, c);
+        return c;
+    }
+
+private:
+    // 在不增加下一层文件数的前提下，最多把这么多字节的输入合并到一次 compaction 中
+    int64_t ExpandedCompactionByteSizeLimit() const {
+        return 25 * static_cast<int64_t>(options_->max_file_size);
+    }
+
+    // 根据 level 层的输入找出下一层重叠的文件，尽量扩大 level 层的输入
+    void SetupOtherInputs(Version* v, int level, std::vector<FileMetaData*>* inputs0,
+                          Compaction* c) {
+        InternalKey smallest, largest;
+        AddBoundaryInputs(*icmp_, v->files(level), inputs0);
+        GetRange(*inputs0, &smallest, &largest);
+
+        std::vector<FileMetaData*> inputs1;
+        v->GetOverlappingInputs(level + 1, &smallest, &largest, &inputs1);
+        AddBoundaryInputs(*icmp_, v->files(level + 1), &inputs1);
+
+        // Get entire range covered by compaction
+        InternalKey all_start, all_limit;
+        GetRange2(*inputs0, inputs1, &all_start, &all_limit);
+
+        // 看看能不能在不改变下一层文件的前提下，加入更多 level 层的文件
+        if (!inputs1.empty()) {
+            std::vector<FileMetaData*> expanded0;
+            v->GetOverlappingInputs(level, &all_start, &all_limit, &expanded0);
+            AddBoundaryInputs(*icmp_, v->files(level), &expanded0);
+            const int64_t inputs1_size = TotalFileSize(inputs1);
+            const int64_t expanded0_size = TotalFileSize(expanded0);
+            if (expanded0.size() > inputs0->size() &&
+                inputs1_size + expanded0_size < ExpandedCompactionByteSizeLimit()) {
+                InternalKey new_start, new_limit;
+                GetRange(expanded0, &new_start, &new_limit);
+                std::vector<FileMetaData*> expanded1;
+                v->GetOverlappingInputs(level + 1, &new_start, &new_limit,
+                                        &expanded1);
+                AddBoundaryInputs(*icmp_, v->files(level + 1), &expanded1);
+                if (expanded1.size() == inputs1.size()) {
+                    smallest = new_start;
+                    largest = new_limit;
+                    *inputs0 = expanded0;
+                    inputs1 = expanded1;
+                    GetRange2(*inputs0, inputs1, &all_start, &all_limit);
+                }
+            }
+        }
+
+        c->AddInputFiles(level, *inputs0);
+        c->AddInputFiles(level + 1, inputs1);
+
+        // Compute the set of grandparent files that overlap this compaction
+        // (parent == level+1; grandparent == level+2)
+        if (level + 2 < config::kNumLevels) {
+            std::vector<FileMetaData*> grandparents;
+            v->GetOverlappingInputs(level + 2, &all_start, &all_limit, &grandparents);
+            c->SetGrandparents(grandparents);
+        }
+
+        // 下一次从这次结束的位置之后开始
+        c->edit()->SetCompactPointer(level, largest);
+    }
+};
+
+} // namespace
+
+CompactionPicker* NewLevelCompactionPicker(const Options* options,
+                                           const InternalKeyComparator* icmp) {
+    return new LevelCompactionPicker(options, icmp);
+}
+
+CompactionPicker* NewCompactionPicker(const Options* options,
+                                      const InternalKeyComparator* icmp) {
+    switch (options->compaction_style) {
+        case kCompactionStyleUniversal:
+            return NewUniversalCompactionPicker(options, icmp);
+        case kCompactionStyleFIFO:
+            return NewFIFOCompactionPicker(options, icmp);
+        case kCompactionStyleLevel:
+            break;
+    }
+    return NewLevelCompactionPicker(options, icmp);
+}
+
+} // namespace tinydb
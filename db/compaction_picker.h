@@ -0,0 +1,82 @@
+#ifndef STORAGE_TINYDB_DB_COMPACTION_PICKER_H_
+#define STORAGE_TINYDB_DB_COMPACTION_PICKER_H_
+
+#include <string>
+#include <vector>
+
+#include "db/dbformat.h"
+
+namespace tinydb {
+
+class Compaction;
+struct FileMetaData;
+struct Options;
+class Version;
+
+/*
+ * 决定什么时候做 compaction、合并哪些文件，每种 compaction 方式一个实现
+ * 选出的 Compaction 都由 CompactionJob 执行，读取输入和写 table 的逻辑是共用的
+ *
+ * 线程安全：调用者需要持有 VersionSet 的锁
+ */
+class CompactionPicker {
+public:
+    CompactionPicker(const Options* options, const InternalKeyComparator* icmp)
+        : options_(options), icmp_(icmp) {}
+
+    CompactionPicker(const CompactionPicker&) = delete;
+    CompactionPicker& operator=(const CompactionPicker&) = delete;
+
+    virtual ~CompactionPicker() = default;
+
+    // 计算 v 的下一次 compaction 应该从哪一层开始及其分数，分数 >= 1 表示需要 compaction
+    virtual void ComputeCompactionScore(const Version* v, int* level,
+                                        double* score) const = 0;
+
+    /*
+     * 选出 v 的下一次 compaction，不需要时返回 nullptr
+     * compact_pointers[level] 是 level 层上一次 compaction 结束的位置(空串表示从头开始)，
+     * 需要更新时通过返回的 Compaction 的 edit 中的 SetCompactPointer() 记录
+     */
+    virtual Compaction* PickCompaction(Version* v,
+                                       const std::string* compact_pointers) = 0;
+
+    // 估计 v 还需要 compaction 读写多少字节才能让所有层回到阈值以下
+    // 默认返回 0，用于只删除文件、不重写数据的方式
+    virtual uint64_t EstimatePendingCompactionBytes(const Version* v) const { return 0; }
+
+protected:
+    // 返回 inputs 覆盖的最小和最大的 key
+    // REQUIRES: inputs is not empty
+    void GetRange(const std::vector<FileMetaData*>& inputs, InternalKey* smallest,
+                  InternalKey* largest) const;
+
+    // 返回 inputs1 和 inputs2 合起来覆盖的最小和最大的 key
+    // REQUIRES: inputs is not empty
+    void GetRange2(const std::vector<FileMetaData*>& inputs1,
+                   const std::vector<FileMetaData*>& inputs2,
+                   InternalKey* smallest, InternalKey* largest) const;
+
+    const Options* const options_;
+    const InternalKeyComparator* const icmp_;
+};
+
+// 每层一个 sorted run 的 leveled compaction
+CompactionPicker* NewLevelCompactionPicker(const Options* options,
+                                           const InternalKeyComparator* icmp);
+
+// 按 sorted run 的大小比例合并的 universal compaction
+CompactionPicker* NewUniversalCompactionPicker(const Options* options,
+                                               const InternalKeyComparator* icmp);
+
+// 只按总大小和文件生成时间删除最旧文件的 FIFO compaction
+CompactionPicker* NewFIFOCompactionPicker(const Options* options,
+                                          const InternalKeyComparator* icmp);
+
+// 按 options->compaction_style 创建
+CompactionPicker* NewCompactionPicker(const Options* options,
+                                      const InternalKeyComparator* icmp);
+
+} // namespace tinydb
+
+#endif  // STORAGE_TINYDB_DB_COMPACTION_PICKER_H_
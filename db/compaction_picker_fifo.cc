@@ -0,0 +1,101 @@
+#include <algorithm>
+
+#include "db/compaction.h"
+#include "db/compaction_picker.h"
+#include "db/version_set.h"
+#include "tinydb/env.h"
+#include "tinydb/options.h"
+
+namespace tinydb {
+
+namespace {
+
+/*
+ * FIFO compaction：flush 生成的文件都留在 L0，按文件编号从旧到新排列
+ * 最旧的文件过期(ttl)或者所有文件的总大小超过 max_table_files_size 时，
+ * 选出从最旧开始需要删除的文件，CompactionJob 只从版本中删除它们，不读写任何数据
+ *
+ * 过期只看文件的生成时间，所以 ttl 的精度是一个 memtable 的时间跨度
+ */
+class FIFOCompactionPicker : public CompactionPicker {
+public:
+    FIFOCompactionPicker(const Options* options, const InternalKeyComparator* icmp)
+        : CompactionPicker(options, icmp) {}
+
+    void ComputeCompactionScore(const Version* v, int* level,
+                                double* score) const override {
+        const CompactionOptionsFIFO& opts = options_->compaction_options_fifo;
+        *level = 0;
+        *score = static_cast<double>(TotalFileSize(v->files(0))) /
+                 std::max<uint64_t>(opts.max_table_files_size, 1);
+        std::vector<FileMetaData*> expired;
+        if (PickExpiredFiles(v, &expired) > 0) {
+            *score = std::max(*score, 1.0);
+        }
+    }
+
+    Compaction* PickCompaction(Version* v, const std::string*) override {
+        // 生成版本之后也可能有文件过期，这里重新判断而不依赖分数
+        std::vector<FileMetaData*> inputs;
+        CompactionReason reason = kCompactionReasonFIFOTtl;
+        uint64_t remaining = TotalFileSize(v->files(0)) - PickExpiredFiles(v, &inputs);
+
+        const uint64_t max_size = options_->compaction_options_fifo.max_table_files_size;
+        if (remaining > max_size) {
+            std::vector<FileMetaData*> files = SortedByAge(v);
+            for (size_t i = inputs.size(); i < files.size() && remaining > max_size; i++) {
+                inputs.push_back(files[i]);
+                remaining -= files[i]->file_size;
+                reason = kCompactionReasonFIFOMaxSize;
+            }
+        }
+        if (inputs.empty()) {
+            return nullptr;
+        }
+
+        Compaction* c = new Compaction(options_, icmp_, v, 0, reason);
+        c->AddInputFiles(0, inputs);
+        return c;
+    }
+
+private:
+    // 按从旧到新的顺序返回 L0 的文件
+    static std::vector<FileMetaData*> SortedByAge(const Version* v) {
+        std::vector<FileMetaData*> files = v->files(0);
+        std::sort(files.begin(), files.end(), [](FileMetaData* a, FileMetaData* b) {
+            return a->number < b->number;
+        });
+        return files;
+    }
+
+    // 从最旧的文件开始，把过期的文件加入 *expired，返回它们的总大小
+    uint64_t PickExpiredFiles(const Version* v,
+                              std::vector<FileMetaData*>* expired) const {
+        const uint64_t ttl = options_->compaction_options_fifo.ttl;
+        if (ttl == 0) {
+            return 0;
+        }
+        const uint64_t now = options_->env->NowMicros() / 1000000;
+        uint64_t bytes = 0;
+        std::vector<FileMetaData*> files = SortedByAge(v);
+        for (size_t i = 0; i < files.size(); i++) {
+            FileMetaData* f = files[i];
+            // 生成时间未知的文件不按时间删除，也不跳过它去删除更新的文件
+            if (f->file_creation_time == 0 || f->file_creation_time + ttl >= now) {
+                break;
+            }
+            expired->push_back(f);
+            bytes += f->file_size;
+        }
+        return bytes;
+    }
+};
+
+} // namespace
+
+CompactionPicker* NewFIFOCompactionPicker(const Options* options,
+                                          const InternalKeyComparator* icmp) {
+    return new FIFOCompactionPicker(options, icmp);
+}
+
+} // namespace tinydb
@@ -0,0 +1,238 @@
+#include "db/compaction_picker.h"
+
+#include <memory>
+#include <string>
+
+#include "db/column_family.h"
+#include "db/compaction.h"
+#include "db/version_edit.h"
+#include "db/version_set.h"
+#include "gtest/gtest.h"
+#include "tinydb/comparator.h"
+#include "tinydb/env.h"
+#include "util/mutexlock.h"
+#include "util/testutil.h"
+
+namespace tinydb {
+
+/*
+ * 在 manifest 中构造各层的文件(不需要真实存在)，检查 VersionSet 选出的 compaction
+ */
+class CompactionPickerTest : public testing::Test {
+public:
+    CompactionPickerTest() : icmp_(BytewiseComparator()), versions_(nullptr) {
+        dbname_ = test::NewTestDirectory("compaction_picker_test");
+        {
+            // 借用 ColumnFamilySet 建一个空的数据库
+            Options db_options;
+            db_options.create_if_missing = true;
+            ColumnFamilySet db(dbname_, db_options);
+            EXPECT_TRUE(db.Open({}).ok());
+        }
+        options_.comparator = &icmp_;
+    }
+
+    ~CompactionPickerTest() override { delete versions_; }
+
+    void Reopen() {
+        delete versions_;
+        versions_ = new VersionSet(dbname_, &options_, &icmp_);
+        bool save_manifest = false;
+        ASSERT_TRUE(versions_->Recover(&save_manifest).ok());
+    }
+
+    // 往 level 层加入一个大小为 size、覆盖 [a,z] 的文件
+    uint64_t AddFile(int level, uint64_t size, uint64_t creation_time = 0) {
+        VersionEdit edit;
+        MutexLock l(&mu_);
+        const uint64_t number = versions_->NewFileNumber();
+        edit.AddFile(level, number, size, InternalKey("a", 1, kTypeValue),
+                     InternalKey("z", 1, kTypeValue), kInvalidBlobFileNumber, creation_time);
+        EXPECT_TRUE(versions_->LogAndApply(&edit, &mu_).ok());
+        return number;
+    }
+
+    Compaction* Pick() {
+        MutexLock l(&mu_);
+        return versions_->PickCompaction();
+    }
+
+    // c 在 level 层的输入文件个数，不包含该层时为 0
+    static int NumInputs(const Compaction* c, int level) {
+        for (size_t i = 0; i < c->num_input_levels(); i++) {
+            if (c->level(i) == level) {
+                return c->num_input_files(i);
+            }
+        }
+        return 0;
+    }
+
+    std::string dbname_;
+    InternalKeyComparator icmp_;
+    Options options_;
+    port::Mutex mu_;
+    VersionSet* versions_;
+};
+
+TEST_F(CompactionPickerTest, UniversalNotEnoughSortedRuns) {
+    options_.compaction_style = kCompactionStyleUniversal;
+    Reopen();
+    AddFile(6, 100);
+    AddFile(0, 1000);
+    AddFile(0, 1000);
+    EXPECT_FALSE(versions_->NeedsCompaction());
+    EXPECT_EQ(nullptr, Pick());
+    EXPECT_EQ(0u, versions_->EstimatedPendingCompactionBytes());
+}
+
+TEST_F(CompactionPickerTest, UniversalSizeAmplification) {
+    options_.compaction_style = kCompactionStyleUniversal;
+    Reopen();
+    AddFile(6, 100);
+    for (int i = 0; i < 3; i++) {
+        AddFile(0, 100);
+    }
+    // 较新的 run 共 300 字节，超过最旧 run 的 200%，合并所有 run
+    ASSERT_TRUE(versions_->NeedsCompaction());
+    EXPECT_EQ(400u, versions_->EstimatedPendingCompactionBytes());
+    std::unique_ptr<Compaction> c(Pick());
+    ASSERT_NE(nullptr, c);
+    EXPECT_EQ(kCompactionReasonUniversalSizeAmplification, c->reason());
+    EXPECT_EQ(config::kNumLevels - 1, c->output_level());
+    EXPECT_EQ(3, NumInputs(c.get(), 0));
+    EXPECT_EQ(1, NumInputs(c.get(), 6));
+}
+
+TEST_F(CompactionPickerTest, UniversalSizeRatio) {
+    options_.compaction_style = kCompactionStyleUniversal;
+    Reopen();
+    AddFile(6, 10000);
+    for (int i = 0; i < 4; i++) {
+        AddFile(0, 100);
+    }
+    // 大小相近的 4 个 L0 文件合并，最旧的 run 大太多，不参与；输出放在它上面一层
+    std::unique_ptr<Compaction> c(Pick());
+    ASSERT_NE(nullptr, c);
+    EXPECT_EQ(kCompactionReasonUniversalSizeRatio, c->reason());
+    EXPECT_EQ(config::kNumLevels - 2, c->output_level());
+    EXPECT_EQ(4, NumInputs(c.get(), 0));
+    EXPECT_EQ(0, NumInputs(c.get(), 6));
+
+    // run 的个数不到 min_merge_width 时不合并
+    c.reset();
+    options_.compaction_options_universal.min_merge_width = 6;
+    Reopen();
+    EXPECT_EQ(nullptr, Pick());
+
+    // 够了之后大小相近的 run 仍然不够，不考虑大小比例合并
+    AddFile(0, 100);
+    c.reset(Pick());
+    ASSERT_NE(nullptr, c);
+    EXPECT_EQ(kCompactionReasonUniversalSortedRunNum, c->reason());
+    EXPECT_EQ(config::kNumLevels - 1, c->output_level());
+    EXPECT_EQ(5, NumInputs(c.get(), 0));
+    EXPECT_EQ(1, NumInputs(c.get(), 6));
+}
+
+TEST_F(CompactionPickerTest, UniversalSortedRunNum) {
+    options_.compaction_style = kCompactionStyleUniversal;
+    Reopen();
+    // 从新到旧：L0(1) L2(10) L3(100) L4(1000) L6(100000)，相邻的 run 大小相差太多
+    AddFile(6, 100000);
+    AddFile(4, 1000);
+    AddFile(3, 100);
+    AddFile(2, 10);
+    AddFile(0, 1);
+    std::unique_ptr<Compaction> c(Pick());
+    ASSERT_NE(nullptr, c);
+    EXPECT_EQ(kCompactionReasonUniversalSortedRunNum, c->reason());
+    // 合并最新的两个 run，输出放在下一个 run 上面一层
+    EXPECT_EQ(2, c->output_level());
+    ASSERT_EQ(2u, c->num_input_levels());
+    EXPECT_EQ(1, NumInputs(c.get(), 0));
+    EXPECT_EQ(1, NumInputs(c.get(), 2));
+}
+
+TEST_F(CompactionPickerTest, UniversalNeverOutputsToLevel0) {
+    options_.compaction_style = kCompactionStyleUniversal;
+    Reopen();
+    // 下一个 run 在 L1，没有空出来的层，把它也合并进来
+    AddFile(6, 100000);
+    AddFile(2, 10000);
+    AddFile(1, 1000);
+    AddFile(0, 10);
+    AddFile(0, 1);
+    std::unique_ptr<Compaction> c(Pick());
+    ASSERT_NE(nullptr, c);
+    EXPECT_EQ(kCompactionReasonUniversalSortedRunNum, c->reason());
+    EXPECT_EQ(1, c->output_level());
+    EXPECT_EQ(2, NumInputs(c.get(), 0));
+    EXPECT_EQ(1, NumInputs(c.get(), 1));
+    EXPECT_EQ(0, NumInputs(c.get(), 2));
+}
+
+TEST_F(CompactionPickerTest, FIFOMaxSize) {
+    options_.compaction_style = kCompactionStyleFIFO;
+    options_.compaction_options_fifo.max_table_files_size = 250;
+    Reopen();
+    const uint64_t oldest = AddFile(0, 100);
+    const uint64_t older = AddFile(0, 100);
+    EXPECT_EQ(nullptr, Pick());
+    AddFile(0, 100);
+    AddFile(0, 100);
+
+    // 从最旧的文件开始删除，直到总大小不超过上限
+    ASSERT_TRUE(versions_->NeedsCompaction());
+    std::unique_ptr<Compaction> c(Pick());
+    ASSERT_NE(nullptr, c);
+    EXPECT_EQ(kCompactionReasonFIFOMaxSize, c->reason());
+    EXPECT_TRUE(c->IsDeletionCompaction());
+    EXPECT_EQ(0, c->output_level());
+    ASSERT_EQ(1u, c->num_input_levels());
+    ASSERT_EQ(2, c->num_input_files(0));
+    EXPECT_EQ(oldest, c->inputs(0)[0]->number);
+    EXPECT_EQ(older, c->inputs(0)[1]->number);
+}
+
+TEST_F(CompactionPickerTest, FIFOTtl) {
+    options_.compaction_style = kCompactionStyleFIFO;
+    options_.compaction_options_fifo.ttl = 100;
+    Reopen();
+    const uint64_t now = options_.env->NowMicros() / 1000000;
+    const uint64_t oldest = AddFile(0, 100, now - 1000);
+    const uint64_t older = AddFile(0, 100, now - 500);
+    // 生成时间未知的文件不删除，也不跳过它删除更新的文件
+    AddFile(0, 100, 0);
+    AddFile(0, 100, now - 1000);
+    AddFile(0, 100, now);
+
+    // 总大小没有超过上限，过期的文件仍然被删除；生成时间重新打开后仍然保留
+    Reopen();
+    ASSERT_TRUE(versions_->NeedsCompaction());
+    std::unique_ptr<Compaction> c(Pick());
+    ASSERT_NE(nullptr, c);
+    EXPECT_EQ(kCompactionReasonFIFOTtl, c->reason());
+    EXPECT_TRUE(c->IsDeletionCompaction());
+    ASSERT_EQ(2, c->num_input_files(0));
+    EXPECT_EQ(oldest, c->inputs(0)[0]->number);
+    EXPECT_EQ(older, c->inputs(0)[1]->number);
+
+    // 删除过期文件后仍然超过上限时，继续删除更新的文件
+    c.reset();
+    options_.compaction_options_fifo.max_table_files_size = 150;
+    Reopen();
+    c.reset(Pick());
+    ASSERT_NE(nullptr, c);
+    EXPECT_EQ(kCompactionReasonFIFOMaxSize, c->reason());
+    EXPECT_EQ(4, c->num_input_files(0));
+
+    // ttl 为 0 时只按总大小删除
+    c.reset();
+    options_.compaction_options_fifo.ttl = 0;
+    options_.compaction_options_fifo.max_table_files_size = 1000;
+    Reopen();
+    EXPECT_FALSE(versions_->NeedsCompaction());
+    EXPECT_EQ(nullptr, Pick());
+}
+
+} // namespace tinydb
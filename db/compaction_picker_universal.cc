@@ -0,0 +1,208 @@
+#include <algorithm>
+
+#include "db/compaction.h"
+#include "db/compaction_picker.h"
+#include "db/version_set.h"
+#include "tinydb/options.h"
+
+namespace tinydb {
+
+namespace {
+
+/*
+ * universal compaction：每个 L0 文件是一个 sorted run，L1 及以下每个非空的层也是一个 run，
+ * 越新的 run 在越上面。flush 生成的 L0 文件按编号从新到旧，之后是 L1、L2...
+ *
+ * sorted run 的个数达到 kL0_CompactionTrigger 时，依次尝试：
+ *   1. 空间放大：较新的 run 的总大小超过最旧 run 的 max_size_amplification_percent%，
+ *      合并所有 run
+ *   2. 大小比例：从较新的 run 开始，已选中的 run 的总大小与下一个 run 相差不超过
+ *      size_ratio% 时继续加入，凑够 min_merge_width 个就合并这些 run
+ *   3. 以上都不满足时，合并最新的若干个 run，使 run 的个数回到阈值以下
+ *
+ * 合并的结果是一个 sorted run，放在比下一个(更旧的) run 高一层的位置，永远不会写回 L0，
+ * 这样 L0 文件的编号顺序就是它们的新旧顺序
+ */
+class UniversalCompactionPicker : public CompactionPicker {
+public:
+    UniversalCompactionPicker(const Options* options,
+                              const InternalKeyComparator* icmp)
+        : CompactionPicker(options, icmp) {}
+
+    void ComputeCompactionScore(const Version* v, int* level,
+                                double* score) const override {
+        std::vector<SortedRun> runs;
+        CalculateSortedRuns(v, &runs);
+        *level = 0;
+        *score = runs.size() / static_cast<double>(config::kL0_CompactionTrigger);
+    }
+
+    // sorted run 达到阈值时，最坏情况下要合并所有 run
+    uint64_t EstimatePendingCompactionBytes(const Version* v) const override {
+        std::vector<SortedRun> runs;
+        CalculateSortedRuns(v, &runs);
+        if (runs.size() < static_cast<size_t>(config::kL0_CompactionTrigger)) {
+            return 0;
+        }
+        uint64_t total = 0;
+        for (size_t i = 0; i < runs.size(); i++) {
+            total += runs[i].size;
+        }
+        return total;
+    }
+
+    Compaction* PickCompaction(Version* v,
+                               const std::string* compact_pointers) override {
+        std::vector<SortedRun> runs;
+        CalculateSortedRuns(v, &runs);
+        if (runs.size() < static_cast<size_t>(config::kL0_CompactionTrigger)) {
+            return nullptr;
+        }
+
+        Compaction* c = PickCompactionToReduceSizeAmp(v, runs);
+        if (c == nullptr) {
+            c = PickCompactionToReduceSortedRuns(
+                    v, runs, options_->compaction_options_universal.size_ratio,
+                    UINT_MAX, kCompactionReasonUniversalSizeRatio);
+        }
+        if (c == nullptr) {
+            // 不考虑大小比例，合并最新的几个 run 使个数回到阈值以下
+            const size_t num_runs =
+                    runs.size() - config::kL0_CompactionTrigger + 1;
+            c = PickCompactionToReduceSortedRuns(
+                    v, runs, UINT_MAX, static_cast<unsigned int>(std::max<size_t>(num_runs, 2)),
+                    kCompactionReasonUniversalSortedRunNum);
+        }
+        return c;
+    }
+
+private:
+    struct SortedRun {
+        int level;
+        FileMetaData* file;  // L0 的 run 是单个文件，其他层为 nullptr
+        uint64_t size;
+    };
+
+    // 按从新到旧的顺序列出 v 中的所有 sorted run
+    static void CalculateSortedRuns(const Version* v, std::vector<SortedRun>* runs) {
+        std::vector<FileMetaData*> l0 = v->files(0);
+        std::sort(l0.begin(), l0.end(), [](FileMetaData* a, FileMetaData* b) {
+            return a->number > b->number;
+        });
+        for (size_t i = 0; i < l0.size(); i++) {
+            SortedRun run;
+            run.level = 0;
+            run.file = l0[i];
+            run.size = l0[i]->file_size;
+            runs->push_back(run);
+        }
+        for (int level = 1; level < config::kNumLevels; level++) {
+            if (!v->files(level).empty()) {
+                SortedRun run;
+                run.level = level;
+                run.file = nullptr;
+                run.size = TotalFileSize(v->files(level));
+                runs->push_back(run);
+            }
+        }
+    }
+
+    Compaction* PickCompactionToReduceSizeAmp(Version* v,
+                                              const std::vector<SortedRun>& runs) {
+        if (runs.size() < 2) {
+            return nullptr;
+        }
+        uint64_t candidate_size = 0;
+        for (size_t i = 0; i + 1 < runs.size(); i++) {
+            candidate_size += runs[i].size;
+        }
+        const uint64_t earliest_size = runs.back().size;
+        const unsigned int ratio =
+                options_->compaction_options_universal.max_size_amplification_percent;
+        if (candidate_size * 100 < static_cast<uint64_t>(ratio) * earliest_size) {
+            return nullptr;
+        }
+        return MakeCompaction(v, runs, 0, runs.size(),
+                              kCompactionReasonUniversalSizeAmplification);
+    }
+
+    // 从较新的 run 开始找一段相邻、大小相近的 run，最多 max_runs 个
+    Compaction* PickCompactionToReduceSortedRuns(Version* v,
+                                                 const std::vector<SortedRun>& runs,
+                                                 unsigned int ratio,
+                                                 unsigned int max_runs,
+                                                 CompactionReason reason) {
+        const CompactionOptionsUniversal& opts = options_->compaction_options_universal;
+        const size_t min_merge_width = std::max(2u, opts.min_merge_width);
+        const size_t max_merge_width =
+                std::max<size_t>(min_merge_width,
+                                 std::min(opts.max_merge_width, max_runs));
+
+        size_t start = 0;
+        size_t count = 0;
+        for (size_t loop = 0; loop < runs.size(); loop++) {
+            count = 1;
+            double candidate_size = static_cast<double>(runs[loop].size);
+            for (size_t i = loop + 1; count < max_merge_width && i < runs.size(); i++) {
+                // 下一个 run 比已选中的大太多，合并它的代价不划算
+                if (candidate_size * (100.0 + ratio) / 100.0 < runs[i].size) {
+                    break;
+                }
+                candidate_size += runs[i].size;
+                count++;
+            }
+            if (count >= min_merge_width) {
+                start = loop;
+                break;
+            }
+            count = 0;
+        }
+        if (count < 2) {
+            return nullptr;
+        }
+        return MakeCompaction(v, runs, start, start + count, reason);
+    }
+
+    // 合并 runs[start,end)，必要时向后扩展，使输出可以放进 L1 及以下的某一层
+    Compaction* MakeCompaction(Version* v, const std::vector<SortedRun>& runs,
+                               size_t start, size_t end, CompactionReason reason) {
+        // 输出比下一个 run 新，如果下一个 run 还是 L0 文件，输出只能放进 L0，
+        // 会打乱 L0 按编号的新旧顺序，所以把剩下的 L0 文件也一起合并
+        while (end < runs.size() && runs[end].level == 0) {
+            end++;
+        }
+        int output_level = end == runs.size() ? config::kNumLevels - 1
+                                              : runs[end].level - 1;
+        if (output_level == 0) {
+            // 下一个 run 在 L1，没有空出来的层，把它也合并进来
+            end++;
+            output_level = end == runs.size() ? config::kNumLevels - 1
+                                              : runs[end].level - 1;
+        }
+        assert(output_level > 0);
+
+        Compaction* c = new Compaction(options_, icmp_, v, output_level, reason);
+        std::vector<FileMetaData*> l0_files;
+        for (size_t i = start; i < end && runs[i].level == 0; i++) {
+            l0_files.push_back(runs[i].file);
+        }
+        if (!l0_files.empty()) {
+            c->AddInputFiles(0, l0_files);
+        }
+        for (size_t i = start; i < end; i++) {
+            if (runs[i].level > 0) {
+                c->AddInputFiles(runs[i].level, v->files(runs[i].level));
+            }
+        }
+        return c;
+    }
+};
+
+} // namespace
+
+CompactionPicker* NewUniversalCompactionPicker(const Options* options,
+                                               const InternalKeyComparator* icmp) {
+    return new UniversalCompactionPicker(options, icmp);
+}
+
+} // namespace tinydb
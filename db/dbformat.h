@@ -0,0 +1,231 @@
+#ifndef STORAGE_TINYDB_DB_DBFORMAT_H_
+#define STORAGE_TINYDB_DB_DBFORMAT_H_
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "tinydb/comparator.h"
+#include "tinydb/slice.h"
+#include "tinydb/slice_transform.h"
+#include "util/coding.h"
+
+namespace tinydb {
+
+// 常量参数，用 namespace 包起来方便将来改成可配置的
+namespace config {
+static const int kNumLevels = 7;
+
+// L0 文件数达到该值时开始 compaction
+static const int kL0_CompactionTrigger = 4;
+
+// L0 文件数达到该值时减慢写入
+static const int kL0_SlowdownWritesTrigger = 8;
+
+// L0 文件数达到该值时停止写入
+static const int kL0_StopWritesTrigger = 12;
+
+// 新的 memtable dump 出的文件最多被放到第几层
+static const int kMaxMemCompactLevel = 2;
+
+} // namespace config
+
+class InternalKey;
+
+/*
+ * 写入 internal key 的 value 类型
+ * 该值会持久化到磁盘上，不能修改
+ * kTypeBlobIndex 的 value 是指向 blob 文件的 BlobIndex(见 db/blob_format.h)，
+ * 只由 flush/compaction 写入 table，不会出现在 WAL 和 memtable 中
+ * kTypeRangeDeletion 是 range tombstone：user key 是删除范围的起点(包含)，value 是终点
+ * (不包含)，不与普通条目存放在一起，见 db/range_tombstone_fragmenter.h
+ * kTypeMerge 的 value 是 merge 操作数，读取和 compaction 时用 Options::merge_operator
+ * 与更旧的版本合并，见 tinydb/merge_operator.h
+ */
+enum ValueType {
+    kTypeDeletion = 0x0,
+    kTypeValue = 0x1,
+    kTypeBlobIndex = 0x2,
+    kTypeRangeDeletion = 0x3,
+    kTypeMerge = 0x4
+};
+
+/*
+ * 构造查找用的 ParsedInternalKey 时使用的类型
+ * 同一个序列号下按类型降序排列，所以取最大的类型
+ */
+static const ValueType kValueTypeForSeek = kTypeMerge;
+
+typedef uint64_t SequenceNumber;
+
+// 序列号和类型一起打包到 64 位里，序列号只占低 56 位
+static const SequenceNumber kMaxSequenceNumber = ((0x1ull << 56) - 1);
+
+struct ParsedInternalKey {
+    Slice user_key;
+    SequenceNumber sequence;
+    ValueType type;
+
+    ParsedInternalKey() {}  // Intentionally left uninitialized (for speed)
+    ParsedInternalKey(const Slice& u, const SequenceNumber& seq, ValueType t)
+            : user_key(u), sequence(seq), type(t) {}
+    std::string DebugString() const;
+};
+
+// 返回 key 编码成 internal key 后的长度
+inline size_t InternalKeyEncodingLength(const ParsedInternalKey& key) {
+    return key.user_key.size() + 8;
+}
+
+// 把 key 编码成 internal key 追加到 *result
+void AppendInternalKey(std::string* result, const ParsedInternalKey& key);
+
+// 解析 internal key，成功返回 true，格式错误返回 false
+bool ParseInternalKey(const Slice& internal_key, ParsedInternalKey* result);
+
+// 返回 internal key 中的 user key 部分
+inline Slice ExtractUserKey(const Slice& internal_key) {
+    assert(internal_key.size() >= 8);
+    return Slice(internal_key.data(), internal_key.size() - 8);
+}
+
+/*
+ * internal key 的比较器
+ * 先按 user key 升序，再按序列号降序，最后按类型降序
+ */
+class InternalKeyComparator : public Comparator {
+private:
+    const Comparator* user_comparator_;
+
+public:
+    explicit InternalKeyComparator(const Comparator* c) : user_comparator_(c) {}
+    const char* Name() const override;
+    int Compare(const Slice& a, const Slice& b) const override;
+    void FindShortestSeparator(std::string* start,
+                               const Slice& limit) const override;
+    void FindShortSuccessor(std::string* key) const override;
+
+    const Comparator* user_comparator() const { return user_comparator_; }
+
+    int Compare(const InternalKey& a, const InternalKey& b) const;
+};
+
+/*
+ * 把作用于 user key 的前缀变换包装成作用于 internal key 的变换
+ * 存放 internal key 的 memtable 和 table 通过它使用用户配置的 prefix_extractor
+ */
+class InternalKeySliceTransform : public SliceTransform {
+private:
+    const SliceTransform* const user_transform_;
+
+public:
+    explicit InternalKeySliceTransform(const SliceTransform* t)
+        : user_transform_(t) {}
+    // 与用户的变换同名，这样 table 中记录的名字与用户的配置一致
+    const char* Name() const override { return user_transform_->Name(); }
+    Slice Transform(const Slice& key) const override {
+        return user_transform_->Transform(ExtractUserKey(key));
+    }
+    bool InDomain(const Slice& key) const override {
+        return user_transform_->InDomain(ExtractUserKey(key));
+    }
+
+    const SliceTransform* user_transform() const { return user_transform_; }
+};
+
+/*
+ * 包装编码后的 internal key
+ * 模块间传递 internal key 时使用这个类，避免误用字符串比较代替 InternalKeyComparator
+ */
+class InternalKey {
+private:
+    std::string rep_;
+
+public:
+    InternalKey() {}  // Leave rep_ as empty to indicate it is invalid
+    InternalKey(const Slice& user_key, SequenceNumber s, ValueType t) {
+        AppendInternalKey(&rep_, ParsedInternalKey(user_key, s, t));
+    }
+
+    bool DecodeFrom(const Slice& s) {
+        rep_.assign(s.data(), s.size());
+        return !rep_.empty();
+    }
+
+    Slice Encode() const {
+        assert(!rep_.empty());
+        return rep_;
+    }
+
+    Slice user_key() const { return ExtractUserKey(rep_); }
+
+    void SetFrom(const ParsedInternalKey& p) {
+        rep_.clear();
+        AppendInternalKey(&rep_, p);
+    }
+
+    void Clear() { rep_.clear(); }
+
+    std::string DebugString() const;
+};
+
+inline int InternalKeyComparator::Compare(const InternalKey& a,
+                                          const InternalKey& b) const {
+    return Compare(a.Encode(), b.Encode());
+}
+
+inline bool ParseInternalKey(const Slice& internal_key,
+                             ParsedInternalKey* result) {
+    const size_t n = internal_key.size();
+    if (n < 8) return false;
+    uint64_t num = DecodeFixed64(internal_key.data() + n - 8);
+    uint8_t c = num & 0xff;
+    result->sequence = num >> 8;
+    result->type = static_cast<ValueType>(c);
+    result->user_key = Slice(internal_key.data(), n - 8);
+    return (c <= static_cast<uint8_t>(kTypeMerge));
+}
+
+// 查找 memtable 和 table 时使用的 key
+class LookupKey {
+public:
+    // Initialize *this for looking up user_key at a snapshot with
+    // the specified sequence number.
+    LookupKey(const Slice& user_key, SequenceNumber sequence);
+
+    LookupKey(const LookupKey&) = delete;
+    LookupKey& operator=(const LookupKey&) = delete;
+
+    ~LookupKey();
+
+    // memtable 中的 key 格式：varint32 长度前缀 + internal key
+    Slice memtable_key() const { return Slice(start_, end_ - start_); }
+
+    // Return an internal key (suitable for passing to an internal iterator)
+    Slice internal_key() const { return Slice(kstart_, end_ - kstart_); }
+
+    // Return the user key
+    Slice user_key() const { return Slice(kstart_, end_ - kstart_ - 8); }
+
+private:
+    // We construct a char array of the form:
+    //    klength  varint32               <-- start_
+    //    userkey  char[klength]          <-- kstart_
+    //    tag      uint64
+    //                                    <-- end_
+    // The array is a suitable MemTable key.
+    // The suffix starting with "userkey" can be used as an InternalKey.
+    const char* start_;
+    const char* kstart_;
+    const char* end_;
+    char space_[200];  // Avoid allocation for short keys
+};
+
+inline LookupKey::~LookupKey() {
+    if (start_ != space_) delete[] start_;
+}
+
+} // namespace tinydb
+
+#endif  // STORAGE_TINYDB_DB_DBFORMAT_H_
@@ -0,0 +1,190 @@
+#include "db/filename.h"
+
+#include <cassert>
+#include <cstdio>
+#include <vector>
+
+#include "tinydb/env.h"
+
+namespace tinydb {
+
+static std::string MakeFileName(const std::string& dbname, uint64_t number,
+                                const char* suffix) {
+    char buf[100];
+    std::snprintf(buf, sizeof(buf), "/%06llu.%s",
+                  static_cast<unsigned long long>(number), suffix);
+    return dbname + buf;
+}
+
+std::string LogFileName(const std::string& dbname, uint64_t number) {
+    assert(number > 0);
+    return MakeFileName(dbname, number, "log");
+}
+
+std::string TableFileName(const std::string& dbname, uint64_t number) {
+    assert(number > 0);
+    return MakeFileName(dbname, number, "ldb");
+}
+
+std::string BlobFileName(const std::string& dbname, uint64_t number) {
+    assert(number > 0);
+    return MakeFileName(dbname, number, "blob");
+}
+
+std::string DescriptorFileName(const std::string& dbname, uint64_t number) {
+    assert(number > 0);
+    char buf[100];
+    std::snprintf(buf, sizeof(buf), "/MANIFEST-%06llu",
+                  static_cast<unsigned long long>(number));
+    return dbname + buf;
+}
+
+std::string ColumnFamilyDirName(const std::string& dbname, uint32_t id) {
+    assert(id > 0);
+    char buf[100];
+    std::snprintf(buf, sizeof(buf), "/cf-%06u", static_cast<unsigned int>(id));
+    return dbname + buf;
+}
+
+std::string CurrentFileName(const std::string& dbname) {
+    return dbname + "/CURRENT";
+}
+
+std::string LockFileName(const std::string& dbname) { return dbname + "/LOCK"; }
+
+std::string TempFileName(const std::string& dbname, uint64_t number) {
+    assert(number > 0);
+    return MakeFileName(dbname, number, "dbtmp");
+}
+
+std::string InfoLogFileName(const std::string& dbname) {
+    return dbname + "/LOG";
+}
+
+std::string OldInfoLogFileName(const std::string& dbname) {
+    return dbname + "/LOG.old";
+}
+
+// 解析十进制数字前缀，成功时从 *in 中去掉该前缀
+static bool ConsumeDecimalNumber(Slice* in, uint64_t* val) {
+    static const uint64_t kMaxUint64 = ~static_cast<uint64_t>(0);
+    static const uint64_t kLastDigitOfMaxUint64 = kMaxUint64 % 10;
+
+    uint64_t value = 0;
+    size_t consumed = 0;
+    while (consumed < in->size()) {
+        const char ch = (*in)[consumed];
+        if (ch < '0' || ch > '9') {
+            break;
+        }
+        const uint64_t digit = static_cast<uint64_t>(ch - '0');
+        // 检查溢出
+        if (value > kMaxUint64 / 10 ||
+            (value == kMaxUint64 / 10 && digit > kLastDigitOfMaxUint64)) {
+            return false;
+        }
+        value = value * 10 + digit;
+        consumed++;
+    }
+    *val = value;
+    in->remove_prefix(consumed);
+    return consumed != 0;
+}
+
+// Owned filenames have the form:
+//    dbname/CURRENT
+//    dbname/LOCK
+//    dbname/LOG
+//    dbname/LOG.old
+//    dbname/MANIFEST-[0-9]+
+//    dbname/[0-9]+.(log|ldb|blob|dbtmp)
+bool ParseFileName(const std::string& filename, uint64_t* number,
+                   FileType* type) {
+    Slice rest(filename);
+    if (rest == "CURRENT") {
+        *number = 0;
+        *type = kCurrentFile;
+    } else if (rest == "LOCK") {
+        *number = 0;
+        *type = kDBLockFile;
+    } else if (rest == "LOG" || rest == "LOG.old") {
+        *number = 0;
+        *type = kInfoLogFile;
+    } else if (rest.starts_with("MANIFEST-")) {
+        rest.remove_prefix(strlen("MANIFEST-"));
+        uint64_t num;
+        if (!ConsumeDecimalNumber(&rest, &num)) {
+            return false;
+        }
+        if (!rest.empty()) {
+            return false;
+        }
+        *type = kDescriptorFile;
+        *number = num;
+    } else {
+        uint64_t num;
+        if (!ConsumeDecimalNumber(&rest, &num)) {
+            return false;
+        }
+        Slice suffix = rest;
+        if (suffix == Slice(".log")) {
+            *type = kLogFile;
+        } else if (suffix == Slice(".ldb")) {
+            *type = kTableFile;
+        } else if (suffix == Slice(".blob")) {
+            *type = kBlobFile;
+        } else if (suffix == Slice(".dbtmp")) {
+            *type = kTempFile;
+        } else {
+            return false;
+        }
+        *number = num;
+    }
+    return true;
+}
+
+Status SetCurrentFile(Env* env, const std::string& dbname,
+                      uint64_t descriptor_number) {
+    // Remove leading "dbname/" and add newline to manifest file name
+    std::string manifest = DescriptorFileName(dbname, descriptor_number);
+    Slice contents = manifest;
+    assert(contents.starts_with(dbname + "/"));
+    contents.remove_prefix(dbname.size() + 1);
+    std::string tmp = TempFileName(dbname, descriptor_number);
+    Status s = WriteStringToFileSync(env, contents.ToString() + "\n", tmp);
+    if (s.ok()) {
+        s = env->RenameFile(tmp, CurrentFileName(dbname));
+    }
+    if (!s.ok()) {
+        env->RemoveFile(tmp);
+    }
+    return s;
+}
+
+Status NewLogFile(Env* env, const std::string& dbname, uint64_t number,
+                  uint64_t recycle_number, const EnvOptions& options,
+                  WritableFile** result) {
+    const std::string fname = LogFileName(dbname, number);
+    if (recycle_number == 0) {
+        return env->NewWritableFile(fname, options, result);
+    }
+    return env->ReuseWritableFile(fname, LogFileName(dbname, recycle_number),
+                                  options, result);
+}
+
+void RemoveDirTree(Env* env, const std::string& dir) {
+    std::vector<std::string> children;
+    env->GetChildren(dir, &children);
+    for (size_t i = 0; i < children.size(); i++) {
+        if (children[i] == "." || children[i] == "..") {
+            continue;
+        }
+        const std::string path = dir + "/" + children[i];
+        if (!env->RemoveFile(path).ok()) {
+            RemoveDirTree(env, path);
+        }
+    }
+    env->RemoveDir(dir);
+}
+
+} // namespace tinydb
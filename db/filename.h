@@ -0,0 +1,85 @@
+#ifndef STORAGE_TINYDB_DB_FILENAME_H_
+#define STORAGE_TINYDB_DB_FILENAME_H_
+
+/*
+ * 数据库目录下各种文件的命名
+ *   dbname/CURRENT           当前使用的 manifest 文件名
+ *   dbname/LOCK              数据库锁
+ *   dbname/LOG               info log
+ *   dbname/MANIFEST-[0-9]+   manifest，记录 VersionEdit
+ *   dbname/[0-9]+.log        WAL
+ *   dbname/[0-9]+.ldb        sstable
+ *   dbname/[0-9]+.blob       键值分离后存放大 value 的 blob 文件
+ *   dbname/[0-9]+.dbtmp      临时文件
+ */
+
+#include <cstdint>
+#include <string>
+
+#include "tinydb/slice.h"
+#include "tinydb/status.h"
+
+namespace tinydb {
+
+class Env;
+struct EnvOptions;
+class WritableFile;
+
+enum FileType {
+    kLogFile,
+    kDBLockFile,
+    kTableFile,
+    kBlobFile,
+    kDescriptorFile,
+    kCurrentFile,
+    kTempFile,
+    kInfoLogFile  // Either the current one, or an old one
+};
+
+// 返回 WAL 文件名，number 为文件编号
+std::string LogFileName(const std::string& dbname, uint64_t number);
+
+// 返回 sstable 文件名
+std::string TableFileName(const std::string& dbname, uint64_t number);
+
+// 返回 blob 文件名
+std::string BlobFileName(const std::string& dbname, uint64_t number);
+
+// 返回 manifest 文件名
+std::string DescriptorFileName(const std::string& dbname, uint64_t number);
+
+// 返回编号为 id 的 column family 存放 table 和 manifest 的目录(default 直接使用 dbname)
+std::string ColumnFamilyDirName(const std::string& dbname, uint32_t id);
+
+// 返回 CURRENT 文件名，该文件的内容是当前 manifest 的文件名
+std::string CurrentFileName(const std::string& dbname);
+
+std::string LockFileName(const std::string& dbname);
+
+std::string TempFileName(const std::string& dbname, uint64_t number);
+
+std::string InfoLogFileName(const std::string& dbname);
+
+std::string OldInfoLogFileName(const std::string& dbname);
+
+// 如果 filename 是 tinydb 的文件，把类型和编号存到 *type 和 *number 并返回 true
+bool ParseFileName(const std::string& filename, uint64_t* number,
+                   FileType* type);
+
+// 让 CURRENT 指向编号为 descriptor_number 的 manifest
+// 先写临时文件再 rename，保证 CURRENT 的更新是原子的
+Status SetCurrentFile(Env* env, const std::string& dbname,
+                      uint64_t descriptor_number);
+
+// 创建编号为 number 的 WAL。recycle_number 不为 0 时把编号为 recycle_number 的
+// 旧 WAL 重命名后复用，此时必须用带日志编号的格式写入(见 log::Writer)
+Status NewLogFile(Env* env, const std::string& dbname, uint64_t number,
+                  uint64_t recycle_number, const EnvOptions& options,
+                  WritableFile** result);
+
+// 删除 dir 及其中的所有文件和子目录
+void RemoveDirTree(Env* env, const std::string& dir);
+
+} // namespace tinydb
+
+#endif  // STORAGE_TINYDB_DB_FILENAME_H_
@@ -0,0 +1,356 @@
+#include <algorithm>
+#include <atomic>
+#include <new>
+
+#include "db/memtable_rep.h"
+#include "tinydb/slice_transform.h"
+#include "util/hash.h"
+
+namespace tinydb {
+
+namespace {
+
+/*
+ * 按 user key 的前缀(没有 prefix_extractor 或 key 不在它的定义域时按完整的 user key)
+ * 把条目分到固定个数的桶中，同一个桶内的条目有序存放
+ * 同一个 user key 的所有版本总在同一个桶中，所以 Get() 只需要查一个桶
+ */
+class HashRepBase : public MemTableRep {
+public:
+    HashRepBase(const MemTableKeyComparator& cmp, Arena* arena,
+                const SliceTransform* prefix_extractor, size_t bucket_count)
+        : MemTableRep(arena),
+          compare_(cmp),
+          prefix_extractor_(prefix_extractor),
+          bucket_count_(bucket_count > 0 ? bucket_count : 1) {}
+
+    bool IsOrdered() const override { return false; }
+
+    // 取出所有条目排序，返回这个快照上的迭代器
+    Iterator* GetIterator() override {
+        std::vector<const char*>* entries = new std::vector<const char*>;
+        CollectEntries(entries);
+        std::sort(entries->begin(), entries->end(),
+                  [this](const char* a, const char* b) { return compare_(a, b) < 0; });
+        return NewSortedEntryIterator(entries, compare_);
+    }
+
+    Iterator* GetDynamicPrefixIterator() override;
+
+protected:
+    // user_key 所在的桶
+    size_t BucketIndex(const Slice& user_key) const {
+        const Slice bucket_key = BucketKeyInDomain(user_key)
+                                         ? prefix_extractor_->Transform(user_key)
+                                         : user_key;
+        return Hash(bucket_key.data(), bucket_key.size(), 0x3c9e1a57) % bucket_count_;
+    }
+
+    size_t BucketIndexOfEntry(const char* entry) const {
+        return BucketIndex(ExtractUserKey(GetMemTableEntryKey(entry)));
+    }
+
+    // user_key 是否按前缀分桶，是时同一前缀的条目都在一个桶中
+    bool BucketKeyInDomain(const Slice& user_key) const {
+        return prefix_extractor_ != nullptr && prefix_extractor_->InDomain(user_key);
+    }
+
+    // 遍历一个桶的迭代器，不支持 Prev() 和 SeekToLast() 时由调用者退回到全序迭代器
+    virtual Iterator* NewBucketIterator(size_t bucket) = 0;
+
+    virtual void CollectEntries(std::vector<const char*>* entries) = 0;
+
+    const MemTableKeyComparator& compare_;
+    const SliceTransform* const prefix_extractor_;
+    const size_t bucket_count_;
+
+private:
+    class DynamicIterator;
+};
+
+/*
+ * 前缀 seek 模式的迭代器：Seek() 的目标按前缀分桶时只遍历目标所在的桶，
+ * 其他情况(目标不在前缀的定义域、SeekToFirst()、SeekToLast()、Prev())
+ * 退回到全序迭代器，全序迭代器在第一次需要时才创建
+ */
+class HashRepBase::DynamicIterator : public MemTableRep::Iterator {
+public:
+    explicit DynamicIterator(HashRepBase* rep)
+        : rep_(rep), bucket_iter_(nullptr), full_iter_(nullptr), current_(nullptr) {}
+
+    ~DynamicIterator() override {
+        delete bucket_iter_;
+        delete full_iter_;
+    }
+
+    bool Valid() const override { return current_ != nullptr && current_->Valid(); }
+    const char* key() const override { return current_->key(); }
+    void Next() override { current_->Next(); }
+
+    void Prev() override {
+        if (current_ != full_iter_) {
+            const char* entry = current_->key();
+            UseFullIterator();
+            current_->Seek(entry);
+        }
+        current_->Prev();
+    }
+
+    void Seek(const char* memtable_key) override {
+        const Slice user_key =
+                ExtractUserKey(GetMemTableEntryKey(memtable_key));
+        if (rep_->BucketKeyInDomain(user_key)) {
+            delete bucket_iter_;
+            bucket_iter_ = rep_->NewBucketIterator(rep_->BucketIndex(user_key));
+            current_ = bucket_iter_;
+        } else {
+            UseFullIterator();
+        }
+        current_->Seek(memtable_key);
+    }
+
+    void SeekToFirst() override {
+        UseFullIterator();
+        current_->SeekToFirst();
+    }
+
+    void SeekToLast() override {
+        UseFullIterator();
+        current_->SeekToLast();
+    }
+
+private:
+    void UseFullIterator() {
+        if (full_iter_ == nullptr) {
+            full_iter_ = rep_->GetIterator();
+        }
+        current_ = full_iter_;
+    }
+
+    HashRepBase* const rep_;
+    Iterator* bucket_iter_;
+    Iterator* full_iter_;
+    Iterator* current_;
+};
+
+MemTableRep::Iterator* HashRepBase::GetDynamicPrefixIterator() {
+    return new DynamicIterator(this);
+}
+
+// 每个桶是一个跳表，跳表在桶中第一次插入时才创建
+class HashSkipListRep : public HashRepBase {
+public:
+    HashSkipListRep(const MemTableKeyComparator& cmp, Arena* arena,
+                    const SliceTransform* prefix_extractor, size_t bucket_count)
+        : HashRepBase(cmp, arena, prefix_extractor, bucket_count) {
+        char* mem = arena_->AllocateAligned(sizeof(std::atomic<EntrySkipList*>) *
+                                            bucket_count_);
+        buckets_ = reinterpret_cast<std::atomic<EntrySkipList*>*>(mem);
+        for (size_t i = 0; i < bucket_count_; i++) {
+            new (&buckets_[i]) std::atomic<EntrySkipList*>(nullptr);
+        }
+    }
+
+    void Insert(const char* entry) override {
+        std::atomic<EntrySkipList*>* bucket = &buckets_[BucketIndexOfEntry(entry)];
+        EntrySkipList* list = bucket->load(std::memory_order_relaxed);
+        if (list == nullptr) {
+            char* mem = arena_->AllocateAligned(sizeof(EntrySkipList));
+            list = new (mem) EntrySkipList(compare_, arena_);
+            // 跳表初始化完成后才发布，读者看到非空指针时跳表一定是完整的
+            bucket->store(list, std::memory_order_release);
+        }
+        list->Insert(entry);
+    }
+
+    void Get(const LookupKey& k, void* arg,
+             bool (*callback)(void* arg, const char* entry)) override {
+        EntrySkipList* list = GetBucket(BucketIndex(k.user_key()));
+        if (list == nullptr) {
+            return;
+        }
+        EntrySkipList::Iterator iter(list);
+        for (iter.Seek(k.memtable_key().data());
+             iter.Valid() && (*callback)(arg, iter.key()); iter.Next()) {
+        }
+    }
+
+protected:
+    Iterator* NewBucketIterator(size_t bucket) override {
+        EntrySkipList* list = GetBucket(bucket);
+        if (list == nullptr) {
+            return NewSortedEntryIterator(new std::vector<const char*>, compare_);
+        }
+        return new EntrySkipListIterator(list);
+    }
+
+    void CollectEntries(std::vector<const char*>* entries) override {
+        for (size_t i = 0; i < bucket_count_; i++) {
+            EntrySkipList* list = GetBucket(i);
+            if (list == nullptr) {
+                continue;
+            }
+            EntrySkipList::Iterator iter(list);
+            for (iter.SeekToFirst(); iter.Valid(); iter.Next()) {
+                entries->push_back(iter.key());
+            }
+        }
+    }
+
+private:
+    EntrySkipList* GetBucket(size_t i) const {
+        return buckets_[i].load(std::memory_order_acquire);
+    }
+
+    std::atomic<EntrySkipList*>* buckets_;
+};
+
+/*
+ * 每个桶是一个有序的单链表。桶数足够多时每个桶只有很少几个条目，
+ * Insert() 和 Get() 都是 O(1) 期望时间，且不需要跳表节点的多层指针
+ */
+class HashLinkListRep : public HashRepBase {
+public:
+    HashLinkListRep(const MemTableKeyComparator& cmp, Arena* arena,
+                    const SliceTransform* prefix_extractor, size_t bucket_count)
+        : HashRepBase(cmp, arena, prefix_extractor, bucket_count) {
+        char* mem = arena_->AllocateAligned(sizeof(std::atomic<Node*>) * bucket_count_);
+        buckets_ = reinterpret_cast<std::atomic<Node*>*>(mem);
+        for (size_t i = 0; i < bucket_count_; i++) {
+            new (&buckets_[i]) std::atomic<Node*>(nullptr);
+        }
+    }
+
+    void Insert(const char* entry) override {
+        char* mem = arena_->AllocateAligned(sizeof(Node));
+        Node* x = new (mem) Node(entry);
+
+        // 找到第一个 > entry 的节点，把 x 插到它前面
+        std::atomic<Node*>* prev = &buckets_[BucketIndexOfEntry(entry)];
+        Node* next = prev->load(std::memory_order_relaxed);
+        while (next != nullptr && compare_(next->entry, entry) < 0) {
+            prev = &next->next;
+            next = prev->load(std::memory_order_relaxed);
+        }
+        assert(next == nullptr || compare_(next->entry, entry) != 0);
+        x->next.store(next, std::memory_order_relaxed);
+        // 发布 x，读者通过 acquire 读到 x 时一定能看到 x 初始化后的内容
+        prev->store(x, std::memory_order_release);
+    }
+
+    void Get(const LookupKey& k, void* arg,
+             bool (*callback)(void* arg, const char* entry)) override {
+        const char* target = k.memtable_key().data();
+        Node* x = FindGreaterOrEqual(GetBucket(BucketIndex(k.user_key())), target);
+        for (; x != nullptr && (*callback)(arg, x->entry);
+             x = x->next.load(std::memory_order_acquire)) {
+        }
+    }
+
+protected:
+    Iterator* NewBucketIterator(size_t bucket) override {
+        return new BucketIterator(this, GetBucket(bucket));
+    }
+
+    void CollectEntries(std::vector<const char*>* entries) override {
+        for (size_t i = 0; i < bucket_count_; i++) {
+            for (Node* x = GetBucket(i); x != nullptr;
+                 x = x->next.load(std::memory_order_acquire)) {
+                entries->push_back(x->entry);
+            }
+        }
+    }
+
+private:
+    struct Node {
+        explicit Node(const char* e) : next(nullptr), entry(e) {}
+
+        std::atomic<Node*> next;
+        const char* const entry;
+    };
+
+    // 遍历一个桶，单链表不能向前走，Prev() 和 SeekToLast() 由 DynamicIterator 处理
+    class BucketIterator : public MemTableRep::Iterator {
+    public:
+        BucketIterator(const HashLinkListRep* rep, Node* head)
+            : rep_(rep), head_(head), node_(nullptr) {}
+
+        bool Valid() const override { return node_ != nullptr; }
+        const char* key() const override {
+            assert(Valid());
+            return node_->entry;
+        }
+        void Next() override {
+            assert(Valid());
+            node_ = node_->next.load(std::memory_order_acquire);
+        }
+        void Prev() override { assert(false); }
+        void Seek(const char* memtable_key) override {
+            node_ = rep_->FindGreaterOrEqual(head_, memtable_key);
+        }
+        void SeekToFirst() override { node_ = head_; }
+        void SeekToLast() override { assert(false); }
+
+    private:
+        const HashLinkListRep* const rep_;
+        Node* const head_;
+        Node* node_;
+    };
+
+    Node* GetBucket(size_t i) const {
+        return buckets_[i].load(std::memory_order_acquire);
+    }
+
+    Node* FindGreaterOrEqual(Node* x, const char* target) const {
+        while (x != nullptr && compare_(x->entry, target) < 0) {
+            x = x->next.load(std::memory_order_acquire);
+        }
+        return x;
+    }
+
+    std::atomic<Node*>* buckets_;
+};
+
+class HashSkipListRepFactory : public MemTableRepFactory {
+public:
+    explicit HashSkipListRepFactory(size_t bucket_count)
+        : bucket_count_(bucket_count) {}
+
+    const char* Name() const override { return "HashSkipListRepFactory"; }
+
+    MemTableRep* CreateMemTableRep(const MemTableKeyComparator& cmp, Arena* arena,
+                                   const SliceTransform* prefix_extractor) override {
+        return new HashSkipListRep(cmp, arena, prefix_extractor, bucket_count_);
+    }
+
+private:
+    const size_t bucket_count_;
+};
+
+class HashLinkListRepFactory : public MemTableRepFactory {
+public:
+    explicit HashLinkListRepFactory(size_t bucket_count)
+        : bucket_count_(bucket_count) {}
+
+    const char* Name() const override { return "HashLinkListRepFactory"; }
+
+    MemTableRep* CreateMemTableRep(const MemTableKeyComparator& cmp, Arena* arena,
+                                   const SliceTransform* prefix_extractor) override {
+        return new HashLinkListRep(cmp, arena, prefix_extractor, bucket_count_);
+    }
+
+private:
+    const size_t bucket_count_;
+};
+
+} // namespace
+
+MemTableRepFactory* NewHashSkipListRepFactory(size_t bucket_count) {
+    return new HashSkipListRepFactory(bucket_count);
+}
+
+MemTableRepFactory* NewHashLinkListRepFactory(size_t bucket_count) {
+    return new HashLinkListRepFactory(bucket_count);
+}
+
+} // namespace tinydb
@@ -13,15 +13,37 @@ enum RecordType {
     kFullType = 1,
     kFirstType = 2,
     kMiddleType = 3,
-    kLastTyep = 4
+    kLastTyep = 4,
+
+    // 可复用的 WAL 文件使用的记录类型，记录头中多了写入时的日志编号，
+    // 读到编号不同的记录说明是文件上一次使用时留下的旧数据
+    kRecyclableFullType = 5,
+    kRecyclableFirstType = 6,
+    kRecyclableMiddleType = 7,
+    kRecyclableLastType = 8,
+
+    // 数据只有一个字节的 CompressionType，必须是文件中的第一条记录
+    // 之后的每条逻辑记录都是同一个流式压缩器依次压缩的结果，只能从文件开头顺序解压
+    kSetCompressionType = 9,
+    kRecyclableSetCompressionType = 10
 };
 
-static const int kMaxRecordType = kLastTyep;
+static const int kMaxRecordType = kRecyclableSetCompressionType;
 static const int kBlockSize = 32768;
 
 // Header is checksum (4 bytes), length (2 bytes), type (1 byte).
 static const int kHeaderSize = 4 + 2 + 1;
 
+// Recyclable header is checksum (4 bytes), length (2 bytes), type (1 byte),
+// log number (4 bytes). crc 覆盖 type、log number 和数据
+static const int kRecyclableHeaderSize = 4 + 2 + 1 + 4;
+
+// 是否是带日志编号的记录格式
+inline bool IsRecyclableType(unsigned int type) {
+    return (type >= kRecyclableFullType && type <= kRecyclableLastType) ||
+           type == kRecyclableSetCompressionType;
+}
+
 } // namespace log
 } // namespace tinydb
 
@@ -0,0 +1,344 @@
+#include "db/log_reader.h"
+
+#include <cstdio>
+
+#include "port/port.h"
+#include "tinydb/env.h"
+#include "tinydb/options.h"
+#include "util/coding.h"
+#include "util/crc32c.h"
+
+namespace tinydb {
+namespace log {
+
+Reader::Reporter::~Reporter() = default;
+
+Reader::Reader(SequentialFile* file, Reporter* reporter, bool checksum,
+               uint64_t initial_offset)
+        : Reader(file, reporter, checksum, initial_offset, 0) {}
+
+Reader::Reader(SequentialFile* file, Reporter* reporter, bool checksum,
+               uint64_t initial_offset, uint64_t log_number)
+        : file_(file),
+          reporter_(reporter),
+          checksum_(checksum),
+          backing_store_(new char[kBlockSize]),
+          buffer_(),
+          eof_(false),
+          last_record_offset_(0),
+          end_of_buffer_offset_(0),
+          initial_offset_(initial_offset),
+          resyncing_(initial_offset > 0),
+          log_number_(log_number),
+          recycled_(false),
+          decompress_ctx_(nullptr) {}
+
+Reader::~Reader() {
+    delete[] backing_store_;
+    if (decompress_ctx_ != nullptr) {
+        port::Zstd_FreeDStream(decompress_ctx_);
+    }
+}
+
+bool Reader::SkipToInitialBlock() {
+    const size_t offset_in_block = initial_offset_ % kBlockSize;
+    uint64_t block_start_location = initial_offset_ - offset_in_block;
+
+    // 落在块尾部不足一个记录头的区域时，直接跳到下一个块
+    if (offset_in_block > kBlockSize - 6) {
+        block_start_location += kBlockSize;
+    }
+
+    end_of_buffer_offset_ = block_start_location;
+
+    // 跳到第一个可能包含起始记录的块
+    if (block_start_location > 0) {
+        Status skip_status = file_->Skip(block_start_location);
+        if (!skip_status.ok()) {
+            ReportDrop(block_start_location, skip_status);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool Reader::ReadRecord(Slice* record, std::string* scratch) {
+    if (last_record_offset_ < initial_offset_) {
+        if (!SkipToInitialBlock()) {
+            return false;
+        }
+    }
+
+    scratch->clear();
+    record->clear();
+    bool in_fragmented_record = false;
+    // 正在读取的逻辑记录的偏移
+    // 0 is a dummy value to make compilers happy
+    uint64_t prospective_record_offset = 0;
+
+    Slice fragment;
+    while (true) {
+        const unsigned int record_type = ReadPhysicalRecord(&fragment);
+
+        // ReadPhysicalRecord 返回后 buffer_ 中可能只剩下记录尾部，
+        // 用 end_of_buffer_offset_ 反推当前物理记录的起始偏移
+        const int header_size =
+                IsRecyclableType(record_type) ? kRecyclableHeaderSize : kHeaderSize;
+        uint64_t physical_record_offset =
+                end_of_buffer_offset_ - buffer_.size() - header_size - fragment.size();
+
+        if (resyncing_) {
+            if (record_type == kMiddleType || record_type == kRecyclableMiddleType) {
+                continue;
+            } else if (record_type == kLastTyep ||
+                       record_type == kRecyclableLastType) {
+                resyncing_ = false;
+                continue;
+            } else {
+                resyncing_ = false;
+            }
+        }
+
+        switch (record_type) {
+            case kFullType:
+            case kRecyclableFullType:
+                if (in_fragmented_record) {
+                    // 早期版本的 writer 可能在块尾写出空的 kFirstType 记录，这里不算损坏
+                    if (!scratch->empty()) {
+                        ReportCorruption(scratch->size(), "partial record without end(1)");
+                    }
+                }
+                prospective_record_offset = physical_record_offset;
+                scratch->clear();
+                *record = fragment;
+                last_record_offset_ = prospective_record_offset;
+                return MaybeUncompress(record);
+
+            case kFirstType:
+            case kRecyclableFirstType:
+                if (in_fragmented_record) {
+                    if (!scratch->empty()) {
+                        ReportCorruption(scratch->size(), "partial record without end(2)");
+                    }
+                }
+                prospective_record_offset = physical_record_offset;
+                scratch->assign(fragment.data(), fragment.size());
+                in_fragmented_record = true;
+                break;
+
+            case kMiddleType:
+            case kRecyclableMiddleType:
+                if (!in_fragmented_record) {
+                    ReportCorruption(fragment.size(),
+                                     "missing start of fragmented record(1)");
+                } else {
+                    scratch->append(fragment.data(), fragment.size());
+                }
+                break;
+
+            case kLastTyep:
+            case kRecyclableLastType:
+                if (!in_fragmented_record) {
+                    ReportCorruption(fragment.size(),
+                                     "missing start of fragmented record(2)");
+                } else {
+                    scratch->append(fragment.data(), fragment.size());
+                    *record = Slice(*scratch);
+                    last_record_offset_ = prospective_record_offset;
+                    return MaybeUncompress(record);
+                }
+                break;
+
+            case kSetCompressionType:
+            case kRecyclableSetCompressionType:
+                if (in_fragmented_record) {
+                    ReportCorruption(scratch->size(), "partial record without end(3)");
+                    in_fragmented_record = false;
+                    scratch->clear();
+                }
+                if (!SetCompressionType(fragment)) {
+                    return false;
+                }
+                break;
+
+            case kEof:
+            case kOldRecord:
+                if (in_fragmented_record) {
+                    // writer 在写记录的过程中崩溃了，不算损坏，直接丢弃
+                    scratch->clear();
+                }
+                return false;
+
+            case kBadRecord:
+                if (in_fragmented_record) {
+                    ReportCorruption(scratch->size(), "error in middle of record");
+                    in_fragmented_record = false;
+                    scratch->clear();
+                }
+                break;
+
+            default: {
+                char buf[40];
+                std::snprintf(buf, sizeof(buf), "unknown record type %u", record_type);
+                ReportCorruption(
+                        (fragment.size() + (in_fragmented_record ? scratch->size() : 0)),
+                        buf);
+                in_fragmented_record = false;
+                scratch->clear();
+                break;
+            }
+        }
+    }
+    return false;
+}
+
+uint64_t Reader::LastRecordOffset() { return last_record_offset_; }
+
+bool Reader::SetCompressionType(const Slice& fragment) {
+    if (decompress_ctx_ != nullptr || fragment.size() != 1) {
+        ReportCorruption(fragment.size(), "unexpected compression type record");
+        return false;
+    }
+    const CompressionType type = static_cast<CompressionType>(fragment[0]);
+    if (type == kZstdCompression) {
+        decompress_ctx_ = port::Zstd_CreateDStream();
+    }
+    if (decompress_ctx_ == nullptr) {
+        // 之后的记录都无法解压，不再继续读
+        ReportDrop(fragment.size(),
+                   Status::NotSupported("log compression type not supported"));
+        return false;
+    }
+    return true;
+}
+
+bool Reader::MaybeUncompress(Slice* record) {
+    if (decompress_ctx_ == nullptr) {
+        return true;
+    }
+    uncompressed_.clear();
+    if (!port::Zstd_UncompressStream(decompress_ctx_, record->data(), record->size(),
+                                     &uncompressed_)) {
+        // 解压器的状态已经不可用，之后的记录也无法解压
+        ReportCorruption(record->size(), "log record decompression failed");
+        return false;
+    }
+    *record = Slice(uncompressed_);
+    return true;
+}
+
+void Reader::ReportCorruption(uint64_t bytes, const char* reason) {
+    ReportDrop(bytes, Status::Corruption(reason));
+}
+
+void Reader::ReportDrop(uint64_t bytes, const Status& reason) {
+    if (reporter_ != nullptr &&
+        end_of_buffer_offset_ - buffer_.size() - bytes >= initial_offset_) {
+        reporter_->Corruption(static_cast<size_t>(bytes), reason);
+    }
+}
+
+unsigned int Reader::ReadPhysicalRecord(Slice* result) {
+    while (true) {
+        if (buffer_.size() < kHeaderSize) {
+            if (!eof_) {
+                // 上一次读到的是完整的块，跳过块尾的填充，读下一个块
+                buffer_.clear();
+                Status status = file_->Read(kBlockSize, &buffer_, backing_store_);
+                end_of_buffer_offset_ += buffer_.size();
+                if (!status.ok()) {
+                    buffer_.clear();
+                    ReportDrop(kBlockSize, status);
+                    eof_ = true;
+                    return kEof;
+                } else if (buffer_.size() < kBlockSize) {
+                    eof_ = true;
+                }
+                continue;
+            } else {
+                // 文件末尾只剩下不完整的记录头，可能是 writer 写到一半崩溃了，不算损坏
+                buffer_.clear();
+                return kEof;
+            }
+        }
+
+        // 解析记录头
+        const char* header = buffer_.data();
+        const uint32_t a = static_cast<uint32_t>(header[4]) & 0xff;
+        const uint32_t b = static_cast<uint32_t>(header[5]) & 0xff;
+        const unsigned int type = header[6];
+        const uint32_t length = a | (b << 8);
+        const bool recyclable = IsRecyclableType(type);
+        const size_t header_size = recyclable ? kRecyclableHeaderSize : kHeaderSize;
+        if (header_size + length > buffer_.size()) {
+            size_t drop_size = buffer_.size();
+            buffer_.clear();
+            if (recycled_) {
+                // 本次写入的记录之后是复用前的旧数据，从中间开始解析得到的是无意义的记录头
+                eof_ = true;
+                return kOldRecord;
+            }
+            if (!eof_) {
+                ReportCorruption(drop_size, "bad record length");
+                return kBadRecord;
+            }
+            // 文件末尾的记录不完整，同样认为是 writer 写到一半崩溃了
+            return kEof;
+        }
+
+        if (type == kZeroType && length == 0) {
+            // 跳过零长度记录，不报告丢弃(文件预分配空间时会产生这样的记录)
+            buffer_.clear();
+            return kBadRecord;
+        }
+
+        // 校验 crc
+        if (checksum_) {
+            uint32_t expected_crc = crc32c::Unmask(DecodeFixed32(header));
+            uint32_t actual_crc =
+                    crc32c::Value(header + 6, header_size - 6 + length);
+            if (actual_crc != expected_crc) {
+                // 长度字段本身也可能损坏了，丢弃整个块剩余的数据
+                size_t drop_size = buffer_.size();
+                buffer_.clear();
+                if (recycled_) {
+                    eof_ = true;
+                    return kOldRecord;
+                }
+                ReportCorruption(drop_size, "checksum mismatch");
+                return kBadRecord;
+            }
+        }
+
+        if (recyclable) {
+            if (DecodeFixed32(header + 7) != static_cast<uint32_t>(log_number_)) {
+                // 文件上一次使用时写入的记录
+                buffer_.clear();
+                eof_ = true;
+                return kOldRecord;
+            }
+            recycled_ = true;
+        } else if (recycled_) {
+            // 复用前的文件可能是旧格式写的
+            buffer_.clear();
+            eof_ = true;
+            return kOldRecord;
+        }
+
+        buffer_.remove_prefix(header_size + length);
+
+        // 跳过在 initial_offset_ 之前开始的物理记录
+        if (end_of_buffer_offset_ - buffer_.size() - header_size - length <
+            initial_offset_) {
+            result->clear();
+            return kBadRecord;
+        }
+
+        *result = Slice(header + header_size, length);
+        return type;
+    }
+}
+
+} // namespace log
+} // namespace tinydb
@@ -1,16 +1,129 @@
 #ifndef STORAGE_TINYDB_DB_LOG_READER_H_
 #define STORAGE_TINYDB_DB_LOG_READER_H_
 
+#include <cstdint>
+#include <string>
 
+#include "db/log_format.h"
+#include "tinydb/slice.h"
+#include "tinydb/status.h"
 
 namespace tinydb {
+
+class SequentialFile;
+
 namespace log {
 
+// 读取 log::Writer 写出的 WAL/Manifest 文件
+class Reader {
+public:
+    // 用于报告数据损坏
+    class Reporter {
+    public:
+        virtual ~Reporter();
+
+        // 检测到数据损坏，bytes 为因此丢弃的字节数(估计值)
+        virtual void Corruption(size_t bytes, const Status& status) = 0;
+    };
+
+    /*
+     * 从 file 读取记录，Reader 使用期间 file 必须保持有效
+     * reporter 非空时，遇到损坏的数据会通知它
+     * checksum 为 true 时校验 crc
+     * 从文件中物理位置 >= initial_offset 的第一条记录开始读
+     */
+    Reader(SequentialFile* file, Reporter* reporter, bool checksum,
+           uint64_t initial_offset);
+
+    /*
+     * 读取编号为 log_number 的 WAL，文件可能是复用的旧 WAL 文件
+     * 遇到日志编号不同的记录时认为已经读到本次写入的末尾，之后的内容是旧数据，不报告损坏
+     *
+     * 压缩的 WAL(见 log::Writer)由流式解压器依次解压，只能从文件开头(initial_offset 为 0)读取
+     */
+    Reader(SequentialFile* file, Reporter* reporter, bool checksum,
+           uint64_t initial_offset, uint64_t log_number);
+
+    Reader(const Reader&) = delete;
+    Reader& operator=(const Reader&) = delete;
+
+    ~Reader();
+
+    /*
+     * 读取下一条记录到 *record，成功返回 true，到达文件末尾返回 false
+     * *record 可能指向 *scratch 中的数据，只在下一次修改 Reader 或 *scratch 之前有效
+     */
+    bool ReadRecord(Slice* record, std::string* scratch);
+
+    // 返回最后一次 ReadRecord 读到的记录在文件中的物理偏移
+    // 第一次调用 ReadRecord 之前该值无意义
+    uint64_t LastRecordOffset();
+
+    // 返回最后一次 ReadRecord 读到的记录之后的物理偏移，可以作为下一个 Reader 的 initial_offset，
+    // 用于跟随一个仍在被追加的文件(见 SecondaryInstance)
+    uint64_t NextRecordOffset() const { return end_of_buffer_offset_ - buffer_.size(); }
+
+    // 是否已经读到 kSetCompressionType 记录。压缩的文件只能从头读，不能用 NextRecordOffset() 续读
+    bool compressed() const { return decompress_ctx_ != nullptr; }
 
+private:
+    // Extend record types with the following special values
+    enum {
+        kEof = kMaxRecordType + 1,
+        // 遇到无效的物理记录时返回，包括：
+        // * crc 校验失败 (ReadPhysicalRecord 会报告一次丢弃)
+        // * 长度为 0 的记录 (不报告丢弃)
+        // * 记录在 initial_offset 之前 (不报告丢弃)
+        kBadRecord = kMaxRecordType + 2,
+        // 复用的 WAL 文件中上一次使用时留下的数据，当作文件末尾
+        kOldRecord = kMaxRecordType + 3
+    };
 
+    // 跳到 initial_offset_ 所在的块，成功返回 true
+    bool SkipToInitialBlock();
+
+    // 返回记录类型，或者上面的特殊值
+    unsigned int ReadPhysicalRecord(Slice* result);
+
+    // 处理 kSetCompressionType 记录，之后的记录都需要解压。失败时返回 false
+    bool SetCompressionType(const Slice& fragment);
+
+    // 需要时解压一条完整的逻辑记录，*record 改为指向 uncompressed_。失败时返回 false
+    bool MaybeUncompress(Slice* record);
+
+    // 将丢弃的字节数报告给 reporter
+    void ReportCorruption(uint64_t bytes, const char* reason);
+    void ReportDrop(uint64_t bytes, const Status& reason);
+
+    SequentialFile* const file_;
+    Reporter* const reporter_;
+    bool const checksum_;
+    char* const backing_store_;
+    Slice buffer_;
+    bool eof_;  // Last Read() indicated EOF by returning < kBlockSize
+
+    // 最后一次 ReadRecord 返回的记录的偏移
+    uint64_t last_record_offset_;
+    // buffer_ 末尾之后的第一个偏移
+    uint64_t end_of_buffer_offset_;
+
+    // 开始读取的偏移
+    uint64_t const initial_offset_;
+
+    // 在 initial_offset_ 定位之后，跳过跨块记录剩余的片段(kMiddleType/kLastType)
+    bool resyncing_;
+
+    // 期望的日志编号，只检查带日志编号的记录
+    uint64_t const log_number_;
+    // 是否已经读到过带日志编号的记录，之后出现的损坏可能只是复用前留下的数据
+    bool recycled_;
+
+    // 流式解压器，没有读到 kSetCompressionType 记录时为 nullptr
+    void* decompress_ctx_;
+    std::string uncompressed_;
+};
 
 } // namespace log
 } // namespace tinydb
 
-
-#endif  // STORAGE_TINYDB_DB_LOG_READER_H_
\ No newline at end of file
+#endif  // STORAGE_TINYDB_DB_LOG_READER_H_
@@ -0,0 +1,226 @@
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "db/filename.h"
+#include "db/log_reader.h"
+#include "db/log_writer.h"
+#include "gtest/gtest.h"
+#include "tinydb/env.h"
+#include "util/random.h"
+#include "util/testutil.h"
+
+namespace tinydb {
+namespace log {
+
+namespace {
+
+// 大小不一的记录，包括跨多个块的
+std::vector<std::string> MakeRecords(Random* rnd, int num, int max_size) {
+    std::vector<std::string> records;
+    for (int i = 0; i < num; i++) {
+        std::string record;
+        test::RandomString(rnd, 1 + rnd->Uniform(rnd->OneIn(10) ? 3 * kBlockSize : max_size),
+                           &record);
+        records.push_back(record);
+    }
+    return records;
+}
+
+// 写在内存中的文件，fail 为 true 时 Append() 失败
+class StringFile : public WritableFile {
+public:
+    StringFile() : fail(false) {}
+
+    Status Append(const Slice& data) override {
+        if (fail) {
+            return Status::IOError("injected append error");
+        }
+        contents.append(data.data(), data.size());
+        return Status::OK();
+    }
+    Status Close() override { return Status::OK(); }
+    Status Flush() override { return Status::OK(); }
+    Status Sync() override { return Status::OK(); }
+
+    std::string contents;
+    bool fail;
+};
+
+class ReportCollector : public Reader::Reporter {
+public:
+    ReportCollector() : dropped_bytes(0) {}
+    void Corruption(size_t bytes, const Status& status) override {
+        dropped_bytes += bytes;
+        message.append(status.ToString());
+    }
+
+    size_t dropped_bytes;
+    std::string message;
+};
+
+} // namespace
+
+/*
+ * 在真实的文件上写 WAL 再读回
+ */
+class LogTest : public testing::Test {
+public:
+    LogTest() : env_(Env::Default()) { dir_ = test::NewTestDirectory("log_test"); }
+
+    // 写编号为 number 的 WAL，recycle_number 非 0 时复用该 WAL 文件
+    void Write(uint64_t number, uint64_t recycle_number, const std::vector<std::string>& records,
+               CompressionType compression = kNoCompression,
+               const EnvOptions& options = EnvOptions()) {
+        WritableFile* file;
+        ASSERT_TRUE(NewLogFile(env_, dir_, number, recycle_number, options, &file).ok());
+        Writer writer(file, number, true, compression, 3);
+        for (const std::string& record : records) {
+            ASSERT_TRUE(writer.AddRecord(record).ok());
+        }
+        ASSERT_TRUE(file->Close().ok());
+        delete file;
+        written_size_ = writer.FileSize();
+    }
+
+    // 读出编号为 number 的 WAL 中的所有记录
+    std::vector<std::string> Read(uint64_t number, uint64_t initial_offset = 0) {
+        std::vector<std::string> result;
+        SequentialFile* file;
+        EXPECT_TRUE(env_->NewSequentialFile(LogFileName(dir_, number), &file).ok());
+        Reader reader(file, &report_, true, initial_offset, number);
+        Slice record;
+        std::string scratch;
+        while (reader.ReadRecord(&record, &scratch)) {
+            result.push_back(record.ToString());
+        }
+        compressed_ = reader.compressed();
+        delete file;
+        return result;
+    }
+
+    uint64_t FileSize(uint64_t number) {
+        uint64_t size = 0;
+        EXPECT_TRUE(env_->GetFileSize(LogFileName(dir_, number), &size).ok());
+        return size;
+    }
+
+    Env* env_;
+    std::string dir_;
+    ReportCollector report_;
+    uint64_t written_size_ = 0;
+    bool compressed_ = false;
+};
+
+TEST_F(LogTest, RecyclableRecords) {
+    Random rnd(301);
+    const std::vector<std::string> records = MakeRecords(&rnd, 200, 1000);
+    Write(3, 0, records);
+    EXPECT_EQ(written_size_, FileSize(3));
+    EXPECT_EQ(records, Read(3));
+    EXPECT_EQ(0u, report_.dropped_bytes) << report_.message;
+}
+
+TEST_F(LogTest, ReusedFileStopsAtOldRecords) {
+    Random rnd(301);
+    const std::vector<std::string> old_records = MakeRecords(&rnd, 300, 1000);
+    Write(3, 0, old_records);
+    const uint64_t old_size = FileSize(3);
+
+    // 复用之后文件中还留着上一次写入的数据，读到编号不同的记录时结束，不报告损坏
+    const std::vector<std::string> records = MakeRecords(&rnd, 20, 100);
+    Write(4, 3, records);
+    EXPECT_FALSE(env_->FileExists(LogFileName(dir_, 3)));
+    EXPECT_EQ(old_size, FileSize(4));
+    EXPECT_LT(written_size_, old_size);
+    EXPECT_EQ(records, Read(4));
+    EXPECT_EQ(0u, report_.dropped_bytes) << report_.message;
+
+    // 再复用一次，结果相同
+    const std::vector<std::string> again = MakeRecords(&rnd, 5, 5000);
+    Write(9, 4, again);
+    EXPECT_EQ(again, Read(9));
+    EXPECT_EQ(0u, report_.dropped_bytes) << report_.message;
+}
+
+TEST_F(LogTest, Preallocation) {
+    Random rnd(301);
+    const std::vector<std::string> records = MakeRecords(&rnd, 100, 1000);
+    EnvOptions options;
+    options.preallocation_block_size = 1024 * 1024;
+    Write(3, 0, records, kNoCompression, options);
+    // 预分配不改变文件大小，读者看不到还没写入的部分
+    EXPECT_EQ(written_size_, FileSize(3));
+    EXPECT_EQ(records, Read(3));
+    EXPECT_EQ(0u, report_.dropped_bytes) << report_.message;
+}
+
+TEST_F(LogTest, CompressedRecords) {
+    if (!test::ZstdSupported()) {
+        GTEST_SKIP() << "Zstd is not supported";
+    }
+    // 相似的小记录，跨记录的流式压缩可以引用前面记录的内容
+    std::vector<std::string> records;
+    char buf[100];
+    for (int i = 0; i < 2000; i++) {
+        std::string record;
+        for (int j = 0; j < 5; j++) {
+            std::snprintf(buf, sizeof(buf), "{\"id\":%d,\"name\":\"user%06d\",\"active\":true}",
+                          i * 5 + j, i);
+            record.append(buf);
+        }
+        records.push_back(record);
+    }
+    Write(3, 0, records);
+    const uint64_t raw_size = written_size_;
+
+    Write(3, 0, records, kZstdCompression);
+    EXPECT_LT(written_size_, raw_size / 2);
+    EXPECT_EQ(written_size_, FileSize(3));
+    EXPECT_EQ(records, Read(3));
+    EXPECT_TRUE(compressed_);
+    EXPECT_EQ(0u, report_.dropped_bytes) << report_.message;
+
+    // 复用的文件中留着旧的压缩记录，同样在旧数据处结束；跨多个块的记录照常分段
+    Random rnd(301);
+    std::vector<std::string> mixed(records.begin(), records.begin() + 100);
+    for (const std::string& record : MakeRecords(&rnd, 20, 1000)) {
+        mixed.push_back(record);
+    }
+    Write(4, 3, mixed, kZstdCompression);
+    EXPECT_EQ(mixed, Read(4));
+    EXPECT_TRUE(compressed_);
+    EXPECT_EQ(0u, report_.dropped_bytes) << report_.message;
+}
+
+TEST_F(LogTest, UnsupportedCompressionWritesRaw) {
+    // 没有流式接口的压缩算法不压缩，读者照常读取
+    Random rnd(301);
+    const std::vector<std::string> records = MakeRecords(&rnd, 50, 1000);
+    Write(3, 0, records, kSnappyCompression);
+    EXPECT_EQ(records, Read(3));
+    EXPECT_FALSE(compressed_);
+    EXPECT_EQ(0u, report_.dropped_bytes) << report_.message;
+}
+
+TEST_F(LogTest, PaddingWriteError) {
+    StringFile dest;
+    Writer writer(&dest, 3, true);
+    // 当前块只剩 5 字节，放不下记录头，下一条记录要先填充块尾
+    ASSERT_TRUE(writer.AddRecord(std::string(kBlockSize - kRecyclableHeaderSize - 5, 'a')).ok());
+    ASSERT_EQ(kBlockSize - 5, dest.contents.size());
+    EXPECT_EQ(dest.contents.size(), writer.FileSize());
+
+    // 填充失败时返回错误，FileSize() 不计入没有写出的填充
+    dest.fail = true;
+    EXPECT_TRUE(writer.AddRecord("x").IsIOError());
+    EXPECT_EQ(dest.contents.size(), writer.FileSize());
+
+    dest.fail = false;
+    ASSERT_TRUE(writer.AddRecord("y").ok());
+    EXPECT_EQ(dest.contents.size(), writer.FileSize());
+}
+
+} // namespace log
+} // namespace tinydb
@@ -1,55 +1,145 @@
 #include "db/log_writer.h"
 
+#include <cassert>
 #include <cstdint>
+
+#include "port/port.h"
 #include "tinydb/env.h"
+#include "util/coding.h"
+#include "util/crc32c.h"
 
 namespace tinydb {
 namespace log {
 
-Writer::Writer(WritableFile *dest) {
+// 预先计算每种记录类型的 crc，写记录时在其基础上 Extend 数据部分
+static void InitTypeCrc(uint32_t* type_crc) {
+    for (int i = 0; i <= kMaxRecordType; i++) {
+        char t = static_cast<char>(i);
+        type_crc[i] = crc32c::Value(&t, 1);
+    }
+}
+
+Writer::Writer(WritableFile *dest)
+        : dest_(dest),
+          block_offset_(0),
+          file_size_(0),
+          log_number_(0),
+          recycle_log_files_(false),
+          compress_ctx_(nullptr),
+          compression_type_written_(false) {
+    InitTypeCrc(type_crc_);
+}
+
+Writer::Writer(WritableFile *dest, uint64_t dest_length)
+        : dest_(dest),
+          block_offset_(dest_length % kBlockSize),
+          file_size_(dest_length),
+          log_number_(0),
+          recycle_log_files_(false),
+          compress_ctx_(nullptr),
+          compression_type_written_(false) {
+    InitTypeCrc(type_crc_);
 }
 
-Writer::Writer(WritableFile *dest, uint64_t dest_length) {
+Writer::Writer(WritableFile* dest, uint64_t log_number, bool recycle_log_files)
+        : Writer(dest, log_number, recycle_log_files, kNoCompression, 0) {}
+
+Writer::Writer(WritableFile* dest, uint64_t log_number, bool recycle_log_files,
+               CompressionType compression, int compression_level)
+        : dest_(dest),
+          block_offset_(0),
+          file_size_(0),
+          log_number_(log_number),
+          recycle_log_files_(recycle_log_files),
+          compress_ctx_(nullptr),
+          compression_type_written_(false) {
+    InitTypeCrc(type_crc_);
+    if (compression == kZstdCompression) {
+        compress_ctx_ = port::Zstd_CreateCStream(compression_level);
+    }
 }
 
-Writer::~Writer() = default;
+Writer::~Writer() {
+    if (compress_ctx_ != nullptr) {
+        port::Zstd_FreeCStream(compress_ctx_);
+    }
+}
+
+Status Writer::AddCompressionTypeRecord() {
+    const int header_size = recycle_log_files_ ? kRecyclableHeaderSize : kHeaderSize;
+    if (kBlockSize - block_offset_ < header_size + 1) {
+        // 记录很短，不值得跨块，直接从下一个块开始
+        Status s = dest_->Append(Slice("\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00",
+                                       kBlockSize - block_offset_));
+        if (!s.ok()) {
+            return s;
+        }
+        file_size_ += kBlockSize - block_offset_;
+        block_offset_ = 0;
+    }
+    const char type = static_cast<char>(kZstdCompression);
+    return EmitPhysicalRecord(
+            recycle_log_files_ ? kRecyclableSetCompressionType : kSetCompressionType,
+            &type, 1);
+}
 
 Status Writer::AddRecord(const tinydb::Slice &slice) {
     const char* ptr = slice.data();
     size_t left = slice.size();
 
+    if (compress_ctx_ != nullptr) {
+        if (!compression_type_written_) {
+            Status s = AddCompressionTypeRecord();
+            if (!s.ok()) {
+                return s;
+            }
+            compression_type_written_ = true;
+        }
+        compressed_.clear();
+        if (!port::Zstd_CompressStream(compress_ctx_, ptr, left, &compressed_)) {
+            return Status::IOError("log record compression failed");
+        }
+        ptr = compressed_.data();
+        left = compressed_.size();
+    }
+
     /*
      *  如果有必要，将记录进行分片并发出。注意，如果slice是空的，仍会迭代一次以发出单个零长度记录。
      */
     Status s;
     bool begin = true;
+    const int header_size = recycle_log_files_ ? kRecyclableHeaderSize : kHeaderSize;
     do {
         // leftover当前block还可以写数据的字节数
         const int leftover = kBlockSize - block_offset_;
         assert(leftover >= 0);
-        if (leftover < kHeaderSize) {
+        if (leftover < header_size) {
             if (leftover > 0) {
-                static_assert(kHeaderSize == 7, "");
-                dest_->Append(Slice("\x00\x00\x00\x00\x00\x00", leftover));
+                static_assert(kRecyclableHeaderSize == 11, "");
+                s = dest_->Append(Slice("\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00", leftover));
+                if (!s.ok()) {
+                    return s;
+                }
+                file_size_ += leftover;
             }
             block_offset_ = 0;
         }
 
-        assert(kBlockSize - block_offset_ - kHeaderSize >= 0);
+        assert(kBlockSize - block_offset_ - header_size >= 0);
         // 当前block剩余可写日志数据空间
-        const size_t avail = kBlockSize - block_offset_ - kHeaderSize;
+        const size_t avail = kBlockSize - block_offset_ - header_size;
 
         const size_t fragment_length = (left < avail) ? left: avail;
         RecordType type;
         const bool end = (left == fragment_length);
         if (begin && end) {
-            type = kFullType;
+            type = recycle_log_files_ ? kRecyclableFullType : kFullType;
         } else if (begin) {
-            type = kFirstType;
+            type = recycle_log_files_ ? kRecyclableFirstType : kFirstType;
         } else if (end) {
-            type = kLastTyep;
+            type = recycle_log_files_ ? kRecyclableLastType : kLastTyep;
         } else {
-            type = kMiddleType;
+            type = recycle_log_files_ ? kRecyclableMiddleType : kMiddleType;
         }
 
         s = EmitPhysicalRecord(type, ptr, fragment_length);
@@ -63,9 +153,37 @@ Status Writer::AddRecord(const tinydb::Slice &slice) {
 
 Status Writer::EmitPhysicalRecord(RecordType t, const char* ptr, size_t length) {
     assert(length <= 0xffff);  // Must fit in two bytes
-    assert(block_offset_ + kHeaderSize + length <= kBlockSize);
 
-    return Status::OK();
+    // 格式化记录头
+    char buf[kRecyclableHeaderSize];
+    buf[4] = static_cast<char>(length & 0xff);
+    buf[5] = static_cast<char>(length >> 8);
+    buf[6] = static_cast<char>(t);
+
+    // 计算记录类型、日志编号(如果有)和数据部分的 crc
+    size_t header_size = kHeaderSize;
+    uint32_t crc = type_crc_[t];
+    if (IsRecyclableType(t)) {
+        header_size = kRecyclableHeaderSize;
+        EncodeFixed32(buf + 7, static_cast<uint32_t>(log_number_));
+        crc = crc32c::Extend(crc, buf + 7, 4);
+    }
+    assert(block_offset_ + header_size + length <= kBlockSize);
+    crc = crc32c::Extend(crc, ptr, length);
+    crc = crc32c::Mask(crc);  // Adjust for storage
+    EncodeFixed32(buf, crc);
+
+    // 写记录头和数据
+    Status s = dest_->Append(Slice(buf, header_size));
+    if (s.ok()) {
+        s = dest_->Append(Slice(ptr, length));
+        if (s.ok()) {
+            s = dest_->Flush();
+        }
+    }
+    block_offset_ += header_size + length;
+    file_size_ += header_size + length;
+    return s;
 }
 
 
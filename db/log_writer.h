@@ -3,6 +3,9 @@
 
 #include <cstdint>
 
+#include <string>
+
+#include "tinydb/options.h"
 #include "tinydb/slice.h"
 #include "tinydb/status.h"
 #include "db/log_format.h"
@@ -19,6 +22,22 @@ public:
     explicit Writer(WritableFile* dest);
     Writer(WritableFile* dest, uint64_t dest_length);
 
+    /*
+     * 写编号为 log_number 的 WAL，dest 为空
+     * recycle_log_files 为 true 时使用带日志编号的记录格式，dest 可以是复用的旧 WAL 文件
+     * (见 Env::ReuseWritableFile())，读取时用日志编号识别出上一次使用时留下的数据
+     */
+    Writer(WritableFile* dest, uint64_t log_number, bool recycle_log_files);
+
+    /*
+     * 同上，compression 为 kZstdCompression 时压缩每条记录：第一条记录之前先写一条
+     * kSetCompressionType 记录，之后所有记录由同一个流式压缩器依次压缩，后面的记录可以
+     * 引用前面记录的内容，小的记录也能压缩得很好。当前平台不支持 Zstd，或者是其他压缩
+     * 算法(没有流式接口)时不压缩
+     */
+    Writer(WritableFile* dest, uint64_t log_number, bool recycle_log_files,
+           CompressionType compression, int compression_level);
+
     Writer(const Writer&) = delete;
     Writer& operator=(const Writer&) = delete;
 
@@ -26,12 +45,26 @@ public:
 
     Status AddRecord(const Slice& slice);
 
+    // 已经写入 dest 的字节数，包括记录头和块尾的填充
+    uint64_t FileSize() const { return file_size_; }
+
 private:
     Status EmitPhysicalRecord(RecordType type, const char* ptr, size_t length);
 
+    // 写 kSetCompressionType 记录
+    Status AddCompressionTypeRecord();
+
     WritableFile* dest_;
     int block_offset_;
+    uint64_t file_size_;
+    const uint64_t log_number_;
+    const bool recycle_log_files_;
     uint32_t type_crc_[kMaxRecordType + 1];
+
+    // 流式压缩器，不压缩时为 nullptr
+    void* compress_ctx_;
+    bool compression_type_written_;
+    std::string compressed_;
 };
 
 } // namespace log
@@ -0,0 +1,482 @@
+#include "db/memtable.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "db/dbformat.h"
+#include "db/merge_helper.h"
+#include "db/range_tombstone_fragmenter.h"
+#include "table/prefix_seek_iterator.h"
+#include "tinydb/comparator.h"
+#include "tinydb/iterator.h"
+#include "util/coding.h"
+#include "util/dynamic_bloom.h"
+#include "util/mutexlock.h"
+
+namespace tinydb {
+
+static Slice GetLengthPrefixedSlice(const char* data) {
+    uint32_t len;
+    const char* p = data;
+    p = GetVarint32Ptr(p, p + 5, &len);  // +5: we assume "p" is not corrupted
+    return Slice(p, len);
+}
+
+static MemTableRepFactory* DefaultRepFactory() {
+    static MemTableRepFactory* factory = NewSkipListRepFactory();
+    return factory;
+}
+
+MemTable::MemTable(const InternalKeyComparator& comparator)
+        : comparator_(comparator),
+          refs_(0),
+          table_(DefaultRepFactory()->CreateMemTableRep(comparator_, &arena_, nullptr)),
+          range_del_table_(DefaultRepFactory()->CreateMemTableRep(comparator_, &arena_,
+                                                                  nullptr)),
+          num_range_deletes_(0),
+          num_entries_(0),
+          fragmented_range_dels_(nullptr),
+          cached_range_dels_count_(0),
+          merge_operator_(nullptr),
+          prefix_extractor_(nullptr),
+          prefix_bloom_(nullptr) {}
+
+MemTable::MemTable(const InternalKeyComparator& comparator,
+                   const Options& options)
+        : comparator_(comparator),
+          refs_(0),
+          arena_(options.write_buffer_manager),
+          table_((options.memtable_factory != nullptr ? options.memtable_factory
+                                                      : DefaultRepFactory())
+                         ->CreateMemTableRep(comparator_, &arena_,
+                                             options.prefix_extractor)),
+          range_del_table_(DefaultRepFactory()->CreateMemTableRep(comparator_, &arena_,
+                                                                  nullptr)),
+          num_range_deletes_(0),
+          num_entries_(0),
+          fragmented_range_dels_(nullptr),
+          cached_range_dels_count_(0),
+          merge_operator_(options.merge_operator),
+          prefix_extractor_(nullptr),
+          prefix_bloom_(nullptr) {
+    if (options.prefix_extractor != nullptr) {
+        prefix_extractor_ = new InternalKeySliceTransform(options.prefix_extractor);
+        const size_t bloom_bits = static_cast<size_t>(
+                options.write_buffer_size * options.memtable_prefix_bloom_size_ratio * 8);
+        if (bloom_bits > 0) {
+            prefix_bloom_ = new DynamicBloom(&arena_, bloom_bits);
+        }
+    }
+}
+
+MemTable::~MemTable() {
+    assert(refs_ == 0);
+    delete table_;
+    delete range_del_table_;
+    delete fragmented_range_dels_.load(std::memory_order_relaxed);
+    delete prefix_bloom_;
+    delete prefix_extractor_;
+}
+
+bool MemTable::UserKeyMayMatch(const Slice& user_key) const {
+    if (prefix_bloom_ == nullptr) {
+        return true;
+    }
+    const SliceTransform* user_transform = prefix_extractor_->user_transform();
+    return !user_transform->InDomain(user_key) ||
+           prefix_bloom_->MayContain(user_transform->Transform(user_key));
+}
+
+bool MemTable::PrefixMayMatch(void* arg, const ReadOptions& options,
+                              const Slice& target) {
+    return reinterpret_cast<MemTable*>(arg)->UserKeyMayMatch(ExtractUserKey(target));
+}
+
+size_t MemTable::ApproximateMemoryUsage() {
+    return arena_.MemoryUsage() + table_->ApproximateMemoryUsage() +
+           range_del_table_->ApproximateMemoryUsage();
+}
+
+// Encode a suitable internal key target for "target" and return it.
+// Uses *scratch as scratch space, and the returned pointer will point
+// into this scratch space.
+static const char* EncodeKey(std::string* scratch, const Slice& target) {
+    scratch->clear();
+    PutVarint32(scratch, target.size());
+    scratch->append(target.data(), target.size());
+    return scratch->data();
+}
+
+class MemTableIterator : public Iterator {
+public:
+    // 接管 iter 的所有权
+    explicit MemTableIterator(MemTableRep::Iterator* iter) : iter_(iter) {}
+
+    MemTableIterator(const MemTableIterator&) = delete;
+    MemTableIterator& operator=(const MemTableIterator&) = delete;
+
+    ~MemTableIterator() override { delete iter_; }
+
+    bool Valid() const override { return iter_->Valid(); }
+    void Seek(const Slice& k) override { iter_->Seek(EncodeKey(&tmp_, k)); }
+    void SeekToFirst() override { iter_->SeekToFirst(); }
+    void SeekToLast() override { iter_->SeekToLast(); }
+    void Next() override { iter_->Next(); }
+    void Prev() override { iter_->Prev(); }
+    Slice key() const override { return GetLengthPrefixedSlice(iter_->key()); }
+    Slice value() const override {
+        Slice key_slice = GetLengthPrefixedSlice(iter_->key());
+        return GetLengthPrefixedSlice(key_slice.data() + key_slice.size());
+    }
+
+    Status status() const override { return Status::OK(); }
+
+private:
+    MemTableRep::Iterator* const iter_;
+    std::string tmp_;  // For passing to EncodeKey
+};
+
+Iterator* MemTable::NewIterator() {
+    return new MemTableIterator(table_->GetIterator());
+}
+
+Iterator* MemTable::NewIterator(const ReadOptions& options) {
+    if (prefix_extractor_ == nullptr || options.total_order_seek) {
+        return NewIterator();
+    }
+    // 前缀 seek 模式下按前缀分桶的实现只需要遍历一个桶
+    return NewPrefixSeekIterator(
+            new MemTableIterator(table_->GetDynamicPrefixIterator()),
+            prefix_extractor_,
+            prefix_bloom_ != nullptr ? &MemTable::PrefixMayMatch : nullptr, this,
+            options);
+}
+
+Iterator* MemTable::NewRangeTombstoneIterator() {
+    if (num_range_deletes_.load(std::memory_order_acquire) == 0) {
+        return nullptr;
+    }
+    return new MemTableIterator(range_del_table_->GetIterator());
+}
+
+void MemTable::MarkReadOnly() {
+    table_->MarkReadOnly();
+    arena_.MarkImmutable();
+    if (num_range_deletes_.load(std::memory_order_acquire) > 0 &&
+        fragmented_range_dels_.load(std::memory_order_relaxed) == nullptr) {
+        fragmented_range_dels_.store(FragmentRangeTombstones(), std::memory_order_release);
+        MutexLock l(&range_dels_mutex_);
+        cached_range_dels_.reset();
+    }
+}
+
+FragmentedRangeTombstoneList* MemTable::FragmentRangeTombstones() {
+    std::vector<RangeTombstone> tombstones;
+    Iterator* iter = NewRangeTombstoneIterator();
+    ReadRangeTombstones(iter, &tombstones);  // memtable 中的条目总是可以解析
+    delete iter;
+    return new FragmentedRangeTombstoneList(
+            tombstones, comparator_.comparator.user_comparator());
+}
+
+std::shared_ptr<const FragmentedRangeTombstoneList> MemTable::GetRangeTombstones() {
+    const int num = num_range_deletes_.load(std::memory_order_acquire);
+    if (num == 0) {
+        return nullptr;
+    }
+    const FragmentedRangeTombstoneList* list =
+            fragmented_range_dels_.load(std::memory_order_acquire);
+    if (list != nullptr) {
+        // 由 memtable 自己持有，返回不带引用计数的指针
+        return std::shared_ptr<const FragmentedRangeTombstoneList>(
+                std::shared_ptr<const FragmentedRangeTombstoneList>(), list);
+    }
+    // 缓存中至少有前 num 个 range tombstone 时可以直接用，多出来的是更新的写入，
+    // 查找时按序列号过滤
+    MutexLock l(&range_dels_mutex_);
+    if (cached_range_dels_ == nullptr || cached_range_dels_count_ < num) {
+        cached_range_dels_.reset(FragmentRangeTombstones());
+        cached_range_dels_count_ = num;
+    }
+    return cached_range_dels_;
+}
+
+void MemTable::Add(SequenceNumber s, ValueType type, const Slice& key,
+                   const Slice& value) {
+    // Format of an entry is concatenation of:
+    //  key_size     : varint32 of internal_key.size()
+    //  key bytes    : char[internal_key.size()]
+    //  tag          : uint64((sequence << 8) | type)
+    //  value_size   : varint32 of value.size()
+    //  value bytes  : char[value.size()]
+    size_t key_size = key.size();
+    size_t val_size = value.size();
+    size_t internal_key_size = key_size + 8;
+    const size_t encoded_len = VarintLength(internal_key_size) +
+                               internal_key_size + VarintLength(val_size) +
+                               val_size;
+    char* buf = (type == kTypeRangeDeletion ? range_del_table_ : table_)
+                        ->Allocate(encoded_len);
+    char* p = EncodeVarint32(buf, internal_key_size);
+    std::memcpy(p, key.data(), key_size);
+    p += key_size;
+    EncodeFixed64(p, (s << 8) | type);
+    p += 8;
+    p = EncodeVarint32(p, val_size);
+    std::memcpy(p, value.data(), val_size);
+    assert(p + val_size == buf + encoded_len);
+    num_entries_.fetch_add(1, std::memory_order_relaxed);
+    if (type == kTypeRangeDeletion) {
+        range_del_table_->Insert(buf);
+        num_range_deletes_.fetch_add(1, std::memory_order_release);
+        return;
+    }
+    if (prefix_bloom_ != nullptr) {
+        const SliceTransform* user_transform = prefix_extractor_->user_transform();
+        if (user_transform->InDomain(key)) {
+            prefix_bloom_->Add(user_transform->Transform(key));
+        }
+    }
+    table_->Insert(buf);
+}
+
+namespace {
+
+// 一个 key 的查找状态
+struct Saver {
+    const Comparator* user_comparator;
+    const MergeOperator* merge_operator;
+    const LookupKey* key;
+    std::string* value;
+    Status* status;
+    MergeContext* merge_context;
+    // 覆盖 key 且对查找可见的 range tombstone 的序列号，没有时为 0
+    // 序列号更小的条目都当作已经删除
+    SequenceNumber tombstone_seq;
+    bool found;
+};
+
+// 查找的快照序列号
+SequenceNumber LookupSequence(const LookupKey& key) {
+    const Slice ikey = key.internal_key();
+    return DecodeFixed64(ikey.data() + ikey.size() - 8) >> 8;
+}
+
+// 找到了值(existing_value)或者删除记录(nullptr)，与已经收集到的操作数合并出结果
+void SaveResult(Saver* saver, const Slice* existing_value) {
+    saver->found = true;
+    if (saver->merge_context->empty()) {
+        if (existing_value != nullptr) {
+            saver->value->assign(existing_value->data(), existing_value->size());
+        } else {
+            *saver->status = Status::NotFound(Slice());
+        }
+        return;
+    }
+    *saver->status = FullMergeOperands(saver->merge_operator, saver->key->user_key(),
+                                       existing_value,
+                                       saver->merge_context->GetOperandsOldestFirst(),
+                                       saver->value);
+    saver->merge_context->Clear();
+}
+
+// 处理一个 >= key 的条目，返回是否还需要继续看下一个(更旧的)条目
+bool SaveValue(Saver* saver, const char* entry) {
+    // entry format is:
+    //    klength  varint32
+    //    userkey  char[klength]
+    //    tag      uint64
+    //    vlength  varint32
+    //    value    char[vlength]
+    // Check that it belongs to same user key.  We do not check the
+    // sequence number since the Seek() call above should have skipped
+    // all entries with overly large sequence numbers.
+    uint32_t key_length;
+    const char* key_ptr = GetVarint32Ptr(entry, entry + 5, &key_length);
+    if (saver->user_comparator->Compare(Slice(key_ptr, key_length - 8),
+                                        saver->key->user_key()) != 0) {
+        return false;
+    }
+    // Correct user key
+    const uint64_t tag = DecodeFixed64(key_ptr + key_length - 8);
+    if ((tag >> 8) < saver->tombstone_seq) {
+        // 被 range tombstone 删除
+        SaveResult(saver, nullptr);
+        return false;
+    }
+    const Slice v = GetLengthPrefixedSlice(key_ptr + key_length);
+    switch (static_cast<ValueType>(tag & 0xff)) {
+        case kTypeValue:
+            SaveResult(saver, &v);
+            return false;
+        case kTypeDeletion:
+            SaveResult(saver, nullptr);
+            return false;
+        case kTypeMerge:
+            if (saver->merge_operator == nullptr) {
+                saver->found = true;
+                *saver->status = FullMergeOperands(nullptr, saver->key->user_key(),
+                                                   nullptr, std::vector<Slice>(),
+                                                   saver->value);
+                return false;
+            }
+            saver->merge_context->PushOperand(v);
+            return true;
+        case kTypeBlobIndex:
+            // blob 引用只在 flush/compaction 时产生
+            assert(false);
+            break;
+        case kTypeRangeDeletion:
+            // range tombstone 存放在 range_del_table_ 中
+            assert(false);
+            break;
+    }
+    return false;
+}
+
+// memtable 中的条目都看完之后调用
+// own_context 为 true 表示没有更旧的数据，只有操作数时把它们作用到不存在的值上
+void FinishLookup(Saver* saver, bool own_context) {
+    if (saver->found) {
+        return;
+    }
+    if (saver->tombstone_seq > 0 ||
+        (own_context && !saver->merge_context->empty())) {
+        SaveResult(saver, nullptr);
+    }
+}
+
+bool GetCallback(void* arg, const char* entry) {
+    return SaveValue(reinterpret_cast<Saver*>(arg), entry);
+}
+
+} // namespace
+
+bool MemTable::Get(const LookupKey& key, std::string* value, Status* s,
+                   MergeContext* merge_context) {
+    MergeContext local_context;
+    std::shared_ptr<const FragmentedRangeTombstoneList> list = GetRangeTombstones();
+    Saver saver = {comparator_.comparator.user_comparator(),
+                   merge_operator_,
+                   &key,
+                   value,
+                   s,
+                   merge_context != nullptr ? merge_context : &local_context,
+                   list != nullptr ? list->MaxCoveringTombstoneSeqnum(
+                                             key.user_key(), LookupSequence(key))
+                                   : 0,
+                   false};
+    if (UserKeyMayMatch(key.user_key())) {
+        table_->Get(key, &saver, &GetCallback);
+    }
+    FinishLookup(&saver, merge_context == nullptr);
+    return saver.found;
+}
+
+void MemTable::MultiGet(const LookupKey* const* keys, int n,
+                        std::string* values, Status* statuses, bool* found,
+                        MergeContext* merge_contexts) {
+    // 向后走这么多步还没有到达目标时，改用 Seek
+    static const int kMaxSteps = 8;
+
+    if (!table_->IsOrdered()) {
+        // 有序扫描需要先把所有条目排序，不如逐个查找
+        for (int i = 0; i < n; i++) {
+            found[i] = Get(*keys[i], &values[i], &statuses[i],
+                           merge_contexts != nullptr ? &merge_contexts[i] : nullptr);
+        }
+        return;
+    }
+
+    std::vector<int> order(n);
+    for (int i = 0; i < n; i++) {
+        order[i] = i;
+    }
+    const InternalKeyComparator& icmp = comparator_.comparator;
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+        return icmp.Compare(keys[a]->internal_key(), keys[b]->internal_key()) < 0;
+    });
+
+    // 所有 key 共用一次切分的结果
+    std::vector<MergeContext> local_contexts(merge_contexts != nullptr ? 0 : n);
+    std::shared_ptr<const FragmentedRangeTombstoneList> list = GetRangeTombstones();
+    std::vector<Saver> savers(n);
+    for (int i = 0; i < n; i++) {
+        Saver& saver = savers[i];
+        saver.user_comparator = icmp.user_comparator();
+        saver.merge_operator = merge_operator_;
+        saver.key = keys[i];
+        saver.value = &values[i];
+        saver.status = &statuses[i];
+        saver.merge_context =
+                merge_contexts != nullptr ? &merge_contexts[i] : &local_contexts[i];
+        saver.tombstone_seq =
+                list != nullptr ? list->MaxCoveringTombstoneSeqnum(
+                                          keys[i]->user_key(), LookupSequence(*keys[i]))
+                                : 0;
+        saver.found = false;
+    }
+
+    MemTableRep::Iterator* iter = table_->GetIterator();
+    bool positioned = false;
+    int prev = -1;
+    std::vector<int> duplicate_of(n, -1);
+    for (int j = 0; j < n; j++) {
+        const int i = order[j];
+        const LookupKey& key = *keys[i];
+        if (prev >= 0 && icmp.Compare(keys[prev]->internal_key(),
+                                      key.internal_key()) == 0) {
+            // 重复的 key 最后直接复用上一个结果
+            duplicate_of[i] = prev;
+            continue;
+        }
+        prev = i;
+        if (!UserKeyMayMatch(key.user_key())) {
+            // 前缀不在 bloom filter 中，不需要移动迭代器
+            continue;
+        }
+
+        const char* target = key.memtable_key().data();
+        if (!positioned) {
+            iter->Seek(target);
+            positioned = true;
+        } else if (iter->Valid() && comparator_(iter->key(), target) < 0) {
+            // 迭代器位于上一个 key 的位置，而 keys 是有序的，只可能需要往后走
+            int steps = 0;
+            do {
+                iter->Next();
+            } while (++steps < kMaxSteps && iter->Valid() &&
+                     comparator_(iter->key(), target) < 0);
+            if (iter->Valid() && comparator_(iter->key(), target) < 0) {
+                iter->Seek(target);
+            }
+        }
+        while (iter->Valid() && SaveValue(&savers[i], iter->key())) {
+            // merge 操作数：继续看更旧的版本，之后的 key 可能在当前位置之前，需要重新 Seek
+            iter->Next();
+            positioned = false;
+        }
+    }
+    delete iter;
+
+    for (int i = 0; i < n; i++) {
+        if (duplicate_of[i] < 0) {
+            FinishLookup(&savers[i], merge_contexts == nullptr);
+            found[i] = savers[i].found;
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        const int d = duplicate_of[i];
+        if (d >= 0) {
+            found[i] = found[d];
+            values[i] = values[d];
+            statuses[i] = statuses[d];
+            if (merge_contexts != nullptr) {
+                merge_contexts[i] = merge_contexts[d];
+            }
+        }
+    }
+}
+
+} // namespace tinydb
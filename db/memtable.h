@@ -0,0 +1,152 @@
+#ifndef STORAGE_TINYDB_DB_MEMTABLE_H_
+#define STORAGE_TINYDB_DB_MEMTABLE_H_
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include "db/dbformat.h"
+#include "db/memtable_rep.h"
+#include "port/port.h"
+#include "port/thread_annotations.h"
+#include "tinydb/iterator.h"
+#include "tinydb/options.h"
+#include "util/arena.h"
+
+namespace tinydb {
+
+class DynamicBloom;
+class FragmentedRangeTombstoneList;
+class InternalKeyComparator;
+class MemTableIterator;
+class MergeContext;
+
+class MemTable {
+public:
+    // MemTable 是引用计数的，初始引用计数为 0，调用者至少要调用一次 Ref()
+    explicit MemTable(const InternalKeyComparator& comparator);
+
+    // 按 options 创建 memtable：内部数据结构由 memtable_factory 创建。设置了 prefix_extractor 和 memtable_prefix_bloom_size_ratio 时
+    // 维护一个 user key 前缀的 bloom filter，Get() 和前缀 seek 先用它排除不存在的前缀
+    MemTable(const InternalKeyComparator& comparator, const Options& options);
+
+    MemTable(const MemTable&) = delete;
+    MemTable& operator=(const MemTable&) = delete;
+
+    // Increase reference count.
+    void Ref() { ++refs_; }
+
+    // Drop reference count.  Delete if no more references exist.
+    void Unref() {
+        --refs_;
+        assert(refs_ >= 0);
+        if (refs_ <= 0) {
+            delete this;
+        }
+    }
+
+    // 返回该 memtable 使用的内存大小的估计值，在修改 memtable 的同时调用也是安全的
+    size_t ApproximateMemoryUsage();
+
+    // 写入的条目数(包括 range tombstone)，在修改 memtable 的同时调用也是安全的
+    uint64_t NumEntries() const { return num_entries_.load(std::memory_order_relaxed); }
+
+    // 返回遍历 memtable 内容的迭代器
+    // 迭代器使用期间调用者必须保证 memtable 一直有效，
+    // 迭代器返回的 key 是 internal key(见 db/dbformat.{h,cc})
+    Iterator* NewIterator();
+
+    // 同 NewIterator()，设置了 prefix_extractor 且没有要求 total_order_seek 时
+    // 是前缀 seek 模式的迭代器(见 table/prefix_seek_iterator.h)
+    Iterator* NewIterator(const ReadOptions& options);
+
+    // 返回遍历 range tombstone 的迭代器(格式见 db/range_tombstone_fragmenter.h)，
+    // 没有 range tombstone 时返回 nullptr。flush 时与 NewIterator() 一起写入 table
+    Iterator* NewRangeTombstoneIterator();
+
+    // 添加一条记录：序列号为 seq、类型为 type 的 key 映射到 value
+    // type == kTypeDeletion 时 value 通常为空
+    // type == kTypeRangeDeletion 时删除 [key, value) 中的所有 key，只写入一个条目，
+    // 单独存放，不影响普通条目的查找和遍历
+    void Add(SequenceNumber seq, ValueType type, const Slice& key,
+             const Slice& value);
+
+    /*
+     * 包含 key 的值时把值存到 *value 并返回 true
+     * 包含 key 的删除记录，或者 key 被对查找可见的 range tombstone 覆盖时，
+     * 把 NotFound() 存到 *status 并返回 true，此时更旧的数据都不可见
+     * 否则返回 false
+     *
+     * 遇到 merge 操作数时加入 *merge_context 并继续查找更旧的版本，找到值或者删除记录时
+     * 用 Options::merge_operator 与 *merge_context 中的操作数(包括更新的数据源中已经收集到的)
+     * 合并出结果，合并失败时把错误存到 *status。只有操作数时返回 false，调用者继续在更旧的
+     * 数据中查找。merge_context 为 nullptr 表示没有更旧的数据，只有操作数时直接合并
+     */
+    bool Get(const LookupKey& key, std::string* value, Status* s,
+             MergeContext* merge_context = nullptr);
+
+    /*
+     * 批量查找 keys[0,n-1]，keys 可以是任意顺序，可以有重复
+     * 结果与对每个 i 调用 found[i] = Get(*keys[i], &values[i], &statuses[i],
+     * &merge_contexts[i]) 相同，merge_contexts 为 nullptr 时对每个 key 都传入 nullptr
+     *
+     * 先按 internal key 排序，再用同一个迭代器从前往后扫一遍：
+     * 下一个 key 离当前位置很近时直接向后走几步，否则才重新 Seek
+     * 内部数据结构不是有序存放时(见 MemTableRep::IsOrdered())逐个调用 Get()
+     */
+    void MultiGet(const LookupKey* const* keys, int n, std::string* values,
+                  Status* statuses, bool* found,
+                  MergeContext* merge_contexts = nullptr);
+
+    // memtable 变为只读时调用，之后不会再有 Add()
+    // 此时把 range tombstone 切分一次，之后的查找都复用它，不再需要加锁
+    void MarkReadOnly();
+
+private:
+    friend class MemTableIterator;
+
+    ~MemTable();  // Private since only Unref() should be used to delete it
+
+    // user_key 的前缀不在 bloom filter 中时返回 false
+    bool UserKeyMayMatch(const Slice& user_key) const;
+
+    // 返回切分后的 range tombstone，没有时返回 nullptr
+    // 还可以写入时复用上一次切分的结果，加入新的 range tombstone 之后才重新切分
+    std::shared_ptr<const FragmentedRangeTombstoneList> GetRangeTombstones();
+
+    // 把当前所有的 range tombstone 切分一次
+    FragmentedRangeTombstoneList* FragmentRangeTombstones();
+
+    // 前缀 seek：memtable 中是否可能有与 internal key target 前缀相同的 key
+    static bool PrefixMayMatch(void* arg, const ReadOptions& options,
+                               const Slice& target);
+
+    MemTableKeyComparator comparator_;
+    int refs_;
+    Arena arena_;
+    MemTableRep* const table_;
+
+    // range tombstone 单独存放在一个跳表中，key 是起点，value 是终点
+    MemTableRep* const range_del_table_;
+    std::atomic<int> num_range_deletes_;
+    std::atomic<uint64_t> num_entries_;
+    // MarkReadOnly() 之后才有
+    std::atomic<FragmentedRangeTombstoneList*> fragmented_range_dels_;
+    // 还可以写入时缓存的切分结果，以及切分时已经有的 range tombstone 个数
+    port::Mutex range_dels_mutex_;
+    std::shared_ptr<const FragmentedRangeTombstoneList> cached_range_dels_
+            GUARDED_BY(range_dels_mutex_);
+    int cached_range_dels_count_ GUARDED_BY(range_dels_mutex_);
+
+    // 没有设置时遇到 merge 操作数返回 InvalidArgument
+    const MergeOperator* const merge_operator_;
+
+    // 没有设置 prefix_extractor 时为 nullptr
+    const InternalKeySliceTransform* prefix_extractor_;
+    // 前缀 bloom filter，内存从 arena_ 分配，没有启用时为 nullptr
+    DynamicBloom* prefix_bloom_;
+};
+
+} // namespace tinydb
+
+#endif  // STORAGE_TINYDB_DB_MEMTABLE_H_
@@ -0,0 +1,123 @@
+#include "db/memtable_rep.h"
+
+#include <algorithm>
+
+#include "util/coding.h"
+
+namespace tinydb {
+
+Slice GetMemTableEntryKey(const char* entry) {
+    uint32_t len;
+    const char* p = GetVarint32Ptr(entry, entry + 5, &len);  // +5: we assume "p" is not corrupted
+    return Slice(p, len);
+}
+
+int MemTableKeyComparator::operator()(const char* aptr, const char* bptr) const {
+    // Internal keys are encoded as length-prefixed strings.
+    return comparator.Compare(GetMemTableEntryKey(aptr), GetMemTableEntryKey(bptr));
+}
+
+MemTableRepFactory::~MemTableRepFactory() = default;
+
+MemTableRep::~MemTableRep() = default;
+
+MemTableRep::Iterator::~Iterator() = default;
+
+void MemTableRep::Get(const LookupKey& k, void* arg,
+                      bool (*callback)(void* arg, const char* entry)) {
+    Iterator* iter = GetDynamicPrefixIterator();
+    for (iter->Seek(k.memtable_key().data());
+         iter->Valid() && (*callback)(arg, iter->key()); iter->Next()) {
+    }
+    delete iter;
+}
+
+namespace {
+
+class SortedEntryIterator : public MemTableRep::Iterator {
+public:
+    // owned 非空时析构时删除它，entries 指向它的内容
+    SortedEntryIterator(const char* const* entries, size_t n,
+                        const MemTableKeyComparator& cmp,
+                        std::vector<const char*>* owned)
+        : entries_(entries), n_(n), cmp_(cmp), owned_(owned), pos_(n) {}
+
+    ~SortedEntryIterator() override { delete owned_; }
+
+    bool Valid() const override { return pos_ < n_; }
+    const char* key() const override {
+        assert(Valid());
+        return entries_[pos_];
+    }
+    void Next() override {
+        assert(Valid());
+        pos_++;
+    }
+    void Prev() override {
+        assert(Valid());
+        pos_ = (pos_ == 0) ? n_ : pos_ - 1;
+    }
+    void Seek(const char* memtable_key) override {
+        pos_ = std::lower_bound(entries_, entries_ + n_, memtable_key,
+                                [this](const char* a, const char* b) {
+                                    return cmp_(a, b) < 0;
+                                }) -
+               entries_;
+    }
+    void SeekToFirst() override { pos_ = 0; }
+    void SeekToLast() override { pos_ = (n_ == 0) ? 0 : n_ - 1; }
+
+private:
+    const char* const* const entries_;
+    const size_t n_;
+    const MemTableKeyComparator& cmp_;
+    std::vector<const char*>* const owned_;
+    size_t pos_;
+};
+
+class SkipListRep : public MemTableRep {
+public:
+    SkipListRep(const MemTableKeyComparator& cmp, Arena* arena)
+        : MemTableRep(arena), list_(cmp, arena) {}
+
+    void Insert(const char* entry) override { list_.Insert(entry); }
+
+    void Get(const LookupKey& k, void* arg,
+             bool (*callback)(void* arg, const char* entry)) override {
+        EntrySkipList::Iterator iter(&list_);
+        for (iter.Seek(k.memtable_key().data());
+             iter.Valid() && (*callback)(arg, iter.key()); iter.Next()) {
+        }
+    }
+
+    Iterator* GetIterator() override { return new EntrySkipListIterator(&list_); }
+
+private:
+    EntrySkipList list_;
+};
+
+class SkipListRepFactory : public MemTableRepFactory {
+public:
+    const char* Name() const override { return "SkipListRepFactory"; }
+
+    MemTableRep* CreateMemTableRep(const MemTableKeyComparator& cmp, Arena* arena,
+                                   const SliceTransform* prefix_extractor) override {
+        return new SkipListRep(cmp, arena);
+    }
+};
+
+} // namespace
+
+MemTableRep::Iterator* NewSortedEntryIterator(std::vector<const char*>* entries,
+                                              const MemTableKeyComparator& cmp) {
+    return new SortedEntryIterator(entries->data(), entries->size(), cmp, entries);
+}
+
+MemTableRep::Iterator* NewSortedArrayIterator(const char* const* entries, size_t n,
+                                              const MemTableKeyComparator& cmp) {
+    return new SortedEntryIterator(entries, n, cmp, nullptr);
+}
+
+MemTableRepFactory* NewSkipListRepFactory() { return new SkipListRepFactory; }
+
+} // namespace tinydb
@@ -0,0 +1,132 @@
+#ifndef STORAGE_TINYDB_DB_MEMTABLE_REP_H_
+#define STORAGE_TINYDB_DB_MEMTABLE_REP_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "db/dbformat.h"
+#include "db/skiplist.h"
+#include "tinydb/memtable_rep.h"
+#include "util/arena.h"
+
+namespace tinydb {
+
+/*
+ * memtable 条目的比较器
+ * 条目的格式见 MemTable::Add()，开头是 varint32 长度前缀的 internal key
+ */
+class MemTableKeyComparator {
+public:
+    explicit MemTableKeyComparator(const InternalKeyComparator& c) : comparator(c) {}
+
+    int operator()(const char* a, const char* b) const;
+
+    const InternalKeyComparator comparator;
+};
+
+// 解码条目开头的 internal key
+Slice GetMemTableEntryKey(const char* entry);
+
+/*
+ * memtable 内部存放条目的数据结构
+ * 条目的内存由调用者通过 Allocate() 从 arena 分配并填好，再调用 Insert()
+ *
+ * 同一时刻只能有一个线程调用 Insert()，其他方法可以与 Insert() 并发调用
+ * 析构时不释放条目的内存，它们随 arena 一起释放
+ */
+class MemTableRep {
+public:
+    explicit MemTableRep(Arena* arena) : arena_(arena) {}
+
+    MemTableRep(const MemTableRep&) = delete;
+    MemTableRep& operator=(const MemTableRep&) = delete;
+
+    virtual ~MemTableRep();
+
+    // 分配一个 len 字节的条目
+    char* Allocate(size_t len) { return arena_->Allocate(len); }
+
+    // REQUIRES: 没有与 entry 相等的条目
+    virtual void Insert(const char* entry) = 0;
+
+    // memtable 变为只读(immutable)时调用，之后不会再有 Insert()
+    virtual void MarkReadOnly() {}
+
+    /*
+     * 从第一个 >= k 的条目开始按顺序对每个条目调用 (*callback)(arg, entry)，
+     * 直到 callback 返回 false 或者没有更多条目。只保证 user key 与 k 相同的条目
+     * 是按顺序给出的，callback 在 user key 不同时应当返回 false
+     */
+    virtual void Get(const LookupKey& k, void* arg,
+                     bool (*callback)(void* arg, const char* entry));
+
+    // 条目当前是否有序存放。为 false 时全序迭代器需要先把所有条目排序，开销很大
+    virtual bool IsOrdered() const { return true; }
+
+    // 没有从 arena 分配的额外内存
+    virtual size_t ApproximateMemoryUsage() { return 0; }
+
+    // 遍历条目的迭代器，key() 返回条目的开头
+    class Iterator {
+    public:
+        Iterator() = default;
+        Iterator(const Iterator&) = delete;
+        Iterator& operator=(const Iterator&) = delete;
+        virtual ~Iterator();
+
+        virtual bool Valid() const = 0;
+        // REQUIRES: Valid()
+        virtual const char* key() const = 0;
+        // REQUIRES: Valid()
+        virtual void Next() = 0;
+        // REQUIRES: Valid()
+        virtual void Prev() = 0;
+        // 定位到第一个 >= memtable_key 的条目，memtable_key 是长度前缀编码的 internal key
+        virtual void Seek(const char* memtable_key) = 0;
+        virtual void SeekToFirst() = 0;
+        virtual void SeekToLast() = 0;
+    };
+
+    // 全序迭代器。不一直有序存放的实现返回创建时所有条目排好序的快照
+    virtual Iterator* GetIterator() = 0;
+
+    /*
+     * 前缀 seek 模式使用的迭代器：Seek() 只保证与目标前缀相同的条目是按顺序给出的
+     * 按前缀分桶的实现只遍历目标所在的桶，不需要排序
+     */
+    virtual Iterator* GetDynamicPrefixIterator() { return GetIterator(); }
+
+protected:
+    Arena* const arena_;
+};
+
+typedef SkipList<const char*, const MemTableKeyComparator&> EntrySkipList;
+
+// 遍历一个存放条目的跳表，跳表实现和按桶存放跳表的实现共用
+class EntrySkipListIterator : public MemTableRep::Iterator {
+public:
+    explicit EntrySkipListIterator(const EntrySkipList* list) : iter_(list) {}
+
+    bool Valid() const override { return iter_.Valid(); }
+    const char* key() const override { return iter_.key(); }
+    void Next() override { iter_.Next(); }
+    void Prev() override { iter_.Prev(); }
+    void Seek(const char* memtable_key) override { iter_.Seek(memtable_key); }
+    void SeekToFirst() override { iter_.SeekToFirst(); }
+    void SeekToLast() override { iter_.SeekToLast(); }
+
+private:
+    EntrySkipList::Iterator iter_;
+};
+
+// 返回遍历 *entries 的迭代器，*entries 必须已经按 cmp 排好序，迭代器接管它的所有权
+MemTableRep::Iterator* NewSortedEntryIterator(std::vector<const char*>* entries,
+                                              const MemTableKeyComparator& cmp);
+
+// 同上，但不接管 entries[0,n-1] 的所有权，迭代器使用期间它必须一直有效
+MemTableRep::Iterator* NewSortedArrayIterator(const char* const* entries, size_t n,
+                                              const MemTableKeyComparator& cmp);
+
+} // namespace tinydb
+
+#endif  // STORAGE_TINYDB_DB_MEMTABLE_REP_H_
@@ -0,0 +1,370 @@
+#include "db/memtable.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "db/dbformat.h"
+#include "gtest/gtest.h"
+#include "tinydb/comparator.h"
+#include "tinydb/memtable_rep.h"
+#include "tinydb/slice_transform.h"
+#include "util/random.h"
+
+namespace tinydb {
+
+namespace {
+
+std::string Key(int i) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "key%08d", i);
+    return buf;
+}
+
+} // namespace
+
+class MemTableTest : public testing::Test {
+public:
+    MemTableTest() : icmp_(BytewiseComparator()), mem_(nullptr) {}
+
+    ~MemTableTest() override {
+        if (mem_ != nullptr) mem_->Unref();
+    }
+
+    void NewMemTable(MemTableRepFactory* factory) {
+        factory_.reset(factory);
+        options_.memtable_factory = factory;
+        mem_ = new MemTable(icmp_, options_);
+        mem_->Ref();
+    }
+
+    // 读取序列号不大于 seq 的最新版本，不存在或者已删除时为 "NOT_FOUND"
+    std::string Get(const std::string& key, SequenceNumber seq = kMaxSequenceNumber) {
+        LookupKey lkey(key, seq);
+        std::string value;
+        Status s;
+        if (!mem_->Get(lkey, &value, &s)) {
+            return "NOT_FOUND";
+        }
+        return s.ok() ? value : (s.IsNotFound() ? "NOT_FOUND" : s.ToString());
+    }
+
+    // 按顺序检查 memtable 中的所有 user key
+    void CheckOrdered(int expected_entries) {
+        Iterator* iter = mem_->NewIterator();
+        int count = 0;
+        std::string prev;
+        for (iter->SeekToFirst(); iter->Valid(); iter->Next(), count++) {
+            if (count > 0) {
+                ASSERT_LT(icmp_.Compare(prev, iter->key()), 0);
+            }
+            prev = iter->key().ToString();
+        }
+        EXPECT_EQ(expected_entries, count);
+        delete iter;
+    }
+
+    InternalKeyComparator icmp_;
+    Options options_;
+    std::unique_ptr<MemTableRepFactory> factory_;
+    MemTable* mem_;
+};
+
+TEST_F(MemTableTest, VectorRep) {
+    NewMemTable(NewVectorRepFactory(4));
+    const int kNum = 50000;
+    std::vector<int> order(kNum);
+    for (int i = 0; i < kNum; i++) order[i] = i;
+    Random rnd(301);
+    for (int i = kNum - 1; i > 0; i--) {
+        std::swap(order[i], order[rnd.Uniform(i + 1)]);
+    }
+
+    SequenceNumber seq = 0;
+    for (int i : order) {
+        mem_->Add(++seq, kTypeValue, Key(i), "v1." + Key(i));
+    }
+    // 偶数 key 再写一个新版本，3 的倍数删除
+    const SequenceNumber before_overwrite = seq;
+    for (int i : order) {
+        if (i % 2 == 0) mem_->Add(++seq, kTypeValue, Key(i), "v2." + Key(i));
+        if (i % 3 == 0) mem_->Add(++seq, kTypeDeletion, Key(i), "");
+    }
+    const int entries = static_cast<int>(seq);
+    EXPECT_EQ(seq, mem_->NumEntries());
+
+    // 可写期间线性扫描
+    EXPECT_EQ("v2." + Key(2), Get(Key(2)));
+    EXPECT_EQ("v1." + Key(2), Get(Key(2), before_overwrite));
+    EXPECT_EQ("NOT_FOUND", Get(Key(3)));
+    EXPECT_EQ("NOT_FOUND", Get("missing"));
+
+    mem_->MarkReadOnly();
+    CheckOrdered(entries);
+    // 重复调用没有影响
+    mem_->MarkReadOnly();
+    for (int i = 0; i < kNum; i += 7) {
+        std::string expected;
+        if (i % 3 == 0) {
+            expected = "NOT_FOUND";
+        } else {
+            expected = (i % 2 == 0 ? "v2." : "v1.") + Key(i);
+        }
+        ASSERT_EQ(expected, Get(Key(i))) << i;
+        ASSERT_EQ("v1." + Key(i), Get(Key(i), before_overwrite)) << i;
+    }
+    EXPECT_EQ("NOT_FOUND", Get("missing"));
+    EXPECT_EQ("NOT_FOUND", Get(Key(kNum)));
+}
+
+TEST_F(MemTableTest, VectorRepEmpty) {
+    NewMemTable(NewVectorRepFactory(2));
+    mem_->MarkReadOnly();
+    CheckOrdered(0);
+    EXPECT_EQ("NOT_FOUND", Get("a"));
+}
+
+TEST_F(MemTableTest, RangeDeletion) {
+    NewMemTable(NewSkipListRepFactory());
+    mem_->Add(1, kTypeValue, "a", "va");
+    mem_->Add(2, kTypeValue, "b", "vb");
+    mem_->Add(3, kTypeValue, "c", "vc");
+    EXPECT_EQ("vb", Get("b"));
+
+    // 可写期间缓存切分结果，加入新的 tombstone 之后重新切分
+    mem_->Add(4, kTypeRangeDeletion, "b", "c");
+    EXPECT_EQ("va", Get("a"));
+    EXPECT_EQ("NOT_FOUND", Get("b"));
+    EXPECT_EQ("vc", Get("c"));
+    EXPECT_EQ("vb", Get("b", 3));
+
+    mem_->Add(5, kTypeRangeDeletion, "a", "z");
+    EXPECT_EQ("NOT_FOUND", Get("a"));
+    EXPECT_EQ("NOT_FOUND", Get("c"));
+    EXPECT_EQ("vc", Get("c", 4));
+
+    // tombstone 之后的写入可见
+    mem_->Add(6, kTypeValue, "c", "vc2");
+    EXPECT_EQ("vc2", Get("c"));
+    EXPECT_EQ(6u, mem_->NumEntries());
+
+    mem_->MarkReadOnly();
+    EXPECT_EQ("NOT_FOUND", Get("a"));
+    EXPECT_EQ("NOT_FOUND", Get("b"));
+    EXPECT_EQ("vc2", Get("c"));
+    EXPECT_EQ("vb", Get("b", 3));
+
+    // range tombstone 不出现在普通迭代器中，单独遍历
+    CheckOrdered(4);
+    Iterator* iter = mem_->NewRangeTombstoneIterator();
+    ASSERT_NE(nullptr, iter);
+    int count = 0;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+        count++;
+    }
+    EXPECT_EQ(2, count);
+    delete iter;
+}
+
+TEST_F(MemTableTest, MultiGet) {
+    for (int vector_rep = 0; vector_rep < 2; vector_rep++) {
+        if (mem_ != nullptr) mem_->Unref();
+        NewMemTable(vector_rep ? NewVectorRepFactory(2) : NewSkipListRepFactory());
+        const int kNum = 2000;
+        SequenceNumber seq = 0;
+        for (int i = 0; i < kNum; i += 2) {
+            mem_->Add(++seq, kTypeValue, Key(i), "v1." + Key(i));
+        }
+        const SequenceNumber before_overwrite = seq;
+        for (int i = 0; i < kNum; i += 6) {
+            mem_->Add(++seq, kTypeValue, Key(i), "v2." + Key(i));
+            mem_->Add(++seq, kTypeDeletion, Key(i + 2), "");
+        }
+        mem_->Add(++seq, kTypeRangeDeletion, Key(100), Key(120));
+
+        for (int read_only = 0; read_only < 2; read_only++) {
+            if (read_only) mem_->MarkReadOnly();
+            // 任意顺序，包括重复的 key 和不同的快照
+            Random rnd(301 + read_only);
+            std::vector<LookupKey*> lkeys;
+            std::vector<std::string> keys;
+            std::vector<SequenceNumber> seqs;
+            for (int i = 0; i < 300; i++) {
+                keys.push_back(Key(rnd.Uniform(kNum + 10)));
+                seqs.push_back(rnd.OneIn(3) ? before_overwrite : kMaxSequenceNumber);
+            }
+            keys.push_back(keys[0]);
+            seqs.push_back(seqs[0]);
+            for (size_t i = 0; i < keys.size(); i++) {
+                lkeys.push_back(new LookupKey(keys[i], seqs[i]));
+            }
+            const int n = static_cast<int>(lkeys.size());
+            std::vector<std::string> values(n);
+            std::vector<Status> statuses(n);
+            std::unique_ptr<bool[]> found(new bool[n]);
+            mem_->MultiGet(lkeys.data(), n, values.data(), statuses.data(), found.get());
+
+            for (int i = 0; i < n; i++) {
+                std::string expected = Get(keys[i], seqs[i]);
+                std::string actual = "NOT_FOUND";
+                if (found[i] && statuses[i].ok()) {
+                    actual = values[i];
+                } else if (found[i] && !statuses[i].IsNotFound()) {
+                    actual = statuses[i].ToString();
+                }
+                ASSERT_EQ(expected, actual) << vector_rep << " " << read_only << " " << keys[i];
+                delete lkeys[i];
+            }
+        }
+    }
+}
+
+TEST_F(MemTableTest, PrefixBloom) {
+    std::unique_ptr<const SliceTransform> prefix(NewFixedPrefixTransform(6));
+    options_.prefix_extractor = prefix.get();
+    options_.memtable_prefix_bloom_size_ratio = 0.1;
+    NewMemTable(NewSkipListRepFactory());
+    // 只有偶数编号的前缀有 key
+    char buf[32];
+    SequenceNumber seq = 0;
+    for (int p = 0; p < 200; p += 2) {
+        for (int i = 0; i < 20; i++) {
+            std::snprintf(buf, sizeof(buf), "p%04d/%04d", p, i);
+            mem_->Add(++seq, kTypeValue, buf, std::string("v") + buf);
+        }
+    }
+    EXPECT_EQ("vp0004/0005", Get("p0004/0005"));
+    EXPECT_EQ("NOT_FOUND", Get("p0004/0020"));
+    EXPECT_EQ("NOT_FOUND", Get("p0005/0000"));
+
+    // 前缀 seek 模式下，bloom filter 排除的前缀直接无效，不再定位到其他前缀
+    ReadOptions read_options;
+    Iterator* iter = mem_->NewIterator(read_options);
+    int valid = 0;
+    for (int p = 1; p < 200; p += 2) {
+        std::snprintf(buf, sizeof(buf), "p%04d/", p);
+        iter->Seek(LookupKey(buf, kMaxSequenceNumber).internal_key());
+        if (iter->Valid()) valid++;
+    }
+    EXPECT_LT(valid, 10);
+    delete iter;
+
+    read_options.prefix_same_as_start = true;
+    iter = mem_->NewIterator(read_options);
+    int count = 0;
+    for (iter->Seek(LookupKey("p0004/0005", kMaxSequenceNumber).internal_key());
+         iter->Valid(); iter->Next(), count++) {
+        ASSERT_TRUE(ExtractUserKey(iter->key()).starts_with("p0004/"));
+    }
+    EXPECT_EQ(15, count);
+    delete iter;
+
+    // total_order_seek 时定位到下一个存在的 key
+    read_options = ReadOptions();
+    read_options.total_order_seek = true;
+    iter = mem_->NewIterator(read_options);
+    iter->Seek(LookupKey("p0003/", kMaxSequenceNumber).internal_key());
+    ASSERT_TRUE(iter->Valid());
+    EXPECT_EQ("p0004/0000", ExtractUserKey(iter->key()).ToString());
+    delete iter;
+}
+
+TEST_F(MemTableTest, HashReps) {
+    std::unique_ptr<const SliceTransform> prefix(NewFixedPrefixTransform(10));
+    for (int kind = 0; kind < 4; kind++) {
+        if (mem_ != nullptr) mem_->Unref();
+        // 桶很少，每个桶中有很多前缀
+        options_.prefix_extractor = (kind % 2 == 1) ? prefix.get() : nullptr;
+        NewMemTable(kind < 2 ? NewHashSkipListRepFactory(16) : NewHashLinkListRepFactory(16));
+
+        const int kNum = 5000;
+        std::vector<int> order(kNum);
+        for (int i = 0; i < kNum; i++) order[i] = i;
+        Random rnd(301 + kind);
+        for (int i = kNum - 1; i > 0; i--) {
+            std::swap(order[i], order[rnd.Uniform(i + 1)]);
+        }
+        SequenceNumber seq = 0;
+        for (int i : order) {
+            mem_->Add(++seq, kTypeValue, Key(i), "v1." + Key(i));
+        }
+        const SequenceNumber before_overwrite = seq;
+        for (int i : order) {
+            if (i % 2 == 0) mem_->Add(++seq, kTypeValue, Key(i), "v2." + Key(i));
+            if (i % 3 == 0) mem_->Add(++seq, kTypeDeletion, Key(i), "");
+        }
+        for (int i = 0; i < kNum; i++) {
+            std::string expected;
+            if (i % 3 == 0) {
+                expected = "NOT_FOUND";
+            } else {
+                expected = (i % 2 == 0 ? "v2." : "v1.") + Key(i);
+            }
+            ASSERT_EQ(expected, Get(Key(i))) << kind << " " << i;
+            ASSERT_EQ("v1." + Key(i), Get(Key(i), before_overwrite)) << kind << " " << i;
+        }
+        EXPECT_EQ("NOT_FOUND", Get(Key(kNum)));
+        EXPECT_EQ("NOT_FOUND", Get("k"));
+
+        // 全序遍历时排序一次
+        CheckOrdered(static_cast<int>(seq));
+
+        // 前缀 seek 模式只遍历一个前缀，没有 prefix_extractor 时一直遍历到结尾
+        ReadOptions read_options;
+        read_options.prefix_same_as_start = true;
+        Iterator* iter = mem_->NewIterator(read_options);
+        int count = 0;
+        for (iter->Seek(LookupKey(Key(1230), kMaxSequenceNumber).internal_key());
+             iter->Valid(); iter->Next(), count++) {
+            if (kind % 2 == 1) {
+                ASSERT_TRUE(ExtractUserKey(iter->key()).starts_with("key0000123")) << kind;
+            }
+        }
+        if (kind % 2 == 1) {
+            // 1230~1239 十个 key，共 10 + 5 + 4 个条目
+            EXPECT_EQ(19, count);
+        } else {
+            EXPECT_GT(count, 19);
+        }
+        delete iter;
+        mem_->MarkReadOnly();
+        EXPECT_EQ("v1." + Key(1), Get(Key(1)));
+    }
+}
+
+TEST_F(MemTableTest, HashRepConcurrentReads) {
+    std::unique_ptr<const SliceTransform> prefix(NewFixedPrefixTransform(10));
+    options_.prefix_extractor = prefix.get();
+    for (int kind = 0; kind < 2; kind++) {
+        if (mem_ != nullptr) mem_->Unref();
+        NewMemTable(kind == 0 ? NewHashSkipListRepFactory(1000) : NewHashLinkListRepFactory(1000));
+        // 一个写线程，多个读线程不加锁地读取已经写入的 key
+        const int kNum = 20000;
+        std::atomic<int> written(0);
+        std::atomic<bool> failed(false);
+        std::vector<std::thread> readers;
+        for (int t = 0; t < 3; t++) {
+            readers.emplace_back([&, t]() {
+                Random rnd(t + 1);
+                while (written.load(std::memory_order_acquire) < kNum) {
+                    const int n = written.load(std::memory_order_acquire);
+                    if (n == 0) continue;
+                    const int i = rnd.Uniform(n);
+                    if (Get(Key(i)) != "v" + Key(i)) failed = true;
+                }
+            });
+        }
+        for (int i = 0; i < kNum; i++) {
+            mem_->Add(i + 1, kTypeValue, Key(i), "v" + Key(i));
+            written.store(i + 1, std::memory_order_release);
+        }
+        for (auto& t : readers) t.join();
+        EXPECT_FALSE(failed.load());
+        CheckOrdered(kNum);
+    }
+}
+
+} // namespace tinydb
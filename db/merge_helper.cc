@@ -0,0 +1,44 @@
+#include "db/merge_helper.h"
+
+#include "tinydb/merge_operator.h"
+
+namespace tinydb {
+
+std::vector<Slice> MergeContext::GetOperandsOldestFirst() const {
+    std::vector<Slice> result;
+    result.reserve(operands_.size());
+    for (size_t i = operands_.size(); i > 0; i--) {
+        result.push_back(operands_[i - 1]);
+    }
+    return result;
+}
+
+Status FullMergeOperands(const MergeOperator* merge_operator, const Slice& user_key,
+                         const Slice* existing_value, const std::vector<Slice>& operands,
+                         std::string* result) {
+    if (merge_operator == nullptr) {
+        return Status::InvalidArgument("merge operand found but merge_operator is not set");
+    }
+    if (!merge_operator->FullMerge(user_key, existing_value, operands, result)) {
+        return Status::Corruption("merge failed", merge_operator->Name());
+    }
+    return Status::OK();
+}
+
+bool PartialMergeOperands(const MergeOperator* merge_operator, const Slice& user_key,
+                          const std::vector<Slice>& operands, std::string* result) {
+    if (merge_operator == nullptr || operands.empty()) {
+        return false;
+    }
+    result->assign(operands[0].data(), operands[0].size());
+    std::string merged;
+    for (size_t i = 1; i < operands.size(); i++) {
+        if (!merge_operator->PartialMerge(user_key, *result, operands[i], &merged)) {
+            return false;
+        }
+        result->swap(merged);
+    }
+    return true;
+}
+
+} // namespace tinydb
@@ -0,0 +1,52 @@
+#ifndef STORAGE_TINYDB_DB_MERGE_HELPER_H_
+#define STORAGE_TINYDB_DB_MERGE_HELPER_H_
+
+#include <string>
+#include <vector>
+
+#include "tinydb/slice.h"
+#include "tinydb/status.h"
+
+namespace tinydb {
+
+class MergeOperator;
+
+/*
+ * 查找一个 key 时收集到的 merge 操作数
+ * 按从新到旧的顺序查找各个数据源(memtable、table)，遇到操作数时记下来继续查找更旧的版本，
+ * 直到遇到值或者删除记录时再一次合并
+ */
+class MergeContext {
+public:
+    // 加入一个比已有的操作数都旧的操作数
+    void PushOperand(const Slice& operand) {
+        operands_.push_back(operand.ToString());
+    }
+
+    bool empty() const { return operands_.empty(); }
+    size_t size() const { return operands_.size(); }
+    void Clear() { operands_.clear(); }
+
+    // 按从旧到新的顺序返回所有的操作数，在下一次 PushOperand() 之前有效
+    std::vector<Slice> GetOperandsOldestFirst() const;
+
+private:
+    std::vector<std::string> operands_;  // 从新到旧
+};
+
+// 用 merge_operator 把 operands(从旧到新)作用到 existing_value(nullptr 表示不存在)上
+// merge_operator 为 nullptr 时返回 InvalidArgument，合并失败时返回 Corruption
+Status FullMergeOperands(const MergeOperator* merge_operator, const Slice& user_key,
+                         const Slice* existing_value, const std::vector<Slice>& operands,
+                         std::string* result);
+
+/*
+ * 用 PartialMerge() 从旧到新把 operands 合并成一个操作数存到 *result
+ * 有任意一对不能合并时返回 false
+ */
+bool PartialMergeOperands(const MergeOperator* merge_operator, const Slice& user_key,
+                          const std::vector<Slice>& operands, std::string* result);
+
+} // namespace tinydb
+
+#endif  // STORAGE_TINYDB_DB_MERGE_HELPER_H_
@@ -0,0 +1,137 @@
+#include "db/range_tombstone_fragmenter.h"
+
+#include <algorithm>
+#include <functional>
+
+#include "tinydb/comparator.h"
+#include "tinydb/iterator.h"
+
+namespace tinydb {
+
+Status ReadRangeTombstones(Iterator* iter, std::vector<RangeTombstone>* result) {
+    if (iter == nullptr) {
+        return Status::OK();
+    }
+    ParsedInternalKey ikey;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+        if (!ParseInternalKey(iter->key(), &ikey) || ikey.type != kTypeRangeDeletion) {
+            return Status::Corruption("bad range tombstone");
+        }
+        result->push_back(RangeTombstone(ikey.user_key, iter->value(), ikey.sequence));
+    }
+    return iter->status();
+}
+
+FragmentedRangeTombstoneList::FragmentedRangeTombstoneList(
+        const std::vector<RangeTombstone>& tombstones, const Comparator* ucmp)
+    : ucmp_(ucmp) {
+    auto key_less = [ucmp](const std::string& a, const std::string& b) {
+        return ucmp->Compare(a, b) < 0;
+    };
+
+    // 所有端点排序去重，相邻两个端点之间的区间就是一个候选片段
+    std::vector<const RangeTombstone*> sorted;
+    std::vector<std::string> bounds;
+    for (size_t i = 0; i < tombstones.size(); i++) {
+        const RangeTombstone& t = tombstones[i];
+        if (ucmp->Compare(t.start_key, t.end_key) >= 0) {
+            continue;  // 空范围
+        }
+        sorted.push_back(&t);
+        bounds.push_back(t.start_key);
+        bounds.push_back(t.end_key);
+    }
+    std::sort(sorted.begin(), sorted.end(),
+              [ucmp](const RangeTombstone* a, const RangeTombstone* b) {
+                  return ucmp->Compare(a->start_key, b->start_key) < 0;
+              });
+    std::sort(bounds.begin(), bounds.end(), key_less);
+    bounds.erase(std::unique(bounds.begin(), bounds.end(),
+                             [ucmp](const std::string& a, const std::string& b) {
+                                 return ucmp->Compare(a, b) == 0;
+                             }),
+                 bounds.end());
+
+    // 从左到右扫描端点，active 是覆盖当前区间的 tombstone
+    std::vector<const RangeTombstone*> active;
+    size_t next = 0;
+    for (size_t i = 0; i + 1 < bounds.size(); i++) {
+        const std::string& b = bounds[i];
+        size_t kept = 0;
+        for (size_t j = 0; j < active.size(); j++) {
+            if (ucmp->Compare(active[j]->end_key, b) > 0) {
+                active[kept++] = active[j];
+            }
+        }
+        active.resize(kept);
+        while (next < sorted.size() && ucmp->Compare(sorted[next]->start_key, b) <= 0) {
+            active.push_back(sorted[next++]);
+        }
+        if (active.empty()) {
+            continue;
+        }
+
+        Fragment f;
+        f.start_key = b;
+        f.end_key = bounds[i + 1];
+        f.seq_start = seqs_.size();
+        for (size_t j = 0; j < active.size(); j++) {
+            seqs_.push_back(active[j]->seq);
+        }
+        std::sort(seqs_.begin() + f.seq_start, seqs_.end(),
+                  std::greater<SequenceNumber>());
+        seqs_.erase(std::unique(seqs_.begin() + f.seq_start, seqs_.end()),
+                    seqs_.end());
+        f.seq_end = seqs_.size();
+        fragments_.push_back(f);
+    }
+}
+
+SequenceNumber FragmentedRangeTombstoneList::MaxCoveringTombstoneSeqnum(
+        const Slice& user_key, SequenceNumber snapshot) const {
+    // 找到最后一个起点 <= user_key 的片段
+    auto it = std::upper_bound(fragments_.begin(), fragments_.end(), user_key,
+                               [this](const Slice& key, const Fragment& f) {
+                                   return ucmp_->Compare(key, f.start_key) < 0;
+                               });
+    if (it == fragments_.begin()) {
+        return 0;
+    }
+    --it;
+    if (ucmp_->Compare(user_key, it->end_key) >= 0) {
+        return 0;
+    }
+    for (size_t i = it->seq_start; i < it->seq_end; i++) {
+        if (seqs_[i] <= snapshot) {
+            return seqs_[i];
+        }
+    }
+    return 0;
+}
+
+void FragmentedRangeTombstoneList::GetTombstones(
+        SequenceNumber smallest_snapshot, const Slice* lower, const Slice* upper,
+        std::vector<RangeTombstone>* result) const {
+    for (size_t i = 0; i < fragments_.size(); i++) {
+        const Fragment& f = fragments_[i];
+        Slice start = f.start_key;
+        Slice end = f.end_key;
+        if (lower != nullptr && ucmp_->Compare(start, *lower) < 0) {
+            start = *lower;
+        }
+        if (upper != nullptr && ucmp_->Compare(end, *upper) > 0) {
+            end = *upper;
+        }
+        if (ucmp_->Compare(start, end) >= 0) {
+            continue;
+        }
+        for (size_t j = f.seq_start; j < f.seq_end; j++) {
+            result->push_back(RangeTombstone(start, end, seqs_[j]));
+            if (seqs_[j] <= smallest_snapshot) {
+                break;
+            }
+        }
+    }
+}
+
+} // namespace tinydb
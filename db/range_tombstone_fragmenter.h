@@ -0,0 +1,91 @@
+#ifndef STORAGE_TINYDB_DB_RANGE_TOMBSTONE_FRAGMENTER_H_
+#define STORAGE_TINYDB_DB_RANGE_TOMBSTONE_FRAGMENTER_H_
+
+#include <string>
+#include <vector>
+
+#include "db/dbformat.h"
+#include "tinydb/status.h"
+
+namespace tinydb {
+
+class Comparator;
+class Iterator;
+
+/*
+ * range tombstone：删除 user key 在 [start_key, end_key) 中、序列号小于 seq 的所有版本
+ * 在 memtable 和 table 中保存为一个条目，key 是 (start_key, seq, kTypeRangeDeletion)，
+ * value 是 end_key
+ */
+struct RangeTombstone {
+    RangeTombstone() : seq(0) {}
+    RangeTombstone(const Slice& start, const Slice& end, SequenceNumber s)
+        : start_key(start.ToString()), end_key(end.ToString()), seq(s) {}
+
+    // 保存时使用的 internal key
+    InternalKey SerializeKey() const {
+        return InternalKey(start_key, seq, kTypeRangeDeletion);
+    }
+
+    // 文件 key 范围的上界：end_key 不包含在范围内，序列号取最大值，
+    // 使它排在 end_key 的所有真实条目之前
+    InternalKey SerializeEndKey() const {
+        return InternalKey(end_key, kMaxSequenceNumber, kTypeRangeDeletion);
+    }
+
+    std::string start_key;
+    std::string end_key;
+    SequenceNumber seq;
+};
+
+// 读出 iter 中所有的 range tombstone 追加到 *result，iter 为 nullptr 时什么都不做
+// 不接管 iter
+Status ReadRangeTombstones(Iterator* iter, std::vector<RangeTombstone>* result);
+
+/*
+ * 切分后的 range tombstone 列表：互相重叠的 tombstone 在所有端点处切开，得到按起点有序、
+ * 互不重叠的片段，每个片段记录覆盖它的所有序列号(从大到小)
+ * 查找一个 key 被哪些 tombstone 覆盖只需要一次二分查找，与 tombstone 的个数无关
+ *
+ * 构造之后不可修改，多个线程可以并发读
+ */
+class FragmentedRangeTombstoneList {
+public:
+    FragmentedRangeTombstoneList(const std::vector<RangeTombstone>& tombstones,
+                                 const Comparator* ucmp);
+
+    FragmentedRangeTombstoneList(const FragmentedRangeTombstoneList&) = delete;
+    FragmentedRangeTombstoneList& operator=(const FragmentedRangeTombstoneList&) = delete;
+
+    bool empty() const { return fragments_.empty(); }
+    size_t num_fragments() const { return fragments_.size(); }
+
+    // 返回覆盖 user_key 且序列号不大于 snapshot 的 tombstone 中最大的序列号，没有时返回 0
+    // 序列号小于返回值的版本对 snapshot 都不可见
+    SequenceNumber MaxCoveringTombstoneSeqnum(const Slice& user_key,
+                                              SequenceNumber snapshot) const;
+
+    /*
+     * 按 internal key 的顺序把片段追加到 *result，用于写回 table
+     * 同一个片段中不大于 smallest_snapshot 的序列号只保留最大的一个，更小的已经被它遮住
+     * [lower, upper) 非空时只输出与它相交的部分并裁剪到这个范围
+     */
+    void GetTombstones(SequenceNumber smallest_snapshot, const Slice* lower,
+                       const Slice* upper, std::vector<RangeTombstone>* result) const;
+
+private:
+    struct Fragment {
+        std::string start_key;
+        std::string end_key;
+        size_t seq_start;  // 在 seqs_ 中的下标范围 [seq_start, seq_end)
+        size_t seq_end;
+    };
+
+    const Comparator* const ucmp_;
+    std::vector<Fragment> fragments_;
+    std::vector<SequenceNumber> seqs_;
+};
+
+} // namespace tinydb
+
+#endif  // STORAGE_TINYDB_DB_RANGE_TOMBSTONE_FRAGMENTER_H_
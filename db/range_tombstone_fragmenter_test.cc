@@ -0,0 +1,73 @@
+#include "db/range_tombstone_fragmenter.h"
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "tinydb/comparator.h"
+
+namespace tinydb {
+
+TEST(FragmentedRangeTombstoneListTest, Empty) {
+    FragmentedRangeTombstoneList list({}, BytewiseComparator());
+    EXPECT_TRUE(list.empty());
+    EXPECT_EQ(0u, list.MaxCoveringTombstoneSeqnum("a", kMaxSequenceNumber));
+}
+
+TEST(FragmentedRangeTombstoneListTest, OverlappingTombstones) {
+    // [a,e)@10 和 [c,g)@20 切成 [a,c) [c,e) [e,g)
+    FragmentedRangeTombstoneList list({RangeTombstone("a", "e", 10),
+                                       RangeTombstone("c", "g", 20)},
+                                      BytewiseComparator());
+    EXPECT_EQ(3u, list.num_fragments());
+
+    EXPECT_EQ(10u, list.MaxCoveringTombstoneSeqnum("a", kMaxSequenceNumber));
+    EXPECT_EQ(10u, list.MaxCoveringTombstoneSeqnum("b", kMaxSequenceNumber));
+    EXPECT_EQ(20u, list.MaxCoveringTombstoneSeqnum("c", kMaxSequenceNumber));
+    EXPECT_EQ(20u, list.MaxCoveringTombstoneSeqnum("f", kMaxSequenceNumber));
+    // 终点不包含在范围内
+    EXPECT_EQ(0u, list.MaxCoveringTombstoneSeqnum("g", kMaxSequenceNumber));
+    EXPECT_EQ(0u, list.MaxCoveringTombstoneSeqnum("0", kMaxSequenceNumber));
+
+    // 快照看不到更新的 tombstone
+    EXPECT_EQ(10u, list.MaxCoveringTombstoneSeqnum("d", 15));
+    EXPECT_EQ(0u, list.MaxCoveringTombstoneSeqnum("f", 15));
+    EXPECT_EQ(0u, list.MaxCoveringTombstoneSeqnum("b", 9));
+}
+
+TEST(FragmentedRangeTombstoneListTest, GetTombstones) {
+    FragmentedRangeTombstoneList list({RangeTombstone("a", "e", 10),
+                                       RangeTombstone("c", "g", 20)},
+                                      BytewiseComparator());
+
+    // 所有快照都能看到时，[c,e) 中被 @20 遮住的 @10 丢掉
+    std::vector<RangeTombstone> result;
+    list.GetTombstones(kMaxSequenceNumber, nullptr, nullptr, &result);
+    ASSERT_EQ(3u, result.size());
+    EXPECT_EQ("a", result[0].start_key);
+    EXPECT_EQ("c", result[0].end_key);
+    EXPECT_EQ(10u, result[0].seq);
+    EXPECT_EQ("c", result[1].start_key);
+    EXPECT_EQ("e", result[1].end_key);
+    EXPECT_EQ(20u, result[1].seq);
+    EXPECT_EQ("e", result[2].start_key);
+    EXPECT_EQ("g", result[2].end_key);
+    EXPECT_EQ(20u, result[2].seq);
+
+    // 有快照在两者之间时两个版本都要保留
+    result.clear();
+    list.GetTombstones(15, nullptr, nullptr, &result);
+    EXPECT_EQ(4u, result.size());
+
+    // 裁剪到 [b,d)
+    result.clear();
+    const Slice lower("b"), upper("d");
+    list.GetTombstones(kMaxSequenceNumber, &lower, &upper, &result);
+    ASSERT_EQ(2u, result.size());
+    EXPECT_EQ("b", result[0].start_key);
+    EXPECT_EQ("c", result[0].end_key);
+    EXPECT_EQ("c", result[1].start_key);
+    EXPECT_EQ("d", result[1].end_key);
+}
+
+} // namespace tinydb
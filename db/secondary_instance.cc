@@ -0,0 +1,368 @@
+#include "db/secondary_instance.h"
+
+#include <algorithm>
+
+#include "db/filename.h"
+#include "db/log_reader.h"
+#include "db/memtable.h"
+#include "db/merge_helper.h"
+#include "db/table_cache.h"
+#include "db/version_set.h"
+#include "db/write_batch_internal.h"
+#include "tinydb/env.h"
+#include "tinydb/write_batch.h"
+#include "util/mutexlock.h"
+#include "util/statistics.h"
+
+namespace tinydb {
+
+namespace {
+
+// 留给 manifest、WAL 等非 table 文件的文件描述符
+const int kNumNonTableCacheFiles = 10;
+
+int TableCacheSize(const Options& options) {
+    return std::max(options.max_open_files - kNumNonTableCacheFiles, 64);
+}
+
+} // namespace
+
+struct SecondaryInstance::ColumnFamily {
+    ColumnFamily(const std::string& dir, const Options& opts)
+        : icmp(opts.comparator),
+          options(opts),
+          versions(nullptr),
+          table_cache(nullptr),
+          dropped(false) {
+        options.comparator = &icmp;
+        // secondary 不能 flush，它的 memtable 不计入共享的预算，否则只会让 primary 多做无用的 flush
+        options.write_buffer_manager = nullptr;
+        versions = new VersionSet(dir, &options, &icmp);
+        table_cache = new TableCache(dir, options, TableCacheSize(options));
+    }
+
+    ~ColumnFamily() {
+        DropMemTables(~static_cast<uint64_t>(0));
+        delete table_cache;
+        delete versions;
+    }
+
+    // 丢弃编号小于 log_number 的 WAL 对应的 memtable，它们的数据已经 flush 到 table 中
+    void DropMemTables(uint64_t log_number) {
+        auto end = mems.lower_bound(log_number);
+        for (auto it = mems.begin(); it != end; ++it) {
+            it->second->Unref();
+        }
+        mems.erase(mems.begin(), end);
+    }
+
+    const InternalKeyComparator icmp;
+    Options options;
+    VersionSet* versions;
+    TableCache* table_cache;
+    // 每个还没有 flush 的 WAL 中属于这个 column family 的更新，key 是 WAL 的编号
+    std::map<uint64_t, MemTable*> mems;
+    bool dropped;
+};
+
+/*
+ * 把编号为 log_number 的 WAL 中的更新写入对应的 memtable
+ * 没有打开、已经删除的 column family，以及日志编号已经超过 log_number
+ * (这个 WAL 中的数据已经 flush 过)的 column family 的更新都跳过
+ */
+class SecondaryInstance::MemTableInserter : public ColumnFamilyMemTables {
+public:
+    MemTableInserter(const std::map<uint32_t, ColumnFamily*>* families, uint64_t log_number)
+        : families_(families), log_number_(log_number) {}
+
+    MemTable* GetMemTable(uint32_t column_family_id, bool* skip) override {
+        *skip = true;
+        auto it = families_->find(column_family_id);
+        if (it == families_->end() || it->second->dropped ||
+            log_number_ < it->second->versions->LogNumber()) {
+            return nullptr;
+        }
+        ColumnFamily* cf = it->second;
+        MemTable*& mem = cf->mems[log_number_];
+        if (mem == nullptr) {
+            mem = new MemTable(cf->icmp, cf->options);
+            mem->Ref();
+        }
+        return mem;
+    }
+
+private:
+    const std::map<uint32_t, ColumnFamily*>* const families_;
+    const uint64_t log_number_;
+};
+
+SecondaryInstance::SecondaryInstance(const std::string& dbname, const Options& db_options)
+    : env_(db_options.env),
+      dbname_(dbname),
+      db_options_(db_options),
+      log_sequence_(0),
+      newest_log_(0) {}
+
+SecondaryInstance::~SecondaryInstance() {
+    MutexLock l(&mutex_);
+    for (auto& entry : column_families_) {
+        delete entry.second;
+    }
+}
+
+Status SecondaryInstance::OpenColumnFamily(uint32_t id, const std::string& name,
+                                           const Options& options) {
+    const std::string dir = (id == 0) ? dbname_ : ColumnFamilyDirName(dbname_, id);
+    Options cf_options = options;
+    cf_options.statistics = db_options_.statistics;
+    ColumnFamily* cf = new ColumnFamily(dir, cf_options);
+    bool changed;
+    Status s = cf->versions->CatchUpWithManifest(&changed);
+    if (!s.ok()) {
+        delete cf;
+        return s;
+    }
+    column_families_[id] = cf;
+    column_family_ids_[name] = id;
+    return s;
+}
+
+Status SecondaryInstance::Open(const std::vector<ColumnFamilyDescriptor>& families) {
+    MutexLock l(&mutex_);
+    if (!column_families_.empty()) {
+        return Status::InvalidArgument("column families are already open");
+    }
+
+    std::map<std::string, const ColumnFamilyDescriptor*> descs;
+    for (size_t i = 0; i < families.size(); i++) {
+        descs[families[i].name] = &families[i];
+    }
+    auto default_desc = descs.find(kDefaultColumnFamilyName);
+    Status s = OpenColumnFamily(
+            0, kDefaultColumnFamilyName,
+            (default_desc != descs.end()) ? default_desc->second->options : db_options_);
+
+    if (s.ok()) {
+        const std::map<uint32_t, std::string>& registered =
+                column_families_[0]->versions->column_families();
+        size_t matched = (default_desc != descs.end()) ? 1 : 0;
+        for (auto it = registered.begin(); s.ok() && it != registered.end(); ++it) {
+            auto desc = descs.find(it->second);
+            if (desc != descs.end()) {
+                matched++;
+                s = OpenColumnFamily(it->first, it->second, desc->second->options);
+            }
+        }
+        if (s.ok() && matched != descs.size()) {
+            s = Status::InvalidArgument("unknown column family in descriptors");
+        }
+    }
+    if (s.ok()) {
+        s = CatchUpLocked();
+    }
+    if (!s.ok()) {
+        for (auto& entry : column_families_) {
+            delete entry.second;
+        }
+        column_families_.clear();
+        column_family_ids_.clear();
+    }
+    return s;
+}
+
+Status SecondaryInstance::TryCatchUpWithPrimary() {
+    MutexLock l(&mutex_);
+    if (column_families_.empty()) {
+        return Status::InvalidArgument("column families are not open");
+    }
+    return CatchUpLocked();
+}
+
+Status SecondaryInstance::CatchUpLocked() {
+    // column family 的注册表在 default 的 manifest 中，先追上它才知道哪些被删除了
+    ColumnFamily* default_cf = column_families_[0];
+    bool changed;
+    Status s = default_cf->versions->CatchUpWithManifest(&changed);
+    if (!s.ok()) {
+        return s;
+    }
+    const std::map<uint32_t, std::string>& registered =
+            default_cf->versions->column_families();
+    for (auto& entry : column_families_) {
+        ColumnFamily* cf = entry.second;
+        if (entry.first != 0 && !cf->dropped && registered.count(entry.first) == 0) {
+            cf->dropped = true;
+            cf->DropMemTables(~static_cast<uint64_t>(0));
+        }
+    }
+
+    uint64_t min_log = ~static_cast<uint64_t>(0);
+    for (auto& entry : column_families_) {
+        ColumnFamily* cf = entry.second;
+        if (cf->dropped) {
+            continue;
+        }
+        if (entry.first != 0) {
+            s = cf->versions->CatchUpWithManifest(&changed);
+            if (s.IsNotFound()) {
+                // 读注册表之后 primary 删除了这个 column family，下一次追赶时再处理
+                s = Status::OK();
+                continue;
+            }
+            if (!s.ok()) {
+                return s;
+            }
+        }
+        cf->DropMemTables(cf->versions->LogNumber());
+        min_log = std::min(min_log, cf->versions->LogNumber());
+    }
+
+    // 编号不小于 min_log 的 WAL 中还有没有 flush 的数据，按编号从小到大续读
+    std::vector<std::string> filenames;
+    s = env_->GetChildren(dbname_, &filenames);
+    if (!s.ok()) {
+        return s;
+    }
+    std::vector<uint64_t> logs;
+    uint64_t number;
+    FileType type;
+    for (size_t i = 0; i < filenames.size(); i++) {
+        if (ParseFileName(filenames[i], &number, &type) && type == kLogFile &&
+            number >= min_log) {
+            logs.push_back(number);
+        }
+    }
+    std::sort(logs.begin(), logs.end());
+    log_offsets_.erase(log_offsets_.begin(), log_offsets_.lower_bound(min_log));
+    // primary 先建新的 WAL 再关闭旧的，旧 WAL 缓冲中的数据可能在新 WAL 出现之后才写出，
+    // 但新 WAL 中的记录一定在旧 WAL 关闭之后才写入。上一次追赶已经读到更新的 WAL 中的记录时，
+    // 旧 WAL 这一次读完就不会再变，它的 memtable 标记为只读
+    const uint64_t finished_before = newest_log_;
+    for (size_t i = 0; s.ok() && i < logs.size(); i++) {
+        s = CatchUpWithLog(logs[i]);
+        if (s.ok() && logs[i] < finished_before) {
+            for (auto& entry : column_families_) {
+                auto mem = entry.second->mems.find(logs[i]);
+                if (mem != entry.second->mems.end()) {
+                    mem->second->MarkReadOnly();
+                }
+            }
+        }
+    }
+    return s;
+}
+
+Status SecondaryInstance::CatchUpWithLog(uint64_t log_number) {
+    struct LogReporter : public log::Reader::Reporter {
+        Status* status;  // 为 nullptr 时忽略错误
+        void Corruption(size_t bytes, const Status& s) override {
+            if (this->status != nullptr && this->status->ok()) *this->status = s;
+        }
+    };
+
+    SequentialFile* file;
+    Status status = env_->NewSequentialFile(LogFileName(dbname_, log_number), &file);
+    if (!status.ok()) {
+        // 列出目录之后 primary 删除了这个 WAL，其中的数据已经 flush 到 table 中
+        return status.IsNotFound() ? Status::OK() : status;
+    }
+
+    // 压缩的 WAL 只能从头读，已经读过的记录按序列号跳过
+    const uint64_t offset = log_offsets_.count(log_number) ? log_offsets_[log_number] : 0;
+    uint64_t next_offset = offset;
+    LogReporter reporter;
+    reporter.status = db_options_.paranoid_checks ? &status : nullptr;
+    log::Reader reader(file, &reporter, true /*checksum*/, offset, log_number);
+    std::string scratch;
+    Slice record;
+    WriteBatch batch;
+    MemTableInserter inserter(&column_families_, log_number);
+    // primary 可能正在追加，读到不完整的记录时当作文件末尾，下次从这里继续
+    while (reader.ReadRecord(&record, &scratch) && status.ok()) {
+        if (record.size() < 12) {
+            reporter.Corruption(record.size(), Status::Corruption("log record too small"));
+            continue;
+        }
+        WriteBatchInternal::SetContents(&batch, record);
+        const SequenceNumber last_seq = WriteBatchInternal::Sequence(&batch) +
+                                        WriteBatchInternal::Count(&batch) - 1;
+        if (last_seq > log_sequence_) {
+            status = WriteBatchInternal::InsertInto(&batch, &inserter);
+            if (!status.ok()) {
+                break;
+            }
+            log_sequence_ = last_seq;
+        }
+        newest_log_ = std::max(newest_log_, log_number);
+        next_offset = reader.NextRecordOffset();
+    }
+    if (reader.compressed()) {
+        log_offsets_.erase(log_number);
+    } else {
+        log_offsets_[log_number] = next_offset;
+    }
+    delete file;
+    return status;
+}
+
+Status SecondaryInstance::Get(const ReadOptions& options, const std::string& column_family,
+                              const Slice& key, std::string* value) {
+    Version* current;
+    std::vector<MemTable*> mems;
+    ColumnFamily* cf;
+    {
+        MutexLock l(&mutex_);
+        auto id = column_family_ids_.find(column_family);
+        if (id == column_family_ids_.end()) {
+            return Status::InvalidArgument("column family not opened: ", column_family);
+        }
+        cf = column_families_[id->second];
+        if (cf->dropped) {
+            return Status::InvalidArgument("column family dropped: ", column_family);
+        }
+        current = cf->versions->current();
+        current->Ref();
+        // 编号越大的 WAL 中的数据越新
+        for (auto it = cf->mems.rbegin(); it != cf->mems.rend(); ++it) {
+            it->second->Ref();
+            mems.push_back(it->second);
+        }
+    }
+
+    LookupKey lkey(key, kMaxSequenceNumber);
+    MergeContext merge_context;
+    Status s;
+    bool done = false;
+    for (size_t i = 0; !done && i < mems.size(); i++) {
+        done = mems[i]->Get(lkey, value, &s, &merge_context);
+    }
+    Statistics* const statistics = cf->options.statistics;
+    if (done) {
+        RecordTick(statistics, MEMTABLE_HIT);
+    } else {
+        RecordTick(statistics, MEMTABLE_MISS);
+        s = current->Get(options, lkey, value, cf->table_cache, &merge_context);
+    }
+    if (s.ok()) {
+        RecordTick(statistics, NUMBER_KEYS_READ);
+        RecordTick(statistics, BYTES_READ, value->size());
+    }
+
+    MutexLock l(&mutex_);
+    for (size_t i = 0; i < mems.size(); i++) {
+        mems[i]->Unref();
+    }
+    current->Unref();
+    return s;
+}
+
+SequenceNumber SecondaryInstance::LastSequence() const {
+    MutexLock l(&mutex_);
+    SequenceNumber result = log_sequence_;
+    for (auto& entry : column_families_) {
+        result = std::max(result, entry.second->versions->LastSequence());
+    }
+    return result;
+}
+
+} // namespace tinydb
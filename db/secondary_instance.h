@@ -0,0 +1,100 @@
+#ifndef STORAGE_TINYDB_DB_SECONDARY_INSTANCE_H_
+#define STORAGE_TINYDB_DB_SECONDARY_INSTANCE_H_
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "db/column_family.h"
+#include "db/dbformat.h"
+#include "port/port.h"
+#include "port/thread_annotations.h"
+#include "tinydb/options.h"
+#include "tinydb/status.h"
+
+namespace tinydb {
+
+class MemTable;
+class TableCache;
+class VersionSet;
+
+/*
+ * 只读的 secondary 实例：在另一个进程(primary，即 ColumnFamilySet)正在写的数据库目录上
+ * 提供读服务，不获取任何锁，也不写任何文件，可以同时有多个
+ *
+ * TryCatchUpWithPrimary() 追上 primary 的最新状态：先续读每个 column family 的 manifest
+ * 得到新的 table 文件，再续读还没有 flush 的 WAL，把新的更新写入每个 WAL 一个的 memtable
+ * 两次调用之间看到的是上一次追上时的状态，由调用者决定追赶的频率
+ *
+ * primary 在 compaction 之后会删除旧的 table 文件，已经打开的文件仍然可以读；
+ * Get() 遇到刚被删除的文件时返回 IOError，调用 TryCatchUpWithPrimary() 之后重试即可
+ *
+ * 所有方法都是线程安全的，Get() 与 TryCatchUpWithPrimary() 可以并发
+ */
+class SecondaryInstance {
+public:
+    // db_options 的含义与 ColumnFamilySet 相同，其中的 create_if_missing 等选项不起作用
+    SecondaryInstance(const std::string& dbname, const Options& db_options);
+
+    SecondaryInstance(const SecondaryInstance&) = delete;
+    SecondaryInstance& operator=(const SecondaryInstance&) = delete;
+
+    ~SecondaryInstance();
+
+    /*
+     * 打开 families 中的 column family 并追上 primary，default 可以省略(此时使用 db_options)
+     * 与 ColumnFamilySet::Open() 不同，可以只打开一部分 column family，
+     * 之后 primary 新建的 column family 不会被打开
+     */
+    Status Open(const std::vector<ColumnFamilyDescriptor>& families);
+
+    // 追上 primary 当前写入的 manifest 和 WAL
+    Status TryCatchUpWithPrimary();
+
+    // 在名为 column_family 的 column family 中查找 key
+    // key 不存在时返回 NotFound，column family 没有打开或者已经被 primary 删除时返回 InvalidArgument
+    Status Get(const ReadOptions& options, const std::string& column_family, const Slice& key,
+               std::string* value);
+
+    // 在 default column family 中查找
+    Status Get(const ReadOptions& options, const Slice& key, std::string* value) {
+        return Get(options, kDefaultColumnFamilyName, key, value);
+    }
+
+    // 已经追上的最大序列号
+    SequenceNumber LastSequence() const;
+
+private:
+    struct ColumnFamily;
+    class MemTableInserter;
+
+    Status OpenColumnFamily(uint32_t id, const std::string& name, const Options& options)
+            EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+    Status CatchUpLocked() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+    // 续读编号为 log_number 的 WAL
+    Status CatchUpWithLog(uint64_t log_number) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+    Env* const env_;
+    const std::string dbname_;
+    const Options db_options_;
+
+    mutable port::Mutex mutex_;
+
+    // 已经打开的 column family，被 primary 删除之后仍然保留到析构，只是不能再读
+    std::map<uint32_t, ColumnFamily*> column_families_ GUARDED_BY(mutex_);
+    std::map<std::string, uint32_t> column_family_ids_ GUARDED_BY(mutex_);
+
+    // 每个未压缩的 WAL 下一条记录的偏移，压缩的 WAL 每次都从头读
+    std::map<uint64_t, uint64_t> log_offsets_ GUARDED_BY(mutex_);
+    // 从 WAL 中读到的最大序列号，之前的记录已经写入 memtable
+    SequenceNumber log_sequence_ GUARDED_BY(mutex_);
+    // 读到过记录的最大 WAL 编号
+    uint64_t newest_log_ GUARDED_BY(mutex_);
+};
+
+} // namespace tinydb
+
+#endif  // STORAGE_TINYDB_DB_SECONDARY_INSTANCE_H_
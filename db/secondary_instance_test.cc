@@ -0,0 +1,252 @@
+#include "db/secondary_instance.h"
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "db/filename.h"
+#include "gtest/gtest.h"
+#include "tinydb/env.h"
+#include "tinydb/memtable_rep.h"
+#include "tinydb/write_batch.h"
+#include "util/testutil.h"
+
+namespace tinydb {
+
+namespace {
+
+std::string Key(int i) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%04d", i);
+    return buf;
+}
+
+} // namespace
+
+/*
+ * primary 一直打开，secondary 在它写入、flush 之间追赶
+ */
+class SecondaryInstanceTest : public testing::Test {
+public:
+    SecondaryInstanceTest() : env_(Env::Default()), db_(nullptr) {
+        dbname_ = test::NewTestDirectory("secondary_instance_test");
+        options_.create_if_missing = true;
+    }
+
+    ~SecondaryInstanceTest() override {
+        secondary_.reset();
+        delete db_;
+    }
+
+    Status OpenPrimary(const std::vector<ColumnFamilyDescriptor>& families = {}) {
+        delete db_;
+        db_ = new ColumnFamilySet(dbname_, options_);
+        return db_->Open(families);
+    }
+
+    Status OpenSecondary(const std::vector<ColumnFamilyDescriptor>& families = {}) {
+        secondary_.reset(new SecondaryInstance(dbname_, options_));
+        return secondary_->Open(families);
+    }
+
+    Status Put(uint32_t cf, const std::string& key, const std::string& value) {
+        WriteBatch batch;
+        batch.Put(cf, key, value);
+        return db_->Write(WriteOptions(), &batch);
+    }
+
+    std::string Get(const std::string& cf, const std::string& key) {
+        std::string value;
+        Status s = secondary_->Get(ReadOptions(), cf, key, &value);
+        if (s.IsNotFound()) {
+            return "NOT_FOUND";
+        }
+        return s.ok() ? value : s.ToString();
+    }
+
+    std::string Get(const std::string& key) { return Get(kDefaultColumnFamilyName, key); }
+
+    // dir 中所有 blob 文件的编号
+    std::vector<uint64_t> BlobFiles(const std::string& dir) {
+        std::vector<std::string> filenames;
+        EXPECT_TRUE(env_->GetChildren(dir, &filenames).ok());
+        std::vector<uint64_t> result;
+        uint64_t number;
+        FileType type;
+        for (const std::string& f : filenames) {
+            if (ParseFileName(f, &number, &type) && type == kBlobFile) {
+                result.push_back(number);
+            }
+        }
+        return result;
+    }
+
+    Env* env_;
+    std::string dbname_;
+    Options options_;
+    ColumnFamilySet* db_;
+    std::unique_ptr<SecondaryInstance> secondary_;
+};
+
+TEST_F(SecondaryInstanceTest, CatchUpWithWritesAndFlushes) {
+    ASSERT_TRUE(OpenPrimary().ok());
+    ASSERT_TRUE(Put(0, "a", "v1").ok());
+    ASSERT_TRUE(OpenSecondary().ok());
+    EXPECT_EQ("v1", Get("a"));
+    EXPECT_EQ(1u, secondary_->LastSequence());
+
+    // 追赶之前看到的是上一次的状态
+    ASSERT_TRUE(Put(0, "a", "v2").ok());
+    ASSERT_TRUE(Put(0, "b", "v3").ok());
+    EXPECT_EQ("v1", Get("a"));
+    EXPECT_EQ("NOT_FOUND", Get("b"));
+    ASSERT_TRUE(secondary_->TryCatchUpWithPrimary().ok());
+    EXPECT_EQ("v2", Get("a"));
+    EXPECT_EQ("v3", Get("b"));
+
+    // flush 之后从 table 中读，WAL 中的旧 memtable 被丢弃
+    ASSERT_TRUE(db_->Flush(db_->GetColumnFamily(0u)).ok());
+    ASSERT_TRUE(Put(0, "c", "v4").ok());
+    ASSERT_TRUE(secondary_->TryCatchUpWithPrimary().ok());
+    EXPECT_EQ("v2", Get("a"));
+    EXPECT_EQ("v3", Get("b"));
+    EXPECT_EQ("v4", Get("c"));
+    EXPECT_EQ(db_->LastSequence(), secondary_->LastSequence());
+}
+
+TEST_F(SecondaryInstanceTest, FinishedWalMemTablesAcrossSwitches) {
+    // secondary 的 memtable 用 vector rep，WAL 写完后标记只读时才排序
+    std::unique_ptr<MemTableRepFactory> factory(NewVectorRepFactory(2));
+    ASSERT_TRUE(OpenPrimary().ok());
+    ColumnFamilyData* cf;
+    ASSERT_TRUE(db_->CreateColumnFamily(ColumnFamilyDescriptor("a", options_), &cf).ok());
+    Options secondary_options = options_;
+    secondary_options.memtable_factory = factory.get();
+    const std::vector<ColumnFamilyDescriptor> families = {
+            ColumnFamilyDescriptor(kDefaultColumnFamilyName, secondary_options),
+            ColumnFamilyDescriptor("a", secondary_options)};
+
+    // default 的数据一直留在第一个 WAL 中，包括一个 range tombstone
+    for (int i = 99; i >= 0; i--) {
+        ASSERT_TRUE(Put(0, Key(i), "old" + Key(i)).ok());
+    }
+    WriteBatch batch;
+    batch.DeleteRange(0, Key(10), Key(20));
+    ASSERT_TRUE(db_->Write(WriteOptions(), &batch).ok());
+    ASSERT_TRUE(Put(cf->id(), "x", "1").ok());
+    ASSERT_TRUE(OpenSecondary(families).ok());
+
+    // 每次 flush "a" 都切换 WAL，default 的更新分散在多个 WAL 中
+    for (int round = 0; round < 4; round++) {
+        ASSERT_TRUE(db_->Flush(cf).ok());
+        for (int i = round; i < 100; i += 4) {
+            ASSERT_TRUE(Put(0, Key(i), "new" + Key(i)).ok());
+        }
+        ASSERT_TRUE(Put(cf->id(), "x", std::to_string(round + 2)).ok());
+        ASSERT_TRUE(secondary_->TryCatchUpWithPrimary().ok());
+        for (int i = 0; i < 100; i++) {
+            std::string expected = "old" + Key(i);
+            if (i % 4 <= round) {
+                expected = "new" + Key(i);
+            } else if (i >= 10 && i < 20) {
+                expected = "NOT_FOUND";
+            }
+            ASSERT_EQ(expected, Get(Key(i))) << round << " " << i;
+        }
+        EXPECT_EQ(std::to_string(round + 2), Get("a", "x"));
+    }
+    // 没有新的写入时再追赶一次，已经读完的 WAL 不再变化
+    ASSERT_TRUE(secondary_->TryCatchUpWithPrimary().ok());
+    EXPECT_EQ("new" + Key(15), Get(Key(15)));
+    EXPECT_EQ(db_->LastSequence(), secondary_->LastSequence());
+}
+
+TEST_F(SecondaryInstanceTest, CompressedWal) {
+    if (!test::ZstdSupported()) {
+        GTEST_SKIP() << "Zstd is not supported";
+    }
+    options_.wal_compression = kZstdCompression;
+    ASSERT_TRUE(OpenPrimary().ok());
+    for (int i = 0; i < 100; i++) {
+        ASSERT_TRUE(Put(0, Key(i), "v1." + Key(i)).ok());
+    }
+    ASSERT_TRUE(OpenSecondary().ok());
+    EXPECT_EQ("v1." + Key(5), Get(Key(5)));
+
+    // 压缩的 WAL 每次从头读，已经读过的记录按序列号跳过
+    for (int i = 0; i < 100; i += 2) {
+        ASSERT_TRUE(Put(0, Key(i), "v2." + Key(i)).ok());
+    }
+    ASSERT_TRUE(secondary_->TryCatchUpWithPrimary().ok());
+    for (int i = 0; i < 100; i++) {
+        ASSERT_EQ((i % 2 == 0 ? "v2." : "v1.") + Key(i), Get(Key(i))) << i;
+    }
+    EXPECT_EQ(db_->LastSequence(), secondary_->LastSequence());
+
+    // primary 重新打开时从压缩的 WAL 恢复
+    secondary_.reset();
+    ASSERT_TRUE(OpenPrimary().ok());
+    EXPECT_EQ(150u, db_->LastSequence());
+    ASSERT_TRUE(OpenSecondary().ok());
+    EXPECT_EQ("v2." + Key(98), Get(Key(98)));
+    EXPECT_EQ("v1." + Key(99), Get(Key(99)));
+}
+
+TEST_F(SecondaryInstanceTest, BlobReadersAreCached) {
+    options_.enable_blob_files = true;
+    options_.min_blob_size = 100;
+    ASSERT_TRUE(OpenPrimary().ok());
+    ColumnFamilyData* cfd = db_->GetColumnFamily(0u);
+    const std::string big1(1000, 'x');
+    const std::string big2(1000, 'y');
+    ASSERT_TRUE(Put(0, "k1", big1).ok());
+    ASSERT_TRUE(Put(0, "small", "v").ok());
+    ASSERT_TRUE(db_->Flush(cfd).ok());
+    ASSERT_EQ(1u, BlobFiles(dbname_).size());
+
+    ASSERT_TRUE(OpenSecondary().ok());
+    EXPECT_EQ(big1, Get("k1"));
+    EXPECT_EQ("v", Get("small"));
+
+    // 已经打开的 blob 文件被删除后仍然可以读
+    const uint64_t first = BlobFiles(dbname_)[0];
+    ASSERT_TRUE(env_->RemoveFile(BlobFileName(dbname_, first)).ok());
+    EXPECT_EQ(big1, Get("k1"));
+    EXPECT_EQ(big1, Get("k1"));
+
+    // 还没有打开过的 blob 文件丢失时返回错误
+    ASSERT_TRUE(Put(0, "k2", big2).ok());
+    ASSERT_TRUE(db_->Flush(cfd).ok());
+    ASSERT_TRUE(secondary_->TryCatchUpWithPrimary().ok());
+    for (uint64_t number : BlobFiles(dbname_)) {
+        ASSERT_TRUE(env_->RemoveFile(BlobFileName(dbname_, number)).ok());
+    }
+    std::string value;
+    Status s = secondary_->Get(ReadOptions(), "k2", &value);
+    EXPECT_TRUE(s.IsIOError()) << s.ToString();
+    EXPECT_EQ(big1, Get("k1"));
+}
+
+TEST_F(SecondaryInstanceTest, OpenErrors) {
+    // 数据库不存在
+    EXPECT_FALSE(OpenSecondary().ok());
+    EXPECT_TRUE(secondary_->TryCatchUpWithPrimary().IsInvalidArgument());
+
+    ASSERT_TRUE(OpenPrimary().ok());
+    ASSERT_TRUE(Put(0, "k", "v").ok());
+    EXPECT_TRUE(OpenSecondary({ColumnFamilyDescriptor("a", options_)}).IsInvalidArgument());
+
+    ASSERT_TRUE(OpenSecondary().ok());
+    EXPECT_TRUE(secondary_->Open({}).IsInvalidArgument());
+    std::string value;
+    EXPECT_TRUE(secondary_->Get(ReadOptions(), "a", "k", &value).IsInvalidArgument());
+    EXPECT_EQ("v", Get("k"));
+
+    // CURRENT 损坏
+    ASSERT_TRUE(WriteStringToFile(env_, "MANIFEST-000001", CurrentFileName(dbname_)).ok());
+    EXPECT_TRUE(OpenSecondary().IsCorruption());
+    EXPECT_TRUE(secondary_->TryCatchUpWithPrimary().IsInvalidArgument());
+}
+
+} // namespace tinydb
@@ -32,7 +32,7 @@ private:
     struct Node;
 
 public:
-    explicit SkipList(Comparator cmp, Arena* arean);
+    explicit SkipList(Comparator cmp, Arena* arena);
 
     SkipList(const SkipList&) = delete;
     SkipList operator=(const SkipList&) = delete;
@@ -69,7 +69,7 @@ public:
 private:
     enum { kMaxHeight = 12 };
     inline int GetMaxHeight() const {
-        return 0;
+        return max_height_.load(std::memory_order_relaxed);
     }
 
     Node* NewNode(const Key& key, int height);
@@ -259,21 +259,31 @@ typename SkipList<Key, Comparator>::Node* SkipList<Key, Comparator>::FindLast()
     Node* x = head_;
     int level = GetMaxHeight() - 1;
     while (true) {
-        Node* next = GetMaxHeight() - 1;
-        while (true) {
-            if (next == nullptr) {
-                if (level == 0) {
-                    return x;
-                } else {
-                    level--;
-                }
+        Node* next = x->Next(level);
+        if (next == nullptr) {
+            if (level == 0) {
+                return x;
             } else {
-                x = next;
+                level--;
             }
+        } else {
+            x = next;
         }
     }
 }
 
+template <typename Key, class Comparator>
+SkipList<Key, Comparator>::SkipList(Comparator cmp, Arena* arena)
+        : compare_(cmp),
+          arena_(arena),
+          head_(NewNode(0 /* any key will do */, kMaxHeight)),
+          max_height_(1),
+          rnd_(0xdeadbeef) {
+    for (int i = 0; i < kMaxHeight; i++) {
+        head_->SetNext(i, nullptr);
+    }
+}
+
 template <typename Key, class Comparator>
 void SkipList<Key, Comparator>::Insert(const Key &key) {
     Node* prev[kMaxHeight];
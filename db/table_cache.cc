@@ -0,0 +1,271 @@
+#include "db/table_cache.h"
+
+#include <vector>
+
+#include "db/blob_file_reader.h"
+#include "db/blob_format.h"
+#include "db/filename.h"
+#include "db/range_tombstone_fragmenter.h"
+#include "tinydb/env.h"
+#include "util/coding.h"
+#include "util/statistics.h"
+
+namespace tinydb {
+
+namespace {
+
+struct TableAndFile {
+    RandomAccessFile* file;
+    Table* table;
+    // 文件中没有 range tombstone 时为 nullptr
+    FragmentedRangeTombstoneList* range_dels;
+};
+
+void DeleteEntry(const Slice& key, void* value) {
+    TableAndFile* tf = reinterpret_cast<TableAndFile*>(value);
+    delete tf->range_dels;
+    delete tf->table;
+    delete tf->file;
+    delete tf;
+}
+
+void DeleteBlobEntry(const Slice& key, void* value) {
+    delete reinterpret_cast<BlobFileReader*>(value);
+}
+
+// table 文件的 key 是 8 字节的文件编号，blob 文件在前面加一个 'b'，两者不会冲突
+std::string BlobCacheKey(uint64_t file_number) {
+    std::string key(1, 'b');
+    PutFixed64(&key, file_number);
+    return key;
+}
+
+void UnrefEntry(void* arg1, void* arg2) {
+    Cache* cache = reinterpret_cast<Cache*>(arg1);
+    Cache::Handle* h = reinterpret_cast<Cache::Handle*>(arg2);
+    cache->Release(h);
+}
+
+/*
+ * row cache 中的 value：文件中 user key 最新的一个条目，与查找时的序列号无关
+ *   1 字节：是否有这个 user key 的条目
+ *   有时接着 varint32 长度 + internal key，之后是 value
+ */
+void DeleteRowEntry(const Slice& key, void* value) {
+    delete reinterpret_cast<std::string*>(value);
+}
+
+// 收集 Table::InternalGet() 找到的第一个条目
+struct RowSaver {
+    const Comparator* ucmp;
+    Slice user_key;
+    std::string* row;
+};
+
+void SaveRow(void* arg, const Slice& ikey, const Slice& v) {
+    RowSaver* saver = reinterpret_cast<RowSaver*>(arg);
+    if (ikey.size() >= 8 && saver->ucmp->Compare(ExtractUserKey(ikey), saver->user_key) == 0) {
+        saver->row->assign(1, 1);
+        PutLengthPrefixedSlice(saver->row, ikey);
+        saver->row->append(v.data(), v.size());
+    }
+}
+
+} // namespace
+
+TableCache::TableCache(const std::string& dbname, const Options& options, int entries)
+    : env_(options.env),
+      dbname_(dbname),
+      options_(options),
+      ucmp_(static_cast<const InternalKeyComparator*>(options.comparator)->user_comparator()),
+      cache_(NewLRUCache(entries)),
+      row_cache_id_(options.row_cache != nullptr ? options.row_cache->NewId() : 0) {}
+
+TableCache::~TableCache() { delete cache_; }
+
+Status TableCache::FindTable(uint64_t file_number, uint64_t file_size,
+                             Cache::Handle** handle) {
+    Status s;
+    char buf[sizeof(file_number)];
+    EncodeFixed64(buf, file_number);
+    Slice key(buf, sizeof(buf));
+    *handle = cache_->Lookup(key);
+    if (*handle != nullptr) {
+        return s;
+    }
+
+    RandomAccessFile* file = nullptr;
+    Table* table = nullptr;
+    s = env_->NewRandomAccessFile(TableFileName(dbname_, file_number), &file);
+    if (s.ok()) {
+        s = Table::Open(options_, file, file_size, &table);
+    }
+    std::vector<RangeTombstone> tombstones;
+    if (s.ok()) {
+        Iterator* range_del_iter = table->NewRangeTombstoneIterator();
+        s = ReadRangeTombstones(range_del_iter, &tombstones);
+        delete range_del_iter;
+    }
+    if (!s.ok()) {
+        // 不缓存错误，文件恢复之后可以重新打开
+        delete table;
+        delete file;
+        return s;
+    }
+
+    TableAndFile* tf = new TableAndFile;
+    tf->file = file;
+    tf->table = table;
+    tf->range_dels = tombstones.empty()
+                             ? nullptr
+                             : new FragmentedRangeTombstoneList(tombstones, ucmp_);
+    *handle = cache_->Insert(key, tf, 1, &DeleteEntry);
+    return s;
+}
+
+Iterator* TableCache::NewIterator(const ReadOptions& options, uint64_t file_number,
+                                  uint64_t file_size, Table** tableptr) {
+    if (tableptr != nullptr) {
+        *tableptr = nullptr;
+    }
+
+    Cache::Handle* handle = nullptr;
+    Status s = FindTable(file_number, file_size, &handle);
+    if (!s.ok()) {
+        return NewErrorIterator(s);
+    }
+
+    Table* table = reinterpret_cast<TableAndFile*>(cache_->Value(handle))->table;
+    Iterator* result = table->NewIterator(options);
+    result->RegisterCleanup(&UnrefEntry, cache_, handle);
+    if (tableptr != nullptr) {
+        *tableptr = table;
+    }
+    return result;
+}
+
+Status TableCache::Get(const ReadOptions& options, uint64_t file_number,
+                       uint64_t file_size, const Slice& k,
+                       SequenceNumber* max_covering_tombstone_seq, void* arg,
+                       void (*handle_result)(void*, const Slice&, const Slice&)) {
+    *max_covering_tombstone_seq = 0;
+    Cache::Handle* handle = nullptr;
+    Status s = FindTable(file_number, file_size, &handle);
+    if (s.ok()) {
+        TableAndFile* tf = reinterpret_cast<TableAndFile*>(cache_->Value(handle));
+        if (tf->range_dels != nullptr) {
+            const SequenceNumber snapshot = DecodeFixed64(k.data() + k.size() - 8) >> 8;
+            *max_covering_tombstone_seq =
+                    tf->range_dels->MaxCoveringTombstoneSeqnum(ExtractUserKey(k), snapshot);
+        }
+        bool done = false;
+        if (options_.row_cache != nullptr) {
+            s = GetFromRowCache(options, tf->table, file_number, k, arg, handle_result, &done);
+        }
+        if (s.ok() && !done) {
+            s = tf->table->InternalGet(options, k, arg, handle_result);
+        }
+        cache_->Release(handle);
+    }
+    return s;
+}
+
+Status TableCache::GetFromRowCache(const ReadOptions& options, Table* table,
+                                   uint64_t file_number, const Slice& k, void* arg,
+                                   void (*handle_result)(void*, const Slice&, const Slice&),
+                                   bool* done) {
+    Cache* row_cache = options_.row_cache;
+    const Slice user_key = ExtractUserKey(k);
+    std::string row_key;
+    PutVarint64(&row_key, row_cache_id_);
+    PutVarint64(&row_key, file_number);
+    row_key.append(user_key.data(), user_key.size());
+
+    Status s;
+    std::string fetched;
+    const std::string* row;
+    Cache::Handle* row_handle = row_cache->Lookup(row_key);
+    if (row_handle != nullptr) {
+        RecordTick(options_.statistics, ROW_CACHE_HIT);
+        row = reinterpret_cast<const std::string*>(row_cache->Value(row_handle));
+    } else {
+        RecordTick(options_.statistics, ROW_CACHE_MISS);
+        // 按最大的序列号查找，缓存的是这个 user key 最新的条目，对所有序列号都适用
+        fetched.assign(1, 0);
+        RowSaver saver;
+        saver.ucmp = ucmp_;
+        saver.user_key = user_key;
+        saver.row = &fetched;
+        LookupKey lkey(user_key, kMaxSequenceNumber);
+        s = table->InternalGet(options, lkey.internal_key(), &saver, SaveRow);
+        if (!s.ok()) {
+            return s;
+        }
+        row = &fetched;
+        if (options.fill_cache) {
+            std::string* value = new std::string(fetched);
+            row_handle = row_cache->Insert(row_key, value, row_key.size() + value->size(),
+                                           &DeleteRowEntry);
+        }
+    }
+
+    Slice input(*row);
+    Slice ikey;
+    if (input[0] == 0) {
+        *done = true;  // 文件中没有这个 user key
+    } else {
+        input.remove_prefix(1);
+        if (!GetLengthPrefixedSlice(&input, &ikey)) {
+            s = Status::Corruption("bad entry in row cache");
+        } else if (DecodeFixed64(ikey.data() + ikey.size() - 8) >> 8 <=
+                   DecodeFixed64(k.data() + k.size() - 8) >> 8) {
+            // 最新的条目对这次查找可见
+            (*handle_result)(arg, ikey, input);
+            *done = true;
+        }
+        // 否则查找的快照更旧，需要在文件中查找更早的条目
+    }
+    if (row_handle != nullptr) {
+        row_cache->Release(row_handle);
+    }
+    return s;
+}
+
+Status TableCache::FindBlobFile(uint64_t file_number, Cache::Handle** handle) {
+    const std::string key = BlobCacheKey(file_number);
+    *handle = cache_->Lookup(key);
+    if (*handle != nullptr) {
+        return Status::OK();
+    }
+    BlobFileReader* reader;
+    Status s = BlobFileReader::Open(env_, dbname_, file_number, &reader);
+    if (s.ok()) {
+        *handle = cache_->Insert(key, reader, 1, &DeleteBlobEntry);
+    } else if (s.IsNotFound()) {
+        // 被引用的 blob 文件不存在不是 key 不存在
+        s = Status::IOError("missing blob file", BlobFileName(dbname_, file_number));
+    }
+    return s;
+}
+
+Status TableCache::GetBlob(const Slice& user_key, const BlobIndex& index,
+                           std::string* value) {
+    Cache::Handle* handle = nullptr;
+    Status s = FindBlobFile(index.file_number(), &handle);
+    if (s.ok()) {
+        const BlobFileReader* reader =
+                reinterpret_cast<BlobFileReader*>(cache_->Value(handle));
+        s = reader->GetBlob(user_key, index, value);
+        cache_->Release(handle);
+    }
+    return s;
+}
+
+void TableCache::Evict(uint64_t file_number) {
+    char buf[sizeof(file_number)];
+    EncodeFixed64(buf, file_number);
+    cache_->Erase(Slice(buf, sizeof(buf)));
+    cache_->Erase(BlobCacheKey(file_number));
+}
+
+} // namespace tinydb
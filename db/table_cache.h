@@ -0,0 +1,77 @@
+#ifndef STORAGE_TINYDB_DB_TABLE_CACHE_H_
+#define STORAGE_TINYDB_DB_TABLE_CACHE_H_
+
+#include <cstdint>
+#include <string>
+
+#include "db/dbformat.h"
+#include "tinydb/cache.h"
+#include "tinydb/options.h"
+#include "tinydb/table.h"
+
+namespace tinydb {
+
+class BlobIndex;
+class Comparator;
+class Env;
+class FragmentedRangeTombstoneList;
+
+/*
+ * 缓存打开的 table 文件，用于读路径：打开 table 需要读取 footer、索引和过滤器，
+ * 每次查找都重新打开的代价太高。最多同时打开 entries 个文件，按 LRU 淘汰
+ * 打开时顺便把文件中的 range tombstone 切分好，查找时只需要一次二分查找
+ * 读取 blob 时打开的 blob 文件也缓存在这里，与 table 文件共用 entries 个名额
+ *
+ * 多个线程可以并发访问
+ */
+class TableCache {
+public:
+    // options 与传给 VersionSet 的相同，其中 comparator 是 internal key comparator
+    TableCache(const std::string& dbname, const Options& options, int entries);
+
+    TableCache(const TableCache&) = delete;
+    TableCache& operator=(const TableCache&) = delete;
+
+    ~TableCache();
+
+    // 返回遍历编号为 file_number 的 table 文件的迭代器
+    // tableptr 非空时把迭代器使用的 Table 存到 *tableptr，它在迭代器析构之前有效
+    Iterator* NewIterator(const ReadOptions& options, uint64_t file_number,
+                          uint64_t file_size, Table** tableptr = nullptr);
+
+    // 在文件中查找第一个 >= k 的条目，找到时调用 (*handle_result)(arg, key, value)
+    // *max_covering_tombstone_seq 设为文件中覆盖 k 的 user key 的 range tombstone
+    // 的最大序列号(不大于 k 的序列号)，没有时为 0
+    // 设置了 Options::row_cache 时先查它，此时文件中没有这个 user key 的条目就不会调用 handle_result
+    Status Get(const ReadOptions& options, uint64_t file_number, uint64_t file_size,
+               const Slice& k, SequenceNumber* max_covering_tombstone_seq, void* arg,
+               void (*handle_result)(void*, const Slice&, const Slice&));
+
+    // 读取 user key 为 user_key 的 BlobIndex 指向的 value，blob 文件不存在时返回 IOError
+    Status GetBlob(const Slice& user_key, const BlobIndex& index, std::string* value);
+
+    // 关闭文件(table 或 blob 文件)，文件被删除之后调用
+    void Evict(uint64_t file_number);
+
+private:
+    Status FindTable(uint64_t file_number, uint64_t file_size, Cache::Handle**);
+    Status FindBlobFile(uint64_t file_number, Cache::Handle**);
+
+    // 通过 row cache 查找 k，结果不能用于 k 的序列号时把 *done 设为 false
+    Status GetFromRowCache(const ReadOptions& options, Table* table, uint64_t file_number,
+                           const Slice& k, void* arg,
+                           void (*handle_result)(void*, const Slice&, const Slice&),
+                           bool* done);
+
+    Env* const env_;
+    const std::string dbname_;
+    const Options& options_;
+    const Comparator* const ucmp_;
+    Cache* cache_;
+    // 在 row cache 中区分不同的 TableCache，没有设置 row cache 时为 0
+    const uint64_t row_cache_id_;
+};
+
+} // namespace tinydb
+
+#endif  // STORAGE_TINYDB_DB_TABLE_CACHE_H_
@@ -0,0 +1,155 @@
+#include "db/table_cache.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "db/builder.h"
+#include "db/dbformat.h"
+#include "db/memtable.h"
+#include "db/version_edit.h"
+#include "gtest/gtest.h"
+#include "tinydb/cache.h"
+#include "tinydb/comparator.h"
+#include "tinydb/env.h"
+#include "tinydb/statistics.h"
+#include "util/testutil.h"
+
+namespace tinydb {
+
+namespace {
+
+struct Entry {
+    std::string key;
+    SequenceNumber seq;
+    ValueType type;
+    std::string value;
+};
+
+// 记录 TableCache::Get() 找到的条目，user key 不同时视为没有找到
+struct GetResult {
+    std::string user_key;
+    std::string value;
+};
+
+void SaveResult(void* arg, const Slice& ikey, const Slice& v) {
+    GetResult* result = reinterpret_cast<GetResult*>(arg);
+    ParsedInternalKey parsed;
+    if (!ParseInternalKey(ikey, &parsed)) {
+        result->value = "CORRUPT";
+    } else if (parsed.user_key == Slice(result->user_key)) {
+        result->value = parsed.type == kTypeDeletion ? "DELETED" : v.ToString();
+    }
+}
+
+} // namespace
+
+class TableCacheTest : public testing::Test {
+public:
+    TableCacheTest() : icmp_(BytewiseComparator()), statistics_(NewStatistics()) {
+        dbname_ = test::NewTestDirectory("table_cache_test");
+        row_cache_.reset(NewLRUCache(1024 * 1024));
+        options_.comparator = &icmp_;
+        options_.row_cache = row_cache_.get();
+        options_.statistics = statistics_.get();
+    }
+
+    // 把 entries 写成 dir 中编号为 number 的 table 文件，返回文件大小
+    uint64_t BuildFile(const std::string& dir, uint64_t number,
+                       const std::vector<Entry>& entries) {
+        MemTable* mem = new MemTable(icmp_, options_);
+        mem->Ref();
+        for (const Entry& e : entries) {
+            mem->Add(e.seq, e.type, e.key, e.value);
+        }
+        FileMetaData meta;
+        meta.number = number;
+        Iterator* iter = mem->NewIterator();
+        EXPECT_TRUE(BuildTable(dir, options_.env, options_, iter, &meta).ok());
+        delete iter;
+        mem->Unref();
+        return meta.file_size;
+    }
+
+    std::string Get(TableCache* cache, uint64_t number, uint64_t size, const std::string& key,
+                    SequenceNumber seq = kMaxSequenceNumber, bool fill_cache = true) {
+        ReadOptions read_options;
+        read_options.fill_cache = fill_cache;
+        LookupKey lkey(key, seq);
+        GetResult result;
+        result.user_key = key;
+        result.value = "NOT_FOUND";
+        SequenceNumber tombstone_seq;
+        Status s = cache->Get(read_options, number, size, lkey.internal_key(), &tombstone_seq,
+                              &result, SaveResult);
+        return s.ok() ? result.value : s.ToString();
+    }
+
+    uint64_t Hits() { return statistics_->GetTickerCount(ROW_CACHE_HIT); }
+    uint64_t Misses() { return statistics_->GetTickerCount(ROW_CACHE_MISS); }
+
+    std::string dbname_;
+    InternalKeyComparator icmp_;
+    std::unique_ptr<Cache> row_cache_;
+    std::unique_ptr<Statistics> statistics_;
+    Options options_;
+};
+
+TEST_F(TableCacheTest, RowCache) {
+    const uint64_t size = BuildFile(dbname_, 5,
+                                    {{"a", 5, kTypeValue, "a5"},
+                                     {"a", 3, kTypeValue, "a3"},
+                                     {"b", 4, kTypeDeletion, ""},
+                                     {"c", 6, kTypeValue, "c6"}});
+    TableCache cache(dbname_, options_, 100);
+
+    EXPECT_EQ("a5", Get(&cache, 5, size, "a"));
+    EXPECT_EQ(0u, Hits());
+    EXPECT_EQ(1u, Misses());
+    EXPECT_EQ("a5", Get(&cache, 5, size, "a"));
+    EXPECT_EQ(1u, Hits());
+
+    // 缓存的是最新的条目，更旧的快照在文件中查找更早的版本
+    EXPECT_EQ("a3", Get(&cache, 5, size, "a", 4));
+    EXPECT_EQ(2u, Hits());
+    EXPECT_EQ("NOT_FOUND", Get(&cache, 5, size, "a", 2));
+
+    // 删除标记和不存在的 key 同样被缓存
+    EXPECT_EQ("DELETED", Get(&cache, 5, size, "b"));
+    EXPECT_EQ("DELETED", Get(&cache, 5, size, "b"));
+    EXPECT_EQ("NOT_FOUND", Get(&cache, 5, size, "zz"));
+    EXPECT_EQ("NOT_FOUND", Get(&cache, 5, size, "zz"));
+    EXPECT_EQ(5u, Hits());
+    EXPECT_EQ(3u, Misses());
+
+    // fill_cache 为 false 时不加入缓存
+    EXPECT_EQ("c6", Get(&cache, 5, size, "c", kMaxSequenceNumber, false));
+    EXPECT_EQ("c6", Get(&cache, 5, size, "c", kMaxSequenceNumber, false));
+    EXPECT_EQ(5u, Misses());
+    EXPECT_EQ("c6", Get(&cache, 5, size, "c"));
+    EXPECT_EQ("c6", Get(&cache, 5, size, "c"));
+    EXPECT_EQ(6u, Hits());
+    EXPECT_EQ(6u, Misses());
+}
+
+TEST_F(TableCacheTest, SharedRowCache) {
+    // 两个数据库中编号相同的文件共享一个 row cache，互不干扰
+    const std::string other = test::NewTestDirectory("table_cache_test_other");
+    const uint64_t size1 = BuildFile(dbname_, 7, {{"k", 1, kTypeValue, "first"}});
+    const uint64_t size2 = BuildFile(other, 7, {{"k", 1, kTypeValue, "second"}});
+    TableCache cache1(dbname_, options_, 100);
+    TableCache cache2(other, options_, 100);
+    EXPECT_EQ("first", Get(&cache1, 7, size1, "k"));
+    EXPECT_EQ("second", Get(&cache2, 7, size2, "k"));
+    EXPECT_EQ("first", Get(&cache1, 7, size1, "k"));
+    EXPECT_EQ("second", Get(&cache2, 7, size2, "k"));
+    EXPECT_EQ(2u, Hits());
+    EXPECT_EQ(2u, Misses());
+    EXPECT_GT(row_cache_->TotalCharge(), 0u);
+
+    // 文件不存在时返回错误，不查 row cache
+    EXPECT_NE("NOT_FOUND", Get(&cache1, 8, size1, "k"));
+    EXPECT_EQ(2u, Misses());
+}
+
+} // namespace tinydb
@@ -0,0 +1,218 @@
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include "db/memtable_rep.h"
+
+namespace tinydb {
+
+namespace {
+
+/*
+ * 条目按插入顺序追加到从 arena 分配的定长块中，插入只是一次指针写入
+ * MarkReadOnly() 时把所有条目拷贝到一个连续数组中并行排序，之后按二分查找
+ *
+ * 可写期间读取的开销很大：Get() 是线性扫描，迭代器需要先把所有条目排序
+ */
+class VectorRep : public MemTableRep {
+public:
+    VectorRep(const MemTableKeyComparator& cmp, Arena* arena, int sort_threads)
+        : MemTableRep(arena),
+          compare_(cmp),
+          sort_threads_(sort_threads > 0 ? sort_threads : 1),
+          head_(nullptr),
+          tail_(nullptr),
+          count_(0),
+          sorted_(nullptr) {}
+
+    void Insert(const char* entry) override {
+        const size_t n = count_.load(std::memory_order_relaxed);
+        if (n % kChunkEntries == 0) {
+            char* mem = arena_->AllocateAligned(sizeof(Chunk));
+            Chunk* chunk = new (mem) Chunk;
+            if (tail_ == nullptr) {
+                head_.store(chunk, std::memory_order_release);
+            } else {
+                tail_->next.store(chunk, std::memory_order_release);
+            }
+            tail_ = chunk;
+        }
+        tail_->entries[n % kChunkEntries] = entry;
+        // 发布新的条目，读者 acquire 读到 count_ 后一定能看到前 count_ 个条目
+        count_.store(n + 1, std::memory_order_release);
+    }
+
+    void MarkReadOnly() override {
+        if (sorted_.load(std::memory_order_relaxed) != nullptr) {
+            return;
+        }
+        const size_t n = count_.load(std::memory_order_relaxed);
+        const char** entries = reinterpret_cast<const char**>(
+                arena_->AllocateAligned(sizeof(const char*) * (n > 0 ? n : 1)));
+        CopyEntries(n, entries);
+        ParallelSort(entries, n);
+        sorted_.store(entries, std::memory_order_release);
+    }
+
+    void Get(const LookupKey& k, void* arg,
+             bool (*callback)(void* arg, const char* entry)) override {
+        const char* target = k.memtable_key().data();
+        const char** sorted = sorted_.load(std::memory_order_acquire);
+        if (sorted != nullptr) {
+            const size_t n = count_.load(std::memory_order_relaxed);
+            const char** p = LowerBound(sorted, n, target);
+            for (; p != sorted + n && (*callback)(arg, *p); ++p) {
+            }
+            return;
+        }
+
+        // 还没有排序，线性扫描找到第一个 >= target 的条目
+        const char* first = nullptr;
+        const size_t n = count_.load(std::memory_order_acquire);
+        Chunk* chunk = head_.load(std::memory_order_acquire);
+        for (size_t i = 0; i < n; i++) {
+            if (i > 0 && i % kChunkEntries == 0) {
+                chunk = chunk->next.load(std::memory_order_acquire);
+            }
+            const char* entry = chunk->entries[i % kChunkEntries];
+            if (compare_(entry, target) >= 0 &&
+                (first == nullptr || compare_(entry, first) < 0)) {
+                first = entry;
+            }
+        }
+        if (first != nullptr && (*callback)(arg, first)) {
+            // 调用者还需要后面的条目，只能排序
+            MemTableRep::Iterator* iter = GetIterator();
+            for (iter->Seek(first), iter->Next();
+                 iter->Valid() && (*callback)(arg, iter->key()); iter->Next()) {
+            }
+            delete iter;
+        }
+    }
+
+    bool IsOrdered() const override {
+        return sorted_.load(std::memory_order_acquire) != nullptr;
+    }
+
+    Iterator* GetIterator() override {
+        const char** sorted = sorted_.load(std::memory_order_acquire);
+        if (sorted != nullptr) {
+            return NewSortedArrayIterator(sorted, count_.load(std::memory_order_relaxed),
+                                          compare_);
+        }
+        const size_t n = count_.load(std::memory_order_acquire);
+        std::vector<const char*>* entries = new std::vector<const char*>(n);
+        CopyEntries(n, entries->data());
+        std::sort(entries->begin(), entries->end(), Less(compare_));
+        return NewSortedEntryIterator(entries, compare_);
+    }
+
+private:
+    enum { kChunkEntries = 1024 };
+
+    struct Chunk {
+        Chunk() : next(nullptr) {}
+
+        std::atomic<Chunk*> next;
+        const char* entries[kChunkEntries];
+    };
+
+    struct Less {
+        explicit Less(const MemTableKeyComparator& c) : cmp(c) {}
+        bool operator()(const char* a, const char* b) const { return cmp(a, b) < 0; }
+
+        const MemTableKeyComparator& cmp;
+    };
+
+    // 把前 n 个条目拷贝到 out
+    void CopyEntries(size_t n, const char** out) const {
+        Chunk* chunk = head_.load(std::memory_order_acquire);
+        for (size_t i = 0; i < n; i += kChunkEntries) {
+            const size_t m = std::min<size_t>(n - i, kChunkEntries);
+            std::copy(chunk->entries, chunk->entries + m, out + i);
+            chunk = chunk->next.load(std::memory_order_acquire);
+        }
+    }
+
+    const char** LowerBound(const char** entries, size_t n, const char* target) const {
+        return std::lower_bound(entries, entries + n, target, Less(compare_));
+    }
+
+    /*
+     * 把 entries 切成 sort_threads_ 段分别在不同线程中排序，再两两归并
+     * 同一轮的多次归并之间没有重叠，也并行执行
+     */
+    void ParallelSort(const char** entries, size_t n) const {
+        // 条目太少时启动线程的开销超过排序本身
+        static const size_t kMinEntriesPerThread = 16 * 1024;
+
+        const size_t parts = std::max<size_t>(
+                1, std::min<size_t>(sort_threads_, n / kMinEntriesPerThread));
+        std::vector<size_t> bounds(parts + 1);
+        for (size_t i = 0; i <= parts; i++) {
+            bounds[i] = n * i / parts;
+        }
+        const Less less(compare_);
+
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < parts; i++) {
+            threads.emplace_back([&, i]() {
+                std::sort(entries + bounds[i], entries + bounds[i + 1], less);
+            });
+        }
+        std::sort(entries + bounds[0], entries + bounds[1], less);
+        for (std::thread& t : threads) {
+            t.join();
+        }
+
+        for (size_t width = 1; width < parts; width *= 2) {
+            threads.clear();
+            for (size_t i = 0; i + width < parts; i += 2 * width) {
+                const size_t first = bounds[i];
+                const size_t middle = bounds[i + width];
+                const size_t last = bounds[std::min(i + 2 * width, parts)];
+                threads.emplace_back([=, &less]() {
+                    std::inplace_merge(entries + first, entries + middle,
+                                       entries + last, less);
+                });
+            }
+            for (std::thread& t : threads) {
+                t.join();
+            }
+        }
+    }
+
+    const MemTableKeyComparator& compare_;
+    const int sort_threads_;
+
+    std::atomic<Chunk*> head_;
+    Chunk* tail_;  // 只有写线程访问
+    std::atomic<size_t> count_;
+    // MarkReadOnly() 之后指向排好序的 count_ 个条目，之前为 nullptr
+    std::atomic<const char**> sorted_;
+};
+
+class VectorRepFactory : public MemTableRepFactory {
+public:
+    explicit VectorRepFactory(int sort_threads) : sort_threads_(sort_threads) {}
+
+    const char* Name() const override { return "VectorRepFactory"; }
+
+    MemTableRep* CreateMemTableRep(const MemTableKeyComparator& cmp, Arena* arena,
+                                   const SliceTransform* prefix_extractor) override {
+        return new VectorRep(cmp, arena, sort_threads_);
+    }
+
+private:
+    const int sort_threads_;
+};
+
+} // namespace
+
+MemTableRepFactory* NewVectorRepFactory(int sort_threads) {
+    return new VectorRepFactory(sort_threads);
+}
+
+} // namespace tinydb
@@ -0,0 +1,428 @@
+#include "db/version_edit.h"
+
+#include "db/version_set.h"
+#include "util/coding.h"
+
+namespace tinydb {
+
+// 写入 manifest 的字段标签，会持久化到磁盘上，不能修改
+enum Tag {
+    kComparator = 1,
+    kLogNumber = 2,
+    kNextFileNumber = 3,
+    kLastSequence = 4,
+    kCompactPointer = 5,
+    kDeletedFile = 6,
+    kNewFile = 7,
+    // 8 was used for large value refs
+    kPrevLogNumber = 9,
+    kNewBlobFile = 10,
+    kBlobFileGarbage = 11,
+    // 与 kNewFile 相同，后面多一个 oldest_blob_file_number
+    kNewFileWithBlobRef = 12,
+    // 与 kNewFileWithBlobRef 相同，后面多一个 file_creation_time
+    kNewFileWithCreationTime = 13,
+    // column family 的注册表，只出现在 default column family 的 manifest 中
+    kColumnFamilyAdd = 14,
+    kColumnFamilyDrop = 15,
+    kMaxColumnFamily = 16
+};
+
+void VersionEdit::Clear() {
+    comparator_.clear();
+    log_number_ = 0;
+    prev_log_number_ = 0;
+    last_sequence_ = 0;
+    next_file_number_ = 0;
+    max_column_family_ = 0;
+    has_comparator_ = false;
+    has_log_number_ = false;
+    has_prev_log_number_ = false;
+    has_next_file_number_ = false;
+    has_last_sequence_ = false;
+    has_max_column_family_ = false;
+    compact_pointers_.clear();
+    deleted_files_.clear();
+    new_files_.clear();
+    new_blob_files_.clear();
+    blob_file_garbages_.clear();
+    added_column_families_.clear();
+    dropped_column_families_.clear();
+}
+
+void VersionEdit::EncodeTo(std::string* dst) const {
+    if (has_comparator_) {
+        PutVarint32(dst, kComparator);
+        PutLengthPrefixedSlice(dst, comparator_);
+    }
+    if (has_log_number_) {
+        PutVarint32(dst, kLogNumber);
+        PutVarint64(dst, log_number_);
+    }
+    if (has_prev_log_number_) {
+        PutVarint32(dst, kPrevLogNumber);
+        PutVarint64(dst, prev_log_number_);
+    }
+    if (has_next_file_number_) {
+        PutVarint32(dst, kNextFileNumber);
+        PutVarint64(dst, next_file_number_);
+    }
+    if (has_last_sequence_) {
+        PutVarint32(dst, kLastSequence);
+        PutVarint64(dst, last_sequence_);
+    }
+
+    for (size_t i = 0; i < compact_pointers_.size(); i++) {
+        PutVarint32(dst, kCompactPointer);
+        PutVarint32(dst, compact_pointers_[i].first);  // level
+        PutLengthPrefixedSlice(dst, compact_pointers_[i].second.Encode());
+    }
+
+    for (const auto& deleted_file_kvp : deleted_files_) {
+        PutVarint32(dst, kDeletedFile);
+        PutVarint32(dst, deleted_file_kvp.first);   // level
+        PutVarint64(dst, deleted_file_kvp.second);  // file number
+    }
+
+    for (size_t i = 0; i < new_files_.size(); i++) {
+        const FileMetaData& f = new_files_[i].second;
+        // 没有新的字段时仍然使用旧的格式
+        const bool has_creation_time = f.file_creation_time != 0;
+        const bool has_blob_ref =
+                has_creation_time ||
+                f.oldest_blob_file_number != kInvalidBlobFileNumber;
+        PutVarint32(dst, has_creation_time ? kNewFileWithCreationTime
+                         : has_blob_ref    ? kNewFileWithBlobRef
+                                           : kNewFile);
+        PutVarint32(dst, new_files_[i].first);  // level
+        PutVarint64(dst, f.number);
+        PutVarint64(dst, f.file_size);
+        PutLengthPrefixedSlice(dst, f.smallest.Encode());
+        PutLengthPrefixedSlice(dst, f.largest.Encode());
+        if (has_blob_ref) {
+            PutVarint64(dst, f.oldest_blob_file_number);
+        }
+        if (has_creation_time) {
+            PutVarint64(dst, f.file_creation_time);
+        }
+    }
+
+    for (size_t i = 0; i < new_blob_files_.size(); i++) {
+        const BlobFileMetaData& b = new_blob_files_[i];
+        PutVarint32(dst, kNewBlobFile);
+        PutVarint64(dst, b.number);
+        PutVarint64(dst, b.total_blob_count);
+        PutVarint64(dst, b.total_blob_bytes);
+    }
+
+    for (size_t i = 0; i < blob_file_garbages_.size(); i++) {
+        const BlobFileMetaData& b = blob_file_garbages_[i];
+        PutVarint32(dst, kBlobFileGarbage);
+        PutVarint64(dst, b.number);
+        PutVarint64(dst, b.garbage_blob_count);
+        PutVarint64(dst, b.garbage_blob_bytes);
+    }
+
+    for (size_t i = 0; i < added_column_families_.size(); i++) {
+        PutVarint32(dst, kColumnFamilyAdd);
+        PutVarint32(dst, added_column_families_[i].first);
+        PutLengthPrefixedSlice(dst, added_column_families_[i].second);
+    }
+    for (size_t i = 0; i < dropped_column_families_.size(); i++) {
+        PutVarint32(dst, kColumnFamilyDrop);
+        PutVarint32(dst, dropped_column_families_[i]);
+    }
+    if (has_max_column_family_) {
+        PutVarint32(dst, kMaxColumnFamily);
+        PutVarint32(dst, max_column_family_);
+    }
+}
+
+static bool GetInternalKey(Slice* input, InternalKey* dst) {
+    Slice str;
+    if (GetLengthPrefixedSlice(input, &str)) {
+        return dst->DecodeFrom(str);
+    } else {
+        return false;
+    }
+}
+
+static bool GetLevel(Slice* input, int* level) {
+    uint32_t v;
+    if (GetVarint32(input, &v) && v < config::kNumLevels) {
+        *level = v;
+        return true;
+    } else {
+        return false;
+    }
+}
+
+Status VersionEdit::DecodeFrom(const Slice& src) {
+    Clear();
+    Slice input = src;
+    const char* msg = nullptr;
+    uint32_t tag;
+
+    // Temporary storage for parsing
+    int level;
+    uint64_t number;
+    FileMetaData f;
+    BlobFileMetaData b;
+    Slice str;
+    InternalKey key;
+    uint32_t column_family;
+
+    while (msg == nullptr && GetVarint32(&input, &tag)) {
+        switch (tag) {
+            case kComparator:
+                if (GetLengthPrefixedSlice(&input, &str)) {
+                    comparator_ = str.ToString();
+                    has_comparator_ = true;
+                } else {
+                    msg = "comparator name";
+                }
+                break;
+
+            case kLogNumber:
+                if (GetVarint64(&input, &log_number_)) {
+                    has_log_number_ = true;
+                } else {
+                    msg = "log number";
+                }
+                break;
+
+            case kPrevLogNumber:
+                if (GetVarint64(&input, &prev_log_number_)) {
+                    has_prev_log_number_ = true;
+                } else {
+                    msg = "previous log number";
+                }
+                break;
+
+            case kNextFileNumber:
+                if (GetVarint64(&input, &next_file_number_)) {
+                    has_next_file_number_ = true;
+                } else {
+                    msg = "next file number";
+                }
+                break;
+
+            case kLastSequence:
+                if (GetVarint64(&input, &last_sequence_)) {
+                    has_last_sequence_ = true;
+                } else {
+                    msg = "last sequence number";
+                }
+                break;
+
+            case kCompactPointer:
+                if (GetLevel(&input, &level) && GetInternalKey(&input, &key)) {
+                    compact_pointers_.push_back(std::make_pair(level, key));
+                } else {
+                    msg = "compaction pointer";
+                }
+                break;
+
+            case kDeletedFile:
+                if (GetLevel(&input, &level) && GetVarint64(&input, &number)) {
+                    deleted_files_.insert(std::make_pair(level, number));
+                } else {
+                    msg = "deleted file";
+                }
+                break;
+
+            case kNewFile:
+                if (GetLevel(&input, &level) && GetVarint64(&input, &f.number) &&
+                    GetVarint64(&input, &f.file_size) &&
+                    GetInternalKey(&input, &f.smallest) &&
+                    GetInternalKey(&input, &f.largest)) {
+                    new_files_.push_back(std::make_pair(level, f));
+                } else {
+                    msg = "new-file entry";
+                }
+                break;
+
+            case kNewFileWithBlobRef:
+                if (GetLevel(&input, &level) && GetVarint64(&input, &f.number) &&
+                    GetVarint64(&input, &f.file_size) &&
+                    GetInternalKey(&input, &f.smallest) &&
+                    GetInternalKey(&input, &f.largest) &&
+                    GetVarint64(&input, &f.oldest_blob_file_number)) {
+                    new_files_.push_back(std::make_pair(level, f));
+                    f.oldest_blob_file_number = kInvalidBlobFileNumber;
+                } else {
+                    msg = "new-file entry";
+                }
+                break;
+
+            case kNewFileWithCreationTime:
+                if (GetLevel(&input, &level) && GetVarint64(&input, &f.number) &&
+                    GetVarint64(&input, &f.file_size) &&
+                    GetInternalKey(&input, &f.smallest) &&
+                    GetInternalKey(&input, &f.largest) &&
+                    GetVarint64(&input, &f.oldest_blob_file_number) &&
+                    GetVarint64(&input, &f.file_creation_time)) {
+                    new_files_.push_back(std::make_pair(level, f));
+                    f.oldest_blob_file_number = kInvalidBlobFileNumber;
+                    f.file_creation_time = 0;
+                } else {
+                    msg = "new-file entry";
+                }
+                break;
+
+            case kNewBlobFile:
+                if (GetVarint64(&input, &b.number) &&
+                    GetVarint64(&input, &b.total_blob_count) &&
+                    GetVarint64(&input, &b.total_blob_bytes)) {
+                    AddBlobFile(b.number, b.total_blob_count, b.total_blob_bytes);
+                } else {
+                    msg = "new-blob-file entry";
+                }
+                break;
+
+            case kBlobFileGarbage:
+                if (GetVarint64(&input, &b.number) &&
+                    GetVarint64(&input, &b.garbage_blob_count) &&
+                    GetVarint64(&input, &b.garbage_blob_bytes)) {
+                    AddBlobFileGarbage(b.number, b.garbage_blob_count,
+                                       b.garbage_blob_bytes);
+                } else {
+                    msg = "blob-file-garbage entry";
+                }
+                break;
+
+            case kColumnFamilyAdd:
+                if (GetVarint32(&input, &column_family) &&
+                    GetLengthPrefixedSlice(&input, &str)) {
+                    AddColumnFamily(column_family, str);
+                } else {
+                    msg = "column-family-add entry";
+                }
+                break;
+
+            case kColumnFamilyDrop:
+                if (GetVarint32(&input, &column_family)) {
+                    DropColumnFamily(column_family);
+                } else {
+                    msg = "column-family-drop entry";
+                }
+                break;
+
+            case kMaxColumnFamily:
+                if (GetVarint32(&input, &max_column_family_)) {
+                    has_max_column_family_ = true;
+                } else {
+                    msg = "max column family";
+                }
+                break;
+
+            default:
+                msg = "unknown tag";
+                break;
+        }
+    }
+
+    if (msg == nullptr && !input.empty()) {
+        msg = "invalid tag";
+    }
+
+    Status result;
+    if (msg != nullptr) {
+        result = Status::Corruption("VersionEdit", msg);
+    }
+    return result;
+}
+
+std::string VersionEdit::DebugString() const {
+    std::string r;
+    r.append("VersionEdit {");
+    if (has_comparator_) {
+        r.append("\n  Comparator: ");
+        r.append(comparator_);
+    }
+    if (has_log_number_) {
+        r.append("\n  LogNumber: ");
+        r.append(std::to_string(log_number_));
+    }
+    if (has_prev_log_number_) {
+        r.append("\n  PrevLogNumber: ");
+        r.append(std::to_string(prev_log_number_));
+    }
+    if (has_next_file_number_) {
+        r.append("\n  NextFile: ");
+        r.append(std::to_string(next_file_number_));
+    }
+    if (has_last_sequence_) {
+        r.append("\n  LastSeq: ");
+        r.append(std::to_string(last_sequence_));
+    }
+    for (size_t i = 0; i < compact_pointers_.size(); i++) {
+        r.append("\n  CompactPointer: ");
+        r.append(std::to_string(compact_pointers_[i].first));
+        r.append(" ");
+        r.append(compact_pointers_[i].second.DebugString());
+    }
+    for (const auto& deleted_files_kvp : deleted_files_) {
+        r.append("\n  RemoveFile: ");
+        r.append(std::to_string(deleted_files_kvp.first));
+        r.append(" ");
+        r.append(std::to_string(deleted_files_kvp.second));
+    }
+    for (size_t i = 0; i < new_files_.size(); i++) {
+        const FileMetaData& f = new_files_[i].second;
+        r.append("\n  AddFile: ");
+        r.append(std::to_string(new_files_[i].first));
+        r.append(" ");
+        r.append(std::to_string(f.number));
+        r.append(" ");
+        r.append(std::to_string(f.file_size));
+        r.append(" ");
+        r.append(f.smallest.DebugString());
+        r.append(" .. ");
+        r.append(f.largest.DebugString());
+        if (f.oldest_blob_file_number != kInvalidBlobFileNumber) {
+            r.append(" blob ");
+            r.append(std::to_string(f.oldest_blob_file_number));
+        }
+        if (f.file_creation_time != 0) {
+            r.append(" created ");
+            r.append(std::to_string(f.file_creation_time));
+        }
+    }
+    for (size_t i = 0; i < new_blob_files_.size(); i++) {
+        const BlobFileMetaData& b = new_blob_files_[i];
+        r.append("\n  AddBlobFile: ");
+        r.append(std::to_string(b.number));
+        r.append(" ");
+        r.append(std::to_string(b.total_blob_count));
+        r.append(" ");
+        r.append(std::to_string(b.total_blob_bytes));
+    }
+    for (size_t i = 0; i < blob_file_garbages_.size(); i++) {
+        const BlobFileMetaData& b = blob_file_garbages_[i];
+        r.append("\n  BlobFileGarbage: ");
+        r.append(std::to_string(b.number));
+        r.append(" ");
+        r.append(std::to_string(b.garbage_blob_count));
+        r.append(" ");
+        r.append(std::to_string(b.garbage_blob_bytes));
+    }
+    for (size_t i = 0; i < added_column_families_.size(); i++) {
+        r.append("\n  AddColumnFamily: ");
+        r.append(std::to_string(added_column_families_[i].first));
+        r.append(" ");
+        r.append(added_column_families_[i].second);
+    }
+    for (size_t i = 0; i < dropped_column_families_.size(); i++) {
+        r.append("\n  DropColumnFamily: ");
+        r.append(std::to_string(dropped_column_families_[i]));
+    }
+    if (has_max_column_family_) {
+        r.append("\n  MaxColumnFamily: ");
+        r.append(std::to_string(max_column_family_));
+    }
+    r.append("\n}\n");
+    return r;
+}
+
+} // namespace tinydb
@@ -0,0 +1,186 @@
+#ifndef STORAGE_TINYDB_DB_VERSION_EDIT_H_
+#define STORAGE_TINYDB_DB_VERSION_EDIT_H_
+
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "db/blob_format.h"
+#include "db/dbformat.h"
+#include "tinydb/status.h"
+
+namespace tinydb {
+
+class VersionSet;
+
+// 一个 sstable 文件的元数据
+struct FileMetaData {
+    FileMetaData()
+        : refs(0),
+          allowed_seeks(1 << 30),
+          file_size(0),
+          oldest_blob_file_number(kInvalidBlobFileNumber),
+          file_creation_time(0) {}
+
+    int refs;
+    int allowed_seeks;  // 允许的 seek 次数，用完之后触发 compaction
+    uint64_t number;
+    uint64_t file_size;    // File size in bytes
+    InternalKey smallest;  // Smallest internal key served by table
+    InternalKey largest;   // Largest internal key served by table
+    // 文件中的 BlobIndex 引用的编号最小的 blob 文件，没有引用时为 kInvalidBlobFileNumber
+    uint64_t oldest_blob_file_number;
+    // 文件中数据最早的生成时间(unix 时间，秒)：flush 的时间，或者 compaction 的输入中
+    // 最早的生成时间。0 表示未知。FIFO compaction 按它判断文件是否过期
+    uint64_t file_creation_time;
+};
+
+/*
+ * 一个 blob 文件的元数据
+ * garbage 是已经没有 BlobIndex 引用的 blob(被覆盖、删除，或被 GC 搬走)，
+ * compaction 丢掉或搬走 BlobIndex 时累加。garbage 达到 total 时文件不再被任何版本需要
+ */
+struct BlobFileMetaData {
+    BlobFileMetaData()
+        : refs(0),
+          number(0),
+          total_blob_count(0),
+          total_blob_bytes(0),
+          garbage_blob_count(0),
+          garbage_blob_bytes(0) {}
+
+    int refs;
+    uint64_t number;
+    uint64_t total_blob_count;
+    uint64_t total_blob_bytes;  // value 字节数之和，不含 record 头部和 key
+    uint64_t garbage_blob_count;
+    uint64_t garbage_blob_bytes;
+};
+
+/*
+ * 版本之间的增量：新增/删除了哪些文件，以及日志编号、序列号等元数据的变化
+ * 每次 flush/compaction 产生一个 VersionEdit，编码后作为一条记录追加到 manifest 中
+ */
+class VersionEdit {
+public:
+    VersionEdit() { Clear(); }
+    ~VersionEdit() = default;
+
+    void Clear();
+
+    void SetComparatorName(const Slice& name) {
+        has_comparator_ = true;
+        comparator_ = name.ToString();
+    }
+    void SetLogNumber(uint64_t num) {
+        has_log_number_ = true;
+        log_number_ = num;
+    }
+    void SetPrevLogNumber(uint64_t num) {
+        has_prev_log_number_ = true;
+        prev_log_number_ = num;
+    }
+    void SetNextFile(uint64_t num) {
+        has_next_file_number_ = true;
+        next_file_number_ = num;
+    }
+    void SetLastSequence(SequenceNumber seq) {
+        has_last_sequence_ = true;
+        last_sequence_ = seq;
+    }
+    void SetCompactPointer(int level, const InternalKey& key) {
+        compact_pointers_.push_back(std::make_pair(level, key));
+    }
+
+    // 在 level 层新增一个文件
+    // REQUIRES: This version has not been saved (see VersionSet::SaveTo)
+    // REQUIRES: "smallest" and "largest" are smallest and largest keys in file
+    // oldest_blob_file_number 为文件中 BlobIndex 引用的最小的 blob 文件编号
+    void AddFile(int level, uint64_t file, uint64_t file_size,
+                 const InternalKey& smallest, const InternalKey& largest,
+                 uint64_t oldest_blob_file_number = kInvalidBlobFileNumber,
+                 uint64_t file_creation_time = 0) {
+        FileMetaData f;
+        f.number = file;
+        f.file_size = file_size;
+        f.smallest = smallest;
+        f.largest = largest;
+        f.oldest_blob_file_number = oldest_blob_file_number;
+        f.file_creation_time = file_creation_time;
+        new_files_.push_back(std::make_pair(level, f));
+    }
+
+    // 从 level 层删除一个文件
+    void RemoveFile(int level, uint64_t file) {
+        deleted_files_.insert(std::make_pair(level, file));
+    }
+
+    // 新增一个 blob 文件
+    void AddBlobFile(uint64_t number, uint64_t total_blob_count,
+                     uint64_t total_blob_bytes) {
+        BlobFileMetaData b;
+        b.number = number;
+        b.total_blob_count = total_blob_count;
+        b.total_blob_bytes = total_blob_bytes;
+        new_blob_files_.push_back(b);
+    }
+
+    // blob 文件 number 新增的 garbage，与之前记录的 garbage 累加
+    void AddBlobFileGarbage(uint64_t number, uint64_t garbage_blob_count,
+                            uint64_t garbage_blob_bytes) {
+        BlobFileMetaData b;
+        b.number = number;
+        b.garbage_blob_count = garbage_blob_count;
+        b.garbage_blob_bytes = garbage_blob_bytes;
+        blob_file_garbages_.push_back(b);
+    }
+
+    // 注册/删除一个 column family，只用于 default column family 的 VersionSet
+    void AddColumnFamily(uint32_t id, const Slice& name) {
+        added_column_families_.push_back(std::make_pair(id, name.ToString()));
+    }
+    void DropColumnFamily(uint32_t id) { dropped_column_families_.push_back(id); }
+
+    // 分配过的最大的 column family 编号，删除的编号不会再被使用
+    void SetMaxColumnFamily(uint32_t id) {
+        has_max_column_family_ = true;
+        max_column_family_ = id;
+    }
+
+    void EncodeTo(std::string* dst) const;
+    Status DecodeFrom(const Slice& src);
+
+    std::string DebugString() const;
+
+private:
+    friend class VersionSet;
+
+    typedef std::set<std::pair<int, uint64_t>> DeletedFileSet;
+
+    std::string comparator_;
+    uint64_t log_number_;
+    uint64_t prev_log_number_;
+    uint64_t next_file_number_;
+    SequenceNumber last_sequence_;
+    uint32_t max_column_family_;
+    bool has_comparator_;
+    bool has_log_number_;
+    bool has_prev_log_number_;
+    bool has_next_file_number_;
+    bool has_last_sequence_;
+    bool has_max_column_family_;
+
+    std::vector<std::pair<int, InternalKey>> compact_pointers_;
+    DeletedFileSet deleted_files_;
+    std::vector<std::pair<int, FileMetaData>> new_files_;
+    std::vector<BlobFileMetaData> new_blob_files_;
+    // 只使用 number 和 garbage_* 字段
+    std::vector<BlobFileMetaData> blob_file_garbages_;
+    std::vector<std::pair<uint32_t, std::string>> added_column_families_;
+    std::vector<uint32_t> dropped_column_families_;
+};
+
+} // namespace tinydb
+
+#endif  // STORAGE_TINYDB_DB_VERSION_EDIT_H_
@@ -0,0 +1,1249 @@
+#include "db/version_set.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#include "db/blob_format.h"
+#include "db/compaction.h"
+#include "db/compaction_picker.h"
+#include "db/filename.h"
+#include "db/log_reader.h"
+#include "db/log_writer.h"
+#include "db/merge_helper.h"
+#include "db/table_cache.h"
+#include "tinydb/env.h"
+#include "util/coding.h"
+
+namespace tinydb {
+
+int64_t TotalFileSize(const std::vector<FileMetaData*>& files) {
+    int64_t sum = 0;
+    for (size_t i = 0; i < files.size(); i++) {
+        sum += files[i]->file_size;
+    }
+    return sum;
+}
+
+Version::~Version() {
+    assert(refs_ == 0);
+
+    // Remove from linked list
+    prev_->next_ = next_;
+    next_->prev_ = prev_;
+
+    // Drop references to files
+    for (int level = 0; level < config::kNumLevels; level++) {
+        for (size_t i = 0; i < files_[level].size(); i++) {
+            FileMetaData* f = files_[level][i];
+            assert(f->refs > 0);
+            f->refs--;
+            if (f->refs <= 0) {
+                delete f;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < blob_files_.size(); i++) {
+        BlobFileMetaData* b = blob_files_[i];
+        assert(b->refs > 0);
+        b->refs--;
+        if (b->refs <= 0) {
+            delete b;
+        }
+    }
+}
+
+int FindFile(const InternalKeyComparator& icmp,
+             const std::vector<FileMetaData*>& files, const Slice& key) {
+    uint32_t left = 0;
+    uint32_t right = files.size();
+    while (left < right) {
+        uint32_t mid = (left + right) / 2;
+        const FileMetaData* f = files[mid];
+        if (icmp.InternalKeyComparator::Compare(f->largest.Encode(), key) < 0) {
+            // Key at "mid.largest" is < "target".  Therefore all
+            // files at or before "mid" are uninteresting.
+            left = mid + 1;
+        } else {
+            // Key at "mid.largest" is >= "target".  Therefore all files
+            // after "mid" are uninteresting.
+            right = mid;
+        }
+    }
+    return right;
+}
+
+static bool AfterFile(const Comparator* ucmp, const Slice* user_key,
+                      const FileMetaData* f) {
+    // null user_key occurs before all keys and is therefore never after *f
+    return (user_key != nullptr &&
+            ucmp->Compare(*user_key, f->largest.user_key()) > 0);
+}
+
+static bool BeforeFile(const Comparator* ucmp, const Slice* user_key,
+                       const FileMetaData* f) {
+    // null user_key occurs after all keys and is therefore never before *f
+    return (user_key != nullptr &&
+            ucmp->Compare(*user_key, f->smallest.user_key()) < 0);
+}
+
+bool SomeFileOverlapsRange(const InternalKeyComparator& icmp,
+                           bool disjoint_sorted_files,
+                           const std::vector<FileMetaData*>& files,
+                           const Slice* smallest_user_key,
+                           const Slice* largest_user_key) {
+    const Comparator* ucmp = icmp.user_comparator();
+    if (!disjoint_sorted_files) {
+        // Need to check against all files
+        for (size_t i = 0; i < files.size(); i++) {
+            const FileMetaData* f = files[i];
+            if (AfterFile(ucmp, smallest_user_key, f) ||
+                BeforeFile(ucmp, largest_user_key, f)) {
+                // No overlap
+            } else {
+                return true;  // Overlap
+            }
+        }
+        return false;
+    }
+
+    // Binary search over file list
+    uint32_t index = 0;
+    if (smallest_user_key != nullptr) {
+        // Find the earliest possible internal key for smallest_user_key
+        InternalKey small_key(*smallest_user_key, kMaxSequenceNumber,
+                              kValueTypeForSeek);
+        index = FindFile(icmp, files, small_key.Encode());
+    }
+
+    if (index >= files.size()) {
+        // beginning of range is after all files, so no overlap.
+        return false;
+    }
+
+    return !BeforeFile(ucmp, largest_user_key, files[index]);
+}
+
+bool Version::OverlapInLevel(int level, const Slice* smallest_user_key,
+                             const Slice* largest_user_key) {
+    return SomeFileOverlapsRange(vset_->icmp_, (level > 0), files_[level],
+                                 smallest_user_key, largest_user_key);
+}
+
+uint64_t Version::BlobGCCutoffFileNumber(double age_cutoff) const {
+    const size_t cutoff_index =
+            static_cast<size_t>(age_cutoff * blob_files_.size());
+    if (cutoff_index >= blob_files_.size()) {
+        return ~static_cast<uint64_t>(0);
+    }
+    return blob_files_[cutoff_index]->number;
+}
+
+void Version::GetOverlappingInputs(int level, const InternalKey* begin,
+                                   const InternalKey* end,
+                                   std::vector<FileMetaData*>* inputs) {
+    assert(level >= 0);
+    assert(level < config::kNumLevels);
+    inputs->clear();
+    Slice user_begin, user_end;
+    if (begin != nullptr) {
+        user_begin = begin->user_key();
+    }
+    if (end != nullptr) {
+        user_end = end->user_key();
+    }
+    const Comparator* user_cmp = vset_->icmp_.user_comparator();
+    for (size_t i = 0; i < files_[level].size();) {
+        FileMetaData* f = files_[level][i++];
+        const Slice file_start = f->smallest.user_key();
+        const Slice file_limit = f->largest.user_key();
+        if (begin != nullptr && user_cmp->Compare(file_limit, user_begin) < 0) {
+            // "f" is completely before specified range; skip it
+        } else if (end != nullptr && user_cmp->Compare(file_start, user_end) > 0) {
+            // "f" is completely after specified range; skip it
+        } else {
+            inputs->push_back(f);
+            if (level == 0) {
+                // L0 的文件可能互相重叠，区间被扩大时从头重新找
+                if (begin != nullptr && user_cmp->Compare(file_start, user_begin) < 0) {
+                    user_begin = file_start;
+                    inputs->clear();
+                    i = 0;
+                } else if (end != nullptr &&
+                           user_cmp->Compare(file_limit, user_end) > 0) {
+                    user_end = file_limit;
+                    inputs->clear();
+                    i = 0;
+                }
+            }
+        }
+    }
+}
+
+namespace {
+
+// Version::Get() 在一个文件中找到的第一个 >= 查找 key 的条目
+struct Saver {
+    enum State { kNotFound, kFound, kCorrupt };
+
+    State state;
+    const Comparator* ucmp;
+    Slice user_key;
+    ValueType type;
+    SequenceNumber sequence;
+    std::string* value;
+};
+
+void SaveValue(void* arg, const Slice& ikey, const Slice& v) {
+    Saver* s = reinterpret_cast<Saver*>(arg);
+    ParsedInternalKey parsed;
+    if (!ParseInternalKey(ikey, &parsed)) {
+        s->state = Saver::kCorrupt;
+    } else if (s->ucmp->Compare(parsed.user_key, s->user_key) == 0) {
+        s->state = Saver::kFound;
+        s->type = parsed.type;
+        s->sequence = parsed.sequence;
+        s->value->assign(v.data(), v.size());
+    }
+}
+
+bool NewestFirst(FileMetaData* a, FileMetaData* b) { return a->number > b->number; }
+
+} // namespace
+
+Status Version::ResolveBlobIndex(const Slice& user_key, const Slice& blob_index,
+                                 TableCache* table_cache, std::string* value) const {
+    BlobIndex index;
+    Status s = index.DecodeFrom(blob_index);
+    if (s.ok()) {
+        s = table_cache->GetBlob(user_key, index, value);
+    }
+    return s;
+}
+
+Status Version::Get(const ReadOptions& options, const LookupKey& k, std::string* value,
+                    TableCache* table_cache, MergeContext* merge_context) {
+    const Comparator* ucmp = vset_->icmp_.user_comparator();
+    const Slice ikey = k.internal_key();
+    const Slice user_key = k.user_key();
+
+    // 找到值或删除记录时与已经收集到的操作数合并，existing 为 nullptr 表示不存在
+    auto finish = [&](const Slice* existing) -> Status {
+        if (merge_context == nullptr || merge_context->empty()) {
+            if (existing == nullptr) {
+                return Status::NotFound(Slice());
+            }
+            value->assign(existing->data(), existing->size());
+            return Status::OK();
+        }
+        std::string result;
+        Status s = FullMergeOperands(vset_->options_->merge_operator, user_key, existing,
+                                     merge_context->GetOperandsOldestFirst(), &result);
+        if (s.ok()) {
+            value->swap(result);
+        }
+        return s;
+    };
+
+    // 按从新到旧的顺序排列可能包含 key 的文件：L0 的文件互相重叠，按编号从大到小都要查；
+    // 其他层最多只有一个文件
+    std::vector<FileMetaData*> candidates;
+    for (FileMetaData* f : files_[0]) {
+        if (ucmp->Compare(user_key, f->smallest.user_key()) >= 0 &&
+            ucmp->Compare(user_key, f->largest.user_key()) <= 0) {
+            candidates.push_back(f);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(), NewestFirst);
+    for (int level = 1; level < config::kNumLevels; level++) {
+        const std::vector<FileMetaData*>& files = files_[level];
+        const uint32_t index = FindFile(vset_->icmp_, files, ikey);
+        if (index < files.size() &&
+            ucmp->Compare(user_key, files[index]->smallest.user_key()) >= 0) {
+            candidates.push_back(files[index]);
+        }
+    }
+
+    // 新文件中的 range tombstone 也覆盖旧文件中的条目，序列号更小的条目都已经被删除
+    SequenceNumber max_covering_tombstone_seq = 0;
+    std::string found;
+    for (FileMetaData* f : candidates) {
+        Saver saver;
+        saver.state = Saver::kNotFound;
+        saver.ucmp = ucmp;
+        saver.user_key = user_key;
+        saver.value = &found;
+        SequenceNumber tombstone_seq;
+        Status s = table_cache->Get(options, f->number, f->file_size, ikey, &tombstone_seq,
+                                    &saver, SaveValue);
+        if (!s.ok()) {
+            return s;
+        }
+        max_covering_tombstone_seq = std::max(max_covering_tombstone_seq, tombstone_seq);
+        if (saver.state == Saver::kCorrupt) {
+            return Status::Corruption("corrupted key for ", user_key);
+        }
+        if (saver.state == Saver::kNotFound) {
+            continue;
+        }
+        if (saver.sequence < max_covering_tombstone_seq) {
+            return finish(nullptr);
+        }
+
+        switch (saver.type) {
+            case kTypeValue: {
+                Slice v(found);
+                return finish(&v);
+            }
+            case kTypeBlobIndex: {
+                std::string blob;
+                s = ResolveBlobIndex(user_key, found, table_cache, &blob);
+                if (!s.ok()) {
+                    return s;
+                }
+                Slice v(blob);
+                return finish(&v);
+            }
+            case kTypeDeletion:
+                return finish(nullptr);
+            case kTypeMerge:
+                break;
+            default:
+                return Status::Corruption("unexpected value type for ", user_key);
+        }
+
+        // 操作数：同一个文件中可能还有更旧的操作数，顺序遍历直到遇到值、删除记录或者其他 key
+        if (merge_context == nullptr) {
+            return Status::InvalidArgument("merge operand without merge context");
+        }
+        Iterator* iter = table_cache->NewIterator(options, f->number, f->file_size);
+        ParsedInternalKey parsed;
+        bool done = false;
+        for (iter->Seek(ikey); iter->Valid() && !done; iter->Next()) {
+            if (!ParseInternalKey(iter->key(), &parsed)) {
+                s = Status::Corruption("corrupted key for ", user_key);
+                break;
+            }
+            if (ucmp->Compare(parsed.user_key, user_key) != 0) {
+                break;
+            }
+            if (parsed.sequence < max_covering_tombstone_seq) {
+                s = finish(nullptr);
+                done = true;
+            } else if (parsed.type == kTypeMerge) {
+                merge_context->PushOperand(iter->value());
+            } else if (parsed.type == kTypeValue) {
+                Slice v = iter->value();
+                s = finish(&v);
+                done = true;
+            } else if (parsed.type == kTypeBlobIndex) {
+                std::string blob;
+                s = ResolveBlobIndex(user_key, iter->value(), table_cache, &blob);
+                if (s.ok()) {
+                    Slice v(blob);
+                    s = finish(&v);
+                }
+                done = true;
+            } else {
+                s = finish(nullptr);
+                done = true;
+            }
+        }
+        if (s.ok() && !done) {
+            s = iter->status();
+        }
+        delete iter;
+        if (!s.ok() || done) {
+            return s;
+        }
+    }
+    return finish(nullptr);
+}
+
+void Version::Ref() { ++refs_; }
+
+void Version::Unref() {
+    assert(this != &vset_->dummy_versions_);
+    assert(refs_ >= 1);
+    --refs_;
+    if (refs_ == 0) {
+        delete this;
+    }
+}
+
+std::string Version::DebugString() const {
+    std::string r;
+    for (int level = 0; level < config::kNumLevels; level++) {
+        // E.g.,
+        //   --- level 1 ---
+        //   17:123['a' .. 'd']
+        //   20:43['e' .. 'g']
+        r.append("--- level ");
+        r.append(std::to_string(level));
+        r.append(" ---\n");
+        const std::vector<FileMetaData*>& files = files_[level];
+        for (size_t i = 0; i < files.size(); i++) {
+            r.push_back(' ');
+            r.append(std::to_string(files[i]->number));
+            r.push_back(':');
+            r.append(std::to_string(files[i]->file_size));
+            r.append("[");
+            r.append(files[i]->smallest.DebugString());
+            r.append(" .. ");
+            r.append(files[i]->largest.DebugString());
+            r.append("]\n");
+        }
+    }
+    if (!blob_files_.empty()) {
+        //   --- blob files ---
+        //   12: 100/1048576 garbage 20/209715
+        r.append("--- blob files ---\n");
+        for (size_t i = 0; i < blob_files_.size(); i++) {
+            const BlobFileMetaData* b = blob_files_[i];
+            r.push_back(' ');
+            r.append(std::to_string(b->number));
+            r.append(": ");
+            r.append(std::to_string(b->total_blob_count));
+            r.push_back('/');
+            r.append(std::to_string(b->total_blob_bytes));
+            r.append(" garbage ");
+            r.append(std::to_string(b->garbage_blob_count));
+            r.push_back('/');
+            r.append(std::to_string(b->garbage_blob_bytes));
+            r.push_back('\n');
+        }
+    }
+    return r;
+}
+
+/*
+ * 高效地把一串 VersionEdit 应用到某个 Version 上，中间不产生临时 Version
+ * 恢复时整个 manifest 的 edit 都累积到同一个 Builder 中
+ */
+class VersionSet::Builder {
+private:
+    // Helper to sort by v->files_[file_number].smallest
+    struct BySmallestKey {
+        const InternalKeyComparator* internal_comparator;
+
+        bool operator()(FileMetaData* f1, FileMetaData* f2) const {
+            int r = internal_comparator->Compare(f1->smallest, f2->smallest);
+            if (r != 0) {
+                return (r < 0);
+            } else {
+                // Break ties by file number
+                return (f1->number < f2->number);
+            }
+        }
+    };
+
+    typedef std::set<FileMetaData*, BySmallestKey> FileSet;
+    struct LevelState {
+        std::set<uint64_t> deleted_files;
+        FileSet* added_files;
+    };
+
+    VersionSet* vset_;
+    Version* base_;
+    LevelState levels_[config::kNumLevels];
+    // 新增的 blob 文件和各 blob 文件累积的 garbage，都按编号排序
+    std::map<uint64_t, BlobFileMetaData> added_blob_files_;
+    std::map<uint64_t, BlobFileMetaData> blob_garbages_;
+
+public:
+    // Initialize a builder with the files from *base and other info from *vset
+    Builder(VersionSet* vset, Version* base) : vset_(vset), base_(base) {
+        base_->Ref();
+        BySmallestKey cmp;
+        cmp.internal_comparator = &vset_->icmp_;
+        for (int level = 0; level < config::kNumLevels; level++) {
+            levels_[level].added_files = new FileSet(cmp);
+        }
+    }
+
+    ~Builder() {
+        for (int level = 0; level < config::kNumLevels; level++) {
+            const FileSet* added = levels_[level].added_files;
+            std::vector<FileMetaData*> to_unref;
+            to_unref.reserve(added->size());
+            for (FileSet::const_iterator it = added->begin(); it != added->end();
+                 ++it) {
+                to_unref.push_back(*it);
+            }
+            delete added;
+            for (uint32_t i = 0; i < to_unref.size(); i++) {
+                FileMetaData* f = to_unref[i];
+                f->refs--;
+                if (f->refs <= 0) {
+                    delete f;
+                }
+            }
+        }
+        base_->Unref();
+    }
+
+    // Apply all of the edits in *edit to the current state.
+    void Apply(const VersionEdit* edit) {
+        // Update compaction pointers
+        for (size_t i = 0; i < edit->compact_pointers_.size(); i++) {
+            const int level = edit->compact_pointers_[i].first;
+            vset_->compact_pointer_[level] =
+                    edit->compact_pointers_[i].second.Encode().ToString();
+        }
+
+        // Delete files
+        for (const auto& deleted_file_set_kvp : edit->deleted_files_) {
+            const int level = deleted_file_set_kvp.first;
+            const uint64_t number = deleted_file_set_kvp.second;
+            levels_[level].deleted_files.insert(number);
+        }
+
+        // Add new files
+        for (size_t i = 0; i < edit->new_files_.size(); i++) {
+            const int level = edit->new_files_[i].first;
+            FileMetaData* f = new FileMetaData(edit->new_files_[i].second);
+            f->refs = 1;
+
+            // 文件被 seek 一定次数之后自动 compaction，
+            // 一次 seek 的代价大约相当于 compaction 40KB 数据，这里保守地按 16KB 算
+            f->allowed_seeks = static_cast<int>((f->file_size / 16384U));
+            if (f->allowed_seeks < 100) f->allowed_seeks = 100;
+
+            levels_[level].deleted_files.erase(f->number);
+            levels_[level].added_files->insert(f);
+        }
+
+        // Add new blob files
+        for (size_t i = 0; i < edit->new_blob_files_.size(); i++) {
+            const BlobFileMetaData& b = edit->new_blob_files_[i];
+            added_blob_files_[b.number] = b;
+        }
+
+        // Accumulate blob garbage
+        for (size_t i = 0; i < edit->blob_file_garbages_.size(); i++) {
+            const BlobFileMetaData& g = edit->blob_file_garbages_[i];
+            BlobFileMetaData* acc = &blob_garbages_[g.number];
+            acc->garbage_blob_count += g.garbage_blob_count;
+            acc->garbage_blob_bytes += g.garbage_blob_bytes;
+        }
+    }
+
+    // Save the current state in *v.
+    void SaveTo(Version* v) {
+        BySmallestKey cmp;
+        cmp.internal_comparator = &vset_->icmp_;
+        for (int level = 0; level < config::kNumLevels; level++) {
+            // 把 base 中的文件和新增的文件按顺序合并，丢掉已删除的文件
+            const std::vector<FileMetaData*>& base_files = base_->files_[level];
+            std::vector<FileMetaData*>::const_iterator base_iter = base_files.begin();
+            std::vector<FileMetaData*>::const_iterator base_end = base_files.end();
+            const FileSet* added_files = levels_[level].added_files;
+            v->files_[level].reserve(base_files.size() + added_files->size());
+            for (const auto& added_file : *added_files) {
+                // Add all smaller files listed in base_
+                for (std::vector<FileMetaData*>::const_iterator bpos =
+                        std::upper_bound(base_iter, base_end, added_file, cmp);
+                     base_iter != bpos; ++base_iter) {
+                    MaybeAddFile(v, level, *base_iter);
+                }
+
+                MaybeAddFile(v, level, added_file);
+            }
+
+            // Add remaining base files
+            for (; base_iter != base_end; ++base_iter) {
+                MaybeAddFile(v, level, *base_iter);
+            }
+
+#ifndef NDEBUG
+            // Make sure there is no overlap in levels > 0
+            if (level > 0) {
+                for (uint32_t i = 1; i < v->files_[level].size(); i++) {
+                    const InternalKey& prev_end = v->files_[level][i - 1]->largest;
+                    const InternalKey& this_begin = v->files_[level][i]->smallest;
+                    if (vset_->icmp_.Compare(prev_end, this_begin) >= 0) {
+                        std::fprintf(stderr, "overlapping ranges in same level %s vs. %s\n",
+                                     prev_end.DebugString().c_str(),
+                                     this_begin.DebugString().c_str());
+                        std::abort();
+                    }
+                }
+            }
+#endif
+        }
+
+        SaveBlobFilesTo(v);
+    }
+
+    // 合并 base 中的和新增的 blob 文件，加上新的 garbage，丢掉已经全部是 garbage 的文件
+    void SaveBlobFilesTo(Version* v) {
+        const std::vector<BlobFileMetaData*>& base_blobs = base_->blob_files_;
+        std::vector<BlobFileMetaData*>::const_iterator base_iter = base_blobs.begin();
+        std::map<uint64_t, BlobFileMetaData>::const_iterator added_iter =
+                added_blob_files_.begin();
+        v->blob_files_.reserve(base_blobs.size() + added_blob_files_.size());
+        while (base_iter != base_blobs.end() ||
+               added_iter != added_blob_files_.end()) {
+            if (added_iter == added_blob_files_.end() ||
+                (base_iter != base_blobs.end() &&
+                 (*base_iter)->number < added_iter->first)) {
+                MaybeAddBlobFile(v, *base_iter, nullptr);
+                ++base_iter;
+            } else {
+                MaybeAddBlobFile(v, nullptr, &added_iter->second);
+                ++added_iter;
+            }
+        }
+    }
+
+    // base 与 added 恰好一个非空
+    void MaybeAddBlobFile(Version* v, BlobFileMetaData* base,
+                          const BlobFileMetaData* added) {
+        const uint64_t number = base != nullptr ? base->number : added->number;
+        std::map<uint64_t, BlobFileMetaData>::const_iterator garbage =
+                blob_garbages_.find(number);
+        BlobFileMetaData* b = base;
+        if (added != nullptr || garbage != blob_garbages_.end()) {
+            // garbage 有变化时生成新的元数据，旧版本仍然引用原来的
+            b = new BlobFileMetaData(base != nullptr ? *base : *added);
+            b->refs = 0;
+            if (garbage != blob_garbages_.end()) {
+                b->garbage_blob_count += garbage->second.garbage_blob_count;
+                b->garbage_blob_bytes += garbage->second.garbage_blob_bytes;
+            }
+        }
+        if (b->garbage_blob_count >= b->total_blob_count) {
+            // 所有 blob 都已是 garbage，新版本不再需要这个文件
+            if (b != base) {
+                delete b;
+            }
+            return;
+        }
+        b->refs++;
+        v->blob_files_.push_back(b);
+    }
+
+    void MaybeAddFile(Version* v, int level, FileMetaData* f) {
+        if (levels_[level].deleted_files.count(f->number) > 0) {
+            // File is deleted: do nothing
+        } else {
+            std::vector<FileMetaData*>* files = &v->files_[level];
+            if (level > 0 && !files->empty()) {
+                // Must not overlap
+                assert(vset_->icmp_.Compare((*files)[files->size() - 1]->largest,
+                                            f->smallest) < 0);
+            }
+            f->refs++;
+            files->push_back(f);
+        }
+    }
+};
+
+VersionSet::VersionSet(const std::string& dbname, const Options* options,
+                       const InternalKeyComparator* cmp)
+        : env_(options->env),
+          dbname_(dbname),
+          options_(options),
+          icmp_(*cmp),
+          picker_(NewCompactionPicker(options, &icmp_)),
+          next_file_number_(2),
+          manifest_file_number_(0),  // Filled by Recover()
+          last_sequence_(0),
+          log_number_(0),
+          prev_log_number_(0),
+          descriptor_file_(nullptr),
+          descriptor_log_(nullptr),
+          manifest_file_size_(0),
+          manifest_snapshot_size_(0),
+          obsolete_manifest_number_(0),
+          tail_manifest_number_(0),
+          tail_offset_(0),
+          dummy_versions_(this),
+          current_(nullptr),
+          max_column_family_(0) {
+    AppendVersion(new Version(this));
+}
+
+VersionSet::~VersionSet() {
+    current_->Unref();
+    assert(dummy_versions_.next_ == &dummy_versions_);  // List must be empty
+    delete descriptor_log_;
+    delete descriptor_file_;
+    delete picker_;
+}
+
+void VersionSet::AppendVersion(Version* v) {
+    // Make "v" current
+    assert(v->refs_ == 0);
+    assert(v != current_);
+    if (current_ != nullptr) {
+        current_->Unref();
+    }
+    current_ = v;
+    v->Ref();
+
+    // Append to linked list
+    v->prev_ = dummy_versions_.prev_;
+    v->next_ = &dummy_versions_;
+    v->prev_->next_ = v;
+    v->next_->prev_ = v;
+}
+
+void VersionSet::ApplyColumnFamilies(const VersionEdit& edit) {
+    for (size_t i = 0; i < edit.added_column_families_.size(); i++) {
+        column_families_[edit.added_column_families_[i].first] =
+                edit.added_column_families_[i].second;
+    }
+    for (size_t i = 0; i < edit.dropped_column_families_.size(); i++) {
+        column_families_.erase(edit.dropped_column_families_[i]);
+    }
+    if (edit.has_max_column_family_) {
+        max_column_family_ = std::max(max_column_family_, edit.max_column_family_);
+    }
+}
+
+bool VersionSet::ShouldRollManifest() const {
+    // 快照之后追加的历史记录既超过了配置的上限，又超过了快照本身，
+    // 重写一次快照的代价被至少同样多的历史记录分摊
+    const uint64_t history = manifest_file_size_ - manifest_snapshot_size_;
+    return history >= options_->max_manifest_file_size &&
+           history >= manifest_snapshot_size_;
+}
+
+Status VersionSet::LogAndApply(VersionEdit* edit, port::Mutex* mu) {
+    if (edit->has_log_number_) {
+        assert(edit->log_number_ >= log_number_);
+        assert(edit->log_number_ < next_file_number_);
+    } else {
+        edit->SetLogNumber(log_number_);
+    }
+
+    if (!edit->has_prev_log_number_) {
+        edit->SetPrevLogNumber(prev_log_number_);
+    }
+
+    // 历史记录过长，关闭当前 manifest，下面会新建一个以快照开头的 manifest
+    // 新 manifest 的编号必须在 SetNextFile 之前分配
+    if (descriptor_log_ != nullptr && ShouldRollManifest()) {
+        delete descriptor_log_;
+        delete descriptor_file_;
+        descriptor_log_ = nullptr;
+        descriptor_file_ = nullptr;
+        if (obsolete_manifest_number_ == 0) {
+            obsolete_manifest_number_ = manifest_file_number_;
+        }
+        manifest_file_number_ = NewFileNumber();
+    }
+
+    edit->SetNextFile(next_file_number_);
+    edit->SetLastSequence(last_sequence_);
+
+    Version* v = new Version(this);
+    {
+        Builder builder(this, current_);
+        builder.Apply(edit);
+        builder.SaveTo(v);
+    }
+    Finalize(v);
+
+    // 需要时新建 manifest，先写入当前版本的快照
+    std::string new_manifest_file;
+    Status s;
+    if (descriptor_log_ == nullptr) {
+        // 写快照要读 current_，所以在持有 *mu 的情况下进行。
+        // 只有打开数据库后的第一次调用和切换 manifest 时才会走到这里
+        assert(descriptor_file_ == nullptr);
+        new_manifest_file = DescriptorFileName(dbname_, manifest_file_number_);
+        s = env_->NewWritableFile(new_manifest_file, &descriptor_file_);
+        if (s.ok()) {
+            descriptor_log_ = new log::Writer(descriptor_file_);
+            s = WriteSnapshot(descriptor_log_);
+            manifest_file_size_ = descriptor_log_->FileSize();
+            manifest_snapshot_size_ = manifest_file_size_;
+        }
+    }
+
+    // 写 manifest 比较耗时，期间释放锁
+    {
+        mu->Unlock();
+
+        // Write new record to MANIFEST log
+        if (s.ok()) {
+            std::string record;
+            edit->EncodeTo(&record);
+            s = descriptor_log_->AddRecord(record);
+            manifest_file_size_ = descriptor_log_->FileSize();
+            if (s.ok()) {
+                s = descriptor_file_->Sync();
+            }
+        }
+
+        // 新建了 manifest 时，让 CURRENT 指向它
+        if (s.ok() && !new_manifest_file.empty()) {
+            s = SetCurrentFile(env_, dbname_, manifest_file_number_);
+        }
+
+        mu->Lock();
+    }
+
+    // Install the new version
+    if (s.ok()) {
+        AppendVersion(v);
+        log_number_ = edit->log_number_;
+        prev_log_number_ = edit->prev_log_number_;
+        ApplyColumnFamilies(*edit);
+        // CURRENT 已经指向新的 manifest，旧的可以删除了
+        if (!new_manifest_file.empty() && obsolete_manifest_number_ != 0 &&
+            obsolete_manifest_number_ != manifest_file_number_) {
+            env_->RemoveFile(DescriptorFileName(dbname_, obsolete_manifest_number_));
+            obsolete_manifest_number_ = 0;
+        }
+    } else {
+        delete v;
+        if (!new_manifest_file.empty()) {
+            delete descriptor_log_;
+            delete descriptor_file_;
+            descriptor_log_ = nullptr;
+            descriptor_file_ = nullptr;
+            env_->RemoveFile(new_manifest_file);
+        }
+    }
+
+    return s;
+}
+
+Status VersionSet::Recover(bool* save_manifest) {
+    struct LogReporter : public log::Reader::Reporter {
+        Status* status;
+        void Corruption(size_t bytes, const Status& s) override {
+            if (this->status->ok()) *this->status = s;
+        }
+    };
+
+    // Read "CURRENT" file, which contains a pointer to the current manifest file
+    std::string current;
+    Status s = ReadFileToString(env_, CurrentFileName(dbname_), &current);
+    if (!s.ok()) {
+        return s;
+    }
+    if (current.empty() || current[current.size() - 1] != '\n') {
+        return Status::Corruption("CURRENT file does not end with newline");
+    }
+    current.resize(current.size() - 1);
+
+    std::string dscname = dbname_ + "/" + current;
+    SequentialFile* file;
+    s = env_->NewSequentialFile(dscname, &file);
+    if (!s.ok()) {
+        if (s.IsNotFound()) {
+            return Status::Corruption("CURRENT points to a non-existent file",
+                                      s.ToString());
+        }
+        return s;
+    }
+
+    bool have_log_number = false;
+    bool have_prev_log_number = false;
+    bool have_next_file = false;
+    bool have_last_sequence = false;
+    uint64_t next_file = 0;
+    uint64_t last_sequence = 0;
+    uint64_t log_number = 0;
+    uint64_t prev_log_number = 0;
+    uint64_t manifest_size = 0;
+    uint64_t snapshot_size = 0;
+    Builder builder(this, current_);
+    int read_records = 0;
+
+    {
+        LogReporter reporter;
+        reporter.status = &s;
+        log::Reader reader(file, &reporter, true /*checksum*/,
+                           0 /*initial_offset*/);
+        Slice record;
+        std::string scratch;
+        VersionEdit edit;
+        while (reader.ReadRecord(&record, &scratch) && s.ok()) {
+            ++read_records;
+            // 按文件中的偏移计算，包括分片的记录头和块尾的填充
+            manifest_size = reader.NextRecordOffset();
+            // 每个 manifest 的第一条记录是快照
+            if (read_records == 1) {
+                snapshot_size = manifest_size;
+            }
+            s = edit.DecodeFrom(record);
+            if (s.ok()) {
+                if (edit.has_comparator_ &&
+                    edit.comparator_ != icmp_.user_comparator()->Name()) {
+                    s = Status::InvalidArgument(
+                            edit.comparator_ + " does not match existing comparator ",
+                            icmp_.user_comparator()->Name());
+                }
+            }
+
+            if (s.ok()) {
+                builder.Apply(&edit);
+                ApplyColumnFamilies(edit);
+            }
+
+            if (edit.has_log_number_) {
+                log_number = edit.log_number_;
+                have_log_number = true;
+            }
+
+            if (edit.has_prev_log_number_) {
+                prev_log_number = edit.prev_log_number_;
+                have_prev_log_number = true;
+            }
+
+            if (edit.has_next_file_number_) {
+                next_file = edit.next_file_number_;
+                have_next_file = true;
+            }
+
+            if (edit.has_last_sequence_) {
+                last_sequence = edit.last_sequence_;
+                have_last_sequence = true;
+            }
+        }
+    }
+    delete file;
+    file = nullptr;
+
+    if (s.ok()) {
+        if (!have_next_file) {
+            s = Status::Corruption("no meta-nextfile entry in descriptor");
+        } else if (!have_log_number) {
+            s = Status::Corruption("no meta-lognumber entry in descriptor");
+        } else if (!have_last_sequence) {
+            s = Status::Corruption("no last-sequence-number entry in descriptor");
+        }
+
+        if (!have_prev_log_number) {
+            prev_log_number = 0;
+        }
+
+        MarkFileNumberUsed(prev_log_number);
+        MarkFileNumberUsed(log_number);
+    }
+
+    if (s.ok()) {
+        Version* v = new Version(this);
+        builder.SaveTo(v);
+        // Install recovered version
+        Finalize(v);
+        AppendVersion(v);
+        manifest_file_number_ = next_file;
+        next_file_number_ = next_file + 1;
+        last_sequence_ = last_sequence;
+        log_number_ = log_number;
+        prev_log_number_ = prev_log_number;
+        manifest_file_size_ = manifest_size;
+        manifest_snapshot_size_ = snapshot_size;
+
+        // See if we can reuse the existing MANIFEST file.
+        if (ReuseManifest(dscname, current)) {
+            // No need to save new manifest
+        } else {
+            *save_manifest = true;
+        }
+    }
+
+    return s;
+}
+
+Status VersionSet::CatchUpWithManifest(bool* changed) {
+    struct LogReporter : public log::Reader::Reporter {
+        Status* status;
+        void Corruption(size_t bytes, const Status& s) override {
+            if (this->status->ok()) *this->status = s;
+        }
+    };
+
+    *changed = false;
+    std::string current;
+    Status s = ReadFileToString(env_, CurrentFileName(dbname_), &current);
+    if (!s.ok()) {
+        return s;
+    }
+    if (current.empty() || current[current.size() - 1] != '\n') {
+        return Status::Corruption("CURRENT file does not end with newline");
+    }
+    current.resize(current.size() - 1);
+    uint64_t manifest_number;
+    FileType type;
+    if (!ParseFileName(current, &manifest_number, &type) || type != kDescriptorFile) {
+        return Status::Corruption("CURRENT points to an invalid file name", current);
+    }
+
+    // 主实例切换了 manifest 时，新 manifest 以完整的快照开头，从空版本重新构建
+    const bool restart = (manifest_number != tail_manifest_number_);
+    const uint64_t offset = restart ? 0 : tail_offset_;
+    SequentialFile* file;
+    s = env_->NewSequentialFile(dbname_ + "/" + current, &file);
+    if (!s.ok()) {
+        // 读 CURRENT 之后 manifest 又被切换并删除了，下次重试
+        return s.IsNotFound() ? Status::OK() : s;
+    }
+
+    Version* base = restart ? new Version(this) : current_;
+    base->Ref();
+    int applied = 0;
+    uint64_t next_offset = offset;
+    {
+        Builder builder(this, base);
+        Status read_status;
+        LogReporter reporter;
+        reporter.status = &read_status;
+        log::Reader reader(file, &reporter, true /*checksum*/, offset);
+        Slice record;
+        std::string scratch;
+        // 主实例可能正在追加，读到不完整的记录时当作文件末尾，下次从这里继续
+        std::map<uint32_t, std::string> column_families =
+                restart ? std::map<uint32_t, std::string>() : column_families_;
+        while (reader.ReadRecord(&record, &scratch) && read_status.ok()) {
+            VersionEdit edit;
+            s = edit.DecodeFrom(record);
+            if (s.ok() && edit.has_comparator_ &&
+                edit.comparator_ != icmp_.user_comparator()->Name()) {
+                s = Status::InvalidArgument(
+                        edit.comparator_ + " does not match existing comparator ",
+                        icmp_.user_comparator()->Name());
+            }
+            if (!s.ok()) {
+                break;
+            }
+
+            builder.Apply(&edit);
+            for (size_t i = 0; i < edit.added_column_families_.size(); i++) {
+                column_families[edit.added_column_families_[i].first] =
+                        edit.added_column_families_[i].second;
+            }
+            for (size_t i = 0; i < edit.dropped_column_families_.size(); i++) {
+                column_families.erase(edit.dropped_column_families_[i]);
+            }
+            if (edit.has_max_column_family_) {
+                max_column_family_ = std::max(max_column_family_, edit.max_column_family_);
+            }
+            if (edit.has_log_number_) {
+                log_number_ = edit.log_number_;
+            }
+            if (edit.has_prev_log_number_) {
+                prev_log_number_ = edit.prev_log_number_;
+            }
+            if (edit.has_next_file_number_) {
+                MarkFileNumberUsed(edit.next_file_number_);
+            }
+            if (edit.has_last_sequence_ && edit.last_sequence_ > last_sequence_) {
+                last_sequence_ = edit.last_sequence_;
+            }
+            next_offset = reader.NextRecordOffset();
+            applied++;
+        }
+        delete file;
+
+        if (s.ok() && (applied > 0 || restart)) {
+            Version* v = new Version(this);
+            builder.SaveTo(v);
+            Finalize(v);
+            AppendVersion(v);
+            column_families_.swap(column_families);
+            tail_manifest_number_ = manifest_number;
+            tail_offset_ = next_offset;
+            *changed = true;
+        }
+    }
+    base->Unref();
+    return s;
+}
+
+bool VersionSet::ReuseManifest(const std::string& dscname,
+                               const std::string& dscbase) {
+    FileType manifest_type;
+    uint64_t manifest_number;
+    uint64_t manifest_size;
+    if (!ParseFileName(dscbase, &manifest_number, &manifest_type) ||
+        manifest_type != kDescriptorFile ||
+        !env_->GetFileSize(dscname, &manifest_size).ok() ||
+        // 历史记录已经过长时不再沿用，写一个新的快照
+        ShouldRollManifest()) {
+        return false;
+    }
+
+    assert(descriptor_file_ == nullptr);
+    assert(descriptor_log_ == nullptr);
+    Status r = env_->NewAppendableFile(dscname, &descriptor_file_);
+    if (!r.ok()) {
+        assert(descriptor_file_ == nullptr);
+        return false;
+    }
+
+    descriptor_log_ = new log::Writer(descriptor_file_, manifest_size);
+    // Recover 时分配的编号没有用上，还回去
+    ReuseFileNumber(manifest_file_number_);
+    manifest_file_number_ = manifest_number;
+    manifest_file_size_ = manifest_size;
+    return true;
+}
+
+void VersionSet::MarkFileNumberUsed(uint64_t number) {
+    if (next_file_number_ <= number) {
+        next_file_number_ = number + 1;
+    }
+}
+
+void VersionSet::Finalize(Version* v) {
+    // Precomputed best level for next compaction
+    picker_->ComputeCompactionScore(v, &v->compaction_level_,
+                                    &v->compaction_score_);
+
+    ComputeFilesMarkedForForcedBlobGC(v);
+}
+
+void VersionSet::ComputeFilesMarkedForForcedBlobGC(Version* v) {
+    v->files_marked_for_forced_blob_gc_.clear();
+    if (!options_->enable_blob_garbage_collection ||
+        options_->blob_garbage_collection_force_threshold >= 1.0) {
+        return;
+    }
+
+    // 统计最旧的 age_cutoff 比例的 blob 文件中 garbage 的比例，
+    // 普通 compaction 迟迟没有覆盖到引用它们的 table 时，这些文件的空间一直无法回收
+    const uint64_t cutoff = v->BlobGCCutoffFileNumber(
+            options_->blob_garbage_collection_age_cutoff);
+    uint64_t total_bytes = 0;
+    uint64_t garbage_bytes = 0;
+    for (size_t i = 0; i < v->blob_files_.size(); i++) {
+        const BlobFileMetaData* b = v->blob_files_[i];
+        if (b->number >= cutoff) {
+            break;
+        }
+        total_bytes += b->total_blob_bytes;
+        garbage_bytes += b->garbage_blob_bytes;
+    }
+    if (total_bytes == 0 ||
+        garbage_bytes < options_->blob_garbage_collection_force_threshold *
+                                total_bytes) {
+        return;
+    }
+
+    // 引用了这批 blob 文件的 table 经过 compaction 后，其中仍然存活的 blob 被搬走，
+    // 这批 blob 文件全部变成 garbage 后被删除
+    for (int level = 0; level < config::kNumLevels; level++) {
+        const std::vector<FileMetaData*>& files = v->files_[level];
+        for (size_t i = 0; i < files.size(); i++) {
+            FileMetaData* f = files[i];
+            if (f->oldest_blob_file_number != kInvalidBlobFileNumber &&
+                f->oldest_blob_file_number < cutoff) {
+                v->files_marked_for_forced_blob_gc_.push_back(
+                        std::make_pair(level, f));
+            }
+        }
+    }
+}
+
+Status VersionSet::WriteSnapshot(log::Writer* log) {
+    // Save metadata
+    VersionEdit edit;
+    edit.SetComparatorName(icmp_.user_comparator()->Name());
+
+    // Save compaction pointers
+    for (int level = 0; level < config::kNumLevels; level++) {
+        if (!compact_pointer_[level].empty()) {
+            InternalKey key;
+            key.DecodeFrom(compact_pointer_[level]);
+            edit.SetCompactPointer(level, key);
+        }
+    }
+
+    // Save files
+    for (int level = 0; level < config::kNumLevels; level++) {
+        const std::vector<FileMetaData*>& files = current_->files_[level];
+        for (size_t i = 0; i < files.size(); i++) {
+            const FileMetaData* f = files[i];
+            edit.AddFile(level, f->number, f->file_size, f->smallest, f->largest,
+                         f->oldest_blob_file_number, f->file_creation_time);
+        }
+    }
+
+    // Save blob files
+    for (size_t i = 0; i < current_->blob_files_.size(); i++) {
+        const BlobFileMetaData* b = current_->blob_files_[i];
+        edit.AddBlobFile(b->number, b->total_blob_count, b->total_blob_bytes);
+        if (b->garbage_blob_count > 0) {
+            edit.AddBlobFileGarbage(b->number, b->garbage_blob_count,
+                                    b->garbage_blob_bytes);
+        }
+    }
+
+    // Save column families
+    for (const auto& cf : column_families_) {
+        edit.AddColumnFamily(cf.first, cf.second);
+    }
+    if (max_column_family_ > 0) {
+        edit.SetMaxColumnFamily(max_column_family_);
+    }
+
+    std::string record;
+    edit.EncodeTo(&record);
+    return log->AddRecord(record);
+}
+
+Compaction* VersionSet::PickCompaction() {
+    Compaction* c = picker_->PickCompaction(current_, compact_pointer_);
+    if (c != nullptr) {
+        // 立即更新下一次 compaction 的起点，而不是等到 edit 被应用，
+        // 这样即使这次 compaction 失败，下一次也会换一个范围
+        const VersionEdit* edit = c->edit();
+        for (size_t i = 0; i < edit->compact_pointers_.size(); i++) {
+            compact_pointer_[edit->compact_pointers_[i].first] =
+                    edit->compact_pointers_[i].second.Encode().ToString();
+        }
+    }
+    return c;
+}
+
+uint64_t VersionSet::EstimatedPendingCompactionBytes() const {
+    return picker_->EstimatePendingCompactionBytes(current_);
+}
+
+int VersionSet::NumLevelFiles(int level) const {
+    assert(level >= 0);
+    assert(level < config::kNumLevels);
+    return current_->files_[level].size();
+}
+
+const char* VersionSet::LevelSummary(LevelSummaryStorage* scratch) const {
+    // Update code if kNumLevels changes
+    static_assert(config::kNumLevels == 7, "");
+    std::snprintf(
+            scratch->buffer, sizeof(scratch->buffer), "files[ %d %d %d %d %d %d %d ]",
+            int(current_->files_[0].size()), int(current_->files_[1].size()),
+            int(current_->files_[2].size()), int(current_->files_[3].size()),
+            int(current_->files_[4].size()), int(current_->files_[5].size()),
+            int(current_->files_[6].size()));
+    return scratch->buffer;
+}
+
+void VersionSet::AddLiveFiles(std::set<uint64_t>* live) {
+    for (Version* v = dummy_versions_.next_; v != &dummy_versions_;
+         v = v->next_) {
+        for (int level = 0; level < config::kNumLevels; level++) {
+            const std::vector<FileMetaData*>& files = v->files_[level];
+            for (size_t i = 0; i < files.size(); i++) {
+                live->insert(files[i]->number);
+            }
+        }
+        for (size_t i = 0; i < v->blob_files_.size(); i++) {
+            live->insert(v->blob_files_[i]->number);
+        }
+    }
+}
+
+int64_t VersionSet::NumLevelBytes(int level) const {
+    assert(level >= 0);
+    assert(level < config::kNumLevels);
+    return TotalFileSize(current_->files_[level]);
+}
+
+} // namespace tinydb
@@ -0,0 +1,326 @@
+#ifndef STORAGE_TINYDB_DB_VERSION_SET_H_
+#define STORAGE_TINYDB_DB_VERSION_SET_H_
+
+/*
+ * 数据库的状态由一组 Version 表示，每个 Version 记录每一层有哪些文件
+ * 最新的 Version 称为 "current"，旧的 Version 可能还在被迭代器等使用，用引用计数管理
+ *
+ * Version 的变化以 VersionEdit 的形式追加到 manifest 中，打开数据库时重放 manifest 恢复出 current
+ *
+ * 线程安全：Version 本身是不可变的；VersionSet 的方法需要外部同步(持有 LogAndApply 传入的 mu)
+ */
+
+#include <map>
+#include <set>
+#include <vector>
+
+#include "db/dbformat.h"
+#include "db/version_edit.h"
+#include "port/port.h"
+#include "port/thread_annotations.h"
+#include "tinydb/options.h"
+
+namespace tinydb {
+
+namespace log {
+class Writer;
+}
+
+class Compaction;
+class CompactionPicker;
+class MergeContext;
+class TableCache;
+class VersionSet;
+class WritableFile;
+
+// files 中所有文件的大小之和
+int64_t TotalFileSize(const std::vector<FileMetaData*>& files);
+
+/*
+ * 返回满足 files[i]->largest >= key 的最小下标 i，不存在时返回 files.size()
+ * REQUIRES: "files" contains a sorted list of non-overlapping files.
+ */
+int FindFile(const InternalKeyComparator& icmp,
+             const std::vector<FileMetaData*>& files, const Slice& key);
+
+/*
+ * files 中是否有文件与 user key 区间 [*smallest,*largest] 重叠
+ * smallest==nullptr 表示小于所有 key，largest==nullptr 表示大于所有 key
+ * disjoint_sorted_files 为 true 时 files 必须有序且互不重叠(L1 及以上)，可以二分查找
+ */
+bool SomeFileOverlapsRange(const InternalKeyComparator& icmp,
+                           bool disjoint_sorted_files,
+                           const std::vector<FileMetaData*>& files,
+                           const Slice* smallest_user_key,
+                           const Slice* largest_user_key);
+
+class Version {
+public:
+    void Ref();
+    void Unref();
+
+    int NumFiles(int level) const { return files_[level].size(); }
+
+    const std::vector<FileMetaData*>& files(int level) const {
+        return files_[level];
+    }
+
+    // 存活的 blob 文件，按编号升序
+    const std::vector<BlobFileMetaData*>& blob_files() const {
+        return blob_files_;
+    }
+
+    // 编号 < 返回值的 blob 文件属于最旧的 age_cutoff 比例的 blob 文件，
+    // compaction 遇到指向它们的 BlobIndex 时把 blob 搬到新的 blob 文件(见 BlobRelocator)
+    uint64_t BlobGCCutoffFileNumber(double age_cutoff) const;
+
+    // 为了回收最旧一批 blob 文件的空间需要强制 compaction 的文件(层, 文件)，
+    // 由 VersionSet::Finalize() 计算
+    const std::vector<std::pair<int, FileMetaData*>>& FilesMarkedForForcedBlobGC()
+            const {
+        return files_marked_for_forced_blob_gc_;
+    }
+
+    // 把 level 层中与 user key 区间 [begin,end] 重叠的文件存到 *inputs
+    // begin==nullptr 表示小于所有 key，end==nullptr 表示大于所有 key
+    // L0 的文件之间可能重叠，结果会扩展到与选中文件重叠的所有 L0 文件
+    void GetOverlappingInputs(int level, const InternalKey* begin,
+                              const InternalKey* end,
+                              std::vector<FileMetaData*>* inputs);
+
+    // 下一个需要 compaction 的层及其分数，分数 >= 1 表示需要 compaction
+    double compaction_score() const { return compaction_score_; }
+    int compaction_level() const { return compaction_level_; }
+
+    // level 层是否有文件与 [*smallest_user_key,*largest_user_key] 重叠
+    bool OverlapInLevel(int level, const Slice* smallest_user_key,
+                        const Slice* largest_user_key);
+
+    /*
+     * 在这个版本的 table 文件中查找 k，找到值时存到 *value 并返回 OK，
+     * key 不存在、已经删除或者被 range tombstone 覆盖时返回 NotFound
+     * merge_context 中是更新的数据源(memtable)中已经收集到的操作数，遇到更多的操作数时
+     * 继续收集，最后用 Options::merge_operator 合并出结果
+     * REQUIRES: 不持有锁，调用者持有这个版本的引用
+     */
+    Status Get(const ReadOptions& options, const LookupKey& k, std::string* value,
+               TableCache* table_cache, MergeContext* merge_context);
+
+    // 返回每层文件的描述
+    std::string DebugString() const;
+
+private:
+    friend class VersionSet;
+
+    // 读取 BlobIndex 指向的 value，blob 文件通过 table_cache 打开
+    Status ResolveBlobIndex(const Slice& user_key, const Slice& blob_index,
+                            TableCache* table_cache, std::string* value) const;
+
+    explicit Version(VersionSet* vset)
+            : vset_(vset),
+              next_(this),
+              prev_(this),
+              refs_(0),
+              compaction_score_(-1),
+              compaction_level_(-1) {}
+
+    Version(const Version&) = delete;
+    Version& operator=(const Version&) = delete;
+
+    ~Version();
+
+    VersionSet* vset_;  // VersionSet to which this Version belongs
+    Version* next_;     // Next version in linked list
+    Version* prev_;     // Previous version in linked list
+    int refs_;          // Number of live refs to this version
+
+    // List of files per level
+    std::vector<FileMetaData*> files_[config::kNumLevels];
+
+    std::vector<BlobFileMetaData*> blob_files_;
+    std::vector<std::pair<int, FileMetaData*>> files_marked_for_forced_blob_gc_;
+
+    // 下一个需要 compaction 的层及其分数，由 VersionSet::Finalize() 计算
+    // 分数 >= 1 表示需要 compaction
+    double compaction_score_;
+    int compaction_level_;
+};
+
+class VersionSet {
+public:
+    VersionSet(const std::string& dbname, const Options* options,
+               const InternalKeyComparator* cmp);
+
+    VersionSet(const VersionSet&) = delete;
+    VersionSet& operator=(const VersionSet&) = delete;
+
+    ~VersionSet();
+
+    /*
+     * 把 edit 应用到 current 上生成新版本，写入 manifest 后成为新的 current
+     * 写 manifest 期间会释放 *mu
+     * manifest 的历史记录过长时，先切换到一个以当前版本快照开头的新 manifest
+     * REQUIRES: *mu is held on entry.
+     * REQUIRES: no other thread concurrently calls LogAndApply()
+     */
+    Status LogAndApply(VersionEdit* edit, port::Mutex* mu)
+            EXCLUSIVE_LOCKS_REQUIRED(mu);
+
+    /*
+     * 从 CURRENT 指向的 manifest 恢复最近一次保存的状态
+     * 所有 VersionEdit 先累积到同一个 Builder 中，最后只生成一次 Version，
+     * 所以恢复的代价与存活文件数和 manifest 大小成正比，与 edit 的条数无关
+     * 返回时 *save_manifest 为 true 表示没有沿用旧的 manifest，
+     * 调用者应当随后调用一次 LogAndApply 写出新的 manifest
+     */
+    Status Recover(bool* save_manifest);
+
+    /*
+     * 只读地跟随另一个进程正在写的 manifest(见 SecondaryInstance)：
+     * 从上一次读到的位置继续应用新追加的 edit，CURRENT 指向新的 manifest 时从头重新构建
+     * 读到不完整或损坏的记录时停在它之前，下一次调用再重试。不会打开任何文件写入
+     * 生成了新的 current 时 *changed 为 true
+     * 不能与 Recover()/LogAndApply() 用在同一个 VersionSet 上
+     */
+    Status CatchUpWithManifest(bool* changed);
+
+    // Return the current version.
+    Version* current() const { return current_; }
+
+    const InternalKeyComparator* internal_comparator() const { return &icmp_; }
+
+    // Return the current manifest file number
+    uint64_t ManifestFileNumber() const { return manifest_file_number_; }
+
+    // 当前 manifest 的大小，以及其开头快照的大小
+    uint64_t ManifestFileSize() const { return manifest_file_size_; }
+    uint64_t ManifestSnapshotSize() const { return manifest_snapshot_size_; }
+
+    // Allocate and return a new file number
+    uint64_t NewFileNumber() { return next_file_number_++; }
+
+    // 归还一个刚分配的文件编号，要求它就是最后分配的那个
+    void ReuseFileNumber(uint64_t file_number) {
+        if (next_file_number_ == file_number + 1) {
+            next_file_number_ = file_number;
+        }
+    }
+
+    // Return the number of Table files at the specified level.
+    int NumLevelFiles(int level) const;
+
+    // Return the combined file size of all files at the specified level.
+    int64_t NumLevelBytes(int level) const;
+
+    // Return the last sequence number.
+    uint64_t LastSequence() const { return last_sequence_; }
+
+    // Set the last sequence number to s.
+    void SetLastSequence(uint64_t s) {
+        assert(s >= last_sequence_);
+        last_sequence_ = s;
+    }
+
+    // Mark the specified file number as used.
+    void MarkFileNumberUsed(uint64_t number);
+
+    // Return the current log file number.
+    uint64_t LogNumber() const { return log_number_; }
+
+    // 正在 compaction 的 memtable 对应的日志编号，没有时为 0
+    uint64_t PrevLogNumber() const { return prev_log_number_; }
+
+    // 是否有层需要 compaction，或者有文件需要为 blob GC 强制 compaction
+    bool NeedsCompaction() const {
+        return current_->compaction_score_ >= 1 ||
+               !current_->files_marked_for_forced_blob_gc_.empty();
+    }
+
+    /*
+     * 按 options->compaction_style 选出下一次要做的 compaction，不需要时返回 nullptr
+     * 调用者负责 delete 返回的对象(见 CompactionJob)
+     */
+    Compaction* PickCompaction();
+
+    // 当前版本估计还需要 compaction 读写的字节数，见 CompactionPicker::EstimatePendingCompactionBytes()
+    uint64_t EstimatedPendingCompactionBytes() const;
+
+    // 已注册的 column family 的编号和名字(不包括 default)，见 VersionEdit::AddColumnFamily()
+    const std::map<uint32_t, std::string>& column_families() const {
+        return column_families_;
+    }
+
+    // 分配过的最大的 column family 编号
+    uint32_t MaxColumnFamily() const { return max_column_family_; }
+
+    // 把所有还在使用的 Version 引用的文件编号(包括 blob 文件)加入 *live
+    void AddLiveFiles(std::set<uint64_t>* live);
+
+    // Return a human-readable short (single-line) summary of the number
+    // of files per level.  Uses *scratch as backing store.
+    struct LevelSummaryStorage {
+        char buffer[100];
+    };
+    const char* LevelSummary(LevelSummaryStorage* scratch) const;
+
+private:
+    class Builder;
+
+    friend class Version;
+
+    // 如果 manifest 的历史记录还不长，继续追加到这个 manifest 上
+    bool ReuseManifest(const std::string& dscname, const std::string& dscbase);
+
+    // 当前 manifest 是否应该切换成新的快照
+    bool ShouldRollManifest() const;
+
+    void Finalize(Version* v);
+
+    // 最旧的一批 blob 文件中 garbage 的比例达到阈值时，
+    // 找出引用它们的 table 文件，记录到 v->files_marked_for_forced_blob_gc_
+    void ComputeFilesMarkedForForcedBlobGC(Version* v);
+
+    // Save current contents to *log
+    Status WriteSnapshot(log::Writer* log);
+
+    void AppendVersion(Version* v);
+
+    // 把 edit 中 column family 注册表的变化应用到 column_families_
+    void ApplyColumnFamilies(const VersionEdit& edit);
+
+    Env* const env_;
+    const std::string dbname_;
+    const Options* const options_;
+    const InternalKeyComparator icmp_;
+    CompactionPicker* const picker_;
+    uint64_t next_file_number_;
+    uint64_t manifest_file_number_;
+    uint64_t last_sequence_;
+    uint64_t log_number_;
+    uint64_t prev_log_number_;  // 0 or backing store for memtable being compacted
+
+    // Opened lazily
+    WritableFile* descriptor_file_;
+    log::Writer* descriptor_log_;
+    uint64_t manifest_file_size_;
+    uint64_t manifest_snapshot_size_;
+    // 已经切换走但还没有删除的 manifest，为 0 表示没有
+    uint64_t obsolete_manifest_number_;
+
+    // CatchUpWithManifest() 正在跟随的 manifest，以及下一条记录的偏移
+    uint64_t tail_manifest_number_;
+    uint64_t tail_offset_;
+
+    Version dummy_versions_;  // Head of circular doubly-linked list of versions.
+    Version* current_;        // == dummy_versions_.prev_
+
+    // 每层下一次 compaction 的起始 key，为空串或者一个有效的 InternalKey
+    std::string compact_pointer_[config::kNumLevels];
+
+    std::map<uint32_t, std::string> column_families_;
+    uint32_t max_column_family_;
+};
+
+} // namespace tinydb
+
+#endif  // STORAGE_TINYDB_DB_VERSION_SET_H_
@@ -0,0 +1,190 @@
+#include "db/version_set.h"
+
+#include <string>
+
+#include "db/column_family.h"
+#include "db/filename.h"
+#include "db/version_edit.h"
+#include "gtest/gtest.h"
+#include "tinydb/comparator.h"
+#include "tinydb/env.h"
+#include "util/mutexlock.h"
+#include "util/testutil.h"
+
+namespace tinydb {
+
+class VersionSetTest : public testing::Test {
+public:
+    VersionSetTest() : icmp_(BytewiseComparator()), versions_(nullptr) {
+        dbname_ = test::NewTestDirectory("version_set_test");
+        {
+            // 借用 ColumnFamilySet 建一个空的数据库
+            Options db_options;
+            db_options.create_if_missing = true;
+            ColumnFamilySet db(dbname_, db_options);
+            EXPECT_TRUE(db.Open({}).ok());
+        }
+        options_.comparator = &icmp_;
+    }
+
+    ~VersionSetTest() override { delete versions_; }
+
+    void Reopen() {
+        delete versions_;
+        versions_ = new VersionSet(dbname_, &options_, &icmp_);
+        bool save_manifest = false;
+        ASSERT_TRUE(versions_->Recover(&save_manifest).ok());
+    }
+
+    // 往 level 层加入一个文件(只记录在 manifest 中，不需要真实存在)
+    uint64_t AddFile(int level, const std::string& smallest, const std::string& largest,
+                     uint64_t oldest_blob_file_number = kInvalidBlobFileNumber) {
+        VersionEdit edit;
+        MutexLock l(&mu_);
+        const uint64_t number = versions_->NewFileNumber();
+        edit.AddFile(level, number, 1000, InternalKey(smallest, 1, kTypeValue),
+                     InternalKey(largest, 1, kTypeValue), oldest_blob_file_number, 0);
+        EXPECT_TRUE(versions_->LogAndApply(&edit, &mu_).ok());
+        return number;
+    }
+
+    // 加入一个有 10 个 blob、共 1000 字节的 blob 文件
+    uint64_t AddBlobFile() {
+        VersionEdit edit;
+        MutexLock l(&mu_);
+        const uint64_t number = versions_->NewFileNumber();
+        edit.AddBlobFile(number, 10, 1000);
+        EXPECT_TRUE(versions_->LogAndApply(&edit, &mu_).ok());
+        return number;
+    }
+
+    void AddBlobGarbage(uint64_t number, uint64_t count, uint64_t bytes) {
+        VersionEdit edit;
+        edit.AddBlobFileGarbage(number, count, bytes);
+        MutexLock l(&mu_);
+        EXPECT_TRUE(versions_->LogAndApply(&edit, &mu_).ok());
+    }
+
+    void RemoveFile(int level, uint64_t number) {
+        VersionEdit edit;
+        edit.RemoveFile(level, number);
+        MutexLock l(&mu_);
+        EXPECT_TRUE(versions_->LogAndApply(&edit, &mu_).ok());
+    }
+
+    uint64_t ManifestFileSize() {
+        uint64_t size = 0;
+        EXPECT_TRUE(options_.env->GetFileSize(
+                DescriptorFileName(dbname_, versions_->ManifestFileNumber()), &size).ok());
+        return size;
+    }
+
+    std::string dbname_;
+    InternalKeyComparator icmp_;
+    Options options_;
+    port::Mutex mu_;
+    VersionSet* versions_;
+};
+
+TEST_F(VersionSetTest, ManifestSizeIncludesHeadersAndPadding) {
+    Reopen();
+    // 很长的 key 让记录跨越多个块
+    const std::string big(40000, 'x');
+    for (int i = 0; i < 20; i++) {
+        AddFile(1, big + std::to_string(100 + i * 2), big + std::to_string(101 + i * 2));
+    }
+    EXPECT_EQ(ManifestFileSize(), versions_->ManifestFileSize());
+
+    Reopen();
+    EXPECT_EQ(ManifestFileSize(), versions_->ManifestFileSize());
+    EXPECT_EQ(20, versions_->NumLevelFiles(1));
+}
+
+TEST_F(VersionSetTest, RollManifestAndReopen) {
+    options_.max_manifest_file_size = 4096;
+    Reopen();
+    const uint64_t first_manifest = versions_->ManifestFileNumber();
+
+    // 反复加入和删除文件，历史记录增长而快照保持很小
+    uint64_t kept = AddFile(2, "a", "b");
+    for (int i = 0; i < 500; i++) {
+        RemoveFile(1, AddFile(1, "c" + std::to_string(i), "d"));
+    }
+    const uint64_t manifest = versions_->ManifestFileNumber();
+    EXPECT_NE(first_manifest, manifest);
+    EXPECT_EQ(ManifestFileSize(), versions_->ManifestFileSize());
+    EXPECT_LT(versions_->ManifestFileSize(), 3 * options_.max_manifest_file_size);
+    // 旧的 manifest 已经删除
+    EXPECT_FALSE(options_.env->FileExists(DescriptorFileName(dbname_, first_manifest)));
+
+    Reopen();
+    EXPECT_EQ(manifest, versions_->ManifestFileNumber());
+    EXPECT_EQ(ManifestFileSize(), versions_->ManifestFileSize());
+    EXPECT_EQ(0, versions_->NumLevelFiles(1));
+    ASSERT_EQ(1, versions_->NumLevelFiles(2));
+    EXPECT_EQ(kept, versions_->current()->files(2)[0]->number);
+
+    // 重新打开后继续追加，仍然可以恢复
+    AddFile(1, "e", "f");
+    Reopen();
+    EXPECT_EQ(1, versions_->NumLevelFiles(1));
+    EXPECT_EQ(1, versions_->NumLevelFiles(2));
+}
+
+TEST_F(VersionSetTest, ForcedBlobGC) {
+    options_.enable_blob_garbage_collection = true;
+    options_.blob_garbage_collection_age_cutoff = 0.5;
+    options_.blob_garbage_collection_force_threshold = 0.8;
+    Reopen();
+    uint64_t blobs[4];
+    for (int i = 0; i < 4; i++) {
+        blobs[i] = AddBlobFile();
+    }
+    const uint64_t old_file = AddFile(1, "a", "b", blobs[0]);
+    AddFile(2, "c", "d", blobs[2]);
+    AddFile(2, "e", "f");
+    Version* v = versions_->current();
+    EXPECT_EQ(blobs[2], v->BlobGCCutoffFileNumber(0.5));
+    EXPECT_EQ(blobs[0], v->BlobGCCutoffFileNumber(0));
+    EXPECT_EQ(~static_cast<uint64_t>(0), v->BlobGCCutoffFileNumber(1.0));
+    EXPECT_TRUE(v->FilesMarkedForForcedBlobGC().empty());
+    EXPECT_FALSE(versions_->NeedsCompaction());
+
+    // 最旧的一半 blob 文件中 garbage 不到 80%，不强制
+    AddBlobGarbage(blobs[0], 9, 900);
+    AddBlobGarbage(blobs[1], 6, 600);
+    AddBlobGarbage(blobs[3], 9, 999);
+    EXPECT_TRUE(versions_->current()->FilesMarkedForForcedBlobGC().empty());
+
+    // 达到 80% 后，引用它们的 table 需要 compaction
+    AddBlobGarbage(blobs[1], 1, 100);
+    v = versions_->current();
+    ASSERT_EQ(1u, v->FilesMarkedForForcedBlobGC().size());
+    EXPECT_EQ(1, v->FilesMarkedForForcedBlobGC()[0].first);
+    EXPECT_EQ(old_file, v->FilesMarkedForForcedBlobGC()[0].second->number);
+    EXPECT_TRUE(versions_->NeedsCompaction());
+
+    // 全部是 garbage 的 blob 文件不再属于新版本，garbage 重新打开后仍然保留
+    ASSERT_EQ(4u, v->blob_files().size());
+    AddBlobGarbage(blobs[0], 1, 100);
+    Reopen();
+    v = versions_->current();
+    ASSERT_EQ(3u, v->blob_files().size());
+    EXPECT_EQ(blobs[1], v->blob_files()[0]->number);
+    EXPECT_EQ(700u, v->blob_files()[0]->garbage_blob_bytes);
+    EXPECT_EQ(999u, v->blob_files()[2]->garbage_blob_bytes);
+    // 剩下的最旧一批只有 blobs[1]，garbage 不到 80%
+    EXPECT_EQ(blobs[2], v->BlobGCCutoffFileNumber(0.5));
+    EXPECT_TRUE(v->FilesMarkedForForcedBlobGC().empty());
+
+    AddBlobGarbage(blobs[1], 2, 200);
+    ASSERT_EQ(1u, versions_->current()->FilesMarkedForForcedBlobGC().size());
+
+    // 阈值为 1.0 时不强制
+    options_.blob_garbage_collection_force_threshold = 1.0;
+    Reopen();
+    EXPECT_TRUE(versions_->current()->FilesMarkedForForcedBlobGC().empty());
+    EXPECT_FALSE(versions_->NeedsCompaction());
+}
+
+} // namespace tinydb
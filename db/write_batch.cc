@@ -0,0 +1,221 @@
+/*
+ * WriteBatch::rep_ :=
+ *    sequence: fixed64
+ *    count: fixed32
+ *    data: record[count]
+ * record :=
+ *    kTypeValue varint32 varstring varstring         |
+ *    kTypeDeletion varint32 varstring                |
+ *    kTypeMerge varint32 varstring varstring         |
+ *    kTypeRangeDeletion varint32 varstring varstring
+ * varint32 :=
+ *    column family 编号
+ * varstring :=
+ *    len: varint32
+ *    data: uint8[len]
+ */
+
+#include "tinydb/write_batch.h"
+
+#include "db/dbformat.h"
+#include "db/memtable.h"
+#include "db/write_batch_internal.h"
+#include "util/coding.h"
+
+namespace tinydb {
+
+// WriteBatch header has an 8-byte sequence number followed by a 4-byte count.
+static const size_t kHeader = 12;
+
+WriteBatch::Handler::~Handler() = default;
+
+ColumnFamilyMemTables::~ColumnFamilyMemTables() = default;
+
+WriteBatch::WriteBatch() { Clear(); }
+
+WriteBatch::~WriteBatch() = default;
+
+void WriteBatch::Clear() {
+    rep_.clear();
+    rep_.resize(kHeader);
+}
+
+size_t WriteBatch::ApproximateSize() const { return rep_.size(); }
+
+Status WriteBatch::Iterate(Handler* handler) const {
+    Slice input(rep_);
+    if (input.size() < kHeader) {
+        return Status::Corruption("malformed WriteBatch (too small)");
+    }
+
+    input.remove_prefix(kHeader);
+    Slice key, value;
+    int found = 0;
+    Status s;
+    while (s.ok() && !input.empty()) {
+        found++;
+        const char tag = input[0];
+        input.remove_prefix(1);
+        uint32_t column_family;
+        if (!GetVarint32(&input, &column_family)) {
+            return Status::Corruption("bad WriteBatch column family");
+        }
+        switch (tag) {
+            case kTypeValue:
+                if (GetLengthPrefixedSlice(&input, &key) &&
+                    GetLengthPrefixedSlice(&input, &value)) {
+                    s = handler->Put(column_family, key, value);
+                } else {
+                    return Status::Corruption("bad WriteBatch Put");
+                }
+                break;
+            case kTypeDeletion:
+                if (GetLengthPrefixedSlice(&input, &key)) {
+                    s = handler->Delete(column_family, key);
+                } else {
+                    return Status::Corruption("bad WriteBatch Delete");
+                }
+                break;
+            case kTypeMerge:
+                if (GetLengthPrefixedSlice(&input, &key) &&
+                    GetLengthPrefixedSlice(&input, &value)) {
+                    s = handler->Merge(column_family, key, value);
+                } else {
+                    return Status::Corruption("bad WriteBatch Merge");
+                }
+                break;
+            case kTypeRangeDeletion:
+                if (GetLengthPrefixedSlice(&input, &key) &&
+                    GetLengthPrefixedSlice(&input, &value)) {
+                    s = handler->DeleteRange(column_family, key, value);
+                } else {
+                    return Status::Corruption("bad WriteBatch DeleteRange");
+                }
+                break;
+            default:
+                return Status::Corruption("unknown WriteBatch tag");
+        }
+    }
+    if (!s.ok()) {
+        return s;
+    }
+    if (found != WriteBatchInternal::Count(this)) {
+        return Status::Corruption("WriteBatch has wrong count");
+    }
+    return Status::OK();
+}
+
+int WriteBatchInternal::Count(const WriteBatch* b) {
+    return DecodeFixed32(b->rep_.data() + 8);
+}
+
+void WriteBatchInternal::SetCount(WriteBatch* b, int n) {
+    EncodeFixed32(&b->rep_[8], n);
+}
+
+SequenceNumber WriteBatchInternal::Sequence(const WriteBatch* b) {
+    return SequenceNumber(DecodeFixed64(b->rep_.data()));
+}
+
+void WriteBatchInternal::SetSequence(WriteBatch* b, SequenceNumber seq) {
+    EncodeFixed64(&b->rep_[0], seq);
+}
+
+void WriteBatch::Put(uint32_t column_family_id, const Slice& key, const Slice& value) {
+    WriteBatchInternal::SetCount(this, WriteBatchInternal::Count(this) + 1);
+    rep_.push_back(static_cast<char>(kTypeValue));
+    PutVarint32(&rep_, column_family_id);
+    PutLengthPrefixedSlice(&rep_, key);
+    PutLengthPrefixedSlice(&rep_, value);
+}
+
+void WriteBatch::Delete(uint32_t column_family_id, const Slice& key) {
+    WriteBatchInternal::SetCount(this, WriteBatchInternal::Count(this) + 1);
+    rep_.push_back(static_cast<char>(kTypeDeletion));
+    PutVarint32(&rep_, column_family_id);
+    PutLengthPrefixedSlice(&rep_, key);
+}
+
+void WriteBatch::Merge(uint32_t column_family_id, const Slice& key, const Slice& value) {
+    WriteBatchInternal::SetCount(this, WriteBatchInternal::Count(this) + 1);
+    rep_.push_back(static_cast<char>(kTypeMerge));
+    PutVarint32(&rep_, column_family_id);
+    PutLengthPrefixedSlice(&rep_, key);
+    PutLengthPrefixedSlice(&rep_, value);
+}
+
+void WriteBatch::DeleteRange(uint32_t column_family_id, const Slice& begin_key,
+                             const Slice& end_key) {
+    WriteBatchInternal::SetCount(this, WriteBatchInternal::Count(this) + 1);
+    rep_.push_back(static_cast<char>(kTypeRangeDeletion));
+    PutVarint32(&rep_, column_family_id);
+    PutLengthPrefixedSlice(&rep_, begin_key);
+    PutLengthPrefixedSlice(&rep_, end_key);
+}
+
+void WriteBatch::Append(const WriteBatch& source) {
+    WriteBatchInternal::Append(this, &source);
+}
+
+namespace {
+
+class MemTableInserter : public WriteBatch::Handler {
+public:
+    MemTableInserter(SequenceNumber sequence, ColumnFamilyMemTables* memtables)
+        : sequence_(sequence), memtables_(memtables) {}
+
+    Status Put(uint32_t column_family_id, const Slice& key,
+               const Slice& value) override {
+        return Add(column_family_id, kTypeValue, key, value);
+    }
+    Status Delete(uint32_t column_family_id, const Slice& key) override {
+        return Add(column_family_id, kTypeDeletion, key, Slice());
+    }
+    Status Merge(uint32_t column_family_id, const Slice& key,
+                 const Slice& value) override {
+        return Add(column_family_id, kTypeMerge, key, value);
+    }
+    Status DeleteRange(uint32_t column_family_id, const Slice& begin_key,
+                       const Slice& end_key) override {
+        return Add(column_family_id, kTypeRangeDeletion, begin_key, end_key);
+    }
+
+private:
+    Status Add(uint32_t column_family_id, ValueType type, const Slice& key,
+               const Slice& value) {
+        // 跳过的更新也占用序列号，同一个 batch 重放时序列号不变
+        const SequenceNumber seq = sequence_++;
+        bool skip = false;
+        MemTable* mem = memtables_->GetMemTable(column_family_id, &skip);
+        if (mem == nullptr) {
+            return skip ? Status::OK()
+                        : Status::InvalidArgument("column family not found");
+        }
+        mem->Add(seq, type, key, value);
+        return Status::OK();
+    }
+
+    SequenceNumber sequence_;
+    ColumnFamilyMemTables* const memtables_;
+};
+
+} // namespace
+
+Status WriteBatchInternal::InsertInto(const WriteBatch* b,
+                                      ColumnFamilyMemTables* memtables) {
+    MemTableInserter inserter(WriteBatchInternal::Sequence(b), memtables);
+    return b->Iterate(&inserter);
+}
+
+void WriteBatchInternal::SetContents(WriteBatch* b, const Slice& contents) {
+    assert(contents.size() >= kHeader);
+    b->rep_.assign(contents.data(), contents.size());
+}
+
+void WriteBatchInternal::Append(WriteBatch* dst, const WriteBatch* src) {
+    SetCount(dst, Count(dst) + Count(src));
+    assert(src->rep_.size() >= kHeader);
+    dst->rep_.append(src->rep_.data() + kHeader, src->rep_.size() - kHeader);
+}
+
+} // namespace tinydb
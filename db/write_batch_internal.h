@@ -0,0 +1,53 @@
+#ifndef STORAGE_TINYDB_DB_WRITE_BATCH_INTERNAL_H_
+#define STORAGE_TINYDB_DB_WRITE_BATCH_INTERNAL_H_
+
+#include "db/dbformat.h"
+#include "tinydb/write_batch.h"
+
+namespace tinydb {
+
+class MemTable;
+
+// 按 column family 编号找到写入的 memtable
+class ColumnFamilyMemTables {
+public:
+    virtual ~ColumnFamilyMemTables();
+
+    // 返回 column_family_id 当前的 memtable
+    // 返回 nullptr 且 *skip 为 true 时跳过属于它的更新(例如恢复时已经 flush 过的数据)，
+    // *skip 为 false 表示 column family 不存在
+    virtual MemTable* GetMemTable(uint32_t column_family_id, bool* skip) = 0;
+};
+
+// WriteBatch 中不需要出现在公开接口中的方法
+class WriteBatchInternal {
+public:
+    // Return the number of entries in the batch.
+    static int Count(const WriteBatch* batch);
+
+    // Set the count for the number of entries in the batch.
+    static void SetCount(WriteBatch* batch, int n);
+
+    // Return the sequence number for the start of this batch.
+    static SequenceNumber Sequence(const WriteBatch* batch);
+
+    // Store the specified number as the sequence number for the start of
+    // this batch.
+    static void SetSequence(WriteBatch* batch, SequenceNumber seq);
+
+    static Slice Contents(const WriteBatch* batch) { return Slice(batch->rep_); }
+
+    static size_t ByteSize(const WriteBatch* batch) { return batch->rep_.size(); }
+
+    static void SetContents(WriteBatch* batch, const Slice& contents);
+
+    // 从 Sequence(batch) 开始为每个更新分配一个序列号，写入对应 column family 的 memtable
+    // 遇到不存在的 column family 时返回 InvalidArgument，之前的更新已经写入
+    static Status InsertInto(const WriteBatch* batch, ColumnFamilyMemTables* memtables);
+
+    static void Append(WriteBatch* dst, const WriteBatch* src);
+};
+
+} // namespace tinydb
+
+#endif  // STORAGE_TINYDB_DB_WRITE_BATCH_INTERNAL_H_
@@ -0,0 +1,69 @@
+#ifndef STORAGE_TINYDB_INCLUDE_CACHE_H_
+#define STORAGE_TINYDB_INCLUDE_CACHE_H_
+
+/*
+ * Cache 是 key 到 value 的映射，内部做了同步，可以被多个线程并发使用
+ * 容量满时按某种策略淘汰旧的条目，每个条目按插入时给出的 charge 计入容量
+ *
+ * 内置的实现是 LRU，用户也可以实现自己的 Cache
+ */
+
+#include <cstdint>
+
+#include "tinydb/export.h"
+#include "tinydb/slice.h"
+
+namespace tinydb {
+
+class TINYDB_EXPORT Cache;
+
+// 创建一个容量固定的 LRU cache
+TINYDB_EXPORT Cache* NewLRUCache(size_t capacity);
+
+class TINYDB_EXPORT Cache {
+public:
+    Cache() = default;
+
+    Cache(const Cache&) = delete;
+    Cache& operator=(const Cache&) = delete;
+
+    // 析构时用插入时给出的 deleter 销毁所有条目
+    virtual ~Cache();
+
+    // Opaque handle to an entry stored in the cache.
+    struct Handle {};
+
+    /*
+     * 插入 key->value，按 charge 计入容量
+     * 返回该条目的 handle，调用者不再使用时必须调用 Release(handle)
+     * 条目被淘汰后，key 和 value 会被传给 deleter
+     */
+    virtual Handle* Insert(const Slice& key, void* value, size_t charge,
+                           void (*deleter)(const Slice& key, void* value)) = 0;
+
+    // 没有 key 时返回 nullptr，否则返回的 handle 必须调用 Release(handle)
+    virtual Handle* Lookup(const Slice& key) = 0;
+
+    // REQUIRES: handle must not have been released yet.
+    // REQUIRES: handle must have been returned by a method on *this.
+    virtual void Release(Handle* handle) = 0;
+
+    // 返回 Lookup() 得到的 handle 中的 value
+    virtual void* Value(Handle* handle) = 0;
+
+    // 删除 key，对应的条目在所有 handle 释放之后才会真正销毁
+    virtual void Erase(const Slice& key) = 0;
+
+    // 返回一个新的数值 id，多个客户端共享同一个 cache 时用它给 key 加前缀区分
+    virtual uint64_t NewId() = 0;
+
+    // 淘汰所有没有在使用的条目
+    virtual void Prune() {}
+
+    // 返回 cache 中所有条目的 charge 总和(估计值)
+    virtual size_t TotalCharge() const = 0;
+};
+
+} // namespace tinydb
+
+#endif  // STORAGE_TINYDB_INCLUDE_CACHE_H_
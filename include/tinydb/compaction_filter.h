@@ -0,0 +1,53 @@
+#ifndef STORAGE_TINYDB_INCLUDE_COMPACTION_FILTER_H_
+#define STORAGE_TINYDB_INCLUDE_COMPACTION_FILTER_H_
+
+/*
+ * CompactionFilter 在 compaction 合并数据时按用户的规则丢掉条目，例如已经过期的数据，
+ * 不需要额外的删除操作和 I/O
+ *
+ * 只作用于普通的 value(不包括删除标记和分离到 blob 文件中的 value)，并且只作用于
+ * 所有快照都能看到的版本。被丢掉的 key 在更深的层中还有旧版本时，会改写成删除标记，
+ * 以免旧版本重新变得可见
+ */
+
+#include <cstdint>
+#include <string>
+
+#include "tinydb/export.h"
+
+namespace tinydb {
+
+class Env;
+class Slice;
+
+class TINYDB_EXPORT CompactionFilter {
+public:
+    virtual ~CompactionFilter();
+
+    // filter 的名字，用于日志
+    virtual const char* Name() const = 0;
+
+    // 返回 true 表示丢掉这个条目，level 是 compaction 的输出层
+    // 会在后台 compaction 中调用，实现需要线程安全
+    virtual bool Filter(int level, const Slice& user_key,
+                        const Slice& value) const = 0;
+};
+
+/*
+ * 条目级 TTL：value 的末尾是写入时追加的时间(见 AppendTTLTimestamp)，
+ * 写入超过 ttl_seconds 秒的条目在 compaction 时被丢掉
+ * 使用它时所有 value 都必须带有时间，读到的 value 需要用 StripTTLTimestamp 去掉时间
+ * 调用者负责在不再使用之后删除返回的对象
+ */
+TINYDB_EXPORT const CompactionFilter* NewTTLCompactionFilter(Env* env,
+                                                             uint64_t ttl_seconds);
+
+// 在 *value 末尾追加当前时间，供 NewTTLCompactionFilter() 判断是否过期
+TINYDB_EXPORT void AppendTTLTimestamp(Env* env, std::string* value);
+
+// 去掉 *value 末尾的时间，value 太短时返回 false
+TINYDB_EXPORT bool StripTTLTimestamp(Slice* value);
+
+} // namespace tinydb
+
+#endif  // STORAGE_TINYDB_INCLUDE_COMPACTION_FILTER_H_
@@ -0,0 +1,48 @@
+#ifndef STORAGE_TINYDB_INCLUDE_COMPARATOR_H_
+#define STORAGE_TINYDB_INCLUDE_COMPARATOR_H_
+
+#include <string>
+
+#include "tinydb/export.h"
+
+namespace tinydb {
+
+class Slice;
+
+/*
+ * 定义 key 的全序关系，用于 sstable 和数据库中 key 的排序
+ * 实现必须是线程安全的，因为 tinydb 可能在多个线程中同时调用这些方法
+ */
+class TINYDB_EXPORT Comparator {
+public:
+    virtual ~Comparator();
+
+    // Three-way comparison.  Returns value:
+    //   < 0 iff "a" < "b",
+    //   == 0 iff "a" == "b",
+    //   > 0 iff "a" > "b"
+    virtual int Compare(const Slice& a, const Slice& b) const = 0;
+
+    /*
+     * 比较器的名字，用于检查打开数据库时使用的比较器与创建时是否一致
+     * 比较器的实现一旦改变了 key 的顺序，就必须换一个名字
+     * 以 "tinydb." 开头的名字保留给内部使用
+     */
+    virtual const char* Name() const = 0;
+
+    // 以下两个方法用于减小索引块等内部数据结构的空间
+    // 如果 *start < limit，把 *start 改成一个在 [start,limit) 之间、更短的字符串
+    // 简单的实现可以什么都不做
+    virtual void FindShortestSeparator(std::string* start,
+                                       const Slice& limit) const = 0;
+
+    // 把 *key 改成一个 >= *key 的更短的字符串，简单的实现可以什么都不做
+    virtual void FindShortSuccessor(std::string* key) const = 0;
+};
+
+// 返回按字节字典序比较的内置比较器，结果是单例，不能删除
+TINYDB_EXPORT const Comparator* BytewiseComparator();
+
+} // namespace tinydb
+
+#endif  // STORAGE_TINYDB_INCLUDE_COMPARATOR_H_
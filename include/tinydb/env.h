@@ -3,13 +3,40 @@
 
 #include <cstdarg>
 #include <cstdint>
+#include <string>
+#include <vector>
 
 #include "tinydb/export.h"
+#include "tinydb/rate_limiter.h"
 #include "tinydb/status.h"
 
 namespace tinydb {
 
+class FileLock;
+class RandomAccessFile;
 class SequentialFile;
+class WritableFile;
+
+// 打开文件时的 I/O 选项，flush 和 compaction 读写 table 文件时使用
+struct TINYDB_EXPORT EnvOptions {
+    // 使用直接 I/O(O_DIRECT)读写，绕过页缓存，大量一次性的读写不会把热数据挤出页缓存
+    // 偏移和长度的对齐由文件实现负责，调用者不需要关心
+    bool use_direct_io = false;
+
+    // 非 0 时，写文件时每写入这么多字节，就让操作系统在后台开始写回这部分脏页，
+    // 使写回均匀地分散开，而不是在 Sync()/Close() 时集中写出造成 I/O 尖峰
+    uint64_t bytes_per_sync = 0;
+
+    // 非空时，文件的每次读写都先按字节数向 rate_limiter 申请配额，用来限制后台 I/O 的速率
+    RateLimiter* rate_limiter = nullptr;
+
+    // 向 rate_limiter 申请配额时使用的优先级
+    RateLimiter::IOPriority rate_limiter_priority = RateLimiter::IO_LOW;
+
+    // 非 0 时，写到尚未分配的位置之前按这个粒度预先分配磁盘空间(不改变文件大小)，
+    // 减少文件增长时分配 extent 的开销。文件系统不支持时忽略
+    uint64_t preallocation_block_size = 0;
+};
 
 class TINYDB_EXPORT Env {
 public:
@@ -23,8 +50,77 @@ public:
     static Env* Default();
 
 
+    // 打开 fname 用于顺序读，成功时 *result 为新打开的文件，调用者负责删除
+    // 文件不存在时返回 NotFound
     virtual Status NewSequentialFile(const std::string& fname,
                                      SequentialFile** result) = 0;
+
+    // 打开 fname 用于随机读，*result 可以被多个线程并发使用
+    virtual Status NewRandomAccessFile(const std::string& fname,
+                                       RandomAccessFile** result) = 0;
+
+    // 创建 fname 用于写，已存在的同名文件会被清空
+    virtual Status NewWritableFile(const std::string& fname,
+                                   WritableFile** result) = 0;
+
+    // 按 options 打开 fname 用于随机读
+    // 请求直接 I/O 而 Env 或文件系统不支持时返回 NotSupported，调用者可以退回到普通文件
+    virtual Status NewRandomAccessFile(const std::string& fname,
+                                       const EnvOptions& options,
+                                       RandomAccessFile** result);
+
+    // 按 options 创建 fname 用于写，不支持直接 I/O 时同样返回 NotSupported
+    virtual Status NewWritableFile(const std::string& fname,
+                                   const EnvOptions& options,
+                                   WritableFile** result);
+
+    // 打开 fname 用于追加写，文件不存在时创建
+    virtual Status NewAppendableFile(const std::string& fname,
+                                     WritableFile** result);
+
+    /*
+     * 把 old_fname 重命名为 fname 并打开用于写，从文件开头覆盖写，不清空原有内容
+     * 覆盖写不改变文件大小，也不需要分配新的空间，Sync() 时不需要更新文件元数据
+     * 默认实现重命名后调用 NewWritableFile()，会清空文件
+     */
+    virtual Status ReuseWritableFile(const std::string& fname,
+                                     const std::string& old_fname,
+                                     const EnvOptions& options,
+                                     WritableFile** result);
+
+    virtual bool FileExists(const std::string& fname) = 0;
+
+    // 将 dir 下的文件名(不含路径)存到 *result
+    virtual Status GetChildren(const std::string& dir,
+                               std::vector<std::string>* result) = 0;
+
+    virtual Status RemoveFile(const std::string& fname) = 0;
+
+    virtual Status CreateDir(const std::string& dirname) = 0;
+
+    virtual Status RemoveDir(const std::string& dirname) = 0;
+
+    virtual Status GetFileSize(const std::string& fname, uint64_t* file_size) = 0;
+
+    virtual Status RenameFile(const std::string& src,
+                              const std::string& target) = 0;
+
+    // 为 src 创建硬链接 target，两者共享同一份数据
+    // 不支持硬链接(或 src 和 target 不在同一个文件系统上)时返回 NotSupported，调用者可以退回到复制
+    virtual Status LinkFile(const std::string& src, const std::string& target);
+
+    /*
+     * 锁住 fname，防止多个进程同时打开同一个数据库
+     * 成功时 *lock 为锁对象，调用者用 UnlockFile 释放；锁已被其他进程持有时立即返回错误
+     */
+    virtual Status LockFile(const std::string& fname, FileLock** lock) = 0;
+
+    virtual Status UnlockFile(FileLock* lock) = 0;
+
+    // 返回当前的微秒数，只用于计算时间差
+    virtual uint64_t NowMicros() = 0;
+
+    virtual void SleepForMicroseconds(int micros) = 0;
 };
 
 /*
@@ -62,6 +158,12 @@ public:
         该方法是线程安全的，多个线程可以安全地并发使用它
      */
     virtual Status Read(uint64_t offset, size_t, Slice* result, char* scratch) const = 0;
+
+    /*
+        提示操作系统 [offset, offset + n) 很快就会被读取，可以在后台提前读入页缓存
+        只是提示，不会阻塞等待 I/O 完成，不支持的实现什么也不做
+     */
+    virtual Status Prefetch(uint64_t offset, size_t n) const;
 };
 
 /*
@@ -109,10 +211,18 @@ public:
 TINYDB_EXPORT Status WriteStringToFile(Env* env, const Slice& data,
 const std::string& fname);
 
+// A utility routine: write "data" to the named file and Sync() it.
+TINYDB_EXPORT Status WriteStringToFileSync(Env* env, const Slice& data,
+const std::string& fname);
+
 // A utility routine: read contents of named file into *data
 TINYDB_EXPORT Status ReadFileToString(Env* env, const std::string& fname,
         std::string* data);
 
+// 把 src 的内容复制到新文件 target 并 Sync()，失败时删除 target
+TINYDB_EXPORT Status CopyFile(Env* env, const std::string& src,
+        const std::string& target);
+
 
 class TINYDB_EXPORT FileLock {
 public:
@@ -132,6 +242,71 @@ public:
  */
 class TINYDB_EXPORT EnvWrapper: public Env {
 public:
+    // 所有调用都转发给 t
+    explicit EnvWrapper(Env* t) : target_(t) {}
+    virtual ~EnvWrapper();
+
+    // 返回被包装的 Env
+    Env* target() const { return target_; }
+
+    Status NewSequentialFile(const std::string& f, SequentialFile** r) override {
+        return target_->NewSequentialFile(f, r);
+    }
+    Status NewRandomAccessFile(const std::string& f,
+                               RandomAccessFile** r) override {
+        return target_->NewRandomAccessFile(f, r);
+    }
+    Status NewWritableFile(const std::string& f, WritableFile** r) override {
+        return target_->NewWritableFile(f, r);
+    }
+    Status NewRandomAccessFile(const std::string& f, const EnvOptions& o,
+                               RandomAccessFile** r) override {
+        return target_->NewRandomAccessFile(f, o, r);
+    }
+    Status NewWritableFile(const std::string& f, const EnvOptions& o,
+                           WritableFile** r) override {
+        return target_->NewWritableFile(f, o, r);
+    }
+    Status NewAppendableFile(const std::string& f, WritableFile** r) override {
+        return target_->NewAppendableFile(f, r);
+    }
+    Status ReuseWritableFile(const std::string& f, const std::string& old_f,
+                             const EnvOptions& o, WritableFile** r) override {
+        return target_->ReuseWritableFile(f, old_f, o, r);
+    }
+    bool FileExists(const std::string& f) override {
+        return target_->FileExists(f);
+    }
+    Status GetChildren(const std::string& dir,
+                       std::vector<std::string>* r) override {
+        return target_->GetChildren(dir, r);
+    }
+    Status RemoveFile(const std::string& f) override {
+        return target_->RemoveFile(f);
+    }
+    Status CreateDir(const std::string& d) override {
+        return target_->CreateDir(d);
+    }
+    Status RemoveDir(const std::string& d) override {
+        return target_->RemoveDir(d);
+    }
+    Status GetFileSize(const std::string& f, uint64_t* s) override {
+        return target_->GetFileSize(f, s);
+    }
+    Status RenameFile(const std::string& s, const std::string& t) override {
+        return target_->RenameFile(s, t);
+    }
+    Status LinkFile(const std::string& s, const std::string& t) override {
+        return target_->LinkFile(s, t);
+    }
+    Status LockFile(const std::string& f, FileLock** l) override {
+        return target_->LockFile(f, l);
+    }
+    Status UnlockFile(FileLock* l) override { return target_->UnlockFile(l); }
+    uint64_t NowMicros() override { return target_->NowMicros(); }
+    void SleepForMicroseconds(int micros) override {
+        target_->SleepForMicroseconds(micros);
+    }
 
 private:
     Env* target_;
@@ -0,0 +1,46 @@
+#ifndef STORAGE_TINYDB_INCLUDE_FILTER_POLICY_H_
+#define STORAGE_TINYDB_INCLUDE_FILTER_POLICY_H_
+
+/*
+ * FilterPolicy 为一组 key 生成一个小的过滤器，保存在 sstable 中
+ * 读取时先用过滤器判断 key 是否可能存在，大幅减少 Get() 的磁盘读取
+ *
+ * 大多数情况下使用内置的 bloom filter 即可
+ */
+
+#include <string>
+
+#include "tinydb/export.h"
+
+namespace tinydb {
+
+class Slice;
+
+class TINYDB_EXPORT FilterPolicy {
+public:
+    virtual ~FilterPolicy();
+
+    // 过滤器的名字，过滤器的编码方式改变时必须换名字，
+    // 否则旧的过滤器可能被错误地传给 KeyMayMatch
+    virtual const char* Name() const = 0;
+
+    // keys[0,n-1] 按比较器有序(可能有重复)，为它们生成过滤器追加到 *dst
+    // 注意：不能修改 *dst 原有的内容
+    virtual void CreateFilter(const Slice* keys, int n,
+                              std::string* dst) const = 0;
+
+    // filter 是 CreateFilter 生成的内容
+    // key 在生成 filter 的 key 列表中时必须返回 true，不在时应当尽可能返回 false
+    virtual bool KeyMayMatch(const Slice& key, const Slice& filter) const = 0;
+};
+
+/*
+ * 返回每个 key 使用大约 bits_per_key 位的 bloom filter 策略，10 是比较好的取值，
+ * 误判率大约 1%
+ * 调用者负责在所有使用它的 table 关闭之后删除返回的对象
+ */
+TINYDB_EXPORT const FilterPolicy* NewBloomFilterPolicy(int bits_per_key);
+
+} // namespace tinydb
+
+#endif  // STORAGE_TINYDB_INCLUDE_FILTER_POLICY_H_
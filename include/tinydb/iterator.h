@@ -0,0 +1,95 @@
+#ifndef STORAGE_TINYDB_INCLUDE_ITERATOR_H_
+#define STORAGE_TINYDB_INCLUDE_ITERATOR_H_
+
+/*
+ * 迭代器从某个数据源中按顺序产生一串 key/value
+ * 本接口定义了 memtable、sstable、数据库等各种迭代器的共同行为
+ *
+ * 多个线程可以并发调用迭代器的 const 方法，
+ * 非 const 方法需要外部同步
+ */
+
+#include "tinydb/export.h"
+#include "tinydb/slice.h"
+#include "tinydb/status.h"
+
+namespace tinydb {
+
+class TINYDB_EXPORT Iterator {
+public:
+    Iterator();
+
+    Iterator(const Iterator&) = delete;
+    Iterator& operator=(const Iterator&) = delete;
+
+    virtual ~Iterator();
+
+    // 迭代器是否指向一个有效的 key/value
+    virtual bool Valid() const = 0;
+
+    // 定位到第一个 key，数据源不为空时之后 Valid() 为 true
+    virtual void SeekToFirst() = 0;
+
+    // 定位到最后一个 key，数据源不为空时之后 Valid() 为 true
+    virtual void SeekToLast() = 0;
+
+    // 定位到第一个 >= target 的 key，存在时之后 Valid() 为 true
+    virtual void Seek(const Slice& target) = 0;
+
+    // 移动到下一个 key
+    // REQUIRES: Valid()
+    virtual void Next() = 0;
+
+    // 移动到上一个 key
+    // REQUIRES: Valid()
+    virtual void Prev() = 0;
+
+    // 返回当前的 key，只在下一次修改迭代器之前有效
+    // REQUIRES: Valid()
+    virtual Slice key() const = 0;
+
+    // 返回当前的 value，只在下一次修改迭代器之前有效
+    // REQUIRES: Valid()
+    virtual Slice value() const = 0;
+
+    // 出错时返回错误，否则返回 ok
+    virtual Status status() const = 0;
+
+    /*
+     * 注册一个在迭代器析构时调用的清理函数
+     * 注意这个方法不是虚函数，子类不应该覆盖
+     */
+    using CleanupFunction = void (*)(void* arg1, void* arg2);
+    void RegisterCleanup(CleanupFunction function, void* arg1, void* arg2);
+
+private:
+    /*
+     * 清理函数存放在单链表中，头结点直接内嵌在迭代器里
+     */
+    struct CleanupNode {
+        // True if the node is not used. Only head nodes might be unused.
+        bool IsEmpty() const { return function == nullptr; }
+        // Invokes the cleanup function.
+        void Run() {
+            assert(function != nullptr);
+            (*function)(arg1, arg2);
+        }
+
+        // The head node is used if the function pointer is not null.
+        CleanupFunction function;
+        void* arg1;
+        void* arg2;
+        CleanupNode* next;
+    };
+    CleanupNode cleanup_head_;
+};
+
+// 返回一个空的迭代器
+TINYDB_EXPORT Iterator* NewEmptyIterator();
+
+// 返回一个空的、status() 为 status 的迭代器
+TINYDB_EXPORT Iterator* NewErrorIterator(const Status& status);
+
+} // namespace tinydb
+
+#endif  // STORAGE_TINYDB_INCLUDE_ITERATOR_H_
@@ -0,0 +1,59 @@
+#ifndef STORAGE_TINYDB_INCLUDE_MEMTABLE_REP_H_
+#define STORAGE_TINYDB_INCLUDE_MEMTABLE_REP_H_
+
+/*
+ * memtable 的内部数据结构(MemTableRep)可以按数据库选择，见 Options::memtable_factory
+ *
+ * - SkipList: 默认实现，插入和查找都是 O(log n)，随时可以有序遍历
+ * - HashSkipList: 按 key 的前缀(没有 prefix_extractor 时按完整的 user key)分桶，
+ *   每个桶是一个跳表。适合前缀很多、每个前缀下 key 也不少的负载
+ * - HashLinkList: 分桶方式同上，每个桶是一个有序单链表，桶中元素很少时 Get 和插入
+ *   都是 O(1) 期望时间。适合只做点查询、从不扫描的负载
+ * - Vector: 条目按插入顺序追加，memtable 变为只读时并行排序一次。插入最快，
+ *   但可写期间的读取需要线性扫描或排序，只适合写完之前不读的批量导入
+ *
+ * 两种哈希实现只在需要全序遍历(例如 flush)时才把所有条目取出排序一次，
+ * 不适合频繁全序扫描的负载。所有实现的内存都从 memtable 的 Arena 分配，
+ * 支持一个写线程与多个读线程并发，读不加锁
+ */
+
+#include <cstddef>
+
+#include "tinydb/export.h"
+
+namespace tinydb {
+
+class Arena;
+class MemTableKeyComparator;
+class MemTableRep;
+class SliceTransform;
+
+class TINYDB_EXPORT MemTableRepFactory {
+public:
+    virtual ~MemTableRepFactory();
+
+    virtual const char* Name() const = 0;
+
+    // 内部使用：创建一个 MemTableRep，内存从 arena 分配
+    // prefix_extractor 是作用于 user key 的前缀变换，可以为 nullptr
+    virtual MemTableRep* CreateMemTableRep(const MemTableKeyComparator& cmp,
+                                           Arena* arena,
+                                           const SliceTransform* prefix_extractor) = 0;
+};
+
+TINYDB_EXPORT MemTableRepFactory* NewSkipListRepFactory();
+
+// bucket_count: 桶的个数，桶数组在创建 memtable 时从它的 arena 一次分配(每个桶一个指针)，
+// 计入 memtable 的内存用量
+TINYDB_EXPORT MemTableRepFactory* NewHashSkipListRepFactory(
+        size_t bucket_count = 100000);
+
+TINYDB_EXPORT MemTableRepFactory* NewHashLinkListRepFactory(
+        size_t bucket_count = 50000);
+
+// sort_threads: memtable 变为只读时用于排序的线程数
+TINYDB_EXPORT MemTableRepFactory* NewVectorRepFactory(int sort_threads = 4);
+
+} // namespace tinydb
+
+#endif  // STORAGE_TINYDB_INCLUDE_MEMTABLE_REP_H_
@@ -0,0 +1,62 @@
+#ifndef STORAGE_TINYDB_INCLUDE_MERGE_OPERATOR_H_
+#define STORAGE_TINYDB_INCLUDE_MERGE_OPERATOR_H_
+
+/*
+ * MergeOperator 实现不需要先读的读-改-写：写入时只记录一个操作数(kTypeMerge)，
+ * 与 value 一样写入 WAL 和 memtable，读取时才把操作数依次作用到更旧的值上
+ * compaction 也会合并操作数：遇到更旧的值或删除记录时合并成一个普通的值，
+ * 否则尽量用 PartialMerge() 把相邻的操作数合并成一个，避免操作数链越来越长
+ *
+ * 例如计数器：每次加一写入一个 "+1" 的操作数，不需要先 Get 出原来的值
+ */
+
+#include <string>
+#include <vector>
+
+#include "tinydb/export.h"
+
+namespace tinydb {
+
+class Slice;
+
+class TINYDB_EXPORT MergeOperator {
+public:
+    virtual ~MergeOperator();
+
+    // 名字，用于日志
+    virtual const char* Name() const = 0;
+
+    /*
+     * 把 operands(从旧到新)依次作用到 existing_value 上，结果存到 *new_value
+     * existing_value 为 nullptr 表示 key 不存在或者已经被删除
+     * 返回 false 表示数据损坏，读取和 compaction 会返回 Corruption
+     */
+    virtual bool FullMerge(const Slice& key, const Slice* existing_value,
+                           const std::vector<Slice>& operands,
+                           std::string* new_value) const = 0;
+
+    /*
+     * 把两个相邻的操作数(left_operand 更旧)合并成一个，效果与依次作用这两个操作数相同
+     * 不能合并时返回 false，默认实现总是返回 false
+     */
+    virtual bool PartialMerge(const Slice& key, const Slice& left_operand,
+                              const Slice& right_operand,
+                              std::string* new_value) const;
+};
+
+/*
+ * 64 位无符号计数器：值和操作数都是 8 字节的 fixed64(小端)，合并时相加
+ * 值或操作数的长度不是 8 字节时合并失败，读取和 compaction 返回 Corruption
+ * 调用者负责在不再使用之后删除返回的对象
+ */
+TINYDB_EXPORT const MergeOperator* NewUInt64AddOperator();
+
+/*
+ * 追加列表：用 delim 把操作数依次追加到原来的值后面
+ * 调用者负责在不再使用之后删除返回的对象
+ */
+TINYDB_EXPORT const MergeOperator* NewStringAppendOperator(char delim);
+
+} // namespace tinydb
+
+#endif  // STORAGE_TINYDB_INCLUDE_MERGE_OPERATOR_H_
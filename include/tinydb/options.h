@@ -2,34 +2,254 @@
 #define STORAGE_TINYDB_INCLUDE_OPTIONS_H
 
 
+#include <climits>
 #include <cstddef>
+#include <cstdint>
+#include <vector>
+
 #include "tinydb/export.h"
 
 
 namespace tinydb {
 
+class Cache;
+class Comparator;
+class Env;
+class CompactionFilter;
+class FilterPolicy;
+class MemTableRepFactory;
+class MergeOperator;
+class RateLimiter;
+class SliceTransform;
+class Statistics;
+class WriteBufferManager;
+
 enum CompressionType {
     kNoCompression = 0x0,
     kSnappyCompression = 0x1,
     kZstdCompression = 0x2,
 };
 
+// compaction 的方式，见 Options::compaction_style
+enum CompactionStyle {
+    // 每层(L0 以外)是一个有序且互不重叠的 run，每层大小是上一层的 10 倍。
+    // 读放大和空间放大小，写放大大
+    kCompactionStyleLevel = 0x0,
+    // universal(tiered)：每个 L0 文件和每个非空的层各是一个 sorted run，
+    // 按大小比例合并相邻的 run。写放大小，读放大和空间放大大
+    kCompactionStyleUniversal = 0x1,
+    // FIFO：所有文件都在 L0，总大小或文件存在的时间超过限制时直接删除最旧的文件，
+    // 不读也不改写任何数据。适合只保留最近一段时间数据的场景(例如监控指标)
+    kCompactionStyleFIFO = 0x2,
+};
+
+// universal compaction 的参数
+struct TINYDB_EXPORT CompactionOptionsUniversal {
+    // 从较新的 run 开始挑选，已选中的 run 的总大小乘以 (100 + size_ratio)% 后
+    // 不小于下一个(更旧的) run 时，把下一个 run 也加入这次合并
+    unsigned int size_ratio = 1;
+
+    // 一次合并的 sorted run 个数的下限和上限
+    unsigned int min_merge_width = 2;
+    unsigned int max_merge_width = UINT_MAX;
+
+    // 空间放大触发：除最旧的 run 以外所有 run 的总大小超过最旧 run 的这个百分比时，
+    // 把所有 run 合并成一个。200 表示最多占用 3 倍于实际数据的空间
+    unsigned int max_size_amplification_percent = 200;
+};
+
+// FIFO compaction 的参数
+struct TINYDB_EXPORT CompactionOptionsFIFO {
+    // 所有 table 文件的总大小超过该值时，从最旧的文件开始删除
+    uint64_t max_table_files_size = 1024 * 1024 * 1024;
+
+    // 文件生成后超过这么多秒时删除，为 0 时只按总大小删除
+    // 按文件的生成时间判断，文件中最新的数据也过期之后才会被删除
+    uint64_t ttl = 0;
+};
+
 struct TINYDB_EXPORT Options {
     Options();
 
+    // 定义 key 顺序的比较器，默认按字节字典序
+    // 打开数据库时使用的比较器必须与创建时的名字一致
+    const Comparator* comparator;
+
+    // 用于读写文件等操作系统相关的功能，默认为 Env::Default()
+    Env* env;
+
     bool create_if_missing = false;
     bool error_if_exists = false;
+
+    // 为 true 时对数据做更严格的检查，例如打开 table 时校验元数据块的 crc
+    bool paranoid_checks = false;
     int max_open_files = 1000;
     size_t block_size = 4 * 1024;
     int block_restart_interval = 16;
     size_t max_file_size = 2 * 1024 * 1024;
+
+    // 保留这么多个不再需要的 WAL 文件，新的 WAL 重命名后复用它们(见 NewLogFile())，
+    // 覆盖写已经分配好空间的文件，Sync() 不需要更新文件大小等元数据。为 0 时不复用
+    size_t recycle_log_file_num = 0;
+
+    // 非 0 时新建的 WAL 按这个粒度用 fallocate 预先分配空间，见 EnvOptions::preallocation_block_size
+    size_t wal_preallocation_size = 0;
+
+    // WAL 记录的压缩算法，目前只支持 kZstdCompression(级别为 zstd_compression_level)，
+    // 跨记录流式压缩，见 log::Writer。其他值不压缩
+    CompressionType wal_compression = kNoCompression;
     CompressionType compression = kSnappyCompression;
+
+    // 数据块的缓存，为 nullptr 时不缓存
+    Cache* block_cache = nullptr;
+
+    // 点查的结果缓存，key 是 (table 文件, user key)，value 是文件中这个 key 最新的条目，
+    // 命中时不需要查索引和解码数据块，适合少数热点 key 承担大部分 Get() 的负载。
+    // 为 nullptr 时不缓存。可以被多个数据库共享
+    Cache* row_cache = nullptr;
+
+    // 非空时为每个 table 生成过滤器，Get() 时跳过不包含该 key 的数据块
+    const FilterPolicy* filter_policy = nullptr;
+
+    // 非空时把 key 的前缀也加入 table 的过滤器(需要设置 filter_policy)和 memtable 的前缀
+    // bloom filter，迭代器进入前缀 seek 模式：Seek(target) 时先用过滤器检查 target 的前缀，
+    // 确定不存在的 table 和 memtable 不读取任何数据块。见 ReadOptions::total_order_seek
+    const SliceTransform* prefix_extractor = nullptr;
+
+    // 是否把完整的 key 加入 table 的过滤器。只做前缀查询的负载可以设为 false，
+    // 过滤器只包含前缀，占用更少的空间。为 false 时 Get() 使用前缀过滤
+    bool whole_key_filtering = true;
+
+    // memtable 的大小上限
+    size_t write_buffer_size = 4 * 1024 * 1024;
+
+    // 非空时 memtable 的内存都计入它，所有 memtable 的总量接近它的预算时 flush 最大的 memtable，
+    // 可以被多个数据库共享，见 tinydb/write_buffer_manager.h。对整个数据库(所有 column family)生效
+    WriteBufferManager* write_buffer_manager = nullptr;
+
+    // 设置了 prefix_extractor 时，memtable 前缀 bloom filter 的大小与 write_buffer_size 的比值，
+    // 为 0 时 memtable 不使用前缀 bloom filter
+    double memtable_prefix_bloom_size_ratio = 0;
+
+    // 创建 memtable 内部数据结构的工厂，为 nullptr 时使用跳表，见 tinydb/memtable_rep.h
+    // 按前缀分桶的实现应与 prefix_extractor 一起使用
+    MemTableRepFactory* memtable_factory = nullptr;
+
+    // compaction 方式，在较低的读放大(leveled)和较低的写放大(universal)之间选择
+    // 两种方式的文件格式相同，但 universal 下每层只有一个 sorted run，切换前需要全量 compaction
+    // FIFO 不支持键值分离，被删除的 table 引用的 blob 不会被回收
+    CompactionStyle compaction_style = kCompactionStyleLevel;
+    CompactionOptionsUniversal compaction_options_universal;
+    CompactionOptionsFIFO compaction_options_fifo;
+
+    // 非空时在合并数据的 compaction 中对条目调用，丢掉它认为不再需要的条目，
+    // 例如 NewTTLCompactionFilter() 按条目的写入时间丢掉过期数据。见 tinydb/compaction_filter.h
+    const CompactionFilter* compaction_filter = nullptr;
+
+    // 写入 merge 操作数(kTypeMerge)时必须设置，读取和 compaction 时用它合并操作数，
+    // 例如 NewUInt64AddOperator() 实现计数器。见 tinydb/merge_operator.h
+    const MergeOperator* merge_operator = nullptr;
+
+    // 键值分离：flush/compaction 时把不小于 min_blob_size 字节的 value 写到单独的 blob 文件，
+    // table 中只保存指向它的 BlobIndex。compaction 只改写很小的 BlobIndex，
+    // value 较大的负载写放大明显降低，代价是读取这些 value 需要多一次 I/O
+    bool enable_blob_files = false;
+    size_t min_blob_size = 4 * 1024;
+
+    // blob GC：compaction 遇到指向最旧的 blob_garbage_collection_age_cutoff 比例的
+    // blob 文件的 BlobIndex 时，把 blob 搬到新的 blob 文件，旧文件全部变成 garbage 后删除
+    bool enable_blob_garbage_collection = false;
+    double blob_garbage_collection_age_cutoff = 0.25;
+
+    // 最旧的那批 blob 文件中 garbage 的比例达到该值时，强制 compaction 引用它们的 table，
+    // 尽快回收空间。为 1.0 时不强制，只依靠普通 compaction 顺带回收
+    double blob_garbage_collection_force_threshold = 1.0;
+
+    // 顺序扫描 table 时自动预读的最大字节数。检测到顺序读取后，
+    // 预读大小从 8KB 开始每次翻倍，直到该值。为 0 时不自动预读
+    size_t max_readahead_size = 256 * 1024;
+
+    // 分区索引：索引块按 block_size 切成多个分区，footer 指向一个只包含各分区
+    // 最后一个 key 的顶层索引。打开 table 时只读顶层索引，查找时只读取并缓存
+    // 用到的分区，避免大文件的索引块占满 block cache
+    bool partition_index = false;
+
+    // 分区过滤器：与索引分区一一对应，每个分区一个过滤器，由顶层过滤器索引定位
+    // 需要同时打开 partition_index 和设置 filter_policy
+    bool partition_filters = false;
+
+    // Zstd 压缩级别，仅在 compression == kZstdCompression 时生效
+    int zstd_compression_level = 1;
+
+    // Zstd 字典的最大字节数。为 0 时不使用字典，每个块独立压缩
+    // 非 0 时，构建 table 时会从数据块中采样训练一个字典，存放在 meta block 中，
+    // 该 table 的所有数据块都用这个字典压缩。值很小的负载(如短 JSON)压缩率提升明显
+    size_t zstd_max_dict_bytes = 0;
+
+    // 用于训练字典的样本总字节数上限。为 0 时不训练，直接把前 zstd_max_dict_bytes
+    // 字节的样本当作原始内容字典(raw content dictionary)使用
+    size_t zstd_max_train_bytes = 0;
+
+    // 每层使用的压缩算法。为空时所有层都使用 compression；
+    // 层数超过 vector 长度时，更深的层沿用最后一个元素。
+    // 通常上层写得多、存活时间短，用 kNoCompression 或 kSnappyCompression，
+    // 最底层数据量最大、很少改写，用 kZstdCompression 和更高的压缩级别
+    std::vector<CompressionType> compression_per_level;
+
+    // 每层的压缩级别(目前只对 Zstd 有意义)，规则同 compression_per_level，
+    // 为空时使用 zstd_compression_level
+    std::vector<int> compression_level_per_level;
+
+    // 压缩后至少要节省的比例，达不到就按不压缩存储该块
+    double min_compression_savings = 0.125;
+
+    // 自适应压缩：某一层的块大多压缩不动时，只对其中一部分块尝试压缩，
+    // 省下压缩的 CPU 开销。压缩率回升后自动恢复。需要传入 CompressionStats
+    bool adaptive_compression = false;
+
+    // flush 和 compaction 读写 table 文件时使用直接 I/O，绕过页缓存，
+    // 避免大 compaction 把前台读取用到的热数据挤出页缓存。文件系统不支持时退回到普通 I/O
+    bool use_direct_io_for_flush_and_compaction = false;
+
+    // flush 和 compaction 写 table 文件时，每写入这么多字节就让操作系统开始在后台写回，
+    // 把写回分散开，避免在文件结束时集中写出造成前台读取延迟抖动。为 0 时不做
+    uint64_t bytes_per_sync = 0;
+
+    // 非空时 flush 和 compaction 读写 table 文件的字节数都计入该限速器，
+    // flush 使用高优先级，compaction 使用低优先级。可以被多个数据库共享。
+    // 自动调整模式的限速器还会收到 table 读取未命中 block cache 的块时的延迟
+    RateLimiter* rate_limiter = nullptr;
+
+    // 非空时记录读写、WAL、过滤器、flush 和 compaction 等计数器，见 tinydb/statistics.h
+    // 可以被多个数据库共享。对整个数据库(所有 column family)生效
+    Statistics* statistics = nullptr;
+
+    // manifest 中的历史记录(快照之后追加的 VersionEdit)超过该值，且超过快照本身的大小时，
+    // 切换到一个以当前版本快照开头的新 manifest。这样打开数据库时读取的 manifest
+    // 大小只与存活文件数有关，不会随着历史不断增长
+    size_t max_manifest_file_size = 4 * 1024 * 1024;
 };
 
-struct TINYDB_EXPORT ReadOption {
+struct TINYDB_EXPORT ReadOptions {
+    ReadOptions() = default;
+
+    // 为 true 时校验读到的所有数据的 crc
     bool verify_checksums = false;
+
+    // 本次读取的块是否放入 block cache，批量扫描时通常设为 false
     bool fill_cache = true;
 
+    // 迭代器每次从文件预读的固定字节数。为 0 时按 Options::max_readahead_size 自动预读，
+    // 已知要做大范围扫描时设成较大的值(例如 2MB)，从第一个块开始就按大块读取
+    size_t readahead_size = 0;
+
+    // 为 true 时忽略 prefix_extractor，迭代器按完整的顺序 seek，不使用前缀过滤
+    // 前缀 seek 模式下 Seek(target) 只保证返回与 target 前缀相同的 key 是正确的
+    bool total_order_seek = false;
+
+    // 前缀 seek 模式下，迭代器只返回与 Seek() 目标前缀相同的 key，
+    // 遇到其他前缀的 key 时变为无效，前缀扫描的开销只与结果的数量有关
+    bool prefix_same_as_start = false;
 };
 
 struct TINYDB_EXPORT WriteOptions {
@@ -0,0 +1,83 @@
+#ifndef STORAGE_TINYDB_INCLUDE_RATE_LIMITER_H_
+#define STORAGE_TINYDB_INCLUDE_RATE_LIMITER_H_
+
+#include <cstdint>
+
+#include "tinydb/export.h"
+
+namespace tinydb {
+
+class Env;
+
+/*
+ * 限制后台 I/O(flush、compaction 读写 table 文件)的速率
+ * 每次读写前按字节数向 RateLimiter 申请配额，配额不足时阻塞，直到下一次补充
+ * 多个数据库可以共享同一个 RateLimiter，这样总的后台 I/O 受同一个预算约束
+ *
+ * 内部做了同步，可以被多个线程并发使用
+ */
+class TINYDB_EXPORT RateLimiter {
+public:
+    // 请求的优先级，配额不足时高优先级的请求先得到满足
+    enum IOPriority {
+        IO_LOW = 0,   // compaction
+        IO_HIGH = 1,  // flush，不及时完成会阻塞前台写入
+        IO_TOTAL = 2
+    };
+
+    RateLimiter() = default;
+
+    RateLimiter(const RateLimiter&) = delete;
+    RateLimiter& operator=(const RateLimiter&) = delete;
+
+    // 析构时不能有正在等待的 Request()
+    virtual ~RateLimiter();
+
+    // 修改每秒允许的字节数
+    virtual void SetBytesPerSecond(int64_t bytes_per_second) = 0;
+
+    // 当前每秒允许的字节数，自动调整模式下会随前台延迟变化
+    virtual int64_t GetBytesPerSecond() const = 0;
+
+    /*
+     * 申请 bytes 字节的配额，配额不足时阻塞
+     * bytes 应当不超过 GetSingleBurstBytes()，更大的请求要等待多个周期才能得到满足
+     */
+    virtual void Request(int64_t bytes, IOPriority pri) = 0;
+
+    // 一次 Request() 最多可以申请的字节数，调用者需要把更大的读写拆开
+    virtual int64_t GetSingleBurstBytes() const = 0;
+
+    // pri 为 IO_TOTAL 时返回所有优先级的总和
+    virtual int64_t GetTotalBytesThrough(IOPriority pri = IO_TOTAL) const = 0;
+    virtual int64_t GetTotalRequests(IOPriority pri = IO_TOTAL) const = 0;
+
+    // 是否根据前台延迟自动调整速率
+    virtual bool IsAutoTuned() const { return false; }
+
+    /*
+     * 报告一次前台读 I/O 的延迟，table 在读取不在 block cache 中的块时调用
+     * 自动调整模式下，前台延迟升高时降低后台速率，延迟恢复后再逐渐提高
+     */
+    virtual void ReportForegroundLatency(uint64_t micros) {}
+};
+
+/*
+ * 创建一个令牌桶实现的 RateLimiter
+ *   rate_bytes_per_sec: 每秒允许的字节数，自动调整模式下是速率的上限
+ *   refill_period_us: 补充配额的周期，每个周期补充 rate_bytes_per_sec * refill_period_us / 1e6 字节
+ *   fairness: 配额不足时低优先级的请求有 1/fairness 的概率先于高优先级得到满足，避免饿死
+ *   auto_tuned: 为 true 时根据 ReportForegroundLatency() 报告的延迟在
+ *               [rate_bytes_per_sec / 20, rate_bytes_per_sec] 之间自动调整速率
+ *   foreground_latency_target_us: 自动调整的目标延迟，为 0 时以观察到的最低延迟为基准，
+ *               延迟超过基准的两倍即认为前台受到了影响
+ *   env: 用于计时，为 nullptr 时使用 Env::Default()
+ */
+TINYDB_EXPORT RateLimiter* NewGenericRateLimiter(
+        int64_t rate_bytes_per_sec, int64_t refill_period_us = 100 * 1000,
+        int32_t fairness = 10, bool auto_tuned = false,
+        uint64_t foreground_latency_target_us = 0, Env* env = nullptr);
+
+} // namespace tinydb
+
+#endif  // STORAGE_TINYDB_INCLUDE_RATE_LIMITER_H_
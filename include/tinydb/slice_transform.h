@@ -0,0 +1,42 @@
+#ifndef STORAGE_TINYDB_INCLUDE_SLICE_TRANSFORM_H_
+#define STORAGE_TINYDB_INCLUDE_SLICE_TRANSFORM_H_
+
+/*
+ * SliceTransform 把 key 映射为它的前缀，用于前缀 bloom filter 和前缀 seek
+ *
+ * 要求比较器的顺序与前缀一致：前缀相同的 key 在排序中是连续的，
+ * 即 a < b < c 且 a、c 前缀相同时，b 的前缀也相同。按字节序比较的定长前缀满足这个要求
+ */
+
+#include <cstddef>
+
+#include "tinydb/export.h"
+#include "tinydb/slice.h"
+
+namespace tinydb {
+
+class TINYDB_EXPORT SliceTransform {
+public:
+    virtual ~SliceTransform();
+
+    // 变换的名字，记录在 table 中，打开 table 时名字不同的前缀过滤器不会被使用
+    // 变换的逻辑改变时必须换名字
+    virtual const char* Name() const = 0;
+
+    // 返回 key 的前缀，结果指向 key 的内存
+    // REQUIRES: InDomain(key)
+    virtual Slice Transform(const Slice& key) const = 0;
+
+    // key 是否有前缀，没有前缀的 key 不加入前缀过滤器，查询时也不使用前缀过滤器
+    virtual bool InDomain(const Slice& key) const = 0;
+};
+
+// 取 key 的前 prefix_len 个字节，短于 prefix_len 的 key 不在定义域内
+TINYDB_EXPORT const SliceTransform* NewFixedPrefixTransform(size_t prefix_len);
+
+// 取 key 的前 cap_len 个字节，短于 cap_len 的 key 以整个 key 为前缀
+TINYDB_EXPORT const SliceTransform* NewCappedPrefixTransform(size_t cap_len);
+
+} // namespace tinydb
+
+#endif  // STORAGE_TINYDB_INCLUDE_SLICE_TRANSFORM_H_
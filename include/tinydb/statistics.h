@@ -0,0 +1,88 @@
+#ifndef STORAGE_TINYDB_INCLUDE_STATISTICS_H_
+#define STORAGE_TINYDB_INCLUDE_STATISTICS_H_
+
+#include <cstdint>
+#include <string>
+
+#include "tinydb/export.h"
+
+namespace tinydb {
+
+// 计数器的编号，名字见 TickerName()
+enum Tickers : uint32_t {
+    // 写入的 WriteBatch 的字节数和条数
+    BYTES_WRITTEN = 0,
+    NUMBER_KEYS_WRITTEN,
+    // Get() 找到的 value 的字节数和次数
+    BYTES_READ,
+    NUMBER_KEYS_READ,
+
+    // 写入 WAL 的字节数，以及 WriteOptions::sync 引起的 fsync 次数
+    WAL_FILE_BYTES,
+    WAL_FILE_SYNCED,
+
+    // Get() 在 memtable 中得到结果(值或者删除记录)的次数，没有得到结果的次数
+    MEMTABLE_HIT,
+    MEMTABLE_MISS,
+
+    // 过滤器判断 key 不存在、省去读取数据块的次数
+    BLOOM_FILTER_USEFUL,
+    // 过滤器判断 key 可能存在的次数
+    BLOOM_FILTER_POSITIVE,
+
+    // row cache 的命中和未命中次数(见 Options::row_cache)
+    ROW_CACHE_HIT,
+    ROW_CACHE_MISS,
+
+    // flush 写出的字节数
+    FLUSH_WRITE_BYTES,
+    // compaction 读取和写出的字节数
+    COMPACT_READ_BYTES,
+    COMPACT_WRITE_BYTES,
+
+    // 写入因为等待 flush 和 compaction 而阻塞的时间，单位微秒
+    STALL_MICROS,
+
+    TICKER_ENUM_MAX
+};
+
+// 返回计数器的名字，例如 "tinydb.bytes.written"
+TINYDB_EXPORT const char* TickerName(uint32_t ticker_type);
+
+/*
+ * 数据库运行时的统计计数器，设置在 Options::statistics 中，可以被多个数据库共享
+ *
+ * 内部做了同步，可以被多个线程并发使用
+ */
+class TINYDB_EXPORT Statistics {
+public:
+    Statistics() = default;
+
+    Statistics(const Statistics&) = delete;
+    Statistics& operator=(const Statistics&) = delete;
+
+    virtual ~Statistics();
+
+    // 返回计数器的当前值
+    virtual uint64_t GetTickerCount(uint32_t ticker_type) const = 0;
+
+    // 给计数器加上 count
+    virtual void RecordTick(uint32_t ticker_type, uint64_t count) = 0;
+
+    // 把所有计数器清零
+    virtual void Reset() = 0;
+
+    // 每个计数器一行："<名字> COUNT : <值>"
+    virtual std::string ToString() const;
+};
+
+/*
+ * 创建一个按 CPU 分片计数的 Statistics：每个 CPU 核一组计数器，各占独立的 cache line，
+ * RecordTick() 只对当前核的计数器做一次 relaxed 原子加，不同核上的线程之间没有 cache line 争用
+ * GetTickerCount() 把所有核的值加起来，读取的代价与核数成正比
+ */
+TINYDB_EXPORT Statistics* NewStatistics();
+
+} // namespace tinydb
+
+#endif  // STORAGE_TINYDB_INCLUDE_STATISTICS_H_
@@ -0,0 +1,119 @@
+#ifndef STORAGE_TINYDB_INCLUDE_TABLE_H_
+#define STORAGE_TINYDB_INCLUDE_TABLE_H_
+
+#include <cstdint>
+
+#include "tinydb/export.h"
+#include "tinydb/iterator.h"
+
+namespace tinydb {
+
+class Block;
+class BlockHandle;
+class FilePrefetchBuffer;
+class Footer;
+struct Options;
+class RandomAccessFile;
+struct ReadOptions;
+
+/*
+ * Table 是一个有序的 string 到 string 的映射，不可修改且持久化
+ * 多个线程可以并发访问 Table，不需要外部同步
+ */
+class TINYDB_EXPORT Table {
+public:
+    /*
+     * 打开 file 中保存的 table，file 的前 file_size 字节为 table 内容
+     * 成功时返回 OK，*table 指向新打开的 table，调用者不再使用时 delete 它
+     * 出错时返回非 OK，*table 为 nullptr
+     *
+     * 打开时只读取 footer、metaindex、索引块(分区索引时只读顶层索引)、range tombstone 和过滤器
+     * (分区过滤器时只读顶层过滤器索引)，各个分区在用到时才读取并放入 block cache
+     *
+     * 调用者必须保证 table 使用期间 file 一直有效，table 析构时不会删除 file
+     */
+    static Status Open(const Options& options, RandomAccessFile* file,
+                       uint64_t file_size, Table** table);
+
+    Table(const Table&) = delete;
+    Table& operator=(const Table&) = delete;
+
+    ~Table();
+
+    // 返回遍历 table 内容的迭代器，刚创建时 !Valid()，需要先调用某个 Seek 方法
+    // 设置了 prefix_extractor 且没有要求 total_order_seek 时是前缀 seek 模式的迭代器：
+    // 过滤器判断 table 中没有 Seek() 目标的前缀时，不读取任何数据块
+    Iterator* NewIterator(const ReadOptions&) const;
+
+    // 返回遍历 TableBuilder::AddRangeTombstone() 添加的条目的迭代器，没有时返回 nullptr
+    // 这些条目在 Open() 时已经读入内存
+    Iterator* NewRangeTombstoneIterator() const;
+
+    // 返回 key 所在数据(或 key 如果存在时所在位置)在文件中的大致偏移
+    // 偏移以未压缩的 table 文件为准，例如 key 在最后一个 key 之后时返回文件大小附近的值
+    uint64_t ApproximateOffsetOf(const Slice& key) const;
+
+    // 是否使用分区索引
+    bool IsPartitionedIndex() const;
+
+    // 在 table 中查找第一个 >= key 的条目，找到时调用 (*handle_result)(arg, 找到的 key, value)
+    // 过滤器判断 key 不存在时不会读取数据块，也不会调用 handle_result
+    Status InternalGet(const ReadOptions&, const Slice& key, void* arg,
+                       void (*handle_result)(void* arg, const Slice& k,
+                                             const Slice& v));
+
+    /*
+     * 批量查找 keys[0,n-1]，keys 可以是任意顺序。对每个 key，结果与 InternalGet 相同，
+     * 找到时调用 (*handle_result)(arg, key 的下标, 找到的 key, value)
+     *
+     * key 先排序，落在同一个数据块的 key 只读取一次该块；没有命中 block cache 的块
+     * 中，相邻或间隔很小的块合并成一次 RandomAccessFile::Read
+     */
+    Status InternalMultiGet(const ReadOptions&, const Slice* keys, int n,
+                            void* arg,
+                            void (*handle_result)(void* arg, int index,
+                                                  const Slice& k,
+                                                  const Slice& v));
+
+    struct ScanState;
+
+private:
+    struct FilterCursor;
+    struct Rep;
+
+    static Iterator* BlockReader(void*, const ReadOptions&, const Slice&);
+    static Iterator* ScanBlockReader(void*, const ReadOptions&, const Slice&);
+
+    // 返回 index_value 指向的块的迭代器，prefetch 非空时经过预读缓冲区读取
+    Iterator* ReadBlockIterator(const ReadOptions&, const Slice& index_value,
+                                FilePrefetchBuffer* prefetch);
+
+    explicit Table(Rep* rep) : rep_(rep) {}
+
+    // 返回索引迭代器，分区索引时是顶层索引和索引分区组成的两层迭代器
+    Iterator* NewIndexIterator(const ReadOptions&) const;
+
+    // 过滤器判断 key 是否可能在 handle_value 指向的数据块中
+    // cursor 保存分区过滤器的查找状态，有序查找多个 key 时可以复用
+    bool KeyMayMatch(const ReadOptions&, const Slice& key,
+                     const Slice& handle_value, FilterCursor* cursor);
+
+    // 用 filter_key(完整的 key 或它的前缀)查询 key 所在位置的过滤器
+    bool FilterMayMatch(const ReadOptions&, const Slice& key,
+                        const Slice& filter_key, const Slice& handle_value,
+                        FilterCursor* cursor);
+
+    // 前缀 seek：table 中是否可能有与 target 前缀相同且 >= target 的 key
+    static bool PrefixMayMatch(void*, const ReadOptions&, const Slice& target);
+
+    void ReadMeta(const Footer& footer);
+    void ReadFilter(const Slice& filter_handle_value, bool partitioned);
+    void ReadDict(const Slice& dict_handle_value);
+    Status ReadRangeDel(const Slice& range_del_handle_value);
+
+    Rep* const rep_;
+};
+
+} // namespace tinydb
+
+#endif  // STORAGE_TINYDB_INCLUDE_TABLE_H_
@@ -0,0 +1,101 @@
+#ifndef STORAGE_TINYDB_INCLUDE_TABLE_BUILDER_H_
+#define STORAGE_TINYDB_INCLUDE_TABLE_BUILDER_H_
+
+/*
+ * TableBuilder 用于构建 table：一个持久化的、不可修改的有序 key/value 映射
+ *
+ * 多个线程可以并发调用 TableBuilder 的 const 方法，
+ * 非 const 方法需要外部同步
+ */
+
+#include <cstdint>
+
+#include "tinydb/export.h"
+#include "tinydb/options.h"
+#include "tinydb/status.h"
+
+namespace tinydb {
+
+class BlockBuilder;
+class BlockHandle;
+class CompressionStats;
+class WritableFile;
+
+class TINYDB_EXPORT TableBuilder {
+public:
+    // 创建一个写入 *file 的 builder，调用者负责在 Finish() 之后关闭 file
+    TableBuilder(const Options& options, WritableFile* file);
+
+    // 构建第 level 层的 table，压缩算法和级别按 level 选取(见 compression_per_level)，
+    // stats 非空时记录每个块的压缩结果，也用于自适应压缩
+    TableBuilder(const Options& options, WritableFile* file, int level,
+                 CompressionStats* stats);
+
+    TableBuilder(const TableBuilder&) = delete;
+    TableBuilder& operator=(const TableBuilder&) = delete;
+
+    // REQUIRES: Either Finish() or Abandon() has been called.
+    ~TableBuilder();
+
+    // 构建过程中修改选项，只有部分字段可以改，comparator 等影响文件格式的字段
+    // 与构造时不同时返回错误
+    Status ChangeOptions(const Options& options);
+
+    // REQUIRES: key is after any previously added key according to comparator.
+    // REQUIRES: Finish(), Abandon() have not been called
+    void Add(const Slice& key, const Slice& value);
+
+    /*
+     * 添加一个 range tombstone，与 Add() 的 key 分开存放，不影响数据块、索引和过滤器
+     * 内容由调用者解释，table 只负责保存，读取见 Table::NewRangeTombstoneIterator()
+     * REQUIRES: key is after any previously added range tombstone key
+     * REQUIRES: Finish(), Abandon() have not been called
+     */
+    void AddRangeTombstone(const Slice& key, const Slice& value);
+
+    // 把缓冲的 key/value 作为一个数据块写入文件，主要用于保证两个相邻的 key
+    // 落在不同的数据块中，大多数调用者不需要使用
+    // REQUIRES: Finish(), Abandon() have not been called
+    void Flush();
+
+    // Return non-ok iff some error has been detected.
+    Status status() const;
+
+    // 结束构建，返回后不再使用传给构造函数的 file
+    // REQUIRES: Finish(), Abandon() have not been called
+    Status Finish();
+
+    // 放弃构建，返回后不再使用传给构造函数的 file
+    // REQUIRES: Finish(), Abandon() have not been called
+    void Abandon();
+
+    // Number of calls to Add() so far.
+    uint64_t NumEntries() const;
+
+    // 目前为止 AddRangeTombstone() 的调用次数
+    uint64_t NumRangeDeletions() const;
+
+    // 目前为止生成的文件大小，Finish() 成功后即为最终文件大小
+    // 开启字典压缩时，训练字典之前缓冲的数据块按不压缩的大小计入，写出之后会变小
+    uint64_t FileSize() const;
+
+private:
+    struct Rep;
+
+    bool ok() const { return status().ok(); }
+    void WriteBlock(BlockBuilder* block, BlockHandle* handle);
+    void WriteBlockContents(const Slice& raw, BlockHandle* handle);
+    void WriteRawBlock(const Slice& data, CompressionType, BlockHandle* handle);
+    void AddKeyToFilter(const Slice& key);
+    void AddFilterEntry(const Slice& entry);
+    void AddIndexEntry(const Slice& last_key, const Slice* next_key,
+                       const BlockHandle& handle);
+    void FinishIndexPartition();
+    void FlushBufferedBlocks(const Slice* next_key);
+
+    Rep* rep_;
+};
+
+} // namespace tinydb
+
+#endif  // STORAGE_TINYDB_INCLUDE_TABLE_BUILDER_H_
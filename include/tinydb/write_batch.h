@@ -0,0 +1,84 @@
+#ifndef STORAGE_TINYDB_INCLUDE_WRITE_BATCH_H_
+#define STORAGE_TINYDB_INCLUDE_WRITE_BATCH_H_
+
+/*
+ * WriteBatch 把多个更新打包成一次原子写入：整个 batch 作为一条记录写入 WAL，
+ * 恢复时要么全部重放，要么全部丢弃
+ * 每个更新可以属于不同的 column family(用编号表示，default 为 0)，多个 column family
+ * 共用一个 WAL，跨 column family 的更新同样是原子的
+ *
+ * 多个线程可以同时调用一个 WriteBatch 的 const 方法，修改时需要外部同步
+ */
+
+#include <cstdint>
+#include <string>
+
+#include "tinydb/export.h"
+#include "tinydb/status.h"
+
+namespace tinydb {
+
+class Slice;
+
+class TINYDB_EXPORT WriteBatch {
+public:
+    // Iterate() 按写入的顺序对每个更新调用一个方法
+    class TINYDB_EXPORT Handler {
+    public:
+        virtual ~Handler();
+        virtual Status Put(uint32_t column_family_id, const Slice& key,
+                           const Slice& value) = 0;
+        virtual Status Delete(uint32_t column_family_id, const Slice& key) = 0;
+        virtual Status Merge(uint32_t column_family_id, const Slice& key,
+                             const Slice& value) = 0;
+        virtual Status DeleteRange(uint32_t column_family_id, const Slice& begin_key,
+                                   const Slice& end_key) = 0;
+    };
+
+    WriteBatch();
+
+    // Intentionally copyable.
+    WriteBatch(const WriteBatch&) = default;
+    WriteBatch& operator=(const WriteBatch&) = default;
+
+    ~WriteBatch();
+
+    // 写入 key -> value，不指定 column family 时写入 default
+    void Put(uint32_t column_family_id, const Slice& key, const Slice& value);
+    void Put(const Slice& key, const Slice& value) { Put(0, key, value); }
+
+    // 删除 key
+    void Delete(uint32_t column_family_id, const Slice& key);
+    void Delete(const Slice& key) { Delete(0, key); }
+
+    // 写入一个 merge 操作数，column family 必须设置了 Options::merge_operator
+    void Merge(uint32_t column_family_id, const Slice& key, const Slice& value);
+    void Merge(const Slice& key, const Slice& value) { Merge(0, key, value); }
+
+    // 删除 [begin_key, end_key) 中的所有 key
+    void DeleteRange(uint32_t column_family_id, const Slice& begin_key,
+                     const Slice& end_key);
+    void DeleteRange(const Slice& begin_key, const Slice& end_key) {
+        DeleteRange(0, begin_key, end_key);
+    }
+
+    // 清空 batch
+    void Clear();
+
+    // batch 编码后的大小，即写入 WAL 的字节数
+    size_t ApproximateSize() const;
+
+    // 把 source 中的更新追加到本 batch 后面
+    void Append(const WriteBatch& source);
+
+    Status Iterate(Handler* handler) const;
+
+private:
+    friend class WriteBatchInternal;
+
+    std::string rep_;  // See comment in write_batch.cc for the format of rep_
+};
+
+} // namespace tinydb
+
+#endif  // STORAGE_TINYDB_INCLUDE_WRITE_BATCH_H_
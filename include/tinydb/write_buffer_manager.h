@@ -0,0 +1,87 @@
+#ifndef STORAGE_TINYDB_INCLUDE_WRITE_BUFFER_MANAGER_H_
+#define STORAGE_TINYDB_INCLUDE_WRITE_BUFFER_MANAGER_H_
+
+#include <atomic>
+#include <cstddef>
+
+#include "tinydb/export.h"
+
+namespace tinydb {
+
+class Cache;
+
+/*
+ * 多个数据库、多个 column family 的 memtable 共享的内存预算
+ * 每个 memtable 的 Arena 分配和释放内存块时都计入同一个 WriteBufferManager，
+ * 写入之后 ShouldFlush() 为 true 时，数据库 flush 自己最大的 memtable，
+ * 这样 memtable 占用的总内存不会随着数据库和 column family 的个数增长
+ *
+ * 设置了 cache 时，memtable 占用的内存同时以占位条目的形式计入 cache(通常就是 block_cache)，
+ * memtable 占用越多，cache 中能留下的数据块越少，两者的总和受 cache 容量的约束
+ *
+ * 内部做了同步，可以被多个线程并发使用。必须在所有使用它的数据库关闭之后析构
+ */
+class TINYDB_EXPORT WriteBufferManager {
+public:
+    // buffer_size 为 0 时只统计内存，不触发 flush
+    explicit WriteBufferManager(size_t buffer_size, Cache* cache = nullptr);
+
+    WriteBufferManager(const WriteBufferManager&) = delete;
+    WriteBufferManager& operator=(const WriteBufferManager&) = delete;
+
+    ~WriteBufferManager();
+
+    bool enabled() const { return buffer_size_ > 0; }
+
+    size_t buffer_size() const { return buffer_size_; }
+
+    // 所有 memtable 占用的内存
+    size_t memory_usage() const { return memory_used_.load(std::memory_order_relaxed); }
+
+    // 其中还在写入的 memtable 占用的内存，已经变为只读、正在 flush 的不算在内
+    size_t mutable_memtable_memory_usage() const {
+        return memory_active_.load(std::memory_order_relaxed);
+    }
+
+    // 计入 cache 的占位条目的总大小
+    size_t dummy_entries_in_cache_usage() const;
+
+    /*
+     * 是否应该 flush：还在写入的 memtable 超过预算的 7/8，
+     * 或者总量已经超过预算且其中至少一半还在写入(flush 可以释放足够多的内存)
+     */
+    bool ShouldFlush() const {
+        if (!enabled()) {
+            return false;
+        }
+        const size_t active = mutable_memtable_memory_usage();
+        return active > mutable_limit_ ||
+               (memory_usage() >= buffer_size_ && active >= buffer_size_ / 2);
+    }
+
+    // memtable 分配了 mem 字节
+    void ReserveMem(size_t mem);
+
+    // memtable 变为只读，其中的 mem 字节会在 flush 之后释放
+    void ScheduleFreeMem(size_t mem);
+
+    // memtable 析构，释放了 mem 字节
+    void FreeMem(size_t mem);
+
+private:
+    struct CacheRep;
+
+    // 按 memory_used_ 增减 cache 中的占位条目
+    void UpdateCacheCharge();
+
+    const size_t buffer_size_;
+    const size_t mutable_limit_;
+    std::atomic<size_t> memory_used_;
+    std::atomic<size_t> memory_active_;
+    // 没有设置 cache 时为 nullptr
+    CacheRep* const cache_rep_;
+};
+
+} // namespace tinydb
+
+#endif  // STORAGE_TINYDB_INCLUDE_WRITE_BUFFER_MANAGER_H_
@@ -25,14 +25,22 @@
 #if HAVE_ZSTD
 #define ZSTD_STATIC_LINKING_ONLY  // For ZSTD_compressionParameters.
 #include <zstd.h>
+#include <zdict.h>
 #endif  // HAVE_ZSTD
 
+#if HAVE_SCHED_GETCPU
+#include <sched.h>
+#endif  // HAVE_SCHED_GETCPU
+
+#include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <condition_variable>  // NOLINT
 #include <cstddef>
 #include <cstdint>
 #include <mutex>  // NOLINT
 #include <string>
+#include <vector>
 
 #include "port/thread_annotations.h"
 
@@ -79,6 +87,14 @@ public:
         cv_.wait(lock);
         lock.release();
     }
+    // 阻塞等待，最多等待 micros 微秒，超时返回 true
+    bool TimedWait(uint64_t micros) {
+        std::unique_lock<std::mutex> lock(mu_->mu_, std::adopt_lock);
+        bool timeout = cv_.wait_for(lock, std::chrono::microseconds(micros)) ==
+                       std::cv_status::timeout;
+        lock.release();
+        return timeout;
+    }
     void Signal() { cv_.notify_one(); }
     void SignalAll() { cv_.notify_all(); }
 
@@ -142,6 +158,32 @@ inline bool Snappy_Uncompress(const char* input, size_t length, char* output) {
 #endif  // HAVE_SNAPPY
 }
 
+#if HAVE_ZSTD
+/*
+    当前线程复用的压缩/解压 context。每个块新建一个 context 要分配并初始化几百 KB 的工作区，
+    比压缩一个小块本身还慢；context 不能被多个线程同时使用，所以每个线程一个，线程退出时释放
+ */
+inline ZSTD_CCtx* Zstd_ThreadLocalCCtx() {
+    struct Holder {
+        Holder() : ctx(ZSTD_createCCtx()) {}
+        ~Holder() { ZSTD_freeCCtx(ctx); }
+        ZSTD_CCtx* const ctx;
+    };
+    static thread_local Holder holder;
+    return holder.ctx;
+}
+
+inline ZSTD_DCtx* Zstd_ThreadLocalDCtx() {
+    struct Holder {
+        Holder() : ctx(ZSTD_createDCtx()) {}
+        ~Holder() { ZSTD_freeDCtx(ctx); }
+        ZSTD_DCtx* const ctx;
+    };
+    static thread_local Holder holder;
+    return holder.ctx;
+}
+#endif  // HAVE_ZSTD
+
 inline bool Zstd_Compress(int level, const char* input, size_t length,
                           std::string* output) {
 #if HAVE_ZSTD
@@ -150,13 +192,17 @@ inline bool Zstd_Compress(int level, const char* input, size_t length,
     if (ZSTD_isError(outlen)) {
         return false;
     }
+    ZSTD_CCtx* ctx = Zstd_ThreadLocalCCtx();
+    if (ctx == nullptr) {
+        return false;
+    }
     output->resize(outlen);
-    ZSTD_CCtx* ctx = ZSTD_createCCtx();
+    // 复用的 context 上还留着上一次的参数，先清掉
+    ZSTD_CCtx_reset(ctx, ZSTD_reset_session_and_parameters);
     ZSTD_compressionParameters parameters =
       ZSTD_getCParams(level, std::max(length, size_t{1}), /*dictSize=*/0);
     ZSTD_CCtx_setCParams(ctx, parameters);
     outlen = ZSTD_compress2(ctx, &(*output)[0], output->size(), input, length);
-    ZSTD_freeCCtx(ctx);
     if (ZSTD_isError(outlen)) {
         return false;
     }
@@ -192,17 +238,259 @@ inline bool Zstd_Uncompress(const char* input, size_t length, char* output) {
 #if HAVE_ZSTD
     size_t outlen;
     if (!Zstd_GetUncompressedLength(input, length, &outlen)) {
-    return false;
+        return false;
+    }
+    ZSTD_DCtx* ctx = Zstd_ThreadLocalDCtx();
+    if (ctx == nullptr) {
+        return false;
     }
-    ZSTD_DCtx* ctx = ZSTD_createDCtx();
     outlen = ZSTD_decompressDCtx(ctx, output, outlen, input, length);
-    ZSTD_freeDCtx(ctx);
     if (ZSTD_isError(outlen)) {
+        return false;
+    }
+    return true;
+#else
+    // Silence compiler warnings about unused arguments.
+    (void)input;
+    (void)length;
+    (void)output;
     return false;
+#endif  // HAVE_ZSTD
+}
+
+/*
+    用样本训练 Zstd 字典。samples 是所有样本首尾相连的内容，sample_lengths 为每个样本的长度
+    训练得到的字典(不超过 max_dict_bytes 字节)放到参数dict中。样本太少或不支持Zstd时返回false
+ */
+inline bool Zstd_TrainDictionary(const std::string& samples,
+                                 const std::vector<size_t>& sample_lengths,
+                                 size_t max_dict_bytes, std::string* dict) {
+#if HAVE_ZSTD
+    if (sample_lengths.empty() || max_dict_bytes == 0) {
+        return false;
     }
+    dict->resize(max_dict_bytes);
+    size_t outlen = ZDICT_trainFromBuffer(
+            &(*dict)[0], dict->size(), samples.data(), sample_lengths.data(),
+            static_cast<unsigned>(sample_lengths.size()));
+    if (ZDICT_isError(outlen)) {
+        dict->clear();
+        return false;
+    }
+    dict->resize(outlen);
     return true;
 #else
     // Silence compiler warnings about unused arguments.
+    (void)samples;
+    (void)sample_lengths;
+    (void)max_dict_bytes;
+    (void)dict;
+    return false;
+#endif  // HAVE_ZSTD
+}
+
+/*
+    基于字典预先构建 ZSTD_CDict/ZSTD_DDict。字典解析的代价只付一次，之后每个块都复用。
+    返回的是不透明指针，须用对应的 Zstd_Free*Dict 释放；不支持Zstd时返回nullptr
+ */
+inline void* Zstd_CreateCDict(const char* dict, size_t size, int level) {
+#if HAVE_ZSTD
+    return ZSTD_createCDict(dict, size, level);
+#else
+    // Silence compiler warnings about unused arguments.
+    (void)dict;
+    (void)size;
+    (void)level;
+    return nullptr;
+#endif  // HAVE_ZSTD
+}
+
+inline void Zstd_FreeCDict(void* cdict) {
+#if HAVE_ZSTD
+    ZSTD_freeCDict(static_cast<ZSTD_CDict*>(cdict));
+#else
+    (void)cdict;
+#endif  // HAVE_ZSTD
+}
+
+inline void* Zstd_CreateDDict(const char* dict, size_t size) {
+#if HAVE_ZSTD
+    return ZSTD_createDDict(dict, size);
+#else
+    // Silence compiler warnings about unused arguments.
+    (void)dict;
+    (void)size;
+    return nullptr;
+#endif  // HAVE_ZSTD
+}
+
+inline void Zstd_FreeDDict(void* ddict) {
+#if HAVE_ZSTD
+    ZSTD_freeDDict(static_cast<ZSTD_DDict*>(ddict));
+#else
+    (void)ddict;
+#endif  // HAVE_ZSTD
+}
+
+// 使用 Zstd_CreateCDict 返回的字典进行压缩，复用当前线程的 context
+inline bool Zstd_CompressWithDict(const void* cdict, const char* input,
+                                  size_t length, std::string* output) {
+#if HAVE_ZSTD
+    size_t outlen = ZSTD_compressBound(length);
+    if (ZSTD_isError(outlen)) {
+        return false;
+    }
+    ZSTD_CCtx* ctx = Zstd_ThreadLocalCCtx();
+    if (ctx == nullptr) {
+        return false;
+    }
+    output->resize(outlen);
+    // 压缩参数都来自 cdict，不受 context 上残留的参数影响
+    outlen = ZSTD_compress_usingCDict(ctx, &(*output)[0], output->size(),
+                                      input, length,
+                                      static_cast<const ZSTD_CDict*>(cdict));
+    if (ZSTD_isError(outlen)) {
+        return false;
+    }
+    output->resize(outlen);
+    return true;
+#else
+    // Silence compiler warnings about unused arguments.
+    (void)cdict;
+    (void)input;
+    (void)length;
+    (void)output;
+    return false;
+#endif  // HAVE_ZSTD
+}
+
+// 使用 Zstd_CreateDDict 返回的字典解压缩，复用当前线程的 context
+// 解压后的长度仍由 Zstd_GetUncompressedLength 得到
+inline bool Zstd_UncompressWithDict(const void* ddict, const char* input,
+                                    size_t length, char* output) {
+#if HAVE_ZSTD
+    size_t outlen;
+    if (!Zstd_GetUncompressedLength(input, length, &outlen)) {
+        return false;
+    }
+    ZSTD_DCtx* ctx = Zstd_ThreadLocalDCtx();
+    if (ctx == nullptr) {
+        return false;
+    }
+    outlen = ZSTD_decompress_usingDDict(ctx, output, outlen, input, length,
+                                        static_cast<const ZSTD_DDict*>(ddict));
+    if (ZSTD_isError(outlen)) {
+        return false;
+    }
+    return true;
+#else
+    // Silence compiler warnings about unused arguments.
+    (void)ddict;
+    (void)input;
+    (void)length;
+    (void)output;
+    return false;
+#endif  // HAVE_ZSTD
+}
+
+/*
+    流式压缩：同一个 context 连续压缩多段数据，后面的数据可以引用前面的数据，
+    很小的输入也能得到较好的压缩率。每段压缩后都 flush，解压端拿到这一段就能完整解出
+    返回的是不透明指针，须用 Zstd_FreeCStream 释放；不支持Zstd时返回nullptr
+ */
+inline void* Zstd_CreateCStream(int level) {
+#if HAVE_ZSTD
+    ZSTD_CCtx* ctx = ZSTD_createCCtx();
+    if (ctx != nullptr) {
+        ZSTD_CCtx_setParameter(ctx, ZSTD_c_compressionLevel, level);
+    }
+    return ctx;
+#else
+    (void)level;
+    return nullptr;
+#endif  // HAVE_ZSTD
+}
+
+inline void Zstd_FreeCStream(void* ctx) {
+#if HAVE_ZSTD
+    ZSTD_freeCCtx(static_cast<ZSTD_CCtx*>(ctx));
+#else
+    (void)ctx;
+#endif  // HAVE_ZSTD
+}
+
+// 压缩一段数据并 flush，结果追加到 output
+inline bool Zstd_CompressStream(void* ctx, const char* input, size_t length,
+                                std::string* output) {
+#if HAVE_ZSTD
+    ZSTD_inBuffer in = {input, length, 0};
+    const size_t start = output->size();
+    size_t out_pos = start;
+    size_t remaining;
+    do {
+        output->resize(out_pos + ZSTD_compressBound(in.size - in.pos) + 64);
+        ZSTD_outBuffer out = {&(*output)[0], output->size(), out_pos};
+        remaining = ZSTD_compressStream2(static_cast<ZSTD_CCtx*>(ctx), &out, &in,
+                                         ZSTD_e_flush);
+        if (ZSTD_isError(remaining)) {
+            output->resize(start);
+            return false;
+        }
+        out_pos = out.pos;
+    } while (remaining != 0);
+    output->resize(out_pos);
+    return true;
+#else
+    (void)ctx;
+    (void)input;
+    (void)length;
+    (void)output;
+    return false;
+#endif  // HAVE_ZSTD
+}
+
+inline void* Zstd_CreateDStream() {
+#if HAVE_ZSTD
+    return ZSTD_createDCtx();
+#else
+    return nullptr;
+#endif  // HAVE_ZSTD
+}
+
+inline void Zstd_FreeDStream(void* ctx) {
+#if HAVE_ZSTD
+    ZSTD_freeDCtx(static_cast<ZSTD_DCtx*>(ctx));
+#else
+    (void)ctx;
+#endif  // HAVE_ZSTD
+}
+
+// 解压 Zstd_CompressStream 压缩的一段数据，结果追加到 output
+inline bool Zstd_UncompressStream(void* ctx, const char* input, size_t length,
+                                  std::string* output) {
+#if HAVE_ZSTD
+    ZSTD_inBuffer in = {input, length, 0};
+    const size_t start = output->size();
+    size_t out_pos = start;
+    while (true) {
+        output->resize(out_pos + std::max<size_t>(ZSTD_DStreamOutSize(), 2 * length));
+        ZSTD_outBuffer out = {&(*output)[0], output->size(), out_pos};
+        const size_t ret =
+                ZSTD_decompressStream(static_cast<ZSTD_DCtx*>(ctx), &out, &in);
+        if (ZSTD_isError(ret)) {
+            output->resize(start);
+            return false;
+        }
+        out_pos = out.pos;
+        // 输入已经用完，且输出没有填满(解压器内部没有剩余数据)
+        if (in.pos == in.size && out.pos < out.size) {
+            break;
+        }
+    }
+    output->resize(out_pos);
+    return true;
+#else
+    (void)ctx;
     (void)input;
     (void)length;
     (void)output;
@@ -218,6 +506,15 @@ inline bool GetHeapProfile(void (*func)(void*, const char*, int), void* arg) {
     return false;
 }
 
+// 返回当前线程所在的 CPU 核的编号，不支持时返回 -1
+inline int PhysicalCoreID() {
+#if HAVE_SCHED_GETCPU
+    return sched_getcpu();
+#else
+    return -1;
+#endif  // HAVE_SCHED_GETCPU
+}
+
 inline uint32_t AcceleratedCRC32C(uint32_t crc, const char* buf, size_t size) {
 #if HAVE_CRC32C
     return ::crc32c::Extend(crc, reinterpret_cast<const uint8_t*>(buf), size);
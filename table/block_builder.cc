@@ -0,0 +1,99 @@
+/*
+ * BlockBuilder 生成的块中，key 做了前缀压缩：
+ * 每个 key 只存与前一个 key 不同的后缀部分，以减少空间
+ * 每隔 K 个 key 设置一个"重启点"，重启点处不做前缀压缩，存完整的 key
+ * 块的末尾存所有重启点的偏移，查找时可以在重启点上二分查找
+ *
+ * 每个 key/value 的格式：
+ *     shared_bytes: varint32
+ *     unshared_bytes: varint32
+ *     value_length: varint32
+ *     key_delta: char[unshared_bytes]
+ *     value: char[value_length]
+ * 重启点处 shared_bytes == 0
+ *
+ * 块的末尾：
+ *     restarts: uint32[num_restarts]
+ *     num_restarts: uint32
+ * restarts[i] 是第 i 个重启点在块中的偏移
+ */
+
+#include "table/block_builder.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "tinydb/comparator.h"
+#include "tinydb/options.h"
+#include "util/coding.h"
+
+namespace tinydb {
+
+BlockBuilder::BlockBuilder(const Options* options)
+        : options_(options), restarts_(), counter_(0), finished_(false) {
+    assert(options->block_restart_interval >= 1);
+    restarts_.push_back(0);  // First restart point is at offset 0
+}
+
+void BlockBuilder::Reset() {
+    buffer_.clear();
+    restarts_.clear();
+    restarts_.push_back(0);  // First restart point is at offset 0
+    counter_ = 0;
+    finished_ = false;
+    last_key_.clear();
+}
+
+size_t BlockBuilder::CurrentSizeEstimate() const {
+    return (buffer_.size() +                       // Raw data buffer
+            restarts_.size() * sizeof(uint32_t) +  // Restart array
+            sizeof(uint32_t));                     // Restart array length
+}
+
+Slice BlockBuilder::Finish() {
+    // Append restart array
+    for (size_t i = 0; i < restarts_.size(); i++) {
+        PutFixed32(&buffer_, restarts_[i]);
+    }
+    PutFixed32(&buffer_, restarts_.size());
+    finished_ = true;
+    return Slice(buffer_);
+}
+
+void BlockBuilder::Add(const Slice& key, const Slice& value) {
+    Slice last_key_piece(last_key_);
+    assert(!finished_);
+    assert(counter_ <= options_->block_restart_interval);
+    assert(buffer_.empty()  // No values yet?
+           || options_->comparator->Compare(key, last_key_piece) > 0);
+    size_t shared = 0;
+    if (counter_ < options_->block_restart_interval) {
+        // See how much sharing to do with previous string
+        const size_t min_length = std::min(last_key_piece.size(), key.size());
+        while ((shared < min_length) && (last_key_piece[shared] == key[shared])) {
+            shared++;
+        }
+    } else {
+        // Restart compression
+        restarts_.push_back(buffer_.size());
+        counter_ = 0;
+    }
+    const size_t non_shared = key.size() - shared;
+
+    // Add "<shared><non_shared><value_size>" to buffer_
+    PutVarint32(&buffer_, shared);
+    PutVarint32(&buffer_, non_shared);
+    PutVarint32(&buffer_, value.size());
+
+    // Add string delta to buffer_ followed by value
+    buffer_.append(key.data() + shared, non_shared);
+    buffer_.append(value.data(), value.size());
+
+    // Update state
+    last_key_.resize(shared);
+    last_key_.append(key.data() + shared, non_shared);
+    assert(Slice(last_key_) == key);
+    counter_++;
+}
+
+} // namespace tinydb
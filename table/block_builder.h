@@ -0,0 +1,52 @@
+#ifndef STORAGE_TINYDB_TABLE_BLOCK_BUILDER_H_
+#define STORAGE_TINYDB_TABLE_BLOCK_BUILDER_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "tinydb/slice.h"
+
+namespace tinydb {
+
+struct Options;
+
+/*
+ * 构建数据块、索引块等 key 有序的块
+ * 相邻的 key 做前缀压缩，每隔 block_restart_interval 个 key 设置一个重启点，
+ * 重启点处存完整的 key，读取时在重启点上二分查找
+ */
+class BlockBuilder {
+public:
+    explicit BlockBuilder(const Options* options);
+
+    BlockBuilder(const BlockBuilder&) = delete;
+    BlockBuilder& operator=(const BlockBuilder&) = delete;
+
+    // Reset the contents as if the BlockBuilder was just constructed.
+    void Reset();
+
+    // REQUIRES: Finish() has not been called since the last call to Reset().
+    // REQUIRES: key is larger than any previously added key
+    void Add(const Slice& key, const Slice& value);
+
+    // 结束构建，返回块的内容，在 builder 析构或 Reset() 之前有效
+    Slice Finish();
+
+    // 返回当前块(未压缩)大小的估计值
+    size_t CurrentSizeEstimate() const;
+
+    // Return true iff no entries have been added since the last Reset()
+    bool empty() const { return buffer_.empty(); }
+
+private:
+    const Options* options_;
+    std::string buffer_;              // Destination buffer
+    std::vector<uint32_t> restarts_;  // Restart points
+    int counter_;                     // Number of entries emitted since restart
+    bool finished_;                   // Has Finish() been called?
+    std::string last_key_;
+};
+
+} // namespace tinydb
+
+#endif  // STORAGE_TINYDB_TABLE_BLOCK_BUILDER_H_
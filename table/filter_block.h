@@ -0,0 +1,87 @@
+#ifndef STORAGE_TINYDB_TABLE_FILTER_BLOCK_H_
+#define STORAGE_TINYDB_TABLE_FILTER_BLOCK_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "tinydb/slice.h"
+
+namespace tinydb {
+
+class FilterPolicy;
+
+/*
+ * 构建整个 table 的过滤块(filter block)，存放在 table 末尾
+ * 每 2KB 数据偏移对应一个过滤器，调用顺序必须满足正则表达式：
+ *      (StartBlock AddKey*)* Finish
+ */
+class FilterBlockBuilder {
+public:
+    explicit FilterBlockBuilder(const FilterPolicy*);
+
+    FilterBlockBuilder(const FilterBlockBuilder&) = delete;
+    FilterBlockBuilder& operator=(const FilterBlockBuilder&) = delete;
+
+    void StartBlock(uint64_t block_offset);
+    void AddKey(const Slice& key);
+    Slice Finish();
+
+private:
+    void GenerateFilter();
+
+    const FilterPolicy* policy_;
+    std::string keys_;             // Flattened key contents
+    std::vector<size_t> start_;    // Starting index in keys_ of each key
+    std::string result_;           // Filter data computed so far
+    std::vector<Slice> tmp_keys_;  // policy_->CreateFilter() argument
+    std::vector<uint32_t> filter_offsets_;
+};
+
+class FilterBlockReader {
+public:
+    // REQUIRES: "contents" and *policy must stay live while *this is live.
+    FilterBlockReader(const FilterPolicy* policy, const Slice& contents);
+    bool KeyMayMatch(uint64_t block_offset, const Slice& key);
+
+private:
+    const FilterPolicy* policy_;
+    const char* data_;    // Pointer to filter data (at block-start)
+    const char* offset_;  // Pointer to beginning of offset array (at block-end)
+    size_t num_;          // Number of entries in offset array
+    size_t base_lg_;      // Encoding parameter (see kFilterBaseLg in .cc file)
+};
+
+/*
+ * 构建分区过滤器中的一个分区
+ * 分区与索引分区对齐，一个分区覆盖该索引分区下所有数据块的 key，
+ * 分区内容就是 policy 对这些 key 生成的一个完整过滤器
+ */
+class PartitionedFilterBuilder {
+public:
+    explicit PartitionedFilterBuilder(const FilterPolicy*);
+
+    PartitionedFilterBuilder(const PartitionedFilterBuilder&) = delete;
+    PartitionedFilterBuilder& operator=(const PartitionedFilterBuilder&) = delete;
+
+    void AddKey(const Slice& key);
+
+    // 当前分区没有 key
+    bool empty() const { return start_.empty(); }
+
+    // 为上次 FinishPartition() 之后添加的 key 生成过滤器，
+    // 返回值在下次调用 AddKey() 或 FinishPartition() 之前有效
+    Slice FinishPartition();
+
+private:
+    const FilterPolicy* policy_;
+    std::string keys_;
+    std::vector<size_t> start_;
+    std::vector<Slice> tmp_keys_;
+    std::string result_;
+};
+
+} // namespace tinydb
+
+#endif  // STORAGE_TINYDB_TABLE_FILTER_BLOCK_H_
@@ -0,0 +1,196 @@
+#include "table/format.h"
+
+#include <cstring>
+
+#include "port/port.h"
+#include "table/block.h"
+#include "tinydb/env.h"
+#include "tinydb/options.h"
+#include "util/coding.h"
+#include "util/compression_dict.h"
+#include "util/crc32c.h"
+
+namespace tinydb {
+
+void BlockHandle::EncodeTo(std::string* dst) const {
+    // Sanity check that all fields have been set
+    assert(offset_ != ~static_cast<uint64_t>(0));
+    assert(size_ != ~static_cast<uint64_t>(0));
+    PutVarint64(dst, offset_);
+    PutVarint64(dst, size_);
+}
+
+Status BlockHandle::DecodeFrom(Slice* input) {
+    if (GetVarint64(input, &offset_) && GetVarint64(input, &size_)) {
+        return Status::OK();
+    } else {
+        return Status::Corruption("bad block handle");
+    }
+}
+
+void Footer::EncodeTo(std::string* dst) const {
+    const size_t original_size = dst->size();
+    metaindex_handle_.EncodeTo(dst);
+    index_handle_.EncodeTo(dst);
+    dst->resize(2 * BlockHandle::kMaxEncodedLength);  // Padding
+    PutFixed32(dst, static_cast<uint32_t>(kTableMagicNumber & 0xffffffffu));
+    PutFixed32(dst, static_cast<uint32_t>(kTableMagicNumber >> 32));
+    assert(dst->size() == original_size + kEncodedLength);
+    (void)original_size;  // Disable unused variable warning.
+}
+
+Status Footer::DecodeFrom(Slice* input) {
+    if (input->size() < kEncodedLength) {
+        return Status::Corruption("not an sstable (footer too short)");
+    }
+
+    const char* magic_ptr = input->data() + kEncodedLength - 8;
+    const uint32_t magic_lo = DecodeFixed32(magic_ptr);
+    const uint32_t magic_hi = DecodeFixed32(magic_ptr + 4);
+    const uint64_t magic = ((static_cast<uint64_t>(magic_hi) << 32) |
+                            (static_cast<uint64_t>(magic_lo)));
+    if (magic != kTableMagicNumber) {
+        return Status::Corruption("not an sstable (bad magic number)");
+    }
+
+    Status result = metaindex_handle_.DecodeFrom(input);
+    if (result.ok()) {
+        result = index_handle_.DecodeFrom(input);
+    }
+    if (result.ok()) {
+        // We skip over any leftover data (just padding for now) in "input"
+        const char* end = magic_ptr + 8;
+        *input = Slice(end, input->data() + input->size() - end);
+    }
+    return result;
+}
+
+// 解压 data[0,n) 到新分配的堆内存中，type 为压缩算法
+static Status UncompressBlock(char type, const char* data, size_t n,
+                              const CompressionDict* dict,
+                              BlockContents* result) {
+    switch (type) {
+        case kSnappyCompression: {
+            size_t ulength = 0;
+            if (!port::Snappy_GetUncompressedLength(data, n, &ulength)) {
+                return Status::Corruption("corrupted snappy compressed block length");
+            }
+            char* ubuf = new char[ulength];
+            if (!port::Snappy_Uncompress(data, n, ubuf)) {
+                delete[] ubuf;
+                return Status::Corruption("corrupted snappy compressed block contents");
+            }
+            result->data = Slice(ubuf, ulength);
+            result->heap_allocated = true;
+            result->cachable = true;
+            return Status::OK();
+        }
+        case kZstdCompression: {
+            size_t ulength = 0;
+            if (!port::Zstd_GetUncompressedLength(data, n, &ulength)) {
+                return Status::Corruption("corrupted zstd compressed block length");
+            }
+            char* ubuf = new char[ulength];
+            const bool ok = (dict != nullptr && !dict->empty())
+                            ? dict->Uncompress(data, n, ubuf)
+                            : port::Zstd_Uncompress(data, n, ubuf);
+            if (!ok) {
+                delete[] ubuf;
+                return Status::Corruption("corrupted zstd compressed block contents");
+            }
+            result->data = Slice(ubuf, ulength);
+            result->heap_allocated = true;
+            result->cachable = true;
+            return Status::OK();
+        }
+        default:
+            return Status::Corruption("bad block type");
+    }
+}
+
+static Status VerifyBlockChecksum(const char* data, size_t n) {
+    const uint32_t crc = crc32c::Unmask(DecodeFixed32(data + n + 1));
+    const uint32_t actual = crc32c::Value(data, n + 1);
+    if (actual != crc) {
+        return Status::Corruption("block checksum mismatch");
+    }
+    return Status::OK();
+}
+
+Status ReadBlock(RandomAccessFile* file, const ReadOptions& options,
+                 const BlockHandle& handle, BlockContents* result,
+                 const CompressionDict* dict) {
+    result->data = Slice();
+    result->cachable = false;
+    result->heap_allocated = false;
+
+    // 读取块内容和 trailer(类型和 crc)
+    size_t n = static_cast<size_t>(handle.size());
+    char* buf = new char[n + kBlockTrailerSize];
+    Slice contents;
+    Status s = file->Read(handle.offset(), n + kBlockTrailerSize, &contents, buf);
+    if (!s.ok()) {
+        delete[] buf;
+        return s;
+    }
+    if (contents.size() != n + kBlockTrailerSize) {
+        delete[] buf;
+        return Status::Corruption("truncated block read");
+    }
+
+    // Check the crc of the type and the block contents
+    const char* data = contents.data();  // Pointer to where Read put the data
+    if (options.verify_checksums) {
+        s = VerifyBlockChecksum(data, n);
+        if (!s.ok()) {
+            delete[] buf;
+            return s;
+        }
+    }
+
+    if (data[n] == kNoCompression) {
+        if (data != buf) {
+            // 文件实现直接返回了自己的数据(例如 mmap)，不需要缓存
+            delete[] buf;
+            result->data = Slice(data, n);
+            result->heap_allocated = false;
+            result->cachable = false;  // Do not double-cache
+        } else {
+            result->data = Slice(buf, n);
+            result->heap_allocated = true;
+            result->cachable = true;
+        }
+        return Status::OK();
+    }
+
+    s = UncompressBlock(data[n], data, n, dict, result);
+    delete[] buf;
+    return s;
+}
+
+Status DecodeBlock(const char* data, const ReadOptions& options,
+                   const BlockHandle& handle, BlockContents* result,
+                   const CompressionDict* dict) {
+    result->data = Slice();
+    result->cachable = false;
+    result->heap_allocated = false;
+
+    const size_t n = static_cast<size_t>(handle.size());
+    if (options.verify_checksums) {
+        Status s = VerifyBlockChecksum(data, n);
+        if (!s.ok()) {
+            return s;
+        }
+    }
+    if (data[n] == kNoCompression) {
+        char* copy = new char[n];
+        std::memcpy(copy, data, n);
+        result->data = Slice(copy, n);
+        result->heap_allocated = true;
+        result->cachable = true;
+        return Status::OK();
+    }
+    return UncompressBlock(data[n], data, n, dict, result);
+}
+
+} // namespace tinydb
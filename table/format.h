@@ -0,0 +1,122 @@
+#ifndef STORAGE_TINYDB_TABLE_FORMAT_H_
+#define STORAGE_TINYDB_TABLE_FORMAT_H_
+
+#include <cstdint>
+#include <string>
+
+#include "tinydb/slice.h"
+#include "tinydb/status.h"
+
+namespace tinydb {
+
+class Block;
+class CompressionDict;
+class RandomAccessFile;
+struct ReadOptions;
+
+// BlockHandle 是指向文件中一个数据块或 meta 块的指针：偏移和大小
+class BlockHandle {
+public:
+    // Maximum encoding length of a BlockHandle
+    enum { kMaxEncodedLength = 10 + 10 };
+
+    BlockHandle();
+
+    // The offset of the block in the file.
+    uint64_t offset() const { return offset_; }
+    void set_offset(uint64_t offset) { offset_ = offset; }
+
+    // The size of the stored block
+    uint64_t size() const { return size_; }
+    void set_size(uint64_t size) { size_ = size; }
+
+    void EncodeTo(std::string* dst) const;
+    Status DecodeFrom(Slice* input);
+
+private:
+    uint64_t offset_;
+    uint64_t size_;
+};
+
+// Footer 位于每个 table 文件的末尾，长度固定
+class Footer {
+public:
+    // Encoded length of a Footer.  Note that the serialization of a
+    // Footer will always occupy exactly this many bytes.  It consists
+    // of two block handles and a magic number.
+    enum { kEncodedLength = 2 * BlockHandle::kMaxEncodedLength + 8 };
+
+    Footer() = default;
+
+    // The block handle for the metaindex block of the table
+    const BlockHandle& metaindex_handle() const { return metaindex_handle_; }
+    void set_metaindex_handle(const BlockHandle& h) { metaindex_handle_ = h; }
+
+    // 索引块的 handle，分区索引时指向顶层索引
+    const BlockHandle& index_handle() const { return index_handle_; }
+    void set_index_handle(const BlockHandle& h) { index_handle_ = h; }
+
+    void EncodeTo(std::string* dst) const;
+    Status DecodeFrom(Slice* input);
+
+private:
+    BlockHandle metaindex_handle_;
+    BlockHandle index_handle_;
+};
+
+// kTableMagicNumber was picked by running
+//    echo http://code.google.com/p/leveldb/ | sha1sum
+// and taking the leading 64 bits.
+static const uint64_t kTableMagicNumber = 0xdb4775248b80fb57ull;
+
+// metaindex 中记录索引类型的条目名称，value 是 varint32 编码的 IndexType
+static const char kIndexTypeBlockName[] = "tinydb.IndexType";
+
+// metaindex 中记录前缀过滤器的条目名称，value 是 1 字节的 whole_key_filtering 标志
+// 加上生成过滤器时使用的 prefix_extractor 的名字
+static const char kPrefixExtractorBlockName[] = "tinydb.PrefixExtractor";
+
+// metaindex 中 range tombstone 块的条目名称，value 是块的 BlockHandle
+// 块中的 key/value 由调用者决定，table 只负责保存(见 TableBuilder::AddRangeTombstone)
+static const char kRangeDelBlockName[] = "tinydb.RangeDel";
+
+enum IndexType {
+    // 单个索引块，在数据块的分隔 key 上二分查找
+    kBinarySearch = 0,
+    // 分区索引：顶层索引指向多个索引分区，分区按需读取
+    kTwoLevelIndexSearch = 1,
+};
+
+// 1-byte type + 32-bit crc
+static const size_t kBlockTrailerSize = 5;
+
+struct BlockContents {
+    Slice data;           // Actual contents of data
+    bool cachable;        // True iff data can be cached
+    bool heap_allocated;  // True iff caller should delete[] data.data()
+};
+
+/*
+ * 从 file 中读取 handle 指向的块，解压后放到 *result
+ * dict 非空时，Zstd 压缩的块用该字典解压
+ */
+Status ReadBlock(RandomAccessFile* file, const ReadOptions& options,
+                 const BlockHandle& handle, BlockContents* result,
+                 const CompressionDict* dict = nullptr);
+
+/*
+ * 解析已经读到内存中的块，data 指向块内容加 trailer，共 handle.size() + kBlockTrailerSize 字节
+ * 用于一次读取多个相邻块的场景。result 总是指向新分配的堆内存，返回后 data 可以释放
+ */
+Status DecodeBlock(const char* data, const ReadOptions& options,
+                   const BlockHandle& handle, BlockContents* result,
+                   const CompressionDict* dict = nullptr);
+
+// Implementation details follow.  Clients should ignore,
+
+inline BlockHandle::BlockHandle()
+        : offset_(~static_cast<uint64_t>(0)), size_(~static_cast<uint64_t>(0)) {}
+
+} // namespace tinydb
+
+#endif  // STORAGE_TINYDB_TABLE_FORMAT_H_
@@ -0,0 +1,87 @@
+#ifndef STORAGE_TINYDB_TABLE_ITERATOR_WRAPPER_H_
+#define STORAGE_TINYDB_TABLE_ITERATOR_WRAPPER_H_
+
+#include "tinydb/iterator.h"
+#include "tinydb/slice.h"
+
+namespace tinydb {
+
+/*
+ * 缓存了 Valid() 和 key() 结果的迭代器包装
+ * 避免每次都调用虚函数，同时 key 的访问有更好的缓存局部性
+ */
+class IteratorWrapper {
+public:
+    IteratorWrapper() : iter_(nullptr), valid_(false) {}
+    explicit IteratorWrapper(Iterator* iter) : iter_(nullptr) { Set(iter); }
+    ~IteratorWrapper() { delete iter_; }
+    Iterator* iter() const { return iter_; }
+
+    // 接管 iter 的所有权，之前的迭代器会被删除
+    void Set(Iterator* iter) {
+        delete iter_;
+        iter_ = iter;
+        if (iter_ == nullptr) {
+            valid_ = false;
+        } else {
+            Update();
+        }
+    }
+
+    // Iterator interface methods
+    bool Valid() const { return valid_; }
+    Slice key() const {
+        assert(Valid());
+        return key_;
+    }
+    Slice value() const {
+        assert(Valid());
+        return iter_->value();
+    }
+    // Methods below require iter() != nullptr
+    Status status() const {
+        assert(iter_);
+        return iter_->status();
+    }
+    void Next() {
+        assert(iter_);
+        iter_->Next();
+        Update();
+    }
+    void Prev() {
+        assert(iter_);
+        iter_->Prev();
+        Update();
+    }
+    void Seek(const Slice& k) {
+        assert(iter_);
+        iter_->Seek(k);
+        Update();
+    }
+    void SeekToFirst() {
+        assert(iter_);
+        iter_->SeekToFirst();
+        Update();
+    }
+    void SeekToLast() {
+        assert(iter_);
+        iter_->SeekToLast();
+        Update();
+    }
+
+private:
+    void Update() {
+        valid_ = iter_->Valid();
+        if (valid_) {
+            key_ = iter_->key();
+        }
+    }
+
+    Iterator* iter_;
+    bool valid_;
+    Slice key_;
+};
+
+} // namespace tinydb
+
+#endif  // STORAGE_TINYDB_TABLE_ITERATOR_WRAPPER_H_
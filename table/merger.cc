@@ -0,0 +1,265 @@
+/*
+ * MergingIterator 用败者树(loser tree)从多个子迭代器中选出当前最小(反向时最大)的 key
+ *
+ * 败者树是一棵完全二叉树，叶子是子迭代器，每个内部节点记录该处比赛的败者，
+ * tree_[0] 记录最终的胜者。胜者前进一步后，只需要沿着它的叶子到根的路径
+ * 重新比赛 log(n) 次，每层只比较一次，而二叉堆下沉时每层要比较两次
+ *
+ * 同一个子迭代器连续胜出(例如各个源的 key 范围重叠不多)时，记录下胜者路径上
+ * 最强的败者，即亚军。胜者前进后只要仍然胜过亚军，路径上的所有比赛结果都不变，
+ * 只需比较一次就可以确定它仍是胜者
+ */
+
+#include "table/merger.h"
+
+#include <vector>
+
+#include "table/iterator_wrapper.h"
+#include "tinydb/comparator.h"
+#include "tinydb/iterator.h"
+
+namespace tinydb {
+
+namespace {
+
+class MergingIterator : public Iterator {
+public:
+    MergingIterator(const Comparator* comparator, Iterator** children, int n)
+            : comparator_(comparator),
+              children_(new IteratorWrapper[n]),
+              n_(n),
+              tree_(n),
+              winners_(2 * n),
+              runner_up_(kNone),
+              current_(nullptr),
+              direction_(kForward) {
+        for (int i = 0; i < n; i++) {
+            children_[i].Set(children[i]);
+        }
+    }
+
+    ~MergingIterator() override { delete[] children_; }
+
+    bool Valid() const override { return (current_ != nullptr); }
+
+    void SeekToFirst() override {
+        for (int i = 0; i < n_; i++) {
+            children_[i].SeekToFirst();
+        }
+        direction_ = kForward;
+        Build();
+    }
+
+    void SeekToLast() override {
+        for (int i = 0; i < n_; i++) {
+            children_[i].SeekToLast();
+        }
+        direction_ = kReverse;
+        Build();
+    }
+
+    void Seek(const Slice& target) override {
+        for (int i = 0; i < n_; i++) {
+            children_[i].Seek(target);
+        }
+        direction_ = kForward;
+        Build();
+    }
+
+    void Next() override {
+        assert(Valid());
+
+        // 保证所有子迭代器都位于 key() 之后。正向移动时，除 current_ 之外的
+        // 子迭代器已经满足，因为 current_ 是最小的子迭代器，而 key() == current_->key()
+        // 否则需要显式地把其他子迭代器移到 key() 之后
+        if (direction_ != kForward) {
+            for (int i = 0; i < n_; i++) {
+                IteratorWrapper* child = &children_[i];
+                if (child != current_) {
+                    child->Seek(key());
+                    if (child->Valid() &&
+                        comparator_->Compare(key(), child->key()) == 0) {
+                        child->Next();
+                    }
+                }
+            }
+            direction_ = kForward;
+            current_->Next();
+            Build();
+            return;
+        }
+
+        current_->Next();
+        Advance();
+    }
+
+    void Prev() override {
+        assert(Valid());
+
+        // 保证所有子迭代器都位于 key() 之前，与 Next() 对称
+        if (direction_ != kReverse) {
+            for (int i = 0; i < n_; i++) {
+                IteratorWrapper* child = &children_[i];
+                if (child != current_) {
+                    child->Seek(key());
+                    if (child->Valid()) {
+                        // Child is at first entry >= key().  Step back one to be < key()
+                        child->Prev();
+                    } else {
+                        // Child has no entries >= key().  Position at last entry.
+                        child->SeekToLast();
+                    }
+                }
+            }
+            direction_ = kReverse;
+            current_->Prev();
+            Build();
+            return;
+        }
+
+        current_->Prev();
+        Advance();
+    }
+
+    Slice key() const override {
+        assert(Valid());
+        return current_->key();
+    }
+
+    Slice value() const override {
+        assert(Valid());
+        return current_->value();
+    }
+
+    Status status() const override {
+        Status status;
+        for (int i = 0; i < n_; i++) {
+            status = children_[i].status();
+            if (!status.ok()) {
+                break;
+            }
+        }
+        return status;
+    }
+
+private:
+    // Which direction is the iterator moving?
+    enum Direction { kForward, kReverse };
+
+    // 没有亚军
+    static const int kNone = -1;
+
+    // 子迭代器 a 是否胜过 b：无效的子迭代器总是输。key 相同时正向下标小的胜，
+    // 反向下标大的胜，反向遍历的顺序与正向完全相反
+    bool Beats(int a, int b) const {
+        const IteratorWrapper& x = children_[a];
+        const IteratorWrapper& y = children_[b];
+        if (!x.Valid()) return false;
+        if (!y.Valid()) return true;
+        const int r = comparator_->Compare(x.key(), y.key());
+        if (direction_ == kReverse) {
+            return r > 0 || (r == 0 && a > b);
+        }
+        return r < 0 || (r == 0 && a < b);
+    }
+
+    // 所有子迭代器重新定位后，自底向上重建整棵树
+    void Build() {
+        runner_up_ = kNone;
+        if (n_ == 0) {
+            current_ = nullptr;
+            return;
+        }
+        // 叶子 i 位于 n_ + i，节点 p 的子节点为 2p 和 2p+1
+        for (int i = 0; i < n_; i++) {
+            winners_[n_ + i] = i;
+        }
+        for (int p = n_ - 1; p >= 1; p--) {
+            const int l = winners_[2 * p];
+            const int r = winners_[2 * p + 1];
+            if (Beats(r, l)) {
+                winners_[p] = r;
+                tree_[p] = l;
+            } else {
+                winners_[p] = l;
+                tree_[p] = r;
+            }
+        }
+        tree_[0] = (n_ == 1) ? 0 : winners_[1];
+        SetCurrent();
+    }
+
+    // 胜者前进了一步，重新确定胜者
+    void Advance() {
+        const int winner = tree_[0];
+        if (runner_up_ != kNone && Beats(winner, runner_up_)) {
+            // 仍然胜过路径上最强的败者，所有比赛结果不变
+            SetCurrent();
+            return;
+        }
+        Replay(winner);
+        if (tree_[0] == winner) {
+            // 连续胜出，值得为后续的快速路径找出亚军
+            FindRunnerUp();
+        } else {
+            runner_up_ = kNone;
+        }
+        SetCurrent();
+    }
+
+    // 沿叶子 i 到根的路径重新比赛
+    void Replay(int i) {
+        int winner = i;
+        for (int p = (n_ + i) / 2; p > 0; p /= 2) {
+            if (Beats(tree_[p], winner)) {
+                std::swap(tree_[p], winner);
+            }
+        }
+        tree_[0] = winner;
+    }
+
+    // 亚军是胜者路径上各个败者中最强的一个
+    void FindRunnerUp() {
+        runner_up_ = kNone;
+        if (!children_[tree_[0]].Valid()) {
+            return;
+        }
+        for (int p = (n_ + tree_[0]) / 2; p > 0; p /= 2) {
+            if (runner_up_ == kNone || Beats(tree_[p], runner_up_)) {
+                runner_up_ = tree_[p];
+            }
+        }
+    }
+
+    void SetCurrent() {
+        IteratorWrapper* winner = &children_[tree_[0]];
+        current_ = winner->Valid() ? winner : nullptr;
+    }
+
+    const Comparator* comparator_;
+    IteratorWrapper* children_;
+    int n_;
+    // tree_[0] 是胜者的下标，tree_[1..n_-1] 是各内部节点的败者
+    std::vector<int> tree_;
+    // Build() 使用的临时数组，记录每个节点的胜者
+    std::vector<int> winners_;
+    int runner_up_;
+    IteratorWrapper* current_;
+    Direction direction_;
+};
+
+} // namespace
+
+Iterator* NewMergingIterator(const Comparator* comparator, Iterator** children,
+                             int n) {
+    assert(n >= 0);
+    if (n == 0) {
+        return NewEmptyIterator();
+    } else if (n == 1) {
+        return children[0];
+    } else {
+        return new MergingIterator(comparator, children, n);
+    }
+}
+
+} // namespace tinydb
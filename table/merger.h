@@ -0,0 +1,23 @@
+#ifndef STORAGE_TINYDB_TABLE_MERGER_H_
+#define STORAGE_TINYDB_TABLE_MERGER_H_
+
+namespace tinydb {
+
+class Comparator;
+class Iterator;
+
+/*
+ * 返回合并 children[0,n-1] 的迭代器，接管所有子迭代器的所有权，
+ * 返回的迭代器析构时删除它们
+ *
+ * 不会去掉重复的 key：某个 key 在 K 个子迭代器中出现时，会被返回 K 次
+ * 相同的 key 正向遍历时按子迭代器的下标顺序返回，反向遍历时顺序相反
+ *
+ * REQUIRES: n >= 0
+ */
+Iterator* NewMergingIterator(const Comparator* comparator, Iterator** children,
+                             int n);
+
+} // namespace tinydb
+
+#endif  // STORAGE_TINYDB_TABLE_MERGER_H_
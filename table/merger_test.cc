@@ -0,0 +1,189 @@
+#include "table/merger.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "tinydb/comparator.h"
+#include "tinydb/iterator.h"
+#include "util/random.h"
+
+namespace tinydb {
+
+namespace {
+
+// 遍历一组有序的 (key, value)
+class VectorIterator : public Iterator {
+public:
+    explicit VectorIterator(std::vector<std::pair<std::string, std::string>> entries)
+        : entries_(std::move(entries)), pos_(entries_.size()) {}
+
+    bool Valid() const override { return pos_ < entries_.size(); }
+    void SeekToFirst() override { pos_ = 0; }
+    void SeekToLast() override { pos_ = entries_.empty() ? 0 : entries_.size() - 1; }
+    void Seek(const Slice& target) override {
+        pos_ = 0;
+        while (pos_ < entries_.size() && Slice(entries_[pos_].first).compare(target) < 0) {
+            pos_++;
+        }
+    }
+    void Next() override { pos_++; }
+    void Prev() override { pos_ = pos_ == 0 ? entries_.size() : pos_ - 1; }
+    Slice key() const override { return entries_[pos_].first; }
+    Slice value() const override { return entries_[pos_].second; }
+    Status status() const override { return Status::OK(); }
+
+private:
+    std::vector<std::pair<std::string, std::string>> entries_;
+    size_t pos_;
+};
+
+std::string Key(int i) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%06d", i);
+    return buf;
+}
+
+} // namespace
+
+/*
+ * 把随机数据分给若干子迭代器，与按 (key, 子迭代器下标) 排序的参照结果比较
+ */
+class MergerTest : public testing::Test {
+public:
+    // value 记录所属的子迭代器，相同 key 的顺序可以检查
+    void Build(int children, int num, int key_space, uint32_t seed) {
+        Random rnd(seed);
+        std::vector<std::vector<std::pair<std::string, std::string>>> data(children);
+        expected_.clear();
+        for (int i = 0; i < num; i++) {
+            const int child = rnd.Uniform(children);
+            const std::string key = Key(rnd.Uniform(key_space));
+            const std::string value = std::to_string(child);
+            // 同一个子迭代器内 key 不重复
+            auto& entries = data[child];
+            bool dup = false;
+            for (const auto& e : entries) {
+                if (e.first == key) dup = true;
+            }
+            if (!dup) {
+                entries.emplace_back(key, value);
+                expected_.emplace_back(key, child);
+            }
+        }
+        std::sort(expected_.begin(), expected_.end());
+
+        std::vector<Iterator*> list;
+        for (auto& entries : data) {
+            std::sort(entries.begin(), entries.end());
+            list.push_back(new VectorIterator(entries));
+        }
+        iter_.reset(NewMergingIterator(BytewiseComparator(), list.data(),
+                                       static_cast<int>(list.size())));
+    }
+
+    // 迭代器当前位置是否是 expected_[pos]
+    void CheckAt(size_t pos) {
+        if (pos >= expected_.size()) {
+            ASSERT_FALSE(iter_->Valid());
+            return;
+        }
+        ASSERT_TRUE(iter_->Valid());
+        EXPECT_EQ(expected_[pos].first, iter_->key().ToString());
+        EXPECT_EQ(std::to_string(expected_[pos].second), iter_->value().ToString());
+    }
+
+    // 第一个 key >= target 的位置
+    size_t LowerBound(const std::string& target) {
+        size_t pos = 0;
+        while (pos < expected_.size() && expected_[pos].first < target) pos++;
+        return pos;
+    }
+
+    std::vector<std::pair<std::string, int>> expected_;
+    std::unique_ptr<Iterator> iter_;
+};
+
+TEST_F(MergerTest, Empty) {
+    Build(0, 0, 1, 1);
+    iter_->SeekToFirst();
+    EXPECT_FALSE(iter_->Valid());
+    iter_->SeekToLast();
+    EXPECT_FALSE(iter_->Valid());
+
+    Build(5, 0, 1, 1);
+    iter_->Seek("a");
+    EXPECT_FALSE(iter_->Valid());
+}
+
+TEST_F(MergerTest, ForwardAndReverse) {
+    for (int children : {1, 2, 3, 7, 64}) {
+        Build(children, 2000, 1000, 301 + children);
+        size_t pos = 0;
+        for (iter_->SeekToFirst(); iter_->Valid(); iter_->Next(), pos++) {
+            CheckAt(pos);
+        }
+        EXPECT_EQ(expected_.size(), pos) << children;
+
+        pos = expected_.size();
+        for (iter_->SeekToLast(); iter_->Valid(); iter_->Prev()) {
+            CheckAt(--pos);
+        }
+        EXPECT_EQ(0u, pos) << children;
+    }
+}
+
+TEST_F(MergerTest, DuplicateKeysInChildOrder) {
+    std::vector<Iterator*> list;
+    for (int c = 0; c < 4; c++) {
+        list.push_back(new VectorIterator({{"a", std::to_string(c)},
+                                           {"b", std::to_string(c)}}));
+    }
+    iter_.reset(NewMergingIterator(BytewiseComparator(), list.data(), 4));
+    std::string result;
+    for (iter_->SeekToFirst(); iter_->Valid(); iter_->Next()) {
+        result += iter_->key().ToString() + iter_->value().ToString() + " ";
+    }
+    EXPECT_EQ("a0 a1 a2 a3 b0 b1 b2 b3 ", result);
+
+    result.clear();
+    for (iter_->SeekToLast(); iter_->Valid(); iter_->Prev()) {
+        result += iter_->key().ToString() + iter_->value().ToString() + " ";
+    }
+    EXPECT_EQ("b3 b2 b1 b0 a3 a2 a1 a0 ", result);
+}
+
+TEST_F(MergerTest, RandomSeekAndDirectionChanges) {
+    // 相同 key 出现在多个子迭代器中时，Prev 和 Next 的切换可能跳过或重复它们，
+    // 这里只用互不相同的 key 检查
+    Build(16, 3000, 1 << 30, 17);
+    for (size_t i = 1; i < expected_.size(); i++) {
+        ASSERT_NE(expected_[i - 1].first, expected_[i].first);
+    }
+    Random rnd(42);
+    size_t pos = 0;
+    iter_->SeekToFirst();
+    for (int step = 0; step < 10000; step++) {
+        const int op = rnd.Uniform(5);
+        if (op == 0) {
+            const std::string target = Key(rnd.Uniform(1 << 30));
+            iter_->Seek(target);
+            pos = LowerBound(target);
+        } else if (op == 1 || op == 2) {
+            if (!iter_->Valid()) continue;
+            iter_->Next();
+            pos++;
+        } else {
+            if (!iter_->Valid()) continue;
+            iter_->Prev();
+            pos = pos == 0 ? expected_.size() : pos - 1;
+        }
+        CheckAt(pos);
+    }
+}
+
+} // namespace tinydb
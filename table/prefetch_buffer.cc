@@ -0,0 +1,81 @@
+#include "table/prefetch_buffer.h"
+
+#include <algorithm>
+
+#include "tinydb/env.h"
+
+namespace tinydb {
+
+const size_t FilePrefetchBuffer::kInitialReadahead;
+
+FilePrefetchBuffer::FilePrefetchBuffer(RandomAccessFile* file,
+                                       size_t readahead_size,
+                                       size_t max_readahead_size)
+        : file_(file),
+          fixed_readahead_(readahead_size),
+          max_readahead_(std::max(max_readahead_size, kInitialReadahead)),
+          readahead_(kInitialReadahead),
+          sequential_reads_(0),
+          prev_end_(0),
+          buffer_offset_(0),
+          buffer_len_(0),
+          buffer_data_(nullptr) {}
+
+bool FilePrefetchBuffer::TryRead(uint64_t offset, size_t n, Slice* result,
+                                 Status* s) {
+    const bool sequential = (offset == prev_end_);
+    const bool backward = (offset < prev_end_);
+    prev_end_ = offset + n;
+
+    if (Contains(offset, n)) {
+        *result = Slice(buffer_data_ + (offset - buffer_offset_), n);
+        return true;
+    }
+
+    size_t len;
+    if (fixed_readahead_ > 0) {
+        if (backward) {
+            // 反向遍历时往后预读没有用
+            return false;
+        }
+        len = std::max(n, fixed_readahead_);
+    } else {
+        if (!sequential) {
+            // 随机读取，重新开始检测
+            sequential_reads_ = 0;
+            readahead_ = kInitialReadahead;
+            return false;
+        }
+        if (++sequential_reads_ < kSequentialReads) {
+            return false;
+        }
+        len = std::max(n, readahead_);
+        readahead_ = std::min(readahead_ * 2, max_readahead_);
+    }
+
+    if (buffer_.size() < len) {
+        buffer_.resize(len);
+    }
+    Slice contents;
+    *s = file_->Read(offset, len, &contents, &buffer_[0]);
+    if (!s->ok()) {
+        buffer_len_ = 0;
+        return true;
+    }
+    buffer_offset_ = offset;
+    buffer_len_ = contents.size();
+    buffer_data_ = contents.data();
+    if (!Contains(offset, n)) {
+        *s = Status::Corruption("truncated block read");
+        return true;
+    }
+
+    // 在解析这一段的同时，让操作系统在后台读入下一段
+    const size_t next = (fixed_readahead_ > 0) ? fixed_readahead_ : readahead_;
+    file_->Prefetch(offset + buffer_len_, next);
+
+    *result = Slice(buffer_data_, n);
+    return true;
+}
+
+} // namespace tinydb
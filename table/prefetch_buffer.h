@@ -0,0 +1,67 @@
+#ifndef STORAGE_TINYDB_TABLE_PREFETCH_BUFFER_H_
+#define STORAGE_TINYDB_TABLE_PREFETCH_BUFFER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "tinydb/slice.h"
+#include "tinydb/status.h"
+
+namespace tinydb {
+
+class RandomAccessFile;
+
+/*
+ * table 迭代器使用的预读缓冲区，每个迭代器一个，不是线程安全的
+ *
+ * readahead_size > 0 时每次向前读取缺失时都读取固定大小的一段
+ * readahead_size == 0 时自动预读：连续 kSequentialReads 次读取首尾相接时认为是顺序扫描，
+ * 从 kInitialReadahead 开始，每次预读的大小翻倍，直到 max_readahead_size；
+ * 一旦发生不连续的读取(例如 Seek)，就退回到直接读文件
+ *
+ * 每次填充缓冲区后，通过 RandomAccessFile::Prefetch 提示操作系统在后台读入下一段，
+ * 这样解析当前数据块时，下一段数据的 I/O 已经在进行
+ */
+class FilePrefetchBuffer {
+public:
+    FilePrefetchBuffer(RandomAccessFile* file, size_t readahead_size,
+                       size_t max_readahead_size);
+
+    FilePrefetchBuffer(const FilePrefetchBuffer&) = delete;
+    FilePrefetchBuffer& operator=(const FilePrefetchBuffer&) = delete;
+
+    /*
+     * 尝试从缓冲区中读取 [offset, offset + n)，需要时先预读
+     * 返回 true 时 *result 为读取的内容(或者 *s 为读取错误)，
+     * *result 在下一次调用 TryRead 之前有效
+     * 返回 false 表示不值得预读，调用者应该直接读文件
+     */
+    bool TryRead(uint64_t offset, size_t n, Slice* result, Status* s);
+
+private:
+    // 自动预读的初始大小
+    static const size_t kInitialReadahead = 8 * 1024;
+    // 连续多少次首尾相接的读取之后开始自动预读
+    static const int kSequentialReads = 2;
+
+    bool Contains(uint64_t offset, size_t n) const {
+        return offset >= buffer_offset_ &&
+               offset + n <= buffer_offset_ + buffer_len_;
+    }
+
+    RandomAccessFile* const file_;
+    const size_t fixed_readahead_;
+    const size_t max_readahead_;
+    size_t readahead_;         // 下次填充缓冲区的大小
+    int sequential_reads_;     // 连续首尾相接的读取次数
+    uint64_t prev_end_;        // 上一次读取的结束位置
+    std::string buffer_;
+    uint64_t buffer_offset_;   // buffer_ 在文件中的起始偏移
+    size_t buffer_len_;        // buffer_ 中有效数据的长度
+    const char* buffer_data_;  // 有效数据的起始地址，文件可能返回自己的内存
+};
+
+} // namespace tinydb
+
+#endif  // STORAGE_TINYDB_TABLE_PREFETCH_BUFFER_H_
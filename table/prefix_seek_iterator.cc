@@ -0,0 +1,108 @@
+#include "table/prefix_seek_iterator.h"
+
+#include <string>
+
+#include "tinydb/slice_transform.h"
+
+namespace tinydb {
+
+namespace {
+
+typedef bool (*PrefixMayMatchFunction)(void*, const ReadOptions&, const Slice&);
+
+class PrefixSeekIterator : public Iterator {
+public:
+    PrefixSeekIterator(Iterator* iter, const SliceTransform* prefix_extractor,
+                       PrefixMayMatchFunction prefix_may_match, void* arg,
+                       const ReadOptions& options)
+        : iter_(iter),
+          prefix_extractor_(prefix_extractor),
+          prefix_may_match_(prefix_may_match),
+          arg_(arg),
+          options_(options),
+          valid_(false),
+          bounded_(false) {}
+
+    ~PrefixSeekIterator() override { delete iter_; }
+
+    bool Valid() const override { return valid_; }
+
+    void Seek(const Slice& target) override {
+        bounded_ = false;
+        if (prefix_extractor_->InDomain(target)) {
+            if (prefix_may_match_ != nullptr &&
+                !(*prefix_may_match_)(arg_, options_, target)) {
+                valid_ = false;
+                return;
+            }
+            if (options_.prefix_same_as_start) {
+                Slice prefix = prefix_extractor_->Transform(target);
+                prefix_.assign(prefix.data(), prefix.size());
+                bounded_ = true;
+            }
+        }
+        iter_->Seek(target);
+        UpdateValid();
+    }
+    void SeekToFirst() override {
+        bounded_ = false;
+        iter_->SeekToFirst();
+        UpdateValid();
+    }
+    void SeekToLast() override {
+        bounded_ = false;
+        iter_->SeekToLast();
+        UpdateValid();
+    }
+    void Next() override {
+        assert(Valid());
+        iter_->Next();
+        UpdateValid();
+    }
+    void Prev() override {
+        assert(Valid());
+        iter_->Prev();
+        UpdateValid();
+    }
+    Slice key() const override {
+        assert(Valid());
+        return iter_->key();
+    }
+    Slice value() const override {
+        assert(Valid());
+        return iter_->value();
+    }
+    Status status() const override { return iter_->status(); }
+
+private:
+    // 限制在 prefix_ 内时，走出前缀即视为无效
+    void UpdateValid() {
+        valid_ = iter_->Valid();
+        if (valid_ && bounded_) {
+            Slice k = iter_->key();
+            valid_ = prefix_extractor_->InDomain(k) &&
+                     prefix_extractor_->Transform(k) == Slice(prefix_);
+        }
+    }
+
+    Iterator* const iter_;
+    const SliceTransform* const prefix_extractor_;
+    const PrefixMayMatchFunction prefix_may_match_;
+    void* const arg_;
+    const ReadOptions options_;
+    bool valid_;
+    bool bounded_;
+    std::string prefix_;
+};
+
+} // namespace
+
+Iterator* NewPrefixSeekIterator(Iterator* iter,
+                                const SliceTransform* prefix_extractor,
+                                PrefixMayMatchFunction prefix_may_match,
+                                void* arg, const ReadOptions& options) {
+    return new PrefixSeekIterator(iter, prefix_extractor, prefix_may_match, arg,
+                                  options);
+}
+
+} // namespace tinydb
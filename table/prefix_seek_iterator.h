@@ -0,0 +1,31 @@
+#ifndef STORAGE_TINYDB_TABLE_PREFIX_SEEK_ITERATOR_H_
+#define STORAGE_TINYDB_TABLE_PREFIX_SEEK_ITERATOR_H_
+
+#include "tinydb/iterator.h"
+#include "tinydb/options.h"
+
+namespace tinydb {
+
+class SliceTransform;
+
+/*
+ * 返回一个前缀 seek 模式的迭代器，包装 iter
+ *
+ * Seek(target) 时如果 target 有前缀，先调用 (*prefix_may_match)(arg, options, target)，
+ * 返回 false 表示数据源中没有与 target 前缀相同且 >= target 的 key，迭代器直接变为无效，
+ * 不会定位 iter(也就不会读取数据块)。prefix_may_match 可以为 nullptr
+ *
+ * options.prefix_same_as_start 为 true 时，Seek() 之后只返回与 target 前缀相同的 key，
+ * 走到其他前缀时变为无效。SeekToFirst()/SeekToLast() 不受前缀限制
+ *
+ * 接管 iter 的所有权
+ */
+Iterator* NewPrefixSeekIterator(
+        Iterator* iter, const SliceTransform* prefix_extractor,
+        bool (*prefix_may_match)(void* arg, const ReadOptions& options,
+                                 const Slice& target),
+        void* arg, const ReadOptions& options);
+
+} // namespace tinydb
+
+#endif  // STORAGE_TINYDB_TABLE_PREFIX_SEEK_ITERATOR_H_
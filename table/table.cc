@@ -0,0 +1,806 @@
+#include "tinydb/table.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "table/block.h"
+#include "table/filter_block.h"
+#include "table/format.h"
+#include "table/prefetch_buffer.h"
+#include "table/prefix_seek_iterator.h"
+#include "table/two_level_iterator.h"
+#include "tinydb/cache.h"
+#include "tinydb/comparator.h"
+#include "tinydb/env.h"
+#include "tinydb/filter_policy.h"
+#include "tinydb/options.h"
+#include "tinydb/rate_limiter.h"
+#include "tinydb/slice_transform.h"
+#include "util/coding.h"
+#include "util/compression_dict.h"
+#include "util/statistics.h"
+
+namespace tinydb {
+
+struct Table::Rep {
+    ~Rep() {
+        delete filter;
+        delete[] filter_data;
+        delete filter_index;
+        delete dict;
+        delete range_del_block;
+        delete index_block;
+    }
+
+    Options options;
+    Status status;
+    RandomAccessFile* file;
+    uint64_t cache_id;
+
+    // 不分区的过滤器
+    FilterBlockReader* filter;
+    const char* filter_data;
+    // 分区过滤器的顶层索引，value 是各个过滤器分区的 BlockHandle
+    Block* filter_index;
+
+    CompressionDict* dict;
+
+    // range tombstone 块，没有时为 nullptr
+    Block* range_del_block;
+
+    BlockHandle metaindex_handle;  // Handle to metaindex_block: saved from footer
+    // 不分区时是整个索引块，分区时是顶层索引
+    Block* index_block;
+    bool partitioned_index;
+
+    // 过滤器中是否包含完整的 key
+    bool whole_key_filtering;
+    // 过滤器中包含该变换生成的前缀，与 table 记录的名字不一致时为 nullptr
+    const SliceTransform* prefix_extractor;
+};
+
+Status Table::Open(const Options& options, RandomAccessFile* file,
+                   uint64_t size, Table** table) {
+    *table = nullptr;
+    if (size < Footer::kEncodedLength) {
+        return Status::Corruption("file is too short to be an sstable");
+    }
+
+    char footer_space[Footer::kEncodedLength];
+    Slice footer_input;
+    Status s = file->Read(size - Footer::kEncodedLength, Footer::kEncodedLength,
+                          &footer_input, footer_space);
+    if (!s.ok()) return s;
+
+    Footer footer;
+    s = footer.DecodeFrom(&footer_input);
+    if (!s.ok()) return s;
+
+    // Read the index block
+    BlockContents index_block_contents;
+    ReadOptions opt;
+    if (options.paranoid_checks) {
+        opt.verify_checksums = true;
+    }
+    s = ReadBlock(file, opt, footer.index_handle(), &index_block_contents);
+
+    if (s.ok()) {
+        // We've successfully read the footer and the index block: we're
+        // ready to serve requests.
+        Block* index_block = new Block(index_block_contents);
+        Rep* rep = new Table::Rep;
+        rep->options = options;
+        rep->file = file;
+        rep->metaindex_handle = footer.metaindex_handle();
+        rep->index_block = index_block;
+        rep->partitioned_index = false;
+        rep->whole_key_filtering = true;
+        rep->prefix_extractor = nullptr;
+        rep->cache_id = (options.block_cache ? options.block_cache->NewId() : 0);
+        rep->filter_data = nullptr;
+        rep->filter = nullptr;
+        rep->filter_index = nullptr;
+        rep->dict = nullptr;
+        rep->range_del_block = nullptr;
+        *table = new Table(rep);
+        (*table)->ReadMeta(footer);
+        if (!rep->status.ok()) {
+            // 读不到 range tombstone 时被删除的数据会重新可见，不能忽略
+            s = rep->status;
+            delete *table;
+            *table = nullptr;
+        }
+    }
+
+    return s;
+}
+
+void Table::ReadMeta(const Footer& footer) {
+    ReadOptions opt;
+    if (rep_->options.paranoid_checks) {
+        opt.verify_checksums = true;
+    }
+    BlockContents contents;
+    if (!ReadBlock(rep_->file, opt, footer.metaindex_handle(), &contents).ok()) {
+        // Do not propagate errors since meta info is not needed for operation
+        return;
+    }
+    Block* meta = new Block(contents);
+
+    Iterator* iter = meta->NewIterator(BytewiseComparator());
+
+    iter->Seek(kIndexTypeBlockName);
+    if (iter->Valid() && iter->key() == Slice(kIndexTypeBlockName)) {
+        Slice v = iter->value();
+        uint32_t index_type;
+        if (GetVarint32(&v, &index_type)) {
+            rep_->partitioned_index = (index_type == kTwoLevelIndexSearch);
+        }
+    }
+
+    iter->Seek(kPrefixExtractorBlockName);
+    if (iter->Valid() && iter->key() == Slice(kPrefixExtractorBlockName) &&
+        !iter->value().empty()) {
+        Slice v = iter->value();
+        rep_->whole_key_filtering = (v[0] != 0);
+        v.remove_prefix(1);
+        const SliceTransform* prefix_extractor = rep_->options.prefix_extractor;
+        if (prefix_extractor != nullptr && v == Slice(prefix_extractor->Name())) {
+            rep_->prefix_extractor = prefix_extractor;
+        }
+    }
+
+    iter->Seek(kCompressionDictBlockName);
+    if (iter->Valid() && iter->key() == Slice(kCompressionDictBlockName)) {
+        ReadDict(iter->value());
+    }
+
+    iter->Seek(kRangeDelBlockName);
+    if (iter->Valid() && iter->key() == Slice(kRangeDelBlockName)) {
+        rep_->status = ReadRangeDel(iter->value());
+    }
+
+    if (rep_->options.filter_policy != nullptr) {
+        std::string key = "filter.";
+        key.append(rep_->options.filter_policy->Name());
+        iter->Seek(key);
+        if (iter->Valid() && iter->key() == Slice(key)) {
+            ReadFilter(iter->value(), false);
+        } else {
+            key = "filter.partitioned.";
+            key.append(rep_->options.filter_policy->Name());
+            iter->Seek(key);
+            if (iter->Valid() && iter->key() == Slice(key)) {
+                ReadFilter(iter->value(), true);
+            }
+        }
+    }
+    delete iter;
+    delete meta;
+}
+
+void Table::ReadFilter(const Slice& filter_handle_value, bool partitioned) {
+    Slice v = filter_handle_value;
+    BlockHandle filter_handle;
+    if (!filter_handle.DecodeFrom(&v).ok()) {
+        return;
+    }
+
+    // We might want to unify with ReadBlock() if we start
+    // requiring checksum verification in Table::Open.
+    ReadOptions opt;
+    if (rep_->options.paranoid_checks) {
+        opt.verify_checksums = true;
+    }
+    BlockContents block;
+    if (!ReadBlock(rep_->file, opt, filter_handle, &block).ok()) {
+        return;
+    }
+    if (partitioned) {
+        // 只读取顶层过滤器索引，过滤器分区在查找时按需读取
+        rep_->filter_index = new Block(block);
+        return;
+    }
+    if (block.heap_allocated) {
+        rep_->filter_data = block.data.data();  // Will need to delete later
+    }
+    rep_->filter = new FilterBlockReader(rep_->options.filter_policy, block.data);
+}
+
+void Table::ReadDict(const Slice& dict_handle_value) {
+    Slice v = dict_handle_value;
+    BlockHandle dict_handle;
+    if (!dict_handle.DecodeFrom(&v).ok()) {
+        return;
+    }
+    ReadOptions opt;
+    opt.verify_checksums = true;
+    BlockContents block;
+    if (!ReadBlock(rep_->file, opt, dict_handle, &block).ok()) {
+        return;
+    }
+    rep_->dict = new CompressionDict(block.data);
+    if (block.heap_allocated) {
+        delete[] block.data.data();
+    }
+}
+
+Status Table::ReadRangeDel(const Slice& range_del_handle_value) {
+    Slice v = range_del_handle_value;
+    BlockHandle handle;
+    Status s = handle.DecodeFrom(&v);
+    if (!s.ok()) {
+        return s;
+    }
+    ReadOptions opt;
+    opt.verify_checksums = true;
+    BlockContents block;
+    s = ReadBlock(rep_->file, opt, handle, &block);
+    if (s.ok()) {
+        rep_->range_del_block = new Block(block);
+    }
+    return s;
+}
+
+Iterator* Table::NewRangeTombstoneIterator() const {
+    if (rep_->range_del_block == nullptr) {
+        return nullptr;
+    }
+    return rep_->range_del_block->NewIterator(rep_->options.comparator);
+}
+
+Table::~Table() { delete rep_; }
+
+static void DeleteBlock(void* arg, void* ignored) {
+    delete reinterpret_cast<Block*>(arg);
+}
+
+static void DeleteCachedBlock(const Slice& key, void* value) {
+    Block* block = reinterpret_cast<Block*>(value);
+    delete block;
+}
+
+static void ReleaseBlock(void* arg, void* h) {
+    Cache* cache = reinterpret_cast<Cache*>(arg);
+    Cache::Handle* handle = reinterpret_cast<Cache::Handle*>(h);
+    cache->Release(handle);
+}
+
+// block cache 的 key: cache_id + 块在文件中的偏移
+static void EncodeCacheKey(uint64_t cache_id, uint64_t offset, char* buf) {
+    EncodeFixed64(buf, cache_id);
+    EncodeFixed64(buf + 8, offset);
+}
+
+// 顺序扫描的迭代器状态，随迭代器一起删除
+struct Table::ScanState {
+    ScanState(Table* t, size_t readahead_size, size_t max_readahead_size)
+            : table(t),
+              prefetch(t->rep_->file, readahead_size, max_readahead_size) {}
+
+    Table* const table;
+    FilePrefetchBuffer prefetch;
+};
+
+static void DeleteScanState(void* arg, void* ignored) {
+    delete reinterpret_cast<Table::ScanState*>(arg);
+}
+
+// 自动调整的限速器根据前台读取的延迟调整后台速率，这里返回需要报告延迟的限速器
+// 只统计会填充 block cache 的读取，compaction 的输入用 fill_cache = false 读取，不计入
+static RateLimiter* ForegroundLatencySink(const Options& table_options,
+                                          const ReadOptions& options) {
+    RateLimiter* limiter = table_options.rate_limiter;
+    if (limiter != nullptr && options.fill_cache && limiter->IsAutoTuned()) {
+        return limiter;
+    }
+    return nullptr;
+}
+
+// 读取一个块，prefetch 非空时优先从预读缓冲区中读
+static Status ReadBlockWithPrefetch(RandomAccessFile* file,
+                                    const Options& table_options,
+                                    const ReadOptions& options,
+                                    const BlockHandle& handle,
+                                    BlockContents* contents,
+                                    const CompressionDict* dict,
+                                    FilePrefetchBuffer* prefetch) {
+    Slice data;
+    Status s;
+    if (prefetch != nullptr &&
+        prefetch->TryRead(handle.offset(), handle.size() + kBlockTrailerSize,
+                          &data, &s)) {
+        if (!s.ok()) {
+            return s;
+        }
+        return DecodeBlock(data.data(), options, handle, contents, dict);
+    }
+    RateLimiter* latency_sink =
+            prefetch == nullptr ? ForegroundLatencySink(table_options, options)
+                                : nullptr;
+    if (latency_sink == nullptr) {
+        return ReadBlock(file, options, handle, contents, dict);
+    }
+    const uint64_t start = table_options.env->NowMicros();
+    s = ReadBlock(file, options, handle, contents, dict);
+    latency_sink->ReportForegroundLatency(table_options.env->NowMicros() - start);
+    return s;
+}
+
+Iterator* Table::BlockReader(void* arg, const ReadOptions& options,
+                             const Slice& index_value) {
+    return reinterpret_cast<Table*>(arg)->ReadBlockIterator(options, index_value,
+                                                            nullptr);
+}
+
+Iterator* Table::ScanBlockReader(void* arg, const ReadOptions& options,
+                                 const Slice& index_value) {
+    ScanState* state = reinterpret_cast<ScanState*>(arg);
+    return state->table->ReadBlockIterator(options, index_value, &state->prefetch);
+}
+
+// 把一个 index value(即 BlockHandle 编码)转换成对应块的迭代器
+// 数据块和索引分区都通过这里读取，所以都会进入 block cache
+Iterator* Table::ReadBlockIterator(const ReadOptions& options,
+                                   const Slice& index_value,
+                                   FilePrefetchBuffer* prefetch) {
+    Table* table = this;
+    Cache* block_cache = table->rep_->options.block_cache;
+    Block* block = nullptr;
+    Cache::Handle* cache_handle = nullptr;
+
+    BlockHandle handle;
+    Slice input = index_value;
+    Status s = handle.DecodeFrom(&input);
+    // We intentionally allow extra stuff in index_value so that we
+    // can add more features in the future.
+
+    if (s.ok()) {
+        BlockContents contents;
+        if (block_cache != nullptr) {
+            char cache_key_buffer[16];
+            EncodeCacheKey(table->rep_->cache_id, handle.offset(), cache_key_buffer);
+            Slice key(cache_key_buffer, sizeof(cache_key_buffer));
+            cache_handle = block_cache->Lookup(key);
+            if (cache_handle != nullptr) {
+                block = reinterpret_cast<Block*>(block_cache->Value(cache_handle));
+            } else {
+                s = ReadBlockWithPrefetch(table->rep_->file, table->rep_->options,
+                                          options, handle, &contents,
+                                          table->rep_->dict, prefetch);
+                if (s.ok()) {
+                    block = new Block(contents);
+                    if (contents.cachable && options.fill_cache) {
+                        cache_handle = block_cache->Insert(key, block, block->size(),
+                                                           &DeleteCachedBlock);
+                    }
+                }
+            }
+        } else {
+            s = ReadBlockWithPrefetch(table->rep_->file, table->rep_->options,
+                                      options, handle, &contents,
+                                      table->rep_->dict, prefetch);
+            if (s.ok()) {
+                block = new Block(contents);
+            }
+        }
+    }
+
+    Iterator* iter;
+    if (block != nullptr) {
+        iter = block->NewIterator(table->rep_->options.comparator);
+        if (cache_handle == nullptr) {
+            iter->RegisterCleanup(&DeleteBlock, block, nullptr);
+        } else {
+            iter->RegisterCleanup(&ReleaseBlock, block_cache, cache_handle);
+        }
+    } else {
+        iter = NewErrorIterator(s);
+    }
+    return iter;
+}
+
+Iterator* Table::NewIndexIterator(const ReadOptions& options) const {
+    Iterator* top = rep_->index_block->NewIterator(rep_->options.comparator);
+    if (!rep_->partitioned_index) {
+        return top;
+    }
+    return NewTwoLevelIterator(top, &Table::BlockReader,
+                               const_cast<Table*>(this), options);
+}
+
+Iterator* Table::NewIterator(const ReadOptions& options) const {
+    Iterator* iter;
+    if (options.readahead_size == 0 && rep_->options.max_readahead_size == 0) {
+        iter = NewTwoLevelIterator(NewIndexIterator(options), &Table::BlockReader,
+                                   const_cast<Table*>(this), options);
+    } else {
+        // 数据块经过预读缓冲区读取，索引分区仍然直接读
+        ScanState* state = new ScanState(const_cast<Table*>(this),
+                                         options.readahead_size,
+                                         rep_->options.max_readahead_size);
+        iter = NewTwoLevelIterator(NewIndexIterator(options),
+                                   &Table::ScanBlockReader, state, options);
+        iter->RegisterCleanup(&DeleteScanState, state, nullptr);
+    }
+    if (rep_->options.prefix_extractor != nullptr && !options.total_order_seek) {
+        iter = NewPrefixSeekIterator(iter, rep_->options.prefix_extractor,
+                                     &Table::PrefixMayMatch,
+                                     const_cast<Table*>(this), options);
+    }
+    return iter;
+}
+
+bool Table::IsPartitionedIndex() const { return rep_->partitioned_index; }
+
+namespace {
+
+// 缓存中的过滤器分区
+struct FilterPartition {
+    Slice data;
+    bool heap_allocated;
+};
+
+void DeleteFilterPartition(const Slice& key, void* value) {
+    FilterPartition* partition = reinterpret_cast<FilterPartition*>(value);
+    if (partition->heap_allocated) {
+        delete[] partition->data.data();
+    }
+    delete partition;
+}
+
+} // namespace
+
+// 分区过滤器的查找状态。有序地查找多个 key 时，顶层过滤器索引的迭代器和
+// 最近用到的过滤器分区都可以复用，落在同一个分区的 key 只需要读取一次分区
+struct Table::FilterCursor {
+    FilterCursor() : index_iter(nullptr), offset(0), partition(nullptr),
+                     cache(nullptr), cache_handle(nullptr) {}
+
+    ~FilterCursor() { ReleasePartition(); delete index_iter; }
+
+    void ReleasePartition() {
+        if (cache_handle != nullptr) {
+            cache->Release(cache_handle);
+        } else if (partition != nullptr) {
+            DeleteFilterPartition(Slice(), partition);
+        }
+        partition = nullptr;
+        cache_handle = nullptr;
+    }
+
+    Iterator* index_iter;
+    uint64_t offset;  // partition 在文件中的偏移
+    FilterPartition* partition;
+    Cache* cache;
+    Cache::Handle* cache_handle;
+};
+
+bool Table::KeyMayMatch(const ReadOptions& options, const Slice& key,
+                        const Slice& handle_value, FilterCursor* cursor) {
+    if (rep_->filter == nullptr && rep_->filter_index == nullptr) {
+        return true;
+    }
+    bool may_match;
+    const SliceTransform* prefix_extractor = rep_->prefix_extractor;
+    if (rep_->whole_key_filtering) {
+        may_match = FilterMayMatch(options, key, key, handle_value, cursor);
+    } else if (prefix_extractor != nullptr && prefix_extractor->InDomain(key)) {
+        // 过滤器中只有前缀
+        may_match = FilterMayMatch(options, key, prefix_extractor->Transform(key),
+                                   handle_value, cursor);
+    } else {
+        return true;
+    }
+    RecordTick(rep_->options.statistics, may_match ? BLOOM_FILTER_POSITIVE : BLOOM_FILTER_USEFUL);
+    return may_match;
+}
+
+bool Table::PrefixMayMatch(void* arg, const ReadOptions& options,
+                           const Slice& target) {
+    Table* table = reinterpret_cast<Table*>(arg);
+    const SliceTransform* prefix_extractor = table->rep_->prefix_extractor;
+    if (prefix_extractor == nullptr) {
+        return true;
+    }
+
+    // 前缀相同的 key 是连续的，其中 >= target 的部分从 target 所在的数据块开始。
+    // 该块不包含这个前缀时，它的最后一个 key(>= target)的前缀已经大于 target 的前缀，
+    // 之后的块更不会有。所以只需要检查这一个块的过滤器
+    Iterator* iiter = table->NewIndexIterator(options);
+    iiter->Seek(target);
+    bool may_match;
+    if (iiter->Valid()) {
+        FilterCursor cursor;
+        may_match = table->FilterMayMatch(options, target,
+                                          prefix_extractor->Transform(target),
+                                          iiter->value(), &cursor);
+    } else {
+        // 所有 key 都小于 target，出错时保守地认为可能存在
+        may_match = !iiter->status().ok();
+    }
+    delete iiter;
+    return may_match;
+}
+
+bool Table::FilterMayMatch(const ReadOptions& options, const Slice& key,
+                           const Slice& filter_key, const Slice& handle_value,
+                           FilterCursor* cursor) {
+    if (rep_->filter != nullptr) {
+        BlockHandle handle;
+        Slice input = handle_value;
+        return !handle.DecodeFrom(&input).ok() ||
+               rep_->filter->KeyMayMatch(handle.offset(), filter_key);
+    }
+    if (rep_->filter_index == nullptr) {
+        return true;
+    }
+
+    // 过滤器分区与索引分区的边界相同，在顶层过滤器索引中找到 key 所在的分区
+    if (cursor->index_iter == nullptr) {
+        cursor->index_iter = rep_->filter_index->NewIterator(rep_->options.comparator);
+    }
+    Iterator* iter = cursor->index_iter;
+    iter->Seek(key);
+    BlockHandle handle;
+    if (!iter->Valid()) {
+        // key 在所有分区之后，交给数据块去判断
+        return true;
+    }
+    Slice input = iter->value();
+    if (!handle.DecodeFrom(&input).ok()) {
+        return true;
+    }
+
+    if (cursor->partition == nullptr || cursor->offset != handle.offset()) {
+        cursor->ReleasePartition();
+        Cache* block_cache = rep_->options.block_cache;
+        char cache_key_buffer[16];
+        EncodeCacheKey(rep_->cache_id, handle.offset(), cache_key_buffer);
+        Slice cache_key(cache_key_buffer, sizeof(cache_key_buffer));
+        Cache::Handle* cache_handle = nullptr;
+        if (block_cache != nullptr) {
+            cache_handle = block_cache->Lookup(cache_key);
+        }
+
+        FilterPartition* partition = nullptr;
+        if (cache_handle != nullptr) {
+            partition = reinterpret_cast<FilterPartition*>(block_cache->Value(cache_handle));
+        } else {
+            BlockContents contents;
+            if (!ReadBlock(rep_->file, options, handle, &contents).ok()) {
+                return true;  // Errors are treated as potential matches
+            }
+            partition = new FilterPartition;
+            partition->data = contents.data;
+            partition->heap_allocated = contents.heap_allocated;
+            if (block_cache != nullptr && contents.cachable && options.fill_cache) {
+                cache_handle = block_cache->Insert(cache_key, partition,
+                                                   contents.data.size(),
+                                                   &DeleteFilterPartition);
+            }
+        }
+        cursor->offset = handle.offset();
+        cursor->partition = partition;
+        cursor->cache = block_cache;
+        cursor->cache_handle = cache_handle;
+    }
+
+    return rep_->options.filter_policy->KeyMayMatch(filter_key,
+                                                    cursor->partition->data);
+}
+
+Status Table::InternalGet(const ReadOptions& options, const Slice& k, void* arg,
+                          void (*handle_result)(void*, const Slice&,
+                                                const Slice&)) {
+    Status s;
+    Iterator* iiter = NewIndexIterator(options);
+    iiter->Seek(k);
+    if (iiter->Valid()) {
+        Slice handle_value = iiter->value();
+        FilterCursor cursor;
+        if (!KeyMayMatch(options, k, handle_value, &cursor)) {
+            // Not found
+        } else {
+            Iterator* block_iter = BlockReader(this, options, iiter->value());
+            block_iter->Seek(k);
+            if (block_iter->Valid()) {
+                (*handle_result)(arg, block_iter->key(), block_iter->value());
+            }
+            s = block_iter->status();
+            delete block_iter;
+        }
+    }
+    if (s.ok()) {
+        s = iiter->status();
+    }
+    delete iiter;
+    return s;
+}
+
+namespace {
+
+// 一次读取合并的相邻块之间最多允许的空洞字节数
+const uint64_t kMaxCoalesceGap = 16 * 1024;
+
+// 一次合并读取的最大字节数
+const uint64_t kMaxCoalesceBytes = 512 * 1024;
+
+// MultiGet 中落在同一个数据块的一组 key
+struct BlockRequest {
+    BlockHandle handle;
+    std::vector<int> keys;  // 下标，按 key 有序
+    Block* block = nullptr;
+    Cache::Handle* cache_handle = nullptr;
+};
+
+} // namespace
+
+Status Table::InternalMultiGet(const ReadOptions& options, const Slice* keys,
+                               int n, void* arg,
+                               void (*handle_result)(void*, int, const Slice&,
+                                                     const Slice&)) {
+    const Comparator* comparator = rep_->options.comparator;
+    std::vector<int> order(n);
+    for (int i = 0; i < n; i++) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+        return comparator->Compare(keys[a], keys[b]) < 0;
+    });
+
+    // 1. 按顺序在索引和过滤器中查找，把落在同一个数据块的 key 归到一组
+    Status s;
+    std::vector<BlockRequest> requests;
+    {
+        Iterator* iiter = NewIndexIterator(options);
+        FilterCursor cursor;
+        for (int j = 0; j < n; j++) {
+            const int i = order[j];
+            iiter->Seek(keys[i]);
+            if (!iiter->Valid()) {
+                // 剩下的 key 都在 table 的最后一个 key 之后
+                break;
+            }
+            Slice handle_value = iiter->value();
+            if (!KeyMayMatch(options, keys[i], handle_value, &cursor)) {
+                continue;
+            }
+            BlockHandle handle;
+            s = handle.DecodeFrom(&handle_value);
+            if (!s.ok()) {
+                break;
+            }
+            if (requests.empty() ||
+                requests.back().handle.offset() != handle.offset()) {
+                requests.emplace_back();
+                requests.back().handle = handle;
+            }
+            requests.back().keys.push_back(i);
+        }
+        if (s.ok()) {
+            s = iiter->status();
+        }
+        delete iiter;
+    }
+
+    // 2. 先查 block cache
+    Cache* block_cache = rep_->options.block_cache;
+    std::vector<size_t> misses;
+    for (size_t r = 0; r < requests.size(); r++) {
+        BlockRequest& req = requests[r];
+        if (block_cache != nullptr) {
+            char cache_key_buffer[16];
+            EncodeCacheKey(rep_->cache_id, req.handle.offset(), cache_key_buffer);
+            req.cache_handle = block_cache->Lookup(
+                    Slice(cache_key_buffer, sizeof(cache_key_buffer)));
+            if (req.cache_handle != nullptr) {
+                req.block = reinterpret_cast<Block*>(block_cache->Value(req.cache_handle));
+                continue;
+            }
+        }
+        misses.push_back(r);
+    }
+
+    // 3. 没有命中的块按偏移有序，相邻或间隔很小的块合并成一次读取
+    std::string scratch;
+    for (size_t m = 0; m < misses.size() && s.ok();) {
+        const uint64_t start = requests[misses[m]].handle.offset();
+        uint64_t end = start + requests[misses[m]].handle.size() + kBlockTrailerSize;
+        size_t last = m + 1;
+        while (last < misses.size()) {
+            const BlockHandle& next = requests[misses[last]].handle;
+            const uint64_t next_end = next.offset() + next.size() + kBlockTrailerSize;
+            if (next.offset() > end + kMaxCoalesceGap ||
+                next_end - start > kMaxCoalesceBytes) {
+                break;
+            }
+            end = next_end;
+            last++;
+        }
+
+        scratch.resize(end - start);
+        Slice contents;
+        RateLimiter* latency_sink = ForegroundLatencySink(rep_->options, options);
+        const uint64_t read_start =
+                latency_sink != nullptr ? rep_->options.env->NowMicros() : 0;
+        s = rep_->file->Read(start, end - start, &contents, &scratch[0]);
+        if (latency_sink != nullptr) {
+            latency_sink->ReportForegroundLatency(rep_->options.env->NowMicros() -
+                                                  read_start);
+        }
+        if (s.ok() && contents.size() != end - start) {
+            s = Status::Corruption("truncated block read");
+        }
+        for (; m < last && s.ok(); m++) {
+            BlockRequest& req = requests[misses[m]];
+            BlockContents block_contents;
+            s = DecodeBlock(contents.data() + (req.handle.offset() - start), options,
+                            req.handle, &block_contents, rep_->dict);
+            if (!s.ok()) {
+                break;
+            }
+            req.block = new Block(block_contents);
+            if (block_cache != nullptr && options.fill_cache) {
+                char cache_key_buffer[16];
+                EncodeCacheKey(rep_->cache_id, req.handle.offset(), cache_key_buffer);
+                req.cache_handle = block_cache->Insert(
+                        Slice(cache_key_buffer, sizeof(cache_key_buffer)), req.block,
+                        req.block->size(), &DeleteCachedBlock);
+            }
+        }
+    }
+
+    // 4. 在每个数据块中依次查找该组的 key，组内有序，块迭代器可以利用当前位置缩小查找范围
+    for (size_t r = 0; r < requests.size(); r++) {
+        BlockRequest& req = requests[r];
+        if (req.block != nullptr && s.ok()) {
+            Iterator* block_iter = req.block->NewIterator(comparator);
+            for (size_t k = 0; k < req.keys.size(); k++) {
+                const int i = req.keys[k];
+                block_iter->Seek(keys[i]);
+                if (block_iter->Valid()) {
+                    (*handle_result)(arg, i, block_iter->key(), block_iter->value());
+                }
+            }
+            s = block_iter->status();
+            delete block_iter;
+        }
+        if (req.cache_handle != nullptr) {
+            block_cache->Release(req.cache_handle);
+        } else {
+            delete req.block;
+        }
+    }
+    return s;
+}
+
+uint64_t Table::ApproximateOffsetOf(const Slice& key) const {
+    ReadOptions options;
+    options.fill_cache = false;
+    Iterator* index_iter = NewIndexIterator(options);
+    index_iter->Seek(key);
+    uint64_t result;
+    if (index_iter->Valid()) {
+        BlockHandle handle;
+        Slice input = index_iter->value();
+        Status s = handle.DecodeFrom(&input);
+        if (s.ok()) {
+            result = handle.offset();
+        } else {
+            // Strange: we can't decode the block handle in the index block.
+            // We'll just return the offset of the metaindex block, which is
+            // close to the whole file size for this case.
+            result = rep_->metaindex_handle.offset();
+        }
+    } else {
+        // key is past the last key in the file.  Approximate the offset
+        // by returning the offset of the metaindex block (which is
+        // right near the end of the file).
+        result = rep_->metaindex_handle.offset();
+    }
+    delete index_iter;
+    return result;
+}
+
+} // namespace tinydb
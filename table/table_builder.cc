@@ -0,0 +1,575 @@
+/*
+ * table 文件格式：
+ *     [data block 1]
+ *     ...
+ *     [data block N]
+ *     [filter block 或 filter 分区 + 顶层 filter 索引]
+ *     [index 分区(仅分区索引)]
+ *     [compression dict block(可选)]
+ *     [range tombstone block(可选)]
+ *     [metaindex block]
+ *     [index block 或顶层 index]
+ *     [footer]
+ *
+ * 分区索引时，索引按 block_size 切成多个分区，footer 中的 index handle 指向顶层索引，
+ * 顶层索引的 key 是各分区的最后一个 key，value 是分区的 BlockHandle
+ * 分区过滤器与索引分区一一对应，顶层 filter 索引与顶层索引的 key 相同
+ * metaindex 中的 "tinydb.IndexType" 记录索引类型
+ * 设置了 prefix_extractor 时，key 的前缀也加入过滤器，"tinydb.PrefixExtractor" 记录变换的名字
+ * range tombstone 单独存放在一个不压缩的块中，"tinydb.RangeDel" 记录它的位置
+ */
+
+#include "tinydb/table_builder.h"
+
+#include <cassert>
+#include <string>
+#include <vector>
+
+#include "table/block.h"
+#include "table/block_builder.h"
+#include "table/filter_block.h"
+#include "table/format.h"
+#include "tinydb/comparator.h"
+#include "tinydb/env.h"
+#include "tinydb/filter_policy.h"
+#include "tinydb/slice_transform.h"
+#include "util/coding.h"
+#include "util/compression.h"
+#include "util/compression_dict.h"
+#include "util/crc32c.h"
+
+namespace tinydb {
+
+namespace {
+
+// 字典是否启用取决于该层实际使用的压缩算法
+Options DictOptions(const Options& options, int level) {
+    Options opt = options;
+    opt.compression = CompressionTypeForLevel(options, level);
+    return opt;
+}
+
+} // namespace
+
+struct TableBuilder::Rep {
+    Rep(const Options& opt, WritableFile* f, int lvl, CompressionStats* st)
+            : options(opt),
+              index_block_options(opt),
+              file(f),
+              offset(0),
+              data_block(&options),
+              index_block(&index_block_options),
+              num_entries(0),
+              closed(false),
+              range_del_block(&index_block_options),
+              num_range_deletions(0),
+              partition_index(opt.partition_index),
+              filter_block(nullptr),
+              partition_filter(nullptr),
+              level(lvl),
+              stats(st),
+              dict_builder(DictOptions(opt, lvl)),
+              dict(nullptr),
+              buffering(dict_builder.enabled()),
+              buffered_bytes(0),
+              last_prefix_valid(false),
+              pending_index_entry(false) {
+        index_block_options.block_restart_interval = 1;
+        if (opt.filter_policy != nullptr) {
+            if (partition_index && opt.partition_filters) {
+                partition_filter = new PartitionedFilterBuilder(opt.filter_policy);
+            } else {
+                filter_block = new FilterBlockBuilder(opt.filter_policy);
+            }
+        }
+    }
+
+    ~Rep() {
+        delete filter_block;
+        delete partition_filter;
+        delete dict;
+    }
+
+    Options options;
+    Options index_block_options;
+    WritableFile* file;
+    uint64_t offset;
+    Status status;
+    BlockBuilder data_block;
+    // 不分区时是整个索引块，分区时是正在构建的索引分区
+    BlockBuilder index_block;
+    std::string last_key;
+    int64_t num_entries;
+    bool closed;  // Either Finish() or Abandon() has been called.
+
+    BlockBuilder range_del_block;
+    std::string last_range_del_key;
+    int64_t num_range_deletions;
+
+    const bool partition_index;
+    // 已完成的索引分区：(分区最后一个 key, 分区内容)，Finish() 时统一写入
+    std::vector<std::pair<std::string, std::string>> index_partitions;
+    // 当前索引分区中最后一个 key
+    std::string last_index_key;
+
+    FilterBlockBuilder* filter_block;
+    PartitionedFilterBuilder* partition_filter;
+    // 与 index_partitions 一一对应
+    std::vector<std::string> filter_partitions;
+
+    const int level;
+    CompressionStats* const stats;
+
+    // 启用字典时，字典训练出来之前的数据块先以原始内容缓存在 buffered_blocks 中，
+    // 训练完成后再压缩写入，并补上这些块的过滤器和索引项
+    CompressionDictBuilder dict_builder;
+    CompressionDict* dict;
+    bool buffering;
+    std::vector<std::string> buffered_blocks;
+    // buffered_blocks 不压缩写入时的大小(包括块尾)，计入 FileSize()
+    uint64_t buffered_bytes;
+
+    // 当前数据块中最后加入过滤器的前缀，同一个块内连续相同的前缀只加入一次
+    std::string last_prefix;
+    bool last_prefix_valid;
+
+    // 数据块写完之后，要等看到下一个块的第一个 key 才添加索引项，
+    // 这样可以用更短的分隔 key。例如块的边界 key 是 "the quick brown fox" 和
+    // "the who"，索引项可以用 "the r"
+    //
+    // Invariant: r->pending_index_entry is true only if data_block is empty.
+    bool pending_index_entry;
+    BlockHandle pending_handle;  // Handle to add to index block
+
+    std::string compressed_output;
+};
+
+TableBuilder::TableBuilder(const Options& options, WritableFile* file)
+        : rep_(new Rep(options, file, 0, nullptr)) {
+    if (rep_->filter_block != nullptr) {
+        rep_->filter_block->StartBlock(0);
+    }
+}
+
+TableBuilder::TableBuilder(const Options& options, WritableFile* file, int level,
+                           CompressionStats* stats)
+        : rep_(new Rep(options, file, level, stats)) {
+    if (rep_->filter_block != nullptr) {
+        rep_->filter_block->StartBlock(0);
+    }
+}
+
+TableBuilder::~TableBuilder() {
+    assert(rep_->closed);  // Catch errors where caller forgot to call Finish()
+    delete rep_;
+}
+
+Status TableBuilder::ChangeOptions(const Options& options) {
+    // 影响文件格式的选项不能在构建过程中修改
+    if (options.comparator != rep_->options.comparator) {
+        return Status::InvalidArgument("changing comparator while building table");
+    }
+    if (options.filter_policy != rep_->options.filter_policy ||
+        options.partition_index != rep_->options.partition_index ||
+        options.partition_filters != rep_->options.partition_filters ||
+        options.prefix_extractor != rep_->options.prefix_extractor ||
+        options.whole_key_filtering != rep_->options.whole_key_filtering) {
+        return Status::InvalidArgument("changing table format while building table");
+    }
+
+    // Note that any live BlockBuilders point to rep_->options and therefore
+    // will automatically pick up the updated options.
+    rep_->options = options;
+    rep_->index_block_options = options;
+    rep_->index_block_options.block_restart_interval = 1;
+    return Status::OK();
+}
+
+void TableBuilder::Add(const Slice& key, const Slice& value) {
+    Rep* r = rep_;
+    assert(!r->closed);
+    if (!ok()) return;
+    if (r->num_entries > 0) {
+        assert(r->options.comparator->Compare(key, Slice(r->last_key)) > 0);
+    }
+
+    if (r->buffering && r->dict_builder.full()) {
+        assert(r->data_block.empty());
+        FlushBufferedBlocks(&key);
+    }
+
+    if (r->pending_index_entry) {
+        assert(r->data_block.empty());
+        AddIndexEntry(r->last_key, &key, r->pending_handle);
+        r->pending_index_entry = false;
+    }
+
+    if (!r->buffering) {
+        AddKeyToFilter(key);
+    }
+
+    r->last_key.assign(key.data(), key.size());
+    r->num_entries++;
+    r->data_block.Add(key, value);
+
+    const size_t estimated_block_size = r->data_block.CurrentSizeEstimate();
+    if (estimated_block_size >= r->options.block_size) {
+        Flush();
+    }
+}
+
+void TableBuilder::AddRangeTombstone(const Slice& key, const Slice& value) {
+    Rep* r = rep_;
+    assert(!r->closed);
+    if (!ok()) return;
+    if (r->num_range_deletions > 0) {
+        assert(r->options.comparator->Compare(key, Slice(r->last_range_del_key)) > 0);
+    }
+    r->last_range_del_key.assign(key.data(), key.size());
+    r->num_range_deletions++;
+    r->range_del_block.Add(key, value);
+}
+
+void TableBuilder::Flush() {
+    Rep* r = rep_;
+    assert(!r->closed);
+    if (!ok()) return;
+    if (r->data_block.empty()) return;
+    assert(!r->pending_index_entry);
+    if (r->buffering) {
+        Slice raw = r->data_block.Finish();
+        r->dict_builder.AddSample(raw);
+        r->buffered_blocks.push_back(raw.ToString());
+        r->buffered_bytes += raw.size() + kBlockTrailerSize;
+        r->data_block.Reset();
+        return;
+    }
+    WriteBlock(&r->data_block, &r->pending_handle);
+    if (ok()) {
+        r->pending_index_entry = true;
+        r->status = r->file->Flush();
+    }
+    if (r->filter_block != nullptr) {
+        r->filter_block->StartBlock(r->offset);
+    }
+    r->last_prefix_valid = false;
+}
+
+/*
+ * 前缀 seek 只检查 target 所在数据块的过滤器，所以每个包含某前缀的数据块都要
+ * 把该前缀加入过滤器，去重只在块内进行
+ */
+void TableBuilder::AddKeyToFilter(const Slice& key) {
+    Rep* r = rep_;
+    if (r->filter_block == nullptr && r->partition_filter == nullptr) {
+        return;
+    }
+    const SliceTransform* prefix_extractor = r->options.prefix_extractor;
+    if (prefix_extractor != nullptr && prefix_extractor->InDomain(key)) {
+        Slice prefix = prefix_extractor->Transform(key);
+        if (!r->last_prefix_valid || prefix != Slice(r->last_prefix)) {
+            AddFilterEntry(prefix);
+            r->last_prefix.assign(prefix.data(), prefix.size());
+            r->last_prefix_valid = true;
+        }
+    }
+    if (prefix_extractor == nullptr || r->options.whole_key_filtering) {
+        AddFilterEntry(key);
+    }
+}
+
+void TableBuilder::AddFilterEntry(const Slice& entry) {
+    Rep* r = rep_;
+    if (r->filter_block != nullptr) {
+        r->filter_block->AddKey(entry);
+    } else {
+        r->partition_filter->AddKey(entry);
+    }
+}
+
+void TableBuilder::AddIndexEntry(const Slice& last_key, const Slice* next_key,
+                                 const BlockHandle& handle) {
+    Rep* r = rep_;
+    std::string separator = last_key.ToString();
+    if (next_key != nullptr) {
+        r->options.comparator->FindShortestSeparator(&separator, *next_key);
+    } else {
+        r->options.comparator->FindShortSuccessor(&separator);
+    }
+    std::string handle_encoding;
+    handle.EncodeTo(&handle_encoding);
+    r->index_block.Add(separator, Slice(handle_encoding));
+
+    if (r->partition_index) {
+        r->last_index_key.swap(separator);
+        if (r->index_block.CurrentSizeEstimate() >= r->options.block_size) {
+            FinishIndexPartition();
+        }
+    }
+}
+
+void TableBuilder::FinishIndexPartition() {
+    Rep* r = rep_;
+    if (r->index_block.empty()) {
+        return;
+    }
+    r->index_partitions.emplace_back(r->last_index_key,
+                                     r->index_block.Finish().ToString());
+    r->index_block.Reset();
+    if (r->partition_filter != nullptr) {
+        // 分区边界上的 key 都已经加入过滤器，下一个 key 属于下一个分区
+        r->filter_partitions.push_back(r->partition_filter->FinishPartition().ToString());
+    }
+}
+
+void TableBuilder::FlushBufferedBlocks(const Slice* next_key) {
+    Rep* r = rep_;
+    assert(r->buffering);
+    r->buffering = false;
+
+    std::string dict;
+    if (r->dict_builder.Finish(&dict)) {
+        r->dict = new CompressionDict(dict, CompressionLevelForLevel(r->options, r->level));
+    }
+
+    // 重放缓存的数据块：写入文件，并把其中的 key 加入过滤器和索引
+    std::string block_last_key;
+    std::string next_first_key;
+    for (size_t i = 0; i < r->buffered_blocks.size() && ok(); i++) {
+        const std::string& raw = r->buffered_blocks[i];
+        BlockContents contents;
+        contents.data = Slice(raw);
+        contents.cachable = false;
+        contents.heap_allocated = false;
+        Block block(contents);
+        Iterator* iter = block.NewIterator(r->options.comparator);
+        for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+            AddKeyToFilter(iter->key());
+            block_last_key.assign(iter->key().data(), iter->key().size());
+        }
+        delete iter;
+        r->last_prefix_valid = false;
+
+        BlockHandle handle;
+        WriteBlockContents(Slice(raw), &handle);
+        if (!ok()) {
+            break;
+        }
+        if (r->filter_block != nullptr) {
+            r->filter_block->StartBlock(r->offset);
+        }
+
+        if (i + 1 < r->buffered_blocks.size()) {
+            BlockContents next_contents;
+            next_contents.data = Slice(r->buffered_blocks[i + 1]);
+            next_contents.cachable = false;
+            next_contents.heap_allocated = false;
+            Block next_block(next_contents);
+            Iterator* next_iter = next_block.NewIterator(r->options.comparator);
+            next_iter->SeekToFirst();
+            assert(next_iter->Valid());
+            next_first_key.assign(next_iter->key().data(), next_iter->key().size());
+            delete next_iter;
+            Slice next(next_first_key);
+            AddIndexEntry(block_last_key, &next, handle);
+        } else if (next_key != nullptr) {
+            AddIndexEntry(block_last_key, next_key, handle);
+        } else {
+            // 最后一个块，索引项留到 Finish() 中添加
+            r->pending_handle = handle;
+            r->pending_index_entry = true;
+        }
+    }
+    if (ok()) {
+        r->status = r->file->Flush();
+    }
+    std::vector<std::string>().swap(r->buffered_blocks);
+    r->buffered_bytes = 0;
+}
+
+void TableBuilder::WriteBlock(BlockBuilder* block, BlockHandle* handle) {
+    WriteBlockContents(block->Finish(), handle);
+    block->Reset();
+}
+
+void TableBuilder::WriteBlockContents(const Slice& raw, BlockHandle* handle) {
+    // File format contains a sequence of blocks where each block has:
+    //    block_data: uint8[n]
+    //    type: uint8
+    //    crc: uint32
+    assert(ok());
+    Rep* r = rep_;
+    const CompressionType type =
+            CompressBlock(r->options, r->level, raw, r->dict,
+                          &r->compressed_output, r->stats);
+    if (type == kNoCompression) {
+        WriteRawBlock(raw, kNoCompression, handle);
+    } else {
+        WriteRawBlock(Slice(r->compressed_output), type, handle);
+    }
+    r->compressed_output.clear();
+}
+
+void TableBuilder::WriteRawBlock(const Slice& block_contents,
+                                 CompressionType type, BlockHandle* handle) {
+    Rep* r = rep_;
+    handle->set_offset(r->offset);
+    handle->set_size(block_contents.size());
+    r->status = r->file->Append(block_contents);
+    if (r->status.ok()) {
+        char trailer[kBlockTrailerSize];
+        trailer[0] = type;
+        uint32_t crc = crc32c::Value(block_contents.data(), block_contents.size());
+        crc = crc32c::Extend(crc, trailer, 1);  // Extend crc to cover block type
+        EncodeFixed32(trailer + 1, crc32c::Mask(crc));
+        r->status = r->file->Append(Slice(trailer, kBlockTrailerSize));
+        if (r->status.ok()) {
+            r->offset += block_contents.size() + kBlockTrailerSize;
+        }
+    }
+}
+
+Status TableBuilder::status() const { return rep_->status; }
+
+Status TableBuilder::Finish() {
+    Rep* r = rep_;
+    Flush();
+    if (ok() && r->buffering) {
+        FlushBufferedBlocks(nullptr);
+    }
+    assert(!r->closed);
+    r->closed = true;
+
+    BlockHandle filter_block_handle, dict_block_handle, range_del_block_handle,
+            metaindex_block_handle, index_block_handle;
+
+    // 最后一个数据块的索引项
+    if (ok() && r->pending_index_entry) {
+        AddIndexEntry(r->last_key, nullptr, r->pending_handle);
+        r->pending_index_entry = false;
+    }
+    if (ok() && r->partition_index) {
+        FinishIndexPartition();
+    }
+
+    // Write filter block
+    if (ok() && r->filter_block != nullptr) {
+        WriteRawBlock(r->filter_block->Finish(), kNoCompression,
+                      &filter_block_handle);
+    } else if (ok() && r->partition_filter != nullptr) {
+        BlockBuilder filter_index(&r->index_block_options);
+        std::string handle_encoding;
+        for (size_t i = 0; i < r->filter_partitions.size() && ok(); i++) {
+            BlockHandle handle;
+            WriteRawBlock(Slice(r->filter_partitions[i]), kNoCompression, &handle);
+            handle_encoding.clear();
+            handle.EncodeTo(&handle_encoding);
+            filter_index.Add(r->index_partitions[i].first, Slice(handle_encoding));
+        }
+        if (ok()) {
+            WriteRawBlock(filter_index.Finish(), kNoCompression, &filter_block_handle);
+        }
+    }
+
+    // 写入索引分区，生成顶层索引
+    BlockBuilder top_level_index(&r->index_block_options);
+    if (ok() && r->partition_index) {
+        std::string handle_encoding;
+        for (size_t i = 0; i < r->index_partitions.size() && ok(); i++) {
+            BlockHandle handle;
+            WriteRawBlock(Slice(r->index_partitions[i].second), kNoCompression, &handle);
+            handle_encoding.clear();
+            handle.EncodeTo(&handle_encoding);
+            top_level_index.Add(r->index_partitions[i].first, Slice(handle_encoding));
+        }
+    }
+
+    // Write compression dictionary block
+    if (ok() && r->dict != nullptr) {
+        WriteRawBlock(r->dict->contents(), kNoCompression, &dict_block_handle);
+    }
+
+    // Write range tombstone block
+    if (ok() && r->num_range_deletions > 0) {
+        WriteRawBlock(r->range_del_block.Finish(), kNoCompression,
+                      &range_del_block_handle);
+    }
+
+    // Write metaindex block
+    if (ok()) {
+        BlockBuilder meta_index_block(&r->options);
+        std::string handle_encoding;
+        if (r->filter_block != nullptr || r->partition_filter != nullptr) {
+            // Add mapping from "filter.Name" to location of filter data
+            std::string key = r->partition_filter != nullptr ? "filter.partitioned."
+                                                             : "filter.";
+            key.append(r->options.filter_policy->Name());
+            filter_block_handle.EncodeTo(&handle_encoding);
+            meta_index_block.Add(key, handle_encoding);
+        }
+        if (r->dict != nullptr) {
+            handle_encoding.clear();
+            dict_block_handle.EncodeTo(&handle_encoding);
+            meta_index_block.Add(kCompressionDictBlockName, handle_encoding);
+        }
+        if (r->partition_index) {
+            std::string index_type;
+            PutVarint32(&index_type, kTwoLevelIndexSearch);
+            meta_index_block.Add(kIndexTypeBlockName, index_type);
+        }
+        if ((r->filter_block != nullptr || r->partition_filter != nullptr) &&
+            r->options.prefix_extractor != nullptr) {
+            std::string prefix_meta;
+            prefix_meta.push_back(r->options.whole_key_filtering ? 1 : 0);
+            prefix_meta.append(r->options.prefix_extractor->Name());
+            meta_index_block.Add(kPrefixExtractorBlockName, prefix_meta);
+        }
+        if (r->num_range_deletions > 0) {
+            handle_encoding.clear();
+            range_del_block_handle.EncodeTo(&handle_encoding);
+            meta_index_block.Add(kRangeDelBlockName, handle_encoding);
+        }
+
+        WriteRawBlock(meta_index_block.Finish(), kNoCompression,
+                      &metaindex_block_handle);
+    }
+
+    // Write index block
+    if (ok()) {
+        BlockBuilder* index =
+                r->partition_index ? &top_level_index : &r->index_block;
+        WriteRawBlock(index->Finish(), kNoCompression, &index_block_handle);
+    }
+
+    // Write footer
+    if (ok()) {
+        Footer footer;
+        footer.set_metaindex_handle(metaindex_block_handle);
+        footer.set_index_handle(index_block_handle);
+        std::string footer_encoding;
+        footer.EncodeTo(&footer_encoding);
+        r->status = r->file->Append(footer_encoding);
+        if (r->status.ok()) {
+            r->offset += footer_encoding.size();
+        }
+    }
+    return r->status;
+}
+
+void TableBuilder::Abandon() {
+    Rep* r = rep_;
+    assert(!r->closed);
+    r->closed = true;
+    // 缓存的数据块不会再写入文件
+    r->buffered_bytes = 0;
+}
+
+uint64_t TableBuilder::NumEntries() const { return rep_->num_entries; }
+
+uint64_t TableBuilder::NumRangeDeletions() const {
+    return rep_->num_range_deletions;
+}
+
+uint64_t TableBuilder::FileSize() const { return rep_->offset + rep_->buffered_bytes; }
+
+} // namespace tinydb
@@ -0,0 +1,437 @@
+#include "tinydb/table.h"
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "tinydb/cache.h"
+#include "tinydb/env.h"
+#include "tinydb/filter_policy.h"
+#include "tinydb/iterator.h"
+#include "tinydb/options.h"
+#include "tinydb/slice_transform.h"
+#include "tinydb/statistics.h"
+#include "tinydb/table_builder.h"
+#include "util/random.h"
+#include "util/testutil.h"
+
+namespace tinydb {
+
+namespace {
+
+std::string Key(int i) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "key%08d", i);
+    return buf;
+}
+
+std::string Value(int i) { return "value" + std::to_string(i); }
+
+// 记录读取次数和字节数
+class CountingFile : public RandomAccessFile {
+public:
+    explicit CountingFile(RandomAccessFile* target) : target_(target), reads_(0), bytes_(0) {}
+
+    Status Read(uint64_t offset, size_t n, Slice* result, char* scratch) const override {
+        reads_++;
+        bytes_ += n;
+        return target_->Read(offset, n, result, scratch);
+    }
+
+    void Reset() { reads_ = bytes_ = 0; }
+    int reads() const { return reads_; }
+    uint64_t bytes() const { return bytes_; }
+
+private:
+    std::unique_ptr<RandomAccessFile> target_;
+    mutable int reads_;
+    mutable uint64_t bytes_;
+};
+
+// MultiGet 的结果，找到的 key 与查找的 key 不同时为 "NOT_FOUND"
+struct MultiGetResults {
+    const std::vector<std::string>* keys;
+    std::vector<std::string> values;
+};
+
+void SaveMultiGetValue(void* arg, int index, const Slice& k, const Slice& v) {
+    MultiGetResults* results = reinterpret_cast<MultiGetResults*>(arg);
+    if (k == Slice((*results->keys)[index])) {
+        results->values[index] = v.ToString();
+    }
+}
+
+void SaveValue(void* arg, const Slice& k, const Slice& v) {
+    std::pair<std::string, std::string>* found =
+            reinterpret_cast<std::pair<std::string, std::string>*>(arg);
+    found->first = k.ToString();
+    found->second = v.ToString();
+}
+
+} // namespace
+
+/*
+ * 写一个包含 Key(0), Key(2), ..., Key(2 * (num - 1)) 的 table 再打开它，奇数 key 都不存在
+ */
+class TableTest : public testing::Test {
+public:
+    TableTest() : env_(Env::Default()), file_(nullptr), table_(nullptr) {
+        fname_ = test::NewTestDirectory("table_test") + "/000001.ldb";
+        options_.block_size = 256;
+    }
+
+    ~TableTest() override { Close(); }
+
+    void Build(int num) {
+        std::vector<std::pair<std::string, std::string>> entries;
+        for (int i = 0; i < num; i++) {
+            entries.emplace_back(Key(2 * i), Value(2 * i));
+        }
+        Build(entries);
+    }
+
+    // 写入按 key 有序的 entries
+    void Build(const std::vector<std::pair<std::string, std::string>>& entries) {
+        Close();
+        WritableFile* file;
+        ASSERT_TRUE(env_->NewWritableFile(fname_, &file).ok());
+        TableBuilder builder(options_, file);
+        for (const auto& entry : entries) {
+            builder.Add(entry.first, entry.second);
+        }
+        ASSERT_TRUE(builder.Finish().ok());
+        ASSERT_TRUE(file->Close().ok());
+        delete file;
+        file_size_ = builder.FileSize();
+    }
+
+    void Open() {
+        Close();
+        RandomAccessFile* rfile;
+        ASSERT_TRUE(env_->NewRandomAccessFile(fname_, &rfile).ok());
+        file_ = new CountingFile(rfile);
+        ASSERT_TRUE(Table::Open(options_, file_, file_size_, &table_).ok());
+    }
+
+    void Close() {
+        delete table_;
+        table_ = nullptr;
+        delete file_;
+        file_ = nullptr;
+    }
+
+    std::string Get(const std::string& key) {
+        std::pair<std::string, std::string> found;
+        Status s = table_->InternalGet(ReadOptions(), key, &found, SaveValue);
+        if (!s.ok()) {
+            return s.ToString();
+        }
+        return found.first == key ? found.second : "NOT_FOUND";
+    }
+
+    // 批量查找，不存在的 key 为 "NOT_FOUND"
+    std::vector<std::string> MultiGet(const std::vector<std::string>& keys,
+                                      const ReadOptions& options = ReadOptions()) {
+        std::vector<Slice> slices(keys.begin(), keys.end());
+        MultiGetResults results;
+        results.keys = &keys;
+        results.values.assign(keys.size(), "NOT_FOUND");
+        Status s = table_->InternalMultiGet(options, slices.data(),
+                                            static_cast<int>(slices.size()), &results,
+                                            SaveMultiGetValue);
+        EXPECT_TRUE(s.ok()) << s.ToString();
+        return results.values;
+    }
+
+    // 顺序遍历并检查所有条目，再检查 Seek
+    void CheckScan(int num, const ReadOptions& options = ReadOptions()) {
+        Iterator* iter = table_->NewIterator(options);
+        int count = 0;
+        for (iter->SeekToFirst(); iter->Valid(); iter->Next(), count++) {
+            EXPECT_EQ(Key(2 * count), iter->key().ToString());
+            EXPECT_EQ(Value(2 * count), iter->value().ToString());
+        }
+        EXPECT_TRUE(iter->status().ok());
+        EXPECT_EQ(num, count);
+
+        // Seek 到不存在的 key 时停在下一个 key 上
+        for (int i = 0; i < 2 * num; i += 37) {
+            iter->Seek(Key(i));
+            ASSERT_TRUE(iter->Valid()) << i;
+            EXPECT_EQ(Key(i % 2 == 0 ? i : i + 1), iter->key().ToString());
+        }
+        iter->Seek(Key(2 * num));
+        EXPECT_FALSE(iter->Valid());
+        delete iter;
+    }
+
+    Env* env_;
+    Options options_;
+    std::string fname_;
+    uint64_t file_size_;
+    CountingFile* file_;
+    Table* table_;
+};
+
+TEST_F(TableTest, PartitionedIndex) {
+    const int kNum = 5000;
+    Build(kNum);
+    Open();
+    EXPECT_FALSE(table_->IsPartitionedIndex());
+    const uint64_t full_index_bytes = file_->bytes();
+
+    options_.partition_index = true;
+    std::unique_ptr<Cache> cache(NewLRUCache(1 << 20));
+    options_.block_cache = cache.get();
+    Build(kNum);
+    Open();
+    EXPECT_TRUE(table_->IsPartitionedIndex());
+    // 打开时只读顶层索引
+    EXPECT_LT(file_->bytes() * 4, full_index_bytes);
+
+    CheckScan(kNum);
+    for (int i = 0; i < 2 * kNum; i += 7) {
+        ASSERT_EQ(i % 2 == 0 ? Value(i) : "NOT_FOUND", Get(Key(i))) << i;
+    }
+    EXPECT_EQ("NOT_FOUND", Get(Key(2 * kNum)));
+
+    // 分区读入 block cache 之后不再读文件
+    Get(Key(100));
+    file_->Reset();
+    EXPECT_EQ(Value(100), Get(Key(100)));
+    EXPECT_EQ(0, file_->reads());
+
+    // 分区索引上的偏移估计仍然单调
+    uint64_t last = 0;
+    for (int i = 0; i < 2 * kNum; i += 500) {
+        const uint64_t offset = table_->ApproximateOffsetOf(Key(i));
+        EXPECT_LE(last, offset);
+        last = offset;
+    }
+    EXPECT_LE(last, file_size_);
+    Close();
+}
+
+TEST_F(TableTest, PartitionedFilters) {
+    const int kNum = 5000;
+    std::unique_ptr<const FilterPolicy> policy(NewBloomFilterPolicy(10));
+    std::unique_ptr<Cache> cache(NewLRUCache(1 << 20));
+    std::unique_ptr<Statistics> stats(NewStatistics());
+    options_.filter_policy = policy.get();
+    options_.block_cache = cache.get();
+    options_.statistics = stats.get();
+    options_.partition_index = true;
+    options_.partition_filters = true;
+    Build(kNum);
+    Open();
+
+    for (int i = 0; i < 2 * kNum; i += 2) {
+        ASSERT_EQ(Value(i), Get(Key(i))) << i;
+    }
+    EXPECT_EQ(0u, stats->GetTickerCount(BLOOM_FILTER_USEFUL));
+    EXPECT_EQ(static_cast<uint64_t>(kNum), stats->GetTickerCount(BLOOM_FILTER_POSITIVE));
+
+    // 不存在的 key 大部分被过滤器挡住，不读数据块
+    stats->Reset();
+    for (int i = 1; i < 2 * kNum; i += 2) {
+        ASSERT_EQ("NOT_FOUND", Get(Key(i))) << i;
+    }
+    EXPECT_GT(stats->GetTickerCount(BLOOM_FILTER_USEFUL), static_cast<uint64_t>(kNum * 9 / 10));
+
+    CheckScan(kNum);
+    Close();
+}
+
+TEST_F(TableTest, MultiGet) {
+    const int kNum = 5000;
+    std::unique_ptr<const FilterPolicy> policy(NewBloomFilterPolicy(10));
+    options_.filter_policy = policy.get();
+    Build(kNum);
+    Open();
+
+    // 任意顺序，包括重复、不存在以及超出 table 范围的 key
+    Random rnd(301);
+    std::vector<std::string> keys;
+    for (int i = 0; i < 500; i++) {
+        keys.push_back(Key(rnd.Uniform(2 * kNum + 100)));
+    }
+    keys.push_back(keys[0]);
+    keys.push_back(Key(0));
+    keys.push_back("a");
+    keys.push_back(Key(3 * kNum));
+    std::vector<std::string> values = MultiGet(keys);
+    ASSERT_EQ(keys.size(), values.size());
+    for (size_t i = 0; i < keys.size(); i++) {
+        ASSERT_EQ(Get(keys[i]), values[i]) << keys[i];
+    }
+
+    // 没有 block cache 时，所有数据块合并成少数几次读取
+    const int blocks = static_cast<int>(file_size_ / options_.block_size);
+    std::vector<std::string> all;
+    for (int i = kNum - 1; i >= 0; i--) {
+        all.push_back(Key(2 * i));
+    }
+    file_->Reset();
+    values = MultiGet(all);
+    for (int i = 0; i < kNum; i++) {
+        ASSERT_EQ(Value(2 * (kNum - 1 - i)), values[i]) << i;
+    }
+    EXPECT_LT(file_->reads(), blocks / 10);
+
+    // 块已经在 block cache 中时不再读文件
+    std::unique_ptr<Cache> cache(NewLRUCache(1 << 20));
+    options_.block_cache = cache.get();
+    Open();
+    MultiGet(all);
+    file_->Reset();
+    values = MultiGet(all);
+    EXPECT_EQ(Value(0), values[kNum - 1]);
+    EXPECT_EQ(0, file_->reads());
+
+    // fill_cache 为 false 时读到的块不放入 cache
+    Open();
+    ReadOptions no_fill;
+    no_fill.fill_cache = false;
+    MultiGet(all, no_fill);
+    file_->Reset();
+    MultiGet(all);
+    EXPECT_GT(file_->reads(), 0);
+    Close();
+}
+
+TEST_F(TableTest, Readahead) {
+    const int kNum = 20000;
+    Build(kNum);
+    const int blocks = static_cast<int>(file_size_ / options_.block_size);
+
+    // 不预读时每个数据块读一次
+    options_.max_readahead_size = 0;
+    Open();
+    file_->Reset();
+    CheckScan(kNum);
+    EXPECT_GT(file_->reads(), blocks * 9 / 10);
+
+    // 自动预读：预读大小逐渐增大，整个扫描只需要很少的读取
+    options_.max_readahead_size = 64 * 1024;
+    Open();
+    file_->Reset();
+    CheckScan(kNum);
+    EXPECT_LT(file_->reads(), blocks / 10);
+
+    // 固定大小的预读，反向遍历时不预读，结果仍然正确
+    ReadOptions read_options;
+    read_options.readahead_size = 16 * 1024;
+    Open();
+    file_->Reset();
+    CheckScan(kNum, read_options);
+    EXPECT_LT(file_->reads(), blocks / 10);
+    Iterator* iter = table_->NewIterator(read_options);
+    int count = 0;
+    for (iter->SeekToLast(); iter->Valid(); iter->Prev(), count++) {
+        ASSERT_EQ(Key(2 * (kNum - 1 - count)), iter->key().ToString());
+    }
+    EXPECT_TRUE(iter->status().ok());
+    EXPECT_EQ(kNum, count);
+    delete iter;
+
+    // 随机 Seek 不触发自动预读，只读需要的块
+    read_options.readahead_size = 0;
+    iter = table_->NewIterator(read_options);
+    Random rnd(301);
+    file_->Reset();
+    for (int i = 0; i < 100; i++) {
+        iter->Seek(Key(2 * rnd.Uniform(kNum)));
+        ASSERT_TRUE(iter->Valid());
+    }
+    EXPECT_LE(file_->reads(), 100);
+    EXPECT_LT(file_->bytes(), 100u * 2 * options_.block_size);
+    delete iter;
+    Close();
+}
+
+TEST_F(TableTest, PrefixSeek) {
+    // 只有偶数编号的前缀有 key，每个前缀 20 个
+    std::vector<std::pair<std::string, std::string>> entries;
+    char buf[32];
+    for (int p = 0; p < 200; p += 2) {
+        for (int i = 0; i < 20; i++) {
+            std::snprintf(buf, sizeof(buf), "p%04d/%04d", p, i);
+            entries.emplace_back(buf, std::string("v") + buf);
+        }
+    }
+    std::unique_ptr<const FilterPolicy> policy(NewBloomFilterPolicy(10));
+    std::unique_ptr<const SliceTransform> prefix(NewFixedPrefixTransform(6));
+    std::unique_ptr<Statistics> stats(NewStatistics());
+    options_.filter_policy = policy.get();
+    options_.prefix_extractor = prefix.get();
+    options_.whole_key_filtering = false;
+    options_.statistics = stats.get();
+    Build(entries);
+    Open();
+
+    // 不存在的前缀几乎都不读数据块
+    ReadOptions read_options;
+    Iterator* iter = table_->NewIterator(read_options);
+    file_->Reset();
+    int valid = 0;
+    for (int p = 1; p < 200; p += 2) {
+        std::snprintf(buf, sizeof(buf), "p%04d/", p);
+        iter->Seek(buf);
+        if (iter->Valid()) valid++;
+    }
+    EXPECT_LT(valid, 10);
+    EXPECT_LT(file_->reads(), 10);
+
+    // 存在的前缀照常定位
+    iter->Seek("p0004/0005");
+    ASSERT_TRUE(iter->Valid());
+    EXPECT_EQ("p0004/0005", iter->key().ToString());
+    EXPECT_EQ("vp0004/0005", iter->value().ToString());
+    delete iter;
+
+    // prefix_same_as_start 时走到下一个前缀就结束
+    read_options.prefix_same_as_start = true;
+    iter = table_->NewIterator(read_options);
+    int count = 0;
+    for (iter->Seek("p0004/0005"); iter->Valid(); iter->Next(), count++) {
+        ASSERT_TRUE(iter->key().starts_with("p0004/"));
+    }
+    EXPECT_TRUE(iter->status().ok());
+    EXPECT_EQ(15, count);
+    delete iter;
+
+    // total_order_seek 时不使用前缀过滤，Seek 到下一个存在的 key
+    read_options = ReadOptions();
+    read_options.total_order_seek = true;
+    iter = table_->NewIterator(read_options);
+    iter->Seek("p0003/");
+    ASSERT_TRUE(iter->Valid());
+    EXPECT_EQ("p0004/0000", iter->key().ToString());
+    count = 0;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+        count++;
+    }
+    EXPECT_EQ(static_cast<int>(entries.size()), count);
+    delete iter;
+
+    // 过滤器中只有前缀时 Get() 按前缀过滤
+    stats->Reset();
+    EXPECT_EQ("vp0006/0001", Get("p0006/0001"));
+    EXPECT_EQ("NOT_FOUND", Get("p0007/0001"));
+    EXPECT_EQ(1u, stats->GetTickerCount(BLOOM_FILTER_USEFUL));
+
+    // 前缀变换的名字不同时不使用前缀过滤器，结果仍然正确
+    std::unique_ptr<const SliceTransform> other(NewCappedPrefixTransform(6));
+    options_.prefix_extractor = other.get();
+    Open();
+    stats->Reset();
+    EXPECT_EQ("vp0006/0001", Get("p0006/0001"));
+    EXPECT_EQ("NOT_FOUND", Get("p0007/0001"));
+    EXPECT_EQ(0u, stats->GetTickerCount(BLOOM_FILTER_USEFUL));
+    Close();
+}
+
+} // namespace tinydb
@@ -0,0 +1,26 @@
+#ifndef STORAGE_TINYDB_TABLE_TWO_LEVEL_ITERATOR_H_
+#define STORAGE_TINYDB_TABLE_TWO_LEVEL_ITERATOR_H_
+
+#include "tinydb/iterator.h"
+#include "tinydb/options.h"
+
+namespace tinydb {
+
+/*
+ * 返回一个两层迭代器：index_iter 的每个 value 经 block_function 转换成一个
+ * 二级迭代器，依次遍历所有二级迭代器中的 key/value
+ *
+ * 例如 sstable 的 index block 的 value 是数据块的 BlockHandle，
+ * block_function 读出对应的数据块并返回数据块的迭代器
+ *
+ * 接管 index_iter 的所有权
+ */
+Iterator* NewTwoLevelIterator(
+        Iterator* index_iter,
+        Iterator* (*block_function)(void* arg, const ReadOptions& options,
+                                    const Slice& index_value),
+        void* arg, const ReadOptions& options);
+
+} // namespace tinydb
+
+#endif  // STORAGE_TINYDB_TABLE_TWO_LEVEL_ITERATOR_H_
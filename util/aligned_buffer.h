@@ -0,0 +1,99 @@
+#ifndef STORAGE_TINYDB_UTIL_ALIGNED_BUFFER_H_
+#define STORAGE_TINYDB_UTIL_ALIGNED_BUFFER_H_
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <cstring>
+
+namespace tinydb {
+
+// 把 x 向上取整到 alignment 的倍数，alignment 必须是 2 的幂
+inline size_t Roundup(size_t x, size_t alignment) {
+    return (x + alignment - 1) & ~(alignment - 1);
+}
+
+// 把 x 向下取整到 alignment 的倍数
+inline size_t TruncateToPageBoundary(size_t alignment, size_t x) {
+    return x & ~(alignment - 1);
+}
+
+/*
+ * 起始地址和容量都按 alignment 对齐的缓冲区，用于直接 I/O
+ * 直接 I/O 要求内存地址、文件偏移和长度都是逻辑块大小的整数倍
+ */
+class AlignedBuffer {
+public:
+    explicit AlignedBuffer(size_t alignment)
+            : alignment_(alignment), capacity_(0), cursize_(0),
+              raw_(nullptr), buf_(nullptr) {
+        assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+    }
+
+    AlignedBuffer(const AlignedBuffer&) = delete;
+    AlignedBuffer& operator=(const AlignedBuffer&) = delete;
+
+    ~AlignedBuffer() { delete[] raw_; }
+
+    size_t Alignment() const { return alignment_; }
+    size_t Capacity() const { return capacity_; }
+    size_t CurrentSize() const { return cursize_; }
+    char* BufferStart() { return buf_; }
+    const char* BufferStart() const { return buf_; }
+
+    void Size(size_t cursize) {
+        assert(cursize <= capacity_);
+        cursize_ = cursize;
+    }
+
+    // 分配一块至少 requested_capacity 字节的新缓冲区，原有内容丢弃
+    void AllocateNewBuffer(size_t requested_capacity) {
+        const size_t new_capacity = Roundup(requested_capacity, alignment_);
+        if (new_capacity == capacity_) {
+            cursize_ = 0;
+            return;
+        }
+        delete[] raw_;
+        // 多分配 alignment_ 字节，从中找到对齐的起始地址
+        raw_ = new char[new_capacity + alignment_];
+        const uintptr_t addr = reinterpret_cast<uintptr_t>(raw_);
+        buf_ = raw_ + (Roundup(addr, alignment_) - addr);
+        capacity_ = new_capacity;
+        cursize_ = 0;
+    }
+
+    // 追加尽可能多的数据，返回实际追加的字节数
+    size_t Append(const char* src, size_t n) {
+        const size_t to_copy = std::min(capacity_ - cursize_, n);
+        std::memcpy(buf_ + cursize_, src, to_copy);
+        cursize_ += to_copy;
+        return to_copy;
+    }
+
+    // 用 0 填充到对齐的长度，返回填充后的长度
+    size_t PadToAlignment() {
+        const size_t padded = Roundup(cursize_, alignment_);
+        std::memset(buf_ + cursize_, 0, padded - cursize_);
+        return padded;
+    }
+
+    // 把 [tail_offset, cursize_) 移到缓冲区开头，用于写出对齐部分后保留末尾不满一块的数据
+    void RefitTail(size_t tail_offset) {
+        assert(tail_offset <= cursize_);
+        const size_t tail_size = cursize_ - tail_offset;
+        std::memmove(buf_, buf_ + tail_offset, tail_size);
+        cursize_ = tail_size;
+    }
+
+private:
+    const size_t alignment_;
+    size_t capacity_;
+    size_t cursize_;
+    char* raw_;
+    char* buf_;
+};
+
+} // namespace tinydb
+
+#endif  // STORAGE_TINYDB_UTIL_ALIGNED_BUFFER_H_
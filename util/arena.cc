@@ -1,13 +1,26 @@
 #include "arena.h"
 
+#include "tinydb/write_buffer_manager.h"
+
 namespace tinydb {
 
 static const int kBlockSize = 4096;
 
-Arena::Arena()
-        : alloc_ptr_(nullptr), alloc_bytes_remaining_(0), memory_usage_(0) {}
+Arena::Arena() : Arena(nullptr) {}
+
+Arena::Arena(WriteBufferManager* write_buffer_manager)
+        : alloc_ptr_(nullptr),
+          alloc_bytes_remaining_(0),
+          memory_usage_(0),
+          write_buffer_manager_(write_buffer_manager),
+          immutable_usage_(0) {}
 
 Arena::~Arena() {
+    if (write_buffer_manager_ != nullptr) {
+        const size_t usage = MemoryUsage();
+        write_buffer_manager_->ScheduleFreeMem(usage - immutable_usage_);
+        write_buffer_manager_->FreeMem(usage);
+    }
     for (size_t i = 0; i < blocks_.size(); i++) {
         delete[] blocks_[i];
     }
@@ -56,8 +69,18 @@ char* Arena::AllocateNewBlock(size_t block_bytes) {
     blocks_.push_back(result); // 可能有线程安全问题
     memory_usage_.fetch_add(block_bytes + sizeof(char*),
                             std::memory_order_relaxed);
+    if (write_buffer_manager_ != nullptr) {
+        write_buffer_manager_->ReserveMem(block_bytes + sizeof(char*));
+    }
     return result;
 }
 
+void Arena::MarkImmutable() {
+    if (write_buffer_manager_ != nullptr && immutable_usage_ == 0) {
+        immutable_usage_ = MemoryUsage();
+        write_buffer_manager_->ScheduleFreeMem(immutable_usage_);
+    }
+}
+
 
 } // namespace tinydb
@@ -13,10 +13,15 @@
 
 namespace tinydb {
 
+class WriteBufferManager;
+
 class Arena {
 public:
     Arena();
 
+    // 分配的内存块都计入 write_buffer_manager，为 nullptr 时不计入
+    explicit Arena(WriteBufferManager* write_buffer_manager);
+
     Arena(const Arena&) = delete;
     Arena& operator=(const Arena&) = delete;
 
@@ -29,6 +34,9 @@ public:
         return memory_usage_.load(std::memory_order_relaxed);
     }
 
+    // 之后不再分配内存(memtable 变为只读)，在 WriteBufferManager 中不再算作还在写入的内存
+    void MarkImmutable();
+
 private:
     // 在正常分配失败时调用的回退方法，通常用于分配新的内存
     char* AllocateFallback(size_t bytes);
@@ -42,9 +50,23 @@ private:
     std::vector<char*> blocks_;
     // 跟踪已分配的总内存量，使用 std::atomic 保证线程安全
     std::atomic<size_t> memory_usage_;
-};
 
+    WriteBufferManager* const write_buffer_manager_;
+    // MarkImmutable() 时的 memory_usage_，之前为 0
+    size_t immutable_usage_;
+};
 
+inline char* Arena::Allocate(size_t bytes) {
+    // 返回 0 字节的分配没有意义，内部也不需要
+    assert(bytes > 0);
+    if (bytes <= alloc_bytes_remaining_) {
+        char* result = alloc_ptr_;
+        alloc_ptr_ += bytes;
+        alloc_bytes_remaining_ -= bytes;
+        return result;
+    }
+    return AllocateFallback(bytes);
+}
 
 } // namespace tinydb
 
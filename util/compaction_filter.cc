@@ -0,0 +1,60 @@
+#include "tinydb/compaction_filter.h"
+
+#include "tinydb/env.h"
+#include "tinydb/slice.h"
+#include "util/coding.h"
+
+namespace tinydb {
+
+CompactionFilter::~CompactionFilter() = default;
+
+namespace {
+
+// value 末尾的写入时间：unix 时间(秒)，fixed32
+static const size_t kTTLTimestampSize = 4;
+
+static uint32_t NowSeconds(Env* env) {
+    return static_cast<uint32_t>(env->NowMicros() / 1000000);
+}
+
+class TTLCompactionFilter : public CompactionFilter {
+public:
+    TTLCompactionFilter(Env* env, uint64_t ttl_seconds)
+        : env_(env), ttl_seconds_(ttl_seconds) {}
+
+    const char* Name() const override { return "tinydb.TTLCompactionFilter"; }
+
+    bool Filter(int level, const Slice& user_key,
+                const Slice& value) const override {
+        if (value.size() < kTTLTimestampSize) {
+            return false;
+        }
+        const uint64_t write_time =
+                DecodeFixed32(value.data() + value.size() - kTTLTimestampSize);
+        return write_time + ttl_seconds_ < NowSeconds(env_);
+    }
+
+private:
+    Env* const env_;
+    const uint64_t ttl_seconds_;
+};
+
+} // namespace
+
+const CompactionFilter* NewTTLCompactionFilter(Env* env, uint64_t ttl_seconds) {
+    return new TTLCompactionFilter(env, ttl_seconds);
+}
+
+void AppendTTLTimestamp(Env* env, std::string* value) {
+    PutFixed32(value, NowSeconds(env));
+}
+
+bool StripTTLTimestamp(Slice* value) {
+    if (value->size() < kTTLTimestampSize) {
+        return false;
+    }
+    *value = Slice(value->data(), value->size() - kTTLTimestampSize);
+    return true;
+}
+
+} // namespace tinydb
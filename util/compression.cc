@@ -0,0 +1,142 @@
+#include "util/compression.h"
+
+#include <cstdio>
+
+#include "port/port.h"
+#include "util/compression_dict.h"
+
+namespace tinydb {
+
+CompressionType CompressionTypeForLevel(const Options& options, int level) {
+    const std::vector<CompressionType>& types = options.compression_per_level;
+    if (types.empty()) {
+        return options.compression;
+    }
+    if (level < 0) {
+        level = 0;
+    }
+    const size_t i = static_cast<size_t>(level);
+    return i < types.size() ? types[i] : types.back();
+}
+
+int CompressionLevelForLevel(const Options& options, int level) {
+    const std::vector<int>& levels = options.compression_level_per_level;
+    if (levels.empty()) {
+        return options.zstd_compression_level;
+    }
+    if (level < 0) {
+        level = 0;
+    }
+    const size_t i = static_cast<size_t>(level);
+    return i < levels.size() ? levels[i] : levels.back();
+}
+
+bool CompressionStats::ShouldAttempt(int level) {
+    LevelStats& s = levels_[Clamp(level)];
+    const uint32_t attempts = s.recent_attempts.load(std::memory_order_relaxed);
+    const uint32_t rejects = s.recent_rejects.load(std::memory_order_relaxed);
+    // 近期 7/8 以上的块都压缩不动
+    if (attempts < kMinAttempts || rejects * 8 < attempts * 7) {
+        return true;
+    }
+    if (s.probe.fetch_add(1, std::memory_order_relaxed) % kProbeInterval == 0) {
+        return true;
+    }
+    s.blocks_skipped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void CompressionStats::Record(int level, CompressionType requested,
+                              size_t raw, size_t stored, bool compressed) {
+    LevelStats& s = levels_[Clamp(level)];
+    s.raw_bytes.fetch_add(raw, std::memory_order_relaxed);
+    s.stored_bytes.fetch_add(stored, std::memory_order_relaxed);
+    if (requested == kNoCompression) {
+        return;
+    }
+    if (compressed) {
+        s.blocks_compressed.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        s.blocks_rejected.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // 减半不是原子的，并发时窗口会有少许误差，对启发式判断没有影响
+    const uint32_t attempts =
+            s.recent_attempts.fetch_add(1, std::memory_order_relaxed) + 1;
+    uint32_t rejects = s.recent_rejects.load(std::memory_order_relaxed);
+    if (!compressed) {
+        rejects = s.recent_rejects.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+    if (attempts >= kWindow) {
+        s.recent_attempts.store(attempts / 2, std::memory_order_relaxed);
+        s.recent_rejects.store(rejects / 2, std::memory_order_relaxed);
+    }
+}
+
+std::string CompressionStats::ToString() const {
+    std::string result;
+    char buf[200];
+    for (int level = 0; level < kMaxLevels; level++) {
+        const LevelStats& s = levels_[level];
+        const uint64_t raw = s.raw_bytes.load(std::memory_order_relaxed);
+        if (raw == 0) {
+            continue;
+        }
+        const uint64_t stored = s.stored_bytes.load(std::memory_order_relaxed);
+        std::snprintf(
+                buf, sizeof(buf),
+                "L%d: compressed=%llu rejected=%llu skipped=%llu "
+                "raw=%llu stored=%llu ratio=%.3f\n",
+                level,
+                static_cast<unsigned long long>(s.blocks_compressed.load()),
+                static_cast<unsigned long long>(s.blocks_rejected.load()),
+                static_cast<unsigned long long>(s.blocks_skipped.load()),
+                static_cast<unsigned long long>(raw),
+                static_cast<unsigned long long>(stored),
+                static_cast<double>(stored) / static_cast<double>(raw));
+        result.append(buf);
+    }
+    return result;
+}
+
+CompressionType CompressBlock(const Options& options, int level,
+                              const Slice& raw, const CompressionDict* dict,
+                              std::string* output, CompressionStats* stats) {
+    const CompressionType type = CompressionTypeForLevel(options, level);
+    if (type != kNoCompression && options.adaptive_compression &&
+        stats != nullptr && !stats->ShouldAttempt(level)) {
+        stats->Record(level, kNoCompression, raw.size(), raw.size(), false);
+        return kNoCompression;
+    }
+
+    bool ok = false;
+    switch (type) {
+        case kNoCompression:
+            break;
+
+        case kSnappyCompression:
+            ok = port::Snappy_Compress(raw.data(), raw.size(), output);
+            break;
+
+        case kZstdCompression:
+            if (dict != nullptr && !dict->empty()) {
+                ok = dict->Compress(raw.data(), raw.size(), output);
+            } else {
+                ok = port::Zstd_Compress(CompressionLevelForLevel(options, level),
+                                         raw.data(), raw.size(), output);
+            }
+            break;
+    }
+
+    // 节省不到 min_compression_savings 时按不压缩存储
+    const size_t limit = raw.size() - static_cast<size_t>(
+            static_cast<double>(raw.size()) * options.min_compression_savings);
+    const bool compressed = ok && output->size() < limit;
+    if (stats != nullptr) {
+        stats->Record(level, type, raw.size(),
+                      compressed ? output->size() : raw.size(), compressed);
+    }
+    return compressed ? type : kNoCompression;
+}
+
+} // namespace tinydb
@@ -0,0 +1,87 @@
+#ifndef STORAGE_TINYDB_UTIL_COMPRESSION_H_
+#define STORAGE_TINYDB_UTIL_COMPRESSION_H_
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "tinydb/options.h"
+#include "tinydb/slice.h"
+
+namespace tinydb {
+
+class CompressionDict;
+
+// 按层取压缩算法和压缩级别，见 Options::compression_per_level
+CompressionType CompressionTypeForLevel(const Options& options, int level);
+int CompressionLevelForLevel(const Options& options, int level);
+
+/*
+ * 每层的压缩统计，同时也是自适应压缩的状态
+ * 计数器都是 relaxed 原子变量，多个构建 table 的线程可以并发更新，读到的是近似值
+ */
+class CompressionStats {
+public:
+    enum { kMaxLevels = 16 };
+
+    struct LevelStats {
+        std::atomic<uint64_t> blocks_compressed{0};  // 压缩后存储的块数
+        std::atomic<uint64_t> blocks_rejected{0};    // 压缩了但节省太少，按原样存储
+        std::atomic<uint64_t> blocks_skipped{0};     // 自适应模式下没有尝试压缩
+        std::atomic<uint64_t> raw_bytes{0};          // 所有块压缩前的字节数
+        std::atomic<uint64_t> stored_bytes{0};       // 所有块实际写入的字节数
+
+        // 自适应模式使用的近期窗口，超过 kWindow 次后减半，使旧样本逐渐失效
+        std::atomic<uint32_t> recent_attempts{0};
+        std::atomic<uint32_t> recent_rejects{0};
+        // 跳过期间的块计数，用来决定哪些块仍然要尝试压缩
+        std::atomic<uint32_t> probe{0};
+    };
+
+    CompressionStats() = default;
+
+    CompressionStats(const CompressionStats&) = delete;
+    CompressionStats& operator=(const CompressionStats&) = delete;
+
+    const LevelStats& level(int level) const { return levels_[Clamp(level)]; }
+
+    // 自适应模式下本块是否值得尝试压缩
+    bool ShouldAttempt(int level);
+
+    // 记录一个块的压缩结果
+    void Record(int level, CompressionType requested, size_t raw,
+                size_t stored, bool compressed);
+
+    // 可读的各层统计，仅输出有数据的层
+    std::string ToString() const;
+
+private:
+    // 近期窗口大小
+    static const uint32_t kWindow = 1024;
+    // 近期至少要有这么多次尝试才开始跳过
+    static const uint32_t kMinAttempts = 64;
+    // 跳过时，每 kProbeInterval 个块仍然尝试压缩一次，以便发现压缩率回升
+    static const uint32_t kProbeInterval = 16;
+
+    static int Clamp(int level) {
+        return level < 0 ? 0 : (level >= kMaxLevels ? kMaxLevels - 1 : level);
+    }
+
+    LevelStats levels_[kMaxLevels];
+};
+
+/*
+ * 按 level 对应的算法和级别压缩一个块
+ * 返回实际使用的压缩算法，为 kNoCompression 时调用者应当存储原始数据(*output 无意义)：
+ *   - 该层不压缩，或者当前平台不支持该压缩算法
+ *   - 压缩后节省的比例不足 Options::min_compression_savings
+ *   - 自适应模式下本块被跳过
+ * dict 非空且算法为 Zstd 时使用字典压缩；stats 可以为 nullptr
+ */
+CompressionType CompressBlock(const Options& options, int level,
+                              const Slice& raw, const CompressionDict* dict,
+                              std::string* output, CompressionStats* stats);
+
+} // namespace tinydb
+
+#endif  // STORAGE_TINYDB_UTIL_COMPRESSION_H_
@@ -0,0 +1,91 @@
+#include "util/compression_dict.h"
+
+#include <algorithm>
+
+#include "port/port.h"
+
+namespace tinydb {
+
+CompressionDict::CompressionDict(const Slice& dict, int level)
+        : dict_(dict.data(), dict.size()),
+          cdict_(nullptr),
+          ddict_(nullptr) {
+    if (!dict_.empty()) {
+        cdict_ = port::Zstd_CreateCDict(dict_.data(), dict_.size(), level);
+    }
+}
+
+CompressionDict::CompressionDict(const Slice& dict)
+        : dict_(dict.data(), dict.size()),
+          cdict_(nullptr),
+          ddict_(nullptr) {
+    if (!dict_.empty()) {
+        ddict_ = port::Zstd_CreateDDict(dict_.data(), dict_.size());
+    }
+}
+
+CompressionDict::~CompressionDict() {
+    if (cdict_ != nullptr) {
+        port::Zstd_FreeCDict(cdict_);
+    }
+    if (ddict_ != nullptr) {
+        port::Zstd_FreeDDict(ddict_);
+    }
+}
+
+bool CompressionDict::Compress(const char* input, size_t length,
+                               std::string* output) const {
+    if (cdict_ == nullptr) {
+        return false;
+    }
+    return port::Zstd_CompressWithDict(cdict_, input, length, output);
+}
+
+bool CompressionDict::Uncompress(const char* input, size_t length,
+                                 char* output) const {
+    if (ddict_ == nullptr) {
+        return false;
+    }
+    return port::Zstd_UncompressWithDict(ddict_, input, length, output);
+}
+
+CompressionDictBuilder::CompressionDictBuilder(const Options& options)
+        : enabled_(options.compression == kZstdCompression &&
+                   options.zstd_max_dict_bytes > 0),
+          max_dict_bytes_(options.zstd_max_dict_bytes),
+          max_sample_bytes_(options.zstd_max_train_bytes > 0
+                            ? options.zstd_max_train_bytes
+                            : options.zstd_max_dict_bytes),
+          train_(options.zstd_max_train_bytes > 0) {}
+
+void CompressionDictBuilder::AddSample(const Slice& block) {
+    if (!enabled_ || full() || block.empty()) {
+        return;
+    }
+    // 最后一个样本截断到上限，保证样本总量不超过 max_sample_bytes_
+    const size_t n = std::min(block.size(), max_sample_bytes_ - samples_.size());
+    samples_.append(block.data(), n);
+    sample_lengths_.push_back(n);
+}
+
+bool CompressionDictBuilder::Finish(std::string* dict) {
+    dict->clear();
+    if (!enabled_ || samples_.empty()) {
+        return false;
+    }
+    if (train_ &&
+        port::Zstd_TrainDictionary(samples_, sample_lengths_, max_dict_bytes_,
+                                   dict)) {
+        return true;
+    }
+    if (train_) {
+        // 样本太少时 zstd 训练会失败，退化为原始内容字典
+        dict->clear();
+    }
+    // 原始内容字典：越靠后的内容在压缩窗口中离数据越近，所以取样本的末尾
+    const size_t n = std::min(samples_.size(), max_dict_bytes_);
+    dict->assign(samples_.data() + samples_.size() - n, n);
+    return true;
+}
+
+} // namespace tinydb
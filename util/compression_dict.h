@@ -0,0 +1,91 @@
+#ifndef STORAGE_TINYDB_UTIL_COMPRESSION_DICT_H_
+#define STORAGE_TINYDB_UTIL_COMPRESSION_DICT_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "tinydb/options.h"
+#include "tinydb/slice.h"
+
+namespace tinydb {
+
+// 存放压缩字典的 meta block 名称
+static const char kCompressionDictBlockName[] = "tinydb.CompressionDict";
+
+/*
+ * 已经训练好的 Zstd 字典
+ * 构造时就预先建好 ZSTD_CDict 或 ZSTD_DDict，每个块压缩/解压时直接复用，
+ * 避免每个块都重新解析一遍字典。构造后只读，可以被多个线程并发使用
+ */
+class CompressionDict {
+public:
+    // 用于压缩，level 为压缩级别，只建 ZSTD_CDict。此时 Uncompress() 返回 false
+    CompressionDict(const Slice& dict, int level);
+
+    // 用于解压(读取 table 时)，只建 ZSTD_DDict。此时 Compress() 返回 false
+    explicit CompressionDict(const Slice& dict);
+
+    CompressionDict(const CompressionDict&) = delete;
+    CompressionDict& operator=(const CompressionDict&) = delete;
+
+    ~CompressionDict();
+
+    // 字典的原始内容，写 meta block 时使用
+    Slice contents() const { return Slice(dict_); }
+
+    bool empty() const { return dict_.empty(); }
+
+    bool Compress(const char* input, size_t length, std::string* output) const;
+
+    // 解压到 output，output 的长度由 port::Zstd_GetUncompressedLength 给出
+    bool Uncompress(const char* input, size_t length, char* output) const;
+
+private:
+    const std::string dict_;
+    void* cdict_;
+    void* ddict_;
+};
+
+/*
+ * 构建 table 时收集未压缩数据块作为样本，最后训练出字典
+ * 样本总量超过上限后的块不再采样
+ */
+class CompressionDictBuilder {
+public:
+    explicit CompressionDictBuilder(const Options& options);
+
+    CompressionDictBuilder(const CompressionDictBuilder&) = delete;
+    CompressionDictBuilder& operator=(const CompressionDictBuilder&) = delete;
+
+    // 是否需要字典: Zstd 压缩且 zstd_max_dict_bytes > 0
+    bool enabled() const { return enabled_; }
+
+    // 样本是否已经收集够了，够了之后就可以调用 Finish()
+    bool full() const { return samples_.size() >= max_sample_bytes_; }
+
+    // 已收集的样本字节数
+    size_t sample_bytes() const { return samples_.size(); }
+
+    // 添加一个未压缩的数据块作为样本
+    void AddSample(const Slice& block);
+
+    /*
+     * 用收集的样本生成字典放到 *dict，没有启用或者没有样本时返回 false
+     * 设置了 zstd_max_train_bytes 时用 zstd 训练字典；没有设置，或者训练失败(例如样本太少)时，
+     * 直接取样本末尾的 max_dict_bytes 字节作为原始内容字典
+     */
+    bool Finish(std::string* dict);
+
+private:
+    const bool enabled_;
+    const size_t max_dict_bytes_;
+    const size_t max_sample_bytes_;
+    const bool train_;
+    std::string samples_;
+    std::vector<size_t> sample_lengths_;
+};
+
+} // namespace tinydb
+
+#endif  // STORAGE_TINYDB_UTIL_COMPRESSION_DICT_H_
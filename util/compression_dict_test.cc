@@ -0,0 +1,236 @@
+#include "util/compression_dict.h"
+
+#include <cstring>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "port/port.h"
+#include "tinydb/env.h"
+#include "tinydb/iterator.h"
+#include "tinydb/options.h"
+#include "tinydb/table.h"
+#include "tinydb/table_builder.h"
+#include "util/compression.h"
+#include "util/testutil.h"
+
+namespace tinydb {
+
+namespace {
+
+// 字段名和取值反复出现的小记录，适合字典压缩
+std::string JsonValue(int i) {
+    char buf[200];
+    std::snprintf(buf, sizeof(buf),
+                  "{\"id\":%d,\"name\":\"user%06d\",\"email\":\"user%06d@example.com\","
+                  "\"active\":%s,\"tags\":[\"mobile\",\"premium\"]}",
+                  i, i, i, (i % 3 == 0) ? "false" : "true");
+    return buf;
+}
+
+Options DictOptions(size_t dict_bytes, size_t train_bytes) {
+    Options options;
+    options.compression = kZstdCompression;
+    options.zstd_max_dict_bytes = dict_bytes;
+    options.zstd_max_train_bytes = train_bytes;
+    return options;
+}
+
+} // namespace
+
+TEST(CompressionDictBuilderTest, Disabled) {
+    Options options = DictOptions(0, 0);
+    CompressionDictBuilder no_dict(options);
+    EXPECT_FALSE(no_dict.enabled());
+
+    options = DictOptions(1024, 0);
+    options.compression = kSnappyCompression;
+    CompressionDictBuilder snappy(options);
+    EXPECT_FALSE(snappy.enabled());
+    snappy.AddSample("some block");
+    EXPECT_EQ(0u, snappy.sample_bytes());
+    std::string dict;
+    EXPECT_FALSE(snappy.Finish(&dict));
+    EXPECT_TRUE(dict.empty());
+}
+
+TEST(CompressionDictBuilderTest, NoSamples) {
+    CompressionDictBuilder builder(DictOptions(1024, 0));
+    ASSERT_TRUE(builder.enabled());
+    std::string dict = "stale";
+    EXPECT_FALSE(builder.Finish(&dict));
+    EXPECT_TRUE(dict.empty());
+}
+
+TEST(CompressionDictBuilderTest, RawContentDictionary) {
+    // 没有设置 zstd_max_train_bytes：样本上限等于字典大小，字典是样本的末尾
+    CompressionDictBuilder builder(DictOptions(100, 0));
+    std::string all;
+    for (int i = 0; !builder.full(); i++) {
+        const std::string block = JsonValue(i);
+        builder.AddSample(block);
+        all += block;
+    }
+    EXPECT_EQ(100u, builder.sample_bytes());
+    // 样本已经够了，之后的块不再采样
+    builder.AddSample("ignored");
+    EXPECT_EQ(100u, builder.sample_bytes());
+
+    std::string dict;
+    ASSERT_TRUE(builder.Finish(&dict));
+    EXPECT_EQ(all.substr(0, 100), dict);
+}
+
+TEST(CompressionDictBuilderTest, TrainingFailureFallsBackToRawContent) {
+    // 样本太少，zstd 训练失败(或者不支持 Zstd)，退化为原始内容字典
+    CompressionDictBuilder builder(DictOptions(64, 4096));
+    builder.AddSample("tiny sample");
+    std::string dict;
+    ASSERT_TRUE(builder.Finish(&dict));
+    EXPECT_EQ("tiny sample", dict);
+}
+
+TEST(CompressionDictTest, RoundTrip) {
+    if (!test::ZstdSupported()) {
+        GTEST_SKIP() << "Zstd is not supported";
+    }
+    CompressionDictBuilder builder(DictOptions(4096, 4096 * 20));
+    for (int i = 0; !builder.full(); i++) {
+        std::string block;
+        for (int j = 0; j < 30; j++) {
+            block += JsonValue(i * 30 + j);
+        }
+        builder.AddSample(block);
+    }
+    std::string contents;
+    ASSERT_TRUE(builder.Finish(&contents));
+    ASSERT_FALSE(contents.empty());
+
+    CompressionDict compress_dict(contents, 3);
+    CompressionDict uncompress_dict(contents);
+    EXPECT_EQ(Slice(contents), compress_dict.contents());
+
+    const std::string raw = JsonValue(1000000) + JsonValue(1000001);
+    std::string with_dict;
+    ASSERT_TRUE(compress_dict.Compress(raw.data(), raw.size(), &with_dict));
+    std::string without_dict;
+    ASSERT_TRUE(port::Zstd_Compress(3, raw.data(), raw.size(), &without_dict));
+    EXPECT_LT(with_dict.size(), without_dict.size());
+
+    size_t ulength;
+    ASSERT_TRUE(port::Zstd_GetUncompressedLength(with_dict.data(), with_dict.size(),
+                                                 &ulength));
+    ASSERT_EQ(raw.size(), ulength);
+    std::string output(ulength, '\0');
+    ASSERT_TRUE(uncompress_dict.Uncompress(with_dict.data(), with_dict.size(),
+                                           &output[0]));
+    EXPECT_EQ(raw, output);
+
+    // 每种字典只能用于一个方向
+    std::string unused;
+    EXPECT_FALSE(uncompress_dict.Compress(raw.data(), raw.size(), &unused));
+    EXPECT_FALSE(compress_dict.Uncompress(with_dict.data(), with_dict.size(),
+                                          &output[0]));
+
+    // 没有字典解不出来
+    EXPECT_FALSE(port::Zstd_Uncompress(with_dict.data(), with_dict.size(), &output[0]));
+}
+
+TEST(CompressionDictTest, TableRoundTrip) {
+    if (!test::ZstdSupported()) {
+        GTEST_SKIP() << "Zstd is not supported";
+    }
+    const std::string dir = test::NewTestDirectory("compression_dict_test");
+    const std::string fname = dir + "/000001.ldb";
+    Env* env = Env::Default();
+    const int kNum = 5000;
+
+    uint64_t sizes[2];
+    for (int with_dict = 0; with_dict < 2; with_dict++) {
+        Options options = DictOptions(with_dict ? 8192 : 0, with_dict ? 8192 * 50 : 0);
+        WritableFile* file;
+        ASSERT_TRUE(env->NewWritableFile(fname, &file).ok());
+        TableBuilder builder(options, file);
+        char key[32];
+        for (int i = 0; i < kNum; i++) {
+            std::snprintf(key, sizeof(key), "%016d", i);
+            builder.Add(key, JsonValue(i));
+        }
+        ASSERT_TRUE(builder.Finish().ok());
+        ASSERT_TRUE(file->Close().ok());
+        delete file;
+        sizes[with_dict] = builder.FileSize();
+
+        RandomAccessFile* rfile;
+        ASSERT_TRUE(env->NewRandomAccessFile(fname, &rfile).ok());
+        Table* table;
+        ASSERT_TRUE(Table::Open(options, rfile, sizes[with_dict], &table).ok());
+        ReadOptions read_options;
+        read_options.verify_checksums = true;
+        Iterator* iter = table->NewIterator(read_options);
+        int i = 0;
+        for (iter->SeekToFirst(); iter->Valid(); iter->Next(), i++) {
+            std::snprintf(key, sizeof(key), "%016d", i);
+            ASSERT_EQ(key, iter->key().ToString());
+            ASSERT_EQ(JsonValue(i), iter->value().ToString());
+        }
+        EXPECT_TRUE(iter->status().ok());
+        EXPECT_EQ(kNum, i);
+        delete iter;
+        delete table;
+        delete rfile;
+    }
+    EXPECT_LT(sizes[1], sizes[0]);
+}
+
+TEST(CompressionDictTest, FileSizeWhileBuffering) {
+    if (!test::ZstdSupported()) {
+        GTEST_SKIP() << "Zstd is not supported";
+    }
+    const std::string dir = test::NewTestDirectory("compression_dict_test");
+    Env* env = Env::Default();
+    const size_t kTrainBytes = 256 * 1024;
+    Options options = DictOptions(8192, kTrainBytes);
+
+    // 字典训练之前数据块还没有写入文件，FileSize() 按原始大小计入，compaction 可以及时切分文件
+    WritableFile* file;
+    ASSERT_TRUE(env->NewWritableFile(dir + "/000001.ldb", &file).ok());
+    TableBuilder builder(options, file);
+    uint64_t raw_bytes = 0;
+    char key[32];
+    int i = 0;
+    for (; raw_bytes < kTrainBytes / 2; i++) {
+        std::snprintf(key, sizeof(key), "%016d", i);
+        const std::string value = JsonValue(i);
+        builder.Add(key, value);
+        raw_bytes += std::strlen(key) + value.size();
+    }
+    uint64_t file_size;
+    ASSERT_TRUE(env->GetFileSize(dir + "/000001.ldb", &file_size).ok());
+    EXPECT_EQ(0u, file_size);
+    const uint64_t buffering_size = builder.FileSize();
+    EXPECT_GT(buffering_size, raw_bytes / 2);
+    EXPECT_LE(buffering_size, raw_bytes + 4096);
+
+    // 写出之后变为压缩后的大小
+    ASSERT_TRUE(builder.Finish().ok());
+    ASSERT_TRUE(file->Close().ok());
+    delete file;
+    ASSERT_TRUE(env->GetFileSize(dir + "/000001.ldb", &file_size).ok());
+    EXPECT_EQ(file_size, builder.FileSize());
+    EXPECT_LT(builder.FileSize(), buffering_size);
+
+    // 放弃的文件中没有缓存的数据块
+    ASSERT_TRUE(env->NewWritableFile(dir + "/000002.ldb", &file).ok());
+    TableBuilder abandoned(options, file);
+    for (int j = 0; j < i; j++) {
+        std::snprintf(key, sizeof(key), "%016d", j);
+        abandoned.Add(key, JsonValue(j));
+    }
+    EXPECT_GT(abandoned.FileSize(), 0u);
+    abandoned.Abandon();
+    EXPECT_EQ(0u, abandoned.FileSize());
+    ASSERT_TRUE(file->Close().ok());
+    delete file;
+}
+
+} // namespace tinydb
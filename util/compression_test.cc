@@ -0,0 +1,188 @@
+#include "util/compression.h"
+
+#include <cstdio>
+#include <memory>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "port/port.h"
+#include "tinydb/env.h"
+#include "tinydb/iterator.h"
+#include "tinydb/table.h"
+#include "tinydb/table_builder.h"
+#include "util/random.h"
+#include "util/testutil.h"
+
+namespace tinydb {
+
+namespace {
+
+// 任意字节，压缩不动
+std::string RandomBytes(Random* rnd, int len) {
+    std::string result(len, '\0');
+    for (int i = 0; i < len; i++) {
+        result[i] = static_cast<char>(rnd->Uniform(256));
+    }
+    return result;
+}
+
+} // namespace
+
+TEST(CompressionTest, PerLevelSettings) {
+    Options options;
+    options.compression = kSnappyCompression;
+    options.zstd_compression_level = 3;
+    // 为空时所有层使用全局设置
+    EXPECT_EQ(kSnappyCompression, CompressionTypeForLevel(options, 0));
+    EXPECT_EQ(kSnappyCompression, CompressionTypeForLevel(options, 6));
+    EXPECT_EQ(3, CompressionLevelForLevel(options, 4));
+
+    // 更深的层沿用最后一个元素
+    options.compression_per_level = {kNoCompression, kSnappyCompression, kZstdCompression};
+    options.compression_level_per_level = {1, 1, 1, 19};
+    EXPECT_EQ(kNoCompression, CompressionTypeForLevel(options, -1));
+    EXPECT_EQ(kNoCompression, CompressionTypeForLevel(options, 0));
+    EXPECT_EQ(kSnappyCompression, CompressionTypeForLevel(options, 1));
+    EXPECT_EQ(kZstdCompression, CompressionTypeForLevel(options, 2));
+    EXPECT_EQ(kZstdCompression, CompressionTypeForLevel(options, 6));
+    EXPECT_EQ(1, CompressionLevelForLevel(options, 0));
+    EXPECT_EQ(19, CompressionLevelForLevel(options, 3));
+    EXPECT_EQ(19, CompressionLevelForLevel(options, 6));
+}
+
+TEST(CompressionTest, MinSavings) {
+    if (!test::ZstdSupported()) {
+        GTEST_SKIP() << "Zstd is not supported";
+    }
+    Options options;
+    options.compression_per_level = {kNoCompression, kZstdCompression};
+    CompressionStats stats;
+    Random rnd(301);
+    const std::string compressible(4096, 'a');
+    const std::string incompressible = RandomBytes(&rnd, 4096);
+
+    std::string output;
+    ASSERT_EQ(kZstdCompression,
+              CompressBlock(options, 1, compressible, nullptr, &output, &stats));
+    size_t length;
+    ASSERT_TRUE(port::Zstd_GetUncompressedLength(output.data(), output.size(), &length));
+    std::string uncompressed(length, '\0');
+    ASSERT_TRUE(port::Zstd_Uncompress(output.data(), output.size(), &uncompressed[0]));
+    EXPECT_EQ(compressible, uncompressed);
+
+    // 随机数据压缩不动，按原样存储
+    EXPECT_EQ(kNoCompression,
+              CompressBlock(options, 1, incompressible, nullptr, &output, &stats));
+    // 第 0 层不压缩
+    EXPECT_EQ(kNoCompression,
+              CompressBlock(options, 0, compressible, nullptr, &output, &stats));
+
+    EXPECT_EQ(1u, stats.level(1).blocks_compressed.load());
+    EXPECT_EQ(1u, stats.level(1).blocks_rejected.load());
+    EXPECT_EQ(8192u, stats.level(1).raw_bytes.load());
+    EXPECT_GT(stats.level(1).stored_bytes.load(), 4096u);
+    EXPECT_LT(stats.level(1).stored_bytes.load(), 4096u + 1024);
+    EXPECT_EQ(0u, stats.level(0).blocks_compressed.load() + stats.level(0).blocks_rejected.load());
+    EXPECT_EQ(4096u, stats.level(0).stored_bytes.load());
+
+    // 要求节省一半以上时，压缩后只小一点的块也不压缩
+    std::string half = compressible.substr(0, 1024) + incompressible.substr(0, 3072);
+    EXPECT_EQ(kZstdCompression, CompressBlock(options, 1, half, nullptr, &output, nullptr));
+    options.min_compression_savings = 0.5;
+    EXPECT_EQ(kNoCompression, CompressBlock(options, 1, half, nullptr, &output, nullptr));
+}
+
+TEST(CompressionTest, AdaptiveSkipsAndRecovers) {
+    CompressionStats stats;
+    // 样本不足时总是尝试
+    for (int i = 0; i < 63; i++) {
+        ASSERT_TRUE(stats.ShouldAttempt(2));
+        stats.Record(2, kZstdCompression, 100, 100, false);
+    }
+    ASSERT_TRUE(stats.ShouldAttempt(2));
+    stats.Record(2, kZstdCompression, 100, 100, false);
+
+    // 近期几乎都压缩不动，每 16 个块只尝试一次
+    int attempts = 0;
+    for (int i = 0; i < 160; i++) {
+        if (stats.ShouldAttempt(2)) {
+            attempts++;
+        }
+    }
+    EXPECT_EQ(10, attempts);
+    EXPECT_EQ(150u, stats.level(2).blocks_skipped.load());
+    // 其它层不受影响
+    EXPECT_TRUE(stats.ShouldAttempt(3));
+
+    // 压缩率回升后恢复每块都尝试
+    for (int i = 0; i < 64; i++) {
+        stats.Record(2, kZstdCompression, 100, 10, true);
+    }
+    for (int i = 0; i < 20; i++) {
+        EXPECT_TRUE(stats.ShouldAttempt(2));
+    }
+    EXPECT_EQ(150u, stats.level(2).blocks_skipped.load());
+    EXPECT_NE(std::string::npos, stats.ToString().find("L2: compressed=64 rejected=64"));
+}
+
+TEST(CompressionTest, TableBuilderUsesLevelSettings) {
+    if (!test::ZstdSupported()) {
+        GTEST_SKIP() << "Zstd is not supported";
+    }
+    Options options;
+    options.block_size = 1024;
+    options.compression_per_level = {kNoCompression, kZstdCompression};
+    options.adaptive_compression = true;
+    Env* env = Env::Default();
+    const std::string dir = test::NewTestDirectory("compression_test");
+    Random rnd(17);
+
+    // 第 0 层不压缩；第 1 层的随机数据很快不再尝试压缩，之后的可压缩数据仍然压缩存储
+    CompressionStats stats;
+    for (int level = 0; level < 2; level++) {
+        for (int random = 1; random >= 0; random--) {
+            const std::string fname = dir + "/" + std::to_string(level * 2 + random) + ".ldb";
+            WritableFile* file;
+            ASSERT_TRUE(env->NewWritableFile(fname, &file).ok());
+            TableBuilder builder(options, file, level, &stats);
+            std::string value;
+            char key[32];
+            for (int i = 0; i < 2000; i++) {
+                std::snprintf(key, sizeof(key), "%08d", i);
+                if (random) {
+                    value = RandomBytes(&rnd, 200);
+                } else {
+                    value.assign(200, static_cast<char>('a' + i % 26));
+                }
+                builder.Add(key, value);
+            }
+            ASSERT_TRUE(builder.Finish().ok());
+            ASSERT_TRUE(file->Close().ok());
+            delete file;
+
+            // 读回的内容不受压缩方式影响
+            RandomAccessFile* rfile;
+            ASSERT_TRUE(env->NewRandomAccessFile(fname, &rfile).ok());
+            std::unique_ptr<RandomAccessFile> file_guard(rfile);
+            Table* table;
+            ASSERT_TRUE(Table::Open(options, rfile, builder.FileSize(), &table).ok());
+            std::unique_ptr<Table> table_guard(table);
+            std::unique_ptr<Iterator> iter(table->NewIterator(ReadOptions()));
+            int count = 0;
+            for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+                count++;
+            }
+            ASSERT_TRUE(iter->status().ok());
+            EXPECT_EQ(2000, count);
+        }
+    }
+    const CompressionStats::LevelStats& l0 = stats.level(0);
+    const CompressionStats::LevelStats& l1 = stats.level(1);
+    EXPECT_EQ(0u, l0.blocks_compressed.load() + l0.blocks_rejected.load());
+    EXPECT_EQ(l0.raw_bytes.load(), l0.stored_bytes.load());
+    EXPECT_GT(l1.blocks_compressed.load(), 0u);
+    EXPECT_GT(l1.blocks_skipped.load(), 0u);
+    EXPECT_LT(l1.stored_bytes.load(), l1.raw_bytes.load());
+}
+
+} // namespace tinydb
@@ -0,0 +1,95 @@
+#ifndef STORAGE_TINYDB_UTIL_CORE_LOCAL_H_
+#define STORAGE_TINYDB_UTIL_CORE_LOCAL_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <thread>
+
+#include "port/port.h"
+
+namespace tinydb {
+
+/*
+ * 每个 CPU 核一个 T，Access() 返回当前线程所在的核对应的那个
+ * 每个 T 都从 cache line 边界开始，并占满整数个 cache line，不同核之间不共享 cache line
+ *
+ * 线程可能随时被调度到其他核上，所以 T 本身仍然要支持并发访问(通常是 relaxed 原子操作)，
+ * 这里只是让绝大多数访问都落在本核的 cache line 上
+ */
+template <typename T>
+class CoreLocalArray {
+public:
+    CoreLocalArray();
+
+    CoreLocalArray(const CoreLocalArray&) = delete;
+    CoreLocalArray& operator=(const CoreLocalArray&) = delete;
+
+    ~CoreLocalArray();
+
+    // 分片的个数，不小于 CPU 核数的 2 的幂
+    size_t Size() const { return size_t{1} << size_shift_; }
+
+    // 当前核对应的 T
+    T* Access() const { return AccessAtCore(CoreIndex()); }
+
+    // 第 core_idx 个 T
+    // REQUIRES: core_idx < Size()
+    T* AccessAtCore(size_t core_idx) const;
+
+private:
+    static const size_t kCacheLineSize = 64;
+    // sizeof(T) 向上取整到 cache line 大小
+    static const size_t kStride = (sizeof(T) + kCacheLineSize - 1) / kCacheLineSize * kCacheLineSize;
+
+    size_t CoreIndex() const;
+
+    int size_shift_;
+    char* buf_;   // 分配的内存
+    char* data_;  // buf_ 中从 cache line 边界开始的位置
+};
+
+template <typename T>
+CoreLocalArray<T>::CoreLocalArray() : size_shift_(3) {
+    const unsigned int num_cpus = std::thread::hardware_concurrency();
+    while ((1u << size_shift_) < num_cpus) {
+        ++size_shift_;
+    }
+    buf_ = new char[Size() * kStride + kCacheLineSize];
+    data_ = buf_ + (kCacheLineSize - reinterpret_cast<uintptr_t>(buf_) % kCacheLineSize) %
+                           kCacheLineSize;
+    for (size_t i = 0; i < Size(); i++) {
+        new (data_ + i * kStride) T();
+    }
+}
+
+template <typename T>
+CoreLocalArray<T>::~CoreLocalArray() {
+    for (size_t i = 0; i < Size(); i++) {
+        AccessAtCore(i)->~T();
+    }
+    delete[] buf_;
+}
+
+template <typename T>
+T* CoreLocalArray<T>::AccessAtCore(size_t core_idx) const {
+    assert(core_idx < Size());
+    return reinterpret_cast<T*>(data_ + core_idx * kStride);
+}
+
+template <typename T>
+size_t CoreLocalArray<T>::CoreIndex() const {
+    const int cpu_id = port::PhysicalCoreID();
+    if (cpu_id >= 0) {
+        return static_cast<size_t>(cpu_id) & (Size() - 1);
+    }
+    // 不能获取核编号时，每个线程第一次访问时固定分到一个分片上
+    static std::atomic<uint32_t> next_thread(0);
+    thread_local uint32_t thread_idx = next_thread.fetch_add(1, std::memory_order_relaxed);
+    return thread_idx & (Size() - 1);
+}
+
+} // namespace tinydb
+
+#endif  // STORAGE_TINYDB_UTIL_CORE_LOCAL_H_
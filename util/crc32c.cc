@@ -0,0 +1,80 @@
+#include "util/crc32c.h"
+
+#include "port/port.h"
+#include "util/coding.h"
+
+namespace tinydb {
+namespace crc32c {
+
+namespace {
+
+// CRC32C (Castagnoli) 多项式的反转形式
+const uint32_t kPolynomial = 0x82f63b78u;
+
+/*
+ * slicing-by-4 查找表：table[0] 是普通的按字节查找表，
+ * table[k][i] 是 table[0][i] 之后再经过 k 个零字节的结果，这样每次可以处理 4 个字节
+ */
+struct Tables {
+    uint32_t table[4][256];
+
+    Tables() {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t crc = i;
+            for (int j = 0; j < 8; j++) {
+                crc = (crc >> 1) ^ ((crc & 1) ? kPolynomial : 0);
+            }
+            table[0][i] = crc;
+        }
+        for (uint32_t i = 0; i < 256; i++) {
+            for (int k = 1; k < 4; k++) {
+                const uint32_t prev = table[k - 1][i];
+                table[k][i] = (prev >> 8) ^ table[0][prev & 0xff];
+            }
+        }
+    }
+};
+
+const Tables& GetTables() {
+    static const Tables tables;
+    return tables;
+}
+
+// 检测 port::AcceleratedCRC32C 是否可用
+bool CanAccelerateCRC32C() {
+    // port::AcceleretedCRC32C returns zero when unable to accelerate.
+    static const char kTestCRCBuffer[] = "TestCRCBuffer";
+    static const char kBufSize = sizeof(kTestCRCBuffer) - 1;
+    static const uint32_t kTestCRCValue = 0xdcbc59fa;
+
+    return port::AcceleratedCRC32C(0, kTestCRCBuffer, kBufSize) == kTestCRCValue;
+}
+
+} // namespace
+
+uint32_t Extend(uint32_t crc, const char* data, size_t n) {
+    static bool accelerate = CanAccelerateCRC32C();
+    if (accelerate) {
+        return port::AcceleratedCRC32C(crc, data, n);
+    }
+
+    const uint32_t (*table)[256] = GetTables().table;
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+    const uint8_t* const limit = p + n;
+    uint32_t l = crc ^ 0xffffffffu;
+
+    while (limit - p >= 4) {
+        l ^= DecodeFixed32(reinterpret_cast<const char*>(p));
+        l = table[3][l & 0xff] ^ table[2][(l >> 8) & 0xff] ^
+            table[1][(l >> 16) & 0xff] ^ table[0][l >> 24];
+        p += 4;
+    }
+    while (p != limit) {
+        l = table[0][(l ^ *p) & 0xff] ^ (l >> 8);
+        p++;
+    }
+    return l ^ 0xffffffffu;
+}
+
+} // namespace crc32c
+} // namespace tinydb
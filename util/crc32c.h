@@ -0,0 +1,38 @@
+#ifndef STORAGE_TINYDB_UTIL_CRC32C_H_
+#define STORAGE_TINYDB_UTIL_CRC32C_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace tinydb {
+namespace crc32c {
+
+// Return the crc32c of concat(A, data[0,n-1]) where init_crc is the
+// crc32c of some string A.  Extend() is often used to maintain the
+// crc32c of a stream of data.
+uint32_t Extend(uint32_t init_crc, const char* data, size_t n);
+
+// Return the crc32c of data[0,n-1]
+inline uint32_t Value(const char* data, size_t n) { return Extend(0, data, n); }
+
+static const uint32_t kMaskDelta = 0xa282ead8ul;
+
+/*
+ * 返回 crc 的掩码形式
+ * 对包含 crc 的字符串再计算 crc 容易出问题，所以存储到文件中的 crc 都先做一次掩码
+ */
+inline uint32_t Mask(uint32_t crc) {
+    // Rotate right by 15 bits and add a constant.
+    return ((crc >> 15) | (crc << 17)) + kMaskDelta;
+}
+
+// Return the crc whose masked representation is masked_crc.
+inline uint32_t Unmask(uint32_t masked_crc) {
+    uint32_t rot = masked_crc - kMaskDelta;
+    return ((rot >> 17) | (rot << 15));
+}
+
+} // namespace crc32c
+} // namespace tinydb
+
+#endif  // STORAGE_TINYDB_UTIL_CRC32C_H_
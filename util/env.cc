@@ -0,0 +1,179 @@
+#include "tinydb/env.h"
+
+#include <cstdarg>
+
+#include "util/rate_limiter.h"
+
+namespace tinydb {
+
+Env::Env() = default;
+
+Env::~Env() = default;
+
+Status Env::NewAppendableFile(const std::string& fname, WritableFile** result) {
+    return Status::NotSupported("NewAppendableFile", fname);
+}
+
+Status Env::LinkFile(const std::string& src, const std::string& target) {
+    return Status::NotSupported("LinkFile", src);
+}
+
+Status Env::NewRandomAccessFile(const std::string& fname,
+                                const EnvOptions& options,
+                                RandomAccessFile** result) {
+    if (options.use_direct_io) {
+        *result = nullptr;
+        return Status::NotSupported("direct I/O", fname);
+    }
+    Status s = NewRandomAccessFile(fname, result);
+    if (s.ok() && options.rate_limiter != nullptr) {
+        *result = NewRateLimitedRandomAccessFile(*result, options.rate_limiter,
+                                                 options.rate_limiter_priority);
+    }
+    return s;
+}
+
+Status Env::NewWritableFile(const std::string& fname, const EnvOptions& options,
+                            WritableFile** result) {
+    if (options.use_direct_io) {
+        *result = nullptr;
+        return Status::NotSupported("direct I/O", fname);
+    }
+    Status s = NewWritableFile(fname, result);
+    if (s.ok() && options.rate_limiter != nullptr) {
+        *result = NewRateLimitedWritableFile(*result, options.rate_limiter,
+                                             options.rate_limiter_priority);
+    }
+    return s;
+}
+
+Status Env::ReuseWritableFile(const std::string& fname,
+                              const std::string& old_fname,
+                              const EnvOptions& options, WritableFile** result) {
+    Status s = RenameFile(old_fname, fname);
+    if (!s.ok()) {
+        *result = nullptr;
+        return s;
+    }
+    return NewWritableFile(fname, options, result);
+}
+
+SequentialFile::~SequentialFile() = default;
+
+RandomAccessFile::~RandomAccessFile() = default;
+
+Status RandomAccessFile::Prefetch(uint64_t offset, size_t n) const {
+    return Status::OK();
+}
+
+WritableFile::~WritableFile() = default;
+
+Logger::~Logger() = default;
+
+FileLock::~FileLock() = default;
+
+void Log(Logger* info_log, const char* format, ...) {
+    if (info_log != nullptr) {
+        std::va_list ap;
+        va_start(ap, format);
+        info_log->Logv(format, ap);
+        va_end(ap);
+    }
+}
+
+static Status DoWriteStringToFile(Env* env, const Slice& data,
+                                  const std::string& fname, bool should_sync) {
+    WritableFile* file;
+    Status s = env->NewWritableFile(fname, &file);
+    if (!s.ok()) {
+        return s;
+    }
+    s = file->Append(data);
+    if (s.ok() && should_sync) {
+        s = file->Sync();
+    }
+    if (s.ok()) {
+        s = file->Close();
+    }
+    delete file;  // Will auto-close if we did not close above
+    if (!s.ok()) {
+        env->RemoveFile(fname);
+    }
+    return s;
+}
+
+Status WriteStringToFile(Env* env, const Slice& data,
+                         const std::string& fname) {
+    return DoWriteStringToFile(env, data, fname, false);
+}
+
+Status WriteStringToFileSync(Env* env, const Slice& data,
+                             const std::string& fname) {
+    return DoWriteStringToFile(env, data, fname, true);
+}
+
+Status ReadFileToString(Env* env, const std::string& fname, std::string* data) {
+    data->clear();
+    SequentialFile* file;
+    Status s = env->NewSequentialFile(fname, &file);
+    if (!s.ok()) {
+        return s;
+    }
+    static const int kBufferSize = 8192;
+    char* space = new char[kBufferSize];
+    while (true) {
+        Slice fragment;
+        s = file->Read(kBufferSize, &fragment, space);
+        if (!s.ok()) {
+            break;
+        }
+        data->append(fragment.data(), fragment.size());
+        if (fragment.empty()) {
+            break;
+        }
+    }
+    delete[] space;
+    delete file;
+    return s;
+}
+
+Status CopyFile(Env* env, const std::string& src, const std::string& target) {
+    SequentialFile* src_file;
+    Status s = env->NewSequentialFile(src, &src_file);
+    if (!s.ok()) {
+        return s;
+    }
+    WritableFile* dest_file;
+    s = env->NewWritableFile(target, &dest_file);
+    if (!s.ok()) {
+        delete src_file;
+        return s;
+    }
+    static const int kBufferSize = 64 * 1024;
+    char* space = new char[kBufferSize];
+    while (s.ok()) {
+        Slice fragment;
+        s = src_file->Read(kBufferSize, &fragment, space);
+        if (!s.ok() || fragment.empty()) {
+            break;
+        }
+        s = dest_file->Append(fragment);
+    }
+    if (s.ok()) {
+        s = dest_file->Sync();
+    }
+    if (s.ok()) {
+        s = dest_file->Close();
+    }
+    delete[] space;
+    delete dest_file;
+    delete src_file;
+    if (!s.ok()) {
+        env->RemoveFile(target);
+    }
+    return s;
+}
+
+EnvWrapper::~EnvWrapper() {}
+
+} // namespace tinydb
@@ -0,0 +1,883 @@
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <set>
+#include <string>
+#include <thread>
+
+#include "port/port.h"
+#include "port/thread_annotations.h"
+#include "tinydb/env.h"
+#include "tinydb/slice.h"
+#include "tinydb/status.h"
+#include "util/aligned_buffer.h"
+#include "util/rate_limiter.h"
+
+namespace tinydb {
+
+namespace {
+
+// Common flags defined for all posix open operations
+#if HAVE_O_CLOEXEC
+constexpr const int kOpenBaseFlags = O_CLOEXEC;
+#else
+constexpr const int kOpenBaseFlags = 0;
+#endif  // defined(HAVE_O_CLOEXEC)
+
+constexpr const size_t kWritableFileBufferSize = 65536;
+
+// 直接 I/O 的对齐大小，常见文件系统的逻辑块大小不超过 4KB
+constexpr const size_t kDirectIOAlignment = 4096;
+
+// 直接 I/O 写文件的缓冲区大小，攒够这么多再写，减少系统调用次数
+constexpr const size_t kDirectWriteBufferSize = 1024 * 1024;
+
+// 直接 I/O 随机读时每个线程复用的对齐缓冲区大小，更大的读取临时分配
+constexpr const size_t kDirectReadBufferSize = 256 * 1024;
+
+Status PosixError(const std::string& context, int error_number) {
+    if (error_number == ENOENT) {
+        return Status::NotFound(context, std::strerror(error_number));
+    } else {
+        return Status::IOError(context, std::strerror(error_number));
+    }
+}
+
+// 用 read() 顺序读文件
+class PosixSequentialFile final : public SequentialFile {
+public:
+    PosixSequentialFile(std::string filename, int fd)
+            : fd_(fd), filename_(std::move(filename)) {}
+    ~PosixSequentialFile() override { close(fd_); }
+
+    Status Read(size_t n, Slice* result, char* scratch) override {
+        Status status;
+        while (true) {
+            ::ssize_t read_size = ::read(fd_, scratch, n);
+            if (read_size < 0) {  // Read error.
+                if (errno == EINTR) {
+                    continue;  // Retry
+                }
+                status = PosixError(filename_, errno);
+                break;
+            }
+            *result = Slice(scratch, read_size);
+            break;
+        }
+        return status;
+    }
+
+    Status Skip(uint64_t n) override {
+        if (::lseek(fd_, n, SEEK_CUR) == static_cast<off_t>(-1)) {
+            return PosixError(filename_, errno);
+        }
+        return Status::OK();
+    }
+
+private:
+    const int fd_;
+    const std::string filename_;
+};
+
+// 用 pread() 随机读文件，不修改文件偏移，可以被多个线程并发使用
+class PosixRandomAccessFile final : public RandomAccessFile {
+public:
+    PosixRandomAccessFile(std::string filename, int fd)
+            : fd_(fd), filename_(std::move(filename)) {}
+    ~PosixRandomAccessFile() override { close(fd_); }
+
+    Status Read(uint64_t offset, size_t n, Slice* result,
+                char* scratch) const override {
+        Status status;
+        ssize_t read_size = ::pread(fd_, scratch, n, static_cast<off_t>(offset));
+        *result = Slice(scratch, (read_size < 0) ? 0 : read_size);
+        if (read_size < 0) {
+            // An error: return a non-ok status.
+            status = PosixError(filename_, errno);
+        }
+        return status;
+    }
+
+    Status Prefetch(uint64_t offset, size_t n) const override {
+#if defined(__linux__)
+        // readahead() 发起异步读入页缓存后立即返回
+        ::readahead(fd_, static_cast<off64_t>(offset), n);
+#elif defined(POSIX_FADV_WILLNEED)
+        ::posix_fadvise(fd_, static_cast<off_t>(offset), static_cast<off_t>(n),
+                        POSIX_FADV_WILLNEED);
+#endif
+        return Status::OK();
+    }
+
+private:
+    const int fd_;
+    const std::string filename_;
+};
+
+/*
+ * 带 64KB 缓冲区的顺序写文件
+ * 写 manifest 时 Sync() 还要 fsync 所在目录，保证新文件的目录项已经持久化
+ */
+class PosixWritableFile final : public WritableFile {
+public:
+    // preallocated: 文件开头已经分配了空间的字节数，复用旧文件时为旧文件的大小
+    PosixWritableFile(std::string filename, int fd, uint64_t bytes_per_sync = 0,
+                      uint64_t preallocation_block_size = 0,
+                      uint64_t preallocated = 0)
+            : pos_(0),
+              fd_(fd),
+              bytes_per_sync_(bytes_per_sync),
+              written_(0),
+              last_range_sync_(0),
+              preallocation_block_size_(preallocation_block_size),
+              preallocated_(preallocated),
+              is_manifest_(IsManifest(filename)),
+              filename_(std::move(filename)),
+              dirname_(Dirname(filename_)) {}
+
+    ~PosixWritableFile() override {
+        if (fd_ >= 0) {
+            // Ignoring any potential errors
+            Close();
+        }
+    }
+
+    Status Append(const Slice& data) override {
+        size_t write_size = data.size();
+        const char* write_data = data.data();
+
+        // 尽量放进缓冲区
+        size_t copy_size = std::min(write_size, kWritableFileBufferSize - pos_);
+        std::memcpy(buf_ + pos_, write_data, copy_size);
+        write_data += copy_size;
+        write_size -= copy_size;
+        pos_ += copy_size;
+        if (write_size == 0) {
+            return Status::OK();
+        }
+
+        // 缓冲区满了，先写出去
+        Status status = FlushBuffer();
+        if (!status.ok()) {
+            return status;
+        }
+
+        // 剩下的数据小的放进缓冲区，大的直接写
+        if (write_size < kWritableFileBufferSize) {
+            std::memcpy(buf_, write_data, write_size);
+            pos_ = write_size;
+            return Status::OK();
+        }
+        return WriteUnbuffered(write_data, write_size);
+    }
+
+    Status Close() override {
+        Status status = FlushBuffer();
+        const int close_result = ::close(fd_);
+        if (close_result < 0 && status.ok()) {
+            status = PosixError(filename_, errno);
+        }
+        fd_ = -1;
+        return status;
+    }
+
+    Status Flush() override { return FlushBuffer(); }
+
+    Status Sync() override {
+        // manifest 引用的文件必须在 manifest 之前持久化，所以先 fsync 目录
+        Status status = SyncDirIfManifest();
+        if (!status.ok()) {
+            return status;
+        }
+
+        status = FlushBuffer();
+        if (!status.ok()) {
+            return status;
+        }
+
+        return SyncFd(fd_, filename_);
+    }
+
+private:
+    Status FlushBuffer() {
+        Status status = WriteUnbuffered(buf_, pos_);
+        pos_ = 0;
+        return status;
+    }
+
+    Status WriteUnbuffered(const char* data, size_t size) {
+        PreallocateIfNeeded(size);
+        while (size > 0) {
+            ssize_t write_result = ::write(fd_, data, size);
+            if (write_result < 0) {
+                if (errno == EINTR) {
+                    continue;  // Retry
+                }
+                return PosixError(filename_, errno);
+            }
+            data += write_result;
+            size -= write_result;
+            written_ += write_result;
+        }
+        RangeSyncIfNeeded();
+        return Status::OK();
+    }
+
+    // 接下来要写 size 字节，超出已分配的范围时按 preallocation_block_size_ 的整数倍再分配
+    void PreallocateIfNeeded(size_t size) {
+#if defined(FALLOC_FL_KEEP_SIZE)
+        if (preallocation_block_size_ == 0 || written_ + size <= preallocated_) {
+            return;
+        }
+        const uint64_t end = written_ + size;
+        const uint64_t new_end = (end + preallocation_block_size_ - 1) /
+                                 preallocation_block_size_ * preallocation_block_size_;
+        // KEEP_SIZE: 只分配空间不改变文件大小，读者不会看到还没写入的部分
+        if (::fallocate(fd_, FALLOC_FL_KEEP_SIZE, static_cast<off_t>(preallocated_),
+                        static_cast<off_t>(new_end - preallocated_)) == 0) {
+            preallocated_ = new_end;
+        } else {
+            // 文件系统不支持，之后不再尝试
+            preallocation_block_size_ = 0;
+        }
+#endif
+    }
+
+    // 每写入 bytes_per_sync_ 字节，让内核开始异步写回这一段，不等待写回完成
+    void RangeSyncIfNeeded() {
+#if defined(SYNC_FILE_RANGE_WRITE)
+        if (bytes_per_sync_ > 0 && written_ - last_range_sync_ >= bytes_per_sync_) {
+            ::sync_file_range(fd_, static_cast<off64_t>(last_range_sync_),
+                              static_cast<off64_t>(written_ - last_range_sync_),
+                              SYNC_FILE_RANGE_WRITE);
+            last_range_sync_ = written_;
+        }
+#endif
+    }
+
+    Status SyncDirIfManifest() {
+        Status status;
+        if (!is_manifest_) {
+            return status;
+        }
+
+        int fd = ::open(dirname_.c_str(), O_RDONLY | kOpenBaseFlags);
+        if (fd < 0) {
+            status = PosixError(dirname_, errno);
+        } else {
+            status = SyncFd(fd, dirname_);
+            ::close(fd);
+        }
+        return status;
+    }
+
+    static Status SyncFd(int fd, const std::string& fd_path) {
+#if HAVE_FULLFSYNC
+        // On macOS and iOS, fsync() doesn't guarantee durability past power
+        // failures. fcntl(F_FULLFSYNC) is required for that purpose.
+        if (::fcntl(fd, F_FULLFSYNC) == 0) {
+            return Status::OK();
+        }
+#endif  // HAVE_FULLFSYNC
+
+#if HAVE_FDATASYNC
+        bool sync_success = ::fdatasync(fd) == 0;
+#else
+        bool sync_success = ::fsync(fd) == 0;
+#endif  // HAVE_FDATASYNC
+
+        if (sync_success) {
+            return Status::OK();
+        }
+        return PosixError(fd_path, errno);
+    }
+
+    // 返回 filename 所在的目录
+    static std::string Dirname(const std::string& filename) {
+        std::string::size_type separator_pos = filename.rfind('/');
+        if (separator_pos == std::string::npos) {
+            return std::string(".");
+        }
+        // The filename component should not contain a path separator.
+        assert(filename.find('/', separator_pos + 1) == std::string::npos);
+
+        return filename.substr(0, separator_pos);
+    }
+
+    // 去掉目录部分后的文件名
+    static Slice Basename(const std::string& filename) {
+        std::string::size_type separator_pos = filename.rfind('/');
+        if (separator_pos == std::string::npos) {
+            return Slice(filename);
+        }
+        return Slice(filename.data() + separator_pos + 1,
+                     filename.length() - separator_pos - 1);
+    }
+
+    static bool IsManifest(const std::string& filename) {
+        return Basename(filename).starts_with("MANIFEST");
+    }
+
+    // buf_[0, pos_ - 1] contains data to be written to fd_.
+    char buf_[kWritableFileBufferSize];
+    size_t pos_;
+    int fd_;
+
+    const uint64_t bytes_per_sync_;
+    uint64_t written_;          // 已经写到 fd_ 的字节数
+    uint64_t last_range_sync_;  // 上次开始写回的位置
+    uint64_t preallocation_block_size_;
+    uint64_t preallocated_;     // 文件开头已经分配了空间的字节数
+
+    const bool is_manifest_;  // True if the file's name starts with MANIFEST.
+    const std::string filename_;
+    const std::string dirname_;  // The directory of filename_.
+};
+
+/*
+ * 直接 I/O 随机读
+ * 偏移、长度和 scratch 都已对齐时直接读入 scratch；否则把偏移和长度扩展到对齐边界，
+ * 读到当前线程复用的对齐缓冲区中再拷贝出来
+ */
+class PosixDirectRandomAccessFile final : public RandomAccessFile {
+public:
+    PosixDirectRandomAccessFile(std::string filename, int fd)
+            : fd_(fd), filename_(std::move(filename)) {}
+    ~PosixDirectRandomAccessFile() override { close(fd_); }
+
+    Status Read(uint64_t offset, size_t n, Slice* result,
+                char* scratch) const override {
+        size_t read = 0;
+        if (offset % kDirectIOAlignment == 0 && n % kDirectIOAlignment == 0 &&
+            reinterpret_cast<uintptr_t>(scratch) % kDirectIOAlignment == 0) {
+            Status s = ReadAligned(offset, n, scratch, &read);
+            *result = Slice(scratch, s.ok() ? read : 0);
+            return s;
+        }
+
+        const uint64_t aligned_offset = TruncateToPageBoundary(kDirectIOAlignment, offset);
+        const size_t offset_advance = static_cast<size_t>(offset - aligned_offset);
+        const size_t size = Roundup(offset_advance + n, kDirectIOAlignment);
+
+        AlignedBuffer* buf = ThreadLocalBuffer();
+        AlignedBuffer large(kDirectIOAlignment);
+        if (size > buf->Capacity()) {
+            large.AllocateNewBuffer(size);
+            buf = &large;
+        }
+        Status s = ReadAligned(aligned_offset, size, buf->BufferStart(), &read);
+        if (!s.ok()) {
+            *result = Slice(scratch, 0);
+            return s;
+        }
+
+        size_t copied = 0;
+        if (read > offset_advance) {
+            copied = std::min(read - offset_advance, n);
+            std::memcpy(scratch, buf->BufferStart() + offset_advance, copied);
+        }
+        *result = Slice(scratch, copied);
+        return Status::OK();
+    }
+
+private:
+    // 当前线程复用的读缓冲区，线程退出时释放
+    static AlignedBuffer* ThreadLocalBuffer() {
+        static thread_local AlignedBuffer buf(kDirectIOAlignment);
+        if (buf.Capacity() == 0) {
+            buf.AllocateNewBuffer(kDirectReadBufferSize);
+        }
+        return &buf;
+    }
+
+    // 从对齐的 offset 读取 size 字节到对齐的 dst，*read 为实际读到的字节数(遇到文件末尾时更少)
+    Status ReadAligned(uint64_t offset, size_t size, char* dst, size_t* read) const {
+        *read = 0;
+        while (*read < size) {
+            ssize_t r = ::pread(fd_, dst + *read, size - *read,
+                                static_cast<off_t>(offset + *read));
+            if (r < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return PosixError(filename_, errno);
+            }
+            if (r == 0) {
+                break;  // EOF
+            }
+            *read += r;
+        }
+        return Status::OK();
+    }
+
+    const int fd_;
+    const std::string filename_;
+};
+
+/*
+ * 直接 I/O 顺序写
+ * 数据先攒在对齐的缓冲区中，满了之后按对齐的偏移整块写出
+ * Sync()/Close() 时末尾不满一块的部分补 0 写出，并保留在缓冲区中，
+ * 下次从同一个对齐的偏移重新写；Close() 时再把文件截断到实际长度
+ */
+class PosixDirectWritableFile final : public WritableFile {
+public:
+    PosixDirectWritableFile(std::string filename, int fd)
+            : fd_(fd),
+              buf_(kDirectIOAlignment),
+              file_offset_(0),
+              file_size_(0),
+              filename_(std::move(filename)) {
+        buf_.AllocateNewBuffer(kDirectWriteBufferSize);
+    }
+
+    ~PosixDirectWritableFile() override {
+        if (fd_ >= 0) {
+            // Ignoring any potential errors
+            Close();
+        }
+    }
+
+    Status Append(const Slice& data) override {
+        const char* src = data.data();
+        size_t left = data.size();
+        while (left > 0) {
+            const size_t appended = buf_.Append(src, left);
+            src += appended;
+            left -= appended;
+            file_size_ += appended;
+            if (buf_.CurrentSize() == buf_.Capacity()) {
+                Status s = WriteAligned(buf_.CurrentSize());
+                if (!s.ok()) {
+                    return s;
+                }
+                file_offset_ += buf_.CurrentSize();
+                buf_.Size(0);
+            }
+        }
+        return Status::OK();
+    }
+
+    // 不满一块的数据无法单独写出，留到 Sync()/Close()
+    Status Flush() override { return Status::OK(); }
+
+    Status Sync() override {
+        Status s = WritePadded();
+#if HAVE_FDATASYNC
+        if (s.ok() && ::fdatasync(fd_) != 0) {
+#else
+        if (s.ok() && ::fsync(fd_) != 0) {
+#endif  // HAVE_FDATASYNC
+            s = PosixError(filename_, errno);
+        }
+        return s;
+    }
+
+    Status Close() override {
+        Status s = WritePadded();
+        if (s.ok() && ::ftruncate(fd_, static_cast<off_t>(file_size_)) != 0) {
+            s = PosixError(filename_, errno);
+        }
+        if (::close(fd_) < 0 && s.ok()) {
+            s = PosixError(filename_, errno);
+        }
+        fd_ = -1;
+        return s;
+    }
+
+private:
+    // 把缓冲区的前 size 字节写到 file_offset_，size 必须是对齐的
+    Status WriteAligned(size_t size) {
+        assert(size % kDirectIOAlignment == 0);
+        const char* src = buf_.BufferStart();
+        size_t written = 0;
+        while (written < size) {
+            ssize_t r = ::pwrite(fd_, src + written, size - written,
+                                 static_cast<off_t>(file_offset_ + written));
+            if (r < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return PosixError(filename_, errno);
+            }
+            written += r;
+        }
+        return Status::OK();
+    }
+
+    // 写出缓冲区中的全部数据，末尾补齐到对齐长度
+    Status WritePadded() {
+        const size_t size = buf_.CurrentSize();
+        if (size == 0) {
+            return Status::OK();
+        }
+        Status s = WriteAligned(buf_.PadToAlignment());
+        if (!s.ok()) {
+            return s;
+        }
+        // 对齐的部分已经落盘，末尾不满一块的部分下次从同一位置重写
+        const size_t aligned = TruncateToPageBoundary(kDirectIOAlignment, size);
+        buf_.RefitTail(aligned);
+        file_offset_ += aligned;
+        return Status::OK();
+    }
+
+    int fd_;
+    AlignedBuffer buf_;
+    uint64_t file_offset_;  // buf_ 开头对应的文件偏移，总是对齐的
+    uint64_t file_size_;    // 已追加的数据总长度
+    const std::string filename_;
+};
+
+// 以直接 I/O 方式打开文件，文件系统不支持时返回 NotSupported
+Status OpenDirect(const std::string& filename, int flags, int* fd) {
+#if defined(O_DIRECT)
+    *fd = ::open(filename.c_str(), flags | O_DIRECT | kOpenBaseFlags, 0644);
+    if (*fd < 0) {
+        if (errno == EINVAL) {
+            return Status::NotSupported("direct I/O", filename);
+        }
+        return PosixError(filename, errno);
+    }
+    return Status::OK();
+#elif defined(F_NOCACHE)
+    *fd = ::open(filename.c_str(), flags | kOpenBaseFlags, 0644);
+    if (*fd < 0) {
+        return PosixError(filename, errno);
+    }
+    if (::fcntl(*fd, F_NOCACHE, 1) == -1) {
+        ::close(*fd);
+        return Status::NotSupported("direct I/O", filename);
+    }
+    return Status::OK();
+#else
+    return Status::NotSupported("direct I/O", filename);
+#endif
+}
+
+int LockOrUnlock(int fd, bool lock) {
+    errno = 0;
+    struct ::flock file_lock_info;
+    std::memset(&file_lock_info, 0, sizeof(file_lock_info));
+    file_lock_info.l_type = (lock ? F_WRLCK : F_UNLCK);
+    file_lock_info.l_whence = SEEK_SET;
+    file_lock_info.l_start = 0;
+    file_lock_info.l_len = 0;  // Lock/unlock entire file.
+    return ::fcntl(fd, F_SETLK, &file_lock_info);
+}
+
+class PosixFileLock : public FileLock {
+public:
+    PosixFileLock(int fd, std::string filename)
+            : fd_(fd), filename_(std::move(filename)) {}
+
+    int fd() const { return fd_; }
+    const std::string& filename() const { return filename_; }
+
+private:
+    const int fd_;
+    const std::string filename_;
+};
+
+/*
+ * fcntl 锁只在进程之间互斥，同一个进程内重复加锁也会成功，
+ * 所以另外记录本进程已经锁住的文件
+ */
+class PosixLockTable {
+public:
+    bool Insert(const std::string& fname) LOCKS_EXCLUDED(mu_) {
+        mu_.Lock();
+        bool succeeded = locked_files_.insert(fname).second;
+        mu_.Unlock();
+        return succeeded;
+    }
+    void Remove(const std::string& fname) LOCKS_EXCLUDED(mu_) {
+        mu_.Lock();
+        locked_files_.erase(fname);
+        mu_.Unlock();
+    }
+
+private:
+    port::Mutex mu_;
+    std::set<std::string> locked_files_ GUARDED_BY(mu_);
+};
+
+class PosixEnv : public Env {
+public:
+    PosixEnv() = default;
+    ~PosixEnv() override {
+        static const char msg[] =
+                "PosixEnv singleton destroyed. Unsupported behavior!\n";
+        std::fwrite(msg, 1, sizeof(msg), stderr);
+        std::abort();
+    }
+
+    Status NewSequentialFile(const std::string& filename,
+                             SequentialFile** result) override {
+        int fd = ::open(filename.c_str(), O_RDONLY | kOpenBaseFlags);
+        if (fd < 0) {
+            *result = nullptr;
+            return PosixError(filename, errno);
+        }
+
+#if defined(POSIX_FADV_SEQUENTIAL)
+        // 顺序读取整个文件，让内核使用更大的预读窗口
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+        *result = new PosixSequentialFile(filename, fd);
+        return Status::OK();
+    }
+
+    Status NewRandomAccessFile(const std::string& filename,
+                               RandomAccessFile** result) override {
+        *result = nullptr;
+        int fd = ::open(filename.c_str(), O_RDONLY | kOpenBaseFlags);
+        if (fd < 0) {
+            return PosixError(filename, errno);
+        }
+
+        *result = new PosixRandomAccessFile(filename, fd);
+        return Status::OK();
+    }
+
+    Status NewWritableFile(const std::string& filename,
+                           WritableFile** result) override {
+        int fd = ::open(filename.c_str(),
+                        O_TRUNC | O_WRONLY | O_CREAT | kOpenBaseFlags, 0644);
+        if (fd < 0) {
+            *result = nullptr;
+            return PosixError(filename, errno);
+        }
+
+        *result = new PosixWritableFile(filename, fd);
+        return Status::OK();
+    }
+
+    Status NewRandomAccessFile(const std::string& filename,
+                               const EnvOptions& options,
+                               RandomAccessFile** result) override {
+        Status s;
+        if (!options.use_direct_io) {
+            s = NewRandomAccessFile(filename, result);
+        } else {
+            *result = nullptr;
+            int fd;
+            s = OpenDirect(filename, O_RDONLY, &fd);
+            if (s.ok()) {
+                *result = new PosixDirectRandomAccessFile(filename, fd);
+            }
+        }
+        if (s.ok() && options.rate_limiter != nullptr) {
+            *result = NewRateLimitedRandomAccessFile(*result, options.rate_limiter,
+                                                     options.rate_limiter_priority);
+        }
+        return s;
+    }
+
+    Status NewWritableFile(const std::string& filename,
+                           const EnvOptions& options,
+                           WritableFile** result) override {
+        *result = nullptr;
+        Status s;
+        if (!options.use_direct_io) {
+            int fd = ::open(filename.c_str(),
+                            O_TRUNC | O_WRONLY | O_CREAT | kOpenBaseFlags, 0644);
+            if (fd < 0) {
+                return PosixError(filename, errno);
+            }
+            *result = new PosixWritableFile(filename, fd, options.bytes_per_sync,
+                                            options.preallocation_block_size);
+        } else {
+            int fd;
+            s = OpenDirect(filename, O_TRUNC | O_WRONLY | O_CREAT, &fd);
+            if (s.ok()) {
+                *result = new PosixDirectWritableFile(filename, fd);
+            }
+        }
+        if (s.ok() && options.rate_limiter != nullptr) {
+            *result = NewRateLimitedWritableFile(*result, options.rate_limiter,
+                                                 options.rate_limiter_priority);
+        }
+        return s;
+    }
+
+    Status NewAppendableFile(const std::string& filename,
+                             WritableFile** result) override {
+        int fd = ::open(filename.c_str(),
+                        O_APPEND | O_WRONLY | O_CREAT | kOpenBaseFlags, 0644);
+        if (fd < 0) {
+            *result = nullptr;
+            return PosixError(filename, errno);
+        }
+
+        *result = new PosixWritableFile(filename, fd);
+        return Status::OK();
+    }
+
+    Status ReuseWritableFile(const std::string& filename,
+                             const std::string& old_filename,
+                             const EnvOptions& options,
+                             WritableFile** result) override {
+        *result = nullptr;
+        if (options.use_direct_io) {
+            return Status::NotSupported("direct I/O", filename);
+        }
+        Status s = RenameFile(old_filename, filename);
+        if (!s.ok()) {
+            return s;
+        }
+        // 不带 O_TRUNC，从头覆盖写，旧的内容和已分配的空间都保留
+        int fd = ::open(filename.c_str(), O_WRONLY | kOpenBaseFlags, 0644);
+        if (fd < 0) {
+            return PosixError(filename, errno);
+        }
+        struct ::stat file_stat;
+        if (::fstat(fd, &file_stat) != 0) {
+            s = PosixError(filename, errno);
+            ::close(fd);
+            return s;
+        }
+        *result = new PosixWritableFile(filename, fd, options.bytes_per_sync,
+                                        options.preallocation_block_size,
+                                        static_cast<uint64_t>(file_stat.st_size));
+        if (options.rate_limiter != nullptr) {
+            *result = NewRateLimitedWritableFile(*result, options.rate_limiter,
+                                                 options.rate_limiter_priority);
+        }
+        return Status::OK();
+    }
+
+    bool FileExists(const std::string& filename) override {
+        return ::access(filename.c_str(), F_OK) == 0;
+    }
+
+    Status GetChildren(const std::string& directory_path,
+                       std::vector<std::string>* result) override {
+        result->clear();
+        ::DIR* dir = ::opendir(directory_path.c_str());
+        if (dir == nullptr) {
+            return PosixError(directory_path, errno);
+        }
+        struct ::dirent* entry;
+        while ((entry = ::readdir(dir)) != nullptr) {
+            result->emplace_back(entry->d_name);
+        }
+        ::closedir(dir);
+        return Status::OK();
+    }
+
+    Status RemoveFile(const std::string& filename) override {
+        if (::unlink(filename.c_str()) != 0) {
+            return PosixError(filename, errno);
+        }
+        return Status::OK();
+    }
+
+    Status CreateDir(const std::string& dirname) override {
+        if (::mkdir(dirname.c_str(), 0755) != 0) {
+            return PosixError(dirname, errno);
+        }
+        return Status::OK();
+    }
+
+    Status RemoveDir(const std::string& dirname) override {
+        if (::rmdir(dirname.c_str()) != 0) {
+            return PosixError(dirname, errno);
+        }
+        return Status::OK();
+    }
+
+    Status GetFileSize(const std::string& filename, uint64_t* size) override {
+        struct ::stat file_stat;
+        if (::stat(filename.c_str(), &file_stat) != 0) {
+            *size = 0;
+            return PosixError(filename, errno);
+        }
+        *size = file_stat.st_size;
+        return Status::OK();
+    }
+
+    Status RenameFile(const std::string& from, const std::string& to) override {
+        if (std::rename(from.c_str(), to.c_str()) != 0) {
+            return PosixError(from, errno);
+        }
+        return Status::OK();
+    }
+
+    Status LinkFile(const std::string& src, const std::string& target) override {
+        if (::link(src.c_str(), target.c_str()) != 0) {
+            if (errno == EXDEV || errno == EPERM || errno == ENOTSUP) {
+                return Status::NotSupported("link " + src, std::strerror(errno));
+            }
+            return PosixError(src, errno);
+        }
+        return Status::OK();
+    }
+
+    Status LockFile(const std::string& filename, FileLock** lock) override {
+        *lock = nullptr;
+
+        int fd = ::open(filename.c_str(), O_RDWR | O_CREAT | kOpenBaseFlags, 0644);
+        if (fd < 0) {
+            return PosixError(filename, errno);
+        }
+
+        if (!locks_.Insert(filename)) {
+            ::close(fd);
+            return Status::IOError("lock " + filename, "already held by process");
+        }
+
+        if (LockOrUnlock(fd, true) == -1) {
+            int lock_errno = errno;
+            ::close(fd);
+            locks_.Remove(filename);
+            return PosixError("lock " + filename, lock_errno);
+        }
+
+        *lock = new PosixFileLock(fd, filename);
+        return Status::OK();
+    }
+
+    Status UnlockFile(FileLock* lock) override {
+        PosixFileLock* posix_file_lock = static_cast<PosixFileLock*>(lock);
+        if (LockOrUnlock(posix_file_lock->fd(), false) == -1) {
+            return PosixError("unlock " + posix_file_lock->filename(), errno);
+        }
+        locks_.Remove(posix_file_lock->filename());
+        ::close(posix_file_lock->fd());
+        delete posix_file_lock;
+        return Status::OK();
+    }
+
+    uint64_t NowMicros() override {
+        static constexpr uint64_t kUsecondsPerSecond = 1000000;
+        struct ::timeval tv;
+        ::gettimeofday(&tv, nullptr);
+        return static_cast<uint64_t>(tv.tv_sec) * kUsecondsPerSecond + tv.tv_usec;
+    }
+
+    void SleepForMicroseconds(int micros) override {
+        std::this_thread::sleep_for(std::chrono::microseconds(micros));
+    }
+
+private:
+    PosixLockTable locks_;
+};
+
+} // namespace
+
+Env* Env::Default() {
+    // 单例不析构，PosixEnv 的析构函数会直接 abort
+    static PosixEnv* env = new PosixEnv;
+    return env;
+}
+
+} // namespace tinydb
@@ -0,0 +1,98 @@
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "tinydb/env.h"
+#include "util/aligned_buffer.h"
+#include "util/random.h"
+#include "util/testutil.h"
+
+namespace tinydb {
+
+class EnvPosixDirectIOTest : public testing::Test {
+public:
+    EnvPosixDirectIOTest() : env_(Env::Default()) {
+        dir_ = test::NewTestDirectory("env_posix_test");
+        options_.use_direct_io = true;
+    }
+
+    // 用直接 I/O 写 contents，文件系统不支持直接 I/O 时返回 false
+    bool WriteDirect(const std::string& fname, const std::string& contents) {
+        WritableFile* file;
+        Status s = env_->NewWritableFile(fname, options_, &file);
+        if (s.IsNotSupportedError()) {
+            return false;
+        }
+        EXPECT_TRUE(s.ok()) << s.ToString();
+        // 分成大小不一的片段追加，中间 Sync() 一次，末尾不满一块的部分要重写
+        Random rnd(301);
+        size_t pos = 0;
+        while (pos < contents.size()) {
+            const size_t n = std::min<size_t>(contents.size() - pos, 1 + rnd.Uniform(20000));
+            EXPECT_TRUE(file->Append(Slice(contents.data() + pos, n)).ok());
+            pos += n;
+            if (pos > contents.size() / 2 && pos - n <= contents.size() / 2) {
+                EXPECT_TRUE(file->Sync().ok());
+            }
+        }
+        EXPECT_TRUE(file->Close().ok());
+        delete file;
+        return true;
+    }
+
+    Env* env_;
+    EnvOptions options_;
+    std::string dir_;
+};
+
+TEST_F(EnvPosixDirectIOTest, ReadWrite) {
+    const std::string fname = dir_ + "/direct";
+    Random rnd(17);
+    std::string contents;
+    // 不是对齐大小的整数倍
+    test::RandomString(&rnd, 3 * 1024 * 1024 + 123, &contents);
+    if (!WriteDirect(fname, contents)) {
+        GTEST_SKIP() << "direct I/O is not supported";
+    }
+    uint64_t size;
+    ASSERT_TRUE(env_->GetFileSize(fname, &size).ok());
+    ASSERT_EQ(contents.size(), size);
+
+    RandomAccessFile* raw;
+    ASSERT_TRUE(env_->NewRandomAccessFile(fname, options_, &raw).ok());
+    std::unique_ptr<RandomAccessFile> file(raw);
+
+    std::vector<char> scratch(2 * 1024 * 1024);
+    Slice result;
+    // 任意偏移和长度，包括超过每线程缓冲区的读取
+    for (int i = 0; i < 500; i++) {
+        const size_t n = rnd.OneIn(10) ? 300 * 1024 + rnd.Uniform(1 << 20) : rnd.Uniform(20000);
+        const uint64_t offset = rnd.Uniform(static_cast<int>(contents.size()));
+        ASSERT_TRUE(file->Read(offset, n, &result, scratch.data()).ok());
+        const size_t expected = std::min<size_t>(n, contents.size() - offset);
+        ASSERT_EQ(expected, result.size()) << offset << " " << n;
+        ASSERT_EQ(0, std::memcmp(contents.data() + offset, result.data(), expected))
+                << offset << " " << n;
+    }
+
+    // 偏移、长度和缓冲区都对齐时直接读入 scratch
+    AlignedBuffer aligned(4096);
+    aligned.AllocateNewBuffer(64 * 1024);
+    ASSERT_TRUE(file->Read(8192, 64 * 1024, &result, aligned.BufferStart()).ok());
+    EXPECT_EQ(aligned.BufferStart(), result.data());
+    ASSERT_EQ(64u * 1024, result.size());
+    EXPECT_EQ(0, std::memcmp(contents.data() + 8192, result.data(), result.size()));
+
+    // 读到文件末尾时返回较短的结果
+    const uint64_t tail = contents.size() / 4096 * 4096;
+    ASSERT_TRUE(file->Read(tail, 8192, &result, aligned.BufferStart()).ok());
+    ASSERT_EQ(contents.size() - tail, result.size());
+    EXPECT_EQ(0, std::memcmp(contents.data() + tail, result.data(), result.size()));
+    ASSERT_TRUE(file->Read(contents.size() + 10, 100, &result, scratch.data()).ok());
+    EXPECT_EQ(0u, result.size());
+}
+
+} // namespace tinydb
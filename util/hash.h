@@ -0,0 +1,14 @@
+#ifndef STORAGE_TINYDB_UTIL_HASH_H_
+#define STORAGE_TINYDB_UTIL_HASH_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace tinydb {
+
+// 与 murmur hash 类似的简单哈希，用于 cache 分片和 bloom filter
+uint32_t Hash(const char* data, size_t n, uint32_t seed);
+
+} // namespace tinydb
+
+#endif  // STORAGE_TINYDB_UTIL_HASH_H_
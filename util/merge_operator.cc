@@ -0,0 +1,107 @@
+#include "tinydb/merge_operator.h"
+
+#include "tinydb/slice.h"
+#include "util/coding.h"
+
+namespace tinydb {
+
+MergeOperator::~MergeOperator() = default;
+
+bool MergeOperator::PartialMerge(const Slice& key, const Slice& left_operand,
+                                 const Slice& right_operand,
+                                 std::string* new_value) const {
+    return false;
+}
+
+namespace {
+
+class UInt64AddOperator : public MergeOperator {
+public:
+    const char* Name() const override { return "tinydb.UInt64AddOperator"; }
+
+    bool FullMerge(const Slice& key, const Slice* existing_value,
+                   const std::vector<Slice>& operands,
+                   std::string* new_value) const override {
+        uint64_t sum = 0;
+        if (existing_value != nullptr && !Decode(*existing_value, &sum)) {
+            return false;
+        }
+        for (size_t i = 0; i < operands.size(); i++) {
+            uint64_t operand;
+            if (!Decode(operands[i], &operand)) {
+                return false;
+            }
+            sum += operand;
+        }
+        new_value->clear();
+        PutFixed64(new_value, sum);
+        return true;
+    }
+
+    bool PartialMerge(const Slice& key, const Slice& left_operand,
+                      const Slice& right_operand,
+                      std::string* new_value) const override {
+        uint64_t left, right;
+        if (!Decode(left_operand, &left) || !Decode(right_operand, &right)) {
+            return false;
+        }
+        new_value->clear();
+        PutFixed64(new_value, left + right);
+        return true;
+    }
+
+private:
+    // 不是 8 字节的定长整数时返回 false
+    static bool Decode(const Slice& value, uint64_t* result) {
+        if (value.size() != sizeof(uint64_t)) {
+            return false;
+        }
+        *result = DecodeFixed64(value.data());
+        return true;
+    }
+};
+
+class StringAppendOperator : public MergeOperator {
+public:
+    explicit StringAppendOperator(char delim) : delim_(delim) {}
+
+    const char* Name() const override { return "tinydb.StringAppendOperator"; }
+
+    bool FullMerge(const Slice& key, const Slice* existing_value,
+                   const std::vector<Slice>& operands,
+                   std::string* new_value) const override {
+        new_value->clear();
+        if (existing_value != nullptr) {
+            new_value->assign(existing_value->data(), existing_value->size());
+        }
+        for (size_t i = 0; i < operands.size(); i++) {
+            if (i > 0 || existing_value != nullptr) {
+                new_value->push_back(delim_);
+            }
+            new_value->append(operands[i].data(), operands[i].size());
+        }
+        return true;
+    }
+
+    bool PartialMerge(const Slice& key, const Slice& left_operand,
+                      const Slice& right_operand,
+                      std::string* new_value) const override {
+        new_value->assign(left_operand.data(), left_operand.size());
+        new_value->push_back(delim_);
+        new_value->append(right_operand.data(), right_operand.size());
+        return true;
+    }
+
+private:
+    const char delim_;
+};
+
+} // namespace
+
+const MergeOperator* NewUInt64AddOperator() { return new UInt64AddOperator; }
+
+const MergeOperator* NewStringAppendOperator(char delim) {
+    return new StringAppendOperator(delim);
+}
+
+} // namespace tinydb
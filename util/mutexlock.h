@@ -0,0 +1,33 @@
+#ifndef STORAGE_TINYDB_UTIL_MUTEXLOCK_H_
+#define STORAGE_TINYDB_UTIL_MUTEXLOCK_H_
+
+#include "port/port.h"
+#include "port/thread_annotations.h"
+
+namespace tinydb {
+
+/*
+ * 构造时加锁、析构时解锁的辅助类，例如：
+ *
+ *   void MyClass::MyMethod() {
+ *     MutexLock l(&mu_);       // mu_ is an instance variable
+ *     ... some complex code, possibly with multiple return paths ...
+ *   }
+ */
+class SCOPED_LOCKABLE MutexLock {
+public:
+    explicit MutexLock(port::Mutex* mu) EXCLUSIVE_LOCK_FUNCTION(mu) : mu_(mu) {
+        this->mu_->Lock();
+    }
+    ~MutexLock() UNLOCK_FUNCTION() { this->mu_->Unlock(); }
+
+    MutexLock(const MutexLock&) = delete;
+    MutexLock& operator=(const MutexLock&) = delete;
+
+private:
+    port::Mutex* const mu_;
+};
+
+} // namespace tinydb
+
+#endif  // STORAGE_TINYDB_UTIL_MUTEXLOCK_H_
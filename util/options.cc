@@ -1,10 +1,10 @@
 #include "tinydb//options.h"
 
-//#include "tinydb//comparator.h"
-//#include "tinydb//env.h"
+#include "tinydb//comparator.h"
+#include "tinydb//env.h"
 
 namespace tinydb {
 
-Options::Options() {}
+Options::Options() : comparator(BytewiseComparator()), env(Env::Default()) {}
 
 }  // namespace tinydb
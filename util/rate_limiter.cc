@@ -0,0 +1,318 @@
+#include "util/rate_limiter.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "tinydb/env.h"
+#include "util/mutexlock.h"
+
+namespace tinydb {
+
+RateLimiter::~RateLimiter() = default;
+
+namespace {
+
+// 自动调整的窗口为这么多个 refill 周期
+const int kTuneIntervalPeriods = 10;
+
+// 窗口内前台延迟的样本少于这个数时不根据延迟降速，避免被个别慢请求误导
+const uint64_t kMinLatencySamples = 8;
+
+} // namespace
+
+struct GenericRateLimiter::Req {
+    Req(int64_t bytes, port::Mutex* mu)
+        : request_bytes(bytes), granted(false), cv(mu) {}
+
+    int64_t request_bytes;  // 还没有得到的配额
+    bool granted;
+    port::CondVar cv;
+};
+
+GenericRateLimiter::GenericRateLimiter(int64_t rate_bytes_per_sec,
+                                       int64_t refill_period_us,
+                                       int32_t fairness, bool auto_tuned,
+                                       uint64_t foreground_latency_target_us,
+                                       Env* env)
+    : refill_period_us_(refill_period_us),
+      fairness_(fairness > 0 ? fairness : 1),
+      auto_tuned_(auto_tuned),
+      foreground_latency_target_us_(foreground_latency_target_us),
+      max_bytes_per_sec_(rate_bytes_per_sec),
+      env_(env),
+      rate_bytes_per_sec_(0),
+      refill_bytes_per_period_(0),
+      fg_latency_sum_(0),
+      fg_latency_count_(0),
+      leader_(nullptr),
+      rnd_(0x5eed),
+      baseline_latency_us_(0),
+      throttled_(false) {
+    assert(rate_bytes_per_sec > 0);
+    assert(refill_period_us > 0);
+    MutexLock l(&mu_);
+    SetBytesPerSecondLocked(rate_bytes_per_sec);
+    available_bytes_ = refill_bytes_per_period_.load(std::memory_order_relaxed);
+    const uint64_t now = env_->NowMicros();
+    next_refill_us_ = now + refill_period_us_;
+    next_tune_us_ = now + kTuneIntervalPeriods * refill_period_us_;
+    for (int i = 0; i < IO_TOTAL; i++) {
+        total_bytes_through_[i] = 0;
+        total_requests_[i] = 0;
+    }
+}
+
+GenericRateLimiter::~GenericRateLimiter() {
+    MutexLock l(&mu_);
+    assert(leader_ == nullptr);
+    assert(queue_[IO_LOW].empty() && queue_[IO_HIGH].empty());
+}
+
+void GenericRateLimiter::SetBytesPerSecond(int64_t bytes_per_second) {
+    assert(bytes_per_second > 0);
+    MutexLock l(&mu_);
+    SetBytesPerSecondLocked(bytes_per_second);
+}
+
+void GenericRateLimiter::SetBytesPerSecondLocked(int64_t bytes_per_second) {
+    rate_bytes_per_sec_.store(bytes_per_second, std::memory_order_relaxed);
+    const int64_t per_period = bytes_per_second * refill_period_us_ / 1000000;
+    refill_bytes_per_period_.store(std::max<int64_t>(per_period, 1),
+                                   std::memory_order_relaxed);
+}
+
+void GenericRateLimiter::Request(int64_t bytes, IOPriority pri) {
+    assert(pri < IO_TOTAL);
+    MutexLock l(&mu_);
+    const uint64_t now = env_->NowMicros();
+    if (auto_tuned_) {
+        TuneIfNeeded(now);
+    }
+    total_requests_[pri]++;
+
+    // 没有请求在等待时由当前请求补充配额
+    if (leader_ == nullptr && now >= next_refill_us_) {
+        Refill();
+    }
+    if (available_bytes_ >= bytes && queue_[IO_LOW].empty() &&
+        queue_[IO_HIGH].empty()) {
+        available_bytes_ -= bytes;
+        total_bytes_through_[pri] += bytes;
+        return;
+    }
+
+    // 配额不足，排队等待
+    throttled_ = true;
+    Req r(bytes, &mu_);
+    queue_[pri].push_back(&r);
+    while (!r.granted) {
+        if (leader_ == nullptr) {
+            // 成为 leader，等到下一个周期开始时补充配额并分配给排队的请求
+            leader_ = &r;
+            const uint64_t wait_start = env_->NowMicros();
+            if (next_refill_us_ > wait_start) {
+                r.cv.TimedWait(next_refill_us_ - wait_start);
+            }
+            if (env_->NowMicros() >= next_refill_us_) {
+                Refill();
+            }
+            leader_ = nullptr;
+            if (r.granted) {
+                // 唤醒一个仍在排队的请求接替 leader
+                if (!queue_[IO_HIGH].empty()) {
+                    queue_[IO_HIGH].front()->cv.Signal();
+                } else if (!queue_[IO_LOW].empty()) {
+                    queue_[IO_LOW].front()->cv.Signal();
+                }
+            }
+        } else {
+            r.cv.Wait();
+        }
+    }
+    total_bytes_through_[pri] += bytes;
+}
+
+void GenericRateLimiter::Refill() {
+    next_refill_us_ = env_->NowMicros() + refill_period_us_;
+    // 空闲时积累的配额不超过一个周期的量，避免空闲之后出现很大的突发
+    const int64_t refill = refill_bytes_per_period_.load(std::memory_order_relaxed);
+    available_bytes_ = std::min(available_bytes_ + refill, refill);
+
+    // 高优先级先分配，但低优先级有 1/fairness_ 的概率先分配
+    const bool low_first = rnd_.OneIn(fairness_);
+    for (int i = 0; i < IO_TOTAL; i++) {
+        const int pri = (low_first == (i == 0)) ? IO_LOW : IO_HIGH;
+        std::deque<Req*>* queue = &queue_[pri];
+        while (!queue->empty()) {
+            Req* next = queue->front();
+            if (available_bytes_ < next->request_bytes) {
+                // 部分满足，剩下的在后面的周期继续分配
+                next->request_bytes -= available_bytes_;
+                available_bytes_ = 0;
+                break;
+            }
+            available_bytes_ -= next->request_bytes;
+            next->request_bytes = 0;
+            next->granted = true;
+            queue->pop_front();
+            next->cv.Signal();
+        }
+    }
+}
+
+/*
+ * 每个窗口结束时根据窗口内的前台平均延迟调整速率(AIMD)：
+ * 延迟超过阈值时乘性降低到 4/5，否则如果后台请求被限速过，加性提高 1/20 的上限
+ * 阈值为配置的目标延迟，或者观察到的基准延迟的两倍。基准取最低的窗口平均值，
+ * 并缓慢地向更高的平均值漂移，以适应设备本身变慢的情况
+ */
+void GenericRateLimiter::TuneIfNeeded(uint64_t now) {
+    if (now < next_tune_us_) {
+        return;
+    }
+    next_tune_us_ = now + kTuneIntervalPeriods * refill_period_us_;
+    const uint64_t count = fg_latency_count_.exchange(0, std::memory_order_relaxed);
+    const uint64_t sum = fg_latency_sum_.exchange(0, std::memory_order_relaxed);
+    const bool throttled = throttled_;
+    throttled_ = false;
+
+    const int64_t rate = rate_bytes_per_sec_.load(std::memory_order_relaxed);
+    const int64_t min_rate = std::max<int64_t>(max_bytes_per_sec_ / 20, 1);
+    if (count >= kMinLatencySamples) {
+        const uint64_t avg = sum / count;
+        uint64_t threshold;
+        if (foreground_latency_target_us_ > 0) {
+            threshold = foreground_latency_target_us_;
+        } else {
+            if (baseline_latency_us_ == 0 || avg < baseline_latency_us_) {
+                baseline_latency_us_ = avg;
+            }
+            threshold = 2 * baseline_latency_us_;
+            baseline_latency_us_ += (avg - baseline_latency_us_) / 16;
+        }
+        if (avg > threshold) {
+            SetBytesPerSecondLocked(std::max(min_rate, rate * 4 / 5));
+            return;
+        }
+    }
+    if (throttled && rate < max_bytes_per_sec_) {
+        SetBytesPerSecondLocked(
+                std::min(max_bytes_per_sec_, rate + max_bytes_per_sec_ / 20));
+    }
+}
+
+void GenericRateLimiter::ReportForegroundLatency(uint64_t micros) {
+    if (!auto_tuned_) {
+        return;
+    }
+    fg_latency_sum_.fetch_add(micros, std::memory_order_relaxed);
+    fg_latency_count_.fetch_add(1, std::memory_order_relaxed);
+}
+
+int64_t GenericRateLimiter::GetTotalBytesThrough(IOPriority pri) const {
+    MutexLock l(&mu_);
+    if (pri == IO_TOTAL) {
+        return total_bytes_through_[IO_LOW] + total_bytes_through_[IO_HIGH];
+    }
+    return total_bytes_through_[pri];
+}
+
+int64_t GenericRateLimiter::GetTotalRequests(IOPriority pri) const {
+    MutexLock l(&mu_);
+    if (pri == IO_TOTAL) {
+        return total_requests_[IO_LOW] + total_requests_[IO_HIGH];
+    }
+    return total_requests_[pri];
+}
+
+RateLimiter* NewGenericRateLimiter(int64_t rate_bytes_per_sec,
+                                   int64_t refill_period_us, int32_t fairness,
+                                   bool auto_tuned,
+                                   uint64_t foreground_latency_target_us,
+                                   Env* env) {
+    return new GenericRateLimiter(rate_bytes_per_sec, refill_period_us, fairness,
+                                  auto_tuned, foreground_latency_target_us,
+                                  env != nullptr ? env : Env::Default());
+}
+
+namespace {
+
+// 按单次允许的最大字节数分段申请配额
+void RequestInChunks(RateLimiter* limiter, RateLimiter::IOPriority pri,
+                     size_t n) {
+    const size_t burst = static_cast<size_t>(limiter->GetSingleBurstBytes());
+    while (n > 0) {
+        const size_t chunk = std::min(n, burst);
+        limiter->Request(static_cast<int64_t>(chunk), pri);
+        n -= chunk;
+    }
+}
+
+class RateLimitedWritableFile : public WritableFile {
+public:
+    RateLimitedWritableFile(WritableFile* base, RateLimiter* limiter,
+                            RateLimiter::IOPriority pri)
+        : base_(base), limiter_(limiter), pri_(pri) {}
+
+    ~RateLimitedWritableFile() override { delete base_; }
+
+    Status Append(const Slice& data) override {
+        // 大的写入分段申请并写入，使写出的速率平滑
+        const size_t burst = static_cast<size_t>(limiter_->GetSingleBurstBytes());
+        Slice left = data;
+        Status s;
+        while (!left.empty() && s.ok()) {
+            const size_t chunk = std::min(left.size(), burst);
+            limiter_->Request(static_cast<int64_t>(chunk), pri_);
+            s = base_->Append(Slice(left.data(), chunk));
+            left.remove_prefix(chunk);
+        }
+        return s;
+    }
+    Status Close() override { return base_->Close(); }
+    Status Flush() override { return base_->Flush(); }
+    Status Sync() override { return base_->Sync(); }
+
+private:
+    WritableFile* const base_;
+    RateLimiter* const limiter_;
+    const RateLimiter::IOPriority pri_;
+};
+
+class RateLimitedRandomAccessFile : public RandomAccessFile {
+public:
+    RateLimitedRandomAccessFile(RandomAccessFile* base, RateLimiter* limiter,
+                                RateLimiter::IOPriority pri)
+        : base_(base), limiter_(limiter), pri_(pri) {}
+
+    ~RateLimitedRandomAccessFile() override { delete base_; }
+
+    Status Read(uint64_t offset, size_t n, Slice* result,
+                char* scratch) const override {
+        RequestInChunks(limiter_, pri_, n);
+        return base_->Read(offset, n, result, scratch);
+    }
+    Status Prefetch(uint64_t offset, size_t n) const override {
+        return base_->Prefetch(offset, n);
+    }
+
+private:
+    RandomAccessFile* const base_;
+    RateLimiter* const limiter_;
+    const RateLimiter::IOPriority pri_;
+};
+
+} // namespace
+
+WritableFile* NewRateLimitedWritableFile(WritableFile* base, RateLimiter* limiter,
+                                         RateLimiter::IOPriority pri) {
+    return new RateLimitedWritableFile(base, limiter, pri);
+}
+
+RandomAccessFile* NewRateLimitedRandomAccessFile(RandomAccessFile* base,
+                                                 RateLimiter* limiter,
+                                                 RateLimiter::IOPriority pri) {
+    return new RateLimitedRandomAccessFile(base, limiter, pri);
+}
+
+} // namespace tinydb
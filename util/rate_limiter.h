@@ -0,0 +1,91 @@
+#ifndef STORAGE_TINYDB_UTIL_RATE_LIMITER_H_
+#define STORAGE_TINYDB_UTIL_RATE_LIMITER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+
+#include "port/port.h"
+#include "port/thread_annotations.h"
+#include "tinydb/rate_limiter.h"
+#include "util/random.h"
+
+namespace tinydb {
+
+class RandomAccessFile;
+class WritableFile;
+
+/*
+ * 令牌桶：每个 refill 周期补充 refill_bytes_per_period_ 字节的配额
+ * 配额不足的请求按优先级排队，由其中一个请求(leader)等到下一个周期开始时补充配额，
+ * 再按优先级把配额分给排队的请求。一个请求可能分几个周期才得到全部配额
+ */
+class GenericRateLimiter : public RateLimiter {
+public:
+    GenericRateLimiter(int64_t rate_bytes_per_sec, int64_t refill_period_us,
+                       int32_t fairness, bool auto_tuned,
+                       uint64_t foreground_latency_target_us, Env* env);
+
+    ~GenericRateLimiter() override;
+
+    void SetBytesPerSecond(int64_t bytes_per_second) override;
+    int64_t GetBytesPerSecond() const override {
+        return rate_bytes_per_sec_.load(std::memory_order_relaxed);
+    }
+    void Request(int64_t bytes, IOPriority pri) override;
+    int64_t GetSingleBurstBytes() const override {
+        return refill_bytes_per_period_.load(std::memory_order_relaxed);
+    }
+    int64_t GetTotalBytesThrough(IOPriority pri) const override;
+    int64_t GetTotalRequests(IOPriority pri) const override;
+    bool IsAutoTuned() const override { return auto_tuned_; }
+    void ReportForegroundLatency(uint64_t micros) override;
+
+private:
+    struct Req;
+
+    void SetBytesPerSecondLocked(int64_t bytes_per_second)
+            EXCLUSIVE_LOCKS_REQUIRED(mu_);
+    void Refill() EXCLUSIVE_LOCKS_REQUIRED(mu_);
+    void TuneIfNeeded(uint64_t now) EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+    const int64_t refill_period_us_;
+    const int32_t fairness_;
+    const bool auto_tuned_;
+    const uint64_t foreground_latency_target_us_;
+    const int64_t max_bytes_per_sec_;
+    Env* const env_;
+
+    std::atomic<int64_t> rate_bytes_per_sec_;
+    std::atomic<int64_t> refill_bytes_per_period_;
+
+    // 自动调整：当前窗口内报告的前台延迟之和与次数
+    std::atomic<uint64_t> fg_latency_sum_;
+    std::atomic<uint64_t> fg_latency_count_;
+
+    mutable port::Mutex mu_;
+    int64_t available_bytes_ GUARDED_BY(mu_);
+    uint64_t next_refill_us_ GUARDED_BY(mu_);
+    Req* leader_ GUARDED_BY(mu_);
+    std::deque<Req*> queue_[IO_TOTAL] GUARDED_BY(mu_);
+    int64_t total_bytes_through_[IO_TOTAL] GUARDED_BY(mu_);
+    int64_t total_requests_[IO_TOTAL] GUARDED_BY(mu_);
+    Random rnd_ GUARDED_BY(mu_);
+
+    uint64_t next_tune_us_ GUARDED_BY(mu_);
+    uint64_t baseline_latency_us_ GUARDED_BY(mu_);  // 0 表示还没有基准
+    bool throttled_ GUARDED_BY(mu_);  // 当前窗口内是否有请求排队等待
+};
+
+// 返回的文件每次 Append() 前按写入的字节数向 limiter 申请配额，接管 base 的所有权
+WritableFile* NewRateLimitedWritableFile(WritableFile* base, RateLimiter* limiter,
+                                         RateLimiter::IOPriority pri);
+
+// 返回的文件每次 Read() 前按读取的字节数向 limiter 申请配额，接管 base 的所有权
+RandomAccessFile* NewRateLimitedRandomAccessFile(RandomAccessFile* base,
+                                                 RateLimiter* limiter,
+                                                 RateLimiter::IOPriority pri);
+
+} // namespace tinydb
+
+#endif  // STORAGE_TINYDB_UTIL_RATE_LIMITER_H_
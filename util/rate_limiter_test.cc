@@ -0,0 +1,148 @@
+#include "util/rate_limiter.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "tinydb/env.h"
+#include "util/random.h"
+#include "util/testutil.h"
+
+namespace tinydb {
+
+TEST(RateLimiterTest, Rate) {
+    Env* env = Env::Default();
+    // 每 10ms 补充 10KB
+    std::unique_ptr<RateLimiter> limiter(NewGenericRateLimiter(1024 * 1024, 10 * 1000));
+    EXPECT_EQ(1024 * 1024, limiter->GetBytesPerSecond());
+    const int64_t burst = limiter->GetSingleBurstBytes();
+    EXPECT_EQ(10485, burst);
+
+    // 第一个周期的配额可以立即使用，之后每个周期只能通过一次突发
+    const int kBursts = 21;
+    const uint64_t start = env->NowMicros();
+    for (int i = 0; i < kBursts; i++) {
+        limiter->Request(burst, RateLimiter::IO_LOW);
+    }
+    const uint64_t elapsed = env->NowMicros() - start;
+    EXPECT_GE(elapsed, 180u * 1000);
+    EXPECT_LT(elapsed, 2u * 1000 * 1000);
+    EXPECT_EQ(kBursts * burst, limiter->GetTotalBytesThrough());
+    EXPECT_EQ(kBursts * burst, limiter->GetTotalBytesThrough(RateLimiter::IO_LOW));
+    EXPECT_EQ(0, limiter->GetTotalBytesThrough(RateLimiter::IO_HIGH));
+    EXPECT_EQ(kBursts, limiter->GetTotalRequests());
+
+    // 提高速率后单次突发随之变大
+    limiter->SetBytesPerSecond(10 * 1024 * 1024);
+    EXPECT_EQ(104857, limiter->GetSingleBurstBytes());
+}
+
+TEST(RateLimiterTest, HighPriorityFirst) {
+    // fairness 很大，低优先级几乎不会先得到配额
+    std::unique_ptr<RateLimiter> limiter(
+            NewGenericRateLimiter(100 * 1000, 5 * 1000, 1 << 30));
+    const int64_t burst = limiter->GetSingleBurstBytes();
+    limiter->Request(burst, RateLimiter::IO_LOW);
+
+    const int kRequests = 20;
+    std::atomic<int64_t> low_bytes_when_high_done(-1);
+    std::thread low([&]() {
+        for (int i = 0; i < kRequests; i++) {
+            limiter->Request(burst, RateLimiter::IO_LOW);
+        }
+    });
+    std::thread high([&]() {
+        for (int i = 0; i < kRequests; i++) {
+            limiter->Request(burst, RateLimiter::IO_HIGH);
+        }
+        low_bytes_when_high_done = limiter->GetTotalBytesThrough(RateLimiter::IO_LOW);
+    });
+    low.join();
+    high.join();
+    EXPECT_EQ(kRequests * burst, limiter->GetTotalBytesThrough(RateLimiter::IO_HIGH));
+    EXPECT_EQ((kRequests + 1) * burst, limiter->GetTotalBytesThrough(RateLimiter::IO_LOW));
+    // 高优先级完成时，低优先级最多只完成了一半
+    EXPECT_LE(low_bytes_when_high_done.load(), (kRequests / 2 + 1) * burst);
+}
+
+TEST(RateLimiterTest, AutoTune) {
+    Env* env = Env::Default();
+    const int64_t kMaxRate = 10 * 1024 * 1024;
+    // 每 1ms 补充一次，每 10ms 调整一次，目标延迟 1ms
+    std::unique_ptr<RateLimiter> limiter(
+            NewGenericRateLimiter(kMaxRate, 1000, 10, true, 1000));
+    ASSERT_TRUE(limiter->IsAutoTuned());
+
+    // 前台延迟超过目标，速率逐步降到下限
+    for (int i = 0; i < 30; i++) {
+        for (int j = 0; j < 10; j++) {
+            limiter->ReportForegroundLatency(5000);
+        }
+        env->SleepForMicroseconds(11 * 1000);
+        limiter->Request(1, RateLimiter::IO_LOW);
+    }
+    EXPECT_EQ(kMaxRate / 20, limiter->GetBytesPerSecond());
+
+    // 样本太少时不根据延迟调整；延迟恢复后，被限速的后台请求使速率逐渐回升
+    const uint64_t deadline = env->NowMicros() + 10 * 1000 * 1000;
+    while (limiter->GetBytesPerSecond() < kMaxRate && env->NowMicros() < deadline) {
+        limiter->ReportForegroundLatency(100000);
+        limiter->Request(limiter->GetSingleBurstBytes(), RateLimiter::IO_LOW);
+        limiter->Request(limiter->GetSingleBurstBytes(), RateLimiter::IO_LOW);
+    }
+    EXPECT_EQ(kMaxRate, limiter->GetBytesPerSecond());
+
+    // 非自动调整模式忽略延迟报告
+    std::unique_ptr<RateLimiter> fixed(NewGenericRateLimiter(kMaxRate, 1000));
+    for (int j = 0; j < 100; j++) {
+        fixed->ReportForegroundLatency(5000);
+    }
+    env->SleepForMicroseconds(11 * 1000);
+    fixed->Request(1, RateLimiter::IO_LOW);
+    EXPECT_EQ(kMaxRate, fixed->GetBytesPerSecond());
+}
+
+TEST(RateLimiterTest, RateLimitedFiles) {
+    Env* env = Env::Default();
+    const std::string fname = test::NewTestDirectory("rate_limiter_test") + "/file";
+    std::unique_ptr<RateLimiter> limiter(NewGenericRateLimiter(100 * 1024 * 1024, 1000));
+    const int64_t burst = limiter->GetSingleBurstBytes();
+    Random rnd(301);
+    std::string data;
+    test::RandomString(&rnd, static_cast<int>(10 * burst + 123), &data);
+
+    // 写入按高优先级计入，大的 Append 分段申请
+    EnvOptions options;
+    options.rate_limiter = limiter.get();
+    options.rate_limiter_priority = RateLimiter::IO_HIGH;
+    WritableFile* file;
+    ASSERT_TRUE(env->NewWritableFile(fname, options, &file).ok());
+    ASSERT_TRUE(file->Append(data).ok());
+    ASSERT_TRUE(file->Close().ok());
+    delete file;
+    EXPECT_EQ(static_cast<int64_t>(data.size()),
+              limiter->GetTotalBytesThrough(RateLimiter::IO_HIGH));
+    EXPECT_EQ(11, limiter->GetTotalRequests(RateLimiter::IO_HIGH));
+
+    // 读取按低优先级计入，内容不变
+    options.rate_limiter_priority = RateLimiter::IO_LOW;
+    RandomAccessFile* rfile;
+    ASSERT_TRUE(env->NewRandomAccessFile(fname, options, &rfile).ok());
+    std::string scratch(data.size(), '\0');
+    Slice result;
+    ASSERT_TRUE(rfile->Read(0, data.size(), &result, &scratch[0]).ok());
+    EXPECT_EQ(data, result.ToString());
+    delete rfile;
+    EXPECT_EQ(static_cast<int64_t>(data.size()),
+              limiter->GetTotalBytesThrough(RateLimiter::IO_LOW));
+
+    // 不限速时不计入
+    ASSERT_TRUE(env->NewRandomAccessFile(fname, EnvOptions(), &rfile).ok());
+    ASSERT_TRUE(rfile->Read(0, 100, &result, &scratch[0]).ok());
+    delete rfile;
+    EXPECT_EQ(2 * static_cast<int64_t>(data.size()), limiter->GetTotalBytesThrough());
+}
+
+} // namespace tinydb
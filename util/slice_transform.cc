@@ -0,0 +1,64 @@
+#include "tinydb/slice_transform.h"
+
+#include <algorithm>
+#include <cassert>
+#include <string>
+
+namespace tinydb {
+
+SliceTransform::~SliceTransform() = default;
+
+namespace {
+
+class FixedPrefixTransform : public SliceTransform {
+public:
+    explicit FixedPrefixTransform(size_t prefix_len)
+        : prefix_len_(prefix_len),
+          name_("tinydb.FixedPrefix." + std::to_string(prefix_len)) {}
+
+    const char* Name() const override { return name_.c_str(); }
+
+    Slice Transform(const Slice& key) const override {
+        assert(InDomain(key));
+        return Slice(key.data(), prefix_len_);
+    }
+
+    bool InDomain(const Slice& key) const override {
+        return key.size() >= prefix_len_;
+    }
+
+private:
+    const size_t prefix_len_;
+    const std::string name_;
+};
+
+class CappedPrefixTransform : public SliceTransform {
+public:
+    explicit CappedPrefixTransform(size_t cap_len)
+        : cap_len_(cap_len),
+          name_("tinydb.CappedPrefix." + std::to_string(cap_len)) {}
+
+    const char* Name() const override { return name_.c_str(); }
+
+    Slice Transform(const Slice& key) const override {
+        return Slice(key.data(), std::min(cap_len_, key.size()));
+    }
+
+    bool InDomain(const Slice& key) const override { return true; }
+
+private:
+    const size_t cap_len_;
+    const std::string name_;
+};
+
+} // namespace
+
+const SliceTransform* NewFixedPrefixTransform(size_t prefix_len) {
+    return new FixedPrefixTransform(prefix_len);
+}
+
+const SliceTransform* NewCappedPrefixTransform(size_t cap_len) {
+    return new CappedPrefixTransform(cap_len);
+}
+
+} // namespace tinydb
@@ -0,0 +1,93 @@
+#include "tinydb/statistics.h"
+
+#include <atomic>
+#include <cstdio>
+
+#include "util/core_local.h"
+
+namespace tinydb {
+
+namespace {
+
+const char* const kTickerNames[TICKER_ENUM_MAX] = {
+        "tinydb.bytes.written",
+        "tinydb.number.keys.written",
+        "tinydb.bytes.read",
+        "tinydb.number.keys.read",
+        "tinydb.wal.bytes",
+        "tinydb.wal.synced",
+        "tinydb.memtable.hit",
+        "tinydb.memtable.miss",
+        "tinydb.bloom.filter.useful",
+        "tinydb.bloom.filter.positive",
+        "tinydb.row.cache.hit",
+        "tinydb.row.cache.miss",
+        "tinydb.flush.write.bytes",
+        "tinydb.compact.read.bytes",
+        "tinydb.compact.write.bytes",
+        "tinydb.stall.micros",
+};
+
+class StatisticsImpl : public Statistics {
+public:
+    StatisticsImpl() = default;
+
+    uint64_t GetTickerCount(uint32_t ticker_type) const override {
+        assert(ticker_type < TICKER_ENUM_MAX);
+        uint64_t result = 0;
+        for (size_t i = 0; i < per_core_.Size(); i++) {
+            result += per_core_.AccessAtCore(i)->tickers[ticker_type].load(
+                    std::memory_order_relaxed);
+        }
+        return result;
+    }
+
+    void RecordTick(uint32_t ticker_type, uint64_t count) override {
+        assert(ticker_type < TICKER_ENUM_MAX);
+        per_core_.Access()->tickers[ticker_type].fetch_add(count, std::memory_order_relaxed);
+    }
+
+    void Reset() override {
+        for (size_t i = 0; i < per_core_.Size(); i++) {
+            for (uint32_t t = 0; t < TICKER_ENUM_MAX; t++) {
+                per_core_.AccessAtCore(i)->tickers[t].store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+
+private:
+    struct PerCoreStats {
+        PerCoreStats() {
+            for (uint32_t t = 0; t < TICKER_ENUM_MAX; t++) {
+                tickers[t].store(0, std::memory_order_relaxed);
+            }
+        }
+
+        std::atomic<uint64_t> tickers[TICKER_ENUM_MAX];
+    };
+
+    CoreLocalArray<PerCoreStats> per_core_;
+};
+
+} // namespace
+
+const char* TickerName(uint32_t ticker_type) {
+    return ticker_type < TICKER_ENUM_MAX ? kTickerNames[ticker_type] : "unknown";
+}
+
+Statistics::~Statistics() {}
+
+std::string Statistics::ToString() const {
+    std::string result;
+    char buf[200];
+    for (uint32_t t = 0; t < TICKER_ENUM_MAX; t++) {
+        std::snprintf(buf, sizeof(buf), "%s COUNT : %llu\n", TickerName(t),
+                      static_cast<unsigned long long>(GetTickerCount(t)));
+        result.append(buf);
+    }
+    return result;
+}
+
+Statistics* NewStatistics() { return new StatisticsImpl; }
+
+} // namespace tinydb
@@ -0,0 +1,19 @@
+#ifndef STORAGE_TINYDB_UTIL_STATISTICS_H_
+#define STORAGE_TINYDB_UTIL_STATISTICS_H_
+
+#include <cstdint>
+
+#include "tinydb/statistics.h"
+
+namespace tinydb {
+
+// 设置了 statistics 时给计数器加上 count
+inline void RecordTick(Statistics* statistics, uint32_t ticker_type, uint64_t count = 1) {
+    if (statistics != nullptr) {
+        statistics->RecordTick(ticker_type, count);
+    }
+}
+
+} // namespace tinydb
+
+#endif  // STORAGE_TINYDB_UTIL_STATISTICS_H_
@@ -0,0 +1,63 @@
+#include "tinydb/statistics.h"
+
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "util/statistics.h"
+
+namespace tinydb {
+
+TEST(StatisticsTest, TickerNames) {
+    std::set<std::string> names;
+    for (uint32_t t = 0; t < TICKER_ENUM_MAX; t++) {
+        const std::string name = TickerName(t);
+        EXPECT_EQ(0u, name.find("tinydb.")) << t;
+        names.insert(name);
+    }
+    EXPECT_EQ(static_cast<size_t>(TICKER_ENUM_MAX), names.size());
+    EXPECT_EQ(std::string("tinydb.bytes.written"), TickerName(BYTES_WRITTEN));
+    EXPECT_EQ(std::string("tinydb.stall.micros"), TickerName(STALL_MICROS));
+    EXPECT_EQ(std::string("unknown"), TickerName(TICKER_ENUM_MAX));
+}
+
+TEST(StatisticsTest, ConcurrentRecordAndReset) {
+    std::unique_ptr<Statistics> statistics(NewStatistics());
+    // 没有设置 statistics 时不记录
+    RecordTick(nullptr, BYTES_WRITTEN, 100);
+
+    // 多个线程落在不同核的计数器上，读取时加起来
+    const int kThreads = 8;
+    const int kTicks = 100000;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < kThreads; i++) {
+        threads.emplace_back([&]() {
+            for (int j = 0; j < kTicks; j++) {
+                RecordTick(statistics.get(), NUMBER_KEYS_WRITTEN);
+                RecordTick(statistics.get(), BYTES_WRITTEN, 10);
+            }
+        });
+    }
+    for (std::thread& t : threads) {
+        t.join();
+    }
+    EXPECT_EQ(static_cast<uint64_t>(kThreads) * kTicks,
+              statistics->GetTickerCount(NUMBER_KEYS_WRITTEN));
+    EXPECT_EQ(static_cast<uint64_t>(kThreads) * kTicks * 10,
+              statistics->GetTickerCount(BYTES_WRITTEN));
+    EXPECT_EQ(0u, statistics->GetTickerCount(BYTES_READ));
+
+    const std::string dump = statistics->ToString();
+    EXPECT_NE(std::string::npos, dump.find("tinydb.number.keys.written COUNT : 800000\n"));
+    EXPECT_NE(std::string::npos, dump.find("tinydb.bytes.read COUNT : 0\n"));
+
+    statistics->Reset();
+    for (uint32_t t = 0; t < TICKER_ENUM_MAX; t++) {
+        EXPECT_EQ(0u, statistics->GetTickerCount(t)) << TickerName(t);
+    }
+}
+
+} // namespace tinydb
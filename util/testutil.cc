@@ -0,0 +1,139 @@
+#include "util/testutil.h"
+
+#include "db/filename.h"
+#include "port/port.h"
+
+namespace tinydb {
+namespace test {
+
+std::string NewTestDirectory(const std::string& name) {
+    std::string dir = testing::TempDir();
+    if (!dir.empty() && dir[dir.size() - 1] == '/') {
+        dir.resize(dir.size() - 1);
+    }
+    dir += "/tinydb-" + name;
+    Env* env = Env::Default();
+    RemoveDirTree(env, dir);
+    env->CreateDir(dir);
+    return dir;
+}
+
+Slice RandomString(Random* rnd, int len, std::string* dst) {
+    dst->resize(len);
+    for (int i = 0; i < len; i++) {
+        (*dst)[i] = static_cast<char>(' ' + rnd->Uniform(95));  // ' ' .. '~'
+    }
+    return Slice(*dst);
+}
+
+bool ZstdSupported() {
+    std::string out;
+    return port::Zstd_Compress(1, "x", 1, &out);
+}
+
+std::string RandomKey(Random* rnd, int len) {
+    // Make sure to generate a wide variety of characters so we
+    // test the boundary conditions for short-key optimizations.
+    static const char kTestChars[] = {'\0', '\1', 'a',    'b',    'c',
+                                      'd',  'e',  '\xfd', '\xfe', '\xff'};
+    std::string result;
+    for (int i = 0; i < len; i++) {
+        result += kTestChars[rnd->Uniform(sizeof(kTestChars))];
+    }
+    return result;
+}
+
+namespace {
+
+// fail_types 中有 fname 的类型时返回 true
+bool MatchType(const std::string& fname, uint32_t fail_types) {
+    const size_t slash = fname.rfind('/');
+    const std::string base = (slash == std::string::npos) ? fname : fname.substr(slash + 1);
+    uint64_t number;
+    FileType type;
+    return ParseFileName(base, &number, &type) && (fail_types & (1u << type)) != 0;
+}
+
+} // namespace
+
+class ErrorEnv::ErrorWritableFile : public WritableFile {
+public:
+    ErrorWritableFile(ErrorEnv* env, const std::string& fname, WritableFile* base)
+        : env_(env), fname_(fname), base_(base) {}
+    ~ErrorWritableFile() override { delete base_; }
+
+    Status Append(const Slice& data) override {
+        Status s = env_->MaybeFailWrite(fname_);
+        return s.ok() ? base_->Append(data) : s;
+    }
+    Status Close() override { return base_->Close(); }
+    Status Flush() override { return base_->Flush(); }
+    Status Sync() override {
+        Status s = env_->MaybeFailWrite(fname_);
+        return s.ok() ? base_->Sync() : s;
+    }
+
+private:
+    ErrorEnv* const env_;
+    const std::string fname_;
+    WritableFile* const base_;
+};
+
+void ErrorEnv::FailNewFiles(FileType type, bool fail) {
+    if (fail) {
+        fail_types_.fetch_or(1u << type);
+    } else {
+        fail_types_.fetch_and(~(1u << type));
+    }
+}
+
+void ErrorEnv::FailWrites(FileType type, bool fail) {
+    if (fail) {
+        fail_write_types_.fetch_or(1u << type);
+    } else {
+        fail_write_types_.fetch_and(~(1u << type));
+    }
+}
+
+Status ErrorEnv::MaybeFail(const std::string& fname) {
+    if (MatchType(fname, fail_types_.load())) {
+        num_failures_.fetch_add(1);
+        return Status::IOError(fname, "injected error");
+    }
+    return Status::OK();
+}
+
+Status ErrorEnv::MaybeFailWrite(const std::string& fname) {
+    if (MatchType(fname, fail_write_types_.load())) {
+        num_failures_.fetch_add(1);
+        return Status::IOError(fname, "injected write error");
+    }
+    return Status::OK();
+}
+
+Status ErrorEnv::WrapFile(const std::string& fname, Status s, WritableFile** r) {
+    if (s.ok()) {
+        *r = new ErrorWritableFile(this, fname, *r);
+    }
+    return s;
+}
+
+Status ErrorEnv::NewWritableFile(const std::string& f, WritableFile** r) {
+    Status s = MaybeFail(f);
+    return s.ok() ? WrapFile(f, EnvWrapper::NewWritableFile(f, r), r) : s;
+}
+
+Status ErrorEnv::NewWritableFile(const std::string& f, const EnvOptions& o,
+                                 WritableFile** r) {
+    Status s = MaybeFail(f);
+    return s.ok() ? WrapFile(f, EnvWrapper::NewWritableFile(f, o, r), r) : s;
+}
+
+Status ErrorEnv::ReuseWritableFile(const std::string& f, const std::string& old_f,
+                                   const EnvOptions& o, WritableFile** r) {
+    Status s = MaybeFail(f);
+    return s.ok() ? WrapFile(f, EnvWrapper::ReuseWritableFile(f, old_f, o, r), r) : s;
+}
+
+} // namespace test
+} // namespace tinydb
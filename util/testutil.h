@@ -0,0 +1,69 @@
+#ifndef STORAGE_TINYDB_UTIL_TESTUTIL_H_
+#define STORAGE_TINYDB_UTIL_TESTUTIL_H_
+
+#include <atomic>
+#include <string>
+
+#include "db/filename.h"
+#include "gtest/gtest.h"
+#include "tinydb/env.h"
+#include "tinydb/slice.h"
+#include "util/random.h"
+
+namespace tinydb {
+namespace test {
+
+// 返回一个新建的空目录 <TempDir>/tinydb-<name>，已经存在时先删掉其中的所有内容
+std::string NewTestDirectory(const std::string& name);
+
+// 长度为 len 的随机可打印字符串，存到 *dst 并返回
+Slice RandomString(Random* rnd, int len, std::string* dst);
+
+// 当前平台是否支持 Zstd，不支持时依赖 Zstd 的测试直接跳过
+bool ZstdSupported();
+
+// 长度为 len 的随机 key，字符集很小，便于产生相同的前缀
+std::string RandomKey(Random* rnd, int len);
+
+// 创建或写入指定类型的文件时返回 IOError 的 Env，用于测试错误路径，可以被多个线程使用
+class ErrorEnv : public EnvWrapper {
+public:
+    explicit ErrorEnv(Env* base = Env::Default())
+        : EnvWrapper(base), fail_types_(0), fail_write_types_(0), num_failures_(0) {}
+
+    // fail 为 true 时，之后创建(包括复用) type 类型的文件都失败
+    void FailNewFiles(FileType type, bool fail);
+
+    // fail 为 true 时，type 类型的文件(包括已经打开的)的 Append() 和 Sync() 都失败
+    void FailWrites(FileType type, bool fail);
+
+    // 已经注入的错误数
+    int num_failures() const { return num_failures_.load(); }
+
+    Status NewWritableFile(const std::string& f, WritableFile** r) override;
+    Status NewWritableFile(const std::string& f, const EnvOptions& o,
+                           WritableFile** r) override;
+    Status ReuseWritableFile(const std::string& f, const std::string& old_f,
+                             const EnvOptions& o, WritableFile** r) override;
+
+private:
+    class ErrorWritableFile;
+
+    // 需要对 fname 注入错误时返回 IOError
+    Status MaybeFail(const std::string& fname);
+
+    // 需要对 fname 的写入注入错误时返回 IOError
+    Status MaybeFailWrite(const std::string& fname);
+
+    // 打开成功的文件包装成写入时检查 MaybeFailWrite() 的文件
+    Status WrapFile(const std::string& fname, Status s, WritableFile** r);
+
+    std::atomic<uint32_t> fail_types_;        // 按 FileType 的位掩码
+    std::atomic<uint32_t> fail_write_types_;  // 按 FileType 的位掩码
+    std::atomic<int> num_failures_;
+};
+
+} // namespace test
+} // namespace tinydb
+
+#endif  // STORAGE_TINYDB_UTIL_TESTUTIL_H_
@@ -0,0 +1,109 @@
+#include "tinydb/write_buffer_manager.h"
+
+#include <vector>
+
+#include "port/port.h"
+#include "port/thread_annotations.h"
+#include "tinydb/cache.h"
+#include "util/coding.h"
+#include "util/mutexlock.h"
+
+namespace tinydb {
+
+namespace {
+
+// 每个占位条目计入 cache 的大小，按这个粒度增减，避免每次分配内存块都操作 cache
+const size_t kSizeDummyEntry = 256 * 1024;
+
+void DeleteDummyEntry(const Slice& key, void* value) {}
+
+} // namespace
+
+struct WriteBufferManager::CacheRep {
+    explicit CacheRep(Cache* c) : cache(c) {}
+
+    struct DummyEntry {
+        uint64_t id;
+        Cache::Handle* handle;
+    };
+
+    Cache* const cache;
+    port::Mutex mu;
+    // 一直持有引用，cache 不能淘汰它们，只能淘汰其他条目
+    std::vector<DummyEntry> dummy_entries GUARDED_BY(mu);
+};
+
+WriteBufferManager::WriteBufferManager(size_t buffer_size, Cache* cache)
+    : buffer_size_(buffer_size),
+      mutable_limit_(buffer_size * 7 / 8),
+      memory_used_(0),
+      memory_active_(0),
+      cache_rep_(cache != nullptr ? new CacheRep(cache) : nullptr) {}
+
+WriteBufferManager::~WriteBufferManager() {
+    if (cache_rep_ != nullptr) {
+        MutexLock l(&cache_rep_->mu);
+        for (const CacheRep::DummyEntry& e : cache_rep_->dummy_entries) {
+            char buf[sizeof(e.id)];
+            EncodeFixed64(buf, e.id);
+            cache_rep_->cache->Release(e.handle);
+            cache_rep_->cache->Erase(Slice(buf, sizeof(buf)));
+        }
+    }
+    delete cache_rep_;
+}
+
+size_t WriteBufferManager::dummy_entries_in_cache_usage() const {
+    if (cache_rep_ == nullptr) {
+        return 0;
+    }
+    MutexLock l(&cache_rep_->mu);
+    return cache_rep_->dummy_entries.size() * kSizeDummyEntry;
+}
+
+void WriteBufferManager::ReserveMem(size_t mem) {
+    memory_used_.fetch_add(mem, std::memory_order_relaxed);
+    memory_active_.fetch_add(mem, std::memory_order_relaxed);
+    if (cache_rep_ != nullptr) {
+        UpdateCacheCharge();
+    }
+}
+
+void WriteBufferManager::ScheduleFreeMem(size_t mem) {
+    memory_active_.fetch_sub(mem, std::memory_order_relaxed);
+}
+
+void WriteBufferManager::FreeMem(size_t mem) {
+    memory_used_.fetch_sub(mem, std::memory_order_relaxed);
+    if (cache_rep_ != nullptr) {
+        UpdateCacheCharge();
+    }
+}
+
+void WriteBufferManager::UpdateCacheCharge() {
+    MutexLock l(&cache_rep_->mu);
+    Cache* cache = cache_rep_->cache;
+    std::vector<CacheRep::DummyEntry>& entries = cache_rep_->dummy_entries;
+    const size_t usage = memory_used_.load(std::memory_order_relaxed);
+    while (entries.size() * kSizeDummyEntry < usage) {
+        CacheRep::DummyEntry e;
+        e.id = cache->NewId();
+        char buf[sizeof(e.id)];
+        EncodeFixed64(buf, e.id);
+        e.handle = cache->Insert(Slice(buf, sizeof(buf)), nullptr, kSizeDummyEntry,
+                                 &DeleteDummyEntry);
+        entries.push_back(e);
+    }
+    // 用量比占位总量的 3/4 还少一个条目时才归还，避免在边界上反复插入和删除
+    while (!entries.empty() &&
+           (usage == 0 || usage + kSizeDummyEntry <= entries.size() * kSizeDummyEntry * 3 / 4)) {
+        const CacheRep::DummyEntry& e = entries.back();
+        char buf[sizeof(e.id)];
+        EncodeFixed64(buf, e.id);
+        cache->Release(e.handle);
+        cache->Erase(Slice(buf, sizeof(buf)));
+        entries.pop_back();
+    }
+}
+
+} // namespace tinydb
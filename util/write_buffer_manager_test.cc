@@ -0,0 +1,146 @@
+#include "tinydb/write_buffer_manager.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+
+#include "db/column_family.h"
+#include "gtest/gtest.h"
+#include "tinydb/cache.h"
+#include "tinydb/write_batch.h"
+#include "util/arena.h"
+#include "util/testutil.h"
+
+namespace tinydb {
+
+TEST(WriteBufferManagerTest, ShouldFlush) {
+    const size_t kKB = 1024;
+    WriteBufferManager wbm(1024 * kKB);
+    ASSERT_TRUE(wbm.enabled());
+    wbm.ReserveMem(800 * kKB);
+    EXPECT_FALSE(wbm.ShouldFlush());
+    // 还在写入的 memtable 超过预算的 7/8
+    wbm.ReserveMem(100 * kKB);
+    EXPECT_TRUE(wbm.ShouldFlush());
+
+    // 变为只读之后不算在写入的部分中
+    wbm.ScheduleFreeMem(900 * kKB);
+    EXPECT_EQ(900 * kKB, wbm.memory_usage());
+    EXPECT_EQ(0u, wbm.mutable_memtable_memory_usage());
+    EXPECT_FALSE(wbm.ShouldFlush());
+
+    // 总量超过预算，但还在写入的不到一半，flush 释放不了多少内存
+    wbm.ReserveMem(300 * kKB);
+    EXPECT_FALSE(wbm.ShouldFlush());
+    wbm.ReserveMem(300 * kKB);
+    EXPECT_TRUE(wbm.ShouldFlush());
+
+    wbm.FreeMem(900 * kKB);
+    wbm.ScheduleFreeMem(600 * kKB);
+    wbm.FreeMem(600 * kKB);
+    EXPECT_EQ(0u, wbm.memory_usage());
+    EXPECT_EQ(0u, wbm.mutable_memtable_memory_usage());
+
+    // 预算为 0 时只统计
+    WriteBufferManager disabled(0);
+    disabled.ReserveMem(100 * 1024 * kKB);
+    EXPECT_FALSE(disabled.enabled());
+    EXPECT_FALSE(disabled.ShouldFlush());
+    EXPECT_EQ(100 * 1024 * kKB, disabled.memory_usage());
+    disabled.FreeMem(100 * 1024 * kKB);
+}
+
+TEST(WriteBufferManagerTest, ChargeCache) {
+    const size_t kKB = 1024;
+    const size_t kDummy = 256 * kKB;
+    std::unique_ptr<Cache> cache(NewLRUCache(4 * 1024 * kKB));
+    {
+        WriteBufferManager wbm(1024 * kKB, cache.get());
+        EXPECT_EQ(0u, wbm.dummy_entries_in_cache_usage());
+        wbm.ReserveMem(300 * kKB);
+        EXPECT_EQ(2 * kDummy, wbm.dummy_entries_in_cache_usage());
+        EXPECT_EQ(2 * kDummy, cache->TotalCharge());
+        wbm.ReserveMem(700 * kKB);
+        EXPECT_EQ(4 * kDummy, wbm.dummy_entries_in_cache_usage());
+
+        // 减少一点不马上归还，避免在边界上反复插入和删除
+        wbm.FreeMem(100 * kKB);
+        EXPECT_EQ(4 * kDummy, wbm.dummy_entries_in_cache_usage());
+        wbm.FreeMem(400 * kKB);
+        EXPECT_EQ(3 * kDummy, wbm.dummy_entries_in_cache_usage());
+        EXPECT_EQ(3 * kDummy, cache->TotalCharge());
+        wbm.FreeMem(500 * kKB);
+        EXPECT_EQ(0u, wbm.dummy_entries_in_cache_usage());
+        EXPECT_EQ(0u, cache->TotalCharge());
+
+        // 析构时归还所有占位条目
+        wbm.ReserveMem(600 * kKB);
+        EXPECT_EQ(3 * kDummy, cache->TotalCharge());
+        wbm.FreeMem(600 * kKB);
+        wbm.ReserveMem(10 * kKB);
+    }
+    EXPECT_EQ(0u, cache->TotalCharge());
+}
+
+TEST(WriteBufferManagerTest, ArenaAccounting) {
+    WriteBufferManager wbm(0);
+    {
+        Arena arena(&wbm);
+        arena.Allocate(100);
+        arena.Allocate(10000);
+        EXPECT_EQ(arena.MemoryUsage(), wbm.memory_usage());
+        EXPECT_EQ(arena.MemoryUsage(), wbm.mutable_memtable_memory_usage());
+        arena.MarkImmutable();
+        EXPECT_EQ(arena.MemoryUsage(), wbm.memory_usage());
+        EXPECT_EQ(0u, wbm.mutable_memtable_memory_usage());
+    }
+    EXPECT_EQ(0u, wbm.memory_usage());
+    {
+        // 没有变为只读就析构
+        Arena arena(&wbm);
+        arena.Allocate(10000);
+        EXPECT_GT(wbm.mutable_memtable_memory_usage(), 0u);
+    }
+    EXPECT_EQ(0u, wbm.memory_usage());
+    EXPECT_EQ(0u, wbm.mutable_memtable_memory_usage());
+}
+
+TEST(WriteBufferManagerTest, SharedAcrossDatabases) {
+    const size_t kBudget = 256 * 1024;
+    WriteBufferManager wbm(kBudget);
+    Options options;
+    options.create_if_missing = true;
+    // 单个 memtable 的上限很大，只有共享的预算会触发 flush
+    options.write_buffer_size = 64 * 1024 * 1024;
+    options.write_buffer_manager = &wbm;
+    std::unique_ptr<ColumnFamilySet> db1(
+            new ColumnFamilySet(test::NewTestDirectory("write_buffer_manager_test1"), options));
+    std::unique_ptr<ColumnFamilySet> db2(
+            new ColumnFamilySet(test::NewTestDirectory("write_buffer_manager_test2"), options));
+    ASSERT_TRUE(db1->Open({}).ok());
+    ASSERT_TRUE(db2->Open({}).ok());
+
+    const std::string value(1000, 'v');
+    size_t peak = 0;
+    for (int i = 0; i < 2000; i++) {
+        WriteBatch batch;
+        batch.Put(0, "key" + std::to_string(i), value);
+        ColumnFamilySet* db = (i % 2 == 0) ? db1.get() : db2.get();
+        ASSERT_TRUE(db->Write(WriteOptions(), &batch).ok());
+        peak = std::max(peak, wbm.memory_usage());
+    }
+    // 写入了约 2MB，memtable 占用的总内存保持在预算附近
+    EXPECT_LT(peak, 2 * kBudget);
+    for (ColumnFamilySet* db : {db1.get(), db2.get()}) {
+        uint64_t sst_size;
+        ASSERT_TRUE(db->GetIntProperty(db->GetColumnFamily(0u), "tinydb.total-sst-files-size",
+                                       &sst_size));
+        EXPECT_GT(sst_size, 0u);
+    }
+
+    db1.reset();
+    db2.reset();
+    EXPECT_EQ(0u, wbm.memory_usage());
+}
+
+} // namespace tinydb